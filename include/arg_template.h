@@ -0,0 +1,113 @@
+/*****************************************************************************
+
+arg_template.h
+
+Argument Expansion Template Interface
+
+*****************************************************************************/
+
+#ifndef _ARG_TEMPLATE_H
+#define _ARG_TEMPLATE_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define ARG_TEMPLATE_LITERAL ( 0xFFFFFFFFUL )
+                                    /* segment holds literal text           */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct arg_segment_s {      /* compiled string segment type         */
+    DWORD               variable;   /* variable referenced, or              */
+                                    /* ARG_TEMPLATE_LITERAL                 */
+    DWORD               offset;     /* literal text in the pool             */
+    DWORD               length;     /* literal length (characters)          */
+} arg_segment_type;
+
+typedef struct arg_variable_s {     /* referenced variable type             */
+    DWORD               name;       /* offset of the name in the pool       */
+    DWORD               name_length;/* length of the name (characters)      */
+    DWORD               hash;       /* hash of the name (case folded)       */
+    DWORD               value;      /* offset of the value in the pool      */
+    DWORD               value_length;
+                                    /* length of the value (characters)     */
+    BOOL                defined;    /* the variable was found (undefined    */
+                                    /* variables are left as written)       */
+} arg_variable_type;
+
+typedef struct arg_template_s {     /* compiled string table type           */
+    DWORD               count;      /* number of compiled strings           */
+    DWORD               capacity;   /* number of strings allocated          */
+    DWORD*              first;      /* first segment of each string, plus   */
+                                    /* the end of the last                  */
+    DWORD               segment_count;
+                                    /* number of segments                   */
+    DWORD               segment_capacity;
+                                    /* number of segments allocated         */
+    arg_segment_type*   segments;   /* every string's segments              */
+    DWORD               variable_count;
+                                    /* number of distinct variables         */
+    DWORD               variable_capacity;
+                                    /* number of variables allocated        */
+    arg_variable_type*  variables;  /* distinct variables, in the order     */
+                                    /* they were first referenced           */
+    DWORD               resolved;   /* variables looked up so far           */
+    DWORD               bucket_count;
+                                    /* size of the hash table (power of 2)  */
+    DWORD*              buckets;    /* variable index for each hash, or     */
+                                    /* ARG_TEMPLATE_LITERAL                 */
+    LPTSTR              pool;       /* literal text, names and values       */
+    DWORD               used;       /* characters used in the pool          */
+    DWORD               size;       /* characters allocated for the pool    */
+} arg_template_type;                /* an all-zero table is empty           */
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type arg_template_add(        /* compile a string into the table      */
+    arg_template_type*  table,      /* compiled string table                */
+    LPCTSTR             text,       /* string with %VARIABLE% references    */
+    DWORD*              index       /* returned index of compiled string    */
+);                                  /* returns error code                   */
+
+void arg_template_free(             /* release a compiled string table      */
+    arg_template_type*  table       /* compiled string table                */
+);
+
+DWORD arg_template_length(          /* measure an expanded string           */
+    const arg_template_type*
+                        table,      /* compiled string table                */
+    DWORD               index       /* index of compiled string             */
+);                                  /* returns length (characters)          */
+
+error_type arg_template_resolve(    /* look up variables not yet resolved   */
+    arg_template_type*  table       /* compiled string table                */
+);                                  /* returns error code                   */
+
+LPTSTR arg_template_write(          /* expand a compiled string             */
+    const arg_template_type*
+                        table,      /* compiled string table                */
+    DWORD               index,      /* index of compiled string             */
+    LPTSTR              buffer      /* destination, at least the expanded   */
+                                    /* length plus a terminator             */
+);                                  /* returns the terminator written       */
+
+#endif  /* _ARG_TEMPLATE_H */
+
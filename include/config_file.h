@@ -0,0 +1,153 @@
+/*****************************************************************************
+
+config_file.h
+
+Session Configuration File Interface
+
+*****************************************************************************/
+
+#ifndef _CONFIG_FILE_H
+#define _CONFIG_FILE_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "arg_template.h"
+#include "error_types.h"
+#include "json_scan.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define CONFIG_FILE_NAME    _T( "winsession.json" )
+                                    /* configuration file in %UserProfile%  */
+
+#define CONFIG_NAME_LIMIT   ( 256 ) /* longest session name (characters)    */
+
+#define CONFIG_NONE         ( ( DWORD ) -1 )
+                                    /* index of no session                  */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct config_entry_s {     /* indexed session entry type           */
+    json_span_type      name;       /* raw session name                     */
+    json_span_type      value;      /* raw list of windows, or object with  */
+                                    /* "windows" and "monitors"             */
+    BOOL                escaped;    /* the name contains escape sequences   */
+} config_entry_type;
+
+typedef struct config_file_s {      /* mapped configuration file type       */
+    HANDLE              file;       /* configuration file handle            */
+    HANDLE              mapping;    /* file mapping handle                  */
+    LPCSTR              text;       /* mapped UTF-8 text of the file        */
+    DWORD               size;       /* size of the file (bytes)             */
+    json_span_type      config;     /* raw "config" section                 */
+    json_span_type      restore;    /* raw "restore" section                */
+    DWORD               count;      /* number of sessions                   */
+    config_entry_type*  entries;    /* sessions, in file order              */
+    const struct config_index_header_s*
+                        index;      /* compiled index in use, or NULL       */
+    arg_template_type   templates;  /* commands and arguments of the        */
+                                    /* sessions loaded so far               */
+} config_file_type;
+
+typedef struct config_window_s {    /* configured window type               */
+    LPTSTR              name;       /* window name, or NULL                 */
+    RECT                rectangle;  /* window rectangle (left, top, right,  */
+                                    /* bottom)                              */
+    LPTSTR              command;    /* program to run, or NULL              */
+    DWORD               argument_count;
+                                    /* number of arguments                  */
+    LPTSTR              arguments;  /* arguments as a double-NUL terminated */
+                                    /* list, or NULL                        */
+    DWORD               after_count;/* number of windows to start after     */
+    LPTSTR              after;      /* names of windows to start after as a */
+                                    /* double-NUL terminated list, or NULL  */
+    BOOL                wait;       /* later windows wait for this window   */
+                                    /* to appear, not just its launch       */
+    const arg_template_type*
+                        templates;  /* compiled command and arguments, or   */
+                                    /* NULL                                 */
+    DWORD               template;   /* compiled command (the arguments      */
+                                    /* follow it)                           */
+} config_window_type;
+
+typedef struct config_monitor_s {   /* captured monitor type                */
+    RECT                rectangle;  /* monitor rectangle (desktop           */
+                                    /* coordinates)                         */
+    RECT                work;       /* work area (without the taskbar)      */
+    DWORD               dpi;        /* dots per inch, or 0 if unknown       */
+} config_monitor_type;
+
+typedef struct config_session_s {   /* decoded session type                 */
+    LPTSTR              name;       /* session name                         */
+    DWORD               monitor_count;
+                                    /* number of captured monitors          */
+    const config_monitor_type*
+                        monitors;   /* monitors the rectangles were         */
+                                    /* captured on, or NULL                 */
+    DWORD               count;      /* number of windows                    */
+    config_window_type  windows[];  /* list of windows                      */
+} config_session_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+void config_close(                  /* unmap a configuration file           */
+    config_file_type*   config      /* configuration file object            */
+);
+
+error_type config_default_path(     /* get the user's configuration path    */
+    LPTSTR              path,       /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+);                                  /* returns error code                   */
+
+DWORD config_find(                  /* find a session by name               */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             name        /* session name                         */
+);                                  /* returns index, or CONFIG_NONE        */
+
+void config_free_session(           /* release a decoded session            */
+    config_session_type*
+                        session     /* session from config_load             */
+);
+
+error_type config_load(             /* decode one session                   */
+    config_file_type*   config,     /* configuration file object            */
+    DWORD               index,      /* index of session                     */
+    config_session_type**
+                        session     /* returned session (one allocation,    */
+                                    /* valid until config_close)            */
+);                                  /* returns error code                   */
+
+error_type config_name(             /* decode a session's name              */
+    config_file_type*   config,     /* configuration opened from its source */
+    DWORD               index,      /* index of session                     */
+    LPTSTR              name,       /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+);                                  /* returns error code                   */
+
+error_type config_open(             /* map and index a configuration file   */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path        /* path to configuration file           */
+);                                  /* returns error code                   */
+
+error_type config_read(             /* read a configuration into memory     */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path        /* path to configuration file           */
+);                                  /* returns error code                   */
+
+#endif  /* _CONFIG_FILE_H */
+
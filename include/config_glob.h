@@ -0,0 +1,77 @@
+/*****************************************************************************
+
+config_glob.h
+
+Session Name Globbing Interface
+
+*****************************************************************************/
+
+#ifndef _CONFIG_GLOB_H
+#define _CONFIG_GLOB_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct config_glob_name_s {
+                                    /* sorted session name type             */
+    LPCTSTR             name;       /* session name                         */
+    DWORD               index;      /* index of session                     */
+} config_glob_name_type;
+
+typedef struct config_glob_s {      /* session name table type              */
+    DWORD               count;      /* number of distinct names             */
+    config_glob_name_type*
+                        names;      /* names in ascending order             */
+    LPVOID              block;      /* allocation holding the table         */
+} config_glob_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+int config_glob_compare(            /* order names (then sessions)          */
+    const void*         left,       /* left-hand name                       */
+    const void*         right       /* right-hand name                      */
+);                                  /* returns relative order               */
+
+void config_glob_free(              /* release a session name table         */
+    config_glob_type*   glob        /* session name table                   */
+);
+
+error_type config_glob_init(        /* build a sorted session name table    */
+    config_glob_type*   glob,       /* session name table to initialize     */
+    config_file_type*   config      /* open configuration file              */
+);                                  /* returns error code                   */
+
+error_type config_glob_match(       /* select sessions with glob patterns   */
+    config_glob_type*   glob,       /* session name table                   */
+    LPCTSTR*            patterns,   /* patterns using * and ?               */
+    DWORD               pattern_count,
+                                    /* number of patterns                   */
+    DWORD*              indices,    /* returned session indices (room for   */
+                                    /* glob->count items)                   */
+    DWORD*              count,      /* returned number of sessions          */
+    BOOL*               matched     /* per-pattern match flags, or NULL     */
+);                                  /* returns error code                   */
+
+#endif  /* _CONFIG_GLOB_H */
+
@@ -0,0 +1,140 @@
+/*****************************************************************************
+
+config_index.h
+
+Compiled Session Index Interface
+
+*****************************************************************************/
+
+#ifndef _CONFIG_INDEX_H
+#define _CONFIG_INDEX_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "config_glob.h"
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define CONFIG_INDEX_EXTENSION  _T( ".idx" )
+                                    /* replaces the configuration extension */
+
+#define CONFIG_INDEX_MAGIC  ( 0x58495357 )
+                                    /* "WSIX" as a little-endian DWORD      */
+
+#define CONFIG_INDEX_VERSION    ( 4 )
+                                    /* current layout of the index file     */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct config_index_header_s {
+                                    /* index file header type               */
+    DWORD               magic;      /* CONFIG_INDEX_MAGIC                   */
+    DWORD               version;    /* CONFIG_INDEX_VERSION                 */
+    DWORD               char_size;  /* size of a stored character (bytes)   */
+    DWORD               size;       /* size of the index file (bytes)       */
+    FILETIME            source_time;/* last write of the source file        */
+    DWORD               source_size;/* size of the source file (bytes)      */
+    DWORD               bucket_count;
+                                    /* number of hash buckets (power of 2)  */
+    DWORD               buckets;    /* first session in each bucket         */
+    DWORD               session_count;
+                                    /* number of session records            */
+    DWORD               sessions;   /* session records                      */
+    DWORD               order;      /* session indices sorted by name       */
+    DWORD               window_count;
+                                    /* number of window records             */
+    DWORD               windows;    /* window records                       */
+    DWORD               monitor_count;
+                                    /* number of monitor records            */
+    DWORD               monitors;   /* monitor records                      */
+    DWORD               strings;    /* string table                         */
+    DWORD               string_size;/* size of string table (bytes)         */
+    json_span_type      config;     /* raw "config" section                 */
+    json_span_type      restore;    /* raw "restore" section                */
+} config_index_header_type;
+
+typedef struct config_index_session_s {
+                                    /* indexed session record type          */
+    DWORD               name;       /* session name                         */
+    DWORD               hash;       /* hash of the session name             */
+    DWORD               next;       /* next session in bucket, or           */
+                                    /* CONFIG_NONE                          */
+    DWORD               first;      /* index of first window record         */
+    DWORD               count;      /* number of window records             */
+    DWORD               monitor_first;
+                                    /* index of first monitor record        */
+    DWORD               monitor_count;
+                                    /* number of monitor records            */
+} config_index_session_type;
+
+typedef struct config_index_window_s {
+                                    /* indexed window record type           */
+    DWORD               name;       /* window name                          */
+    RECT                rectangle;  /* window rectangle                     */
+    DWORD               command;    /* program to run                       */
+    DWORD               argument_count;
+                                    /* number of arguments                  */
+    DWORD               arguments;  /* double-NUL terminated argument list  */
+    DWORD               after_count;/* number of windows to start after     */
+    DWORD               after;      /* double-NUL terminated window names   */
+    BOOL                wait;       /* later windows wait for it to appear  */
+} config_index_window_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type config_index_compile(    /* write the index for a configuration  */
+    config_file_type*   config,     /* configuration opened from its source */
+    LPCTSTR             path        /* path to the source file              */
+);                                  /* returns error code                   */
+
+DWORD config_index_find(            /* find a session with the hash index   */
+    config_file_type*   config,     /* configuration opened from its index  */
+    LPCTSTR             name        /* session name                         */
+);                                  /* returns index, or CONFIG_NONE        */
+
+error_type config_index_load(       /* build a session from its records     */
+    config_file_type*   config,     /* configuration opened from its index  */
+    DWORD               index,      /* index of session                     */
+    config_session_type**
+                        session     /* returned session (one allocation)    */
+);                                  /* returns error code                   */
+
+error_type config_index_names(      /* list session names in sorted order   */
+    config_file_type*   config,     /* configuration opened from its index  */
+    config_glob_name_type*
+                        names,      /* list to fill (config->count items)   */
+    DWORD*              count       /* returned number of names             */
+);                                  /* returns error code                   */
+
+error_type config_index_open(       /* map a current index for a source     */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path,       /* path to the source file              */
+    const FILETIME*     source_time,/* last write of the source file        */
+    DWORD               source_size /* size of the source file (bytes)      */
+);                                  /* returns error code                   */
+
+error_type config_index_path(       /* derive the index path for a source   */
+    LPCTSTR             path,       /* path to the source file              */
+    LPTSTR              index_path, /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+);                                  /* returns error code                   */
+
+#endif  /* _CONFIG_INDEX_H */
+
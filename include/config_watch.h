@@ -0,0 +1,102 @@
+/*****************************************************************************
+
+config_watch.h
+
+Configuration File Watch Interface
+
+*****************************************************************************/
+
+#ifndef _CONFIG_WATCH_H
+#define _CONFIG_WATCH_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define CONFIG_WATCH_BUFFER ( 4096 )/* change notification buffer (bytes)   */
+
+#define CONFIG_WATCH_SLACK  ( 256 ) /* compiled strings left behind by      */
+                                    /* changed sessions before the          */
+                                    /* templates are rebuilt                */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct config_cached_s {    /* cached session type                  */
+    DWORD               hash;       /* hash of the session's raw name and   */
+                                    /* value                                */
+    config_session_type*
+                        session;    /* decoded session, or NULL             */
+    RECT*               rectangles; /* configured rectangles (restoring     */
+                                    /* moves the session's in place)        */
+    DWORD               strings;    /* number of compiled strings           */
+} config_cached_type;
+
+typedef struct config_watch_s {     /* configuration file watch type        */
+    TCHAR               path[ MAX_PATH ];
+                                    /* configuration file path              */
+    WCHAR               name[ MAX_PATH ];
+                                    /* file name, as changes report it      */
+    DWORD               name_length;/* length of the file name (characters) */
+    HANDLE              directory;  /* directory holding the file, or NULL  */
+    HANDLE              event;      /* signaled when changes are reported   */
+    OVERLAPPED          overlapped; /* pending request for changes          */
+    DWORD               changes[ CONFIG_WATCH_BUFFER / sizeof( DWORD ) ];
+                                    /* reported changes                     */
+    BOOL                stale;      /* the file changed since it was read   */
+    DWORD               count;      /* number of sessions                   */
+    config_cached_type* cached;     /* each session's cache entry           */
+    DWORD               live;       /* compiled strings of cached sessions  */
+} config_watch_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+void config_watch_close(            /* stop watching, and release sessions  */
+    config_watch_type*  watch       /* configuration file watch             */
+);
+
+error_type config_watch_load(       /* get a session, decoding it only if   */
+                                    /* it is not cached                     */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_file_type*   config,     /* configuration read by the watch      */
+    DWORD               index,      /* index of session                     */
+    config_session_type**
+                        session     /* returned session (owned by the       */
+                                    /* watch until the next reload)         */
+);                                  /* returns error code                   */
+
+error_type config_watch_open(       /* read a configuration, and watch it   */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path        /* path to configuration file           */
+);                                  /* returns error code                   */
+
+BOOL config_watch_poll(             /* check for changes to the file        */
+    config_watch_type*  watch       /* configuration file watch             */
+);                                  /* returns TRUE if it must be reloaded  */
+
+error_type config_watch_reload(     /* read the file again, keeping the     */
+                                    /* sessions that did not change         */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_file_type*   config      /* configuration read by the watch      */
+);                                  /* returns error code (the old          */
+                                    /* configuration is kept on failure)    */
+
+#endif  /* _CONFIG_WATCH_H */
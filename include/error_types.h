@@ -38,7 +38,11 @@ enum {                              /* interface error codes                */
     ERR_UNKNOWN     = SHRT_MIN,     /* unknown/undefined error              */
     ERR_USAGE,                      /* interface usage error                */
     ERR_ALLOC,                      /* memory allocation error              */
-    ERR_WINAPI                      /* error from Windows API               */
+    ERR_WINAPI,                     /* error from Windows API               */
+    ERR_TIMEOUT,                    /* operation abandoned at its deadline  */
+    ERR_OVERFLOW,                   /* user buffer too small                */
+    ERR_FORMAT,                     /* malformed input data                 */
+    ERR_NOT_FOUND                   /* requested item does not exist        */
 };
 
 #endif  /* _ERROR_TYPES_H */
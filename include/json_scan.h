@@ -0,0 +1,96 @@
+/*****************************************************************************
+
+json_scan.h
+
+Streaming JSON Scanner Interface
+
+*****************************************************************************/
+
+#ifndef _JSON_SCAN_H
+#define _JSON_SCAN_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef enum json_token_e {         /* JSON token types                     */
+    JSON_ERROR,                     /* malformed or truncated text          */
+    JSON_END,                       /* end of a container or of the text    */
+    JSON_OBJECT,                    /* start of an object                   */
+    JSON_ARRAY,                     /* start of an array                    */
+    JSON_STRING,                    /* string                               */
+    JSON_NUMBER,                    /* number                               */
+    JSON_LITERAL                    /* true, false, or null                 */
+} json_token_type;
+
+typedef struct json_span_s {        /* span of JSON text type               */
+    DWORD               offset;     /* offset of span in text (bytes)       */
+    DWORD               length;     /* length of span (bytes)               */
+} json_span_type;
+
+typedef struct json_cursor_s {      /* JSON scanning position type          */
+    LPCSTR              text;       /* UTF-8 text being scanned             */
+    DWORD               size;       /* size of text (bytes)                 */
+    DWORD               offset;     /* current position in text (bytes)     */
+} json_cursor_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD json_decode(                  /* decode a string span to UTF-16       */
+    LPCSTR              text,       /* UTF-8 text holding the span          */
+    json_span_type*     span,       /* raw string contents (no quotes)      */
+    LPWSTR              target      /* destination, at least span->length   */
+                                    /* characters                           */
+);                                  /* returns characters written (no NUL)  */
+
+BOOL json_enter(                    /* step into an object or array         */
+    json_cursor_type*   cursor      /* scanning position                    */
+);                                  /* returns TRUE if a container started  */
+
+void json_init(                     /* start scanning a JSON text           */
+    json_cursor_type*   cursor,     /* scanning position to initialize      */
+    LPCSTR              text,       /* UTF-8 text to scan                   */
+    DWORD               size        /* size of text (bytes)                 */
+);
+
+BOOL json_next(                     /* move to a container's next item      */
+    json_cursor_type*   cursor      /* scanning position                    */
+);                                  /* returns FALSE at the container's end */
+
+BOOL json_number(                   /* scan an integer value                */
+    json_cursor_type*   cursor,     /* scanning position                    */
+    LONG*               value       /* returned value                       */
+);                                  /* returns TRUE if a number was scanned */
+
+json_token_type json_peek(          /* get the type of the next token       */
+    json_cursor_type*   cursor      /* scanning position                    */
+);                                  /* returns token type                   */
+
+BOOL json_skip(                     /* skip a value without decoding it     */
+    json_cursor_type*   cursor,     /* scanning position                    */
+    json_span_type*     span        /* returned span of the value, or NULL  */
+);                                  /* returns TRUE if a value was skipped  */
+
+BOOL json_string(                   /* scan a string value                  */
+    json_cursor_type*   cursor,     /* scanning position                    */
+    json_span_type*     span        /* returned raw contents (no quotes)    */
+);                                  /* returns TRUE if a string was scanned */
+
+#endif  /* _JSON_SCAN_H */
+
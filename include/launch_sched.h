@@ -0,0 +1,115 @@
+/*****************************************************************************
+
+launch_sched.h
+
+Session Launch Scheduler Interface
+
+*****************************************************************************/
+
+#ifndef _LAUNCH_SCHED_H
+#define _LAUNCH_SCHED_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "error_types.h"
+#include "proc_match.h"
+#include "window_watch.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define LAUNCH_SCHED_MAX_WORKERS ( MAXIMUM_WAIT_OBJECTS )
+                                    /* most worker threads in a launch      */
+
+#define LAUNCH_SCHED_TIMEOUT ( 30000 )
+                                    /* usual limit on a window wait (ms)    */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct launch_sched_item_s {/* launched window type                 */
+    error_type          result;     /* result of launching the window       */
+    DWORD               process_id; /* process ID, or 0                     */
+    HANDLE              process;    /* process handle, or NULL              */
+    HWND                window;     /* window that appeared, or NULL        */
+    DWORD               shown;      /* tick count when the window appeared  */
+    DWORD               started;    /* tick count when the launch started   */
+    DWORD               ready;      /* tick count when later windows could  */
+                                    /* start                                */
+    BOOL                reused;     /* an already running process' window   */
+                                    /* was placed instead of starting one   */
+} launch_sched_item_type;
+
+typedef struct launch_sched_backend_s {
+                                    /* window launching backend type        */
+    error_type          ( *start )( /* start a window's program             */
+        LPVOID          context,    /* backend's context                    */
+        const config_window_type*
+                        window,     /* configured window                    */
+        launch_sched_item_type*
+                        item        /* item to fill with the process        */
+    );                              /* returns error code                   */
+    error_type          ( *place )( /* move a window to its rectangle       */
+        LPVOID          context,    /* backend's context                    */
+        const config_window_type*
+                        window,     /* configured window                    */
+        launch_sched_item_type*
+                        item        /* item with the window that appeared   */
+    );                              /* returns error code                   */
+    void                ( *close )( /* release what start acquired          */
+        LPVOID          context,    /* backend's context                    */
+        launch_sched_item_type*
+                        item        /* started item                         */
+    );
+    const window_watch_source_type*
+                        source;     /* window events, or NULL for hooks on  */
+                                    /* the calling thread                   */
+    LPVOID              context;    /* passed to each function              */
+} launch_sched_backend_type;
+
+typedef struct launch_sched_s {     /* session launch type                  */
+    DWORD               count;      /* number of items                      */
+    launch_sched_item_type*
+                        items;      /* one item per window, in session      */
+                                    /* order                                */
+    DWORD               workers;    /* number of workers that ran           */
+    const launch_sched_backend_type*
+                        backend;    /* backend that started the items       */
+} launch_sched_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+void launch_sched_free(             /* release a session launch             */
+    launch_sched_type*  launch      /* launch object                        */
+);
+
+error_type launch_sched_run(        /* launch every window in a session     */
+    config_session_type*
+                        session,    /* session to launch                    */
+    const launch_sched_backend_type*
+                        backend,    /* backend, or NULL for CreateProcess   */
+    proc_match_type*    existing,   /* running processes to reuse, or NULL  */
+    DWORD               workers,    /* worker threads, or 0 for one per CPU */
+    DWORD               window_timeout,
+                                    /* limit on each window wait (ms), or   */
+                                    /* INFINITE                             */
+    launch_sched_type*  launch      /* launch object to initialize          */
+);                                  /* returns error code (ERR_TIMEOUT if   */
+                                    /* a window did not appear in time)     */
+
+#endif  /* _LAUNCH_SCHED_H */
+
@@ -0,0 +1,121 @@
+/*****************************************************************************
+
+monitor_layout.h
+
+Monitor Layout Remapping Interface
+
+*****************************************************************************/
+
+#ifndef _MONITOR_LAYOUT_H
+#define _MONITOR_LAYOUT_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define MONITOR_LAYOUT_LIMIT ( 16 ) /* most monitors in a profile (more are */
+                                    /* ignored)                             */
+
+#define MONITOR_LAYOUT_CACHE ( 8 )  /* remap tables kept for reuse          */
+
+#define MONITOR_LAYOUT_DPI   ( 96 ) /* dots per inch assumed when unknown   */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct monitor_transform_s {/* captured monitor's remap type        */
+    RECT                source;     /* captured monitor rectangle           */
+    LONG                from_left;  /* captured work area origin            */
+    LONG                from_top;
+    LONG                from_width; /* captured work area size (at least 1) */
+    LONG                from_height;
+    LONG                to_left;    /* target work area origin              */
+    LONG                to_top;
+    LONG                to_width;   /* target work area size                */
+    LONG                to_height;
+    LONG                scale;      /* size scale (target DPI)              */
+    LONG                unit;       /* size unit (captured DPI)             */
+    RECT                limits[ 2 ];/* rectangles are kept inside the       */
+                                    /* first (unbounded if the monitor did  */
+                                    /* not change), or the second (the      */
+                                    /* target work area) if they were off   */
+                                    /* every monitor                        */
+} monitor_transform_type;
+
+typedef struct monitor_map_s {      /* cached remap table type              */
+    DWORD               captured;   /* hash of the captured profile         */
+    DWORD               current;    /* hash of the current profile          */
+    DWORD               count;      /* number of captured monitors          */
+    BOOL                identity;   /* the profiles are the same            */
+    config_monitor_type monitors[ MONITOR_LAYOUT_LIMIT ];
+                                    /* captured profile                     */
+    monitor_transform_type
+                        transforms[ MONITOR_LAYOUT_LIMIT ];
+                                    /* remap of each captured monitor       */
+    DWORD               stamp;      /* remap call that last used the table  */
+    DWORD               base;       /* first transform in that call         */
+} monitor_map_type;
+
+typedef struct monitor_layout_s {   /* current monitor layout type          */
+    DWORD               count;      /* number of current monitors           */
+    config_monitor_type monitors[ MONITOR_LAYOUT_LIMIT ];
+                                    /* current profile, primary first       */
+    DWORD               hash;       /* hash of the current profile          */
+    DWORD               map_count;  /* number of cached tables              */
+    DWORD               next_map;   /* cached table replaced next           */
+    monitor_map_type    maps[ MONITOR_LAYOUT_CACHE ];
+                                    /* remap tables by profile pair         */
+    DWORD               stamp;      /* number of remap calls                */
+    DWORD               hits;       /* remap tables found in the cache      */
+    DWORD               misses;     /* remap tables built                   */
+} monitor_layout_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD monitor_layout_hash(          /* hash a monitor profile               */
+    const config_monitor_type*
+                        monitors,   /* monitors in the profile              */
+    DWORD               count       /* number of monitors                   */
+);                                  /* returns FNV-1a hash                  */
+
+error_type monitor_layout_open(     /* read the current monitor layout      */
+    monitor_layout_type*
+                        layout      /* layout object to initialize          */
+);                                  /* returns error code                   */
+
+error_type monitor_layout_remap(    /* move sessions' rectangles onto the   */
+                                    /* current monitors                     */
+    monitor_layout_type*
+                        layout,     /* current monitor layout               */
+    config_session_type**
+                        sessions,   /* decoded sessions (changed in place)  */
+    DWORD               count       /* number of sessions                   */
+);                                  /* returns error code                   */
+
+error_type monitor_layout_set(      /* use a given current monitor layout   */
+    monitor_layout_type*
+                        layout,     /* layout object to initialize          */
+    const config_monitor_type*
+                        monitors,   /* current monitors, primary first      */
+    DWORD               count       /* number of monitors                   */
+);                                  /* returns error code                   */
+
+#endif  /* _MONITOR_LAYOUT_H */
+
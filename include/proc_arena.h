@@ -0,0 +1,74 @@
+/*****************************************************************************
+
+proc_arena.h
+
+Process Information Arena Allocator Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_ARENA_H
+#define _PROC_ARENA_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_ARENA_ALIGN    ( sizeof( ULONGLONG ) )
+                                    /* alignment of every arena allocation  */
+
+#define PROC_ARENA_DEFAULT  ( 64 * 1024 )
+                                    /* default arena chunk size (bytes)     */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_arena_chunk_s { /* arena memory chunk type              */
+    struct proc_arena_chunk_s*
+                        next;       /* previously filled chunk              */
+    SIZE_T              size;       /* usable bytes in this chunk           */
+    SIZE_T              used;       /* bytes allocated from this chunk      */
+} proc_arena_chunk_type;
+
+typedef struct proc_arena_s {       /* bump allocator arena type            */
+    proc_arena_chunk_type*
+                        head;       /* chunk currently being allocated      */
+    SIZE_T              chunk_size; /* minimum size of new chunks           */
+} proc_arena_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+LPVOID proc_arena_alloc(            /* allocate memory from an arena        */
+    proc_arena_type*    arena,      /* arena to allocate from               */
+    SIZE_T              size        /* number of bytes to allocate          */
+);                                  /* returns memory, or NULL              */
+
+void proc_arena_free(               /* release all memory held by an arena  */
+    proc_arena_type*    arena       /* arena to release                     */
+);
+
+error_type proc_arena_init(         /* initialize an arena                  */
+    proc_arena_type*    arena,      /* arena to initialize                  */
+    SIZE_T              chunk_size  /* initial chunk size, or 0 for default */
+);                                  /* returns error code                   */
+
+error_type proc_arena_reset(        /* discard every allocation in an arena */
+    proc_arena_type*    arena       /* arena to reset                       */
+);                                  /* returns error code                   */
+
+#endif  /* _PROC_ARENA_H */
+
@@ -0,0 +1,52 @@
+/*****************************************************************************
+
+proc_args.h
+
+Command Line Argument Tokenizer Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_ARGS_H
+#define _PROC_ARGS_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_arg_view_s {    /* command line argument view type      */
+    DWORD               offset;     /* argument offset in buffer (chars)    */
+    DWORD               length;     /* argument length (characters)         */
+} proc_arg_view_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD proc_args_count(              /* count arguments in a command line    */
+    LPCWSTR             buffer,     /* command line                         */
+    DWORD               length      /* length of command line (characters)  */
+);                                  /* returns number of arguments          */
+
+DWORD proc_args_split(              /* split a command line in place        */
+    LPWSTR              buffer,     /* command line, unescaped in place     */
+    DWORD               length,     /* length of command line (characters)  */
+    proc_arg_view_type* views,      /* list of argument views to fill       */
+    DWORD               capacity    /* number of views in list              */
+);                                  /* returns number of arguments          */
+
+#endif  /* _PROC_ARGS_H */
+
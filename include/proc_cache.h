@@ -0,0 +1,84 @@
+/*****************************************************************************
+
+proc_cache.h
+
+Process Information Cache Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_CACHE_H
+#define _PROC_CACHE_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "error_types.h"
+#include "proc_capture.h"
+#include "proc_info.h"
+#include "proc_pool.h"
+#include "proc_snapshot.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+void proc_cache_free(               /* release every cached process         */
+    proc_instance_type* instance    /* process information instance         */
+);
+
+proc_info_type* proc_cache_get(     /* get a cached process' information    */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               id,         /* process ID                           */
+    proc_fields_t32     fields      /* mask of PROC_FIELD_* values to load  */
+);                                  /* returns information (valid until the */
+                                    /* next update), or NULL                */
+
+error_type proc_cache_insert(       /* start caching a process that started */
+    proc_instance_type* instance,   /* process information instance         */
+    const proc_record_type*
+                        record      /* record of the new process            */
+);                                  /* returns error code                   */
+
+error_type proc_cache_records(      /* describe the cached processes as a   */
+                                    /* snapshot                             */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot    /* snapshot object to initialize (its   */
+                                    /* records have no images or owners)    */
+);                                  /* returns error code                   */
+
+void proc_cache_remove(             /* stop caching a process that exited   */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               id,         /* process ID                           */
+    const FILETIME*     start_time  /* process creation time                */
+);
+
+error_type proc_cache_store(        /* keep a process' captured command     */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_pool_type*     pool,       /* pool the item's strings are in       */
+    const proc_capture_item_type*
+                        item        /* captured image and command           */
+);                                  /* returns error code (ERR_NOT_FOUND if */
+                                    /* the process is not cached)           */
+
+error_type proc_cache_update(       /* sync the cache with a new capture    */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot    /* capture of the current processes     */
+);                                  /* returns error code                   */
+
+#endif  /* _PROC_CACHE_H */
+
@@ -0,0 +1,84 @@
+/*****************************************************************************
+
+proc_capture.h
+
+Parallel Process Capture Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_CAPTURE_H
+#define _PROC_CAPTURE_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "error_types.h"
+#include "proc_arena.h"
+#include "proc_info.h"
+#include "proc_pool.h"
+#include "proc_snapshot.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_CAPTURE_MAX_WORKERS ( MAXIMUM_WAIT_OBJECTS )
+                                    /* most worker threads in a capture     */
+
+#define PROC_CAPTURE_POLL   ( 10 )  /* deadline check interval (ms)         */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_capture_item_s {/* captured process information type    */
+    DWORD               id;         /* process ID                           */
+    error_type          result;     /* result of querying the process       */
+    proc_fields_t32     fields;     /* fields that were loaded              */
+    DWORD               image;      /* pool ID of image file name           */
+    DWORD               directory;  /* pool ID of current directory         */
+    DWORD               count;      /* number of command strings            */
+    DWORD*              values;     /* pool ID of each command string       */
+    PSID                owner;      /* owner (user) SID                     */
+} proc_capture_item_type;
+
+typedef struct proc_capture_s {     /* parallel process capture type        */
+    DWORD               count;      /* number of captured processes         */
+    proc_capture_item_type*
+                        items;      /* captured processes, sorted by ID     */
+    DWORD               workers;    /* number of workers that ran           */
+    LPVOID              block;      /* state shared with the workers        */
+} proc_capture_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+void proc_capture_free(             /* release a parallel capture           */
+    proc_capture_type*  capture     /* capture object                       */
+);
+
+error_type proc_capture_run(        /* query every process in a snapshot    */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* processes to query                   */
+    proc_fields_t32     fields,     /* mask of PROC_FIELD_* values to load  */
+    DWORD               workers,    /* worker threads, or 0 for one per CPU */
+    DWORD               process_timeout,
+                                    /* per-process limit (ms), or INFINITE  */
+    DWORD               capture_timeout,
+                                    /* capture limit (ms), or INFINITE      */
+    proc_pool_type*     pool,       /* pool the strings are interned in     */
+                                    /* (must outlive the capture)           */
+    proc_capture_type*  capture     /* capture object to initialize         */
+);                                  /* returns error code (ERR_TIMEOUT if   */
+                                    /* any query ran out of time)           */
+
+#endif  /* _PROC_CAPTURE_H */
+
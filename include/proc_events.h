@@ -0,0 +1,103 @@
+/*****************************************************************************
+
+proc_events.h
+
+Process Start and Exit Events Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_EVENTS_H
+#define _PROC_EVENTS_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+#include <evntrace.h>
+#include <evntcons.h>
+
+#include "error_types.h"
+#include "proc_info.h"
+#include "proc_snapshot.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_EVENTS_NAME _T( "winsession process events" )
+                                    /* trace session name (this process' ID */
+                                    /* is appended)                         */
+
+#define PROC_EVENTS_NAME_SIZE ( 64 )/* longest session name (characters)    */
+
+#define PROC_EVENTS_FLUSH ( 10 )    /* longest an event waits in the trace  */
+                                    /* session's buffers (ms)               */
+
+#define PROC_EVENTS_LIMIT ( 4096 )  /* most changes waiting to be applied   */
+                                    /* (more are dropped, and the cache is  */
+                                    /* read again)                          */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_change_s {      /* process start or exit type           */
+    BOOL                started;    /* the process started (or else exited) */
+    proc_record_type    record;     /* process ID, parent, session, and     */
+                                    /* creation time                        */
+} proc_change_type;
+
+typedef struct proc_events_s {      /* process event subscription type      */
+    proc_instance_type* instance;   /* instance whose cache is kept current */
+    TCHAR               name[ PROC_EVENTS_NAME_SIZE ];
+                                    /* trace session name                   */
+    TRACEHANDLE         session;    /* trace session, or 0                  */
+    TRACEHANDLE         trace;      /* events being delivered, or           */
+                                    /* INVALID_PROCESSTRACE_HANDLE          */
+    HANDLE              thread;     /* thread delivering events, or NULL    */
+    CRITICAL_SECTION    lock;       /* protects the changes                 */
+    DWORD               count;      /* number of changes                    */
+    DWORD               capacity;   /* number of changes allocated          */
+    proc_change_type*   changes;    /* changes not yet applied, in order    */
+    BOOL                lost;       /* changes were dropped since the last  */
+                                    /* time they were applied               */
+    ULONG               dropped;    /* events the session had lost when     */
+                                    /* the cache was last read              */
+    HANDLE              ready;      /* set while changes wait to be applied */
+} proc_events_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type proc_events_apply(       /* bring the cache up to date           */
+    proc_events_type*   events      /* process event subscription           */
+);                                  /* returns error code                   */
+
+void proc_events_close(             /* stop following process events        */
+    proc_events_type*   events      /* process event subscription           */
+);
+
+error_type proc_events_decode(      /* read a traced process start or exit  */
+    const EVENT_RECORD* record,     /* traced event                         */
+    proc_change_type*   change      /* returned start or exit               */
+);                                  /* returns error code (ERR_NOT_FOUND if */
+                                    /* it is neither, ERR_FORMAT if its     */
+                                    /* fields are cut short)                */
+
+error_type proc_events_open(        /* cache every process, and follow      */
+                                    /* their starts and exits               */
+    proc_events_type*   events,     /* subscription object to initialize    */
+    proc_instance_type* instance    /* process information instance         */
+);                                  /* returns error code (ERR_WINAPI if    */
+                                    /* events can not be traced, e.g.       */
+                                    /* without the rights to trace)         */
+
+#endif  /* _PROC_EVENTS_H */
+
@@ -18,6 +18,9 @@ Includes
 #include <winternl.h>
 
 #include "error_types.h"
+#include "proc_arena.h"
+#include "proc_sid.h"
+#include "proc_volume.h"
 
 /*----------------------------------------------------------------------------
 Macros
@@ -42,32 +45,81 @@ typedef NTSTATUS ( NTAPI *proc_NtQueryInformationProcess_fun ) (
                                     /* length of returned information       */
 );                                  /* returns status of query              */
 
+typedef NTSTATUS ( NTAPI *proc_NtQuerySystemInformation_fun ) (
+                                    /* pointer to NT system query function  */
+    IN  SYSTEM_INFORMATION_CLASS
+                        SystemInformationClass,
+                                    /* information to query                 */
+    OUT PVOID           SystemInformation,
+                                    /* returned information                 */
+    IN  ULONG           SystemInformationLength,
+                                    /* information buffer length            */
+    OUT PULONG          ReturnLength                OPTIONAL
+                                    /* length of returned information       */
+);                                  /* returns status of query              */
+
 typedef struct proc_command_s {     /* process command type                 */
     LPTSTR              image;      /* path to process' running image       */
+    LPTSTR              directory;  /* process' current directory           */
     DWORD               count;      /* number of command strings            */
     LPTSTR              values[];   /* list of command strings              */
 } proc_command_type;
 
+typedef struct proc_cache_s {       /* process information cache type       */
+    struct proc_info_s* entries;    /* cached processes, sorted by ID       */
+    DWORD               count;      /* number of cached processes           */
+    DWORD               capacity;   /* number of entries allocated          */
+    BOOL                current;    /* every process is cached, and kept    */
+                                    /* current by process events            */
+} proc_cache_type;
+
 typedef struct proc_instance_s {    /* process interface instance type      */
     proc_NtQueryInformationProcess_fun
                         nqip;       /* pointer to NT query API function     */
+    proc_NtQuerySystemInformation_fun
+                        nqsi;       /* pointer to NT system query function  */
+    BOOL                wow64;      /* this process runs under WOW64        */
+    proc_sid_table_type sids;       /* owner SIDs interned by snapshots     */
+    proc_volume_table_type
+                        volumes;    /* NT device to drive letter mappings   */
+    proc_cache_type     cache;      /* processes kept between captures      */
 } proc_instance_type;
 
+typedef DWORD proc_fields_t32;      /* process information field mask       */
+
+enum {                              /* process information fields           */
+    PROC_FIELD_IMAGE     = 0x0001,  /* image file name                      */
+    PROC_FIELD_COMMAND   = 0x0002,  /* start command and arguments          */
+    PROC_FIELD_OWNER     = 0x0004,  /* owner (user) SID                     */
+    PROC_FIELD_SESSION   = 0x0008,  /* terminal services session ID         */
+    PROC_FIELD_START     = 0x0010,  /* process creation time                */
+    PROC_FIELD_DIRECTORY = 0x0020   /* current directory                    */
+};
+
 typedef struct proc_info_s {        /* process information type             */
     proc_instance_type* instance;   /* owner interface object               */
     DWORD               id;         /* process ID                           */
     HANDLE              handle;     /* process handle                       */
+    DWORD               access;     /* access rights of process handle      */
     HANDLE              token;      /* process token handle                 */
     PTOKEN_USER         user;       /* user information process token       */
     proc_command_type*  command;    /* process start command                */
+    proc_arena_type*    arena;      /* user's arena for PROC_ALLOC_ARENA    */
+    proc_fields_t32     fields;     /* fields loaded by proc_query          */
+    LPTSTR              image;      /* image file name                      */
+    DWORD               session;    /* terminal services session ID         */
+    FILETIME            start_time; /* process creation time                */
 } proc_info_type;
 
-typedef sint32 proc_alloc_t32;      /* process memory allocation spec       */
-                                    /* pass a 0 to request allocation, or   */
-                                    /* specify size (bytes) of buffer       */
+typedef LONG proc_alloc_t32;        /* process memory allocation spec       */
+                                    /* pass a 0 to request allocation, a    */
+                                    /* PROC_ALLOC_ARENA to allocate from    */
+                                    /* the info's arena, or specify size    */
+                                    /* (bytes) of buffer                    */
 
 enum {                              /* memory allocation specifications     */
-    PROC_ALLOC_ALLOCATE = 0         /* library should allocate memory       */
+    PROC_ALLOC_ALLOCATE = 0,        /* library should allocate memory       */
+    PROC_ALLOC_ARENA    = -1        /* library should use the info's arena  */
 };
 
 /*----------------------------------------------------------------------------
@@ -82,15 +134,20 @@ void proc_close(                    /* close query interface to process     */
     proc_info_type*     info        /* process information object           */
 );
 
+void proc_free_command(             /* release an allocated command object  */
+    proc_command_type*  command     /* command from PROC_ALLOC_ALLOCATE     */
+);
+
 error_type proc_get_command(        /* get the command used to start proc.  */
     proc_info_type*     info,       /* process information object           */
-    proc_command_type*  command,    /* user's command object memory         */
+    proc_command_type** command,    /* user's command object memory         */
     proc_alloc_t32      alloc       /* memory allocation specification      */
 );                                  /* returns error code                   */
 
 error_type proc_get_user_sid(       /* get the process' user SID            */
     proc_info_type*     info,       /* process information object           */
-    PSID                sid         /* pointer to destination SID variable  */
+    PSID                sid         /* destination SID variable, at least   */
+                                    /* SECURITY_MAX_SID_SIZE bytes          */
 );                                  /* returns error code                   */
 
 error_type proc_init(               /* initialize and interface instance    */
@@ -103,5 +160,14 @@ error_type proc_open(               /* open query interface to process      */
     DWORD               id          /* process ID to open                   */
 );                                  /* returns error code                   */
 
+error_type proc_query(              /* load several fields in one pass      */
+    proc_info_type*     info,       /* process information object           */
+    proc_fields_t32     fields      /* mask of PROC_FIELD_* values to load  */
+);                                  /* returns error code                   */
+
+void proc_term(                     /* release an interface instance        */
+    proc_instance_type* instance    /* process interface instance object    */
+);
+
 #endif  /* _PROC_INFO_H */
 
@@ -0,0 +1,149 @@
+/*****************************************************************************
+
+proc_match.h
+
+Running Process Matching Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_MATCH_H
+#define _PROC_MATCH_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "error_types.h"
+#include "proc_arena.h"
+#include "proc_capture.h"
+#include "proc_info.h"
+#include "proc_pool.h"
+#include "proc_snapshot.h"
+#include "window_list.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_MATCH_TIMEOUT ( 2000 ) /* usual limit on querying the running  */
+                                    /* processes (ms)                       */
+
+#define PROC_MATCH_NONE    ( 0 )    /* the process runs another program     */
+#define PROC_MATCH_IMAGE   ( 1 )    /* the process runs the same image      */
+#define PROC_MATCH_EXACT   ( 2 )    /* the process runs the same image with */
+                                    /* the same arguments                   */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_match_entry_s { /* running process entry type           */
+    DWORD               id;         /* process ID                           */
+    HWND                window;     /* process' first top-level window      */
+    DWORD               image;      /* pool ID of the image path            */
+    DWORD               path;       /* folded pool ID of the image path     */
+    DWORD               name;       /* folded pool ID of image file name    */
+    DWORD               count;      /* number of command strings            */
+    const DWORD*        values;     /* pool ID of each command string       */
+    DWORD               name_hash;  /* hash of image file name              */
+    DWORD               fingerprint;/* hash of the process' arguments       */
+    DWORD               next;       /* next entry in the bucket             */
+    volatile LONG       claimed;    /* a window has been matched to it      */
+} proc_match_entry_type;
+
+typedef struct proc_match_key_s {   /* configured program key type          */
+    TCHAR               path[ MAX_PATH ];
+                                    /* full path of the image, or the       */
+                                    /* command when it can not be found     */
+    LPCTSTR             name;       /* image file name, within the path     */
+    BOOL                resolved;   /* the full path is known               */
+    DWORD               name_hash;  /* hash of the image file name          */
+    DWORD               path_id;    /* folded pool ID of the path, or       */
+                                    /* PROC_POOL_NONE                       */
+    DWORD               name_id;    /* folded pool ID of the file name, or  */
+                                    /* PROC_POOL_NONE                       */
+    DWORD               raw;        /* fingerprint of arguments as given    */
+    DWORD               expanded;   /* fingerprint of expanded arguments    */
+} proc_match_key_type;
+
+typedef struct proc_match_s {       /* running process index type           */
+    DWORD               count;      /* number of entries                    */
+    proc_match_entry_type*
+                        entries;    /* processes with a top-level window,   */
+                                    /* sorted by process ID                 */
+    DWORD               bucket_count;
+                                    /* number of buckets (power of 2)       */
+    DWORD*              buckets;    /* first entry for each image file name */
+    proc_snapshot_type  snapshot;   /* processes that were indexed          */
+    proc_capture_type   capture;    /* images and commands of the processes */
+    proc_pool_type      strings;    /* images and command strings, interned */
+    proc_arena_type     ids;        /* command string IDs of cached         */
+                                    /* processes                            */
+    window_list_type    windows;    /* top-level windows that were listed   */
+} proc_match_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type proc_match_build(        /* index the processes that own windows */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               timeout,    /* limit on the process queries (ms),   */
+                                    /* or INFINITE                          */
+    BOOL                text,       /* also list window classes and titles  */
+    BOOL                cached,     /* reuse what earlier builds read from  */
+                                    /* processes that are still running     */
+    proc_match_type*    match       /* index object to initialize           */
+);                                  /* returns error code                   */
+
+error_type proc_match_claim(        /* claim a process already running a    */
+                                    /* configured window                    */
+    proc_match_type*    match,      /* index object                         */
+    const config_window_type*
+                        window,     /* configured window                    */
+    DWORD*              process_id, /* returned process ID                  */
+    HWND*               found       /* returned top-level window            */
+);                                  /* returns error code (ERR_NOT_FOUND if */
+                                    /* no unclaimed process matches)        */
+
+proc_match_entry_type* proc_match_find(
+                                    /* find a running process' entry        */
+    proc_match_type*    match,      /* index object                         */
+    DWORD               process_id  /* process ID                           */
+);                                  /* returns entry, or NULL if the        */
+                                    /* process is not indexed               */
+
+void proc_match_free(               /* release a running process index      */
+    proc_match_type*    match       /* index object                         */
+);
+
+error_type proc_match_key(          /* find the program a configured window */
+                                    /* would run                            */
+    proc_match_type*    match,      /* index whose strings the key is       */
+                                    /* looked up in                         */
+    const config_window_type*
+                        window,     /* configured window                    */
+    proc_match_key_type*
+                        key         /* returned program key                 */
+);                                  /* returns error code (ERR_NOT_FOUND if */
+                                    /* the window runs no program)          */
+
+DWORD proc_match_rank(              /* compare a running process to a       */
+                                    /* configured program                   */
+    const proc_match_entry_type*
+                        entry,      /* running process                      */
+    const proc_match_key_type*
+                        key         /* configured program (from the same    */
+                                    /* index)                               */
+);                                  /* returns PROC_MATCH_* rank            */
+
+#endif  /* _PROC_MATCH_H */
+
@@ -0,0 +1,101 @@
+/*****************************************************************************
+
+proc_pool.h
+
+Interned String Pool Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_POOL_H
+#define _PROC_POOL_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "error_types.h"
+#include "proc_arena.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_POOL_NONE      ( ( DWORD ) -1 )
+                                    /* ID of no string                      */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_pool_entry_s {  /* interned string entry type           */
+    DWORD               hash;       /* hash of the string                   */
+    DWORD               fold_hash;  /* hash of the string, ignoring case    */
+    DWORD               folded;     /* ID of the first string interned that */
+                                    /* is equal to this one ignoring case   */
+    DWORD               length;     /* length of the string (characters)    */
+    LPCTSTR             text;       /* string, in the pool's arena          */
+} proc_pool_entry_type;
+
+typedef struct proc_pool_s {        /* interned string pool type            */
+    CRITICAL_SECTION    lock;       /* serializes interns                   */
+    proc_pool_entry_type*
+                        entries;    /* list of distinct strings, by ID      */
+    DWORD               count;      /* number of distinct strings           */
+    DWORD               capacity;   /* number of entries allocated          */
+    DWORD*              slots;      /* hash slots holding ID + 1, or 0      */
+    DWORD*              folds;      /* hash slots holding the ID + 1 of     */
+                                    /* each string's folded ID, or 0        */
+    DWORD               slot_count; /* number of each kind of slot (power   */
+                                    /* of 2)                                */
+    DWORD               references; /* number of interns that found an      */
+                                    /* existing string                      */
+    SIZE_T              saved;      /* bytes those interns did not copy     */
+    proc_arena_type     arena;      /* storage for the strings              */
+} proc_pool_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD proc_pool_find(               /* look up the ID of an interned string */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to look up                    */
+    BOOL                fold_case   /* ignore case (returns a folded ID)    */
+);                                  /* returns ID, or PROC_POOL_NONE        */
+
+DWORD proc_pool_fold(               /* get the folded ID of a string        */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    DWORD               id          /* ID of an interned string             */
+);                                  /* returns ID shared by every string    */
+                                    /* equal to it ignoring case, or        */
+                                    /* PROC_POOL_NONE                       */
+
+void proc_pool_free(                /* release an interned string pool      */
+    proc_pool_type*     pool        /* interned string pool                 */
+);
+
+LPCTSTR proc_pool_get(              /* get the string for an ID             */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    DWORD               id          /* ID of an interned string             */
+);                                  /* returns string (valid until the pool */
+                                    /* is freed), or NULL                   */
+
+error_type proc_pool_init(          /* initialize an interned string pool   */
+    proc_pool_type*     pool        /* interned string pool                 */
+);                                  /* returns error code                   */
+
+error_type proc_pool_intern(        /* intern a string                      */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to intern                     */
+    DWORD*              id          /* returned ID of the string            */
+);                                  /* returns error code                   */
+
+#endif  /* _PROC_POOL_H */
+
@@ -0,0 +1,94 @@
+/*****************************************************************************
+
+proc_sid.h
+
+Interned Security Identifier Table Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_SID_H
+#define _PROC_SID_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_SID_NONE       ( ( DWORD ) -1 )
+                                    /* key of no SID                        */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_sid_entry_s {   /* interned SID entry type              */
+    DWORD               hash;       /* hash of the SID's bytes              */
+    DWORD               length;     /* length of the SID (bytes)            */
+    DWORD               offset;     /* offset of the SID in the data        */
+} proc_sid_entry_type;
+
+typedef struct proc_sid_table_s {   /* interned SID table type              */
+    proc_sid_entry_type*
+                        entries;    /* list of distinct SIDs, by key        */
+    DWORD               count;      /* number of distinct SIDs              */
+    DWORD               capacity;   /* number of entries allocated          */
+    DWORD*              slots;      /* hash slots holding key + 1, or 0     */
+    DWORD               slot_count; /* number of hash slots (power of 2)    */
+    LPBYTE              data;       /* storage for the SIDs' bytes          */
+    DWORD               data_used;  /* bytes of SID storage in use          */
+    DWORD               data_size;  /* bytes of SID storage allocated       */
+} proc_sid_table_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD proc_sid_find(                /* look up the key of an interned SID   */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    PSID                sid         /* SID to look up                       */
+);                                  /* returns key, or PROC_SID_NONE        */
+
+void proc_sid_free(                 /* release an interned SID table        */
+    proc_sid_table_type*
+                        table       /* interned SID table                   */
+);
+
+PSID proc_sid_get(                  /* get the SID for a key                */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    DWORD               key         /* key of an interned SID               */
+);                                  /* returns SID (valid until the next    */
+                                    /* intern), or NULL                     */
+
+error_type proc_sid_init(           /* initialize an interned SID table     */
+    proc_sid_table_type*
+                        table       /* interned SID table                   */
+);                                  /* returns error code                   */
+
+error_type proc_sid_intern(         /* intern a SID                         */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    PSID                sid,        /* SID to intern                        */
+    DWORD*              key         /* returned key of the SID              */
+);                                  /* returns error code                   */
+
+error_type proc_sid_user(           /* intern the invoking user's SID       */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    DWORD*              key         /* returned key of the user's SID       */
+);                                  /* returns error code                   */
+
+#endif  /* _PROC_SID_H */
+
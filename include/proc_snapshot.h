@@ -0,0 +1,91 @@
+/*****************************************************************************
+
+proc_snapshot.h
+
+Process Table Snapshot Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_SNAPSHOT_H
+#define _PROC_SNAPSHOT_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "error_types.h"
+#include "proc_info.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_SNAPSHOT_NONE  PROC_SID_NONE
+                                    /* record field has no value            */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_record_s {      /* process snapshot record type         */
+    DWORD               id;         /* process ID                           */
+    DWORD               parent;     /* parent process ID                    */
+    DWORD               session;    /* terminal services session ID         */
+    DWORD               image;      /* offset of image name in strings      */
+    DWORD               owner;      /* key of owner SID in instance table   */
+    FILETIME            start_time; /* process creation time                */
+} proc_record_type;
+
+typedef struct proc_snapshot_s {    /* process table snapshot type          */
+    proc_instance_type* instance;   /* instance holding the owner SIDs      */
+    DWORD               count;      /* number of process records            */
+    proc_record_type*   records;    /* list of records sorted by ID         */
+    LPTSTR              strings;    /* image name string table              */
+    LPVOID              block;      /* allocation backing the snapshot      */
+} proc_snapshot_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+proc_record_type* proc_snapshot_find(
+                                    /* find a process record by ID          */
+    proc_snapshot_type* snapshot,   /* process table snapshot               */
+    DWORD               id          /* process ID to find                   */
+);                                  /* returns record, or NULL              */
+
+void proc_snapshot_free(            /* release a process table snapshot     */
+    proc_snapshot_type* snapshot    /* process table snapshot               */
+);
+
+LPCTSTR proc_snapshot_image(        /* get a record's image name            */
+    proc_snapshot_type* snapshot,   /* process table snapshot               */
+    proc_record_type*   record      /* process record                       */
+);                                  /* returns image name string            */
+
+PSID proc_snapshot_owner(           /* get a record's owner SID             */
+    proc_snapshot_type* snapshot,   /* process table snapshot               */
+    proc_record_type*   record      /* process record                       */
+);                                  /* returns owner SID, or NULL           */
+
+error_type proc_snapshot_take(      /* capture the whole process table      */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot    /* snapshot object to initialize        */
+);                                  /* returns error code                   */
+
+error_type proc_snapshot_take_owned(
+                                    /* capture one owner's processes        */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* snapshot object to initialize        */
+    DWORD               owner       /* key of the owner SID to keep         */
+);                                  /* returns error code                   */
+
+#endif  /* _PROC_SNAPSHOT_H */
+
@@ -0,0 +1,77 @@
+/*****************************************************************************
+
+proc_volume.h
+
+NT Device Path Translation Interface
+
+*****************************************************************************/
+
+#ifndef _PROC_VOLUME_H
+#define _PROC_VOLUME_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <winternl.h>
+
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_VOLUME_DRIVES  ( 26 )  /* number of possible drive letters     */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_volume_entry_s {/* volume prefix mapping type           */
+    WCHAR               letter;     /* DOS drive letter                     */
+    USHORT              length;     /* length of device prefix (characters) */
+    WCHAR               device[ MAX_PATH ];
+                                    /* NT device prefix for the drive       */
+} proc_volume_entry_type;
+
+typedef struct proc_volume_table_s {/* volume prefix translation table      */
+    DWORD               drives;     /* drive mask the table was built from  */
+    BOOL                valid;      /* the table has been built             */
+    DWORD               count;      /* number of mappings in table          */
+    proc_volume_entry_type
+                        entries[ PROC_VOLUME_DRIVES ];
+                                    /* mappings, longest prefix first       */
+} proc_volume_table_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+void proc_volume_init(              /* initialize a translation table       */
+    proc_volume_table_type*
+                        table       /* volume translation table             */
+);
+
+void proc_volume_invalidate(        /* force a rebuild on the next refresh  */
+    proc_volume_table_type*
+                        table       /* volume translation table             */
+);
+
+error_type proc_volume_refresh(     /* rebuild the table if drives changed  */
+    proc_volume_table_type*
+                        table       /* volume translation table             */
+);                                  /* returns error code                   */
+
+BOOL proc_volume_translate(         /* translate an NT path to a DOS path   */
+    proc_volume_table_type*
+                        table,      /* volume translation table             */
+    PUNICODE_STRING     path        /* path, rewritten in place             */
+);                                  /* returns TRUE if path was translated  */
+
+#endif  /* _PROC_VOLUME_H */
+
@@ -0,0 +1,78 @@
+/*****************************************************************************
+
+restore_pipe.h
+
+Resident Restore Pipe Interface
+
+*****************************************************************************/
+
+#ifndef _RESTORE_PIPE_H
+#define _RESTORE_PIPE_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define RESTORE_PIPE_NAME   _T( "\\\\.\\pipe\\winsession" )
+                                    /* prefix of the pipe each user's       */
+                                    /* resident restore serves              */
+
+#define RESTORE_PIPE_NAME_SIZE ( 256 )
+                                    /* longest pipe name, with the session  */
+                                    /* ID and user SID (characters)         */
+
+#define RESTORE_PIPE_LIMIT  ( 64 )  /* most arguments in a request          */
+
+#define RESTORE_PIPE_SIZE   ( 4096 )/* largest request (characters)         */
+
+#define RESTORE_PIPE_TIMEOUT ( 1000 )
+                                    /* usual limit on connecting to a busy  */
+                                    /* resident restore (ms)                */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef BOOL ( *restore_pipe_handler_fun ) (
+                                    /* pointer to request handler function  */
+    LPVOID              context,    /* caller's context                     */
+    LPCTSTR*            arguments,  /* request's arguments                  */
+    DWORD               count,      /* number of arguments                  */
+    DWORD*              status      /* returned exit status for the client  */
+);                                  /* returns FALSE to stop serving        */
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type restore_pipe_send(       /* hand arguments to a resident restore */
+    LPCTSTR*            arguments,  /* arguments to send                    */
+    DWORD               count,      /* number of arguments                  */
+    DWORD               timeout,    /* limit on waiting for a busy pipe     */
+                                    /* (ms)                                 */
+    DWORD*              status      /* returned exit status of the request  */
+);                                  /* returns error code (ERR_NOT_FOUND if */
+                                    /* nothing is serving the pipe)         */
+
+error_type restore_pipe_serve(      /* answer requests until told to stop   */
+    restore_pipe_handler_fun
+                        handler,    /* function answering each request      */
+    LPVOID              context     /* passed to the handler                */
+);                                  /* returns error code (ERR_USAGE if     */
+                                    /* the pipe is already being served)    */
+
+#endif  /* _RESTORE_PIPE_H */
+
@@ -0,0 +1,134 @@
+/*****************************************************************************
+
+session_journal.h
+
+Session Autosave Journal Interface
+
+*****************************************************************************/
+
+#ifndef _SESSION_JOURNAL_H
+#define _SESSION_JOURNAL_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "error_types.h"
+#include "proc_match.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define SESSION_JOURNAL_EXTENSION _T( ".jnl" )
+                                    /* replaces the configuration extension */
+
+#define SESSION_JOURNAL_MAGIC ( 0x4C4A5357 )
+                                    /* "WSJL" as a little-endian DWORD      */
+
+#define SESSION_JOURNAL_VERSION ( 1 )
+                                    /* current layout of the journal file   */
+
+#define SESSION_JOURNAL_CHECKPOINT ( 64 )
+                                    /* changes written between full         */
+                                    /* checkpoints                          */
+
+#define SESSION_JOURNAL_LIMIT ( 256 * 1024 )
+                                    /* size of a journal that is compacted  */
+                                    /* to its latest checkpoint (bytes)     */
+
+#define SESSION_JOURNAL_INTERVAL ( 5000 )
+                                    /* usual time between autosaves (ms)    */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct session_journal_window_s {
+                                    /* journaled window type                */
+    DWORD               id;         /* window's identity (its handle when   */
+                                    /* it was saved)                        */
+    RECT                rectangle;  /* window rectangle                     */
+    DWORD               length;     /* length of the text (characters,      */
+                                    /* with every terminator)               */
+    DWORD               hash;       /* hash of the text                     */
+    LPTSTR              text;       /* command, then each argument, as a    */
+                                    /* double-NUL terminated list           */
+} session_journal_window_type;
+
+typedef struct session_journal_state_s {
+                                    /* saved desktop type                   */
+    DWORD               count;      /* number of windows                    */
+    DWORD               capacity;   /* number of windows allocated          */
+    session_journal_window_type*
+                        windows;    /* windows, sorted by identity          */
+} session_journal_state_type;       /* an all-zero state is empty           */
+
+typedef struct session_journal_s {  /* open journal type                    */
+    TCHAR               path[ MAX_PATH ];
+                                    /* journal file path                    */
+    HANDLE              file;       /* journal file handle                  */
+    DWORD               size;       /* size of the valid journal (bytes)    */
+    DWORD               sequence;   /* number of the next entry             */
+    DWORD               changes;    /* entries since the last checkpoint    */
+    session_journal_state_type
+                        state;      /* desktop as the journal records it    */
+    LPBYTE              buffer;     /* entry being written                  */
+    DWORD               buffer_size;/* size of the entry buffer (bytes)     */
+} session_journal_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type session_journal_capture( /* save the open windows of programs    */
+                                    /* that are running                     */
+    proc_match_type*    match,      /* running process index                */
+    session_journal_state_type*
+                        state       /* state to fill (emptied first)        */
+);                                  /* returns error code                   */
+
+void session_journal_close(         /* close an open journal                */
+    session_journal_type*
+                        journal     /* open journal                         */
+);
+
+void session_journal_free(          /* release a saved desktop              */
+    session_journal_state_type*
+                        state       /* saved desktop                        */
+);
+
+error_type session_journal_open(    /* open a journal for appending         */
+    session_journal_type*
+                        journal,    /* journal object to initialize         */
+    LPCTSTR             path        /* path to the journal file             */
+);                                  /* returns error code                   */
+
+error_type session_journal_path(    /* derive the journal path for a source */
+    LPCTSTR             path,       /* path to the configuration file       */
+    LPTSTR              journal_path,
+                                    /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+);                                  /* returns error code                   */
+
+error_type session_journal_recover( /* replay a journal                     */
+    LPCTSTR             path,       /* path to the journal file             */
+    session_journal_state_type*
+                        state       /* returned latest saved desktop        */
+);                                  /* returns error code                   */
+
+error_type session_journal_save(    /* append the changes to a desktop      */
+    session_journal_type*
+                        journal,    /* open journal                         */
+    const session_journal_state_type*
+                        state       /* current desktop                      */
+);                                  /* returns error code                   */
+
+#endif  /* _SESSION_JOURNAL_H */
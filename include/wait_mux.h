@@ -0,0 +1,108 @@
+/*****************************************************************************
+
+wait_mux.h
+
+Handle Wait Multiplexer Interface
+
+*****************************************************************************/
+
+#ifndef _WAIT_MUX_H
+#define _WAIT_MUX_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define WAIT_MUX_SHARD ( MAXIMUM_WAIT_OBJECTS - 1 )
+                                    /* handles waited on by each helper     */
+                                    /* thread (one slot is its signal)      */
+
+#define WAIT_MUX_NONE ( ( DWORD ) -1 )
+                                    /* tag is not being waited on           */
+
+#define WAIT_MUX_DONE ( ( DWORD ) -2 )
+                                    /* tag is signaled, but not reported    */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+struct wait_mux_s;
+
+typedef struct wait_mux_shard_s {   /* helper wait thread type              */
+    struct wait_mux_s*  mux;        /* multiplexer the shard belongs to     */
+    HANDLE              thread;     /* helper thread, or NULL if not yet    */
+                                    /* started                              */
+    HANDLE              signal;     /* event telling the helper its handles */
+                                    /* changed                              */
+    DWORD               count;      /* handles in use                       */
+    HANDLE              handles[ WAIT_MUX_SHARD ];
+                                    /* handles being waited on              */
+    DWORD               tags[ WAIT_MUX_SHARD ];
+                                    /* tag of each handle                   */
+} wait_mux_shard_type;
+
+typedef struct wait_mux_s {         /* handle wait multiplexer type         */
+    DWORD               capacity;   /* number of tags                       */
+    DWORD*              slots;      /* shard and slot of each tag, or       */
+                                    /* WAIT_MUX_NONE or WAIT_MUX_DONE       */
+    LPBYTE              queued;     /* each tag's place in the signaled     */
+                                    /* tags is taken                        */
+    wait_mux_shard_type*
+                        shards;     /* enough shards for every tag          */
+    DWORD               shard_count;/* number of shards                     */
+    DWORD*              done;       /* signaled tags, in order (a ring)     */
+    DWORD               head;       /* count of signaled tags taken         */
+    DWORD               tail;       /* count of signaled tags added         */
+    CRITICAL_SECTION    lock;       /* protects everything above            */
+    HANDLE              ready;      /* event set while signaled tags are    */
+                                    /* waiting to be reported               */
+    volatile LONG       stopping;   /* helpers must exit                    */
+} wait_mux_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type wait_mux_add(            /* start waiting on a handle            */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag,        /* handle's tag (below the capacity)    */
+    HANDLE              handle      /* handle to wait on (must stay open    */
+                                    /* until the multiplexer is closed)     */
+);                                  /* returns error code                   */
+
+void wait_mux_close(                /* stop every helper and release memory */
+    wait_mux_type*      mux         /* multiplexer object                   */
+);
+
+error_type wait_mux_next(           /* wait for the next signaled handle    */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               timeout,    /* limit on the wait (ms), or INFINITE  */
+    DWORD*              tag         /* returned handle's tag                */
+);                                  /* returns error code (ERR_TIMEOUT if   */
+                                    /* nothing was signaled in time)        */
+
+error_type wait_mux_open(           /* create a handle wait multiplexer     */
+    wait_mux_type*      mux,        /* multiplexer object to initialize     */
+    DWORD               capacity    /* number of tags                       */
+);                                  /* returns error code                   */
+
+void wait_mux_remove(               /* stop waiting on a handle             */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* handle's tag                         */
+);
+
+#endif  /* _WAIT_MUX_H */
+
@@ -0,0 +1,73 @@
+/*****************************************************************************
+
+window_layout.h
+
+Open Window Layout Interface
+
+*****************************************************************************/
+
+#ifndef _WINDOW_LAYOUT_H
+#define _WINDOW_LAYOUT_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "error_types.h"
+#include "proc_match.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct window_layout_item_s {
+                                    /* configured window's layout type      */
+    const config_session_type*
+                        session;    /* session the window belongs to        */
+    DWORD               index;      /* window index within the session      */
+    HWND                found;      /* open window assigned to it, or NULL  */
+    BOOL                moved;      /* the open window had to be moved      */
+    error_type          result;     /* ERR_NOT_FOUND if no open window      */
+                                    /* matches, or result of the move       */
+} window_layout_item_type;
+
+typedef struct window_layout_s {    /* layout pass result type              */
+    DWORD               count;      /* number of configured windows         */
+    window_layout_item_type*
+                        items;      /* each configured window, in session   */
+                                    /* order                                */
+    DWORD               moved;      /* number of windows moved              */
+} window_layout_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+void window_layout_free(            /* release a layout pass result         */
+    window_layout_type* layout      /* layout pass result                   */
+);
+
+error_type window_layout_run(       /* move open windows to their           */
+                                    /* configured rectangles                */
+    config_session_type**
+                        sessions,   /* sessions to lay out                  */
+    DWORD               count,      /* number of sessions                   */
+    proc_match_type*    running,    /* processes that own windows (built    */
+                                    /* with window text)                    */
+    window_layout_type* layout      /* returned result of each window       */
+);                                  /* returns error code                   */
+
+#endif  /* _WINDOW_LAYOUT_H */
+
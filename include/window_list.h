@@ -0,0 +1,76 @@
+/*****************************************************************************
+
+window_list.h
+
+Top-Level Window List Interface
+
+*****************************************************************************/
+
+#ifndef _WINDOW_LIST_H
+#define _WINDOW_LIST_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "error_types.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define WINDOW_LIST_TEXT ( 256 )    /* longest class name or title kept     */
+                                    /* (characters)                         */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct window_list_s {      /* top-level window list type           */
+    DWORD               count;      /* number of windows                    */
+    DWORD               capacity;   /* number of windows allocated          */
+    HWND*               windows;    /* window handles, in Z order           */
+    DWORD*              process_ids;/* process that owns each window        */
+    RECT*               rectangles; /* each window's screen rectangle       */
+    DWORD*              classes;    /* offset of each class name in strings */
+    DWORD*              titles;     /* offset of each title in strings      */
+    LPTSTR              strings;    /* class names and titles, or NULL      */
+    DWORD               used;       /* characters used in strings           */
+    DWORD               size;       /* characters allocated for strings     */
+    BOOL                text;       /* class names and titles are read      */
+    error_type          result;     /* result of reading the windows        */
+} window_list_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+LPCTSTR window_list_class(          /* get a window's class name            */
+    window_list_type*   list,       /* window list                          */
+    DWORD               index       /* window index                         */
+);                                  /* returns class name, or empty string  */
+
+void window_list_free(              /* release a window list                */
+    window_list_type*   list        /* window list                          */
+);
+
+error_type window_list_take(        /* list the visible, unowned top-level  */
+                                    /* windows                              */
+    window_list_type*   list,       /* window list to initialize            */
+    BOOL                text        /* also read class names and titles     */
+);                                  /* returns error code                   */
+
+LPCTSTR window_list_title(          /* get a window's title                 */
+    window_list_type*   list,       /* window list                          */
+    DWORD               index       /* window index                         */
+);                                  /* returns title, or empty string       */
+
+#endif  /* _WINDOW_LIST_H */
+
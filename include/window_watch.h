@@ -0,0 +1,182 @@
+/*****************************************************************************
+
+window_watch.h
+
+Window Appearance Watching Interface
+
+*****************************************************************************/
+
+#ifndef _WINDOW_WATCH_H
+#define _WINDOW_WATCH_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "error_types.h"
+#include "proc_info.h"
+#include "wait_mux.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define WINDOW_WATCH_HANDOFF ( 2000 )
+                                    /* how long an exited process' entry    */
+                                    /* waits for its image (ms)             */
+
+#define WINDOW_WATCH_ORPHANS ( 64 ) /* unmatched windows kept for entries   */
+                                    /* added after their window appeared    */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct window_watch_entry_s {
+                                    /* pending window entry type            */
+    DWORD               process_id; /* process expected to show the window  */
+    HANDLE              process;    /* process handle, or NULL              */
+    DWORD               image_hash; /* hash of image base name, or 0        */
+    LPCTSTR             image;      /* image base name, or NULL             */
+    DWORD               next_id;    /* next entry in process ID bucket      */
+    DWORD               next_image; /* next entry in image bucket           */
+    DWORD               deadline;   /* tick count ending an exited          */
+                                    /* process' wait                        */
+    BOOL                added;      /* the entry's tag has been used        */
+    BOOL                exited;     /* the process has exited               */
+    BOOL                pending;    /* still waiting for a window           */
+} window_watch_entry_type;
+
+typedef struct window_watch_orphan_s {
+                                    /* unmatched window type                */
+    DWORD               process_id; /* process that showed the window       */
+    HWND                window;     /* window that was shown                */
+} window_watch_orphan_type;
+
+struct window_watch_s;
+
+typedef struct window_watch_source_s {
+                                    /* window event source type             */
+    error_type          ( *open )(  /* start delivering window events       */
+        LPVOID          context,    /* source's context                     */
+        struct window_watch_s*
+                        watch       /* watch to deliver to                  */
+    );                              /* returns error code                   */
+    void                ( *wait )(  /* deliver events until one arrives,    */
+                                    /* the watch is woken, a process exits  */
+                                    /* (exits.ready), or time is up         */
+        LPVOID          context,    /* source's context                     */
+        struct window_watch_s*
+                        watch,      /* watch to deliver to                  */
+        DWORD           timeout     /* limit on the wait (ms), or INFINITE  */
+    );
+    error_type          ( *image )( /* get a process' image path            */
+        LPVOID          context,    /* source's context                     */
+        struct window_watch_s*
+                        watch,      /* watch asking                         */
+        DWORD           process_id, /* process ID                           */
+        LPTSTR          image,      /* destination string                   */
+        DWORD           size        /* size of destination (characters)     */
+    );                              /* returns error code                   */
+    void                ( *close )( /* stop delivering window events        */
+        LPVOID          context,    /* source's context                     */
+        struct window_watch_s*
+                        watch       /* watch being closed                   */
+    );
+    LPVOID              context;    /* passed to each function              */
+} window_watch_source_type;
+
+typedef struct window_watch_s {     /* window appearance watch type         */
+    const window_watch_source_type*
+                        source;     /* source of window events              */
+    DWORD               capacity;   /* number of entries (tags)             */
+    window_watch_entry_type*
+                        entries;    /* entries, indexed by tag              */
+    DWORD               bucket_count;
+                                    /* buckets per table (power of 2)       */
+    DWORD*              id_buckets; /* first entry for each process ID      */
+    DWORD*              image_buckets;
+                                    /* first entry for each image name      */
+    DWORD               images;     /* pending entries with an image        */
+    DWORD               exiting;    /* pending entries of exited processes  */
+    DWORD*              ready;      /* matched tags, in order               */
+    HWND*               windows;    /* window matched to each ready tag     */
+    DWORD               head;       /* next ready tag to report             */
+    DWORD               tail;       /* end of the ready tags                */
+    window_watch_orphan_type
+                        orphans[ WINDOW_WATCH_ORPHANS ];
+                                    /* recent unmatched windows             */
+    DWORD               orphan_next;/* next orphan slot to overwrite        */
+    wait_mux_type       exits;      /* waits on the watched processes       */
+    HANDLE              wake;       /* event that interrupts a wait         */
+    volatile LONG       woken;      /* the wait was interrupted             */
+    HWINEVENTHOOK       hook;       /* event hook of the default source     */
+    proc_instance_type  instance;   /* process queries of default source    */
+    BOOL                instance_ready;
+                                    /* instance has been initialized        */
+} window_watch_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+error_type window_watch_add(        /* wait for a process' window           */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               tag,        /* entry's tag (below the capacity)     */
+    DWORD               process_id, /* process that will show the window    */
+    HANDLE              process,    /* process handle, or NULL (kept open   */
+                                    /* until the watch is closed)           */
+    LPCTSTR             image       /* program path or name, or NULL (kept  */
+                                    /* while the entry is pending)          */
+);                                  /* returns error code                   */
+
+void window_watch_cancel(           /* stop waiting for an entry's window   */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               tag         /* entry's tag                          */
+);
+
+void window_watch_close(            /* stop watching for windows            */
+    window_watch_type*  watch       /* watch object                         */
+);
+
+void window_watch_exited(           /* report that a process exited         */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               process_id  /* process ID                           */
+);
+
+error_type window_watch_next(       /* wait for the next matched window     */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               timeout,    /* limit on the wait (ms), or INFINITE  */
+    DWORD*              tag,        /* returned entry's tag                 */
+    HWND*               window      /* returned window, or NULL if the      */
+                                    /* process exited without one           */
+);                                  /* returns error code (ERR_TIMEOUT if   */
+                                    /* nothing matched, or it was woken)    */
+
+error_type window_watch_open(       /* start watching for windows           */
+    window_watch_type*  watch,      /* watch object to initialize           */
+    const window_watch_source_type*
+                        source,     /* event source, or NULL for window     */
+                                    /* event hooks on this thread           */
+    DWORD               capacity    /* number of entries (tags)             */
+);                                  /* returns error code                   */
+
+void window_watch_post(             /* report that a window was shown       */
+    window_watch_type*  watch,      /* watch object                         */
+    HWND                window,     /* top-level window                     */
+    DWORD               process_id  /* process that owns the window         */
+);
+
+void window_watch_wake(             /* interrupt a wait from any thread     */
+    window_watch_type*  watch       /* watch object                         */
+);
+
+#endif  /* _WINDOW_WATCH_H */
+
@@ -0,0 +1,670 @@
+/*****************************************************************************
+
+arg_template.c
+
+Argument Expansion Templates
+
+A window's command and arguments may refer to environment variables
+(%UserProfile%, for instance).  Expanding every string on its own looks up
+the same few variables again and again, and needs a buffer for each string.
+
+Instead, each string is compiled once, when its session is loaded, into a
+list of segments: literal text, and references to variables.  Every
+variable is kept once per table, no matter how many strings refer to it,
+and is looked up once when the table is resolved.  Expanding a string is
+then only copying its segments into the caller's buffer, so a whole command
+line can be written in place.
+
+As with ExpandEnvironmentStrings, a variable that is not defined is left as
+it was written, and a '%' without a closing '%' is literal text.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "arg_template.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define TEMPLATE_FNV_BASIS  ( 2166136261UL )
+                                    /* FNV-1a offset basis                  */
+#define TEMPLATE_FNV_PRIME  ( 16777619UL )
+                                    /* FNV-1a prime                         */
+
+#define TEMPLATE_MIN_ITEMS  ( 16 )  /* fewest strings, segments, variables  */
+                                    /* or buckets allocated                 */
+
+#define TEMPLATE_MIN_POOL   ( 256 ) /* smallest pool allocated (characters) */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type add_segment(             /* append a segment to a table          */
+    arg_template_type*  table,      /* compiled string table                */
+    DWORD               variable,   /* variable, or ARG_TEMPLATE_LITERAL    */
+    LPCTSTR             text,       /* literal text                         */
+    DWORD               length      /* literal length (characters)          */
+);                                  /* returns error code                   */
+
+error_type append_pool(             /* copy text into a table's pool        */
+    arg_template_type*  table,      /* compiled string table                */
+    LPCTSTR             text,       /* text to copy                         */
+    DWORD               length,     /* length of text (characters)          */
+    DWORD*              offset      /* returned offset of the copy          */
+);                                  /* returns error code                   */
+
+error_type find_variable(           /* find or add a referenced variable    */
+    arg_template_type*  table,      /* compiled string table                */
+    LPCTSTR             name,       /* variable name (not terminated)       */
+    DWORD               length,     /* length of name (characters)          */
+    DWORD*              index       /* returned variable index              */
+);                                  /* returns error code                   */
+
+DWORD hash_name(                    /* hash a variable name                 */
+    LPCTSTR             name,       /* variable name                        */
+    DWORD               length      /* length of name (characters)          */
+);                                  /* returns FNV-1a hash (case folded)    */
+
+error_type rehash_variables(        /* resize a table's variable hash       */
+    arg_template_type*  table,      /* compiled string table                */
+    DWORD               bucket_count/* new number of buckets (power of 2)   */
+);                                  /* returns error code                   */
+
+BOOL resize_block(                  /* resize one of a table's arrays       */
+    LPVOID*             block,      /* array to resize (may be NULL)        */
+    SIZE_T              size        /* new size (bytes)                     */
+);                                  /* returns FALSE if out of memory       */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type arg_template_add(        /* compile a string into the table      */
+    arg_template_type*  table,      /* compiled string table                */
+    LPCTSTR             text,       /* string with %VARIABLE% references    */
+    DWORD*              index       /* returned index of compiled string    */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* new number of strings allocated      */
+    LPCTSTR             close;      /* closing '%' of a reference           */
+    LPCTSTR             literal;    /* start of pending literal text        */
+    error_type          result;     /* result of adding a segment           */
+    LPCTSTR             scan;       /* current character                    */
+    DWORD               variable;   /* referenced variable                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( table == NULL ) || ( text == NULL ) || ( index == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Make room for the string's entry, and the end of its segments.
+    ------------------------------------------------------------------*/
+    if( ( table->count + 1 ) >= table->capacity ) {
+        capacity = ( table->capacity == 0 )
+                 ? TEMPLATE_MIN_ITEMS : ( 2 * table->capacity );
+        if( resize_block(
+                ( LPVOID* ) &( table->first ),
+                ( capacity * sizeof( DWORD ) )
+            ) == FALSE ) {
+            return ERR_ALLOC;
+        }
+        table->capacity = capacity;
+    }
+    table->first[ table->count ] = table->segment_count;
+
+    /*------------------------------------------------------------------
+    Split the string at each %NAME% reference.  A '%' that does not
+    start a reference is part of the literal text around it.
+    ------------------------------------------------------------------*/
+    result  = ERR_OK;
+    literal = text;
+    for( scan = text; ( result == ERR_OK ) && ( *scan != _T( '\0' ) ); ) {
+        if( *scan != _T( '%' ) ) {
+            ++scan;
+            continue;
+        }
+        close = _tcschr( ( scan + 1 ), _T( '%' ) );
+        if( close == NULL ) {
+            break;
+        }
+        if( close == ( scan + 1 ) ) {
+            scan = close;
+            continue;
+        }
+        result = add_segment(
+            table,
+            ARG_TEMPLATE_LITERAL,
+            literal,
+            ( DWORD ) ( scan - literal )
+        );
+        if( result == ERR_OK ) {
+            result = find_variable(
+                table,
+                ( scan + 1 ),
+                ( DWORD ) ( close - scan - 1 ),
+                &variable
+            );
+        }
+        if( result == ERR_OK ) {
+            result = add_segment( table, variable, NULL, 0 );
+        }
+        scan    = close + 1;
+        literal = scan;
+    }
+    if( result == ERR_OK ) {
+        result = add_segment(
+            table,
+            ARG_TEMPLATE_LITERAL,
+            literal,
+            ( DWORD ) _tcslen( literal )
+        );
+    }
+
+    /*------------------------------------------------------------------
+    A string that could not be compiled is dropped.
+    ------------------------------------------------------------------*/
+    if( result != ERR_OK ) {
+        table->segment_count = table->first[ table->count ];
+        return result;
+    }
+    *index        = table->count;
+    table->count += 1;
+    table->first[ table->count ] = table->segment_count;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void arg_template_free(             /* release a compiled string table      */
+    arg_template_type*  table       /* compiled string table                */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              heap;       /* current process' heap handle         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( table == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release the table's arrays.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    if( table->first != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->first );
+    }
+    if( table->segments != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->segments );
+    }
+    if( table->variables != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->variables );
+    }
+    if( table->buckets != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->buckets );
+    }
+    if( table->pool != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->pool );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the table object.
+    ------------------------------------------------------------------*/
+    memset( table, 0, sizeof( arg_template_type ) );
+
+}
+
+
+/*==========================================================================*/
+DWORD arg_template_length(          /* measure an expanded string           */
+    const arg_template_type*
+                        table,      /* compiled string table                */
+    DWORD               index       /* index of compiled string             */
+) {                                 /* returns length (characters)          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* segment index                        */
+    DWORD               length;     /* expanded length                      */
+    const arg_segment_type*
+                        segment;    /* current segment                      */
+    const arg_variable_type*
+                        variable;   /* referenced variable                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( table == NULL ) || ( index >= table->count ) ) {
+        return 0;
+    }
+
+    /*------------------------------------------------------------------
+    Add up the segments.  A variable that was not found (or not looked
+    up yet) keeps its '%' delimiters.
+    ------------------------------------------------------------------*/
+    length = 0;
+    for( i = table->first[ index ]; i < table->first[ index + 1 ]; ++i ) {
+        segment = &( table->segments[ i ] );
+        if( segment->variable == ARG_TEMPLATE_LITERAL ) {
+            length += segment->length;
+            continue;
+        }
+        variable = &( table->variables[ segment->variable ] );
+        length  += ( variable->defined != FALSE )
+                 ? variable->value_length : ( variable->name_length + 2 );
+    }
+    return length;
+}
+
+
+/*==========================================================================*/
+error_type arg_template_resolve(    /* look up variables not yet resolved   */
+    arg_template_type*  table       /* compiled string table                */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               length;     /* length of a value (characters)       */
+    DWORD               room;       /* pool space left (characters)         */
+    DWORD               size;       /* new pool size (characters)           */
+    arg_variable_type*  variable;   /* variable being looked up             */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( table == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Look up each variable added since the last call, once.  The value
+    is read straight into the pool, which grows when it is too small.
+    ------------------------------------------------------------------*/
+    while( table->resolved < table->variable_count ) {
+        variable = &( table->variables[ table->resolved ] );
+        room     = table->size - table->used;
+        length   = GetEnvironmentVariable(
+            &( table->pool[ variable->name ] ),
+            &( table->pool[ table->used ] ),
+            room
+        );
+        if( length >= room ) {
+            size = ( 2 * table->size ) + length;
+            if( resize_block(
+                    ( LPVOID* ) &( table->pool ),
+                    ( size * sizeof( TCHAR ) )
+                ) == FALSE ) {
+                return ERR_ALLOC;
+            }
+            table->size = size;
+            continue;
+        }
+        variable->defined = ( ( length > 0 )
+                           || ( GetLastError() != ERROR_ENVVAR_NOT_FOUND ) )
+                          ? TRUE : FALSE;
+        if( variable->defined != FALSE ) {
+            variable->value        = table->used;
+            variable->value_length = length;
+            table->used           += length + 1;
+        }
+        table->resolved += 1;
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+LPTSTR arg_template_write(          /* expand a compiled string             */
+    const arg_template_type*
+                        table,      /* compiled string table                */
+    DWORD               index,      /* index of compiled string             */
+    LPTSTR              buffer      /* destination, at least the expanded   */
+                                    /* length plus a terminator             */
+) {                                 /* returns the terminator written       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* segment index                        */
+    const arg_segment_type*
+                        segment;    /* current segment                      */
+    const arg_variable_type*
+                        variable;   /* referenced variable                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( table == NULL ) || ( buffer == NULL )
+     || ( index >= table->count ) ) {
+        if( buffer != NULL ) {
+            *buffer = _T( '\0' );
+        }
+        return buffer;
+    }
+
+    /*------------------------------------------------------------------
+    Copy each segment.
+    ------------------------------------------------------------------*/
+    for( i = table->first[ index ]; i < table->first[ index + 1 ]; ++i ) {
+        segment = &( table->segments[ i ] );
+        if( segment->variable == ARG_TEMPLATE_LITERAL ) {
+            memcpy(
+                buffer,
+                &( table->pool[ segment->offset ] ),
+                ( segment->length * sizeof( TCHAR ) )
+            );
+            buffer += segment->length;
+            continue;
+        }
+        variable = &( table->variables[ segment->variable ] );
+        if( variable->defined != FALSE ) {
+            memcpy(
+                buffer,
+                &( table->pool[ variable->value ] ),
+                ( variable->value_length * sizeof( TCHAR ) )
+            );
+            buffer += variable->value_length;
+            continue;
+        }
+        *buffer = _T( '%' );
+        memcpy(
+            ( buffer + 1 ),
+            &( table->pool[ variable->name ] ),
+            ( variable->name_length * sizeof( TCHAR ) )
+        );
+        buffer   += variable->name_length + 1;
+        *buffer   = _T( '%' );
+        buffer   += 1;
+    }
+    *buffer = _T( '\0' );
+    return buffer;
+}
+
+
+/*==========================================================================*/
+error_type add_segment(             /* append a segment to a table          */
+    arg_template_type*  table,      /* compiled string table                */
+    DWORD               variable,   /* variable, or ARG_TEMPLATE_LITERAL    */
+    LPCTSTR             text,       /* literal text                         */
+    DWORD               length      /* literal length (characters)          */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* new number of segments allocated     */
+    DWORD               offset;     /* offset of literal text in the pool   */
+    error_type          result;     /* result of copying the text           */
+
+    /*------------------------------------------------------------------
+    Empty literal text needs no segment.
+    ------------------------------------------------------------------*/
+    if( ( variable == ARG_TEMPLATE_LITERAL ) && ( length == 0 ) ) {
+        return ERR_OK;
+    }
+    offset = 0;
+    if( variable == ARG_TEMPLATE_LITERAL ) {
+        result = append_pool( table, text, length, &offset );
+        if( result != ERR_OK ) {
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Grow the segments by doubling.
+    ------------------------------------------------------------------*/
+    if( table->segment_count == table->segment_capacity ) {
+        capacity = ( table->segment_capacity == 0 )
+                 ? TEMPLATE_MIN_ITEMS : ( 2 * table->segment_capacity );
+        if( resize_block(
+                ( LPVOID* ) &( table->segments ),
+                ( capacity * sizeof( arg_segment_type ) )
+            ) == FALSE ) {
+            return ERR_ALLOC;
+        }
+        table->segment_capacity = capacity;
+    }
+    table->segments[ table->segment_count ].variable = variable;
+    table->segments[ table->segment_count ].offset   = offset;
+    table->segments[ table->segment_count ].length   = length;
+    table->segment_count += 1;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type append_pool(             /* copy text into a table's pool        */
+    arg_template_type*  table,      /* compiled string table                */
+    LPCTSTR             text,       /* text to copy                         */
+    DWORD               length,     /* length of text (characters)          */
+    DWORD*              offset      /* returned offset of the copy          */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               size;       /* new pool size (characters)           */
+
+    /*------------------------------------------------------------------
+    Grow the pool by doubling.  Each copy is terminated, so names can
+    be passed to the system as they are.
+    ------------------------------------------------------------------*/
+    if( ( table->used + length + 1 ) > table->size ) {
+        size = ( table->size == 0 ) ? TEMPLATE_MIN_POOL : table->size;
+        while( size < ( table->used + length + 1 ) ) {
+            size *= 2;
+        }
+        if( resize_block(
+                ( LPVOID* ) &( table->pool ),
+                ( size * sizeof( TCHAR ) )
+            ) == FALSE ) {
+            return ERR_ALLOC;
+        }
+        table->size = size;
+    }
+    memcpy(
+        &( table->pool[ table->used ] ),
+        text,
+        ( length * sizeof( TCHAR ) )
+    );
+    table->pool[ table->used + length ] = _T( '\0' );
+    *offset      = table->used;
+    table->used += length + 1;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type find_variable(           /* find or add a referenced variable    */
+    arg_template_type*  table,      /* compiled string table                */
+    LPCTSTR             name,       /* variable name (not terminated)       */
+    DWORD               length,     /* length of name (characters)          */
+    DWORD*              index       /* returned variable index              */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bucket;     /* hash table slot                      */
+    DWORD               capacity;   /* new number of variables allocated    */
+    DWORD               hash;       /* hash of the name                     */
+    DWORD               offset;     /* offset of the name in the pool       */
+    error_type          result;     /* result of internal operation         */
+    arg_variable_type*  variable;   /* variable being checked or added      */
+
+    /*------------------------------------------------------------------
+    Keep the hash table at most half full.
+    ------------------------------------------------------------------*/
+    if( ( 2 * ( table->variable_count + 1 ) ) > table->bucket_count ) {
+        result = rehash_variables(
+            table,
+            ( ( table->bucket_count == 0 )
+              ? TEMPLATE_MIN_ITEMS : ( 2 * table->bucket_count ) )
+        );
+        if( result != ERR_OK ) {
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Variable names are not case sensitive.
+    ------------------------------------------------------------------*/
+    hash   = hash_name( name, length );
+    bucket = hash & ( table->bucket_count - 1 );
+    while( table->buckets[ bucket ] != ARG_TEMPLATE_LITERAL ) {
+        variable = &( table->variables[ table->buckets[ bucket ] ] );
+        if( ( variable->hash == hash ) && ( variable->name_length == length )
+         && ( _tcsnicmp( &( table->pool[ variable->name ] ), name, length )
+              == 0 ) ) {
+            *index = table->buckets[ bucket ];
+            return ERR_OK;
+        }
+        bucket = ( bucket + 1 ) & ( table->bucket_count - 1 );
+    }
+
+    /*------------------------------------------------------------------
+    Add a variable that was not referenced before.  It is looked up at
+    the next resolve.
+    ------------------------------------------------------------------*/
+    if( table->variable_count == table->variable_capacity ) {
+        capacity = ( table->variable_capacity == 0 )
+                 ? TEMPLATE_MIN_ITEMS : ( 2 * table->variable_capacity );
+        if( resize_block(
+                ( LPVOID* ) &( table->variables ),
+                ( capacity * sizeof( arg_variable_type ) )
+            ) == FALSE ) {
+            return ERR_ALLOC;
+        }
+        table->variable_capacity = capacity;
+    }
+    result = append_pool( table, name, length, &offset );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    variable = &( table->variables[ table->variable_count ] );
+    memset( variable, 0, sizeof( arg_variable_type ) );
+    variable->name           = offset;
+    variable->name_length    = length;
+    variable->hash           = hash;
+    table->buckets[ bucket ] = table->variable_count;
+    *index                   = table->variable_count;
+    table->variable_count   += 1;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD hash_name(                    /* hash a variable name                 */
+    LPCTSTR             name,       /* variable name                        */
+    DWORD               length      /* length of name (characters)          */
+) {                                 /* returns FNV-1a hash (case folded)    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               hash;       /* running hash                         */
+    DWORD               i;          /* character index                      */
+
+    /*------------------------------------------------------------------
+    Hash each character in upper case.
+    ------------------------------------------------------------------*/
+    hash = TEMPLATE_FNV_BASIS;
+    for( i = 0; i < length; ++i ) {
+        hash ^= ( DWORD ) ( _TUCHAR ) _totupper( name[ i ] );
+        hash *= TEMPLATE_FNV_PRIME;
+    }
+    return hash;
+}
+
+
+/*==========================================================================*/
+error_type rehash_variables(        /* resize a table's variable hash       */
+    arg_template_type*  table,      /* compiled string table                */
+    DWORD               bucket_count/* new number of buckets (power of 2)   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bucket;     /* hash table slot                      */
+    DWORD               i;          /* variable index                       */
+
+    /*------------------------------------------------------------------
+    Resize the table, then put every variable back in it.
+    ------------------------------------------------------------------*/
+    if( resize_block(
+            ( LPVOID* ) &( table->buckets ),
+            ( bucket_count * sizeof( DWORD ) )
+        ) == FALSE ) {
+        return ERR_ALLOC;
+    }
+    table->bucket_count = bucket_count;
+    memset( table->buckets, 0xFF, ( bucket_count * sizeof( DWORD ) ) );
+    for( i = 0; i < table->variable_count; ++i ) {
+        bucket = table->variables[ i ].hash & ( bucket_count - 1 );
+        while( table->buckets[ bucket ] != ARG_TEMPLATE_LITERAL ) {
+            bucket = ( bucket + 1 ) & ( bucket_count - 1 );
+        }
+        table->buckets[ bucket ] = i;
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL resize_block(                  /* resize one of a table's arrays       */
+    LPVOID*             block,      /* array to resize (may be NULL)        */
+    SIZE_T              size        /* new size (bytes)                     */
+) {                                 /* returns FALSE if out of memory       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPVOID              resized;    /* reallocated array                    */
+
+    /*------------------------------------------------------------------
+    The old array stays valid when it can not be resized.
+    ------------------------------------------------------------------*/
+    resized = ( *block == NULL )
+        ? HeapAlloc( GetProcessHeap(), 0, size )
+        : HeapReAlloc( GetProcessHeap(), 0, *block, size );
+    if( resized == NULL ) {
+        return FALSE;
+    }
+    *block = resized;
+    return TRUE;
+}
+
@@ -0,0 +1,1277 @@
+/*****************************************************************************
+
+config_file.c
+
+Session Configuration File
+
+This module maps the JSON configuration file into memory and indexes it in a
+single streaming pass.  Each entry under "sessions" is recorded as a pair of
+byte spans (its name and its list of windows) without decoding anything, and
+only the sessions that are asked for are decoded.  Indexing skips session
+bodies by bracket depth alone, so it costs little more than reading the
+file, and looking up and decoding one session does not depend on how many
+other sessions the file holds.
+
+A session is either a list of windows, or an object holding that list as
+"windows", and the monitors its rectangles were captured on as "monitors"
+(see monitor_layout.c).
+
+When a compiled index is current for the file, it is mapped instead and
+lookups and loads are passed on to it.
+
+A resident restore reads the file into its own memory instead (see
+config_watch.c), so the file is never held open and can be saved while the
+configuration is in use.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "config_index.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define CONFIG_MIN_ENTRIES  ( 64 )  /* initial size of the session index    */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct config_writer_s {    /* session string writer type           */
+    LPCSTR              text;       /* mapped UTF-8 text of the file        */
+    LPWSTR              scratch;    /* UTF-16 decoding buffer               */
+    LPTSTR              next;       /* next free character in the block     */
+    LPTSTR              end;        /* end of the block's string storage    */
+} config_writer_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type index_file(              /* note each known top-level section    */
+    config_file_type*   config      /* configuration file object            */
+);                                  /* returns error code                   */
+
+error_type index_sessions(          /* record the span of every session     */
+    config_file_type*   config,     /* configuration file object            */
+    json_cursor_type*   cursor      /* position of the "sessions" object    */
+);                                  /* returns error code                   */
+
+error_type compile_session(         /* compile a session's commands and     */
+                                    /* arguments                            */
+    config_file_type*   config,     /* configuration file object            */
+    config_session_type**
+                        session     /* decoded session (released if it can  */
+                                    /* not be compiled)                     */
+);                                  /* returns error code                   */
+
+DWORD count_items(                  /* count a container's items            */
+    config_file_type*   config,     /* configuration file object            */
+    json_span_type*     span        /* raw container, or an empty span      */
+);                                  /* returns number of items, or          */
+                                    /* CONFIG_NONE if it is malformed       */
+
+error_type load_monitor(            /* decode one monitor object            */
+    LPCSTR              text,       /* UTF-8 text of the file               */
+    json_cursor_type*   cursor,     /* position of the monitor object       */
+    config_monitor_type*
+                        monitor     /* monitor to fill                      */
+);                                  /* returns error code                   */
+
+error_type load_rectangle(          /* decode a rectangle's four values     */
+    json_cursor_type*   cursor,     /* position of the rectangle array      */
+    RECT*               rectangle   /* rectangle to fill                    */
+);                                  /* returns error code                   */
+
+error_type load_window(             /* decode one window object             */
+    config_writer_type* writer,     /* session string writer                */
+    json_cursor_type*   cursor,     /* position of the window object        */
+    config_window_type* window      /* window to fill                       */
+);                                  /* returns error code                   */
+
+BOOL match_key(                     /* compare a raw key to a plain name    */
+    LPCSTR              text,       /* UTF-8 text holding the key           */
+    json_span_type*     key,        /* raw key                              */
+    LPCSTR              name        /* ASCII name                           */
+);                                  /* returns TRUE if they are equal       */
+
+error_type split_session(           /* find a session's windows and         */
+                                    /* monitors                             */
+    config_file_type*   config,     /* configuration file object            */
+    config_entry_type*  entry,      /* session's index entry                */
+    json_span_type*     windows,    /* returned raw list of windows         */
+    json_span_type*     monitors    /* returned raw list of monitors, or an */
+                                    /* empty span                           */
+);                                  /* returns error code                   */
+
+LPTSTR store_string(                /* decode a string into the block       */
+    config_writer_type* writer,     /* session string writer                */
+    json_span_type*     span,       /* raw string contents                  */
+    BOOL                list        /* add a second NUL (list terminator)   */
+);                                  /* returns stored string                */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+void config_close(                  /* unmap a configuration file           */
+    config_file_type*   config      /* configuration file object            */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( config == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release the session index, and the compiled arguments.
+    ------------------------------------------------------------------*/
+    if( config->entries != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) config->entries );
+    }
+    arg_template_free( &( config->templates ) );
+
+    /*------------------------------------------------------------------
+    Unmap (or release the copy of) and close the file.
+    ------------------------------------------------------------------*/
+    if( ( config->text != NULL ) && ( config->mapping != NULL ) ) {
+        UnmapViewOfFile( ( LPCVOID ) config->text );
+    }
+    else if( config->text != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) config->text );
+    }
+    if( config->mapping != NULL ) {
+        CloseHandle( config->mapping );
+    }
+    if( ( config->file != NULL )
+     && ( config->file != INVALID_HANDLE_VALUE ) ) {
+        CloseHandle( config->file );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the configuration object.
+    ------------------------------------------------------------------*/
+    memset( config, 0, sizeof( config_file_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type config_default_path(     /* get the user's configuration path    */
+    LPTSTR              path,       /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               length;     /* length of profile directory          */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( path == NULL ) || ( size == 0 ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Get the user's profile directory.
+    ------------------------------------------------------------------*/
+    length = GetEnvironmentVariable( _T( "USERPROFILE" ), path, size );
+    if( length == 0 ) {
+        return ERR_WINAPI;
+    }
+    if( ( length + 1 + _tcslen( CONFIG_FILE_NAME ) ) >= size ) {
+        return ERR_OVERFLOW;
+    }
+
+    /*------------------------------------------------------------------
+    Append the configuration file name.
+    ------------------------------------------------------------------*/
+    path[ length ] = _T( '\\' );
+    _tcscpy( ( path + length + 1 ), CONFIG_FILE_NAME );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD config_find(                  /* find a session by name               */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             name        /* session name                         */
+) {                                 /* returns index, or CONFIG_NONE        */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_entry_type*  entry;      /* entry being compared                 */
+    DWORD               i;          /* entry index                          */
+    WCHAR               key[ CONFIG_NAME_LIMIT * 6 ];
+                                    /* decoded key with escapes             */
+    DWORD               key_length; /* length of decoded key                */
+    CHAR                utf8[ CONFIG_NAME_LIMIT * 3 ];
+                                    /* name as UTF-8                        */
+    int                 utf8_length;/* length of UTF-8 name (bytes)         */
+    #ifdef UNICODE
+    LPCWSTR             wide;       /* name as UTF-16                       */
+    #else
+    WCHAR               wide[ CONFIG_NAME_LIMIT ];
+                                    /* name as UTF-16                       */
+    #endif
+    int                 wide_length;/* length of UTF-16 name                */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( name == NULL ) ) {
+        return CONFIG_NONE;
+    }
+    if( config->index != NULL ) {
+        return config_index_find( config, name );
+    }
+
+    /*------------------------------------------------------------------
+    Convert the name once to the encodings used for comparison.
+    ------------------------------------------------------------------*/
+    #ifdef UNICODE
+        wide        = name;
+        wide_length = lstrlenW( name );
+    #else
+        wide_length = MultiByteToWideChar(
+            CP_ACP,
+            0,
+            name,
+            -1,
+            wide,
+            CONFIG_NAME_LIMIT
+        ) - 1;
+    #endif
+    if( ( wide_length <= 0 ) || ( wide_length >= CONFIG_NAME_LIMIT ) ) {
+        return CONFIG_NONE;
+    }
+    utf8_length = WideCharToMultiByte(
+        CP_UTF8,
+        0,
+        wide,
+        wide_length,
+        utf8,
+        sizeof( utf8 ),
+        NULL,
+        NULL
+    );
+    if( utf8_length <= 0 ) {
+        return CONFIG_NONE;
+    }
+
+    /*------------------------------------------------------------------
+    Plain keys compare byte for byte with the UTF-8 name.  Only keys
+    with escape sequences need to be decoded.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < config->count; ++i ) {
+        entry = &( config->entries[ i ] );
+        if( entry->escaped == FALSE ) {
+            if( ( entry->name.length == ( DWORD ) utf8_length )
+             && ( memcmp( ( config->text + entry->name.offset ), utf8,
+                          utf8_length ) == 0 ) ) {
+                return i;
+            }
+        }
+        else if( entry->name.length <= ( CONFIG_NAME_LIMIT * 6 ) ) {
+            key_length = json_decode( config->text, &( entry->name ), key );
+            if( ( key_length == ( DWORD ) wide_length )
+             && ( memcmp( key, wide, ( key_length * sizeof( WCHAR ) ) )
+                  == 0 ) ) {
+                return i;
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    There is no session by that name.
+    ------------------------------------------------------------------*/
+    return CONFIG_NONE;
+}
+
+
+/*==========================================================================*/
+void config_free_session(           /* release a decoded session            */
+    config_session_type*
+                        session     /* session from config_load             */
+) {
+
+    /*------------------------------------------------------------------
+    The whole session is a single heap allocation.
+    ------------------------------------------------------------------*/
+    if( session != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) session );
+    }
+
+}
+
+
+/*==========================================================================*/
+error_type config_load(             /* decode one session                   */
+    config_file_type*   config,     /* configuration file object            */
+    DWORD               index,      /* index of session                     */
+    config_session_type**
+                        session     /* returned session (one allocation)    */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of windows                    */
+    json_cursor_type    cursor;     /* position in the session's windows    */
+    config_entry_type*  entry;      /* session's index entry                */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* window or monitor index              */
+    DWORD               monitor_count;
+                                    /* number of captured monitors          */
+    config_monitor_type*
+                        monitors;   /* decoded monitors                     */
+    json_span_type      monitor_span;
+                                    /* raw list of monitors                 */
+    error_type          result;     /* result of internal operation         */
+    SIZE_T              size;       /* size of session's fixed part         */
+    SIZE_T              strings;    /* size of string storage (characters)  */
+    json_span_type      window_span;/* raw list of windows                  */
+    config_writer_type  writer;     /* session string writer                */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( session == NULL )
+     || ( index >= config->count ) ) {
+        return ERR_USAGE;
+    }
+    if( config->index != NULL ) {
+        result = config_index_load( config, index, session );
+        return ( result == ERR_OK )
+             ? compile_session( config, session ) : result;
+    }
+    *session = NULL;
+    entry    = &( config->entries[ index ] );
+    heap     = GetProcessHeap();
+
+    /*------------------------------------------------------------------
+    Count the windows and monitors without decoding them.
+    ------------------------------------------------------------------*/
+    result = split_session( config, entry, &window_span, &monitor_span );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    count         = count_items( config, &window_span );
+    monitor_count = count_items( config, &monitor_span );
+    if( ( count == CONFIG_NONE ) || ( monitor_count == CONFIG_NONE ) ) {
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Decoded text is never longer than its raw form, and every string's
+    terminators fit in the quotes and brackets around it, so the raw
+    size bounds the string storage.  The monitors follow the windows.
+    ------------------------------------------------------------------*/
+    size    = sizeof( config_session_type )
+            + ( count * sizeof( config_window_type ) )
+            + ( monitor_count * sizeof( config_monitor_type ) );
+    size    = ( size + sizeof( TCHAR ) - 1 ) & ~( sizeof( TCHAR ) - 1 );
+    strings = entry->name.length + entry->value.length + 1;
+    *session = ( config_session_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( size + ( strings * sizeof( TCHAR ) ) )
+    );
+    if( *session == NULL ) {
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Every string is decoded to UTF-16 first.  No single string is
+    longer than the session's raw text.
+    ------------------------------------------------------------------*/
+    writer.scratch = ( LPWSTR ) HeapAlloc(
+        heap,
+        0,
+        ( ( entry->name.length + entry->value.length + 1 )
+          * sizeof( WCHAR ) )
+    );
+    if( writer.scratch == NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) *session );
+        *session = NULL;
+        return ERR_ALLOC;
+    }
+    writer.text = config->text;
+    writer.next = ( LPTSTR ) ( ( LPBYTE ) *session + size );
+    writer.end  = writer.next + strings;
+
+    /*------------------------------------------------------------------
+    Decode the session's name and windows.
+    ------------------------------------------------------------------*/
+    ( *session )->name  = store_string( &writer, &( entry->name ), FALSE );
+    ( *session )->count = count;
+    json_init( &cursor, config->text, config->size );
+    cursor.offset = window_span.offset;
+    json_enter( &cursor );
+    result = ERR_OK;
+    for( i = 0; ( i < count ) && ( json_next( &cursor ) ); ++i ) {
+        result = load_window(
+            &writer,
+            &cursor,
+            &( ( *session )->windows[ i ] )
+        );
+        if( result != ERR_OK ) {
+            break;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Decode the monitors the session was captured on.
+    ------------------------------------------------------------------*/
+    if( ( result == ERR_OK ) && ( monitor_count > 0 ) ) {
+        monitors = ( config_monitor_type* )
+                   &( ( *session )->windows[ count ] );
+        ( *session )->monitors      = monitors;
+        ( *session )->monitor_count = monitor_count;
+        json_init( &cursor, config->text, config->size );
+        cursor.offset = monitor_span.offset;
+        json_enter( &cursor );
+        for( i = 0; ( i < monitor_count ) && json_next( &cursor ); ++i ) {
+            result = load_monitor( config->text, &cursor, &( monitors[ i ] ) );
+            if( result != ERR_OK ) {
+                break;
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the decoding buffer.
+    ------------------------------------------------------------------*/
+    HeapFree( heap, 0, ( LPVOID ) writer.scratch );
+    if( result != ERR_OK ) {
+        HeapFree( heap, 0, ( LPVOID ) *session );
+        *session = NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Compile the session's commands and arguments.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        result = compile_session( config, session );
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type config_name(             /* decode a session's name              */
+    config_file_type*   config,     /* configuration opened from its source */
+    DWORD               index,      /* index of session                     */
+    LPTSTR              name,       /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_entry_type*  entry;      /* session's index entry                */
+    int                 length;     /* length of decoded name               */
+    WCHAR               wide[ CONFIG_NAME_LIMIT * 6 ];
+                                    /* name as UTF-16                       */
+
+    /*------------------------------------------------------------------
+    Check interface usage.  A compiled index has no raw names.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( name == NULL ) || ( size == 0 )
+     || ( config->index != NULL ) || ( index >= config->count ) ) {
+        return ERR_USAGE;
+    }
+    entry = &( config->entries[ index ] );
+
+    /*------------------------------------------------------------------
+    Names that config_find could never match are too long here too.
+    ------------------------------------------------------------------*/
+    if( entry->name.length > ( CONFIG_NAME_LIMIT * 6 ) ) {
+        return ERR_OVERFLOW;
+    }
+    length = json_decode( config->text, &( entry->name ), wide );
+
+    /*------------------------------------------------------------------
+    Copy or convert the name into the destination.
+    ------------------------------------------------------------------*/
+    #ifdef UNICODE
+        if( ( DWORD ) length >= size ) {
+            return ERR_OVERFLOW;
+        }
+        memcpy( name, wide, ( length * sizeof( WCHAR ) ) );
+    #else
+        if( length > 0 ) {
+            length = WideCharToMultiByte(
+                CP_ACP,
+                0,
+                wide,
+                length,
+                name,
+                ( size - 1 ),
+                NULL,
+                NULL
+            );
+            if( length == 0 ) {
+                return ERR_OVERFLOW;
+            }
+        }
+    #endif
+    name[ length ] = _T( '\0' );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type config_open(             /* map and index a configuration file   */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path        /* path to configuration file           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              file;       /* configuration file handle            */
+    error_type          result;     /* result of internal operation         */
+    DWORD               size;       /* size of the file (bytes)             */
+    DWORD               size_high;  /* upper part of the file size          */
+    FILETIME            write_time; /* last write of the file               */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( path == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Open the file.
+    ------------------------------------------------------------------*/
+    file = CreateFile(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+    if( file == INVALID_HANDLE_VALUE ) {
+        memset( config, 0, sizeof( config_file_type ) );
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    An empty (or enormous) file can not hold a configuration.
+    ------------------------------------------------------------------*/
+    size = GetFileSize( file, &size_high );
+    if( ( size == 0 ) || ( size == INVALID_FILE_SIZE ) || ( size_high != 0 )
+     || ( GetFileTime( file, NULL, NULL, &write_time ) == FALSE ) ) {
+        CloseHandle( file );
+        memset( config, 0, sizeof( config_file_type ) );
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Use the compiled index if it was built from this version of the
+    file.
+    ------------------------------------------------------------------*/
+    if( config_index_open( config, path, &write_time, size ) == ERR_OK ) {
+        CloseHandle( file );
+        return ERR_OK;
+    }
+    memset( config, 0, sizeof( config_file_type ) );
+    config->file = file;
+    config->size = size;
+
+    /*------------------------------------------------------------------
+    Map the whole file.
+    ------------------------------------------------------------------*/
+    config->mapping = CreateFileMapping(
+        config->file,
+        NULL,
+        PAGE_READONLY,
+        0,
+        0,
+        NULL
+    );
+    if( config->mapping == NULL ) {
+        config_close( config );
+        return ERR_WINAPI;
+    }
+    config->text = ( LPCSTR ) MapViewOfFile(
+        config->mapping,
+        FILE_MAP_READ,
+        0,
+        0,
+        0
+    );
+    if( config->text == NULL ) {
+        config_close( config );
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Index the mapped text.
+    ------------------------------------------------------------------*/
+    result = index_file( config );
+    if( result != ERR_OK ) {
+        config_close( config );
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type config_read(             /* read a configuration into memory     */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path        /* path to configuration file           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              file;       /* configuration file handle            */
+    DWORD               read;       /* number of bytes read                 */
+    error_type          result;     /* result of internal operation         */
+    DWORD               size_high;  /* upper part of the file size          */
+    LPSTR               text;       /* copy of the file's text              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( path == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( config, 0, sizeof( config_file_type ) );
+
+    /*------------------------------------------------------------------
+    Open the file without keeping anyone else from changing, renaming,
+    or replacing it.
+    ------------------------------------------------------------------*/
+    file = CreateFile(
+        path,
+        GENERIC_READ,
+        ( FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE ),
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+    if( file == INVALID_HANDLE_VALUE ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Read the whole file, then let it go.  A file that is still being
+    written may come up short, or not parse, and is read again after
+    its next change.
+    ------------------------------------------------------------------*/
+    config->size = GetFileSize( file, &size_high );
+    if( ( config->size == 0 ) || ( config->size == INVALID_FILE_SIZE )
+     || ( size_high != 0 ) ) {
+        CloseHandle( file );
+        memset( config, 0, sizeof( config_file_type ) );
+        return ERR_FORMAT;
+    }
+    text = ( LPSTR ) HeapAlloc( GetProcessHeap(), 0, config->size );
+    if( text == NULL ) {
+        CloseHandle( file );
+        memset( config, 0, sizeof( config_file_type ) );
+        return ERR_ALLOC;
+    }
+    config->text = text;
+    result = ( ReadFile( file, ( LPVOID ) text, config->size, &read, NULL )
+               == FALSE ) ? ERR_WINAPI
+           : ( read != config->size ) ? ERR_FORMAT
+           : index_file( config );
+    CloseHandle( file );
+    if( result != ERR_OK ) {
+        config_close( config );
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type compile_session(         /* compile a session's commands and     */
+                                    /* arguments                            */
+    config_file_type*   config,     /* configuration file object            */
+    config_session_type**
+                        session     /* decoded session (released if it can  */
+                                    /* not be compiled)                     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             argument;   /* current argument                     */
+    DWORD               i;          /* window index                         */
+    DWORD               j;          /* argument index                       */
+    DWORD               next;       /* index of a compiled string           */
+    error_type          result;     /* result of compiling a string         */
+    config_window_type* window;     /* window being compiled                */
+
+    /*------------------------------------------------------------------
+    Each window's command is compiled, then each of its arguments, so
+    they are numbered in order.  A window without a command gets an
+    empty one.
+    ------------------------------------------------------------------*/
+    result = ERR_OK;
+    for( i = 0; ( result == ERR_OK ) && ( i < ( *session )->count ); ++i ) {
+        window = &( ( *session )->windows[ i ] );
+        result = arg_template_add(
+            &( config->templates ),
+            ( ( window->command != NULL ) ? window->command : _T( "" ) ),
+            &( window->template )
+        );
+        argument = window->arguments;
+        for( j = 0; ( result == ERR_OK ) && ( j < window->argument_count );
+             ++j ) {
+            result    = arg_template_add(
+                &( config->templates ),
+                argument,
+                &next
+            );
+            argument += _tcslen( argument ) + 1;
+        }
+        window->templates = &( config->templates );
+    }
+
+    /*------------------------------------------------------------------
+    Look up the variables this session added.  Variables that earlier
+    sessions referred to are not looked up again.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        result = arg_template_resolve( &( config->templates ) );
+    }
+    if( result != ERR_OK ) {
+        config_free_session( *session );
+        *session = NULL;
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+DWORD count_items(                  /* count a container's items            */
+    config_file_type*   config,     /* configuration file object            */
+    json_span_type*     span        /* raw container, or an empty span      */
+) {                                 /* returns number of items, or          */
+                                    /* CONFIG_NONE if it is malformed       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of items                      */
+    json_cursor_type    cursor;     /* position in the container            */
+
+    /*------------------------------------------------------------------
+    An empty span is a missing (optional) container.
+    ------------------------------------------------------------------*/
+    if( span->length == 0 ) {
+        return 0;
+    }
+
+    /*------------------------------------------------------------------
+    Skip each item without decoding it.
+    ------------------------------------------------------------------*/
+    json_init( &cursor, config->text, config->size );
+    cursor.offset = span->offset;
+    if( json_peek( &cursor ) != JSON_ARRAY ) {
+        return CONFIG_NONE;
+    }
+    json_enter( &cursor );
+    count = 0;
+    while( json_next( &cursor ) ) {
+        if( json_skip( &cursor, NULL ) == FALSE ) {
+            return CONFIG_NONE;
+        }
+        count += 1;
+    }
+    return count;
+}
+
+
+/*==========================================================================*/
+error_type index_file(              /* note each known top-level section    */
+    config_file_type*   config      /* configuration file object            */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    json_cursor_type    cursor;     /* position in the file                 */
+    json_span_type      key;        /* current top-level key                */
+    error_type          result;     /* result of internal operation         */
+
+    /*------------------------------------------------------------------
+    Walk the top-level object, noting each known section.
+    ------------------------------------------------------------------*/
+    json_init( &cursor, config->text, config->size );
+    if( json_enter( &cursor ) == FALSE ) {
+        return ERR_FORMAT;
+    }
+    result = ERR_OK;
+    while( ( result == ERR_OK ) && json_next( &cursor ) ) {
+        if( json_string( &cursor, &key ) == FALSE ) {
+            result = ERR_FORMAT;
+        }
+        else if( match_key( config->text, &key, "sessions" ) != FALSE ) {
+            result = index_sessions( config, &cursor );
+        }
+        else if( match_key( config->text, &key, "config" ) != FALSE ) {
+            if( json_skip( &cursor, &( config->config ) ) == FALSE ) {
+                result = ERR_FORMAT;
+            }
+        }
+        else if( match_key( config->text, &key, "restore" ) != FALSE ) {
+            if( json_skip( &cursor, &( config->restore ) ) == FALSE ) {
+                result = ERR_FORMAT;
+            }
+        }
+        else if( json_skip( &cursor, NULL ) == FALSE ) {
+            result = ERR_FORMAT;
+        }
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type index_sessions(          /* record the span of every session     */
+    config_file_type*   config,     /* configuration file object            */
+    json_cursor_type*   cursor      /* position of the "sessions" object    */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* number of entries allocated          */
+    config_entry_type*  entry;      /* entry being recorded                 */
+    LPVOID              grown;      /* reallocated index                    */
+    HANDLE              heap;       /* current process' heap handle         */
+
+    /*------------------------------------------------------------------
+    The sessions section must be an object.
+    ------------------------------------------------------------------*/
+    if( json_peek( cursor ) != JSON_OBJECT ) {
+        return ERR_FORMAT;
+    }
+    json_enter( cursor );
+
+    /*------------------------------------------------------------------
+    Record each session's name and body without decoding either.  The
+    index grows geometrically, so large files need few allocations.
+    ------------------------------------------------------------------*/
+    heap     = GetProcessHeap();
+    capacity = 0;
+    while( json_next( cursor ) ) {
+        if( config->count == capacity ) {
+            capacity = ( capacity == 0 ) ? CONFIG_MIN_ENTRIES : capacity * 2;
+            if( config->entries == NULL ) {
+                grown = HeapAlloc(
+                    heap,
+                    0,
+                    ( capacity * sizeof( config_entry_type ) )
+                );
+            }
+            else {
+                grown = HeapReAlloc(
+                    heap,
+                    0,
+                    ( LPVOID ) config->entries,
+                    ( capacity * sizeof( config_entry_type ) )
+                );
+            }
+            if( grown == NULL ) {
+                return ERR_ALLOC;
+            }
+            config->entries = ( config_entry_type* ) grown;
+        }
+        entry = &( config->entries[ config->count ] );
+        if( ( json_string( cursor, &( entry->name ) ) == FALSE )
+         || ( json_skip( cursor, &( entry->value ) ) == FALSE ) ) {
+            return ERR_FORMAT;
+        }
+        entry->escaped = ( memchr(
+            ( config->text + entry->name.offset ),
+            '\\',
+            entry->name.length
+        ) != NULL ) ? TRUE : FALSE;
+        config->count += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type load_monitor(            /* decode one monitor object            */
+    LPCSTR              text,       /* UTF-8 text of the file               */
+    json_cursor_type*   cursor,     /* position of the monitor object       */
+    config_monitor_type*
+                        monitor     /* monitor to fill                      */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG                dpi;        /* dots per inch                        */
+    json_span_type      key;        /* current field name                   */
+    error_type          result;     /* result of decoding a rectangle       */
+
+    /*------------------------------------------------------------------
+    Each monitor is an object.
+    ------------------------------------------------------------------*/
+    if( json_enter( cursor ) == FALSE ) {
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Decode the known fields, and skip any others.
+    ------------------------------------------------------------------*/
+    while( json_next( cursor ) ) {
+        if( json_string( cursor, &key ) == FALSE ) {
+            return ERR_FORMAT;
+        }
+        result = ERR_OK;
+        if( match_key( text, &key, "rectangle" ) != FALSE ) {
+            result = load_rectangle( cursor, &( monitor->rectangle ) );
+        }
+        else if( match_key( text, &key, "work" ) != FALSE ) {
+            result = load_rectangle( cursor, &( monitor->work ) );
+        }
+        else if( match_key( text, &key, "dpi" ) != FALSE ) {
+            if( ( json_number( cursor, &dpi ) == FALSE ) || ( dpi < 0 ) ) {
+                return ERR_FORMAT;
+            }
+            monitor->dpi = ( DWORD ) dpi;
+        }
+        else if( json_skip( cursor, NULL ) == FALSE ) {
+            return ERR_FORMAT;
+        }
+        if( result != ERR_OK ) {
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    A monitor captured without its work area is assumed to have no
+    taskbar.
+    ------------------------------------------------------------------*/
+    if( IsRectEmpty( &( monitor->work ) ) != FALSE ) {
+        monitor->work = monitor->rectangle;
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type load_rectangle(          /* decode a rectangle's four values     */
+    json_cursor_type*   cursor,     /* position of the rectangle array      */
+    RECT*               rectangle   /* rectangle to fill                    */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG                corner[ 4 ];/* rectangle values                     */
+    DWORD               i;          /* rectangle value index                */
+
+    /*------------------------------------------------------------------
+    Decode up to four values.  Missing values are zero.
+    ------------------------------------------------------------------*/
+    if( json_enter( cursor ) == FALSE ) {
+        return ERR_FORMAT;
+    }
+    memset( corner, 0, sizeof( corner ) );
+    for( i = 0; json_next( cursor ); ++i ) {
+        if( ( i >= 4 ) || ( json_number( cursor, &corner[ i ] ) == FALSE ) ) {
+            return ERR_FORMAT;
+        }
+    }
+    rectangle->left   = corner[ 0 ];
+    rectangle->top    = corner[ 1 ];
+    rectangle->right  = corner[ 2 ];
+    rectangle->bottom = corner[ 3 ];
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type load_window(             /* decode one window object             */
+    config_writer_type* writer,     /* session string writer                */
+    json_cursor_type*   cursor,     /* position of the window object        */
+    config_window_type* window      /* window to fill                       */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    json_span_type      key;        /* current field name                   */
+    LPTSTR              argument;   /* last stored argument                 */
+    DWORD*              count;      /* count of the list being decoded      */
+    LPTSTR*             list;       /* list being decoded                   */
+    json_span_type      value;      /* current string value                 */
+
+    /*------------------------------------------------------------------
+    Each window is an object.
+    ------------------------------------------------------------------*/
+    if( json_enter( cursor ) == FALSE ) {
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Decode the known fields, and skip any others.
+    ------------------------------------------------------------------*/
+    while( json_next( cursor ) ) {
+        if( json_string( cursor, &key ) == FALSE ) {
+            return ERR_FORMAT;
+        }
+
+        /*--------------------------------------------------------------
+        Decode the window name and command.
+        --------------------------------------------------------------*/
+        if( ( match_key( writer->text, &key, "name" ) != FALSE )
+         || ( match_key( writer->text, &key, "command" ) != FALSE ) ) {
+            if( json_string( cursor, &value ) == FALSE ) {
+                return ERR_FORMAT;
+            }
+            if( writer->text[ key.offset ] == 'n' ) {
+                window->name = store_string( writer, &value, FALSE );
+            }
+            else {
+                window->command = store_string( writer, &value, FALSE );
+            }
+        }
+
+        /*--------------------------------------------------------------
+        Decode the rectangle's four values.
+        --------------------------------------------------------------*/
+        else if( match_key( writer->text, &key, "rectangle" ) != FALSE ) {
+            if( load_rectangle( cursor, &( window->rectangle ) ) != ERR_OK ) {
+                return ERR_FORMAT;
+            }
+        }
+
+        /*--------------------------------------------------------------
+        Decode the arguments, or the names of the windows to start
+        after, into one double-NUL terminated list.
+        --------------------------------------------------------------*/
+        else if( ( match_key( writer->text, &key, "arguments" ) != FALSE )
+              || ( match_key( writer->text, &key, "after" ) != FALSE ) ) {
+            if( writer->text[ key.offset + 1 ] == 'f' ) {
+                list  = &window->after;
+                count = &window->after_count;
+            }
+            else {
+                list  = &window->arguments;
+                count = &window->argument_count;
+            }
+            if( json_enter( cursor ) == FALSE ) {
+                return ERR_FORMAT;
+            }
+            argument = NULL;
+            while( json_next( cursor ) ) {
+                if( json_string( cursor, &value ) == FALSE ) {
+                    return ERR_FORMAT;
+                }
+                if( argument != NULL ) {
+                    writer->next -= 1;
+                }
+                argument = store_string( writer, &value, TRUE );
+                if( *list == NULL ) {
+                    *list = argument;
+                }
+                *count += 1;
+            }
+        }
+
+        /*--------------------------------------------------------------
+        Decode whether later windows wait for this one to appear.
+        --------------------------------------------------------------*/
+        else if( match_key( writer->text, &key, "wait" ) != FALSE ) {
+            if( ( json_peek( cursor ) != JSON_LITERAL )
+             || ( json_skip( cursor, &value ) == FALSE ) ) {
+                return ERR_FORMAT;
+            }
+            window->wait = ( writer->text[ value.offset ] == 't' )
+                         ? TRUE : FALSE;
+        }
+
+        /*--------------------------------------------------------------
+        Skip fields this version does not know.
+        --------------------------------------------------------------*/
+        else if( json_skip( cursor, NULL ) == FALSE ) {
+            return ERR_FORMAT;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL match_key(                     /* compare a raw key to a plain name    */
+    LPCSTR              text,       /* UTF-8 text holding the key           */
+    json_span_type*     key,        /* raw key                              */
+    LPCSTR              name        /* ASCII name                           */
+) {                                 /* returns TRUE if they are equal       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               length;     /* length of name                       */
+
+    /*------------------------------------------------------------------
+    Field names in this format never need escapes.
+    ------------------------------------------------------------------*/
+    length = lstrlenA( name );
+    return ( ( key->length == length )
+          && ( memcmp( ( text + key->offset ), name, length ) == 0 ) )
+           ? TRUE : FALSE;
+}
+
+
+/*==========================================================================*/
+error_type split_session(           /* find a session's windows and         */
+                                    /* monitors                             */
+    config_file_type*   config,     /* configuration file object            */
+    config_entry_type*  entry,      /* session's index entry                */
+    json_span_type*     windows,    /* returned raw list of windows         */
+    json_span_type*     monitors    /* returned raw list of monitors, or an */
+                                    /* empty span                           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    json_cursor_type    cursor;     /* position in the session              */
+    json_span_type      key;        /* current field name                   */
+    json_span_type*     span;       /* where the field's span goes, or NULL */
+
+    /*------------------------------------------------------------------
+    A plain list is the session's windows.
+    ------------------------------------------------------------------*/
+    memset( monitors, 0, sizeof( json_span_type ) );
+    json_init( &cursor, config->text, config->size );
+    cursor.offset = entry->value.offset;
+    if( json_peek( &cursor ) == JSON_ARRAY ) {
+        *windows = entry->value;
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Otherwise, find the lists in the session object, skipping fields
+    this version does not know.
+    ------------------------------------------------------------------*/
+    memset( windows, 0, sizeof( json_span_type ) );
+    if( json_enter( &cursor ) == FALSE ) {
+        return ERR_FORMAT;
+    }
+    while( json_next( &cursor ) ) {
+        if( json_string( &cursor, &key ) == FALSE ) {
+            return ERR_FORMAT;
+        }
+        span = NULL;
+        if( match_key( config->text, &key, "windows" ) != FALSE ) {
+            span = windows;
+        }
+        else if( match_key( config->text, &key, "monitors" ) != FALSE ) {
+            span = monitors;
+        }
+        if( json_skip( &cursor, span ) == FALSE ) {
+            return ERR_FORMAT;
+        }
+    }
+    return ( windows->length == 0 ) ? ERR_FORMAT : ERR_OK;
+}
+
+
+/*==========================================================================*/
+LPTSTR store_string(                /* decode a string into the block       */
+    config_writer_type* writer,     /* session string writer                */
+    json_span_type*     span,       /* raw string contents                  */
+    BOOL                list        /* add a second NUL (list terminator)   */
+) {                                 /* returns stored string                */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               length;     /* decoded length (characters)          */
+    LPTSTR              string;     /* stored string                        */
+
+    /*------------------------------------------------------------------
+    Decode the raw text to UTF-16.
+    ------------------------------------------------------------------*/
+    length = json_decode( writer->text, span, writer->scratch );
+    string = writer->next;
+
+    /*------------------------------------------------------------------
+    Copy or convert the text into the block.
+    ------------------------------------------------------------------*/
+    #ifdef UNICODE
+        memcpy( string, writer->scratch, ( length * sizeof( WCHAR ) ) );
+    #else
+        if( length > 0 ) {
+            length = WideCharToMultiByte(
+                CP_ACP,
+                0,
+                writer->scratch,
+                ( int ) length,
+                string,
+                ( int ) ( writer->end - string ),
+                NULL,
+                NULL
+            );
+        }
+    #endif
+
+    /*------------------------------------------------------------------
+    Terminate the string (and the list, if it is part of one).
+    ------------------------------------------------------------------*/
+    string[ length ] = _T( '\0' );
+    writer->next     = string + length + 1;
+    if( list != FALSE ) {
+        *( writer->next ) = _T( '\0' );
+        writer->next     += 1;
+    }
+    return string;
+}
+
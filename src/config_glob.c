@@ -0,0 +1,781 @@
+/*****************************************************************************
+
+config_glob.c
+
+Session Name Globbing
+
+Session names are kept in one table sorted by name, so every name sharing a
+prefix lies in one contiguous range.  Matching classifies each pattern by
+its shape before doing any per-name work:
+
+- A pattern without wildcards is a binary search for one name.
+- A literal prefix followed only by "*" (including "*" alone) selects a
+  whole range of the table with two binary searches.
+- Any other pattern narrows its candidates to the range of its literal
+  prefix, and is compiled into a combined automaton with the other general
+  patterns.  The automaton runs once per candidate name, advancing the
+  states of every such pattern together as one bit set per character.
+
+Each selected session remembers the first pattern that matched it.  Results
+are grouped by that pattern and sorted by name within it, so overlapping
+patterns never repeat a session and the order never depends on how the
+patterns overlap.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_glob.h"
+#include "config_index.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define GLOB_CHARACTERS     ( 256 ) /* characters with precomputed masks    */
+#define GLOB_WORD_BITS      ( 64 )  /* states in each word of a state set   */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef enum glob_kind_e {          /* automaton state kinds                */
+    GLOB_LITERAL,                   /* match one given character            */
+    GLOB_ANY,                       /* match any one character (?)          */
+    GLOB_STAR,                      /* match any run of characters (*)      */
+    GLOB_ACCEPT                     /* the pattern has matched              */
+} glob_kind_type;
+
+typedef struct glob_state_s {       /* automaton state type                 */
+    glob_kind_type      kind;       /* what the state matches               */
+    TCHAR               character;  /* character of a literal state         */
+    DWORD               pattern;    /* pattern the state belongs to         */
+} glob_state_type;
+
+typedef struct glob_range_s {       /* candidate range of the name table    */
+    DWORD               begin;      /* first candidate                      */
+    DWORD               end;        /* one past the last candidate          */
+    BOOL                general;    /* candidates need the automaton        */
+    DWORD               prefix;     /* length of pattern's literal prefix   */
+    DWORD               state;      /* first automaton state of pattern     */
+} glob_range_type;
+
+typedef struct glob_machine_s {     /* combined automaton type              */
+    glob_state_type*    states;     /* states of every general pattern      */
+    DWORD               state_count;/* number of states                     */
+    DWORD               words;      /* number of words in each state set    */
+    ULONGLONG*          literals;   /* literal states matching each         */
+                                    /* character below GLOB_CHARACTERS      */
+    ULONGLONG*          any;        /* states matching any one character    */
+    ULONGLONG*          stars;      /* states matching runs of characters   */
+    ULONGLONG*          accepts;    /* accepting states                     */
+    ULONGLONG*          starts;     /* first state of each pattern          */
+    ULONGLONG*          current;    /* active states                        */
+    ULONGLONG*          next;       /* states active after this character   */
+    ULONGLONG*          mask;       /* states matching this character       */
+} glob_machine_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+void build_mask(                    /* find the states matching a character */
+    glob_machine_type*  machine,    /* combined automaton                   */
+    TCHAR               character   /* character being matched              */
+);
+
+void close_stars(                   /* activate the states after stars      */
+    glob_machine_type*  machine,    /* combined automaton                   */
+    ULONGLONG*          set         /* state set to update                  */
+);
+
+DWORD find_bound(                   /* binary search for a prefix bound     */
+    config_glob_type*   glob,       /* session name table                   */
+    LPCTSTR             prefix,     /* literal prefix                       */
+    DWORD               length,     /* length of prefix                     */
+    BOOL                upper       /* find the end of the range            */
+);                                  /* returns table position               */
+
+void run_machine(                   /* run the automaton over one name      */
+    glob_machine_type*  machine,    /* combined automaton                   */
+    LPCTSTR             name,       /* name to match                        */
+    DWORD*              best,       /* first pattern matching the name      */
+    BOOL*               matched     /* per-pattern match flags, or NULL     */
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int config_glob_compare(            /* order names (then sessions)          */
+    const void*         left,       /* left-hand name                       */
+    const void*         right       /* right-hand name                      */
+) {                                 /* returns relative order               */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const config_glob_name_type*
+                        left_name;  /* left-hand name                       */
+    int                 order;      /* relative order of the names          */
+    const config_glob_name_type*
+                        right_name; /* right-hand name                      */
+
+    /*------------------------------------------------------------------
+    Names compare by character value, then the earlier session first.
+    ------------------------------------------------------------------*/
+    left_name  = ( const config_glob_name_type* ) left;
+    right_name = ( const config_glob_name_type* ) right;
+    order      = _tcscmp( left_name->name, right_name->name );
+    if( order != 0 ) {
+        return order;
+    }
+    return ( left_name->index > right_name->index )
+         - ( left_name->index < right_name->index );
+}
+
+
+/*==========================================================================*/
+void config_glob_free(              /* release a session name table         */
+    config_glob_type*   glob        /* session name table                   */
+) {
+
+    /*------------------------------------------------------------------
+    The table is a single heap allocation.
+    ------------------------------------------------------------------*/
+    if( ( glob != NULL ) && ( glob->block != NULL ) ) {
+        HeapFree( GetProcessHeap(), 0, glob->block );
+        memset( glob, 0, sizeof( config_glob_type ) );
+    }
+
+}
+
+
+/*==========================================================================*/
+error_type config_glob_init(        /* build a sorted session name table    */
+    config_glob_type*   glob,       /* session name table to initialize     */
+    config_file_type*   config      /* open configuration file              */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of names listed               */
+    DWORD               i;          /* session index                        */
+    DWORD               kept;       /* number of distinct names             */
+    LPTSTR              next;       /* next free character in the table     */
+    error_type          result;     /* result of internal operation         */
+    SIZE_T              size;       /* size of the names list               */
+    SIZE_T              strings;    /* size of name storage (characters)    */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( glob == NULL ) || ( config == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( glob, 0, sizeof( config_glob_type ) );
+
+    /*------------------------------------------------------------------
+    Names decoded from the source need storage.  Decoded names are
+    never longer than their raw form.
+    ------------------------------------------------------------------*/
+    size    = ( config->count + 1 ) * sizeof( config_glob_name_type );
+    strings = 0;
+    if( config->index == NULL ) {
+        for( i = 0; i < config->count; ++i ) {
+            strings += config->entries[ i ].name.length + 1;
+        }
+    }
+    glob->block = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( size + ( strings * sizeof( TCHAR ) ) )
+    );
+    if( glob->block == NULL ) {
+        return ERR_ALLOC;
+    }
+    glob->names = ( config_glob_name_type* ) glob->block;
+
+    /*------------------------------------------------------------------
+    A compiled index already holds its names in order.
+    ------------------------------------------------------------------*/
+    if( config->index != NULL ) {
+        result = config_index_names( config, glob->names, &count );
+        if( result != ERR_OK ) {
+            config_glob_free( glob );
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Otherwise, decode every name and sort them.  Names too long to
+    look up are left out.
+    ------------------------------------------------------------------*/
+    else {
+        next  = ( LPTSTR ) ( ( LPBYTE ) glob->block + size );
+        count = 0;
+        for( i = 0; i < config->count; ++i ) {
+            result = config_name(
+                config,
+                i,
+                next,
+                ( config->entries[ i ].name.length + 1 )
+            );
+            if( result == ERR_OK ) {
+                glob->names[ count ].name  = next;
+                glob->names[ count ].index = i;
+                count += 1;
+                next  += _tcslen( next ) + 1;
+            }
+        }
+        qsort(
+            glob->names,
+            count,
+            sizeof( config_glob_name_type ),
+            config_glob_compare
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Only the first session of a repeated name can be selected, as with
+    config_find.
+    ------------------------------------------------------------------*/
+    kept = 0;
+    for( i = 0; i < count; ++i ) {
+        if( ( kept == 0 ) || ( _tcscmp(
+            glob->names[ i ].name,
+            glob->names[ kept - 1 ].name
+        ) != 0 ) ) {
+            glob->names[ kept ] = glob->names[ i ];
+            kept += 1;
+        }
+    }
+    glob->count = kept;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type config_glob_match(       /* select sessions with glob patterns   */
+    config_glob_type*   glob,       /* session name table                   */
+    LPCTSTR*            patterns,   /* patterns using * and ?               */
+    DWORD               pattern_count,
+                                    /* number of patterns                   */
+    DWORD*              indices,    /* returned session indices (room for   */
+                                    /* glob->count items)                   */
+    DWORD*              count,      /* returned number of sessions          */
+    BOOL*               matched     /* per-pattern match flags, or NULL     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD*              best;       /* first pattern matching each name     */
+    LPVOID              block;      /* working memory                       */
+    DWORD*              firsts;     /* first result of each pattern         */
+    DWORD               high;       /* end of the covered part of the table */
+    DWORD               i;          /* pattern index                        */
+    DWORD               low;        /* start of the covered part            */
+    glob_machine_type   machine;    /* combined automaton                   */
+    LPCTSTR             pattern;    /* pattern being compiled               */
+    DWORD               prefix;     /* length of literal prefix             */
+    DWORD               code;       /* character value of a literal state   */
+    DWORD               r;          /* table position                       */
+    glob_range_type*    ranges;     /* candidate range of each pattern      */
+    DWORD               position;   /* start of the current segment         */
+    LPBYTE              scan;       /* carves up working memory             */
+    DWORD               skip;       /* literal prefix shared by a segment   */
+    DWORD               state;      /* automaton state index                */
+    DWORD               state_total;/* upper bound on automaton states      */
+    DWORD               stop;       /* end of the current segment           */
+    ULONGLONG           state_bit;  /* state's bit in its word              */
+    DWORD               w;          /* word of state's bit                  */
+    LPCTSTR             wild;       /* first wildcard in pattern            */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( glob == NULL ) || ( patterns == NULL ) || ( indices == NULL )
+     || ( count == NULL ) ) {
+        return ERR_USAGE;
+    }
+    *count = 0;
+    if( matched != NULL ) {
+        memset( matched, 0, ( pattern_count * sizeof( BOOL ) ) );
+    }
+    if( ( glob->count == 0 ) || ( pattern_count == 0 ) ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate all working memory at once.  Each pattern needs at most
+    one state per character, plus its accepting state.  The state sets
+    come first, so their words are aligned.
+    ------------------------------------------------------------------*/
+    state_total = 0;
+    for( i = 0; i < pattern_count; ++i ) {
+        state_total += _tcslen( patterns[ i ] ) + 1;
+    }
+    machine.words = ( state_total + GLOB_WORD_BITS - 1 ) / GLOB_WORD_BITS;
+    block = HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( ( ( GLOB_CHARACTERS + 7 ) * machine.words * sizeof( ULONGLONG ) )
+        + ( glob->count * sizeof( DWORD ) )
+        + ( ( pattern_count + 1 ) * sizeof( DWORD ) )
+        + ( pattern_count * sizeof( glob_range_type ) )
+        + ( state_total * sizeof( glob_state_type ) ) )
+    );
+    if( block == NULL ) {
+        return ERR_ALLOC;
+    }
+    machine.literals = ( ULONGLONG* ) block;
+    machine.any      = machine.literals + ( GLOB_CHARACTERS * machine.words );
+    machine.stars    = machine.any + machine.words;
+    machine.accepts  = machine.stars + machine.words;
+    machine.starts   = machine.accepts + machine.words;
+    machine.current  = machine.starts + machine.words;
+    machine.next     = machine.current + machine.words;
+    machine.mask     = machine.next + machine.words;
+    scan             = ( LPBYTE ) ( machine.mask + machine.words );
+    best             = ( DWORD* ) scan;
+    scan            += glob->count * sizeof( DWORD );
+    firsts           = ( DWORD* ) scan;
+    scan            += ( pattern_count + 1 ) * sizeof( DWORD );
+    ranges           = ( glob_range_type* ) scan;
+    scan            += pattern_count * sizeof( glob_range_type );
+    machine.states   = ( glob_state_type* ) scan;
+    machine.state_count = 0;
+
+    /*------------------------------------------------------------------
+    Find each pattern's candidates from its literal prefix.  A plain
+    name has at most one candidate, and a prefix followed only by stars
+    matches its whole range.  Anything else needs the automaton.
+    ------------------------------------------------------------------*/
+    low  = glob->count;
+    high = 0;
+    for( i = 0; i < pattern_count; ++i ) {
+        pattern = patterns[ i ];
+        wild    = _tcspbrk( pattern, _T( "*?" ) );
+        prefix  = ( wild == NULL )
+                ? _tcslen( pattern ) : ( DWORD ) ( wild - pattern );
+        ranges[ i ].begin  = find_bound( glob, pattern, prefix, FALSE );
+        ranges[ i ].prefix = prefix;
+        if( wild == NULL ) {
+            ranges[ i ].end = ranges[ i ].begin;
+            if( ( ranges[ i ].begin < glob->count )
+             && ( _tcscmp( glob->names[ ranges[ i ].begin ].name, pattern )
+                  == 0 ) ) {
+                ranges[ i ].end += 1;
+            }
+            ranges[ i ].general = FALSE;
+        }
+        else {
+            ranges[ i ].end     = find_bound( glob, pattern, prefix, TRUE );
+            ranges[ i ].general = ( _tcsspn( wild, _T( "*" ) )
+                                    != _tcslen( wild ) ) ? TRUE : FALSE;
+        }
+        if( ranges[ i ].begin < ranges[ i ].end ) {
+            low  = min( low, ranges[ i ].begin );
+            high = max( high, ranges[ i ].end );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Only the part of the table some pattern covers is ever touched.
+    ------------------------------------------------------------------*/
+    if( low >= high ) {
+        HeapFree( GetProcessHeap(), 0, block );
+        return ERR_OK;
+    }
+    memset( ( best + low ), 0xFF, ( ( high - low ) * sizeof( DWORD ) ) );
+
+    /*------------------------------------------------------------------
+    Select whole ranges directly, and compile the other patterns into
+    the automaton with runs of stars folded into one state.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < pattern_count; ++i ) {
+        if( ranges[ i ].begin == ranges[ i ].end ) {
+            continue;
+        }
+        if( ranges[ i ].general == FALSE ) {
+            for( r = ranges[ i ].begin; r < ranges[ i ].end; ++r ) {
+                if( i < best[ r ] ) {
+                    best[ r ] = i;
+                }
+            }
+            if( matched != NULL ) {
+                matched[ i ] = TRUE;
+            }
+            continue;
+        }
+        ranges[ i ].state = machine.state_count;
+        for( pattern = patterns[ i ]; *pattern != _T( '\0' ); ++pattern ) {
+            if( *pattern == _T( '*' ) ) {
+                if( ( pattern != patterns[ i ] )
+                 && ( pattern[ -1 ] == _T( '*' ) ) ) {
+                    continue;
+                }
+                machine.states[ machine.state_count ].kind = GLOB_STAR;
+            }
+            else if( *pattern == _T( '?' ) ) {
+                machine.states[ machine.state_count ].kind = GLOB_ANY;
+            }
+            else {
+                machine.states[ machine.state_count ].kind = GLOB_LITERAL;
+            }
+            machine.states[ machine.state_count ].character = *pattern;
+            machine.states[ machine.state_count ].pattern   = i;
+            machine.state_count += 1;
+        }
+        machine.states[ machine.state_count ].kind      = GLOB_ACCEPT;
+        machine.states[ machine.state_count ].character = _T( '\0' );
+        machine.states[ machine.state_count ].pattern   = i;
+        machine.state_count += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Record each state's bit in the masks for what it matches.
+    ------------------------------------------------------------------*/
+    for( state = 0; state < machine.state_count; ++state ) {
+        w         = state / GLOB_WORD_BITS;
+        state_bit = 1ULL << ( state % GLOB_WORD_BITS );
+        switch( machine.states[ state ].kind ) {
+            case GLOB_LITERAL:
+                code = ( DWORD ) ( _TUCHAR ) machine.states[ state ].character;
+                if( code < GLOB_CHARACTERS ) {
+                    machine.literals[ ( code * machine.words ) + w ]
+                        |= state_bit;
+                }
+                break;
+            case GLOB_ANY:
+                machine.any[ w ] |= state_bit;
+                break;
+            case GLOB_STAR:
+                machine.stars[ w ] |= state_bit;
+                break;
+            case GLOB_ACCEPT:
+                machine.accepts[ w ] |= state_bit;
+                break;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Run the automaton once over each name the general patterns cover.
+    The table is swept in segments where the same patterns cover every
+    name.  Those names all start with each covering pattern's literal
+    prefix, so the automaton starts after the shortest of them, with
+    only the covering patterns active.
+    ------------------------------------------------------------------*/
+    position = low;
+    while( position < high ) {
+        stop = high;
+        skip = CONFIG_NONE;
+        for( i = 0; i < pattern_count; ++i ) {
+            if( ( ranges[ i ].general == FALSE )
+             || ( ranges[ i ].end <= position ) ) {
+                continue;
+            }
+            if( ranges[ i ].begin > position ) {
+                stop = min( stop, ranges[ i ].begin );
+                continue;
+            }
+            stop = min( stop, ranges[ i ].end );
+            skip = min( skip, ranges[ i ].prefix );
+        }
+        if( skip != CONFIG_NONE ) {
+            memset(
+                machine.starts,
+                0,
+                ( machine.words * sizeof( ULONGLONG ) )
+            );
+            for( i = 0; i < pattern_count; ++i ) {
+                if( ( ranges[ i ].general != FALSE )
+                 && ( ranges[ i ].begin <= position )
+                 && ( ranges[ i ].end > position ) ) {
+                    state = ranges[ i ].state + skip;
+                    machine.starts[ state / GLOB_WORD_BITS ] |=
+                        1ULL << ( state % GLOB_WORD_BITS );
+                }
+            }
+            for( r = position; r < stop; ++r ) {
+                run_machine(
+                    &machine,
+                    ( glob->names[ r ].name + skip ),
+                    &best[ r ],
+                    matched
+                );
+            }
+        }
+        position = stop;
+    }
+
+    /*------------------------------------------------------------------
+    Group the selected sessions by their first matching pattern.  The
+    table is walked in order, so each group stays sorted by name.
+    ------------------------------------------------------------------*/
+    memset( firsts, 0, ( ( pattern_count + 1 ) * sizeof( DWORD ) ) );
+    for( r = low; r < high; ++r ) {
+        if( best[ r ] != CONFIG_NONE ) {
+            firsts[ best[ r ] + 1 ] += 1;
+        }
+    }
+    for( i = 0; i < pattern_count; ++i ) {
+        firsts[ i + 1 ] += firsts[ i ];
+    }
+    *count = firsts[ pattern_count ];
+    for( r = low; r < high; ++r ) {
+        if( best[ r ] != CONFIG_NONE ) {
+            indices[ firsts[ best[ r ] ] ] = glob->names[ r ].index;
+            firsts[ best[ r ] ] += 1;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the working memory.
+    ------------------------------------------------------------------*/
+    HeapFree( GetProcessHeap(), 0, block );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void build_mask(                    /* find the states matching a character */
+    glob_machine_type*  machine,    /* combined automaton                   */
+    TCHAR               character   /* character being matched              */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               code;       /* character value                      */
+    const ULONGLONG*    literal;    /* literal states for the character     */
+    DWORD               state;      /* automaton state index                */
+    DWORD               w;          /* word index                           */
+
+    /*------------------------------------------------------------------
+    Common characters have their literal states precomputed.
+    ------------------------------------------------------------------*/
+    code = ( DWORD ) ( _TUCHAR ) character;
+    if( code < GLOB_CHARACTERS ) {
+        literal = machine->literals + ( code * machine->words );
+        for( w = 0; w < machine->words; ++w ) {
+            machine->mask[ w ] = machine->any[ w ] | literal[ w ];
+        }
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Other characters are compared with each literal state.
+    ------------------------------------------------------------------*/
+    memcpy(
+        machine->mask,
+        machine->any,
+        ( machine->words * sizeof( ULONGLONG ) )
+    );
+    for( state = 0; state < machine->state_count; ++state ) {
+        if( ( machine->states[ state ].kind == GLOB_LITERAL )
+         && ( machine->states[ state ].character == character ) ) {
+            machine->mask[ state / GLOB_WORD_BITS ] |=
+                1ULL << ( state % GLOB_WORD_BITS );
+        }
+    }
+
+}
+
+
+/*==========================================================================*/
+void close_stars(                   /* activate the states after stars      */
+    glob_machine_type*  machine,    /* combined automaton                   */
+    ULONGLONG*          set         /* state set to update                  */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    ULONGLONG           carry;      /* bit shifted into the next word       */
+    ULONGLONG           active;     /* active star states in this word      */
+    DWORD               w;          /* word index                           */
+
+    /*------------------------------------------------------------------
+    A star may also match nothing, so the state after an active star
+    is active too.  Runs of stars were folded, so one pass is enough.
+    ------------------------------------------------------------------*/
+    carry = 0;
+    for( w = 0; w < machine->words; ++w ) {
+        active   = set[ w ] & machine->stars[ w ];
+        set[ w ] |= ( active << 1 ) | carry;
+        carry    = active >> ( GLOB_WORD_BITS - 1 );
+    }
+
+}
+
+
+/*==========================================================================*/
+DWORD find_bound(                   /* binary search for a prefix bound     */
+    config_glob_type*   glob,       /* session name table                   */
+    LPCTSTR             prefix,     /* literal prefix                       */
+    DWORD               length,     /* length of prefix                     */
+    BOOL                upper       /* find the end of the range            */
+) {                                 /* returns table position               */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               high;       /* end of search range                  */
+    DWORD               low;        /* start of search range                */
+    DWORD               middle;     /* position being tested                */
+    int                 order;      /* order of name relative to prefix     */
+
+    /*------------------------------------------------------------------
+    Names starting with the prefix are contiguous in the table.  Find
+    the first name not before them (or, for the upper bound, the first
+    name after them).
+    ------------------------------------------------------------------*/
+    low  = 0;
+    high = glob->count;
+    while( low < high ) {
+        middle = low + ( ( high - low ) / 2 );
+        order  = _tcsncmp( glob->names[ middle ].name, prefix, length );
+        if( ( order < 0 ) || ( ( upper != FALSE ) && ( order == 0 ) ) ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+/*==========================================================================*/
+void run_machine(                   /* run the automaton over one name      */
+    glob_machine_type*  machine,    /* combined automaton                   */
+    LPCTSTR             name,       /* name to match                        */
+    DWORD*              best,       /* first pattern matching the name      */
+    BOOL*               matched     /* per-pattern match flags, or NULL     */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    ULONGLONG           accepted;   /* accepting states still active        */
+    DWORD               bit;        /* bit index in a word                  */
+    ULONGLONG           carry;      /* bit shifted into the next word       */
+    DWORD               code;       /* character value                      */
+    ULONGLONG           live;       /* any state is still active            */
+    ULONGLONG           matching;   /* states matching the character        */
+    ULONGLONG           single;     /* active states of a one-word set      */
+    glob_state_type*    state;      /* automaton state                      */
+    ULONGLONG           stepped;    /* states consuming the character       */
+    ULONGLONG*          swap;       /* exchanges the state sets             */
+    DWORD               w;          /* word index                           */
+
+    /*------------------------------------------------------------------
+    Most command lines compile to a single word of states, which is
+    stepped without touching memory for the state set.
+    ------------------------------------------------------------------*/
+    if( machine->words == 1 ) {
+        single = machine->starts[ 0 ];
+        single |= ( single & machine->stars[ 0 ] ) << 1;
+        for( ; ( *name != _T( '\0' ) ) && ( single != 0 ); ++name ) {
+            code = ( DWORD ) ( _TUCHAR ) *name;
+            if( code < GLOB_CHARACTERS ) {
+                matching = machine->literals[ code ] | machine->any[ 0 ];
+            }
+            else {
+                build_mask( machine, *name );
+                matching = machine->mask[ 0 ];
+            }
+            single  = ( ( single & matching ) << 1 )
+                    | ( single & machine->stars[ 0 ] );
+            single |= ( single & machine->stars[ 0 ] ) << 1;
+        }
+        if( ( *name != _T( '\0' ) ) || ( single == 0 ) ) {
+            return;
+        }
+        machine->current[ 0 ] = single;
+    }
+
+    /*------------------------------------------------------------------
+    Otherwise, every word of the state set is stepped in turn.
+    ------------------------------------------------------------------*/
+    else {
+        memcpy(
+            machine->current,
+            machine->starts,
+            ( machine->words * sizeof( ULONGLONG ) )
+        );
+        close_stars( machine, machine->current );
+
+        /*--------------------------------------------------------------
+        Advance every active state over each character at once.
+        Stars keep their state, the others move on to the next
+        state.
+        --------------------------------------------------------------*/
+        for( ; *name != _T( '\0' ); ++name ) {
+            build_mask( machine, *name );
+            carry = 0;
+            live  = 0;
+            for( w = 0; w < machine->words; ++w ) {
+                stepped = machine->current[ w ] & machine->mask[ w ];
+                machine->next[ w ] = ( stepped << 1 ) | carry
+                                   | ( machine->current[ w ]
+                                       & machine->stars[ w ] );
+                carry  = stepped >> ( GLOB_WORD_BITS - 1 );
+                live  |= machine->next[ w ];
+            }
+            if( live == 0 ) {
+                return;
+            }
+            close_stars( machine, machine->next );
+            swap             = machine->current;
+            machine->current = machine->next;
+            machine->next    = swap;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The name matches every pattern whose accepting state is active.
+    ------------------------------------------------------------------*/
+    for( w = 0; w < machine->words; ++w ) {
+        accepted = machine->current[ w ] & machine->accepts[ w ];
+        for( bit = 0; accepted != 0; ++bit, accepted >>= 1 ) {
+            if( ( accepted & 1 ) == 0 ) {
+                continue;
+            }
+            state = &( machine->states[ ( w * GLOB_WORD_BITS ) + bit ] );
+            if( state->pattern < *best ) {
+                *best = state->pattern;
+            }
+            if( matched != NULL ) {
+                matched[ state->pattern ] = TRUE;
+            }
+        }
+    }
+
+}
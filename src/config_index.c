@@ -0,0 +1,1185 @@
+/*****************************************************************************
+
+config_index.c
+
+Compiled Session Index
+
+Compiling writes the whole configuration into a binary file that can be
+used where it is mapped.  The file is a header, a table of hash buckets,
+fixed-size session records, the sessions' order by name, fixed-size window
+records, the monitors each session was captured on, one string table shared
+by every record (repeated strings are stored once), and finally the raw
+"config" and "restore" sections of the source file.  Every location in the
+file is a byte offset from its start, and strings are stored as
+NUL-terminated TCHARs.
+
+Opening an index maps it and checks its header against the source file's
+size and last write time.  Finding a session hashes its name into one
+bucket, and loading a session only points its fields into the mapped
+strings and monitors, so nothing is parsed or copied.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_index.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define INDEX_FNV_BASIS     ( 2166136261UL )
+                                    /* FNV-1a offset basis                  */
+#define INDEX_FNV_PRIME     ( 16777619UL )
+                                    /* FNV-1a prime                         */
+
+#define INDEX_MIN_ITEMS     ( 64 )  /* initial size of growing tables       */
+
+#define INDEX_TEMPORARY     _T( ".tmp" )
+                                    /* suffix of the file being written     */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct index_slot_s {       /* string table lookup slot type        */
+    DWORD               hash;       /* hash of the stored string            */
+    DWORD               offset;     /* offset in string table (bytes)       */
+    DWORD               length;     /* stored length (bytes), 0 if unused   */
+} index_slot_type;
+
+typedef struct index_strings_s {    /* string table builder type            */
+    LPBYTE              data;       /* table contents                       */
+    DWORD               size;       /* bytes used                           */
+    DWORD               capacity;   /* bytes allocated                      */
+    index_slot_type*    slots;      /* open-addressed lookup slots          */
+    DWORD               slot_count; /* number of slots (power of 2)         */
+    DWORD               used;       /* number of slots in use               */
+} index_strings_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type add_string(              /* store a string once in the table     */
+    index_strings_type* strings,    /* string table builder                 */
+    LPCTSTR             text,       /* string (or list), or NULL            */
+    BOOL                list,       /* text is a double-NUL terminated list */
+    DWORD*              offset      /* returned offset, or CONFIG_NONE      */
+);                                  /* returns error code                   */
+
+BOOL check_range(                   /* test that a table lies in the file   */
+    const config_index_header_type*
+                        header,     /* mapped index header                  */
+    DWORD               offset,     /* offset of table                      */
+    DWORD               count,      /* number of items in table             */
+    DWORD               unit        /* size of each item (bytes)            */
+);                                  /* returns TRUE if the table is valid   */
+
+BOOL get_string(                    /* resolve a string offset              */
+    const config_index_header_type*
+                        header,     /* mapped index header                  */
+    DWORD               offset,     /* offset of string, or CONFIG_NONE     */
+    LPTSTR*             string      /* returned string, or NULL             */
+);                                  /* returns TRUE if the offset is valid  */
+
+error_type grow_table(              /* make room in a growing table         */
+    LPVOID*             table,      /* table allocation                     */
+    DWORD*              capacity,   /* number of items allocated            */
+    DWORD               needed,     /* number of items needed               */
+    DWORD               unit        /* size of each item (bytes)            */
+);                                  /* returns error code                   */
+
+DWORD hash_bytes(                   /* hash a block of memory               */
+    LPCVOID             data,       /* data to hash                         */
+    DWORD               size        /* size of data (bytes)                 */
+);                                  /* returns FNV-1a hash                  */
+
+error_type write_block(             /* write a block to a file              */
+    HANDLE              file,       /* open file handle                     */
+    LPCVOID             data,       /* data to write                        */
+    DWORD               size        /* size of data (bytes)                 */
+);                                  /* returns error code                   */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type config_index_compile(    /* write the index for a configuration  */
+    config_file_type*   config,     /* configuration opened from its source */
+    LPCTSTR             path        /* path to the source file              */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD*              buckets;    /* first session in each bucket         */
+    HANDLE              file;       /* index file being written             */
+    config_index_header_type
+                        header;     /* index file header                    */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* session index                        */
+    TCHAR               index_path[ MAX_PATH ];
+                                    /* path to the index file               */
+    DWORD               j;          /* window index                         */
+    DWORD               monitor_capacity;
+                                    /* number of monitor records allocated  */
+    config_monitor_type*
+                        monitors;   /* monitor records                      */
+    config_glob_name_type*
+                        names;      /* session names in sorted order        */
+    DWORD*              order;      /* session indices sorted by name       */
+    config_index_session_type*
+                        record;     /* session record being built           */
+    config_index_session_type*
+                        records;    /* session records                      */
+    error_type          result;     /* result of internal operation         */
+    config_session_type*
+                        session;    /* decoded session                      */
+    index_strings_type  strings;    /* string table builder                 */
+    TCHAR               temporary[ MAX_PATH ];
+                                    /* path to the file being written       */
+    config_index_window_type*
+                        window;     /* window record being built            */
+    DWORD               window_capacity;
+                                    /* number of window records allocated   */
+    config_index_window_type*
+                        windows;    /* window records                       */
+
+    /*------------------------------------------------------------------
+    Check interface usage.  The index is compiled from the source file.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( path == NULL ) || ( config->index != NULL ) ) {
+        return ERR_USAGE;
+    }
+    result = config_index_path( path, index_path, MAX_PATH );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    if( ( _tcslen( index_path ) + _tcslen( INDEX_TEMPORARY ) ) >= MAX_PATH ) {
+        return ERR_OVERFLOW;
+    }
+    _tcscpy( temporary, index_path );
+    _tcscat( temporary, INDEX_TEMPORARY );
+
+    /*------------------------------------------------------------------
+    Prepare the header and the record tables.
+    ------------------------------------------------------------------*/
+    memset( &header, 0, sizeof( config_index_header_type ) );
+    memset( &strings, 0, sizeof( index_strings_type ) );
+    header.magic         = CONFIG_INDEX_MAGIC;
+    header.version       = CONFIG_INDEX_VERSION;
+    header.char_size     = sizeof( TCHAR );
+    header.source_size   = config->size;
+    header.session_count = config->count;
+    if( GetFileTime( config->file, NULL, NULL, &header.source_time )
+        == FALSE ) {
+        return ERR_WINAPI;
+    }
+    for( header.bucket_count = 1;
+         header.bucket_count < config->count;
+         header.bucket_count <<= 1 );
+    heap    = GetProcessHeap();
+    buckets = ( DWORD* ) HeapAlloc(
+        heap,
+        0,
+        ( header.bucket_count * sizeof( DWORD ) )
+    );
+    records = ( config_index_session_type* ) HeapAlloc(
+        heap,
+        0,
+        ( ( config->count + 1 ) * sizeof( config_index_session_type ) )
+    );
+    order   = ( DWORD* ) HeapAlloc(
+        heap,
+        0,
+        ( ( config->count + 1 ) * sizeof( DWORD ) )
+    );
+    names   = ( config_glob_name_type* ) HeapAlloc(
+        heap,
+        0,
+        ( ( config->count + 1 ) * sizeof( config_glob_name_type ) )
+    );
+    windows          = NULL;
+    window_capacity  = 0;
+    monitors         = NULL;
+    monitor_capacity = 0;
+    result          = ( ( buckets == NULL ) || ( records == NULL )
+                     || ( order == NULL ) || ( names == NULL ) )
+                    ? ERR_ALLOC : ERR_OK;
+
+    /*------------------------------------------------------------------
+    Decode every session from the source, and record its windows.
+    ------------------------------------------------------------------*/
+    for( i = 0; ( result == ERR_OK ) && ( i < config->count ); ++i ) {
+        result = config_load( config, i, &session );
+        if( result != ERR_OK ) {
+            break;
+        }
+        record        = &( records[ i ] );
+        record->hash  = hash_bytes(
+            session->name,
+            ( _tcslen( session->name ) * sizeof( TCHAR ) )
+        );
+        record->first         = header.window_count;
+        record->count         = session->count;
+        record->monitor_first = header.monitor_count;
+        record->monitor_count = session->monitor_count;
+        result = add_string( &strings, session->name, FALSE, &record->name );
+        if( result == ERR_OK ) {
+            result = grow_table(
+                ( LPVOID* ) &windows,
+                &window_capacity,
+                ( header.window_count + session->count ),
+                sizeof( config_index_window_type )
+            );
+        }
+        if( ( result == ERR_OK ) && ( session->monitor_count > 0 ) ) {
+            result = grow_table(
+                ( LPVOID* ) &monitors,
+                &monitor_capacity,
+                ( header.monitor_count + session->monitor_count ),
+                sizeof( config_monitor_type )
+            );
+            if( result == ERR_OK ) {
+                memcpy(
+                    &( monitors[ header.monitor_count ] ),
+                    session->monitors,
+                    ( session->monitor_count * sizeof( config_monitor_type ) )
+                );
+                header.monitor_count += session->monitor_count;
+            }
+        }
+        for( j = 0; ( result == ERR_OK ) && ( j < session->count ); ++j ) {
+            window = &( windows[ header.window_count + j ] );
+            window->rectangle      = session->windows[ j ].rectangle;
+            window->argument_count = session->windows[ j ].argument_count;
+            window->after_count    = session->windows[ j ].after_count;
+            window->wait           = session->windows[ j ].wait;
+            result = add_string(
+                &strings,
+                session->windows[ j ].name,
+                FALSE,
+                &window->name
+            );
+            if( result == ERR_OK ) {
+                result = add_string(
+                    &strings,
+                    session->windows[ j ].command,
+                    FALSE,
+                    &window->command
+                );
+            }
+            if( result == ERR_OK ) {
+                result = add_string(
+                    &strings,
+                    session->windows[ j ].arguments,
+                    TRUE,
+                    &window->arguments
+                );
+            }
+            if( result == ERR_OK ) {
+                result = add_string(
+                    &strings,
+                    session->windows[ j ].after,
+                    TRUE,
+                    &window->after
+                );
+            }
+        }
+        header.window_count += session->count;
+        config_free_session( session );
+    }
+
+    /*------------------------------------------------------------------
+    Lay out the file.  The string table is padded with at least two
+    NULs, so any string or list in it is terminated inside the table.
+    ------------------------------------------------------------------*/
+    header.buckets     = sizeof( config_index_header_type );
+    header.sessions    = header.buckets
+                       + ( header.bucket_count * sizeof( DWORD ) );
+    header.order       = header.sessions
+                       + ( header.session_count
+                           * sizeof( config_index_session_type ) );
+    header.windows     = header.order
+                       + ( header.session_count * sizeof( DWORD ) );
+    header.monitors    = header.windows
+                       + ( header.window_count
+                           * sizeof( config_index_window_type ) );
+    header.strings     = header.monitors
+                       + ( header.monitor_count
+                           * sizeof( config_monitor_type ) );
+    header.string_size = ( strings.size + ( 2 * sizeof( TCHAR ) ) + 3 )
+                       & ~3UL;
+    header.config.offset  = header.strings + header.string_size;
+    header.config.length  = config->config.length;
+    header.restore.offset = header.config.offset + header.config.length;
+    header.restore.length = config->restore.length;
+    header.size           = header.restore.offset + header.restore.length;
+    if( result == ERR_OK ) {
+        result = grow_table(
+            ( LPVOID* ) &strings.data,
+            &strings.capacity,
+            header.string_size,
+            1
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Sort the session names once here, so listing them in order needs
+    no sorting when the index is used.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        for( i = 0; i < config->count; ++i ) {
+            names[ i ].name  = ( LPCTSTR )
+                               ( strings.data + records[ i ].name );
+            names[ i ].index = i;
+        }
+        qsort(
+            names,
+            config->count,
+            sizeof( config_glob_name_type ),
+            config_glob_compare
+        );
+        for( i = 0; i < config->count; ++i ) {
+            order[ i ] = names[ i ].index;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Relocate the string offsets, and chain the sessions into buckets.
+    Chains are built from the end so the first of several sessions with
+    the same name is found first, as it is in the source.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        memset(
+            ( strings.data + strings.size ),
+            0,
+            ( header.string_size - strings.size )
+        );
+        for( j = 0; j < header.window_count; ++j ) {
+            window = &( windows[ j ] );
+            if( window->name != CONFIG_NONE ) {
+                window->name += header.strings;
+            }
+            if( window->command != CONFIG_NONE ) {
+                window->command += header.strings;
+            }
+            if( window->arguments != CONFIG_NONE ) {
+                window->arguments += header.strings;
+            }
+            if( window->after != CONFIG_NONE ) {
+                window->after += header.strings;
+            }
+        }
+        memset( buckets, 0xFF, ( header.bucket_count * sizeof( DWORD ) ) );
+        for( i = config->count; i > 0; --i ) {
+            record        = &( records[ i - 1 ] );
+            record->name += header.strings;
+            record->next  = buckets[
+                record->hash & ( header.bucket_count - 1 )
+            ];
+            buckets[ record->hash & ( header.bucket_count - 1 ) ] = i - 1;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Write a temporary file, and replace the index only once it is
+    complete, so a reader never maps a partial index.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        file = CreateFile(
+            temporary,
+            GENERIC_WRITE,
+            0,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL
+        );
+        if( file == INVALID_HANDLE_VALUE ) {
+            result = ERR_WINAPI;
+        }
+        else {
+            result = write_block( file, &header, sizeof( header ) );
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    buckets,
+                    ( header.bucket_count * sizeof( DWORD ) )
+                );
+            }
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    records,
+                    ( header.session_count
+                      * sizeof( config_index_session_type ) )
+                );
+            }
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    order,
+                    ( header.session_count * sizeof( DWORD ) )
+                );
+            }
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    windows,
+                    ( header.window_count
+                      * sizeof( config_index_window_type ) )
+                );
+            }
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    monitors,
+                    ( header.monitor_count * sizeof( config_monitor_type ) )
+                );
+            }
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    strings.data,
+                    header.string_size
+                );
+            }
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    ( config->text + config->config.offset ),
+                    config->config.length
+                );
+            }
+            if( result == ERR_OK ) {
+                result = write_block(
+                    file,
+                    ( config->text + config->restore.offset ),
+                    config->restore.length
+                );
+            }
+            CloseHandle( file );
+            if( ( result == ERR_OK ) && ( MoveFileEx(
+                temporary,
+                index_path,
+                MOVEFILE_REPLACE_EXISTING
+            ) == FALSE ) ) {
+                result = ERR_WINAPI;
+            }
+            if( result != ERR_OK ) {
+                DeleteFile( temporary );
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the tables.
+    ------------------------------------------------------------------*/
+    if( strings.slots != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) strings.slots );
+    }
+    if( strings.data != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) strings.data );
+    }
+    if( monitors != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) monitors );
+    }
+    if( windows != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) windows );
+    }
+    if( names != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) names );
+    }
+    if( order != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) order );
+    }
+    if( records != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) records );
+    }
+    if( buckets != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) buckets );
+    }
+
+    /*------------------------------------------------------------------
+    Return the result of compiling the index.
+    ------------------------------------------------------------------*/
+    return result;
+}
+
+
+/*==========================================================================*/
+DWORD config_index_find(            /* find a session with the hash index   */
+    config_file_type*   config,     /* configuration opened from its index  */
+    LPCTSTR             name        /* session name                         */
+) {                                 /* returns index, or CONFIG_NONE        */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const DWORD*        buckets;    /* first session in each bucket         */
+    DWORD               hash;       /* hash of requested name               */
+    const config_index_header_type*
+                        header;     /* mapped index header                  */
+    DWORD               i;          /* session index                        */
+    const config_index_session_type*
+                        record;     /* session record being compared        */
+    const config_index_session_type*
+                        records;    /* session records                      */
+    DWORD               steps;      /* number of records compared           */
+    LPTSTR              string;     /* stored session name                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( config->index == NULL ) || ( name == NULL ) ) {
+        return CONFIG_NONE;
+    }
+    header  = config->index;
+    buckets = ( const DWORD* ) ( config->text + header->buckets );
+    records = ( const config_index_session_type* )
+              ( config->text + header->sessions );
+
+    /*------------------------------------------------------------------
+    Walk the name's bucket.  The step limit ends a corrupt chain.
+    ------------------------------------------------------------------*/
+    hash = hash_bytes( name, ( _tcslen( name ) * sizeof( TCHAR ) ) );
+    i    = buckets[ hash & ( header->bucket_count - 1 ) ];
+    for( steps = 0;
+         ( i < header->session_count ) && ( steps < header->session_count );
+         ++steps ) {
+        record = &( records[ i ] );
+        if( ( record->hash == hash )
+         && ( get_string( header, record->name, &string ) != FALSE )
+         && ( string != NULL )
+         && ( _tcscmp( string, name ) == 0 ) ) {
+            return i;
+        }
+        i = record->next;
+    }
+
+    /*------------------------------------------------------------------
+    There is no session by that name.
+    ------------------------------------------------------------------*/
+    return CONFIG_NONE;
+}
+
+
+/*==========================================================================*/
+error_type config_index_load(       /* build a session from its records     */
+    config_file_type*   config,     /* configuration opened from its index  */
+    DWORD               index,      /* index of session                     */
+    config_session_type**
+                        session     /* returned session (one allocation)    */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const config_index_header_type*
+                        header;     /* mapped index header                  */
+    DWORD               i;          /* window index                         */
+    const config_index_session_type*
+                        record;     /* session record                       */
+    const config_index_window_type*
+                        records;    /* session's window records             */
+    config_window_type* window;     /* window being filled                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( config->index == NULL ) || ( session == NULL )
+     || ( index >= config->index->session_count ) ) {
+        return ERR_USAGE;
+    }
+    *session = NULL;
+    header   = config->index;
+    record   = ( ( const config_index_session_type* )
+                 ( config->text + header->sessions ) ) + index;
+
+    /*------------------------------------------------------------------
+    Make sure the session's windows and monitors are in their tables.
+    ------------------------------------------------------------------*/
+    if( ( record->first > header->window_count )
+     || ( record->count > ( header->window_count - record->first ) )
+     || ( record->monitor_first > header->monitor_count )
+     || ( record->monitor_count
+          > ( header->monitor_count - record->monitor_first ) ) ) {
+        return ERR_FORMAT;
+    }
+    records = ( ( const config_index_window_type* )
+                ( config->text + header->windows ) ) + record->first;
+
+    /*------------------------------------------------------------------
+    Allocate the session and its windows.  The strings and monitors
+    stay in the mapped file.
+    ------------------------------------------------------------------*/
+    *session = ( config_session_type* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( sizeof( config_session_type )
+          + ( record->count * sizeof( config_window_type ) ) )
+    );
+    if( *session == NULL ) {
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Point the session's fields at its records.
+    ------------------------------------------------------------------*/
+    ( *session )->count = record->count;
+    if( record->monitor_count > 0 ) {
+        ( *session )->monitor_count = record->monitor_count;
+        ( *session )->monitors      = ( ( const config_monitor_type* )
+            ( config->text + header->monitors ) ) + record->monitor_first;
+    }
+    if( get_string( header, record->name, &( *session )->name ) == FALSE ) {
+        config_free_session( *session );
+        *session = NULL;
+        return ERR_FORMAT;
+    }
+    for( i = 0; i < record->count; ++i ) {
+        window = &( ( *session )->windows[ i ] );
+        window->rectangle      = records[ i ].rectangle;
+        window->argument_count = records[ i ].argument_count;
+        window->after_count    = records[ i ].after_count;
+        window->wait           = records[ i ].wait;
+        if( ( get_string( header, records[ i ].name, &window->name )
+              == FALSE )
+         || ( get_string( header, records[ i ].command, &window->command )
+              == FALSE )
+         || ( get_string( header, records[ i ].arguments,
+                          &window->arguments ) == FALSE )
+         || ( get_string( header, records[ i ].after, &window->after )
+              == FALSE ) ) {
+            config_free_session( *session );
+            *session = NULL;
+            return ERR_FORMAT;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type config_index_names(      /* list session names in sorted order   */
+    config_file_type*   config,     /* configuration opened from its index  */
+    config_glob_name_type*
+                        names,      /* list to fill (config->count items)   */
+    DWORD*              count       /* returned number of names             */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const config_index_header_type*
+                        header;     /* mapped index header                  */
+    DWORD               i;          /* position in sorted order             */
+    const DWORD*        order;      /* session indices sorted by name       */
+    const config_index_session_type*
+                        records;    /* session records                      */
+    LPTSTR              string;     /* stored session name                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( config->index == NULL ) || ( names == NULL )
+     || ( count == NULL ) ) {
+        return ERR_USAGE;
+    }
+    header  = config->index;
+    order   = ( const DWORD* ) ( config->text + header->order );
+    records = ( const config_index_session_type* )
+              ( config->text + header->sessions );
+
+    /*------------------------------------------------------------------
+    The names were sorted when the index was compiled.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < header->session_count; ++i ) {
+        if( ( order[ i ] >= header->session_count )
+         || ( get_string( header, records[ order[ i ] ].name, &string )
+              == FALSE )
+         || ( string == NULL ) ) {
+            return ERR_FORMAT;
+        }
+        names[ i ].name  = string;
+        names[ i ].index = order[ i ];
+    }
+    *count = header->session_count;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type config_index_open(       /* map a current index for a source     */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path,       /* path to the source file              */
+    const FILETIME*     source_time,/* last write of the source file        */
+    DWORD               source_size /* size of the source file (bytes)      */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const config_index_header_type*
+                        header;     /* mapped index header                  */
+    TCHAR               index_path[ MAX_PATH ];
+                                    /* path to the index file               */
+    error_type          result;     /* result of internal operation         */
+    DWORD               size_high;  /* upper part of the file size          */
+    LPCTSTR             tail;       /* end of the string table              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( config == NULL ) || ( path == NULL ) || ( source_time == NULL ) ) {
+        return ERR_USAGE;
+    }
+    result = config_index_path( path, index_path, MAX_PATH );
+    if( result != ERR_OK ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    A missing index is not an error, the source is used instead.
+    ------------------------------------------------------------------*/
+    memset( config, 0, sizeof( config_file_type ) );
+    config->file = CreateFile(
+        index_path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if( config->file == INVALID_HANDLE_VALUE ) {
+        config->file = NULL;
+        return ERR_NOT_FOUND;
+    }
+
+    /*------------------------------------------------------------------
+    Map the whole index.
+    ------------------------------------------------------------------*/
+    config->size = GetFileSize( config->file, &size_high );
+    if( ( config->size < sizeof( config_index_header_type ) )
+     || ( config->size == INVALID_FILE_SIZE ) || ( size_high != 0 ) ) {
+        config_close( config );
+        return ERR_FORMAT;
+    }
+    config->mapping = CreateFileMapping(
+        config->file,
+        NULL,
+        PAGE_READONLY,
+        0,
+        0,
+        NULL
+    );
+    if( config->mapping == NULL ) {
+        config_close( config );
+        return ERR_WINAPI;
+    }
+    config->text = ( LPCSTR ) MapViewOfFile(
+        config->mapping,
+        FILE_MAP_READ,
+        0,
+        0,
+        0
+    );
+    if( config->text == NULL ) {
+        config_close( config );
+        return ERR_WINAPI;
+    }
+    header = ( const config_index_header_type* ) config->text;
+
+    /*------------------------------------------------------------------
+    An index compiled from a different source (or by a build with a
+    different character size) is out of date.
+    ------------------------------------------------------------------*/
+    if( ( header->magic != CONFIG_INDEX_MAGIC )
+     || ( header->version != CONFIG_INDEX_VERSION )
+     || ( header->char_size != sizeof( TCHAR ) )
+     || ( header->source_size != source_size )
+     || ( CompareFileTime( &header->source_time, source_time ) != 0 ) ) {
+        config_close( config );
+        return ERR_NOT_FOUND;
+    }
+
+    /*------------------------------------------------------------------
+    Every table must lie inside the file, so records can be trusted
+    without checking the file size again.
+    ------------------------------------------------------------------*/
+    if( ( header->size != config->size )
+     || ( header->bucket_count == 0 )
+     || ( ( header->bucket_count & ( header->bucket_count - 1 ) ) != 0 )
+     || ( check_range( header, header->buckets, header->bucket_count,
+                       sizeof( DWORD ) ) == FALSE )
+     || ( check_range( header, header->sessions, header->session_count,
+                       sizeof( config_index_session_type ) ) == FALSE )
+     || ( check_range( header, header->order, header->session_count,
+                       sizeof( DWORD ) ) == FALSE )
+     || ( check_range( header, header->windows, header->window_count,
+                       sizeof( config_index_window_type ) ) == FALSE )
+     || ( check_range( header, header->monitors, header->monitor_count,
+                       sizeof( config_monitor_type ) ) == FALSE )
+     || ( header->string_size < ( 2 * sizeof( TCHAR ) ) )
+     || ( check_range( header, header->strings, header->string_size, 1 )
+          == FALSE )
+     || ( header->config.offset > config->size )
+     || ( header->config.length > ( config->size - header->config.offset ) )
+     || ( header->restore.offset > config->size )
+     || ( header->restore.length
+          > ( config->size - header->restore.offset ) ) ) {
+        config_close( config );
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    The string table must end in a list terminator.
+    ------------------------------------------------------------------*/
+    tail = ( LPCTSTR ) ( config->text + header->strings
+                         + header->string_size );
+    if( ( tail[ -1 ] != _T( '\0' ) ) || ( tail[ -2 ] != _T( '\0' ) ) ) {
+        config_close( config );
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Use the index in place of the source.
+    ------------------------------------------------------------------*/
+    config->index   = header;
+    config->count   = header->session_count;
+    config->config  = header->config;
+    config->restore = header->restore;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type config_index_path(       /* derive the index path for a source   */
+    LPCTSTR             path,       /* path to the source file              */
+    LPTSTR              index_path, /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPTSTR              extension;  /* start of the file's extension        */
+    DWORD               length;     /* length of path                       */
+    LPTSTR              scan;       /* current character                    */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( path == NULL ) || ( index_path == NULL ) ) {
+        return ERR_USAGE;
+    }
+    length = _tcslen( path );
+    if( ( length + _tcslen( CONFIG_INDEX_EXTENSION ) ) >= size ) {
+        return ERR_OVERFLOW;
+    }
+    _tcscpy( index_path, path );
+
+    /*------------------------------------------------------------------
+    Replace the file name's extension, if it has one.
+    ------------------------------------------------------------------*/
+    extension = NULL;
+    for( scan = index_path; *scan != _T( '\0' ); ++scan ) {
+        if( *scan == _T( '.' ) ) {
+            extension = scan;
+        }
+        else if( ( *scan == _T( '\\' ) ) || ( *scan == _T( '/' ) ) ) {
+            extension = NULL;
+        }
+    }
+    if( extension == NULL ) {
+        extension = index_path + length;
+    }
+    _tcscpy( extension, CONFIG_INDEX_EXTENSION );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type add_string(              /* store a string once in the table     */
+    index_strings_type* strings,    /* string table builder                 */
+    LPCTSTR             text,       /* string (or list), or NULL            */
+    BOOL                list,       /* text is a double-NUL terminated list */
+    DWORD*              offset      /* returned offset, or CONFIG_NONE      */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               hash;       /* hash of text                         */
+    DWORD               i;          /* slot index                           */
+    DWORD               length;     /* stored length of text (bytes)        */
+    DWORD               mask;       /* slot index mask                      */
+    index_slot_type*    slot;       /* slot being probed                    */
+    index_slot_type*    slots;      /* resized slot table                   */
+    DWORD               slot_count; /* size of resized slot table           */
+
+    /*------------------------------------------------------------------
+    Absent strings are not stored.
+    ------------------------------------------------------------------*/
+    *offset = CONFIG_NONE;
+    if( text == NULL ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Measure the text, including its terminator(s).
+    ------------------------------------------------------------------*/
+    length = _tcslen( text ) + 1;
+    if( list != FALSE ) {
+        while( text[ length ] != _T( '\0' ) ) {
+            length += _tcslen( text + length ) + 1;
+        }
+        length += 1;
+    }
+    length *= sizeof( TCHAR );
+    hash    = hash_bytes( text, length );
+
+    /*------------------------------------------------------------------
+    Keep the slot table at most half full, so probes stay short.
+    ------------------------------------------------------------------*/
+    if( ( ( strings->used + 1 ) * 2 ) > strings->slot_count ) {
+        slot_count = ( strings->slot_count == 0 )
+                   ? INDEX_MIN_ITEMS : ( strings->slot_count * 2 );
+        slots      = ( index_slot_type* ) HeapAlloc(
+            GetProcessHeap(),
+            HEAP_ZERO_MEMORY,
+            ( slot_count * sizeof( index_slot_type ) )
+        );
+        if( slots == NULL ) {
+            return ERR_ALLOC;
+        }
+        for( i = 0; i < strings->slot_count; ++i ) {
+            slot = &( strings->slots[ i ] );
+            if( slot->length != 0 ) {
+                mask = slot->hash & ( slot_count - 1 );
+                while( slots[ mask ].length != 0 ) {
+                    mask = ( mask + 1 ) & ( slot_count - 1 );
+                }
+                slots[ mask ] = *slot;
+            }
+        }
+        if( strings->slots != NULL ) {
+            HeapFree( GetProcessHeap(), 0, ( LPVOID ) strings->slots );
+        }
+        strings->slots      = slots;
+        strings->slot_count = slot_count;
+    }
+
+    /*------------------------------------------------------------------
+    Return the offset of an identical string if one is stored.
+    ------------------------------------------------------------------*/
+    mask = strings->slot_count - 1;
+    for( i = hash & mask;
+         strings->slots[ i ].length != 0;
+         i = ( i + 1 ) & mask ) {
+        slot = &( strings->slots[ i ] );
+        if( ( slot->hash == hash ) && ( slot->length == length )
+         && ( memcmp( ( strings->data + slot->offset ), text, length )
+              == 0 ) ) {
+            *offset = slot->offset;
+            return ERR_OK;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Append the text, and remember it in the free slot.
+    ------------------------------------------------------------------*/
+    if( grow_table(
+        ( LPVOID* ) &strings->data,
+        &strings->capacity,
+        ( strings->size + length ),
+        1
+    ) != ERR_OK ) {
+        return ERR_ALLOC;
+    }
+    memcpy( ( strings->data + strings->size ), text, length );
+    slot         = &( strings->slots[ i ] );
+    slot->hash   = hash;
+    slot->offset = strings->size;
+    slot->length = length;
+    *offset         = strings->size;
+    strings->size  += length;
+    strings->used  += 1;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL check_range(                   /* test that a table lies in the file   */
+    const config_index_header_type*
+                        header,     /* mapped index header                  */
+    DWORD               offset,     /* offset of table                      */
+    DWORD               count,      /* number of items in table             */
+    DWORD               unit        /* size of each item (bytes)            */
+) {                                 /* returns TRUE if the table is valid   */
+
+    /*------------------------------------------------------------------
+    Tables are aligned, and must end inside the file.
+    ------------------------------------------------------------------*/
+    return ( ( ( offset & 3 ) == 0 )
+          && ( offset >= sizeof( config_index_header_type ) )
+          && ( offset <= header->size )
+          && ( count <= ( ( header->size - offset ) / unit ) ) )
+           ? TRUE : FALSE;
+}
+
+
+/*==========================================================================*/
+BOOL get_string(                    /* resolve a string offset              */
+    const config_index_header_type*
+                        header,     /* mapped index header                  */
+    DWORD               offset,     /* offset of string, or CONFIG_NONE     */
+    LPTSTR*             string      /* returned string, or NULL             */
+) {                                 /* returns TRUE if the offset is valid  */
+
+    /*------------------------------------------------------------------
+    Absent strings are returned as NULL.
+    ------------------------------------------------------------------*/
+    *string = NULL;
+    if( offset == CONFIG_NONE ) {
+        return TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    A string must start on a character inside the string table.  The
+    table's terminators keep it from running past the table.
+    ------------------------------------------------------------------*/
+    if( ( offset < header->strings )
+     || ( ( offset - header->strings ) >= header->string_size )
+     || ( ( ( offset - header->strings ) % sizeof( TCHAR ) ) != 0 ) ) {
+        return FALSE;
+    }
+    *string = ( LPTSTR ) ( ( LPBYTE ) header + offset );
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+error_type grow_table(              /* make room in a growing table         */
+    LPVOID*             table,      /* table allocation                     */
+    DWORD*              capacity,   /* number of items allocated            */
+    DWORD               needed,     /* number of items needed               */
+    DWORD               unit        /* size of each item (bytes)            */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPVOID              grown;      /* reallocated table                    */
+    DWORD               size;       /* new number of items                  */
+
+    /*------------------------------------------------------------------
+    Tables grow geometrically, so filling one takes few allocations.
+    ------------------------------------------------------------------*/
+    if( needed <= *capacity ) {
+        return ERR_OK;
+    }
+    for( size = ( *capacity == 0 ) ? INDEX_MIN_ITEMS : *capacity;
+         size < needed;
+         size *= 2 );
+    if( *table == NULL ) {
+        grown = HeapAlloc( GetProcessHeap(), 0, ( size * unit ) );
+    }
+    else {
+        grown = HeapReAlloc( GetProcessHeap(), 0, *table, ( size * unit ) );
+    }
+    if( grown == NULL ) {
+        return ERR_ALLOC;
+    }
+    *table    = grown;
+    *capacity = size;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD hash_bytes(                   /* hash a block of memory               */
+    LPCVOID             data,       /* data to hash                         */
+    DWORD               size        /* size of data (bytes)                 */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const BYTE*         byte;       /* current byte                         */
+    DWORD               hash;       /* accumulated hash                     */
+
+    /*------------------------------------------------------------------
+    Fold in each byte.
+    ------------------------------------------------------------------*/
+    hash = INDEX_FNV_BASIS;
+    for( byte = ( const BYTE* ) data; size > 0; --size, ++byte ) {
+        hash = ( hash ^ *byte ) * INDEX_FNV_PRIME;
+    }
+    return hash;
+}
+
+
+/*==========================================================================*/
+error_type write_block(             /* write a block to a file              */
+    HANDLE              file,       /* open file handle                     */
+    LPCVOID             data,       /* data to write                        */
+    DWORD               size        /* size of data (bytes)                 */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               written;    /* number of bytes written              */
+
+    /*------------------------------------------------------------------
+    Empty blocks need no write.
+    ------------------------------------------------------------------*/
+    if( size == 0 ) {
+        return ERR_OK;
+    }
+    if( ( WriteFile( file, data, size, &written, NULL ) == FALSE )
+     || ( written != size ) ) {
+        return ERR_WINAPI;
+    }
+    return ERR_OK;
+}
+
@@ -0,0 +1,629 @@
+/*****************************************************************************
+
+config_watch.c
+
+Configuration File Watch
+
+A resident restore (see main.c) reads the configuration once, and then has
+to notice when it is edited.  This module reads the file into memory (so it
+is never held open, and editors can save it), and asks the system to report
+changes to the directory that holds it.  Nothing is read again until a
+change names the file.
+
+Sessions are decoded the first time they are restored, and then kept, along
+with their compiled commands and arguments.  Each session is identified by
+a hash of its raw name and value.  When the file changes, it is read and
+indexed again (indexing only skips over session bodies), and each session
+whose raw text is the same as before keeps what was already decoded.  Only
+the sessions that were edited are decoded again, when they are next
+restored.
+
+The compiled strings of sessions that were edited or removed stay in the
+template table until there are enough of them to be worth rebuilding it.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+#include <wchar.h>
+
+#include "config_watch.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define CONFIG_WATCH_FILTER \
+                            ( FILE_NOTIFY_CHANGE_FILE_NAME \
+                            | FILE_NOTIFY_CHANGE_LAST_WRITE \
+                            | FILE_NOTIFY_CHANGE_SIZE )
+                                    /* changes that may replace the file    */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL arm_watch(                     /* ask for the next changes             */
+    config_watch_type*  watch       /* configuration file watch             */
+);                                  /* returns TRUE if changes will be      */
+                                    /* reported                             */
+
+void drop_cached(                   /* release a cached session             */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_cached_type* cached      /* cache entry to empty                 */
+);
+
+config_cached_type* hash_entries(   /* start a cache entry for each session */
+    config_file_type*   config      /* configuration just read              */
+);                                  /* returns cache entries, or NULL       */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+void config_watch_close(            /* stop watching, and release sessions  */
+    config_watch_type*  watch       /* configuration file watch             */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* session index                        */
+    DWORD               size;       /* size of cancelled changes (bytes)    */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( watch == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Cancel the pending request, and wait for it to let go of the
+    change buffer.
+    ------------------------------------------------------------------*/
+    if( watch->directory != NULL ) {
+        CancelIo( watch->directory );
+        GetOverlappedResult(
+            watch->directory,
+            &( watch->overlapped ),
+            &size,
+            TRUE
+        );
+        CloseHandle( watch->directory );
+    }
+    if( watch->event != NULL ) {
+        CloseHandle( watch->event );
+    }
+
+    /*------------------------------------------------------------------
+    Release the cached sessions.
+    ------------------------------------------------------------------*/
+    if( watch->cached != NULL ) {
+        for( i = 0; i < watch->count; ++i ) {
+            drop_cached( watch, &( watch->cached[ i ] ) );
+        }
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) watch->cached );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the watch object.
+    ------------------------------------------------------------------*/
+    memset( watch, 0, sizeof( config_watch_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type config_watch_load(       /* get a session, decoding it only if   */
+                                    /* it is not cached                     */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_file_type*   config,     /* configuration read by the watch      */
+    DWORD               index,      /* index of session                     */
+    config_session_type**
+                        session     /* returned session (owned by the       */
+                                    /* watch until the next reload)         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_cached_type* cached;     /* session's cache entry                */
+    DWORD               i;          /* window index                         */
+    error_type          result;     /* result of decoding the session       */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( watch == NULL ) || ( config == NULL ) || ( session == NULL )
+     || ( index >= watch->count ) || ( watch->count != config->count ) ) {
+        return ERR_USAGE;
+    }
+    *session = NULL;
+    cached   = &( watch->cached[ index ] );
+
+    /*------------------------------------------------------------------
+    A cached session gets its configured rectangles back, since the
+    last restore moved them onto the monitors of the time.
+    ------------------------------------------------------------------*/
+    if( cached->session != NULL ) {
+        for( i = 0; i < cached->session->count; ++i ) {
+            cached->session->windows[ i ].rectangle = cached->rectangles[ i ];
+        }
+        *session = cached->session;
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Decode and compile the session, and keep its rectangles.
+    ------------------------------------------------------------------*/
+    result = config_load( config, index, &( cached->session ) );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    cached->rectangles = ( RECT* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ( cached->session->count + 1 ) * sizeof( RECT ) )
+    );
+    if( cached->rectangles == NULL ) {
+        config_free_session( cached->session );
+        cached->session = NULL;
+        return ERR_ALLOC;
+    }
+    cached->strings = 0;
+    for( i = 0; i < cached->session->count; ++i ) {
+        cached->rectangles[ i ] = cached->session->windows[ i ].rectangle;
+        cached->strings += 1 + cached->session->windows[ i ].argument_count;
+    }
+    watch->live += cached->strings;
+    *session     = cached->session;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type config_watch_open(       /* read a configuration, and watch it   */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_file_type*   config,     /* configuration file object            */
+    LPCTSTR             path        /* path to configuration file           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    TCHAR               directory[ MAX_PATH ];
+                                    /* directory holding the file           */
+    LPTSTR              name;       /* file name in the path                */
+    error_type          result;     /* result of internal operation         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( watch == NULL ) || ( config == NULL ) || ( path == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( watch, 0, sizeof( config_watch_type ) );
+    if( _tcslen( path ) >= MAX_PATH ) {
+        return ERR_OVERFLOW;
+    }
+    _tcscpy( watch->path, path );
+
+    /*------------------------------------------------------------------
+    Read the file, and start a cache entry for each session.
+    ------------------------------------------------------------------*/
+    result = config_read( config, path );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    watch->cached = hash_entries( config );
+    if( watch->cached == NULL ) {
+        config_close( config );
+        return ERR_ALLOC;
+    }
+    watch->count = config->count;
+
+    /*------------------------------------------------------------------
+    Split the path into its directory and file name.  Changes report
+    names in UTF-16.
+    ------------------------------------------------------------------*/
+    _tcscpy( directory, path );
+    name = _tcsrchr( directory, _T( '\\' ) );
+    if( name != NULL ) {
+        *name = _T( '\0' );
+        name += 1;
+    }
+    else {
+        name = watch->path;
+        _tcscpy( directory, _T( "." ) );
+    }
+    #ifdef UNICODE
+        watch->name_length = lstrlenW( name );
+        memcpy(
+            watch->name,
+            name,
+            ( ( watch->name_length + 1 ) * sizeof( WCHAR ) )
+        );
+    #else
+        watch->name_length = MultiByteToWideChar(
+            CP_ACP,
+            0,
+            name,
+            -1,
+            watch->name,
+            MAX_PATH
+        ) - 1;
+    #endif
+
+    /*------------------------------------------------------------------
+    Watch the directory, since editors often save by replacing the
+    file, and a handle to the file would follow the old one.
+    ------------------------------------------------------------------*/
+    watch->event = CreateEvent( NULL, TRUE, FALSE, NULL );
+    watch->directory = CreateFile(
+        directory,
+        FILE_LIST_DIRECTORY,
+        ( FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE ),
+        NULL,
+        OPEN_EXISTING,
+        ( FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED ),
+        NULL
+    );
+    if( watch->directory == INVALID_HANDLE_VALUE ) {
+        watch->directory = NULL;
+    }
+    if( ( watch->event == NULL ) || ( watch->directory == NULL )
+     || ( watch->name_length == 0 ) || ( arm_watch( watch ) == FALSE ) ) {
+        config_watch_close( watch );
+        config_close( config );
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL config_watch_poll(             /* check for changes to the file        */
+    config_watch_type*  watch       /* configuration file watch             */
+) {                                 /* returns TRUE if it must be reloaded  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    FILE_NOTIFY_INFORMATION*
+                        change;     /* reported change                      */
+    DWORD               size;       /* size of reported changes (bytes)     */
+
+    /*------------------------------------------------------------------
+    Check interface usage.  A watch that stopped working can not tell,
+    so the file is read every time.
+    ------------------------------------------------------------------*/
+    if( watch == NULL ) {
+        return FALSE;
+    }
+    if( watch->directory == NULL ) {
+        return TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    Nothing has been reported since the last check.
+    ------------------------------------------------------------------*/
+    if( GetOverlappedResult(
+            watch->directory,
+            &( watch->overlapped ),
+            &size,
+            FALSE
+        ) == FALSE ) {
+        if( GetLastError() == ERROR_IO_INCOMPLETE ) {
+            return watch->stale;
+        }
+        size = 0;
+    }
+
+    /*------------------------------------------------------------------
+    An empty report means there were too many changes to list, and any
+    of them may have been to the file.
+    ------------------------------------------------------------------*/
+    if( size == 0 ) {
+        watch->stale = TRUE;
+    }
+    change = ( FILE_NOTIFY_INFORMATION* ) watch->changes;
+    while( size > 0 ) {
+        if( ( change->FileNameLength
+              == ( watch->name_length * sizeof( WCHAR ) ) )
+         && ( _wcsnicmp( change->FileName, watch->name,
+                         watch->name_length ) == 0 ) ) {
+            watch->stale = TRUE;
+        }
+        if( change->NextEntryOffset == 0 ) {
+            break;
+        }
+        change = ( FILE_NOTIFY_INFORMATION* )
+                 ( ( LPBYTE ) change + change->NextEntryOffset );
+    }
+
+    /*------------------------------------------------------------------
+    Ask for the next changes.
+    ------------------------------------------------------------------*/
+    if( arm_watch( watch ) == FALSE ) {
+        CloseHandle( watch->directory );
+        watch->directory = NULL;
+        watch->stale     = TRUE;
+    }
+    return watch->stale;
+}
+
+
+/*==========================================================================*/
+error_type config_watch_reload(     /* read the file again, keeping the     */
+                                    /* sessions that did not change         */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_file_type*   config      /* configuration read by the watch      */
+) {                                 /* returns error code (the old          */
+                                    /* configuration is kept on failure)    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bucket_count;
+                                    /* size of the hash table (power of 2)  */
+    DWORD*              buckets;    /* old session in each slot, or         */
+                                    /* CONFIG_NONE                          */
+    config_cached_type* cached;     /* new cache entries                    */
+    config_file_type    fresh;      /* configuration read again             */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* old session index                    */
+    DWORD               j;          /* new session index                    */
+    config_entry_type*  new_entry;  /* new session's index entry            */
+    config_entry_type*  old_entry;  /* old session's index entry            */
+    error_type          result;     /* result of internal operation         */
+    DWORD               slot;       /* hash table slot                      */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( watch == NULL ) || ( config == NULL )
+     || ( watch->count != config->count ) ) {
+        return ERR_USAGE;
+    }
+    heap = GetProcessHeap();
+
+    /*------------------------------------------------------------------
+    Read and index the file again.  The old configuration is kept until
+    the new one is complete.
+    ------------------------------------------------------------------*/
+    result = config_read( &fresh, watch->path );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    cached = hash_entries( &fresh );
+    bucket_count = 16;
+    while( bucket_count < ( watch->count * 2 ) ) {
+        bucket_count <<= 1;
+    }
+    buckets = ( DWORD* ) HeapAlloc(
+        heap,
+        0,
+        ( bucket_count * sizeof( DWORD ) )
+    );
+    if( ( cached == NULL ) || ( buckets == NULL ) ) {
+        if( cached != NULL ) {
+            HeapFree( heap, 0, ( LPVOID ) cached );
+        }
+        if( buckets != NULL ) {
+            HeapFree( heap, 0, ( LPVOID ) buckets );
+        }
+        config_close( &fresh );
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Hash the old sessions that were decoded.  The others have nothing
+    to keep.
+    ------------------------------------------------------------------*/
+    memset( buckets, 0xFF, ( bucket_count * sizeof( DWORD ) ) );
+    for( i = 0; i < watch->count; ++i ) {
+        if( watch->cached[ i ].session != NULL ) {
+            slot = watch->cached[ i ].hash & ( bucket_count - 1 );
+            while( buckets[ slot ] != CONFIG_NONE ) {
+                slot = ( slot + 1 ) & ( bucket_count - 1 );
+            }
+            buckets[ slot ] = i;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Each new session whose raw name and value match an old session's
+    byte for byte takes over what was decoded for it.
+    ------------------------------------------------------------------*/
+    for( j = 0; j < fresh.count; ++j ) {
+        new_entry = &( fresh.entries[ j ] );
+        slot      = cached[ j ].hash & ( bucket_count - 1 );
+        for( ; buckets[ slot ] != CONFIG_NONE;
+             slot = ( slot + 1 ) & ( bucket_count - 1 ) ) {
+            i         = buckets[ slot ];
+            old_entry = &( config->entries[ i ] );
+            if( ( watch->cached[ i ].session != NULL )
+             && ( watch->cached[ i ].hash == cached[ j ].hash )
+             && ( old_entry->name.length == new_entry->name.length )
+             && ( old_entry->value.length == new_entry->value.length )
+             && ( memcmp( ( config->text + old_entry->name.offset ),
+                          ( fresh.text + new_entry->name.offset ),
+                          new_entry->name.length ) == 0 )
+             && ( memcmp( ( config->text + old_entry->value.offset ),
+                          ( fresh.text + new_entry->value.offset ),
+                          new_entry->value.length ) == 0 ) ) {
+                cached[ j ] = watch->cached[ i ];
+                watch->cached[ i ].session    = NULL;
+                watch->cached[ i ].rectangles = NULL;
+                break;
+            }
+        }
+    }
+    HeapFree( heap, 0, ( LPVOID ) buckets );
+
+    /*------------------------------------------------------------------
+    Release the sessions that were edited or removed.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < watch->count; ++i ) {
+        drop_cached( watch, &( watch->cached[ i ] ) );
+    }
+    HeapFree( heap, 0, ( LPVOID ) watch->cached );
+    watch->cached = cached;
+    watch->count  = fresh.count;
+
+    /*------------------------------------------------------------------
+    Use the new configuration in place of the old one.  The compiled
+    strings move with it, and the kept sessions point at them through
+    the caller's configuration object, which does not move.
+    ------------------------------------------------------------------*/
+    fresh.templates = config->templates;
+    memset( &( config->templates ), 0, sizeof( arg_template_type ) );
+    config_close( config );
+    *config      = fresh;
+    watch->stale = FALSE;
+
+    /*------------------------------------------------------------------
+    Once the strings of changed sessions outnumber the ones in use,
+    start the table over.  Sessions are compiled again as they are
+    restored.
+    ------------------------------------------------------------------*/
+    if( config->templates.count > ( ( 2 * watch->live )
+                                    + CONFIG_WATCH_SLACK ) ) {
+        for( j = 0; j < watch->count; ++j ) {
+            drop_cached( watch, &( watch->cached[ j ] ) );
+        }
+        arg_template_free( &( config->templates ) );
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL arm_watch(                     /* ask for the next changes             */
+    config_watch_type*  watch       /* configuration file watch             */
+) {                                 /* returns TRUE if changes will be      */
+                                    /* reported                             */
+
+    /*------------------------------------------------------------------
+    Reuse the event for each request.
+    ------------------------------------------------------------------*/
+    ResetEvent( watch->event );
+    memset( &( watch->overlapped ), 0, sizeof( OVERLAPPED ) );
+    watch->overlapped.hEvent = watch->event;
+
+    /*------------------------------------------------------------------
+    Changes to other files in the directory are reported too, and are
+    passed over when they are checked.
+    ------------------------------------------------------------------*/
+    return ReadDirectoryChangesW(
+        watch->directory,
+        ( LPVOID ) watch->changes,
+        sizeof( watch->changes ),
+        FALSE,
+        CONFIG_WATCH_FILTER,
+        NULL,
+        &( watch->overlapped ),
+        NULL
+    );
+}
+
+
+/*==========================================================================*/
+void drop_cached(                   /* release a cached session             */
+    config_watch_type*  watch,      /* configuration file watch             */
+    config_cached_type* cached      /* cache entry to empty                 */
+) {
+
+    /*------------------------------------------------------------------
+    Its compiled strings stay in the table, and are no longer in use.
+    ------------------------------------------------------------------*/
+    if( cached->session != NULL ) {
+        config_free_session( cached->session );
+        watch->live -= cached->strings;
+    }
+    if( cached->rectangles != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) cached->rectangles );
+    }
+    cached->session    = NULL;
+    cached->rectangles = NULL;
+    cached->strings    = 0;
+
+}
+
+
+/*==========================================================================*/
+config_cached_type* hash_entries(   /* start a cache entry for each session */
+    config_file_type*   config      /* configuration just read              */
+) {                                 /* returns cache entries, or NULL       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_cached_type* cached;     /* cache entries                        */
+    config_entry_type*  entry;      /* session's index entry                */
+    DWORD               hash;       /* FNV-1a hash                          */
+    DWORD               i;          /* session index                        */
+    DWORD               k;          /* byte index                           */
+    LPCSTR              text;       /* raw text being hashed                */
+
+    /*------------------------------------------------------------------
+    Allocate an empty entry for each session.
+    ------------------------------------------------------------------*/
+    cached = ( config_cached_type* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( ( config->count + 1 ) * sizeof( config_cached_type ) )
+    );
+    if( cached == NULL ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Hash each session's raw name, then its raw value.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < config->count; ++i ) {
+        entry = &( config->entries[ i ] );
+        hash  = 2166136261UL;
+        text  = config->text + entry->name.offset;
+        for( k = 0; k < entry->name.length; ++k ) {
+            hash = ( hash ^ ( BYTE ) text[ k ] ) * 16777619UL;
+        }
+        text  = config->text + entry->value.offset;
+        for( k = 0; k < entry->value.length; ++k ) {
+            hash = ( hash ^ ( BYTE ) text[ k ] ) * 16777619UL;
+        }
+        cached[ i ].hash = hash;
+    }
+    return cached;
+}
+
@@ -0,0 +1,562 @@
+/*****************************************************************************
+
+json_scan.c
+
+Streaming JSON Scanner
+
+This module walks JSON text in place without building a document tree.  The
+caller steps through containers one item at a time, and can skip any value
+it does not need.  Strings are returned as spans of the raw text, and are
+only decoded when the caller asks for them.  Nothing is allocated.
+
+The scanner is forgiving about separators (commas and colons are treated
+like whitespace), since it only needs to read well-formed configuration
+files quickly, not validate them.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "json_scan.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define JSON_REPLACEMENT    ( 0xFFFD )
+                                    /* character for malformed UTF-8        */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL decode_hex(                    /* decode a \u escape's digits          */
+    LPCSTR              digits,     /* four hexadecimal digits              */
+    DWORD*              value       /* returned value                       */
+);                                  /* returns TRUE if the digits are valid */
+
+BOOL skip_string(                   /* move past a string's closing quote   */
+    json_cursor_type*   cursor      /* scanning position after open quote   */
+);                                  /* returns FALSE if string is truncated */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+DWORD json_decode(                  /* decode a string span to UTF-16       */
+    LPCSTR              text,       /* UTF-8 text holding the span          */
+    json_span_type*     span,       /* raw string contents (no quotes)      */
+    LPWSTR              target      /* destination, at least span->length   */
+                                    /* characters                           */
+) {                                 /* returns characters written (no NUL)  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    BYTE                c;          /* current byte                         */
+    DWORD               code;       /* decoded code point                   */
+    DWORD               count;      /* continuation bytes of a sequence     */
+    DWORD               d;          /* output position                      */
+    DWORD               end;        /* end of the span                      */
+    DWORD               i;          /* continuation byte index              */
+    DWORD               s;          /* input position                       */
+
+    /*------------------------------------------------------------------
+    Every escape and UTF-8 sequence is at least as long as the UTF-16
+    text it decodes to, so the output never outgrows the span.
+    ------------------------------------------------------------------*/
+    d   = 0;
+    s   = span->offset;
+    end = span->offset + span->length;
+    while( s < end ) {
+        c = ( BYTE ) text[ s ];
+
+        /*--------------------------------------------------------------
+        Decode escape sequences.
+        --------------------------------------------------------------*/
+        if( c == '\\' ) {
+            if( ( s + 1 ) >= end ) {
+                break;
+            }
+            c  = ( BYTE ) text[ s + 1 ];
+            s += 2;
+            switch( c ) {
+                case 'b': target[ d++ ] = L'\b'; break;
+                case 'f': target[ d++ ] = L'\f'; break;
+                case 'n': target[ d++ ] = L'\n'; break;
+                case 'r': target[ d++ ] = L'\r'; break;
+                case 't': target[ d++ ] = L'\t'; break;
+                case 'u':
+                    if( ( ( s + 4 ) <= end )
+                     && ( decode_hex( ( text + s ), &code ) != FALSE ) ) {
+                        target[ d++ ] = ( WCHAR ) code;
+                        s += 4;
+                    }
+                    else {
+                        target[ d++ ] = JSON_REPLACEMENT;
+                    }
+                    break;
+                default:  target[ d++ ] = ( WCHAR ) c; break;
+            }
+            continue;
+        }
+
+        /*--------------------------------------------------------------
+        ASCII is copied directly.
+        --------------------------------------------------------------*/
+        if( c < 0x80 ) {
+            target[ d++ ] = ( WCHAR ) c;
+            s += 1;
+            continue;
+        }
+
+        /*--------------------------------------------------------------
+        Determine the length of a multi-byte sequence.
+        --------------------------------------------------------------*/
+        if( ( c & 0xE0 ) == 0xC0 ) {
+            code  = c & 0x1F;
+            count = 1;
+        }
+        else if( ( c & 0xF0 ) == 0xE0 ) {
+            code  = c & 0x0F;
+            count = 2;
+        }
+        else if( ( c & 0xF8 ) == 0xF0 ) {
+            code  = c & 0x07;
+            count = 3;
+        }
+        else {
+            target[ d++ ] = JSON_REPLACEMENT;
+            s += 1;
+            continue;
+        }
+
+        /*--------------------------------------------------------------
+        Collect the continuation bytes.
+        --------------------------------------------------------------*/
+        for( i = 1; i <= count; ++i ) {
+            if( ( ( s + i ) >= end )
+             || ( ( text[ s + i ] & 0xC0 ) != 0x80 ) ) {
+                break;
+            }
+            code = ( code << 6 ) | ( text[ s + i ] & 0x3F );
+        }
+        if( i <= count ) {
+            target[ d++ ] = JSON_REPLACEMENT;
+            s += i;
+            continue;
+        }
+        s += count + 1;
+
+        /*--------------------------------------------------------------
+        Characters beyond the basic plane need a surrogate pair.
+        --------------------------------------------------------------*/
+        if( code >= 0x10000 ) {
+            code         -= 0x10000;
+            target[ d++ ] = ( WCHAR ) ( 0xD800 | ( code >> 10 ) );
+            target[ d++ ] = ( WCHAR ) ( 0xDC00 | ( code & 0x3FF ) );
+        }
+        else {
+            target[ d++ ] = ( WCHAR ) code;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return the number of characters written.
+    ------------------------------------------------------------------*/
+    return d;
+}
+
+
+/*==========================================================================*/
+BOOL json_enter(                    /* step into an object or array         */
+    json_cursor_type*   cursor      /* scanning position                    */
+) {                                 /* returns TRUE if a container started  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    json_token_type     token;      /* type of the next token               */
+
+    /*------------------------------------------------------------------
+    Consume the opening bracket.
+    ------------------------------------------------------------------*/
+    token = json_peek( cursor );
+    if( ( token != JSON_OBJECT ) && ( token != JSON_ARRAY ) ) {
+        return FALSE;
+    }
+    cursor->offset += 1;
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+void json_init(                     /* start scanning a JSON text           */
+    json_cursor_type*   cursor,     /* scanning position to initialize      */
+    LPCSTR              text,       /* UTF-8 text to scan                   */
+    DWORD               size        /* size of text (bytes)                 */
+) {
+
+    /*------------------------------------------------------------------
+    Skip a UTF-8 byte order mark.
+    ------------------------------------------------------------------*/
+    cursor->text   = text;
+    cursor->size   = size;
+    cursor->offset = 0;
+    if( ( size >= 3 ) && ( ( BYTE ) text[ 0 ] == 0xEF )
+     && ( ( BYTE ) text[ 1 ] == 0xBB ) && ( ( BYTE ) text[ 2 ] == 0xBF ) ) {
+        cursor->offset = 3;
+    }
+
+}
+
+
+/*==========================================================================*/
+BOOL json_next(                     /* move to a container's next item      */
+    json_cursor_type*   cursor      /* scanning position                    */
+) {                                 /* returns FALSE at the container's end */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    json_token_type     token;      /* type of the next token               */
+
+    /*------------------------------------------------------------------
+    Consume the closing bracket at the end of a container.
+    ------------------------------------------------------------------*/
+    token = json_peek( cursor );
+    if( token == JSON_END ) {
+        if( cursor->offset < cursor->size ) {
+            cursor->offset += 1;
+        }
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Any other token but an error starts the next item.
+    ------------------------------------------------------------------*/
+    return ( token != JSON_ERROR ) ? TRUE : FALSE;
+}
+
+
+/*==========================================================================*/
+BOOL json_number(                   /* scan an integer value                */
+    json_cursor_type*   cursor,     /* scanning position                    */
+    LONG*               value       /* returned value                       */
+) {                                 /* returns TRUE if a number was scanned */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    char                c;          /* current character                    */
+    BOOL                negative;   /* the number has a minus sign          */
+    LONG                result;     /* accumulated value                    */
+
+    /*------------------------------------------------------------------
+    Check for a number.
+    ------------------------------------------------------------------*/
+    if( json_peek( cursor ) != JSON_NUMBER ) {
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Accumulate the integer part.
+    ------------------------------------------------------------------*/
+    negative = FALSE;
+    if( cursor->text[ cursor->offset ] == '-' ) {
+        negative        = TRUE;
+        cursor->offset += 1;
+    }
+    result = 0;
+    while( cursor->offset < cursor->size ) {
+        c = cursor->text[ cursor->offset ];
+        if( ( c < '0' ) || ( c > '9' ) ) {
+            break;
+        }
+        result          = ( result * 10 ) + ( c - '0' );
+        cursor->offset += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Ignore any fraction or exponent.
+    ------------------------------------------------------------------*/
+    while( cursor->offset < cursor->size ) {
+        c = cursor->text[ cursor->offset ];
+        if( ( ( c < '0' ) || ( c > '9' ) ) && ( c != '.' ) && ( c != 'e' )
+         && ( c != 'E' ) && ( c != '+' ) && ( c != '-' ) ) {
+            break;
+        }
+        cursor->offset += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Return the value.
+    ------------------------------------------------------------------*/
+    *value = ( negative != FALSE ) ? -result : result;
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+json_token_type json_peek(          /* get the type of the next token       */
+    json_cursor_type*   cursor      /* scanning position                    */
+) {                                 /* returns token type                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    char                c;          /* current character                    */
+
+    /*------------------------------------------------------------------
+    Skip whitespace and separators.
+    ------------------------------------------------------------------*/
+    while( cursor->offset < cursor->size ) {
+        c = cursor->text[ cursor->offset ];
+        if( ( c != ' ' ) && ( c != '\t' ) && ( c != '\r' ) && ( c != '\n' )
+         && ( c != ',' ) && ( c != ':' ) ) {
+            break;
+        }
+        cursor->offset += 1;
+    }
+
+    /*------------------------------------------------------------------
+    The end of the text ends every open container.
+    ------------------------------------------------------------------*/
+    if( cursor->offset >= cursor->size ) {
+        return JSON_END;
+    }
+
+    /*------------------------------------------------------------------
+    The first character identifies the token.
+    ------------------------------------------------------------------*/
+    c = cursor->text[ cursor->offset ];
+    switch( c ) {
+        case '{': return JSON_OBJECT;
+        case '[': return JSON_ARRAY;
+        case '"': return JSON_STRING;
+        case '}':
+        case ']': return JSON_END;
+        case 't':
+        case 'f':
+        case 'n': return JSON_LITERAL;
+        default:  break;
+    }
+    if( ( c == '-' ) || ( ( c >= '0' ) && ( c <= '9' ) ) ) {
+        return JSON_NUMBER;
+    }
+    return JSON_ERROR;
+}
+
+
+/*==========================================================================*/
+BOOL json_skip(                     /* skip a value without decoding it     */
+    json_cursor_type*   cursor,     /* scanning position                    */
+    json_span_type*     span        /* returned span of the value, or NULL  */
+) {                                 /* returns TRUE if a value was skipped  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    char                c;          /* current character                    */
+    DWORD               depth;      /* container nesting depth              */
+    DWORD               start;      /* offset of the value                  */
+    json_token_type     token;      /* type of the value                    */
+
+    /*------------------------------------------------------------------
+    Find the start of the value.
+    ------------------------------------------------------------------*/
+    token = json_peek( cursor );
+    start = cursor->offset;
+    switch( token ) {
+
+        /*--------------------------------------------------------------
+        Skip a string.
+        --------------------------------------------------------------*/
+        case JSON_STRING:
+            cursor->offset += 1;
+            if( skip_string( cursor ) == FALSE ) {
+                return FALSE;
+            }
+            break;
+
+        /*--------------------------------------------------------------
+        Skip a container by bracket depth alone.  Only strings need a
+        closer look, since they may contain brackets.
+        --------------------------------------------------------------*/
+        case JSON_OBJECT:
+        case JSON_ARRAY:
+            depth = 0;
+            while( cursor->offset < cursor->size ) {
+                c = cursor->text[ cursor->offset ];
+                cursor->offset += 1;
+                if( c == '"' ) {
+                    if( skip_string( cursor ) == FALSE ) {
+                        return FALSE;
+                    }
+                }
+                else if( ( c == '{' ) || ( c == '[' ) ) {
+                    depth += 1;
+                }
+                else if( ( c == '}' ) || ( c == ']' ) ) {
+                    depth -= 1;
+                    if( depth == 0 ) {
+                        break;
+                    }
+                }
+            }
+            if( depth != 0 ) {
+                return FALSE;
+            }
+            break;
+
+        /*--------------------------------------------------------------
+        Skip a number or literal up to the next delimiter.
+        --------------------------------------------------------------*/
+        case JSON_NUMBER:
+        case JSON_LITERAL:
+            while( cursor->offset < cursor->size ) {
+                c = cursor->text[ cursor->offset ];
+                if( ( c == ',' ) || ( c == '}' ) || ( c == ']' )
+                 || ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' )
+                 || ( c == '\n' ) ) {
+                    break;
+                }
+                cursor->offset += 1;
+            }
+            break;
+
+        /*--------------------------------------------------------------
+        There is no value here.
+        --------------------------------------------------------------*/
+        default:
+            return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Report the span of the skipped value.
+    ------------------------------------------------------------------*/
+    if( span != NULL ) {
+        span->offset = start;
+        span->length = cursor->offset - start;
+    }
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+BOOL json_string(                   /* scan a string value                  */
+    json_cursor_type*   cursor,     /* scanning position                    */
+    json_span_type*     span        /* returned raw contents (no quotes)    */
+) {                                 /* returns TRUE if a string was scanned */
+
+    /*------------------------------------------------------------------
+    Check for a string.
+    ------------------------------------------------------------------*/
+    if( json_peek( cursor ) != JSON_STRING ) {
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Find the closing quote, and report the contents between the quotes.
+    ------------------------------------------------------------------*/
+    cursor->offset += 1;
+    span->offset    = cursor->offset;
+    if( skip_string( cursor ) == FALSE ) {
+        return FALSE;
+    }
+    span->length = cursor->offset - span->offset - 1;
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+BOOL decode_hex(                    /* decode a \u escape's digits          */
+    LPCSTR              digits,     /* four hexadecimal digits              */
+    DWORD*              value       /* returned value                       */
+) {                                 /* returns TRUE if the digits are valid */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    char                c;          /* current digit                        */
+    DWORD               i;          /* digit index                          */
+
+    /*------------------------------------------------------------------
+    Accumulate four digits.
+    ------------------------------------------------------------------*/
+    *value = 0;
+    for( i = 0; i < 4; ++i ) {
+        c       = digits[ i ];
+        *value <<= 4;
+        if( ( c >= '0' ) && ( c <= '9' ) ) {
+            *value |= c - '0';
+        }
+        else if( ( c >= 'a' ) && ( c <= 'f' ) ) {
+            *value |= c - 'a' + 10;
+        }
+        else if( ( c >= 'A' ) && ( c <= 'F' ) ) {
+            *value |= c - 'A' + 10;
+        }
+        else {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+BOOL skip_string(                   /* move past a string's closing quote   */
+    json_cursor_type*   cursor      /* scanning position after open quote   */
+) {                                 /* returns FALSE if string is truncated */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               escapes;    /* backslashes before a quote           */
+    LPCSTR              quote;      /* next quote character                 */
+    LPCSTR              scan;       /* backslash scan position              */
+
+    /*------------------------------------------------------------------
+    Jump from quote to quote.  A quote preceded by an odd number of
+    backslashes is escaped, and does not end the string.
+    ------------------------------------------------------------------*/
+    for( ; ; ) {
+        quote = ( LPCSTR ) memchr(
+            ( cursor->text + cursor->offset ),
+            '"',
+            ( cursor->size - cursor->offset )
+        );
+        if( quote == NULL ) {
+            cursor->offset = cursor->size;
+            return FALSE;
+        }
+        escapes = 0;
+        for( scan = quote; ( scan > ( cursor->text + cursor->offset ) )
+                        && ( scan[ -1 ] == '\\' ); --scan ) {
+            escapes += 1;
+        }
+        cursor->offset = ( DWORD ) ( quote - cursor->text ) + 1;
+        if( ( escapes & 1 ) == 0 ) {
+            return TRUE;
+        }
+    }
+}
+
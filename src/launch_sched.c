@@ -0,0 +1,1052 @@
+/*****************************************************************************
+
+launch_sched.c
+
+Session Launch Scheduler
+
+Launching a session's windows one at a time, and waiting for each window
+before starting the next, makes the session's start-up time the sum of
+every program's start-up time.  This module starts the windows on a bounded
+pool of worker threads instead, so windows that do not depend on each other
+start together.
+
+A window may list the names of windows it must start "after".  By default,
+an earlier window counts as started once its program is running.  An
+earlier window marked "wait" only counts once its window has appeared (or
+its process has exited, or its wait has timed out).  A window whose launch
+fails still releases the windows that start after it.
+
+Windows with a rectangle are moved into place as soon as they appear.  The
+calling thread watches for them (see window_watch.c) while the workers go
+on starting other windows, so neither ever waits on the other.
+
+When the caller passes the processes that are already running (see
+proc_match.c), a window whose program is running with the same arguments is
+moved into place instead of being started again, so restoring a session
+twice does not double it.
+
+Programs are started and placed through a backend.  The usual backend uses
+CreateProcess and SetWindowPos, and learns about new windows from window
+event hooks.  Other backends (for example, a simulated one for measuring the
+scheduler itself) can be passed in its place.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "launch_sched.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+enum {                              /* launch entry states                  */
+    ENTRY_PENDING,                  /* waiting for earlier windows          */
+    ENTRY_WAITING,                  /* started, to be handed to the watch   */
+    ENTRY_WATCHED,                  /* waiting for its window to appear     */
+    ENTRY_DONE                      /* nothing is left to do for it         */
+};
+
+typedef struct sched_block_s {      /* state shared by every worker type    */
+    config_session_type*
+                        session;    /* session being launched               */
+    const launch_sched_backend_type*
+                        backend;    /* backend starting the windows         */
+    proc_match_type*    existing;   /* running processes to reuse, or NULL  */
+    launch_sched_item_type*
+                        items;      /* one item per window                  */
+    volatile LONG*      states;     /* ENTRY_* state of each window         */
+    volatile LONG*      pending;    /* unfinished windows each window is    */
+                                    /* started after                        */
+    DWORD*              first;      /* first dependent of each window, plus */
+                                    /* the end of the last                  */
+    DWORD*              dependents; /* windows started after each window    */
+    DWORD*              queue;      /* windows in the order they were ready */
+    DWORD               head;       /* next window to take from the queue   */
+    DWORD               tail;       /* end of the queue                     */
+    CRITICAL_SECTION    lock;       /* protects the queue                   */
+    HANDLE              ready;      /* semaphore counting queued windows    */
+    window_watch_type   watch;      /* windows that have not appeared yet   */
+    volatile LONG       finished;   /* number of windows that are done      */
+    volatile LONG       stopping;   /* workers must exit                    */
+} sched_block_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type build_graph(             /* resolve each window's "after" names  */
+    sched_block_type*   block       /* shared launch state                  */
+);                                  /* returns error code                   */
+
+DWORD find_window(                  /* find a session window by name        */
+    config_session_type*
+                        session,    /* session to search                    */
+    LPCTSTR             name        /* window name                          */
+);                                  /* returns index, or CONFIG_NONE        */
+
+void finish_entry(                  /* count a window as done               */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               index       /* index of finished window             */
+);
+
+DWORD WINAPI launch_thread(         /* worker thread entry point            */
+    LPVOID              parameter   /* shared launch state                  */
+);                                  /* returns thread exit code             */
+
+void process_close(                 /* close a started process' handle      */
+    LPVOID              context,    /* unused                               */
+    launch_sched_item_type*
+                        item        /* started item                         */
+);
+
+error_type process_place(           /* move a window with SetWindowPos      */
+    LPVOID              context,    /* unused                               */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item with the window that appeared   */
+);                                  /* returns error code                   */
+
+error_type process_start(           /* start a window with CreateProcess    */
+    LPVOID              context,    /* unused                               */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item to fill with the process        */
+);                                  /* returns error code                   */
+
+LPTSTR quote_argument(              /* append one quoted argument           */
+    LPTSTR              target,     /* end of the command line so far       */
+    LPCTSTR             argument    /* argument to append                   */
+);                                  /* returns new end of the command line  */
+
+void queue_entry(                   /* hand a window to the workers         */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               index       /* index of ready window                */
+);
+
+void release_entry(                 /* let later windows start              */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               index       /* index of released window             */
+);
+
+BOOL watch_windows(                 /* place windows as they appear         */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               window_timeout
+                                    /* limit on each window wait (ms), or   */
+                                    /* INFINITE                             */
+);                                  /* returns FALSE if a wait timed out    */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static const launch_sched_backend_type default_backend = {
+    process_start,
+    process_place,
+    process_close,
+    NULL,
+    NULL
+};                                  /* launches windows with CreateProcess  */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+void launch_sched_free(             /* release a session launch             */
+    launch_sched_type*  launch      /* launch object                        */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* item index                           */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( launch == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Let the backend release what it acquired for each item.
+    ------------------------------------------------------------------*/
+    if( launch->items != NULL ) {
+        for( i = 0; i < launch->count; ++i ) {
+            if( launch->backend->close != NULL ) {
+                launch->backend->close(
+                    launch->backend->context,
+                    &( launch->items[ i ] )
+                );
+            }
+        }
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) launch->items );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the launch object.
+    ------------------------------------------------------------------*/
+    memset( launch, 0, sizeof( launch_sched_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type launch_sched_run(        /* launch every window in a session     */
+    config_session_type*
+                        session,    /* session to launch                    */
+    const launch_sched_backend_type*
+                        backend,    /* backend, or NULL for CreateProcess   */
+    proc_match_type*    existing,   /* running processes to reuse, or NULL  */
+    DWORD               workers,    /* worker threads, or 0 for one per CPU */
+    DWORD               window_timeout,
+                                    /* limit on each window wait (ms), or   */
+                                    /* INFINITE                             */
+    launch_sched_type*  launch      /* launch object to initialize          */
+) {                                 /* returns error code (ERR_TIMEOUT if   */
+                                    /* a window did not appear in time)     */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    sched_block_type    block;      /* state shared by every worker         */
+    DWORD               count;      /* number of windows                    */
+    HANDLE              handles[ LAUNCH_SCHED_MAX_WORKERS ];
+                                    /* handles of started worker threads    */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* loop index                           */
+    BOOL                in_time;    /* every window appeared in time        */
+    LPBYTE              memory;     /* scheduling lists                     */
+    error_type          result;     /* result of internal operation         */
+    DWORD               running;    /* number of worker threads started     */
+    SYSTEM_INFO         system;     /* system information                   */
+    HANDLE              thread;     /* handle of a new worker thread        */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( session == NULL ) || ( launch == NULL ) ) {
+        return ERR_USAGE;
+    }
+    if( backend == NULL ) {
+        backend = &default_backend;
+    }
+    if( backend->start == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Initialize the user's memory.
+    ------------------------------------------------------------------*/
+    memset( launch, 0, sizeof( launch_sched_type ) );
+    launch->backend = backend;
+    count = session->count;
+    if( count == 0 ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Use one worker per processor by default, but never more workers
+    than windows.
+    ------------------------------------------------------------------*/
+    if( workers == 0 ) {
+        GetSystemInfo( &system );
+        workers = system.dwNumberOfProcessors;
+    }
+    if( workers > LAUNCH_SCHED_MAX_WORKERS ) {
+        workers = LAUNCH_SCHED_MAX_WORKERS;
+    }
+    if( workers > count ) {
+        workers = count;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate the items, and one block for the scheduling lists.  The
+    dependents list can not be sized until the names are resolved.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    memset( &block, 0, sizeof( sched_block_type ) );
+    block.session  = session;
+    block.backend  = backend;
+    block.existing = existing;
+    block.items   = ( launch_sched_item_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( count * sizeof( launch_sched_item_type ) )
+    );
+    memory = ( LPBYTE ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( ( 2 * count * sizeof( LONG ) )
+          + ( ( ( 2 * count ) + 1 ) * sizeof( DWORD ) ) )
+    );
+    if( ( block.items == NULL ) || ( memory == NULL ) ) {
+        if( block.items != NULL ) {
+            HeapFree( heap, 0, ( LPVOID ) block.items );
+        }
+        if( memory != NULL ) {
+            HeapFree( heap, 0, ( LPVOID ) memory );
+        }
+        return ERR_ALLOC;
+    }
+    block.states  = ( volatile LONG* ) memory;
+    block.pending = block.states + count;
+    block.first   = ( DWORD* ) ( block.pending + count );
+    block.queue   = block.first + count + 1;
+    launch->count = count;
+    launch->items = block.items;
+
+    /*------------------------------------------------------------------
+    Resolve the ordering constraints.  Nothing is started unless every
+    window can be.
+    ------------------------------------------------------------------*/
+    result = build_graph( &block );
+
+    /*------------------------------------------------------------------
+    Start watching for windows before any program is started, so no
+    window can be missed.  Then create the queue's lock and signal.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        result = window_watch_open(
+            &( block.watch ),
+            backend->source,
+            count
+        );
+    }
+    if( result == ERR_OK ) {
+        block.ready = CreateSemaphore(
+            NULL,
+            0,
+            ( LONG ) ( count + workers ),
+            NULL
+        );
+        if( block.ready == NULL ) {
+            window_watch_close( &( block.watch ) );
+            result = ERR_WINAPI;
+        }
+    }
+    if( result != ERR_OK ) {
+        if( block.dependents != NULL ) {
+            HeapFree( heap, 0, ( LPVOID ) block.dependents );
+        }
+        HeapFree( heap, 0, ( LPVOID ) memory );
+        launch_sched_free( launch );
+        return result;
+    }
+    InitializeCriticalSection( &( block.lock ) );
+
+    /*------------------------------------------------------------------
+    Queue the windows that do not start after any others.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < count; ++i ) {
+        if( block.pending[ i ] == 0 ) {
+            queue_entry( &block, i );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Start the worker threads.  Any one of them can start every window,
+    so a launch only fails if none of them start.
+    ------------------------------------------------------------------*/
+    running = 0;
+    for( i = 0; i < workers; ++i ) {
+        thread = CreateThread(
+            NULL,
+            0,
+            launch_thread,
+            ( LPVOID ) &block,
+            0,
+            NULL
+        );
+        if( thread == NULL ) {
+            continue;
+        }
+        handles[ running ] = thread;
+        running += 1;
+    }
+    launch->workers = running;
+
+    /*------------------------------------------------------------------
+    Watch for windows on this thread until every window is done, then
+    let the workers go.
+    ------------------------------------------------------------------*/
+    in_time = TRUE;
+    result  = ERR_WINAPI;
+    if( running > 0 ) {
+        in_time = watch_windows( &block, window_timeout );
+        InterlockedExchange( &( block.stopping ), 1 );
+        ReleaseSemaphore( block.ready, ( LONG ) running, NULL );
+        WaitForMultipleObjects( running, handles, TRUE, INFINITE );
+        for( i = 0; i < running; ++i ) {
+            CloseHandle( handles[ i ] );
+        }
+        result = ( in_time != FALSE ) ? ERR_OK : ERR_TIMEOUT;
+    }
+
+    /*------------------------------------------------------------------
+    Release the scheduling state.  The items belong to the caller.
+    ------------------------------------------------------------------*/
+    DeleteCriticalSection( &( block.lock ) );
+    CloseHandle( block.ready );
+    window_watch_close( &( block.watch ) );
+    if( block.dependents != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) block.dependents );
+    }
+    HeapFree( heap, 0, ( LPVOID ) memory );
+    if( running == 0 ) {
+        launch_sched_free( launch );
+    }
+
+    /*------------------------------------------------------------------
+    Each item holds the result of its own launch.
+    ------------------------------------------------------------------*/
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type build_graph(             /* resolve each window's "after" names  */
+    sched_block_type*   block       /* shared launch state                  */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of windows                    */
+    DWORD               done;       /* windows reached from the roots       */
+    DWORD               i;          /* window index                         */
+    DWORD               k;          /* dependent index                      */
+    LPCTSTR             name;       /* name of an earlier window            */
+    DWORD               other;      /* index of an earlier window           */
+    DWORD               total;      /* number of dependencies               */
+    config_window_type* window;     /* window being resolved                */
+
+    /*------------------------------------------------------------------
+    Count each window's dependents.  Each count is kept one place
+    ahead, so the running sum below leaves each window's first.
+    ------------------------------------------------------------------*/
+    count = block->session->count;
+    total = 0;
+    for( i = 0; i < count; ++i ) {
+        window = &( block->session->windows[ i ] );
+        name   = window->after;
+        for( k = 0; k < window->after_count; ++k ) {
+            other = find_window( block->session, name );
+            if( other == CONFIG_NONE ) {
+                return ERR_NOT_FOUND;
+            }
+            block->first[ other + 1 ] += 1;
+            block->pending[ i ]       += 1;
+            total                     += 1;
+            name                      += _tcslen( name ) + 1;
+        }
+    }
+    for( i = 0; i < count; ++i ) {
+        block->first[ i + 1 ] += block->first[ i ];
+    }
+
+    /*------------------------------------------------------------------
+    Fill in the dependents.  The queue holds each window's next free
+    position for now.
+    ------------------------------------------------------------------*/
+    block->dependents = ( DWORD* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ( total + 1 ) * sizeof( DWORD ) )
+    );
+    if( block->dependents == NULL ) {
+        return ERR_ALLOC;
+    }
+    memcpy( block->queue, block->first, ( count * sizeof( DWORD ) ) );
+    for( i = 0; i < count; ++i ) {
+        window = &( block->session->windows[ i ] );
+        name   = window->after;
+        for( k = 0; k < window->after_count; ++k ) {
+            other = find_window( block->session, name );
+            block->dependents[ block->queue[ other ] ] = i;
+            block->queue[ other ]                     += 1;
+            name += _tcslen( name ) + 1;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Walk the graph from its roots without starting anything.  Windows
+    that can never be reached are waiting on each other.  The pending
+    counts are used up by the walk, and put back afterwards.
+    ------------------------------------------------------------------*/
+    block->tail = 0;
+    for( i = 0; i < count; ++i ) {
+        if( block->pending[ i ] == 0 ) {
+            block->queue[ block->tail ] = i;
+            block->tail += 1;
+        }
+    }
+    for( done = 0; done < block->tail; ++done ) {
+        i = block->queue[ done ];
+        for( k = block->first[ i ]; k < block->first[ i + 1 ]; ++k ) {
+            block->pending[ block->dependents[ k ] ] -= 1;
+            if( block->pending[ block->dependents[ k ] ] == 0 ) {
+                block->queue[ block->tail ] = block->dependents[ k ];
+                block->tail += 1;
+            }
+        }
+    }
+    for( k = 0; k < total; ++k ) {
+        block->pending[ block->dependents[ k ] ] += 1;
+    }
+    block->tail = 0;
+    if( done < count ) {
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD find_window(                  /* find a session window by name        */
+    config_session_type*
+                        session,    /* session to search                    */
+    LPCTSTR             name        /* window name                          */
+) {                                 /* returns index, or CONFIG_NONE        */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* window index                         */
+
+    /*------------------------------------------------------------------
+    Sessions hold few windows, so they are searched in order.  The
+    first window with the name is the one that is meant.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < session->count; ++i ) {
+        if( ( session->windows[ i ].name != NULL )
+         && ( _tcscmp( session->windows[ i ].name, name ) == 0 ) ) {
+            return i;
+        }
+    }
+    return CONFIG_NONE;
+}
+
+
+/*==========================================================================*/
+void finish_entry(                  /* count a window as done               */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               index       /* index of finished window             */
+) {
+
+    /*------------------------------------------------------------------
+    Tell the watching thread when the last window is done.
+    ------------------------------------------------------------------*/
+    InterlockedExchange( &( block->states[ index ] ), ENTRY_DONE );
+    if( InterlockedIncrement( &( block->finished ) )
+        == ( LONG ) block->session->count ) {
+        window_watch_wake( &( block->watch ) );
+    }
+
+}
+
+
+/*==========================================================================*/
+DWORD WINAPI launch_thread(         /* worker thread entry point            */
+    LPVOID              parameter   /* shared launch state                  */
+) {                                 /* returns thread exit code             */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    sched_block_type*   block;      /* shared launch state                  */
+    DWORD               index;      /* index of window being started        */
+    launch_sched_item_type*
+                        item;       /* window's launch results              */
+    error_type          result;     /* result of starting the window        */
+    BOOL                watched;    /* window is handed to the watcher      */
+    config_window_type* window;     /* window being started                 */
+
+    /*------------------------------------------------------------------
+    Start queued windows until told to stop.
+    ------------------------------------------------------------------*/
+    block = ( sched_block_type* ) parameter;
+    for( ; ; ) {
+        WaitForSingleObject( block->ready, INFINITE );
+        if( block->stopping != 0 ) {
+            break;
+        }
+        EnterCriticalSection( &( block->lock ) );
+        index        = block->queue[ block->head ];
+        block->head += 1;
+        LeaveCriticalSection( &( block->lock ) );
+
+        /*--------------------------------------------------------------
+        Start the window's program.
+        --------------------------------------------------------------*/
+        item          = &( block->items[ index ] );
+        window        = &( block->session->windows[ index ] );
+        item->started = GetTickCount();
+
+        /*--------------------------------------------------------------
+        A window whose program is already running is moved into place
+        rather than started again.
+        --------------------------------------------------------------*/
+        if( ( block->existing != NULL )
+         && ( proc_match_claim(
+                block->existing,
+                window,
+                &( item->process_id ),
+                &( item->window )
+            ) == ERR_OK ) ) {
+            item->reused = TRUE;
+            item->shown  = item->started;
+            if( ( block->backend->place != NULL )
+             && ( IsRectEmpty( &( window->rectangle ) ) == FALSE ) ) {
+                item->result = block->backend->place(
+                    block->backend->context,
+                    window,
+                    item
+                );
+            }
+            release_entry( block, index );
+            finish_entry( block, index );
+            continue;
+        }
+        result        = block->backend->start(
+            block->backend->context,
+            window,
+            item
+        );
+        item->result  = result;
+
+        /*--------------------------------------------------------------
+        A started window with a rectangle, or that others wait on, is
+        handed to the watching thread.  Later windows that only need
+        the program started are released now.
+        --------------------------------------------------------------*/
+        watched = ( ( result == ERR_OK ) && ( item->process_id != 0 )
+            && ( ( window->wait != FALSE )
+              || ( ( block->backend->place != NULL )
+                && ( IsRectEmpty( &( window->rectangle ) ) == FALSE ) ) ) );
+        if( ( watched == FALSE ) || ( window->wait == FALSE ) ) {
+            release_entry( block, index );
+        }
+        if( watched != FALSE ) {
+            InterlockedExchange(
+                &( block->states[ index ] ),
+                ENTRY_WAITING
+            );
+            window_watch_wake( &( block->watch ) );
+        }
+        else {
+            finish_entry( block, index );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Exit the thread.
+    ------------------------------------------------------------------*/
+    return 0;
+}
+
+
+/*==========================================================================*/
+void process_close(                 /* close a started process' handle      */
+    LPVOID              context,    /* unused                               */
+    launch_sched_item_type*
+                        item        /* started item                         */
+) {
+
+    /*------------------------------------------------------------------
+    Only the process handle is kept open.
+    ------------------------------------------------------------------*/
+    if( item->process != NULL ) {
+        CloseHandle( item->process );
+        item->process = NULL;
+    }
+
+}
+
+
+/*==========================================================================*/
+error_type process_place(           /* move a window with SetWindowPos      */
+    LPVOID              context,    /* unused                               */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item with the window that appeared   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Move and size the window without changing its order or focus.
+    ------------------------------------------------------------------*/
+    if( SetWindowPos(
+            item->window,
+            NULL,
+            window->rectangle.left,
+            window->rectangle.top,
+            ( window->rectangle.right - window->rectangle.left ),
+            ( window->rectangle.bottom - window->rectangle.top ),
+            ( SWP_NOZORDER | SWP_NOACTIVATE )
+        ) == FALSE ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type process_start(           /* start a window with CreateProcess    */
+    LPVOID              context,    /* unused                               */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item to fill with the process        */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             argument;   /* current argument                     */
+    BOOL                created;    /* the process was created              */
+    LPTSTR              end;        /* end of the command line              */
+    DWORD               i;          /* argument index (0 is the command)    */
+    PROCESS_INFORMATION info;       /* new process' handles                 */
+    SIZE_T              length;     /* length of an expanded argument       */
+    LPTSTR              line;       /* command line                         */
+    SIZE_T              longest;    /* longest expanded argument            */
+    LPTSTR              scratch;    /* where each argument is expanded      */
+    SIZE_T              size;       /* size of command line (characters)    */
+    STARTUPINFO         startup;    /* new process' start-up information    */
+
+    /*------------------------------------------------------------------
+    A window without a program is not started.
+    ------------------------------------------------------------------*/
+    if( window->command == NULL ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Quoting at most doubles each character, and adds two quotes and a
+    separator to each argument.  A compiled window's environment
+    variables are expanded, and its templates give the expanded sizes.
+    ------------------------------------------------------------------*/
+    size     = 0;
+    longest  = 0;
+    argument = window->command;
+    for( i = 0; i <= window->argument_count; ++i ) {
+        length   = ( window->templates != NULL )
+                 ? arg_template_length(
+                     window->templates,
+                     ( window->template + i )
+                 )
+                 : _tcslen( argument );
+        size    += ( 2 * length ) + 3;
+        longest  = ( length > longest ) ? length : longest;
+        argument = ( i == 0 ) ? window->arguments
+                 : ( argument + _tcslen( argument ) + 1 );
+    }
+
+    /*------------------------------------------------------------------
+    One buffer holds the command line, and after it, room to expand
+    the longest argument.
+    ------------------------------------------------------------------*/
+    line = ( LPTSTR ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ( size + longest + 2 ) * sizeof( TCHAR ) )
+    );
+    if( line == NULL ) {
+        return ERR_ALLOC;
+    }
+    scratch = line + size + 1;
+
+    /*------------------------------------------------------------------
+    Build the command line.  Each argument is expanded after the end
+    of the line, then quoted into place.
+    ------------------------------------------------------------------*/
+    end      = line;
+    argument = window->command;
+    for( i = 0; i <= window->argument_count; ++i ) {
+        if( i > 0 ) {
+            *end = _T( ' ' );
+            end += 1;
+        }
+        if( window->templates != NULL ) {
+            arg_template_write(
+                window->templates,
+                ( window->template + i ),
+                scratch
+            );
+        }
+        end      = quote_argument(
+            end,
+            ( ( window->templates != NULL ) ? scratch : argument )
+        );
+        argument = ( i == 0 ) ? window->arguments
+                 : ( argument + _tcslen( argument ) + 1 );
+    }
+    *end = _T( '\0' );
+
+    /*------------------------------------------------------------------
+    Start the program.  Only its process handle is kept.
+    ------------------------------------------------------------------*/
+    memset( &startup, 0, sizeof( STARTUPINFO ) );
+    startup.cb = sizeof( STARTUPINFO );
+    created = CreateProcess(
+        NULL,
+        line,
+        NULL,
+        NULL,
+        FALSE,
+        0,
+        NULL,
+        NULL,
+        &startup,
+        &info
+    );
+    HeapFree( GetProcessHeap(), 0, ( LPVOID ) line );
+    if( created == FALSE ) {
+        return ERR_WINAPI;
+    }
+    CloseHandle( info.hThread );
+    item->process    = info.hProcess;
+    item->process_id = info.dwProcessId;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void queue_entry(                   /* hand a window to the workers         */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               index       /* index of ready window                */
+) {
+
+    /*------------------------------------------------------------------
+    Each window is queued once, so the queue never wraps.
+    ------------------------------------------------------------------*/
+    EnterCriticalSection( &( block->lock ) );
+    block->queue[ block->tail ] = index;
+    block->tail += 1;
+    LeaveCriticalSection( &( block->lock ) );
+    ReleaseSemaphore( block->ready, 1, NULL );
+
+}
+
+
+/*==========================================================================*/
+LPTSTR quote_argument(              /* append one quoted argument           */
+    LPTSTR              target,     /* end of the command line so far       */
+    LPCTSTR             argument    /* argument to append                   */
+) {                                 /* returns new end of the command line  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               slashes;    /* backslashes before this character    */
+
+    /*------------------------------------------------------------------
+    Arguments without spaces or quotes are passed as they are.
+    ------------------------------------------------------------------*/
+    if( ( *argument != _T( '\0' ) )
+     && ( _tcspbrk( argument, _T( " \t\"" ) ) == NULL ) ) {
+        _tcscpy( target, argument );
+        return target + _tcslen( argument );
+    }
+
+    /*------------------------------------------------------------------
+    Otherwise, quote the argument the way the C runtime splits it:
+    backslashes are only special before a quote, so those are doubled,
+    and quotes inside the argument are escaped.
+    ------------------------------------------------------------------*/
+    *target++ = _T( '"' );
+    slashes   = 0;
+    for( ; *argument != _T( '\0' ); ++argument ) {
+        if( *argument == _T( '\\' ) ) {
+            slashes += 1;
+        }
+        else {
+            if( *argument == _T( '"' ) ) {
+                for( slashes += 1; slashes > 0; --slashes ) {
+                    *target++ = _T( '\\' );
+                }
+            }
+            slashes = 0;
+        }
+        *target++ = *argument;
+    }
+    for( ; slashes > 0; --slashes ) {
+        *target++ = _T( '\\' );
+    }
+    *target++ = _T( '"' );
+    return target;
+}
+
+
+/*==========================================================================*/
+void release_entry(                 /* let later windows start              */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               index       /* index of released window             */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               k;          /* dependent index                      */
+
+    /*------------------------------------------------------------------
+    Queue each later window once the last window it waits on is
+    released.
+    ------------------------------------------------------------------*/
+    block->items[ index ].ready = GetTickCount();
+    for( k = block->first[ index ]; k < block->first[ index + 1 ]; ++k ) {
+        if( InterlockedDecrement(
+                &( block->pending[ block->dependents[ k ] ] )
+            ) == 0 ) {
+            queue_entry( block, block->dependents[ k ] );
+        }
+    }
+
+}
+
+
+/*==========================================================================*/
+BOOL watch_windows(                 /* place windows as they appear         */
+    sched_block_type*   block,      /* shared launch state                  */
+    DWORD               window_timeout
+                                    /* limit on each window wait (ms), or   */
+                                    /* INFINITE                             */
+) {                                 /* returns FALSE if a wait timed out    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               elapsed;    /* time a window has been waited on     */
+    HWND                found;      /* window that appeared                 */
+    DWORD               i;          /* window index                         */
+    BOOL                in_time;    /* no wait has timed out                */
+    launch_sched_item_type*
+                        item;       /* window's launch results              */
+    DWORD               now;        /* current tick count                   */
+    error_type          result;     /* result of waiting for a window       */
+    DWORD               tag;        /* index of window that appeared        */
+    DWORD               wait;       /* time until the next deadline         */
+    config_window_type* window;     /* configured window                    */
+
+    /*------------------------------------------------------------------
+    Take over windows from the workers, enforce deadlines, then wait
+    for the next window to appear, or for a worker to hand one over.
+    ------------------------------------------------------------------*/
+    in_time = TRUE;
+    while( block->finished < ( LONG ) block->session->count ) {
+        wait = INFINITE;
+        now  = GetTickCount();
+        for( i = 0; i < block->session->count; ++i ) {
+            item = &( block->items[ i ] );
+            if( block->states[ i ] == ENTRY_WAITING ) {
+                block->states[ i ] = ENTRY_WATCHED;
+                result = window_watch_add(
+                    &( block->watch ),
+                    i,
+                    item->process_id,
+                    item->process,
+                    block->session->windows[ i ].command
+                );
+
+                /*------------------------------------------------------
+                A window that can not be watched is never placed, and
+                must not hold up later windows.
+                ------------------------------------------------------*/
+                if( result != ERR_OK ) {
+                    item->result = result;
+                    if( block->session->windows[ i ].wait != FALSE ) {
+                        release_entry( block, i );
+                    }
+                    finish_entry( block, i );
+                    continue;
+                }
+            }
+            if( ( block->states[ i ] != ENTRY_WATCHED )
+             || ( window_timeout == INFINITE ) ) {
+                continue;
+            }
+
+            /*----------------------------------------------------------
+            A window that never appears stops holding up later windows
+            at its deadline.
+            ----------------------------------------------------------*/
+            elapsed = now - item->started;
+            if( elapsed >= window_timeout ) {
+                window_watch_cancel( &( block->watch ), i );
+                item->result = ERR_TIMEOUT;
+                in_time      = FALSE;
+                if( block->session->windows[ i ].wait != FALSE ) {
+                    release_entry( block, i );
+                }
+                finish_entry( block, i );
+            }
+            else if( wait > ( window_timeout - elapsed ) ) {
+                wait = window_timeout - elapsed;
+            }
+        }
+        if( block->finished >= ( LONG ) block->session->count ) {
+            break;
+        }
+
+        /*--------------------------------------------------------------
+        Place each window the moment it appears.  A window whose
+        process exited without one has nothing to place.
+        --------------------------------------------------------------*/
+        result = window_watch_next( &( block->watch ), wait, &tag, &found );
+        while( result == ERR_OK ) {
+            if( block->states[ tag ] == ENTRY_WATCHED ) {
+                item         = &( block->items[ tag ] );
+                window       = &( block->session->windows[ tag ] );
+                item->window = found;
+                item->shown  = GetTickCount();
+                if( ( found != NULL ) && ( block->backend->place != NULL )
+                 && ( IsRectEmpty( &( window->rectangle ) ) == FALSE ) ) {
+                    item->result = block->backend->place(
+                        block->backend->context,
+                        window,
+                        item
+                    );
+                }
+                if( window->wait != FALSE ) {
+                    release_entry( block, tag );
+                }
+                finish_entry( block, tag );
+            }
+            result = window_watch_next( &( block->watch ), 0, &tag, &found );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Report whether every window appeared in time.
+    ------------------------------------------------------------------*/
+    return in_time;
+}
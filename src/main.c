@@ -10,6 +10,23 @@ Main Program Execution
 Includes
 ----------------------------------------------------------------------------*/
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "config_glob.h"
+#include "config_index.h"
+#include "config_watch.h"
+#include "launch_sched.h"
+#include "monitor_layout.h"
+#include "proc_events.h"
+#include "proc_match.h"
+#include "restore_pipe.h"
+#include "session_journal.h"
+#include "window_layout.h"
+
 /*----------------------------------------------------------------------------
 Macros
 ----------------------------------------------------------------------------*/
@@ -18,6 +35,19 @@ Macros
 Types and Structures
 ----------------------------------------------------------------------------*/
 
+typedef struct restore_s {              /* restore state type               */
+    config_file_type    config;         /* mapped configuration file        */
+    config_glob_type    glob;           /* sorted session name table        */
+    proc_instance_type  instance;       /* process information instance     */
+    BOOL                instance_ready; /* instance has been initialized    */
+    proc_events_type    events;         /* process starts and exits         */
+    BOOL                events_ready;   /* events keep the instance's cache */
+                                        /* current                          */
+    BOOL                resident;       /* state is kept between restores   */
+    config_watch_type   watch;          /* changes to the configuration,    */
+                                        /* and the sessions decoded so far  */
+} restore_type;
+
 /*----------------------------------------------------------------------------
 Memory Constants
 ----------------------------------------------------------------------------*/
@@ -30,6 +60,45 @@ Module Variables
 Module Prototypes
 ----------------------------------------------------------------------------*/
 
+BOOL answer_request(                    /* restore for a pipe client        */
+    LPVOID              context,        /* resident restore state           */
+    LPCTSTR*            arguments,      /* client's arguments               */
+    DWORD               count,          /* number of arguments              */
+    DWORD*              status          /* returned exit status             */
+);                                      /* returns FALSE to stop serving    */
+
+void attach_console(                    /* print to the starting console    */
+    void
+);
+
+int autosave_desktop(                   /* journal the open windows until   */
+                                        /* stopped                          */
+    LPCTSTR             path,           /* path to the journal file         */
+    DWORD               interval        /* time between saves (ms)          */
+);                                      /* returns program exit status      */
+
+error_type load_session(                /* decode (or reuse) a session      */
+    restore_type*       restore,        /* restore state                    */
+    DWORD               index,          /* index of session                 */
+    config_session_type**
+                        session         /* returned session (released by    */
+                                        /* the caller unless resident)      */
+);                                      /* returns error code               */
+
+void print_string(                      /* print text as a JSON string      */
+    LPCTSTR             text            /* text to print                    */
+);
+
+int recover_desktop(                    /* print the last journaled windows */
+    LPCTSTR             path            /* path to the journal file         */
+);                                      /* returns program exit status      */
+
+int restore_sessions(                   /* restore the sessions named       */
+    restore_type*       restore,        /* restore state                    */
+    LPCTSTR*            arguments,      /* options and session patterns     */
+    int                 count_arguments /* number of arguments              */
+);                                      /* returns program exit status      */
+
 /*----------------------------------------------------------------------------
 Implementation
 ----------------------------------------------------------------------------*/
@@ -41,14 +110,745 @@ int main(                               /* program entry point              */
 ) {                                     /* return program exist status      */
 
     /*------------------------------------------------------
-    Comment.
+    Local Variables
+    ------------------------------------------------------*/
+    DWORD               interval;       /* time between autosaves (ms)      */
+    TCHAR               journal[ MAX_PATH ];
+                                        /* autosave journal path            */
+    DWORD               k;              /* monitor index                    */
+    monitor_layout_type monitors;       /* current monitor layout           */
+    TCHAR               path[ MAX_PATH ];
+                                        /* configuration file path          */
+    DWORD               reply;          /* resident restore's exit status   */
+    restore_type        restore;        /* restore state                    */
+    error_type          result;         /* result of internal operation     */
+    int                 status;         /* program exit status              */
+
+    /*------------------------------------------------------
+    Print the current monitors when asked, in the form a
+    session's "monitors" list takes.
+    ------------------------------------------------------*/
+    if( ( argc > 1 ) && ( strcmp( argv[ 1 ], "--monitors" ) == 0 ) ) {
+        attach_console();
+        result = monitor_layout_open( &monitors );
+        if( result != ERR_OK ) {
+            fprintf( stderr, "unable to read monitors (%d)\n", result );
+            return 1;
+        }
+        printf( "[\n" );
+        for( k = 0; k < monitors.count; ++k ) {
+            printf(
+                "  { \"rectangle\": [ %ld, %ld, %ld, %ld ],"
+                " \"work\": [ %ld, %ld, %ld, %ld ], \"dpi\": %lu }%s\n",
+                monitors.monitors[ k ].rectangle.left,
+                monitors.monitors[ k ].rectangle.top,
+                monitors.monitors[ k ].rectangle.right,
+                monitors.monitors[ k ].rectangle.bottom,
+                monitors.monitors[ k ].work.left,
+                monitors.monitors[ k ].work.top,
+                monitors.monitors[ k ].work.right,
+                monitors.monitors[ k ].work.bottom,
+                ( unsigned long ) monitors.monitors[ k ].dpi,
+                ( ( k + 1 ) < monitors.count ) ? "," : ""
+            );
+        }
+        printf( "]\n" );
+        return 0;
+    }
+
+    /*------------------------------------------------------
+    With --autosave, journal the open windows every few
+    seconds (or every number of seconds given).  With
+    --recover, print the windows last journaled.  The
+    journal is kept beside the configuration file.
+    ------------------------------------------------------*/
+    if( ( argc > 1 ) && ( ( strcmp( argv[ 1 ], "--autosave" ) == 0 )
+                       || ( strcmp( argv[ 1 ], "--recover" ) == 0 ) ) ) {
+        if( strcmp( argv[ 1 ], "--recover" ) == 0 ) {
+            attach_console();
+        }
+        result = config_default_path( path, MAX_PATH );
+        if( result == ERR_OK ) {
+            result = session_journal_path( path, journal, MAX_PATH );
+        }
+        if( result != ERR_OK ) {
+            fprintf( stderr, "unable to find journal (%d)\n", result );
+            return 1;
+        }
+        if( strcmp( argv[ 1 ], "--recover" ) == 0 ) {
+            return recover_desktop( journal );
+        }
+        interval = ( argc > 2 )
+                 ? ( DWORD ) strtoul( argv[ 2 ], NULL, 10 ) * 1000
+                 : SESSION_JOURNAL_INTERVAL;
+        return autosave_desktop(
+            journal,
+            ( interval > 0 ) ? interval : SESSION_JOURNAL_INTERVAL
+        );
+    }
+
+    /*------------------------------------------------------
+    Hand a restore (or --stop) to the resident restore when
+    one is running.  Otherwise, restore here.
+    ------------------------------------------------------*/
+    if( ( argc > 1 ) && ( strcmp( argv[ 1 ], "--compile" ) != 0 )
+     && ( strcmp( argv[ 1 ], "--daemon" ) != 0 ) ) {
+        result = restore_pipe_send(
+            ( LPCTSTR* ) ( argv + 1 ),
+            ( argc - 1 ),
+            RESTORE_PIPE_TIMEOUT,
+            &reply
+        );
+        if( result == ERR_OK ) {
+            return ( int ) reply;
+        }
+        if( strcmp( argv[ 1 ], "--stop" ) == 0 ) {
+            fprintf( stderr, "no resident restore to stop (%d)\n", result );
+            return 1;
+        }
+    }
+
+    /*------------------------------------------------------
+    Map and index the user's configuration file.  A
+    resident restore reads it, and watches it for changes,
+    instead.
+    ------------------------------------------------------*/
+    memset( &restore, 0, sizeof( restore_type ) );
+    restore.resident = ( ( argc > 1 )
+                      && ( strcmp( argv[ 1 ], "--daemon" ) == 0 ) )
+                     ? TRUE : FALSE;
+    result = config_default_path( path, MAX_PATH );
+    if( ( result == ERR_OK ) && ( restore.resident != FALSE ) ) {
+        result = config_watch_open(
+            &( restore.watch ),
+            &( restore.config ),
+            path
+        );
+    }
+    else if( result == ERR_OK ) {
+        result = config_open( &( restore.config ), path );
+    }
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to open configuration (%d)\n", result );
+        return 1;
+    }
+
+    /*------------------------------------------------------
+    Compile the configuration into its index when asked.
+    An index that was opened is already up to date.
+    ------------------------------------------------------*/
+    if( ( argc > 1 ) && ( strcmp( argv[ 1 ], "--compile" ) == 0 ) ) {
+        if( restore.config.index == NULL ) {
+            result = config_index_compile( &( restore.config ), path );
+        }
+        config_close( &( restore.config ) );
+        if( result != ERR_OK ) {
+            fprintf( stderr, "unable to compile index (%d)\n", result );
+            return 1;
+        }
+        return 0;
+    }
+
+    /*------------------------------------------------------
+    Sort the session names for selecting them.
+    ------------------------------------------------------*/
+    result = config_glob_init( &( restore.glob ), &( restore.config ) );
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to select sessions (%d)\n", result );
+        config_watch_close( &( restore.watch ) );
+        config_close( &( restore.config ) );
+        return 1;
+    }
+
+    /*------------------------------------------------------
+    With --daemon, stay resident and restore for clients
+    (see restore_pipe.c) until one sends --stop.  The
+    configuration and the process information are kept
+    between restores.  Otherwise, restore once.
+    ------------------------------------------------------*/
+    if( restore.resident != FALSE ) {
+        result = restore_pipe_serve( answer_request, &restore );
+        status = ( result == ERR_OK ) ? 0 : 1;
+        if( result != ERR_OK ) {
+            fprintf( stderr, "unable to stay resident (%d)\n", result );
+        }
+    }
+    else {
+        status = restore_sessions(
+            &restore,
+            ( LPCTSTR* ) ( argv + 1 ),
+            ( argc - 1 )
+        );
+    }
+
+    /*------------------------------------------------------
+    Stop following processes, and release the process
+    information instance.
+    ------------------------------------------------------*/
+    if( restore.events_ready != FALSE ) {
+        proc_events_close( &( restore.events ) );
+    }
+    if( restore.instance_ready != FALSE ) {
+        proc_term( &( restore.instance ) );
+    }
+
+    /*------------------------------------------------------
+    Release the session names, the cached sessions, and
+    the configuration file.
     ------------------------------------------------------*/
-    
+    config_glob_free( &( restore.glob ) );
+    config_watch_close( &( restore.watch ) );
+    config_close( &( restore.config ) );
 
     /*------------------------------------------------------
     Return to the shell.
     ------------------------------------------------------*/
+    return status;
+}
+
+
+/*==========================================================================*/
+BOOL answer_request(                    /* restore for a pipe client        */
+    LPVOID              context,        /* resident restore state           */
+    LPCTSTR*            arguments,      /* client's arguments               */
+    DWORD               count,          /* number of arguments              */
+    DWORD*              status          /* returned exit status             */
+) {                                     /* returns FALSE to stop serving    */
+
+    /*------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------*/
+    restore_type*       restore;        /* resident restore state           */
+    error_type          result;         /* result of reloading              */
+
+    /*------------------------------------------------------
+    A client's --stop ends the resident restore.
+    ------------------------------------------------------*/
+    if( ( count > 0 ) && ( strcmp( arguments[ 0 ], "--stop" ) == 0 ) ) {
+        *status = 0;
+        return FALSE;
+    }
+
+    /*------------------------------------------------------
+    Pick up any changes to the configuration file.  Only
+    the sessions that were edited are decoded again.  A
+    file that can not be read (it may be half written) is
+    tried again next time, and the last one read is used.
+    ------------------------------------------------------*/
+    restore = ( restore_type* ) context;
+    if( config_watch_poll( &( restore->watch ) ) != FALSE ) {
+        result = config_watch_reload(
+            &( restore->watch ),
+            &( restore->config )
+        );
+        if( result == ERR_OK ) {
+            config_glob_free( &( restore->glob ) );
+            result = config_glob_init(
+                &( restore->glob ),
+                &( restore->config )
+            );
+        }
+        if( result != ERR_OK ) {
+            fprintf(
+                stderr,
+                "unable to reload configuration (%d)\n",
+                result
+            );
+        }
+    }
+
+    /*------------------------------------------------------
+    Anything else is restored like a command line.
+    ------------------------------------------------------*/
+    *status = ( DWORD ) restore_sessions( restore, arguments, ( int ) count );
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+void attach_console(                    /* print to the starting console    */
+    void
+) {
+
+    /*------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------*/
+    HANDLE              error;          /* standard error, before attaching */
+    HANDLE              output;         /* standard output, before          */
+                                        /* attaching                        */
+
+    /*------------------------------------------------------
+    The program is built for the desktop, so it has no
+    console of its own.  Output that is not redirected
+    goes to the console it was started from, if any.  The
+    shell does not wait for the program, so it may print
+    its prompt first.  Only commands that print and exit
+    use this: a resident copy attached to a console would
+    be ended when that console is closed.
+    ------------------------------------------------------*/
+    output = GetStdHandle( STD_OUTPUT_HANDLE );
+    error  = GetStdHandle( STD_ERROR_HANDLE );
+    if( AttachConsole( ATTACH_PARENT_PROCESS ) == FALSE ) {
+        return;
+    }
+    if( ( output == NULL ) || ( output == INVALID_HANDLE_VALUE ) ) {
+        freopen( "CONOUT$", "w", stdout );
+    }
+    if( ( error == NULL ) || ( error == INVALID_HANDLE_VALUE ) ) {
+        freopen( "CONOUT$", "w", stderr );
+    }
+
+}
+
+
+/*==========================================================================*/
+int autosave_desktop(                   /* journal the open windows until   */
+                                        /* stopped                          */
+    LPCTSTR             path,           /* path to the journal file         */
+    DWORD               interval        /* time between saves (ms)          */
+) {                                     /* returns program exit status      */
+
+    /*------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------*/
+    session_journal_state_type
+                        desktop;        /* windows open now                 */
+    proc_events_type    events;         /* process starts and exits         */
+    BOOL                events_ready;   /* events keep the cache current    */
+    proc_instance_type  instance;       /* process information instance     */
+    session_journal_type
+                        journal;        /* open autosave journal            */
+    error_type          result;         /* result of internal operation     */
+    proc_match_type     running;        /* processes that own windows       */
+
+    /*------------------------------------------------------
+    Open the journal, and the process information.
+    ------------------------------------------------------*/
+    result = session_journal_open( &journal, path );
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to open journal (%d)\n", result );
+        return 1;
+    }
+    result = proc_init( &instance );
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to read processes (%d)\n", result );
+        session_journal_close( &journal );
+        return 1;
+    }
+
+    /*------------------------------------------------------
+    Follow processes as they start and exit, so the process
+    table is not read on every save.  Without the rights to
+    trace them, it is read each time instead.
+    ------------------------------------------------------*/
+    events_ready = ( proc_events_open( &events, &instance ) == ERR_OK )
+                 ? TRUE : FALSE;
+
+    /*------------------------------------------------------
+    Save the windows of each running program, with its
+    command, until the process is ended.  Only what changed
+    since the last save is written, so a desktop where
+    nothing moves costs next to nothing.  What was read
+    from processes that are still running is kept between
+    saves.  A save that fails is tried again next time.
+    ------------------------------------------------------*/
+    memset( &desktop, 0, sizeof( session_journal_state_type ) );
+    for( ; ; ) {
+        if( events_ready != FALSE ) {
+            proc_events_apply( &events );
+        }
+        result = proc_match_build(
+            &instance,
+            PROC_MATCH_TIMEOUT,
+            FALSE,
+            TRUE,
+            &running
+        );
+        if( result == ERR_OK ) {
+            result = session_journal_capture( &running, &desktop );
+            proc_match_free( &running );
+        }
+        if( result == ERR_OK ) {
+            result = session_journal_save( &journal, &desktop );
+        }
+        if( result != ERR_OK ) {
+            fprintf( stderr, "unable to autosave (%d)\n", result );
+        }
+        Sleep( interval );
+    }
+
+    /*------------------------------------------------------
+    Not reached: the journal is closed when the process is
+    ended, and every entry is already on the disk.
+    ------------------------------------------------------*/
+}
+
+
+/*==========================================================================*/
+error_type load_session(                /* decode (or reuse) a session      */
+    restore_type*       restore,        /* restore state                    */
+    DWORD               index,          /* index of session                 */
+    config_session_type**
+                        session         /* returned session (released by    */
+                                        /* the caller unless resident)      */
+) {                                     /* returns error code               */
+
+    /*------------------------------------------------------
+    A resident restore keeps the sessions it decodes until
+    they are edited.  Otherwise, each is decoded for this
+    restore alone.
+    ------------------------------------------------------*/
+    if( restore->resident != FALSE ) {
+        return config_watch_load(
+            &( restore->watch ),
+            &( restore->config ),
+            index,
+            session
+        );
+    }
+    return config_load( &( restore->config ), index, session );
+}
+
+
+/*==========================================================================*/
+void print_string(                      /* print text as a JSON string      */
+    LPCTSTR             text            /* text to print                    */
+) {
+
+    /*------------------------------------------------------
+    Escape quotes, backslashes, and control characters.
+    ------------------------------------------------------*/
+    putchar( '"' );
+    for( ; *text != _T( '\0' ); ++text ) {
+        if( ( *text == _T( '"' ) ) || ( *text == _T( '\\' ) ) ) {
+            printf( "\\%c", ( char ) *text );
+        }
+        else if( ( ( unsigned ) *text ) < 0x20 ) {
+            printf( "\\u%04x", ( unsigned ) *text );
+        }
+        else {
+            putchar( *text );
+        }
+    }
+    putchar( '"' );
+
+}
+
+
+/*==========================================================================*/
+int recover_desktop(                    /* print the last journaled windows */
+    LPCTSTR             path            /* path to the journal file         */
+) {                                     /* returns program exit status      */
+
+    /*------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------*/
+    LPCTSTR             argument;       /* current argument                 */
+    session_journal_state_type
+                        desktop;        /* windows last journaled           */
+    DWORD               j;              /* window index                     */
+    error_type          result;         /* result of replaying the journal  */
+    const char*         separator;      /* text before the next argument    */
+    session_journal_window_type*
+                        window;         /* current window                   */
+
+    /*------------------------------------------------------
+    Replay the journal up to its last intact entry.
+    ------------------------------------------------------*/
+    result = session_journal_recover( path, &desktop );
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to recover journal (%d)\n", result );
+        return 1;
+    }
+
+    /*------------------------------------------------------
+    Print the windows in the form a session's "windows"
+    list takes, so they can be pasted into one.
+    ------------------------------------------------------*/
+    printf( "[\n" );
+    for( j = 0; j < desktop.count; ++j ) {
+        window = &( desktop.windows[ j ] );
+        printf( "  { \"command\": " );
+        print_string( window->text );
+        printf( ", \"arguments\": [" );
+        separator = " ";
+        argument  = window->text + _tcslen( window->text ) + 1;
+        while( *argument != _T( '\0' ) ) {
+            printf( "%s", separator );
+            print_string( argument );
+            separator = ", ";
+            argument += _tcslen( argument ) + 1;
+        }
+        printf(
+            " ],\n    \"rectangle\": [ %ld, %ld, %ld, %ld ] }%s\n",
+            window->rectangle.left,
+            window->rectangle.top,
+            window->rectangle.right,
+            window->rectangle.bottom,
+            ( ( j + 1 ) < desktop.count ) ? "," : ""
+        );
+    }
+    printf( "]\n" );
+    session_journal_free( &desktop );
     return 0;
 }
 
 
+/*==========================================================================*/
+int restore_sessions(                   /* restore the sessions named       */
+    restore_type*       restore,        /* restore state                    */
+    LPCTSTR*            arguments,      /* options and session patterns     */
+    int                 count_arguments /* number of arguments              */
+) {                                     /* returns program exit status      */
+
+    /*------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------*/
+    DWORD               count;          /* number of selected sessions      */
+    int                 first;          /* first session pattern argument   */
+    int                 i;              /* argument index                   */
+    DWORD*              indices;        /* selected sessions                */
+    DWORD               j;              /* selected session index           */
+    DWORD               k;              /* launched window index            */
+    launch_sched_type   launch;         /* session's launched windows       */
+    window_layout_type  layout;         /* open windows that were moved     */
+    BOOL                layout_only;    /* only move open windows           */
+    DWORD               loaded;         /* number of sessions decoded       */
+    BOOL*               matched;        /* arguments that matched sessions  */
+    monitor_layout_type monitors;       /* current monitor layout           */
+    BOOL                monitors_ready; /* current layout has been read     */
+    error_type          result;         /* result of loading a session      */
+    proc_match_type*    reuse;          /* running processes to reuse, or   */
+                                        /* NULL                             */
+    proc_match_type     running;        /* processes that own windows       */
+    config_session_type*
+                        session;        /* decoded session                  */
+    config_session_type**
+                        sessions;       /* decoded sessions to lay out      */
+    int                 status;         /* program exit status              */
+
+    /*------------------------------------------------------
+    With --layout-only, nothing is launched.  The windows
+    that are already open are moved into place instead.
+    ------------------------------------------------------*/
+    layout_only = ( ( count_arguments > 0 )
+                 && ( strcmp( arguments[ 0 ], "--layout-only" ) == 0 ) )
+                ? TRUE : FALSE;
+    first       = ( layout_only != FALSE ) ? 1 : 0;
+
+    /*------------------------------------------------------
+    Select the sessions named (or globbed) on the command
+    line.  Each session is selected once, in the order of
+    the first pattern that names it.
+    ------------------------------------------------------*/
+    indices = ( DWORD* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ( restore->glob.count + 1 ) * sizeof( DWORD ) )
+    );
+    matched = ( BOOL* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ( count_arguments + 1 ) * sizeof( BOOL ) )
+    );
+    result  = ( ( indices == NULL ) || ( matched == NULL ) )
+            ? ERR_ALLOC : config_glob_match(
+                &( restore->glob ),
+                ( arguments + first ),
+                ( count_arguments - first ),
+                indices,
+                &count,
+                matched
+            );
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to select sessions (%d)\n", result );
+        count = 0;
+    }
+    status = ( result == ERR_OK ) ? 0 : 1;
+    for( i = first; ( result == ERR_OK ) && ( i < count_arguments ); ++i ) {
+        if( matched[ i - first ] == FALSE ) {
+            fprintf( stderr, "unknown session: %s\n", arguments[ i ] );
+            status = 1;
+        }
+    }
+
+    /*------------------------------------------------------
+    Index the programs that are already running, so their
+    windows are moved into place rather than started a
+    second time.  Without the index, every window starts.
+    Laying out also needs the windows' titles.  A resident
+    restore keeps what it read from processes that are
+    still running, and follows processes as they start and
+    exit (when it has the rights to trace them), rather
+    than reading the process table for each restore.
+    ------------------------------------------------------*/
+    reuse = NULL;
+    if( ( count > 0 ) && ( restore->instance_ready == FALSE ) ) {
+        restore->instance_ready
+            = ( proc_init( &( restore->instance ) ) == ERR_OK )
+            ? TRUE : FALSE;
+        restore->events_ready
+            = ( ( restore->resident != FALSE )
+             && ( restore->instance_ready != FALSE )
+             && ( proc_events_open(
+                    &( restore->events ),
+                    &( restore->instance )
+                ) == ERR_OK ) )
+            ? TRUE : FALSE;
+    }
+    if( ( count > 0 ) && ( restore->events_ready != FALSE ) ) {
+        proc_events_apply( &( restore->events ) );
+    }
+    if( ( count > 0 ) && ( restore->instance_ready != FALSE )
+     && ( proc_match_build(
+            &( restore->instance ),
+            PROC_MATCH_TIMEOUT,
+            layout_only,
+            restore->resident,
+            &running
+        ) == ERR_OK ) ) {
+        reuse = &running;
+    }
+
+    /*------------------------------------------------------
+    Read the current monitors, so rectangles captured on
+    other monitors are moved onto these.  Without them,
+    rectangles are used as configured.
+    ------------------------------------------------------*/
+    monitors_ready = ( ( count > 0 )
+                    && ( monitor_layout_open( &monitors ) == ERR_OK ) )
+                   ? TRUE : FALSE;
+
+    /*------------------------------------------------------
+    Lay out every selected session in one pass, so each
+    open window is assigned once, and all of them move
+    together.
+    ------------------------------------------------------*/
+    if( ( layout_only != FALSE ) && ( count > 0 ) ) {
+        sessions = ( config_session_type** ) HeapAlloc(
+            GetProcessHeap(),
+            0,
+            ( count * sizeof( config_session_type* ) )
+        );
+        loaded   = 0;
+        for( j = 0; ( sessions != NULL ) && ( j < count ); ++j ) {
+            result = load_session( restore, indices[ j ], &session );
+            if( result != ERR_OK ) {
+                fprintf(
+                    stderr,
+                    "unable to load session %lu (%d)\n",
+                    ( unsigned long ) indices[ j ],
+                    result
+                );
+                status = 1;
+                continue;
+            }
+            sessions[ loaded ] = session;
+            loaded            += 1;
+        }
+        if( ( sessions != NULL ) && ( monitors_ready != FALSE ) ) {
+            monitor_layout_remap( &monitors, sessions, loaded );
+        }
+        result = ( sessions == NULL ) ? ERR_ALLOC
+               : ( reuse == NULL ) ? ERR_NOT_FOUND
+               : window_layout_run( sessions, loaded, reuse, &layout );
+        if( result != ERR_OK ) {
+            fprintf( stderr, "unable to lay out windows (%d)\n", result );
+            status = 1;
+        }
+        for( k = 0; ( result == ERR_OK ) && ( k < layout.count ); ++k ) {
+            if( layout.items[ k ].result != ERR_OK ) {
+                fprintf(
+                    stderr,
+                    "unable to lay out window %lu of %s (%d)\n",
+                    ( unsigned long ) layout.items[ k ].index,
+                    layout.items[ k ].session->name,
+                    layout.items[ k ].result
+                );
+                status = 1;
+            }
+        }
+        if( result == ERR_OK ) {
+            window_layout_free( &layout );
+        }
+        for( j = 0; ( restore->resident == FALSE ) && ( j < loaded ); ++j ) {
+            config_free_session( sessions[ j ] );
+        }
+        if( sessions != NULL ) {
+            HeapFree( GetProcessHeap(), 0, ( LPVOID ) sessions );
+        }
+        count = 0;
+    }
+
+    /*------------------------------------------------------
+    Decode and launch each selected session.  Only these
+    sessions are ever decoded.
+    ------------------------------------------------------*/
+    for( j = 0; j < count; ++j ) {
+        result = load_session( restore, indices[ j ], &session );
+        if( result != ERR_OK ) {
+            fprintf(
+                stderr,
+                "unable to load session %lu (%d)\n",
+                ( unsigned long ) indices[ j ],
+                result
+            );
+            status = 1;
+            continue;
+        }
+        if( monitors_ready != FALSE ) {
+            monitor_layout_remap( &monitors, &session, 1 );
+        }
+        result = launch_sched_run(
+            session,
+            NULL,
+            reuse,
+            0,
+            LAUNCH_SCHED_TIMEOUT,
+            &launch
+        );
+        if( ( result != ERR_OK ) && ( result != ERR_TIMEOUT ) ) {
+            fprintf(
+                stderr,
+                "unable to launch session %s (%d)\n",
+                session->name,
+                result
+            );
+            status = 1;
+        }
+        for( k = 0; k < launch.count; ++k ) {
+            if( launch.items[ k ].result != ERR_OK ) {
+                fprintf(
+                    stderr,
+                    "unable to launch window %lu of %s (%d)\n",
+                    ( unsigned long ) k,
+                    session->name,
+                    launch.items[ k ].result
+                );
+                status = 1;
+            }
+        }
+        launch_sched_free( &launch );
+        if( restore->resident == FALSE ) {
+            config_free_session( session );
+        }
+    }
+
+    /*------------------------------------------------------
+    Release the running process index.
+    ------------------------------------------------------*/
+    if( reuse != NULL ) {
+        proc_match_free( reuse );
+    }
+
+    /*------------------------------------------------------
+    Release the selection.
+    ------------------------------------------------------*/
+    if( matched != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) matched );
+    }
+    if( indices != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) indices );
+    }
+    return status;
+}
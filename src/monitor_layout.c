@@ -0,0 +1,843 @@
+/*****************************************************************************
+
+monitor_layout.c
+
+Monitor Layout Remapping
+
+Configured rectangles are in desktop coordinates, so a session captured on
+one set of monitors can land off the screen on another.  A session may
+record the monitors it was captured on (its profile), and before a session
+is launched every rectangle is moved from the captured profile onto the
+current one:
+
+    1. Each captured monitor is paired with a current monitor: the one with
+       the same rectangle, else one of the same size, else the one it
+       overlaps most, else the primary monitor.
+    2. A rectangle belongs to the captured monitor it overlaps most.  Its
+       position keeps its proportion within the work area, and its size
+       keeps its physical size (it is scaled by the ratio of the DPIs).
+    3. The result is clamped to the target work area, shrinking it if it
+       is too big.
+
+A monitor that did not change leaves its rectangles alone, so a session
+restored on the profile it was captured on is not touched.  A session
+without a profile is treated as captured on the current monitors, so only
+rectangles that are off every monitor are moved (onto the nearest one).
+
+Pairing the monitors is done once per pair of profiles, and the remap table
+is cached in the layout object.  The rectangles of every session passed in
+are gathered into flat arrays and remapped in one branch-free pass.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "monitor_layout.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define LAYOUT_FNV_BASIS    ( 2166136261UL )
+                                    /* FNV-1a offset basis                  */
+#define LAYOUT_FNV_PRIME    ( 16777619UL )
+                                    /* FNV-1a prime                         */
+
+#define LAYOUT_MIN_TRANSFORMS ( 16 )
+                                    /* fewest transforms gathered per call  */
+
+#define LAYOUT_UNBOUNDED    ( 0x20000000L )
+                                    /* limit that never clamps, and can not */
+                                    /* overflow when sizes are subtracted   */
+
+#define LAYOUT_EFFECTIVE_DPI ( 0 )  /* MDT_EFFECTIVE_DPI                    */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef HRESULT ( WINAPI *layout_GetDpiForMonitor_fun ) (
+                                    /* pointer to shell DPI query function  */
+    HMONITOR            hmonitor,   /* monitor to query                     */
+    int                 dpiType,    /* kind of DPI                          */
+    UINT*               dpiX,       /* returned horizontal DPI              */
+    UINT*               dpiY        /* returned vertical DPI                */
+);                                  /* returns S_OK on success              */
+
+typedef struct layout_reader_s {    /* monitor enumeration state type       */
+    DWORD               count;      /* number of monitors read              */
+    config_monitor_type monitors[ MONITOR_LAYOUT_LIMIT ];
+                                    /* monitors read, primary first         */
+    layout_GetDpiForMonitor_fun
+                        get_dpi;    /* per-monitor DPI query, or NULL       */
+    DWORD               system_dpi; /* DPI used without the query           */
+} layout_reader_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+void build_map(                     /* pair a captured profile's monitors   */
+                                    /* with the current ones                */
+    monitor_layout_type*
+                        layout,     /* current monitor layout               */
+    monitor_map_type*   map         /* table holding the captured profile   */
+);
+
+DWORD classify_rectangle(           /* find the monitor a rectangle is on   */
+    const monitor_map_type*
+                        map,        /* remap table                          */
+    const RECT*         rectangle,  /* configured rectangle                 */
+    BOOL*               outside     /* returned TRUE if it is off every     */
+                                    /* monitor                              */
+);                                  /* returns captured monitor index       */
+
+monitor_map_type* find_map(         /* get the remap table for a profile    */
+    monitor_layout_type*
+                        layout,     /* current monitor layout               */
+    const config_monitor_type*
+                        monitors,   /* captured profile                     */
+    DWORD               count       /* number of captured monitors          */
+);                                  /* returns cached or new table          */
+
+LONGLONG overlap_area(              /* measure two rectangles' overlap      */
+    const RECT*         a,          /* first rectangle                      */
+    const RECT*         b           /* second rectangle                     */
+);                                  /* returns area (0 if they do not       */
+                                    /* overlap)                             */
+
+BOOL CALLBACK read_monitor(         /* add a display monitor to a reader    */
+    HMONITOR            monitor,    /* enumerated monitor                   */
+    HDC                 context,    /* unused                               */
+    LPRECT              rectangle,  /* unused                               */
+    LPARAM              parameter   /* monitor reader                       */
+);                                  /* returns TRUE to keep enumerating     */
+
+void remap_batch(                   /* remap gathered rectangles            */
+    const monitor_transform_type*
+                        transforms, /* gathered transforms                  */
+    const DWORD*        slots,      /* each rectangle's transform and limit */
+    LONG*               lefts,      /* rectangle edges (changed in place)   */
+    LONG*               tops,
+    LONG*               rights,
+    LONG*               bottoms,
+    DWORD               count       /* number of rectangles                 */
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+DWORD monitor_layout_hash(          /* hash a monitor profile               */
+    const config_monitor_type*
+                        monitors,   /* monitors in the profile              */
+    DWORD               count       /* number of monitors                   */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const BYTE*         data;       /* profile bytes                        */
+    DWORD               hash;       /* running hash                         */
+    SIZE_T              i;          /* byte index                           */
+    SIZE_T              size;       /* size of the profile (bytes)          */
+
+    /*------------------------------------------------------------------
+    Monitors have no padding, so their bytes are the profile.
+    ------------------------------------------------------------------*/
+    data = ( const BYTE* ) monitors;
+    size = count * sizeof( config_monitor_type );
+    hash = LAYOUT_FNV_BASIS;
+    for( i = 0; ( data != NULL ) && ( i < size ); ++i ) {
+        hash ^= data[ i ];
+        hash *= LAYOUT_FNV_PRIME;
+    }
+    return hash;
+}
+
+
+/*==========================================================================*/
+error_type monitor_layout_open(     /* read the current monitor layout      */
+    monitor_layout_type*
+                        layout      /* layout object to initialize          */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HDC                 context;    /* screen device context                */
+    layout_reader_type  reader;     /* monitor enumeration state            */
+    HINSTANCE           shcore;     /* link to shell scaling library        */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( layout == NULL ) {
+        return ERR_USAGE;
+    }
+    memset( &reader, 0, sizeof( layout_reader_type ) );
+
+    /*------------------------------------------------------------------
+    Each monitor has its own DPI since Windows 8.1.  Before that, every
+    monitor uses the system DPI.
+    ------------------------------------------------------------------*/
+    reader.system_dpi = MONITOR_LAYOUT_DPI;
+    context           = GetDC( NULL );
+    if( context != NULL ) {
+        reader.system_dpi = ( DWORD ) GetDeviceCaps( context, LOGPIXELSX );
+        ReleaseDC( NULL, context );
+    }
+    shcore = LoadLibrary( _T( "Shcore.dll" ) );
+    if( shcore != NULL ) {
+        reader.get_dpi = ( layout_GetDpiForMonitor_fun ) GetProcAddress(
+            shcore,
+            "GetDpiForMonitor"
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Read every monitor, then release the library.
+    ------------------------------------------------------------------*/
+    EnumDisplayMonitors( NULL, NULL, read_monitor, ( LPARAM ) &reader );
+    if( shcore != NULL ) {
+        FreeLibrary( shcore );
+    }
+    if( reader.count == 0 ) {
+        memset( layout, 0, sizeof( monitor_layout_type ) );
+        return ERR_WINAPI;
+    }
+    return monitor_layout_set( layout, reader.monitors, reader.count );
+}
+
+
+/*==========================================================================*/
+error_type monitor_layout_remap(    /* move sessions' rectangles onto the   */
+                                    /* current monitors                     */
+    monitor_layout_type*
+                        layout,     /* current monitor layout               */
+    config_session_type**
+                        sessions,   /* decoded sessions (changed in place)  */
+    DWORD               count       /* number of sessions                   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG*               bottoms;    /* gathered bottom edges                */
+    DWORD               capacity;   /* number of transforms allocated       */
+    DWORD               gathered;   /* number of rectangles gathered        */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* session or rectangle index           */
+    DWORD               j;          /* window or transform index            */
+    LONG*               lefts;      /* gathered left edges                  */
+    monitor_map_type*   map;        /* session's remap table                */
+    DWORD               monitor;    /* captured monitor of a rectangle      */
+    const config_monitor_type*
+                        monitors;   /* session's captured profile           */
+    DWORD               monitor_count;
+                                    /* number of captured monitors          */
+    BOOL                outside;    /* rectangle is off every monitor       */
+    const RECT*         rectangle;  /* configured rectangle                 */
+    LPVOID              resized;    /* reallocated transforms               */
+    LONG*               rights;     /* gathered right edges                 */
+    DWORD*              slots;      /* each rectangle's transform and limit */
+    RECT**              targets;    /* where each rectangle goes back       */
+    LONG*               tops;       /* gathered top edges                   */
+    DWORD               total;      /* number of configured windows         */
+    monitor_transform_type*
+                        transforms; /* transforms gathered for this call    */
+    DWORD               used;       /* number of transforms gathered        */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( layout == NULL ) || ( layout->count == 0 )
+     || ( ( sessions == NULL ) && ( count > 0 ) ) ) {
+        return ERR_USAGE;
+    }
+    total = 0;
+    for( i = 0; i < count; ++i ) {
+        total += sessions[ i ]->count;
+    }
+    if( total == 0 ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate the flat arrays for every rectangle at once.
+    ------------------------------------------------------------------*/
+    heap    = GetProcessHeap();
+    targets = ( RECT** ) HeapAlloc(
+        heap,
+        0,
+        ( total * ( sizeof( RECT* ) + sizeof( DWORD )
+                    + ( 4 * sizeof( LONG ) ) ) )
+    );
+    if( targets == NULL ) {
+        return ERR_ALLOC;
+    }
+    slots      = ( DWORD* ) ( targets + total );
+    lefts      = ( LONG* ) ( slots + total );
+    tops       = lefts + total;
+    rights     = tops + total;
+    bottoms    = rights + total;
+    transforms = NULL;
+    capacity   = 0;
+    used       = 0;
+    gathered   = 0;
+
+    /*------------------------------------------------------------------
+    Gather the rectangles that may move, and the transforms of each
+    profile they were captured on.  Each table's transforms are
+    gathered once per call.
+    ------------------------------------------------------------------*/
+    layout->stamp += 1;
+    for( i = 0; i < count; ++i ) {
+        monitors      = sessions[ i ]->monitors;
+        monitor_count = sessions[ i ]->monitor_count;
+        if( ( monitors == NULL ) || ( monitor_count == 0 ) ) {
+            monitors      = layout->monitors;
+            monitor_count = layout->count;
+        }
+        if( monitor_count > MONITOR_LAYOUT_LIMIT ) {
+            monitor_count = MONITOR_LAYOUT_LIMIT;
+        }
+        map = find_map( layout, monitors, monitor_count );
+        if( map->stamp != layout->stamp ) {
+            if( ( used + map->count ) > capacity ) {
+                capacity = ( capacity == 0 )
+                         ? LAYOUT_MIN_TRANSFORMS : ( 2 * capacity );
+                while( capacity < ( used + map->count ) ) {
+                    capacity *= 2;
+                }
+                resized = ( transforms == NULL )
+                    ? HeapAlloc(
+                        heap,
+                        0,
+                        ( capacity * sizeof( monitor_transform_type ) )
+                    )
+                    : HeapReAlloc(
+                        heap,
+                        0,
+                        ( LPVOID ) transforms,
+                        ( capacity * sizeof( monitor_transform_type ) )
+                    );
+                if( resized == NULL ) {
+                    if( transforms != NULL ) {
+                        HeapFree( heap, 0, ( LPVOID ) transforms );
+                    }
+                    HeapFree( heap, 0, ( LPVOID ) targets );
+                    return ERR_ALLOC;
+                }
+                transforms = ( monitor_transform_type* ) resized;
+            }
+            memcpy(
+                &( transforms[ used ] ),
+                map->transforms,
+                ( map->count * sizeof( monitor_transform_type ) )
+            );
+            map->stamp = layout->stamp;
+            map->base  = used;
+            used      += map->count;
+        }
+
+        /*--------------------------------------------------------------
+        When the profiles are the same, only rectangles that are off
+        every monitor move.
+        --------------------------------------------------------------*/
+        for( j = 0; j < sessions[ i ]->count; ++j ) {
+            rectangle = &( sessions[ i ]->windows[ j ].rectangle );
+            if( IsRectEmpty( rectangle ) != FALSE ) {
+                continue;
+            }
+            monitor = classify_rectangle( map, rectangle, &outside );
+            if( ( map->identity != FALSE ) && ( outside == FALSE ) ) {
+                continue;
+            }
+            targets[ gathered ] = &( sessions[ i ]->windows[ j ].rectangle );
+            slots[ gathered ]   = ( ( map->base + monitor ) << 1 )
+                                | ( ( outside != FALSE ) ? 1 : 0 );
+            lefts[ gathered ]   = rectangle->left;
+            tops[ gathered ]    = rectangle->top;
+            rights[ gathered ]  = rectangle->right;
+            bottoms[ gathered ] = rectangle->bottom;
+            gathered += 1;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Remap every gathered rectangle in one pass, and store them back.
+    ------------------------------------------------------------------*/
+    remap_batch( transforms, slots, lefts, tops, rights, bottoms, gathered );
+    for( i = 0; i < gathered; ++i ) {
+        targets[ i ]->left   = lefts[ i ];
+        targets[ i ]->top    = tops[ i ];
+        targets[ i ]->right  = rights[ i ];
+        targets[ i ]->bottom = bottoms[ i ];
+    }
+
+    /*------------------------------------------------------------------
+    Release the arrays, and return success.
+    ------------------------------------------------------------------*/
+    if( transforms != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) transforms );
+    }
+    HeapFree( heap, 0, ( LPVOID ) targets );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type monitor_layout_set(      /* use a given current monitor layout   */
+    monitor_layout_type*
+                        layout,     /* layout object to initialize          */
+    const config_monitor_type*
+                        monitors,   /* current monitors, primary first      */
+    DWORD               count       /* number of monitors                   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( layout == NULL ) || ( monitors == NULL ) || ( count == 0 ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Start with an empty cache.  Tables are keyed by both profiles, so
+    none could be reused anyway.
+    ------------------------------------------------------------------*/
+    memset( layout, 0, sizeof( monitor_layout_type ) );
+    layout->count = ( count > MONITOR_LAYOUT_LIMIT )
+                  ? MONITOR_LAYOUT_LIMIT : count;
+    memcpy(
+        layout->monitors,
+        monitors,
+        ( layout->count * sizeof( config_monitor_type ) )
+    );
+    layout->hash = monitor_layout_hash( layout->monitors, layout->count );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void build_map(                     /* pair a captured profile's monitors   */
+                                    /* with the current ones                */
+    monitor_layout_type*
+                        layout,     /* current monitor layout               */
+    monitor_map_type*   map         /* table holding the captured profile   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONGLONG            area;       /* overlap with a current monitor       */
+    RECT                areas[ MONITOR_LAYOUT_LIMIT ];
+                                    /* where each captured work area goes   */
+    LONGLONG            best_area;  /* largest overlap so far               */
+    const config_monitor_type*
+                        captured;   /* captured monitor                     */
+    DWORD               i;          /* captured monitor index               */
+    DWORD               k;          /* current monitor index                */
+    DWORD               pairs[ MONITOR_LAYOUT_LIMIT ];
+                                    /* current monitor of each captured one */
+    BOOL                taken[ MONITOR_LAYOUT_LIMIT ];
+                                    /* current monitor is already paired    */
+    const config_monitor_type*
+                        target;     /* current monitor                      */
+    monitor_transform_type*
+                        transform;  /* transform being built                */
+
+    /*------------------------------------------------------------------
+    Pair the monitors that did not move, then the ones that moved but
+    kept their size.
+    ------------------------------------------------------------------*/
+    memset( taken, 0, sizeof( taken ) );
+    for( i = 0; i < map->count; ++i ) {
+        pairs[ i ] = MONITOR_LAYOUT_LIMIT;
+        for( k = 0; k < layout->count; ++k ) {
+            if( ( taken[ k ] == FALSE )
+             && ( EqualRect( &( map->monitors[ i ].rectangle ),
+                             &( layout->monitors[ k ].rectangle ) )
+                  != FALSE ) ) {
+                pairs[ i ] = k;
+                taken[ k ] = TRUE;
+                break;
+            }
+        }
+    }
+    for( i = 0; i < map->count; ++i ) {
+        captured = &( map->monitors[ i ] );
+        for( k = 0; ( pairs[ i ] == MONITOR_LAYOUT_LIMIT )
+                 && ( k < layout->count ); ++k ) {
+            target = &( layout->monitors[ k ] );
+            if( ( taken[ k ] == FALSE )
+             && ( ( captured->rectangle.right - captured->rectangle.left )
+                  == ( target->rectangle.right - target->rectangle.left ) )
+             && ( ( captured->rectangle.bottom - captured->rectangle.top )
+                  == ( target->rectangle.bottom - target->rectangle.top ) ) ) {
+                pairs[ i ] = k;
+                taken[ k ] = TRUE;
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    A monitor that is gone goes to the current monitor it overlaps
+    most, or else the primary monitor.  When it overlaps one, its work
+    area goes to the part of it that is still there, so windows on a
+    monitor that is now part of a larger one stay where they were.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < map->count; ++i ) {
+        if( pairs[ i ] != MONITOR_LAYOUT_LIMIT ) {
+            areas[ i ] = layout->monitors[ pairs[ i ] ].work;
+            continue;
+        }
+        pairs[ i ] = 0;
+        best_area  = 0;
+        for( k = 0; k < layout->count; ++k ) {
+            area = overlap_area(
+                &( map->monitors[ i ].rectangle ),
+                &( layout->monitors[ k ].rectangle )
+            );
+            if( area > best_area ) {
+                best_area  = area;
+                pairs[ i ] = k;
+            }
+        }
+        captured   = &( map->monitors[ i ] );
+        target     = &( layout->monitors[ pairs[ i ] ] );
+        areas[ i ] = target->work;
+        if( overlap_area( &( captured->work ), &( target->work ) ) > 0 ) {
+            SetRect(
+                &( areas[ i ] ),
+                max( captured->work.left, target->work.left ),
+                max( captured->work.top, target->work.top ),
+                min( captured->work.right, target->work.right ),
+                min( captured->work.bottom, target->work.bottom )
+            );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Build each monitor's transform.  A monitor that is the same in both
+    profiles does not clamp, so its rectangles stay exactly where they
+    were captured.
+    ------------------------------------------------------------------*/
+    map->identity = ( map->count == layout->count ) ? TRUE : FALSE;
+    for( i = 0; i < map->count; ++i ) {
+        captured  = &( map->monitors[ i ] );
+        target    = &( layout->monitors[ pairs[ i ] ] );
+        transform = &( map->transforms[ i ] );
+        transform->source      = captured->rectangle;
+        transform->from_left   = captured->work.left;
+        transform->from_top    = captured->work.top;
+        transform->from_width  = captured->work.right - captured->work.left;
+        transform->from_height = captured->work.bottom - captured->work.top;
+        transform->to_left     = areas[ i ].left;
+        transform->to_top      = areas[ i ].top;
+        transform->to_width    = areas[ i ].right - areas[ i ].left;
+        transform->to_height   = areas[ i ].bottom - areas[ i ].top;
+        transform->scale       = ( target->dpi != 0 )
+                               ? ( LONG ) target->dpi : MONITOR_LAYOUT_DPI;
+        transform->unit        = ( captured->dpi != 0 )
+                               ? ( LONG ) captured->dpi : MONITOR_LAYOUT_DPI;
+        if( transform->from_width < 1 ) {
+            transform->from_width = 1;
+        }
+        if( transform->from_height < 1 ) {
+            transform->from_height = 1;
+        }
+        transform->limits[ 1 ] = target->work;
+        if( memcmp( captured, target, sizeof( config_monitor_type ) ) == 0 ) {
+            SetRect(
+                &( transform->limits[ 0 ] ),
+                -LAYOUT_UNBOUNDED,
+                -LAYOUT_UNBOUNDED,
+                LAYOUT_UNBOUNDED,
+                LAYOUT_UNBOUNDED
+            );
+        }
+        else {
+            transform->limits[ 0 ] = target->work;
+            map->identity          = FALSE;
+        }
+    }
+
+}
+
+
+/*==========================================================================*/
+DWORD classify_rectangle(           /* find the monitor a rectangle is on   */
+    const monitor_map_type*
+                        map,        /* remap table                          */
+    const RECT*         rectangle,  /* configured rectangle                 */
+    BOOL*               outside     /* returned TRUE if it is off every     */
+                                    /* monitor                              */
+) {                                 /* returns captured monitor index       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONGLONG            area;       /* overlap with a monitor               */
+    LONGLONG            best;       /* best overlap, or nearest distance    */
+    DWORD               found;      /* best monitor so far                  */
+    DWORD               i;          /* monitor index                        */
+    LONGLONG            dx;         /* horizontal gap to a monitor          */
+    LONGLONG            dy;         /* vertical gap to a monitor            */
+    const RECT*         source;     /* captured monitor rectangle           */
+
+    /*------------------------------------------------------------------
+    The rectangle is on the monitor it overlaps most.
+    ------------------------------------------------------------------*/
+    found = 0;
+    best  = 0;
+    for( i = 0; i < map->count; ++i ) {
+        area = overlap_area( rectangle, &( map->transforms[ i ].source ) );
+        if( area > best ) {
+            best  = area;
+            found = i;
+        }
+    }
+    *outside = ( best == 0 ) ? TRUE : FALSE;
+    if( best > 0 ) {
+        return found;
+    }
+
+    /*------------------------------------------------------------------
+    A rectangle off every monitor goes to the one nearest it.
+    ------------------------------------------------------------------*/
+    best = -1;
+    for( i = 0; i < map->count; ++i ) {
+        source = &( map->transforms[ i ].source );
+        dx = ( rectangle->right <= source->left )
+           ? ( source->left - rectangle->right )
+           : ( ( rectangle->left >= source->right )
+               ? ( rectangle->left - source->right ) : 0 );
+        dy = ( rectangle->bottom <= source->top )
+           ? ( source->top - rectangle->bottom )
+           : ( ( rectangle->top >= source->bottom )
+               ? ( rectangle->top - source->bottom ) : 0 );
+        if( ( best < 0 ) || ( ( ( dx * dx ) + ( dy * dy ) ) < best ) ) {
+            best  = ( dx * dx ) + ( dy * dy );
+            found = i;
+        }
+    }
+    return found;
+}
+
+
+/*==========================================================================*/
+monitor_map_type* find_map(         /* get the remap table for a profile    */
+    monitor_layout_type*
+                        layout,     /* current monitor layout               */
+    const config_monitor_type*
+                        monitors,   /* captured profile                     */
+    DWORD               count       /* number of captured monitors          */
+) {                                 /* returns cached or new table          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               hash;       /* hash of the captured profile         */
+    DWORD               i;          /* table index                          */
+    monitor_map_type*   map;        /* table found or replaced              */
+
+    /*------------------------------------------------------------------
+    Look for the pair of profiles in the cache.  The hash only narrows
+    the search, the profiles themselves are compared.
+    ------------------------------------------------------------------*/
+    hash = monitor_layout_hash( monitors, count );
+    for( i = 0; i < layout->map_count; ++i ) {
+        map = &( layout->maps[ i ] );
+        if( ( map->captured == hash ) && ( map->current == layout->hash )
+         && ( map->count == count )
+         && ( memcmp( map->monitors, monitors,
+                      ( count * sizeof( config_monitor_type ) ) ) == 0 ) ) {
+            layout->hits += 1;
+            return map;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Build a new table, replacing the oldest one once the cache is full.
+    ------------------------------------------------------------------*/
+    if( layout->map_count < MONITOR_LAYOUT_CACHE ) {
+        map = &( layout->maps[ layout->map_count ] );
+        layout->map_count += 1;
+    }
+    else {
+        map = &( layout->maps[ layout->next_map ] );
+        layout->next_map = ( layout->next_map + 1 ) % MONITOR_LAYOUT_CACHE;
+    }
+    memset( map, 0, sizeof( monitor_map_type ) );
+    map->captured = hash;
+    map->current  = layout->hash;
+    map->count    = count;
+    memcpy(
+        map->monitors,
+        monitors,
+        ( count * sizeof( config_monitor_type ) )
+    );
+    build_map( layout, map );
+    layout->misses += 1;
+    return map;
+}
+
+
+/*==========================================================================*/
+LONGLONG overlap_area(              /* measure two rectangles' overlap      */
+    const RECT*         a,          /* first rectangle                      */
+    const RECT*         b           /* second rectangle                     */
+) {                                 /* returns area (0 if they do not       */
+                                    /* overlap)                             */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG                height;     /* height of the overlap                */
+    LONG                width;      /* width of the overlap                 */
+
+    /*------------------------------------------------------------------
+    Intersect the edges.
+    ------------------------------------------------------------------*/
+    width  = ( ( a->right < b->right ) ? a->right : b->right )
+           - ( ( a->left > b->left ) ? a->left : b->left );
+    height = ( ( a->bottom < b->bottom ) ? a->bottom : b->bottom )
+           - ( ( a->top > b->top ) ? a->top : b->top );
+    if( ( width <= 0 ) || ( height <= 0 ) ) {
+        return 0;
+    }
+    return ( LONGLONG ) width * height;
+}
+
+
+/*==========================================================================*/
+BOOL CALLBACK read_monitor(         /* add a display monitor to a reader    */
+    HMONITOR            monitor,    /* enumerated monitor                   */
+    HDC                 context,    /* unused                               */
+    LPRECT              rectangle,  /* unused                               */
+    LPARAM              parameter   /* monitor reader                       */
+) {                                 /* returns TRUE to keep enumerating     */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    UINT                dpi_x;      /* horizontal DPI                       */
+    UINT                dpi_y;      /* vertical DPI                         */
+    MONITORINFO         info;       /* monitor's rectangles and flags       */
+    config_monitor_type*
+                        read;       /* monitor being filled                 */
+    layout_reader_type* reader;     /* monitor reader                       */
+
+    /*------------------------------------------------------------------
+    Read the monitor's rectangles.  Monitors past the limit are left
+    out.
+    ------------------------------------------------------------------*/
+    reader      = ( layout_reader_type* ) parameter;
+    info.cbSize = sizeof( MONITORINFO );
+    if( ( reader->count == MONITOR_LAYOUT_LIMIT )
+     || ( GetMonitorInfo( monitor, &info ) == FALSE ) ) {
+        return TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    The primary monitor goes first.
+    ------------------------------------------------------------------*/
+    read = &( reader->monitors[ reader->count ] );
+    if( ( ( info.dwFlags & MONITORINFOF_PRIMARY ) != 0 )
+     && ( reader->count > 0 ) ) {
+        *read = reader->monitors[ 0 ];
+        read  = &( reader->monitors[ 0 ] );
+    }
+    read->rectangle = info.rcMonitor;
+    read->work      = info.rcWork;
+    read->dpi       = reader->system_dpi;
+    if( ( reader->get_dpi != NULL )
+     && ( reader->get_dpi(
+            monitor,
+            LAYOUT_EFFECTIVE_DPI,
+            &dpi_x,
+            &dpi_y
+        ) == S_OK ) ) {
+        read->dpi = dpi_x;
+    }
+    reader->count += 1;
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+void remap_batch(                   /* remap gathered rectangles            */
+    const monitor_transform_type*
+                        transforms, /* gathered transforms                  */
+    const DWORD*        slots,      /* each rectangle's transform and limit */
+    LONG*               lefts,      /* rectangle edges (changed in place)   */
+    LONG*               tops,
+    LONG*               rights,
+    LONG*               bottoms,
+    DWORD               count       /* number of rectangles                 */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG                height;     /* remapped height                      */
+    DWORD               i;          /* rectangle index                      */
+    const RECT*         limit;      /* rectangle the result must fit in     */
+    const monitor_transform_type*
+                        transform;  /* rectangle's transform                */
+    LONG                width;      /* remapped width                       */
+    LONG                x;          /* remapped left edge                   */
+    LONG                y;          /* remapped top edge                    */
+
+    /*------------------------------------------------------------------
+    Every rectangle takes the same steps, with only selects (no
+    branches on the data), so the loop stays tight for thousands of
+    rectangles.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < count; ++i ) {
+        transform = &( transforms[ slots[ i ] >> 1 ] );
+        limit     = &( transform->limits[ slots[ i ] & 1 ] );
+        x = transform->to_left + ( LONG ) (
+            ( ( LONGLONG ) ( lefts[ i ] - transform->from_left )
+              * transform->to_width ) / transform->from_width );
+        y = transform->to_top + ( LONG ) (
+            ( ( LONGLONG ) ( tops[ i ] - transform->from_top )
+              * transform->to_height ) / transform->from_height );
+        width  = ( LONG ) ( ( ( LONGLONG ) ( rights[ i ] - lefts[ i ] )
+                              * transform->scale ) / transform->unit );
+        height = ( LONG ) ( ( ( LONGLONG ) ( bottoms[ i ] - tops[ i ] )
+                              * transform->scale ) / transform->unit );
+        width  = ( width < ( limit->right - limit->left ) )
+               ? width : ( limit->right - limit->left );
+        height = ( height < ( limit->bottom - limit->top ) )
+               ? height : ( limit->bottom - limit->top );
+        x      = ( x < ( limit->right - width ) )
+               ? x : ( limit->right - width );
+        y      = ( y < ( limit->bottom - height ) )
+               ? y : ( limit->bottom - height );
+        x      = ( x > limit->left ) ? x : limit->left;
+        y      = ( y > limit->top ) ? y : limit->top;
+        lefts[ i ]   = x;
+        tops[ i ]    = y;
+        rights[ i ]  = x + width;
+        bottoms[ i ] = y + height;
+    }
+
+}
+
@@ -0,0 +1,268 @@
+/*****************************************************************************
+
+proc_arena.c
+
+Process Information Arena Allocator
+
+This module provides a bump allocator for process information queries.  All
+memory handed out by an arena is released at once, either by resetting the
+arena for reuse or by freeing it.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "proc_arena.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define ARENA_ROUND( _size ) \
+    ( ( ( _size ) + ( PROC_ARENA_ALIGN - 1 ) ) & ~( PROC_ARENA_ALIGN - 1 ) )
+                                    /* round a size up to arena alignment   */
+
+#define ARENA_HEADER        ARENA_ROUND( sizeof( proc_arena_chunk_type ) )
+                                    /* size of an aligned chunk header      */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+proc_arena_chunk_type* add_chunk(   /* add a new chunk to an arena          */
+    proc_arena_type*    arena,      /* arena to extend                      */
+    SIZE_T              size        /* minimum usable size of chunk         */
+);                                  /* returns new chunk, or NULL           */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+LPVOID proc_arena_alloc(            /* allocate memory from an arena        */
+    proc_arena_type*    arena,      /* arena to allocate from               */
+    SIZE_T              size        /* number of bytes to allocate          */
+) {                                 /* returns memory, or NULL              */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_arena_chunk_type*
+                        chunk;      /* chunk satisfying the allocation      */
+    LPVOID              memory;     /* allocated memory                     */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( arena == NULL ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Keep every allocation aligned.
+    ------------------------------------------------------------------*/
+    size = ARENA_ROUND( size );
+
+    /*------------------------------------------------------------------
+    Start a new chunk if the current one can not fit the request.
+    ------------------------------------------------------------------*/
+    chunk = arena->head;
+    if( ( chunk == NULL ) || ( ( chunk->size - chunk->used ) < size ) ) {
+        chunk = add_chunk( arena, size );
+        if( chunk == NULL ) {
+            return NULL;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Bump the chunk's allocation offset.
+    ------------------------------------------------------------------*/
+    memory = ( LPVOID ) ( ( LPBYTE ) chunk + ARENA_HEADER + chunk->used );
+    chunk->used += size;
+
+    /*------------------------------------------------------------------
+    Return the allocated memory.
+    ------------------------------------------------------------------*/
+    return memory;
+}
+
+
+/*==========================================================================*/
+void proc_arena_free(               /* release all memory held by an arena  */
+    proc_arena_type*    arena       /* arena to release                     */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_arena_chunk_type*
+                        chunk;      /* chunk being released                 */
+    HANDLE              heap;       /* current process' heap handle         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( arena == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release every chunk in the arena.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    while( arena->head != NULL ) {
+        chunk       = arena->head;
+        arena->head = chunk->next;
+        HeapFree( heap, 0, ( LPVOID ) chunk );
+    }
+
+}
+
+
+/*==========================================================================*/
+error_type proc_arena_init(         /* initialize an arena                  */
+    proc_arena_type*    arena,      /* arena to initialize                  */
+    SIZE_T              chunk_size  /* initial chunk size, or 0 for default */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( arena == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Initialize the arena object.
+    ------------------------------------------------------------------*/
+    arena->head       = NULL;
+    arena->chunk_size = ( chunk_size == 0 ) ? PROC_ARENA_DEFAULT : chunk_size;
+
+    /*------------------------------------------------------------------
+    Allocate the first chunk up front.
+    ------------------------------------------------------------------*/
+    if( add_chunk( arena, arena->chunk_size ) == NULL ) {
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_arena_reset(        /* discard every allocation in an arena */
+    proc_arena_type*    arena       /* arena to reset                       */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_arena_chunk_type*
+                        chunk;      /* chunk being inspected                */
+    SIZE_T              total;      /* total usable size of all chunks      */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( arena == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    A single chunk is simply rewound.
+    ------------------------------------------------------------------*/
+    if( ( arena->head != NULL ) && ( arena->head->next == NULL ) ) {
+        arena->head->used = 0;
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    The last use overflowed into several chunks.  Replace them with one
+    chunk large enough to hold the same amount next time.  An arena
+    left without a chunk by an earlier failure tries again at the size
+    it has.
+    ------------------------------------------------------------------*/
+    if( arena->head != NULL ) {
+        total = 0;
+        for( chunk = arena->head; chunk != NULL; chunk = chunk->next ) {
+            total += chunk->size;
+        }
+        proc_arena_free( arena );
+        arena->chunk_size = total;
+    }
+    if( add_chunk( arena, arena->chunk_size ) == NULL ) {
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+proc_arena_chunk_type* add_chunk(   /* add a new chunk to an arena          */
+    proc_arena_type*    arena,      /* arena to extend                      */
+    SIZE_T              size        /* minimum usable size of chunk         */
+) {                                 /* returns new chunk, or NULL           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_arena_chunk_type*
+                        chunk;      /* newly allocated chunk                */
+
+    /*------------------------------------------------------------------
+    Never allocate less than the arena's chunk size.
+    ------------------------------------------------------------------*/
+    if( size < arena->chunk_size ) {
+        size = arena->chunk_size;
+    }
+    size = ARENA_ROUND( size );
+
+    /*------------------------------------------------------------------
+    Allocate the chunk and its header together.
+    ------------------------------------------------------------------*/
+    chunk = ( proc_arena_chunk_type* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ARENA_HEADER + size )
+    );
+    if( chunk == NULL ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Make the new chunk the arena's current chunk.
+    ------------------------------------------------------------------*/
+    chunk->next = arena->head;
+    chunk->size = size;
+    chunk->used = 0;
+    arena->head = chunk;
+
+    /*------------------------------------------------------------------
+    Return the new chunk.
+    ------------------------------------------------------------------*/
+    return chunk;
+}
+
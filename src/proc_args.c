@@ -0,0 +1,399 @@
+/*****************************************************************************
+
+proc_args.c
+
+Command Line Argument Tokenizer
+
+This module splits a raw command line into arguments using the same quoting
+and backslash rules as CommandLineToArgvW.  Rather than copying arguments, the
+tokenizer unescapes them in place (an argument is never longer than its
+source text) and returns offset/length views into the caller's buffer.  Every
+argument but the last is also NUL-terminated in place.
+
+Runs of ordinary characters are located with SSE2 when it is available.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "proc_args.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define IS_BLANK( _c )      ( ( ( _c ) == L' ' ) || ( ( _c ) == L'\t' ) )
+                                    /* test for an argument separator       */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD scan_plain(                   /* measure a run of ordinary characters */
+    LPCWSTR             text,       /* text to scan                         */
+    DWORD               length,     /* length of text (characters)          */
+    BOOL                quoted      /* whitespace is ordinary when quoted   */
+);                                  /* returns length of run                */
+
+DWORD tokenize(                     /* split or count command line args     */
+    LPWSTR              buffer,     /* command line                         */
+    DWORD               length,     /* length of command line (characters)  */
+    proc_arg_view_type* views,      /* list of argument views, or NULL      */
+    DWORD               capacity,   /* number of views in list              */
+    BOOL                write       /* unescape arguments in the buffer     */
+);                                  /* returns number of arguments          */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+DWORD proc_args_count(              /* count arguments in a command line    */
+    LPCWSTR             buffer,     /* command line                         */
+    DWORD               length      /* length of command line (characters)  */
+) {                                 /* returns number of arguments          */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( buffer == NULL ) {
+        return 0;
+    }
+
+    /*------------------------------------------------------------------
+    Run the tokenizer without touching the buffer.
+    ------------------------------------------------------------------*/
+    return tokenize( ( LPWSTR ) buffer, length, NULL, 0, FALSE );
+}
+
+
+/*==========================================================================*/
+DWORD proc_args_split(              /* split a command line in place        */
+    LPWSTR              buffer,     /* command line, unescaped in place     */
+    DWORD               length,     /* length of command line (characters)  */
+    proc_arg_view_type* views,      /* list of argument views to fill       */
+    DWORD               capacity    /* number of views in list              */
+) {                                 /* returns number of arguments          */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( buffer == NULL ) {
+        return 0;
+    }
+
+    /*------------------------------------------------------------------
+    Unescape the arguments in place, and record their views.
+    ------------------------------------------------------------------*/
+    return tokenize( buffer, length, views, capacity, TRUE );
+}
+
+
+/*==========================================================================*/
+DWORD scan_plain(                   /* measure a run of ordinary characters */
+    LPCWSTR             text,       /* text to scan                         */
+    DWORD               length,     /* length of text (characters)          */
+    BOOL                quoted      /* whitespace is ordinary when quoted   */
+) {                                 /* returns length of run                */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    WCHAR               c;          /* character being tested               */
+    DWORD               i;          /* scan position                        */
+    #ifdef __SSE2__
+    __m128i             backslash;  /* backslash in every lane              */
+    __m128i             chunk;      /* eight characters being tested        */
+    __m128i             hits;       /* lanes holding special characters     */
+    int                 mask;       /* byte mask of special lanes           */
+    __m128i             quote;      /* double quote in every lane           */
+    __m128i             space;      /* space in every lane                  */
+    __m128i             tab;        /* tab in every lane                    */
+    #endif
+
+    /*------------------------------------------------------------------
+    Initialize local variables.
+    ------------------------------------------------------------------*/
+    i = 0;
+
+    /*------------------------------------------------------------------
+    Test eight characters at a time for any special character.
+    ------------------------------------------------------------------*/
+    #ifdef __SSE2__
+        backslash = _mm_set1_epi16( L'\\' );
+        quote     = _mm_set1_epi16( L'"' );
+        space     = _mm_set1_epi16( L' ' );
+        tab       = _mm_set1_epi16( L'\t' );
+        for( ; ( i + 8 ) <= length; i += 8 ) {
+            chunk = _mm_loadu_si128( ( const __m128i* ) ( text + i ) );
+            hits  = _mm_or_si128(
+                _mm_cmpeq_epi16( chunk, quote ),
+                _mm_cmpeq_epi16( chunk, backslash )
+            );
+            if( quoted == FALSE ) {
+                hits = _mm_or_si128(
+                    hits,
+                    _mm_or_si128(
+                        _mm_cmpeq_epi16( chunk, space ),
+                        _mm_cmpeq_epi16( chunk, tab )
+                    )
+                );
+            }
+            mask = _mm_movemask_epi8( hits );
+            if( mask != 0 ) {
+                return i + ( __builtin_ctz( mask ) / sizeof( WCHAR ) );
+            }
+        }
+    #endif
+
+    /*------------------------------------------------------------------
+    Test the remaining characters one at a time.
+    ------------------------------------------------------------------*/
+    for( ; i < length; ++i ) {
+        c = text[ i ];
+        if( ( c == L'"' ) || ( c == L'\\' ) ) {
+            break;
+        }
+        if( ( quoted == FALSE ) && IS_BLANK( c ) ) {
+            break;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return the length of the ordinary run.
+    ------------------------------------------------------------------*/
+    return i;
+}
+
+
+/*==========================================================================*/
+DWORD tokenize(                     /* split or count command line args     */
+    LPWSTR              buffer,     /* command line                         */
+    DWORD               length,     /* length of command line (characters)  */
+    proc_arg_view_type* views,      /* list of argument views, or NULL      */
+    DWORD               capacity,   /* number of views in list              */
+    BOOL                write       /* unescape arguments in the buffer     */
+) {                                 /* returns number of arguments          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bcount;     /* number of pending backslashes        */
+    DWORD               count;      /* number of arguments found            */
+    DWORD               d;          /* unescaped output position            */
+    BOOL                open;       /* an argument is being collected       */
+    DWORD               qcount;     /* quote state, as in CommandLineToArgvW*/
+    DWORD               run;        /* length of an ordinary run            */
+    DWORD               s;          /* source scan position                 */
+    DWORD               start;      /* output offset of current argument    */
+
+    /*------------------------------------------------------------------
+    An empty command line has no arguments.
+    ------------------------------------------------------------------*/
+    if( length == 0 ) {
+        return 0;
+    }
+
+    /*------------------------------------------------------------------
+    Initialize local variables.
+    ------------------------------------------------------------------*/
+    count = 0;
+    d     = 0;
+    s     = 0;
+    start = 0;
+
+    /*------------------------------------------------------------------
+    The program path ends at the next quote if it is quoted, or at the
+    next whitespace otherwise.  Backslashes are not special here.
+    ------------------------------------------------------------------*/
+    if( buffer[ 0 ] == L'"' ) {
+        s = 1;
+        while( ( s < length ) && ( buffer[ s ] != L'"' ) ) {
+            if( write != FALSE ) {
+                buffer[ d ] = buffer[ s ];
+            }
+            ++d;
+            ++s;
+        }
+        if( s < length ) {
+            ++s;
+        }
+    }
+    else {
+        while( ( s < length ) && ( IS_BLANK( buffer[ s ] ) == FALSE ) ) {
+            ++s;
+        }
+        d = s;
+    }
+
+    /*------------------------------------------------------------------
+    Close the program path argument.
+    ------------------------------------------------------------------*/
+    if( ( views != NULL ) && ( count < capacity ) ) {
+        views[ count ].offset = start;
+        views[ count ].length = d - start;
+    }
+    ++count;
+
+    /*------------------------------------------------------------------
+    Skip to the first argument, if any, and terminate the program path
+    (the terminator may overwrite the first separator).
+    ------------------------------------------------------------------*/
+    while( ( s < length ) && IS_BLANK( buffer[ s ] ) ) {
+        ++s;
+    }
+    open = ( s < length ) ? TRUE : FALSE;
+    if( open != FALSE ) {
+        if( write != FALSE ) {
+            buffer[ d ] = L'\0';
+        }
+        ++d;
+    }
+    start  = d;
+    bcount = 0;
+    qcount = 0;
+
+    /*------------------------------------------------------------------
+    Process the remaining arguments.
+    ------------------------------------------------------------------*/
+    while( s < length ) {
+
+        /*--------------------------------------------------------------
+        Unquoted whitespace closes the current argument.
+        --------------------------------------------------------------*/
+        if( IS_BLANK( buffer[ s ] ) && ( qcount == 0 ) ) {
+            if( ( views != NULL ) && ( count < capacity ) ) {
+                views[ count ].offset = start;
+                views[ count ].length = d - start;
+            }
+            ++count;
+            if( write != FALSE ) {
+                buffer[ d ] = L'\0';
+            }
+            ++d;
+            bcount = 0;
+            do {
+                ++s;
+            } while( ( s < length ) && IS_BLANK( buffer[ s ] ) );
+            open  = ( s < length ) ? TRUE : FALSE;
+            start = d;
+        }
+
+        /*--------------------------------------------------------------
+        Backslashes are literal unless they precede a quote.
+        --------------------------------------------------------------*/
+        else if( buffer[ s ] == L'\\' ) {
+            if( write != FALSE ) {
+                buffer[ d ] = L'\\';
+            }
+            ++d;
+            ++s;
+            ++bcount;
+        }
+
+        /*--------------------------------------------------------------
+        Quotes consume half of the preceding backslashes.
+        --------------------------------------------------------------*/
+        else if( buffer[ s ] == L'"' ) {
+
+            /*----------------------------------------------------------
+            An even number of backslashes leaves the quote special.
+            ----------------------------------------------------------*/
+            if( ( bcount & 1 ) == 0 ) {
+                d -= bcount / 2;
+                ++qcount;
+            }
+
+            /*----------------------------------------------------------
+            An odd number of backslashes escapes the quote.
+            ----------------------------------------------------------*/
+            else {
+                d -= ( bcount / 2 ) + 1;
+                if( write != FALSE ) {
+                    buffer[ d ] = L'"';
+                }
+                ++d;
+            }
+            ++s;
+            bcount = 0;
+
+            /*----------------------------------------------------------
+            Every third consecutive quote is a literal quote.
+            ----------------------------------------------------------*/
+            while( ( s < length ) && ( buffer[ s ] == L'"' ) ) {
+                if( ++qcount == 3 ) {
+                    if( write != FALSE ) {
+                        buffer[ d ] = L'"';
+                    }
+                    ++d;
+                    qcount = 0;
+                }
+                ++s;
+            }
+            if( qcount == 2 ) {
+                qcount = 0;
+            }
+        }
+
+        /*--------------------------------------------------------------
+        Move a whole run of ordinary characters at once.
+        --------------------------------------------------------------*/
+        else {
+            run = scan_plain(
+                ( buffer + s ),
+                ( length - s ),
+                ( qcount != 0 ) ? TRUE : FALSE
+            );
+            if( run == 0 ) {
+                run = 1;
+            }
+            if( ( write != FALSE ) && ( d != s ) ) {
+                memmove(
+                    ( buffer + d ),
+                    ( buffer + s ),
+                    ( run * sizeof( WCHAR ) )
+                );
+            }
+            d     += run;
+            s     += run;
+            bcount = 0;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Close the final argument.
+    ------------------------------------------------------------------*/
+    if( open != FALSE ) {
+        if( ( views != NULL ) && ( count < capacity ) ) {
+            views[ count ].offset = start;
+            views[ count ].length = d - start;
+        }
+        ++count;
+    }
+
+    /*------------------------------------------------------------------
+    Return the number of arguments.
+    ------------------------------------------------------------------*/
+    return count;
+}
+
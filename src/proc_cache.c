@@ -0,0 +1,589 @@
+/*****************************************************************************
+
+proc_cache.c
+
+Process Information Cache
+
+This module keeps process information objects (handles and decoded fields)
+in the interface instance between captures.  Processes are identified by
+their ID and creation time, so a reused ID is never mistaken for the process
+that held it before.  Each update is merged against a new snapshot: unchanged
+processes keep everything already loaded, new processes start empty, and
+exited processes are closed.  The cost of a re-capture then follows the
+number of processes that started or exited.
+
+A cache can also be kept current one process at a time, as processes start
+and exit (see proc_events.c).  Such a cache holds every process, so it can
+stand in for a snapshot of the process table.
+
+Cached fields are loaded once, so a cached current directory reflects the
+process when it was first queried.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "proc_cache.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define CACHE_MIN_ENTRIES   ( 64 )  /* initial size of a growing cache      */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD search_entries(               /* find a cached process                */
+    proc_cache_type*    cache,      /* instance's process cache             */
+    DWORD               id,         /* process ID                           */
+    BOOL*               found       /* returned TRUE if it is cached        */
+);                                  /* returns its index, or where it goes  */
+
+void start_entry(                   /* start caching a new process          */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_info_type*     info,       /* cache entry to initialize            */
+    proc_record_type*   record      /* snapshot record of the process       */
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+void proc_cache_free(               /* release every cached process         */
+    proc_instance_type* instance    /* process information instance         */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_cache_type*    cache;      /* instance's process cache             */
+    DWORD               i;          /* loop index                           */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( instance == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Close each cached process, then release the list.
+    ------------------------------------------------------------------*/
+    cache = &( instance->cache );
+    if( cache->entries != NULL ) {
+        for( i = 0; i < cache->count; ++i ) {
+            proc_close( &( cache->entries[ i ] ) );
+        }
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) cache->entries );
+    }
+    cache->entries  = NULL;
+    cache->count    = 0;
+    cache->capacity = 0;
+
+}
+
+
+/*==========================================================================*/
+proc_info_type* proc_cache_get(     /* get a cached process' information    */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               id,         /* process ID                           */
+    proc_fields_t32     fields      /* mask of PROC_FIELD_* values to load  */
+) {                                 /* returns information (valid until the */
+                                    /* next update), or NULL                */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_cache_type*    cache;      /* instance's process cache             */
+    BOOL                found;      /* the process is cached                */
+    DWORD               index;      /* cached process index                 */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( instance == NULL ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Find the process in the ID-ordered list of entries.
+    ------------------------------------------------------------------*/
+    cache = &( instance->cache );
+    index = search_entries( cache, id, &found );
+    if( found == FALSE ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Only fields that were never loaded are queried.  Fields that fail
+    to load are left out of the entry's field mask.
+    ------------------------------------------------------------------*/
+    proc_query( &( cache->entries[ index ] ), fields );
+    return &( cache->entries[ index ] );
+}
+
+
+/*==========================================================================*/
+error_type proc_cache_insert(       /* start caching a process that started */
+    proc_instance_type* instance,   /* process information instance         */
+    const proc_record_type*
+                        record      /* record of the new process            */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_cache_type*    cache;      /* instance's process cache             */
+    DWORD               capacity;   /* new number of entries allocated      */
+    proc_info_type*     entries;    /* grown list of entries                */
+    BOOL                found;      /* the ID is already cached             */
+    DWORD               index;      /* cached process index                 */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( record == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    A process that is already cached is kept.  A different creation
+    time means the ID was reused, and the old process is closed.
+    ------------------------------------------------------------------*/
+    cache = &( instance->cache );
+    index = search_entries( cache, record->id, &found );
+    if( found != FALSE ) {
+        if( CompareFileTime(
+                &( cache->entries[ index ].start_time ),
+                &( record->start_time )
+            ) == 0 ) {
+            return ERR_OK;
+        }
+        proc_close( &( cache->entries[ index ] ) );
+        start_entry(
+            instance,
+            &( cache->entries[ index ] ),
+            ( proc_record_type* ) record
+        );
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Make room for the new entry, doubling the list when it is full.
+    ------------------------------------------------------------------*/
+    if( cache->count == cache->capacity ) {
+        capacity = ( cache->capacity > 0 ) ? ( cache->capacity * 2 )
+                 : CACHE_MIN_ENTRIES;
+        entries  = ( cache->entries == NULL )
+                 ? ( proc_info_type* ) HeapAlloc(
+                     GetProcessHeap(),
+                     0,
+                     ( capacity * sizeof( proc_info_type ) )
+                 )
+                 : ( proc_info_type* ) HeapReAlloc(
+                     GetProcessHeap(),
+                     0,
+                     ( LPVOID ) cache->entries,
+                     ( capacity * sizeof( proc_info_type ) )
+                 );
+        if( entries == NULL ) {
+            return ERR_ALLOC;
+        }
+        cache->entries  = entries;
+        cache->capacity = capacity;
+    }
+
+    /*------------------------------------------------------------------
+    Insert the entry in ID order.
+    ------------------------------------------------------------------*/
+    memmove(
+        &( cache->entries[ index + 1 ] ),
+        &( cache->entries[ index ] ),
+        ( ( cache->count - index ) * sizeof( proc_info_type ) )
+    );
+    start_entry(
+        instance,
+        &( cache->entries[ index ] ),
+        ( proc_record_type* ) record
+    );
+    cache->count += 1;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_cache_records(      /* describe the cached processes as a   */
+                                    /* snapshot                             */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot    /* snapshot object to initialize (its   */
+                                    /* records have no images or owners)    */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_cache_type*    cache;      /* instance's process cache             */
+    DWORD               i;          /* entry index                          */
+    proc_record_type*   record;     /* record being filled                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( snapshot == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( snapshot, 0, sizeof( proc_snapshot_type ) );
+
+    /*------------------------------------------------------------------
+    Allocate the records, and an empty image name they all share, in
+    one block, like a snapshot that was taken.
+    ------------------------------------------------------------------*/
+    cache           = &( instance->cache );
+    snapshot->block = HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ( cache->count * sizeof( proc_record_type ) ) + sizeof( TCHAR ) )
+    );
+    if( snapshot->block == NULL ) {
+        return ERR_ALLOC;
+    }
+    snapshot->instance  = instance;
+    snapshot->records   = ( proc_record_type* ) snapshot->block;
+    snapshot->strings   = ( LPTSTR ) ( snapshot->records + cache->count );
+    *snapshot->strings  = _T( '\0' );
+
+    /*------------------------------------------------------------------
+    The entries are already in ID order.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < cache->count; ++i ) {
+        record             = &( snapshot->records[ i ] );
+        record->id         = cache->entries[ i ].id;
+        record->parent     = 0;
+        record->session    = cache->entries[ i ].session;
+        record->image      = 0;
+        record->owner      = PROC_SNAPSHOT_NONE;
+        record->start_time = cache->entries[ i ].start_time;
+    }
+    snapshot->count = cache->count;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void proc_cache_remove(             /* stop caching a process that exited   */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               id,         /* process ID                           */
+    const FILETIME*     start_time  /* process creation time                */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_cache_type*    cache;      /* instance's process cache             */
+    BOOL                found;      /* the ID is cached                     */
+    DWORD               index;      /* cached process index                 */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( start_time == NULL ) ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Only the process that exited is closed, never a later process that
+    reused its ID.
+    ------------------------------------------------------------------*/
+    cache = &( instance->cache );
+    index = search_entries( cache, id, &found );
+    if( ( found == FALSE )
+     || ( CompareFileTime(
+            &( cache->entries[ index ].start_time ),
+            start_time
+        ) != 0 ) ) {
+        return;
+    }
+    proc_close( &( cache->entries[ index ] ) );
+    memmove(
+        &( cache->entries[ index ] ),
+        &( cache->entries[ index + 1 ] ),
+        ( ( cache->count - index - 1 ) * sizeof( proc_info_type ) )
+    );
+    cache->count -= 1;
+
+}
+
+
+/*==========================================================================*/
+error_type proc_cache_store(        /* keep a process' captured command     */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_pool_type*     pool,       /* pool the item's strings are in       */
+    const proc_capture_item_type*
+                        item        /* captured image and command           */
+) {                                 /* returns error code (ERR_NOT_FOUND if */
+                                    /* the process is not cached)           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_cache_type*    cache;      /* instance's process cache             */
+    SIZE_T              characters; /* characters in every string, with NUL */
+    proc_command_type*  command;    /* command object being built           */
+    BOOL                found;      /* the process is cached                */
+    DWORD               i;          /* command string index                 */
+    DWORD               index;      /* cached process index                 */
+    proc_info_type*     info;       /* cached process                       */
+    LPCTSTR             string;     /* string from the pool                 */
+    LPTSTR              text;       /* next free character in the object    */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( pool == NULL ) || ( item == NULL )
+     || ( item->result != ERR_OK )
+     || ( ( item->fields & PROC_FIELD_IMAGE ) == 0 )
+     || ( ( item->fields & PROC_FIELD_COMMAND ) == 0 ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    A command that is already cached is kept.
+    ------------------------------------------------------------------*/
+    cache = &( instance->cache );
+    index = search_entries( cache, item->id, &found );
+    if( found == FALSE ) {
+        return ERR_NOT_FOUND;
+    }
+    info = &( cache->entries[ index ] );
+    if( ( info->fields & PROC_FIELD_COMMAND ) != 0 ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Build a single-block command object from the pool's strings, the
+    way proc_query would have loaded it.  The directory was not read.
+    ------------------------------------------------------------------*/
+    characters = _tcslen( proc_pool_get( pool, item->image ) ) + 2;
+    for( i = 0; i < item->count; ++i ) {
+        string      = proc_pool_get( pool, item->values[ i ] );
+        characters += _tcslen( string ) + 1;
+    }
+    command = ( proc_command_type* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( sizeof( proc_command_type ) + ( item->count * sizeof( LPTSTR ) )
+          + ( characters * sizeof( TCHAR ) ) )
+    );
+    if( command == NULL ) {
+        return ERR_ALLOC;
+    }
+    text               = ( LPTSTR ) &( command->values[ item->count ] );
+    command->count     = item->count;
+    command->image     = text;
+    _tcscpy( text, proc_pool_get( pool, item->image ) );
+    text              += _tcslen( text ) + 1;
+    command->directory = text;
+    *text++            = _T( '\0' );
+    for( i = 0; i < item->count; ++i ) {
+        string               = proc_pool_get( pool, item->values[ i ] );
+        command->values[ i ] = text;
+        _tcscpy( text, string );
+        text                += _tcslen( string ) + 1;
+    }
+
+    /*------------------------------------------------------------------
+    The cached process now holds the command, and its image unless the
+    image was loaded on its own.
+    ------------------------------------------------------------------*/
+    info->command = command;
+    info->fields |= PROC_FIELD_COMMAND;
+    if( ( info->fields & PROC_FIELD_IMAGE ) == 0 ) {
+        info->image   = command->image;
+        info->fields |= PROC_FIELD_IMAGE;
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_cache_update(       /* sync the cache with a new capture    */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot    /* capture of the current processes     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_cache_type*    cache;      /* instance's process cache             */
+    proc_info_type*     entries;    /* updated list of entries              */
+    DWORD               i;          /* old entry index                      */
+    DWORD               j;          /* snapshot record index                */
+    proc_record_type*   record;     /* current snapshot record              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( snapshot == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate the updated list.  The old list is left untouched if this
+    fails.
+    ------------------------------------------------------------------*/
+    cache   = &( instance->cache );
+    entries = NULL;
+    if( snapshot->count > 0 ) {
+        entries = ( proc_info_type* ) HeapAlloc(
+            GetProcessHeap(),
+            0,
+            ( snapshot->count * sizeof( proc_info_type ) )
+        );
+        if( entries == NULL ) {
+            return ERR_ALLOC;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The cache and the snapshot are both ordered by process ID, so they
+    are merged in a single pass.
+    ------------------------------------------------------------------*/
+    i = 0;
+    for( j = 0; j < snapshot->count; ++j ) {
+        record = &( snapshot->records[ j ] );
+
+        /*--------------------------------------------------------------
+        Close cached processes that are no longer running.
+        --------------------------------------------------------------*/
+        while( ( i < cache->count )
+            && ( cache->entries[ i ].id < record->id ) ) {
+            proc_close( &( cache->entries[ i ] ) );
+            ++i;
+        }
+
+        /*--------------------------------------------------------------
+        Keep a cached process if its creation time still matches.  A
+        different creation time means the ID was reused.
+        --------------------------------------------------------------*/
+        if( ( i < cache->count )
+         && ( cache->entries[ i ].id == record->id ) ) {
+            if( CompareFileTime(
+                    &( cache->entries[ i ].start_time ),
+                    &( record->start_time )
+                ) == 0 ) {
+                entries[ j ] = cache->entries[ i ];
+                ++i;
+                continue;
+            }
+            proc_close( &( cache->entries[ i ] ) );
+            ++i;
+        }
+
+        /*--------------------------------------------------------------
+        Start caching a new process.
+        --------------------------------------------------------------*/
+        start_entry( instance, &( entries[ j ] ), record );
+    }
+
+    /*------------------------------------------------------------------
+    Close the remaining processes that are no longer running.
+    ------------------------------------------------------------------*/
+    for( ; i < cache->count; ++i ) {
+        proc_close( &( cache->entries[ i ] ) );
+    }
+
+    /*------------------------------------------------------------------
+    Replace the old list.
+    ------------------------------------------------------------------*/
+    if( cache->entries != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) cache->entries );
+    }
+    cache->entries  = entries;
+    cache->count    = snapshot->count;
+    cache->capacity = snapshot->count;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD search_entries(               /* find a cached process                */
+    proc_cache_type*    cache,      /* instance's process cache             */
+    DWORD               id,         /* process ID                           */
+    BOOL*               found       /* returned TRUE if it is cached        */
+) {                                 /* returns its index, or where it goes  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               high;       /* upper bound of search range          */
+    DWORD               low;        /* lower bound of search range          */
+    DWORD               middle;     /* entry being tested                   */
+
+    /*------------------------------------------------------------------
+    Binary search the ID-ordered list of entries.
+    ------------------------------------------------------------------*/
+    low  = 0;
+    high = cache->count;
+    while( low < high ) {
+        middle = low + ( ( high - low ) / 2 );
+        if( cache->entries[ middle ].id < id ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    *found = ( ( low < cache->count ) && ( cache->entries[ low ].id == id ) )
+           ? TRUE : FALSE;
+    return low;
+}
+
+
+/*==========================================================================*/
+void start_entry(                   /* start caching a new process          */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_info_type*     info,       /* cache entry to initialize            */
+    proc_record_type*   record      /* snapshot record of the process       */
+) {
+
+    /*------------------------------------------------------------------
+    Nothing is opened until a field is requested.  The idle process
+    (ID 0) can not be opened, but it still gets an entry.
+    ------------------------------------------------------------------*/
+    memset( info, 0, sizeof( proc_info_type ) );
+    info->instance = instance;
+    info->id       = record->id;
+
+    /*------------------------------------------------------------------
+    The snapshot already holds the creation time and session.
+    ------------------------------------------------------------------*/
+    info->start_time = record->start_time;
+    info->session    = record->session;
+    info->fields     = PROC_FIELD_START | PROC_FIELD_SESSION;
+
+}
+
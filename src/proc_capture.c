@@ -0,0 +1,950 @@
+/*****************************************************************************
+
+proc_capture.c
+
+Parallel Process Capture
+
+Querying one process is independent of every other, and mostly waits on
+system calls, so this module spreads the processes of a snapshot across a
+pool of worker threads.  Each worker starts with an equal range of snapshot
+records, and steals records from the other ranges when its own runs out.
+Workers have their own process information object and arenas, so they
+share nothing but the range counters and the string pool.  Results are
+written to the slot of their snapshot record, which keeps the output sorted
+by process ID no matter which worker queried a process.
+
+Most processes run one of a few images, often with the same arguments, so
+each query is read into a scratch arena, and its strings are interned in the
+caller's pool (see proc_pool.c).  Items only keep the strings' IDs.
+
+A wedged or protected process can stall a query inside a system call, and
+such a call can not be interrupted.  When deadlines are given, the calling
+thread supervises the workers instead of working, and abandons queries that
+run over time: their slots are reported as ERR_TIMEOUT, and whatever the
+stalled worker finds later is discarded.  Workers only touch a reference
+counted block of shared state (including a copy of the instance), so a
+worker that is still stalled when the capture returns, or is freed, stays
+safe until it exits.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "proc_capture.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define CAPTURE_LINE        ( 64 )  /* cache line size (bytes)              */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+enum {                              /* capture slot states                  */
+    SLOT_PENDING,                   /* not yet claimed by a worker          */
+    SLOT_RUNNING,                   /* being queried by a worker            */
+    SLOT_WRITING,                   /* worker is storing its results        */
+    SLOT_DONE,                      /* results are stored                   */
+    SLOT_ABANDONED                  /* ran out of time                      */
+};
+
+typedef struct capture_range_s {    /* worker record range type             */
+    volatile LONG       next;       /* next record to claim                 */
+    LONG                end;        /* end of the range                     */
+    BYTE                pad[ CAPTURE_LINE - ( 2 * sizeof( LONG ) ) ];
+                                    /* keep counters on separate lines      */
+} capture_range_type;
+
+typedef struct capture_slot_s {     /* per-process query state type         */
+    volatile LONG       state;      /* SLOT_* state of the query            */
+    volatile DWORD      started;    /* tick count when the query started    */
+    FILETIME            start_time; /* process creation time                */
+    DWORD               session;    /* terminal services session ID         */
+} capture_slot_type;
+
+typedef struct capture_worker_s {   /* worker thread state type             */
+    struct capture_block_s*
+                        block;      /* state shared by every worker         */
+    DWORD               index;      /* worker's index                       */
+    volatile LONG       current;    /* record being queried, or -1          */
+    volatile LONG       exited;     /* worker has stopped claiming records  */
+} capture_worker_type;
+
+typedef struct capture_block_s {    /* state shared by every worker type    */
+    volatile LONG       references; /* capture plus running threads         */
+    volatile LONG       cancelled;  /* the capture has returned             */
+    proc_instance_type  instance;   /* copy of the process instance         */
+    proc_fields_t32     fields;     /* fields to load                       */
+    DWORD               count;      /* number of records                    */
+    DWORD               workers;    /* number of workers                    */
+    proc_capture_item_type*
+                        items;      /* captured processes, sorted by ID     */
+    capture_slot_type*  slots;      /* query state of each record           */
+    capture_range_type* ranges;     /* record range of each worker          */
+    proc_arena_type*    arenas;     /* per-worker memory for string IDs and */
+                                    /* SIDs                                 */
+    proc_arena_type*    scratch;    /* per-worker memory for one query      */
+    proc_pool_type*     pool;       /* pool the strings are interned in     */
+    capture_worker_type*
+                        worker;     /* state of each worker                 */
+} capture_block_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+void abandon_slot(                  /* report a query as timed out          */
+    capture_block_type* block,      /* shared capture state                 */
+    LONG                record      /* index of record                      */
+);
+
+capture_block_type* alloc_block(    /* allocate the shared capture state    */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* processes to query                   */
+    proc_fields_t32     fields,     /* fields to load                       */
+    DWORD               workers     /* number of workers                    */
+);                                  /* returns block, or NULL               */
+
+BOOL claim_record(                  /* claim the next record to query       */
+    capture_block_type* block,      /* shared capture state                 */
+    DWORD               self,       /* claiming worker's index              */
+    LONG*               record      /* returned record index                */
+);                                  /* returns FALSE when none are left     */
+
+error_type intern_item(             /* intern a query's strings into an     */
+                                    /* item                                 */
+    proc_pool_type*     pool,       /* pool the strings are interned in     */
+    proc_arena_type*    arena,      /* worker's arena for the ID list       */
+    proc_info_type*     info,       /* queried process                      */
+    proc_capture_item_type*
+                        item        /* item to fill                         */
+);                                  /* returns error code                   */
+
+void query_item(                    /* query one process into its slot      */
+    capture_block_type* block,      /* shared capture state                 */
+    DWORD               self,       /* querying worker's index              */
+    LONG                record      /* index of snapshot record             */
+);
+
+void release_block(                 /* drop a reference to the shared state */
+    capture_block_type* block       /* shared capture state                 */
+);
+
+DWORD WINAPI run_thread(            /* worker thread entry point            */
+    LPVOID              parameter   /* worker's state                       */
+);                                  /* returns thread exit code             */
+
+void run_worker(                    /* query processes until none are left  */
+    capture_worker_type*
+                        worker      /* worker's state                       */
+);
+
+BOOL supervise(                     /* enforce deadlines on the workers     */
+    capture_block_type* block,      /* shared capture state                 */
+    HANDLE*             handles,    /* handles of worker threads            */
+    DWORD               running,    /* number of worker threads             */
+    DWORD               process_timeout,
+                                    /* per-process limit (ms), or INFINITE  */
+    DWORD               capture_timeout
+                                    /* capture limit (ms), or INFINITE      */
+);                                  /* returns FALSE if any query timed out */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+void proc_capture_free(             /* release a parallel capture           */
+    proc_capture_type*  capture     /* capture object                       */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( capture == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    The items and their strings live in the shared block, which is
+    released once any stalled workers have also let go of it.
+    ------------------------------------------------------------------*/
+    if( capture->block != NULL ) {
+        release_block( ( capture_block_type* ) capture->block );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the capture object.
+    ------------------------------------------------------------------*/
+    memset( capture, 0, sizeof( proc_capture_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type proc_capture_run(        /* query every process in a snapshot    */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* processes to query                   */
+    proc_fields_t32     fields,     /* mask of PROC_FIELD_* values to load  */
+    DWORD               workers,    /* worker threads, or 0 for one per CPU */
+    DWORD               process_timeout,
+                                    /* per-process limit (ms), or INFINITE  */
+    DWORD               capture_timeout,
+                                    /* capture limit (ms), or INFINITE      */
+    proc_pool_type*     pool,       /* pool the strings are interned in     */
+                                    /* (must outlive the capture)           */
+    proc_capture_type*  capture     /* capture object to initialize         */
+) {                                 /* returns error code (ERR_TIMEOUT if   */
+                                    /* any query ran out of time)           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    capture_block_type* block;      /* state shared by every worker         */
+    BOOL                finished;   /* every query ended in time            */
+    HANDLE              handles[ PROC_CAPTURE_MAX_WORKERS ];
+                                    /* handles of started worker threads    */
+    DWORD               i;          /* worker index                         */
+    DWORD               running;    /* number of worker threads started     */
+    BOOL                supervised; /* deadlines are being enforced         */
+    SYSTEM_INFO         system;     /* system information                   */
+    HANDLE              thread;     /* handle of a new worker thread        */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( snapshot == NULL ) || ( pool == NULL )
+     || ( capture == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Initialize the user's memory.
+    ------------------------------------------------------------------*/
+    memset( capture, 0, sizeof( proc_capture_type ) );
+    if( snapshot->count == 0 ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Use one worker per processor by default, but never more workers
+    than processes.
+    ------------------------------------------------------------------*/
+    if( workers == 0 ) {
+        GetSystemInfo( &system );
+        workers = system.dwNumberOfProcessors;
+    }
+    if( workers > PROC_CAPTURE_MAX_WORKERS ) {
+        workers = PROC_CAPTURE_MAX_WORKERS;
+    }
+    if( workers > snapshot->count ) {
+        workers = snapshot->count;
+    }
+
+    /*------------------------------------------------------------------
+    Build the volume table up front, since workers only read it.
+    ------------------------------------------------------------------*/
+    proc_volume_refresh( &( instance->volumes ) );
+
+    /*------------------------------------------------------------------
+    Allocate the state shared by the workers.
+    ------------------------------------------------------------------*/
+    block = alloc_block( instance, snapshot, fields, workers );
+    if( block == NULL ) {
+        return ERR_ALLOC;
+    }
+    block->pool      = pool;
+    capture->count   = block->count;
+    capture->items   = block->items;
+    capture->workers = workers;
+    capture->block   = ( LPVOID ) block;
+
+    /*------------------------------------------------------------------
+    With deadlines, every worker runs on its own thread while this
+    thread keeps time.  Otherwise, this thread is worker 0.
+    ------------------------------------------------------------------*/
+    supervised = ( ( process_timeout != INFINITE )
+                || ( capture_timeout != INFINITE ) ) ? TRUE : FALSE;
+
+    /*------------------------------------------------------------------
+    Start the worker threads.  Each holds a reference to the block.  A
+    worker that fails to start leaves its range to be stolen.
+    ------------------------------------------------------------------*/
+    running = 0;
+    for( i = ( supervised != FALSE ) ? 0 : 1; i < workers; ++i ) {
+        InterlockedIncrement( &( block->references ) );
+        thread = CreateThread(
+            NULL,
+            0,
+            run_thread,
+            ( LPVOID ) &( block->worker[ i ] ),
+            0,
+            NULL
+        );
+        if( thread == NULL ) {
+            InterlockedDecrement( &( block->references ) );
+            block->worker[ i ].exited = 1;
+            continue;
+        }
+        handles[ running ] = thread;
+        running += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Deadlines can only be kept while some other thread does the work.
+    ------------------------------------------------------------------*/
+    finished = TRUE;
+    if( ( supervised != FALSE ) && ( running > 0 ) ) {
+        finished = supervise(
+            block,
+            handles,
+            running,
+            process_timeout,
+            capture_timeout
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Work on this thread, then wait for the other workers to finish.
+    ------------------------------------------------------------------*/
+    else {
+        run_worker( &( block->worker[ 0 ] ) );
+        if( running > 0 ) {
+            WaitForMultipleObjects( running, handles, TRUE, INFINITE );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Let go of the worker threads.  Stalled threads keep running until
+    their query returns, then exit on their own.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < running; ++i ) {
+        CloseHandle( handles[ i ] );
+    }
+
+    /*------------------------------------------------------------------
+    Each item holds the result of its own query.  The capture is usable
+    even if it ran out of time.  Abandoned workers never store results,
+    so nothing is interned in the pool once this returns.
+    ------------------------------------------------------------------*/
+    return ( finished != FALSE ) ? ERR_OK : ERR_TIMEOUT;
+}
+
+
+/*==========================================================================*/
+void abandon_slot(                  /* report a query as timed out          */
+    capture_block_type* block,      /* shared capture state                 */
+    LONG                record      /* index of record                      */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG                state;      /* observed state of the slot           */
+
+    /*------------------------------------------------------------------
+    Take over the slot unless its query already finished.  A worker
+    storing its results is only a few interns from done, so wait for it.
+    ------------------------------------------------------------------*/
+    for( ; ; ) {
+        state = block->slots[ record ].state;
+        if( ( state == SLOT_PENDING ) || ( state == SLOT_RUNNING ) ) {
+            if( InterlockedCompareExchange(
+                    &( block->slots[ record ].state ),
+                    SLOT_ABANDONED,
+                    state
+                ) == state ) {
+                block->items[ record ].result = ERR_TIMEOUT;
+                return;
+            }
+        }
+        else if( state == SLOT_WRITING ) {
+            Sleep( 0 );
+        }
+        else {
+            return;
+        }
+    }
+}
+
+
+/*==========================================================================*/
+capture_block_type* alloc_block(    /* allocate the shared capture state    */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* processes to query                   */
+    proc_fields_t32     fields,     /* fields to load                       */
+    DWORD               workers     /* number of workers                    */
+) {                                 /* returns block, or NULL               */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    capture_block_type* block;      /* new shared state                     */
+    DWORD               count;      /* number of records                    */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* loop index                           */
+    error_type          result;     /* result of internal operation         */
+    DWORD               span;       /* records per worker range             */
+
+    /*------------------------------------------------------------------
+    Allocate the block and its lists.
+    ------------------------------------------------------------------*/
+    heap  = GetProcessHeap();
+    count = snapshot->count;
+    block = ( capture_block_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        sizeof( capture_block_type )
+    );
+    if( block == NULL ) {
+        return NULL;
+    }
+    block->references = 1;
+    block->items  = ( proc_capture_item_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( count * sizeof( proc_capture_item_type ) )
+    );
+    block->slots  = ( capture_slot_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( count * sizeof( capture_slot_type ) )
+    );
+    block->ranges = ( capture_range_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( workers * sizeof( capture_range_type ) )
+    );
+    block->arenas = ( proc_arena_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( 2 * workers * sizeof( proc_arena_type ) )
+    );
+    block->worker = ( capture_worker_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( workers * sizeof( capture_worker_type ) )
+    );
+    if( ( block->items == NULL ) || ( block->slots == NULL )
+     || ( block->ranges == NULL ) || ( block->arenas == NULL )
+     || ( block->worker == NULL ) ) {
+        release_block( block );
+        return NULL;
+    }
+    block->count   = count;
+    block->workers = workers;
+    block->scratch = block->arenas + workers;
+    for( i = 0; i < ( 2 * workers ); ++i ) {
+        result = proc_arena_init( &( block->arenas[ i ] ), 0 );
+        if( result != ERR_OK ) {
+            release_block( block );
+            return NULL;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Workers query through a copy of the instance, so a stalled worker
+    never touches the caller's memory.  Queries only read the instance.
+    ------------------------------------------------------------------*/
+    block->instance = *instance;
+    block->fields   = fields;
+
+    /*------------------------------------------------------------------
+    Copy what the workers need from each snapshot record.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < count; ++i ) {
+        block->items[ i ].id         = snapshot->records[ i ].id;
+        block->items[ i ].image      = PROC_POOL_NONE;
+        block->items[ i ].directory  = PROC_POOL_NONE;
+        block->slots[ i ].state      = SLOT_PENDING;
+        block->slots[ i ].start_time = snapshot->records[ i ].start_time;
+        block->slots[ i ].session    = snapshot->records[ i ].session;
+    }
+
+    /*------------------------------------------------------------------
+    Split the records into one contiguous range per worker.
+    ------------------------------------------------------------------*/
+    span = ( count + workers - 1 ) / workers;
+    for( i = 0; i < workers; ++i ) {
+        block->ranges[ i ].next = ( LONG ) ( i * span );
+        block->ranges[ i ].end  = ( LONG ) ( ( i + 1 ) * span );
+        if( block->ranges[ i ].end > ( LONG ) count ) {
+            block->ranges[ i ].end = ( LONG ) count;
+        }
+        block->worker[ i ].block   = block;
+        block->worker[ i ].index   = i;
+        block->worker[ i ].current = -1;
+    }
+
+    /*------------------------------------------------------------------
+    Return the new block.
+    ------------------------------------------------------------------*/
+    return block;
+}
+
+
+/*==========================================================================*/
+BOOL claim_record(                  /* claim the next record to query       */
+    capture_block_type* block,      /* shared capture state                 */
+    DWORD               self,       /* claiming worker's index              */
+    LONG*               record      /* returned record index                */
+) {                                 /* returns FALSE when none are left     */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* offset from own range                */
+    capture_range_type* range;      /* range being claimed from             */
+
+    /*------------------------------------------------------------------
+    Claim from the worker's own range first, then steal from the others
+    in turn.  Claims are a single atomic increment, so a record is never
+    claimed twice.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < block->workers; ++i ) {
+        range = &( block->ranges[ ( self + i ) % block->workers ] );
+        while( range->next < range->end ) {
+            if( block->cancelled != 0 ) {
+                return FALSE;
+            }
+            *record = InterlockedIncrement( &( range->next ) ) - 1;
+            if( *record < range->end ) {
+                return TRUE;
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Every range is exhausted.
+    ------------------------------------------------------------------*/
+    return FALSE;
+}
+
+
+/*==========================================================================*/
+error_type intern_item(             /* intern a query's strings into an     */
+                                    /* item                                 */
+    proc_pool_type*     pool,       /* pool the strings are interned in     */
+    proc_arena_type*    arena,      /* worker's arena for the ID list       */
+    proc_info_type*     info,       /* queried process                      */
+    proc_capture_item_type*
+                        item        /* item to fill                         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_command_type*  command;    /* process start command                */
+    DWORD               i;          /* command string index                 */
+    error_type          result;     /* result of internal operation         */
+
+    /*------------------------------------------------------------------
+    Intern the image file name.
+    ------------------------------------------------------------------*/
+    if( ( info->fields & PROC_FIELD_IMAGE ) != 0 ) {
+        result = proc_pool_intern( pool, info->image, &( item->image ) );
+        if( result != ERR_OK ) {
+            info->fields &= ~PROC_FIELD_IMAGE;
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Intern the current directory.
+    ------------------------------------------------------------------*/
+    command = info->command;
+    if( ( ( info->fields & PROC_FIELD_DIRECTORY ) != 0 )
+     && ( command->directory != NULL ) ) {
+        result = proc_pool_intern(
+            pool,
+            command->directory,
+            &( item->directory )
+        );
+        if( result != ERR_OK ) {
+            info->fields &= ~PROC_FIELD_DIRECTORY;
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Intern each command string.  Only the list of their IDs is kept in
+    the worker's arena.
+    ------------------------------------------------------------------*/
+    if( ( info->fields & PROC_FIELD_COMMAND ) != 0 ) {
+        item->values = ( DWORD* ) proc_arena_alloc(
+            arena,
+            ( command->count * sizeof( DWORD ) )
+        );
+        if( item->values == NULL ) {
+            info->fields &= ~PROC_FIELD_COMMAND;
+            return ERR_ALLOC;
+        }
+        for( i = 0; i < command->count; ++i ) {
+            result = proc_pool_intern(
+                pool,
+                command->values[ i ],
+                &( item->values[ i ] )
+            );
+            if( result != ERR_OK ) {
+                info->fields &= ~PROC_FIELD_COMMAND;
+                item->values  = NULL;
+                return result;
+            }
+        }
+        item->count = command->count;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void query_item(                    /* query one process into its slot      */
+    capture_block_type* block,      /* shared capture state                 */
+    DWORD               self,       /* querying worker's index              */
+    LONG                record      /* index of snapshot record             */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_arena_type*    arena;      /* worker's arena for what is kept      */
+    proc_info_type      info;       /* worker's scratch information object  */
+    BOOL                opened;     /* the information object is open       */
+    proc_capture_item_type*
+                        item;       /* slot for the process' results        */
+    DWORD               length;     /* length of owner SID (bytes)          */
+    PSID                owner;      /* owner SID copied to the arena        */
+    error_type          result;     /* result of querying the process       */
+    capture_slot_type*  slot;       /* query state of the process           */
+
+    /*------------------------------------------------------------------
+    Start the query, unless it was abandoned before it was claimed.
+    ------------------------------------------------------------------*/
+    item = &( block->items[ record ] );
+    slot = &( block->slots[ record ] );
+    slot->started = GetTickCount();
+    if( InterlockedCompareExchange(
+            &( slot->state ),
+            SLOT_RUNNING,
+            SLOT_PENDING
+        ) != SLOT_PENDING ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Open the process.  Strings and commands come from the worker's
+    scratch arena, so they outlive the information object until they
+    are interned.  The previous query's are no longer needed.  A scratch
+    arena that can not be rewound fails the query.
+    ------------------------------------------------------------------*/
+    arena  = &( block->arenas[ self ] );
+    owner  = NULL;
+    result = proc_arena_reset( &( block->scratch[ self ] ) );
+    if( result == ERR_OK ) {
+        result = proc_open( &( block->instance ), &info, item->id );
+    }
+    opened = ( result == ERR_OK ) ? TRUE : FALSE;
+    if( opened != FALSE ) {
+        info.arena = &( block->scratch[ self ] );
+
+        /*--------------------------------------------------------------
+        The snapshot already holds the creation time and session.
+        --------------------------------------------------------------*/
+        info.start_time = slot->start_time;
+        info.session    = slot->session;
+        info.fields     = PROC_FIELD_START | PROC_FIELD_SESSION;
+
+        /*--------------------------------------------------------------
+        Query the requested fields in one pass.
+        --------------------------------------------------------------*/
+        result       = proc_query( &info, block->fields );
+        info.fields &= block->fields;
+
+        /*--------------------------------------------------------------
+        Copy the owner SID into the arena before the token info is
+        freed.
+        --------------------------------------------------------------*/
+        if( ( info.fields & PROC_FIELD_OWNER ) != 0 ) {
+            length = GetLengthSid( info.user->User.Sid );
+            owner  = ( PSID ) proc_arena_alloc( arena, length );
+            if( owner != NULL ) {
+                CopySid( length, owner, info.user->User.Sid );
+            }
+            else {
+                info.fields &= ~PROC_FIELD_OWNER;
+                result       = ERR_ALLOC;
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Store the results, unless the query ran out of time while it was
+    running.  The results of an abandoned query are left in the arenas,
+    and never reach the pool.  A string that can not be interned is
+    dropped from the item's fields.
+    ------------------------------------------------------------------*/
+    if( InterlockedCompareExchange(
+            &( slot->state ),
+            SLOT_WRITING,
+            SLOT_RUNNING
+        ) == SLOT_RUNNING ) {
+        if( opened != FALSE ) {
+            if( intern_item( block->pool, arena, &info, item ) != ERR_OK ) {
+                result = ERR_ALLOC;
+            }
+            item->fields = info.fields;
+            item->owner  = owner;
+        }
+        item->result = result;
+        InterlockedExchange( &( slot->state ), SLOT_DONE );
+    }
+
+    /*------------------------------------------------------------------
+    Close the process' handles.
+    ------------------------------------------------------------------*/
+    if( opened != FALSE ) {
+        proc_close( &info );
+    }
+
+}
+
+
+/*==========================================================================*/
+void release_block(                 /* drop a reference to the shared state */
+    capture_block_type* block       /* shared capture state                 */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* loop index                           */
+
+    /*------------------------------------------------------------------
+    The last reference releases the block.
+    ------------------------------------------------------------------*/
+    if( InterlockedDecrement( &( block->references ) ) != 0 ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Every ID list and SID lives in a worker's arena.  The strings live
+    in the caller's pool.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    if( block->arenas != NULL ) {
+        for( i = 0; i < ( 2 * block->workers ); ++i ) {
+            proc_arena_free( &( block->arenas[ i ] ) );
+        }
+        HeapFree( heap, 0, ( LPVOID ) block->arenas );
+    }
+
+    /*------------------------------------------------------------------
+    Release the lists and the block.
+    ------------------------------------------------------------------*/
+    if( block->items != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) block->items );
+    }
+    if( block->slots != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) block->slots );
+    }
+    if( block->ranges != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) block->ranges );
+    }
+    if( block->worker != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) block->worker );
+    }
+    HeapFree( heap, 0, ( LPVOID ) block );
+
+}
+
+
+/*==========================================================================*/
+DWORD WINAPI run_thread(            /* worker thread entry point            */
+    LPVOID              parameter   /* worker's state                       */
+) {                                 /* returns thread exit code             */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    capture_worker_type*
+                        worker;     /* worker's state                       */
+
+    /*------------------------------------------------------------------
+    Work, then drop the thread's reference to the shared state.
+    ------------------------------------------------------------------*/
+    worker = ( capture_worker_type* ) parameter;
+    run_worker( worker );
+    InterlockedExchange( &( worker->exited ), 1 );
+    release_block( worker->block );
+
+    /*------------------------------------------------------------------
+    Exit the thread.
+    ------------------------------------------------------------------*/
+    return 0;
+}
+
+
+/*==========================================================================*/
+void run_worker(                    /* query processes until none are left  */
+    capture_worker_type*
+                        worker      /* worker's state                       */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG                record;     /* index of claimed record              */
+
+    /*------------------------------------------------------------------
+    Query processes until none are left, or the capture gives up.
+    ------------------------------------------------------------------*/
+    while( claim_record( worker->block, worker->index, &record ) ) {
+        InterlockedExchange( &( worker->current ), record );
+        query_item( worker->block, worker->index, record );
+        InterlockedExchange( &( worker->current ), -1 );
+    }
+
+}
+
+
+/*==========================================================================*/
+BOOL supervise(                     /* enforce deadlines on the workers     */
+    capture_block_type* block,      /* shared capture state                 */
+    HANDLE*             handles,    /* handles of worker threads            */
+    DWORD               running,    /* number of worker threads             */
+    DWORD               process_timeout,
+                                    /* per-process limit (ms), or INFINITE  */
+    DWORD               capture_timeout
+                                    /* capture limit (ms), or INFINITE      */
+) {                                 /* returns FALSE if any query timed out */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               abandoned;  /* number of abandoned queries          */
+    DWORD               elapsed;    /* time since the capture started       */
+    DWORD               i;          /* loop index                           */
+    DWORD               now;        /* current tick count                   */
+    LONG                record;     /* record a worker is querying          */
+    DWORD               settled;    /* number of queries done or abandoned  */
+    capture_slot_type*  slot;       /* query state of that record           */
+    DWORD               start;      /* tick count when supervision started  */
+    DWORD               stalled;    /* workers that can not claim records   */
+    LONG                state;      /* observed state of a slot             */
+    DWORD               wait;       /* time to wait for the workers         */
+    DWORD               wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Wake up regularly to check per-process deadlines, or only at the
+    capture deadline.
+    ------------------------------------------------------------------*/
+    start   = GetTickCount();
+    elapsed = 0;
+    for( ; ; ) {
+        wait = INFINITE;
+        if( capture_timeout != INFINITE ) {
+            wait = ( elapsed < capture_timeout )
+                 ? ( capture_timeout - elapsed ) : 0;
+        }
+        if( ( process_timeout != INFINITE ) && ( wait > PROC_CAPTURE_POLL ) ) {
+            wait = PROC_CAPTURE_POLL;
+        }
+        wresult = WaitForMultipleObjects( running, handles, TRUE, wait );
+        now     = GetTickCount();
+        elapsed = now - start;
+
+        /*--------------------------------------------------------------
+        At the capture deadline, stop further claims, and abandon every
+        query that has not finished.
+        --------------------------------------------------------------*/
+        if( ( wresult == WAIT_TIMEOUT ) && ( capture_timeout != INFINITE )
+         && ( elapsed >= capture_timeout ) ) {
+            InterlockedExchange( &( block->cancelled ), 1 );
+            for( i = 0; i < block->count; ++i ) {
+                abandon_slot( block, ( LONG ) i );
+            }
+            return FALSE;
+        }
+
+        /*--------------------------------------------------------------
+        Abandon queries that have run past their own deadline.  The
+        worker keeps claiming records once its query returns.  A worker
+        whose query was abandoned, or whose thread has stopped, can not
+        claim anything for now.
+        --------------------------------------------------------------*/
+        stalled = 0;
+        for( i = 0; i < block->workers; ++i ) {
+            if( block->worker[ i ].exited != 0 ) {
+                stalled += 1;
+                continue;
+            }
+            record = block->worker[ i ].current;
+            if( record < 0 ) {
+                continue;
+            }
+            slot = &( block->slots[ record ] );
+            if( ( process_timeout != INFINITE )
+             && ( slot->state == SLOT_RUNNING )
+             && ( ( now - slot->started ) >= process_timeout ) ) {
+                abandon_slot( block, record );
+            }
+            if( slot->state == SLOT_ABANDONED ) {
+                stalled += 1;
+            }
+        }
+
+        /*--------------------------------------------------------------
+        The capture is over once every query is done or abandoned.
+        Stalled workers are not waited for: their queries may never
+        return.
+        --------------------------------------------------------------*/
+        abandoned = 0;
+        settled   = 0;
+        for( i = 0; i < block->count; ++i ) {
+            state = block->slots[ i ].state;
+            if( state == SLOT_ABANDONED ) {
+                abandoned += 1;
+                settled   += 1;
+            }
+            else if( state == SLOT_DONE ) {
+                settled += 1;
+            }
+        }
+        if( settled == block->count ) {
+            InterlockedExchange( &( block->cancelled ), 1 );
+            return ( abandoned == 0 ) ? TRUE : FALSE;
+        }
+
+        /*--------------------------------------------------------------
+        When no worker is left to claim the remaining records (every
+        one is stalled, or has stopped), those records are abandoned
+        too rather than waited on forever.
+        --------------------------------------------------------------*/
+        if( ( wresult != WAIT_TIMEOUT ) || ( stalled == block->workers ) ) {
+            InterlockedExchange( &( block->cancelled ), 1 );
+            for( i = 0; i < block->count; ++i ) {
+                abandon_slot( block, ( LONG ) i );
+            }
+            return FALSE;
+        }
+    }
+}
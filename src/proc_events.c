@@ -0,0 +1,984 @@
+/*****************************************************************************
+
+proc_events.c
+
+Process Start and Exit Events
+
+A caller that looks at the running processes every few seconds (an
+autosave, or a resident restore, see main.c) would otherwise read the whole
+process table each time, though hardly any process starts or exits in
+between.  This module reads the table once, into the instance's cache (see
+proc_cache.c), and then follows the system's process starts and exits to
+keep the cache current.  Nothing is read while nothing happens.
+
+Starts and exits come from the kernel's process provider, through a real-
+time event trace session owned by this process.  The events are delivered
+on a thread of their own, and are queued there.  The caller applies the
+queued changes to the cache when it is about to use it, so the cache is
+only ever changed on the caller's thread.
+
+A trace session belongs to the system, not to the process that starts it,
+and lives on until it is stopped.  Besides closing it, this process stops it
+when its console is closed, when it is asked to close, and when Windows
+ends (see end_thread).  A process that is ended outright can not, so each
+new session first stops those left over by processes that no longer run.
+
+When the queue grows too long, or the trace session reports that it lost
+events, the changes are dropped, and the whole table is read again the next
+time they are applied.  Starting a trace session needs the rights to trace
+(an administrator, or a member of "Performance Log Users").  Without them,
+nothing can be followed, and callers go on reading the table.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdlib.h>
+#include <evntrace.h>
+#include <evntcons.h>
+
+#include "proc_cache.h"
+#include "proc_events.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define EVENTS_KEYWORD      ( 0x10 )/* the provider's process events        */
+#define EVENTS_START        ( 1 )   /* a process started                    */
+#define EVENTS_STOP         ( 2 )   /* a process exited                     */
+#define EVENTS_MIN_CHANGES  ( 64 )  /* initial size of the queue            */
+#define EVENTS_MAX_SESSIONS ( 64 )  /* most sessions looked at for those    */
+                                    /* left over                            */
+#define EVENTS_QUERY_NAME   ( 1024 )/* longest name of a session, or of its */
+                                    /* log file (characters)                */
+
+#ifndef EVENT_TRACE_USE_MS_FLUSH_TIMER
+#define EVENT_TRACE_USE_MS_FLUSH_TIMER \
+                            ( 0x00000010 )
+                                    /* FlushTimer is in milliseconds        */
+#endif
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct events_properties_s {/* trace session properties type        */
+    EVENT_TRACE_PROPERTIES
+                        properties; /* session properties                   */
+    TCHAR               name[ PROC_EVENTS_NAME_SIZE ];
+                                    /* room for the session name            */
+} events_properties_type;
+
+typedef struct events_query_s {     /* any session's properties type        */
+    EVENT_TRACE_PROPERTIES
+                        properties; /* session properties                   */
+    TCHAR               name[ EVENTS_QUERY_NAME ];
+                                    /* room for the session name            */
+    TCHAR               file[ EVENTS_QUERY_NAME ];
+                                    /* room for the log file name           */
+} events_query_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL WINAPI end_console(            /* stop the session as the console ends */
+    DWORD               type        /* CTRL_* event                         */
+);                                  /* returns FALSE to end the process     */
+
+DWORD WINAPI end_thread(            /* end notice thread entry point        */
+    LPVOID              parameter   /* not used                             */
+);                                  /* returns 0                            */
+
+LRESULT CALLBACK end_window(        /* hidden window procedure              */
+    HWND                window,     /* hidden window                        */
+    UINT                message,    /* message                              */
+    WPARAM              wparam,     /* message parameter                    */
+    LPARAM              lparam      /* message parameter                    */
+);                                  /* returns message result               */
+
+void fill_properties(               /* describe the trace session           */
+    events_properties_type*
+                        properties  /* properties to fill                   */
+);
+
+void name_session(                  /* name a process' trace session        */
+    LPTSTR              name,       /* returned name (PROC_EVENTS_NAME_SIZE */
+                                    /* characters)                          */
+    DWORD               id          /* ID of the process                    */
+);
+
+void queue_change(                  /* queue a start or exit for the caller */
+    proc_events_type*   events,     /* process event subscription           */
+    const proc_change_type*
+                        change      /* start or exit                        */
+);
+
+error_type read_table(              /* cache the whole process table again  */
+    proc_events_type*   events      /* process event subscription           */
+);                                  /* returns error code                   */
+
+void WINAPI receive_event(          /* receive a traced event               */
+    PEVENT_RECORD       record      /* event                                */
+);
+
+BOOL session_owner_running(         /* check for the process that started a */
+                                    /* session                              */
+    DWORD               id          /* ID in the session's name             */
+);                                  /* returns FALSE if the session was     */
+                                    /* left over                            */
+
+error_type start_session(           /* start the trace session              */
+    proc_events_type*   events      /* process event subscription           */
+);                                  /* returns error code                   */
+
+void stop_own_session(              /* stop this process' trace session     */
+    void
+);
+
+void stop_stale_sessions(           /* stop sessions whose process is gone  */
+    void
+);
+
+DWORD WINAPI trace_thread(          /* event delivery thread entry point    */
+    LPVOID              parameter   /* process event subscription           */
+);                                  /* returns 0                            */
+
+void watch_process_end(             /* stop the session when the process is */
+                                    /* ended                                */
+    void
+);
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static const GUID provider = {
+    0x22FB2CD6, 0x0E7B, 0x422B,
+    { 0xA0, 0xC7, 0x2F, 0xAD, 0x1F, 0xD0, 0xE7, 0x16 }
+};                                  /* Microsoft-Windows-Kernel-Process     */
+
+static volatile LONG watching = 0;  /* the end of the process is watched    */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type proc_events_apply(       /* bring the cache up to date           */
+    proc_events_type*   events      /* process event subscription           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_change_type*   change;     /* current change                       */
+    ULONG               dropped;    /* events the session has lost          */
+    DWORD               i;          /* change index                         */
+    BOOL                lost;       /* the cache must be read again         */
+    events_properties_type
+                        properties; /* trace session statistics             */
+    error_type          result;     /* result of applying a change          */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( events == NULL ) || ( events->session == 0 ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Find out whether the session lost events since the cache was read.
+    ------------------------------------------------------------------*/
+    fill_properties( &properties );
+    dropped = events->dropped;
+    if( ControlTrace(
+            events->session,
+            NULL,
+            &( properties.properties ),
+            EVENT_TRACE_CONTROL_QUERY
+        ) == ERROR_SUCCESS ) {
+        dropped = properties.properties.EventsLost
+                + properties.properties.RealTimeBuffersLost;
+    }
+
+    /*------------------------------------------------------------------
+    Apply the queued starts and exits, in the order they happened.
+    ------------------------------------------------------------------*/
+    EnterCriticalSection( &( events->lock ) );
+    lost = ( ( events->lost != FALSE ) || ( dropped != events->dropped ) )
+         ? TRUE : FALSE;
+    for( i = 0; ( lost == FALSE ) && ( i < events->count ); ++i ) {
+        change = &( events->changes[ i ] );
+        if( change->started != FALSE ) {
+            result = proc_cache_insert(
+                events->instance,
+                &( change->record )
+            );
+            lost   = ( result != ERR_OK ) ? TRUE : FALSE;
+        }
+        else {
+            proc_cache_remove(
+                events->instance,
+                change->record.id,
+                &( change->record.start_time )
+            );
+        }
+    }
+    events->count = 0;
+    events->lost  = FALSE;
+    ResetEvent( events->ready );
+    LeaveCriticalSection( &( events->lock ) );
+
+    /*------------------------------------------------------------------
+    When changes were lost, read the whole table instead (and again
+    next time, if that fails).  Changes queued while it is read are
+    applied next time, and those the table already shows change
+    nothing.
+    ------------------------------------------------------------------*/
+    if( lost == FALSE ) {
+        return ERR_OK;
+    }
+    events->dropped = dropped;
+    result          = read_table( events );
+    if( result != ERR_OK ) {
+        EnterCriticalSection( &( events->lock ) );
+        events->lost = TRUE;
+        LeaveCriticalSection( &( events->lock ) );
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+void proc_events_close(             /* stop following process events        */
+    proc_events_type*   events      /* process event subscription           */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    events_properties_type
+                        properties; /* trace session properties             */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( events == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Stop the session, which ends the delivery of events, and wait for
+    the delivery thread to finish.
+    ------------------------------------------------------------------*/
+    if( events->session != 0 ) {
+        fill_properties( &properties );
+        ControlTrace(
+            events->session,
+            NULL,
+            &( properties.properties ),
+            EVENT_TRACE_CONTROL_STOP
+        );
+    }
+    if( events->trace != INVALID_PROCESSTRACE_HANDLE ) {
+        CloseTrace( events->trace );
+    }
+    if( events->thread != NULL ) {
+        WaitForSingleObject( events->thread, INFINITE );
+        CloseHandle( events->thread );
+    }
+
+    /*------------------------------------------------------------------
+    The cache is no longer kept current.
+    ------------------------------------------------------------------*/
+    if( events->instance != NULL ) {
+        events->instance->cache.current = FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Release the queue.
+    ------------------------------------------------------------------*/
+    if( events->ready != NULL ) {
+        DeleteCriticalSection( &( events->lock ) );
+        CloseHandle( events->ready );
+    }
+    if( events->changes != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) events->changes );
+    }
+    memset( events, 0, sizeof( proc_events_type ) );
+    events->trace = INVALID_PROCESSTRACE_HANDLE;
+
+}
+
+
+/*==========================================================================*/
+error_type proc_events_decode(      /* read a traced process start or exit  */
+    const EVENT_RECORD* record,     /* traced event                         */
+    proc_change_type*   change      /* returned start or exit               */
+) {                                 /* returns error code (ERR_NOT_FOUND if */
+                                    /* it is neither, ERR_FORMAT if its     */
+                                    /* fields are cut short)                */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const BYTE*         data;       /* event's fields                       */
+    USHORT              id;         /* event's kind                         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( record == NULL ) || ( change == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Only the process provider's starts and exits are decoded.
+    ------------------------------------------------------------------*/
+    id = record->EventHeader.EventDescriptor.Id;
+    if( ( IsEqualGUID( &( record->EventHeader.ProviderId ), &provider )
+          == FALSE )
+     || ( ( id != EVENTS_START ) && ( id != EVENTS_STOP ) ) ) {
+        return ERR_NOT_FOUND;
+    }
+    if( ( record->UserData == NULL ) || ( record->UserDataLength < 12 ) ) {
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Both events start with the process ID and its creation time.  A
+    start goes on with the parent's ID and the session ID.  The fields
+    are not aligned, so they are copied out.
+    ------------------------------------------------------------------*/
+    data = ( const BYTE* ) record->UserData;
+    memset( change, 0, sizeof( proc_change_type ) );
+    change->started      = ( id == EVENTS_START ) ? TRUE : FALSE;
+    change->record.owner = PROC_SNAPSHOT_NONE;
+    memcpy( &( change->record.id ), data, sizeof( DWORD ) );
+    memcpy( &( change->record.start_time ), ( data + 4 ),
+            sizeof( FILETIME ) );
+    if( ( change->started != FALSE ) && ( record->UserDataLength >= 20 ) ) {
+        memcpy( &( change->record.parent ), ( data + 12 ), sizeof( DWORD ) );
+        memcpy( &( change->record.session ), ( data + 16 ),
+                sizeof( DWORD ) );
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_events_open(        /* cache every process, and follow      */
+                                    /* their starts and exits               */
+    proc_events_type*   events,     /* subscription object to initialize    */
+    proc_instance_type* instance    /* process information instance         */
+) {                                 /* returns error code (ERR_WINAPI if    */
+                                    /* events can not be traced, e.g.       */
+                                    /* without the rights to trace)         */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    EVENT_TRACE_LOGFILE logfile;    /* events to deliver, and to whom       */
+    error_type          result;     /* result of internal operation         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( events == NULL ) || ( instance == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( events, 0, sizeof( proc_events_type ) );
+    events->instance = instance;
+    events->trace    = INVALID_PROCESSTRACE_HANDLE;
+
+    /*------------------------------------------------------------------
+    Create the queue.
+    ------------------------------------------------------------------*/
+    events->ready = CreateEvent( NULL, TRUE, FALSE, NULL );
+    if( events->ready == NULL ) {
+        return ERR_WINAPI;
+    }
+    InitializeCriticalSection( &( events->lock ) );
+
+    /*------------------------------------------------------------------
+    Start the session, and deliver its events on a thread of their own.
+    ------------------------------------------------------------------*/
+    result = start_session( events );
+    if( result == ERR_OK ) {
+        memset( &logfile, 0, sizeof( EVENT_TRACE_LOGFILE ) );
+        logfile.LoggerName          = events->name;
+        logfile.ProcessTraceMode    = ( PROCESS_TRACE_MODE_REAL_TIME
+                                      | PROCESS_TRACE_MODE_EVENT_RECORD );
+        logfile.EventRecordCallback = receive_event;
+        logfile.Context             = ( PVOID ) events;
+        events->trace = OpenTrace( &logfile );
+        if( events->trace == INVALID_PROCESSTRACE_HANDLE ) {
+            result = ERR_WINAPI;
+        }
+    }
+    if( result == ERR_OK ) {
+        events->thread = CreateThread(
+            NULL,
+            0,
+            trace_thread,
+            ( LPVOID ) events,
+            0,
+            NULL
+        );
+        if( events->thread == NULL ) {
+            result = ERR_WINAPI;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Read the table once, after events are being followed, so no start
+    or exit falls in between.  Those that happened while it was read
+    change nothing when they are applied.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        result = read_table( events );
+    }
+    if( result != ERR_OK ) {
+        proc_events_close( events );
+        return result;
+    }
+    instance->cache.current = TRUE;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL WINAPI end_console(            /* stop the session as the console ends */
+    DWORD               type        /* CTRL_* event                         */
+) {                                 /* returns FALSE to end the process     */
+
+    /*------------------------------------------------------------------
+    The default handler ends the process on every console event, so
+    the session is stopped first.
+    ------------------------------------------------------------------*/
+    stop_own_session();
+    return FALSE;
+}
+
+
+/*==========================================================================*/
+DWORD WINAPI end_thread(            /* end notice thread entry point        */
+    LPVOID              parameter   /* not used                             */
+) {                                 /* returns 0                            */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    WNDCLASS            window_class;
+                                    /* hidden window's class                */
+    MSG                 message;    /* message to dispatch                  */
+    HWND                window;     /* hidden window                        */
+
+    /*------------------------------------------------------------------
+    A program without a console only hears of the end of the Windows
+    session, or of a request to close it, through its top-level
+    windows.  A hidden one is enough.
+    ------------------------------------------------------------------*/
+    memset( &window_class, 0, sizeof( WNDCLASS ) );
+    window_class.lpfnWndProc   = end_window;
+    window_class.hInstance     = GetModuleHandle( NULL );
+    window_class.lpszClassName = PROC_EVENTS_NAME;
+    if( RegisterClass( &window_class ) == 0 ) {
+        return 0;
+    }
+    window = CreateWindow(
+        PROC_EVENTS_NAME,
+        PROC_EVENTS_NAME,
+        WS_OVERLAPPED,
+        0,
+        0,
+        0,
+        0,
+        NULL,
+        NULL,
+        window_class.hInstance,
+        NULL
+    );
+    if( window == NULL ) {
+        return 0;
+    }
+
+    /*------------------------------------------------------------------
+    Dispatch messages for as long as the process runs.
+    ------------------------------------------------------------------*/
+    while( GetMessage( &message, NULL, 0, 0 ) > 0 ) {
+        DispatchMessage( &message );
+    }
+    return 0;
+}
+
+
+/*==========================================================================*/
+LRESULT CALLBACK end_window(        /* hidden window procedure              */
+    HWND                window,     /* hidden window                        */
+    UINT                message,    /* message                              */
+    WPARAM              wparam,     /* message parameter                    */
+    LPARAM              lparam      /* message parameter                    */
+) {                                 /* returns message result               */
+
+    /*------------------------------------------------------------------
+    At log off or shut down, the process is ended once WM_ENDSESSION
+    returns.  A request to close the process (e.g. taskkill without
+    /F) ends it the way closing its console would.
+    ------------------------------------------------------------------*/
+    if( ( message == WM_ENDSESSION ) && ( wparam != FALSE ) ) {
+        stop_own_session();
+        return 0;
+    }
+    if( message == WM_CLOSE ) {
+        stop_own_session();
+        ExitProcess( 0 );
+    }
+    return DefWindowProc( window, message, wparam, lparam );
+}
+
+
+/*==========================================================================*/
+void fill_properties(               /* describe the trace session           */
+    events_properties_type*
+                        properties  /* properties to fill                   */
+) {
+
+    /*------------------------------------------------------------------
+    The session is real-time only, and flushes its buffers often, so a
+    start is seen within milliseconds.  The name is filled in by the
+    system.
+    ------------------------------------------------------------------*/
+    memset( properties, 0, sizeof( events_properties_type ) );
+    properties->properties.Wnode.BufferSize    = sizeof(
+        events_properties_type
+    );
+    properties->properties.Wnode.Flags         = WNODE_FLAG_TRACED_GUID;
+    properties->properties.Wnode.ClientContext = 1;
+    properties->properties.LogFileMode         = (
+        EVENT_TRACE_REAL_TIME_MODE | EVENT_TRACE_USE_MS_FLUSH_TIMER
+    );
+    properties->properties.FlushTimer          = PROC_EVENTS_FLUSH;
+    properties->properties.LoggerNameOffset    = sizeof(
+        EVENT_TRACE_PROPERTIES
+    );
+
+}
+
+
+/*==========================================================================*/
+void name_session(                  /* name a process' trace session        */
+    LPTSTR              name,       /* returned name (PROC_EVENTS_NAME_SIZE */
+                                    /* characters)                          */
+    DWORD               id          /* ID of the process                    */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    TCHAR               digits[ 16 ];
+                                    /* process ID                           */
+
+    /*------------------------------------------------------------------
+    The session is named for the process that starts it.
+    ------------------------------------------------------------------*/
+    _ultot( id, digits, 10 );
+    _tcscpy( name, PROC_EVENTS_NAME );
+    _tcscat( name, _T( " " ) );
+    _tcscat( name, digits );
+
+}
+
+
+/*==========================================================================*/
+void queue_change(                  /* queue a start or exit for the caller */
+    proc_events_type*   events,     /* process event subscription           */
+    const proc_change_type*
+                        change      /* start or exit                        */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* new number of changes allocated      */
+    proc_change_type*   changes;    /* grown queue                          */
+
+    /*------------------------------------------------------------------
+    A caller that has not applied the changes for a long time reads the
+    table again instead.
+    ------------------------------------------------------------------*/
+    EnterCriticalSection( &( events->lock ) );
+    if( events->count >= PROC_EVENTS_LIMIT ) {
+        events->count = 0;
+        events->lost  = TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    Grow the queue when it is full.  A change that does not fit is
+    lost, like the changes before it.
+    ------------------------------------------------------------------*/
+    if( events->count == events->capacity ) {
+        capacity = ( events->capacity > 0 ) ? ( events->capacity * 2 )
+                 : EVENTS_MIN_CHANGES;
+        changes  = ( events->changes == NULL )
+                 ? ( proc_change_type* ) HeapAlloc(
+                     GetProcessHeap(),
+                     0,
+                     ( capacity * sizeof( proc_change_type ) )
+                 )
+                 : ( proc_change_type* ) HeapReAlloc(
+                     GetProcessHeap(),
+                     0,
+                     ( LPVOID ) events->changes,
+                     ( capacity * sizeof( proc_change_type ) )
+                 );
+        if( changes != NULL ) {
+            events->changes  = changes;
+            events->capacity = capacity;
+        }
+    }
+    if( events->count < events->capacity ) {
+        events->changes[ events->count ] = *change;
+        events->count += 1;
+    }
+    else {
+        events->count = 0;
+        events->lost  = TRUE;
+    }
+    SetEvent( events->ready );
+    LeaveCriticalSection( &( events->lock ) );
+
+}
+
+
+/*==========================================================================*/
+error_type read_table(              /* cache the whole process table again  */
+    proc_events_type*   events      /* process event subscription           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    error_type          result;     /* result of internal operation         */
+    proc_snapshot_type  snapshot;   /* every running process                */
+
+    /*------------------------------------------------------------------
+    Merge a snapshot of every process into the cache.  What was read
+    from processes that are still running is kept.
+    ------------------------------------------------------------------*/
+    result = proc_snapshot_take( events->instance, &snapshot );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    result = proc_cache_update( events->instance, &snapshot );
+    proc_snapshot_free( &snapshot );
+    return result;
+}
+
+
+/*==========================================================================*/
+void WINAPI receive_event(          /* receive a traced event               */
+    PEVENT_RECORD       record      /* event                                */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_change_type    change;     /* start or exit                        */
+
+    /*------------------------------------------------------------------
+    Only starts and exits are wanted.
+    ------------------------------------------------------------------*/
+    if( proc_events_decode( record, &change ) == ERR_OK ) {
+        queue_change( ( proc_events_type* ) record->UserContext, &change );
+    }
+
+}
+
+
+/*==========================================================================*/
+BOOL session_owner_running(         /* check for the process that started a */
+                                    /* session                              */
+    DWORD               id          /* ID in the session's name             */
+) {                                 /* returns FALSE if the session was     */
+                                    /* left over                            */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               code;       /* process' exit code                   */
+    TCHAR               image[ MAX_PATH ];
+                                    /* image of the process with the ID     */
+    LPCTSTR             image_name; /* file name of that image              */
+    DWORD               length;     /* length of the image path             */
+    TCHAR               own[ MAX_PATH ];
+                                    /* this program's image                 */
+    LPCTSTR             own_name;   /* file name of this program's image    */
+    HANDLE              process;    /* process with the ID                  */
+    BOOL                running;    /* the session's process is running     */
+
+    /*------------------------------------------------------------------
+    No process has the ID any longer.  A process that can not be looked
+    at (another user's) is left alone.
+    ------------------------------------------------------------------*/
+    process = OpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE, id );
+    if( process == NULL ) {
+        return ( GetLastError() == ERROR_INVALID_PARAMETER ) ? FALSE : TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    The ID may have been taken by another program since.  Only a copy
+    of this program that is still running owns the session.
+    ------------------------------------------------------------------*/
+    running = ( ( GetExitCodeProcess( process, &code ) != FALSE )
+             && ( code == STILL_ACTIVE ) ) ? TRUE : FALSE;
+    length  = MAX_PATH;
+    if( ( running != FALSE )
+     && ( QueryFullProcessImageName( process, 0, image, &length ) != FALSE )
+     && ( GetModuleFileName( NULL, own, MAX_PATH ) != 0 ) ) {
+        image_name = _tcsrchr( image, _T( '\\' ) );
+        own_name   = _tcsrchr( own, _T( '\\' ) );
+        image_name = ( image_name != NULL ) ? ( image_name + 1 ) : image;
+        own_name   = ( own_name != NULL ) ? ( own_name + 1 ) : own;
+        running    = ( _tcsicmp( image_name, own_name ) == 0 )
+                   ? TRUE : FALSE;
+    }
+    CloseHandle( process );
+    return running;
+}
+
+
+/*==========================================================================*/
+error_type start_session(           /* start the trace session              */
+    proc_events_type*   events      /* process event subscription           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    events_properties_type
+                        properties; /* trace session properties             */
+    ULONG               status;     /* result of a trace call               */
+
+    /*------------------------------------------------------------------
+    Stop the sessions of processes that were ended without stopping
+    them.
+    ------------------------------------------------------------------*/
+    stop_stale_sessions();
+
+    /*------------------------------------------------------------------
+    Each process has a session of its own.  A session with this name
+    can only be left over from an earlier process with the same ID, so
+    it is stopped and replaced.
+    ------------------------------------------------------------------*/
+    name_session( events->name, GetCurrentProcessId() );
+    fill_properties( &properties );
+    status = StartTrace( &( events->session ), events->name,
+                         &( properties.properties ) );
+    if( status == ERROR_ALREADY_EXISTS ) {
+        ControlTrace(
+            0,
+            events->name,
+            &( properties.properties ),
+            EVENT_TRACE_CONTROL_STOP
+        );
+        fill_properties( &properties );
+        status = StartTrace( &( events->session ), events->name,
+                             &( properties.properties ) );
+    }
+    if( status != ERROR_SUCCESS ) {
+        events->session = 0;
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Stop the session if the process is ended before it is closed.
+    ------------------------------------------------------------------*/
+    watch_process_end();
+
+    /*------------------------------------------------------------------
+    Ask the kernel's process provider for its process events.
+    ------------------------------------------------------------------*/
+    status = EnableTraceEx2(
+        events->session,
+        &provider,
+        EVENT_CONTROL_CODE_ENABLE_PROVIDER,
+        TRACE_LEVEL_INFORMATION,
+        EVENTS_KEYWORD,
+        0,
+        0,
+        NULL
+    );
+    return ( status == ERROR_SUCCESS ) ? ERR_OK : ERR_WINAPI;
+}
+
+
+/*==========================================================================*/
+void stop_own_session(              /* stop this process' trace session     */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    TCHAR               name[ PROC_EVENTS_NAME_SIZE ];
+                                    /* session name                         */
+    events_properties_type
+                        properties; /* trace session properties             */
+
+    /*------------------------------------------------------------------
+    Stop the session by name, since the process is about to end on
+    another thread.  Without a session, nothing happens.
+    ------------------------------------------------------------------*/
+    name_session( name, GetCurrentProcessId() );
+    fill_properties( &properties );
+    ControlTrace(
+        0,
+        name,
+        &( properties.properties ),
+        EVENT_TRACE_CONTROL_STOP
+    );
+
+}
+
+
+/*==========================================================================*/
+void stop_stale_sessions(           /* stop sessions whose process is gone  */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    ULONG               count;      /* number of running sessions           */
+    LPTSTR              end;        /* end of the ID in a session's name    */
+    HANDLE              heap;       /* current process' heap handle         */
+    ULONG               i;          /* session index                        */
+    DWORD               id;         /* ID in a session's name               */
+    PEVENT_TRACE_PROPERTIES
+                        list[ EVENTS_MAX_SESSIONS ];
+                                    /* properties of each session           */
+    LPTSTR              name;       /* a session's name                     */
+    size_t              prefix;     /* length of PROC_EVENTS_NAME           */
+    events_properties_type
+                        properties; /* properties to stop a session         */
+    events_query_type*  queries;    /* room for each session's properties   */
+    ULONG               status;     /* result of a trace call               */
+
+    /*------------------------------------------------------------------
+    List the running sessions.  Only the first few are looked at if
+    there are more.
+    ------------------------------------------------------------------*/
+    heap    = GetProcessHeap();
+    queries = ( events_query_type* ) HeapAlloc(
+        heap,
+        HEAP_ZERO_MEMORY,
+        ( EVENTS_MAX_SESSIONS * sizeof( events_query_type ) )
+    );
+    if( queries == NULL ) {
+        return;
+    }
+    for( i = 0; i < EVENTS_MAX_SESSIONS; ++i ) {
+        queries[ i ].properties.Wnode.BufferSize = sizeof(
+            events_query_type
+        );
+        queries[ i ].properties.LoggerNameOffset  = FIELD_OFFSET(
+            events_query_type,
+            name
+        );
+        queries[ i ].properties.LogFileNameOffset = FIELD_OFFSET(
+            events_query_type,
+            file
+        );
+        list[ i ] = &( queries[ i ].properties );
+    }
+    count  = 0;
+    status = QueryAllTraces( list, EVENTS_MAX_SESSIONS, &count );
+    if( ( status != ERROR_SUCCESS ) && ( status != ERROR_MORE_DATA ) ) {
+        count = 0;
+    }
+
+    /*------------------------------------------------------------------
+    Stop every session named for a process other than this one, when
+    that process is no longer a running copy of this program.
+    ------------------------------------------------------------------*/
+    prefix = _tcslen( PROC_EVENTS_NAME );
+    for( i = 0; ( i < count ) && ( i < EVENTS_MAX_SESSIONS ); ++i ) {
+        name = queries[ i ].name;
+        if( ( _tcsncmp( name, PROC_EVENTS_NAME, prefix ) != 0 )
+         || ( name[ prefix ] != _T( ' ' ) ) ) {
+            continue;
+        }
+        id = ( DWORD ) _tcstoul( &( name[ prefix + 1 ] ), &end, 10 );
+        if( ( *end != _T( '\0' ) ) || ( id == GetCurrentProcessId() )
+         || ( session_owner_running( id ) != FALSE ) ) {
+            continue;
+        }
+        fill_properties( &properties );
+        ControlTrace(
+            0,
+            name,
+            &( properties.properties ),
+            EVENT_TRACE_CONTROL_STOP
+        );
+    }
+    HeapFree( heap, 0, ( LPVOID ) queries );
+
+}
+
+
+/*==========================================================================*/
+DWORD WINAPI trace_thread(          /* event delivery thread entry point    */
+    LPVOID              parameter   /* process event subscription           */
+) {                                 /* returns 0                            */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_events_type*   events;     /* process event subscription           */
+
+    /*------------------------------------------------------------------
+    Deliver events until the session is stopped.
+    ------------------------------------------------------------------*/
+    events = ( proc_events_type* ) parameter;
+    ProcessTrace( &( events->trace ), 1, NULL, NULL );
+    return 0;
+}
+
+
+/*==========================================================================*/
+void watch_process_end(             /* stop the session when the process is */
+                                    /* ended                                */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              thread;     /* hidden window's thread               */
+
+    /*------------------------------------------------------------------
+    Watch once per process.  A console's events reach the handler.
+    Everything else reaches a hidden window, on a thread of its own
+    that runs until the process ends.
+    ------------------------------------------------------------------*/
+    if( InterlockedExchange( &watching, 1 ) != 0 ) {
+        return;
+    }
+    SetConsoleCtrlHandler( end_console, TRUE );
+    thread = CreateThread( NULL, 0, end_thread, NULL, 0, NULL );
+    if( thread != NULL ) {
+        CloseHandle( thread );
+    }
+
+}
@@ -16,16 +16,63 @@ Includes
 #include <windows.h>
 #include <tchar.h>
 
+#include "proc_args.h"
+#include "proc_cache.h"
 #include "proc_info.h"
 
 /*----------------------------------------------------------------------------
 Macros
 ----------------------------------------------------------------------------*/
 
+#define PROC_STRING_LOCAL   ( 1024 )
+                                    /* local storage for NT string queries  */
+
+#define PROC_COMMAND_LINE_INFORMATION \
+                            ( ( PROCESSINFOCLASS ) 60 )
+                                    /* direct command line query class      */
+
+#define PROC_SPAN_LIMIT     ( 64 * 1024 )
+                                    /* largest single remote string read    */
+
+#define PROC_ACCESS_LIMITED PROCESS_QUERY_LIMITED_INFORMATION
+                                    /* access for image, times, and token   */
+
+#define PROC_ACCESS_PARAMETERS \
+                            ( PROCESS_QUERY_INFORMATION | PROCESS_VM_READ )
+                                    /* access for reading the parameters    */
+
 /*----------------------------------------------------------------------------
 Types and Structures
 ----------------------------------------------------------------------------*/
 
+typedef struct proc_nt_string_s {   /* NT string query result type          */
+    PUNICODE_STRING     string;     /* queried string                       */
+    LPBYTE              heap;       /* heap storage for long results        */
+    ULONGLONG           local[ PROC_STRING_LOCAL / sizeof( ULONGLONG ) ];
+                                    /* local storage for typical results    */
+} proc_nt_string_type;
+
+typedef struct proc_parameters_s {  /* leading remote process parameters    */
+    ULONG               maximum_length;
+                                    /* allocated size of parameters         */
+    ULONG               length;     /* used size of parameters              */
+    ULONG               flags;      /* parameter flags                      */
+    ULONG               debug_flags;/* debugging flags                      */
+    HANDLE              console;    /* console handle                       */
+    ULONG               console_flags;
+                                    /* console flags                        */
+    HANDLE              input;      /* standard input handle                */
+    HANDLE              output;     /* standard output handle               */
+    HANDLE              error;      /* standard error handle                */
+    UNICODE_STRING      directory;  /* current directory path               */
+    HANDLE              directory_handle;
+                                    /* current directory handle             */
+    UNICODE_STRING      dll_path;   /* DLL search path                      */
+    UNICODE_STRING      image_path; /* image path name                      */
+    UNICODE_STRING      command_line;
+                                    /* command line                         */
+} proc_parameters_type;
+
 /*----------------------------------------------------------------------------
 Memory Constants
 ----------------------------------------------------------------------------*/
@@ -38,16 +85,92 @@ Module Variables
 Module Prototypes
 ----------------------------------------------------------------------------*/
 
+error_type alloc_command(           /* get memory for a command object      */
+    proc_info_type*     info,       /* process information object           */
+    SIZE_T              size,       /* total size of the command object     */
+    proc_alloc_t32      alloc,      /* memory allocation specification      */
+    proc_command_type** command     /* user's command object memory         */
+);                                  /* returns error code                   */
+
+error_type build_command(           /* build a single-block command object  */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     image,      /* process' image file name             */
+    PUNICODE_STRING     line,       /* raw command line, or NULL            */
+    PUNICODE_STRING     directory,  /* current directory, or NULL           */
+    proc_alloc_t32      alloc,      /* memory allocation specification      */
+    proc_command_type** command     /* user's command object memory         */
+);                                  /* returns error code                   */
+
+DWORD copy_unicode(                 /* copy a UTF-16 string to a TCHAR one  */
+    LPTSTR              target,     /* destination string                   */
+    SIZE_T              size,       /* size of destination (bytes)          */
+    LPCWSTR             source,     /* source string                        */
+    DWORD               length      /* length of source (characters)        */
+);                                  /* returns characters written, with NUL */
+
 void enable_process_debugging(      /* attempt to enable debugging features */
     void
 );
 
-error_type get_image(               /* get the process' image file name     */
+error_type ensure_access(           /* make sure the handle has some rights */
     proc_info_type*     info,       /* process information object           */
-    LPTSTR              image,      /* pointer to target string             */
-    proc_alloc_t32      alloc       /* memory allocation specification      */
+    DWORD               access      /* access rights required               */
+);                                  /* returns error code                   */
+
+error_type ensure_token(            /* make sure the process token is open  */
+    proc_info_type*     info        /* process information object           */
+);                                  /* returns error code                   */
+
+error_type load_command(            /* load the command and directory       */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     image,      /* process' image file name             */
+    BOOL                directory,  /* the directory is required            */
+    proc_alloc_t32      alloc,      /* memory allocation specification      */
+    proc_command_type** command,    /* user's command object memory         */
+    BOOL*               read        /* set if the directory was read, or    */
+                                    /* NULL                                 */
+);                                  /* returns error code                   */
+
+error_type load_image(              /* load the image name as a string      */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     image       /* process' image file name             */
+);                                  /* returns error code                   */
+
+error_type load_user(               /* lazy-load the process' user info     */
+    proc_info_type*     info        /* process information object           */
+);                                  /* returns error code                   */
+
+error_type query_image(             /* query the image path in DOS form     */
+    proc_info_type*     info,       /* process information object           */
+    proc_nt_string_type*
+                        image       /* query result                         */
+);                                  /* returns error code                   */
+
+error_type query_string(            /* query a string from the process      */
+    proc_info_type*     info,       /* process information object           */
+    PROCESSINFOCLASS    query,      /* string information to query          */
+    proc_nt_string_type*
+                        string      /* query result                         */
 );                                  /* returns error code                   */
 
+error_type read_parameters(         /* read remote command line and dir.    */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     line,       /* returned command line                */
+    PUNICODE_STRING     directory,  /* returned current directory           */
+    proc_nt_string_type*
+                        storage     /* storage for the returned strings     */
+);                                  /* returns error code                   */
+
+void release_string(                /* release an NT string query result    */
+    proc_nt_string_type*
+                        string      /* query result                         */
+);
+
+SIZE_T unicode_size(                /* size of a UTF-16 string as TCHARs    */
+    LPCWSTR             source,     /* source string                        */
+    DWORD               length      /* length of source (characters)        */
+);                                  /* returns bytes needed, with NUL       */
+
 /*----------------------------------------------------------------------------
 Implementation
 ----------------------------------------------------------------------------*/
@@ -64,6 +187,22 @@ void proc_close(                    /* close query interface to process     */
         return;
     }
 
+    /*------------------------------------------------------------------
+    Release queried strings that were not allocated from an arena.  The
+    image name may be part of the command object.
+    ------------------------------------------------------------------*/
+    if( info->arena == NULL ) {
+        if( ( info->image != NULL )
+         && ( ( info->command == NULL )
+           || ( info->image != info->command->image ) ) ) {
+            HeapFree( GetProcessHeap(), 0, ( LPVOID ) info->image );
+        }
+        proc_free_command( info->command );
+    }
+    info->image   = NULL;
+    info->command = NULL;
+    info->fields  = 0;
+
     /*------------------------------------------------------------------
     Check for allocated user information.
     ------------------------------------------------------------------*/
@@ -97,42 +236,94 @@ void proc_close(                    /* close query interface to process     */
 }
 
 
+/*==========================================================================*/
+void proc_free_command(             /* release an allocated command object  */
+    proc_command_type*  command     /* command from PROC_ALLOC_ALLOCATE     */
+) {
+
+    /*------------------------------------------------------------------
+    The whole command object is a single heap allocation.
+    ------------------------------------------------------------------*/
+    if( command != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) command );
+    }
+
+}
+
+
 /*==========================================================================*/
 error_type proc_get_command(        /* get the command used to start proc.  */
     proc_info_type*     info,       /* process information object           */
-    proc_command_type*  command,    /* user's command object memory         */
+    proc_command_type** command,    /* user's command object memory         */
     proc_alloc_t32      alloc       /* memory allocation specification      */
 ) {                                 /* returns error code                   */
 
     /*------------------------------------------------------
     Local Variables
     ------------------------------------------------------*/
+    proc_nt_string_type image;      /* process' image file name             */
     error_type          result;     /* result of internal operation         */
 
+    /*------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------*/
+    if( ( info == NULL ) || ( command == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------
+    Open the process with limited access.  Loading the
+    command asks for more only if it can use it, so the
+    command line of a protected process is still found.
+    ------------------------------------------------------*/
+    result = ensure_access( info, PROC_ACCESS_LIMITED );
+    if( result != ERR_OK ) {
+        return result;
+    }
+
     /*------------------------------------------------------
     Get the process' image file name.
     ------------------------------------------------------*/
-    result = get_image( info, command->image, alloc );
+    result = query_image( info, &image );
     if( result != ERR_OK ) {
         return result;
     }
 
-    //ZIH - implement me
+    /*------------------------------------------------------
+    Load the command object.
+    ------------------------------------------------------*/
+    result = load_command(
+        info,
+        image.string,
+        TRUE,
+        alloc,
+        command,
+        NULL
+    );
+
+    /*------------------------------------------------------
+    Release the query result.
+    ------------------------------------------------------*/
+    release_string( &image );
+
+    /*------------------------------------------------------
+    Return the result of loading the command.
+    ------------------------------------------------------*/
+    return result;
 }
 
 
 /*==========================================================================*/
 error_type proc_get_user_sid(       /* get the process' user SID            */
     proc_info_type*     info,       /* process information object           */
-    PSID                sid         /* pointer to destination SID variable  */
+    PSID                sid         /* destination SID variable, at least   */
+                                    /* SECURITY_MAX_SID_SIZE bytes          */
 ) {                                 /* returns error code                   */
 
     /*------------------------------------------------------------------
     Local Variables
     ------------------------------------------------------------------*/
-    DWORD               return_length;
-                                    /* data length return variable          */
-    BOOL                wresult;    /* result of Windows API calls          */
+    error_type          result;     /* result of internal operation         */
 
     /*------------------------------------------------------------------
     Check interface usage.
@@ -142,60 +333,21 @@ error_type proc_get_user_sid(       /* get the process' user SID            */
     }
 
     /*------------------------------------------------------------------
-    See if we need to lazy-load the user info.
+    Lazy-load the user info.
     ------------------------------------------------------------------*/
-    if( info->user == NULL ) {
-
-        /*--------------------------------------------------------------
-        Perform a dummy query to fetch the size of the user info data.
-        --------------------------------------------------------------*/
-        return_length = 0;
-        wresult = GetTokenInformation(
-            info->token,
-            TokenUser,
-            ( LPVOID ) info->user,
-            0,
-            &return_length
-        );
-        if( ( wresult == FALSE )
-         && ( GetLastError() != ERROR_INSUFFICIENT_BUFFER ) ) {
-            return ERR_WINAPI;
-        }
-
-        /*------------------------------------------------------------------
-        Allocate heap space for the user info data.
-        ------------------------------------------------------------------*/
-        info->user = ( PTOKEN_USER ) HeapAlloc(
-            GetProcessHeap(),
-            HEAP_ZERO_MEMORY,
-            return_length
-        );
-        if( info->user == NULL ) {
-            return ERR_ALLOC;
-        }
-
-        /*--------------------------------------------------------------
-        Perform the real query to retrieve the user information.
-        --------------------------------------------------------------*/
-        wresult = GetTokenInformation(
-            info->token,
-            TokenUser,
-            ( LPVOID ) info->user,
-            return_length,
-            &return_length
-        );
-        if( wresult == FALSE ) {
-            HeapFree( GetProcessHeap(), 0, ( LPVOID ) info->user );
-            info->user = NULL;
-            return ERR_WINAPI;
-        }
-
+    result = load_user( info );
+    if( result != ERR_OK ) {
+        return result;
     }
 
     /*------------------------------------------------------------------
     Load the process' SID into the user's memory.
     ------------------------------------------------------------------*/
-    memcpy( sid, info->user->User.Sid, sizeof( SID ) );
+    CopySid(
+        GetLengthSid( info->user->User.Sid ),
+        sid,
+        info->user->User.Sid
+    );
 
     /*------------------------------------------------------------------
     Return success.
@@ -213,6 +365,7 @@ error_type proc_init(               /* initialize an interface instance     */
     Local Variables
     ------------------------------------------------------------------*/
     HINSTANCE           ntdll;      /* link to NT dll library         */
+    BOOL                wresult;    /* result of Windows API calls          */
 
     /*------------------------------------------------------------------
     Initialize local variables.
@@ -226,6 +379,17 @@ error_type proc_init(               /* initialize an interface instance     */
         return ERR_USAGE;
     }
 
+    /*------------------------------------------------------------------
+    Start with an empty owner SID table, volume translation table, and
+    process cache.
+    ------------------------------------------------------------------*/
+    proc_sid_init( &( instance->sids ) );
+    proc_volume_init( &( instance->volumes ) );
+    instance->cache.entries  = NULL;
+    instance->cache.count    = 0;
+    instance->cache.capacity = 0;
+    instance->cache.current  = FALSE;
+
     /*------------------------------------------------------------------
     Dynamically link the "Ntdll.dll" library.
     ------------------------------------------------------------------*/
@@ -246,11 +410,32 @@ error_type proc_init(               /* initialize an interface instance     */
         return ERR_WINAPI;
     }
 
+    /*------------------------------------------------------------------
+    Retrieve the entry point for the system query function.
+    ------------------------------------------------------------------*/
+    instance->nqsi = ( proc_NtQuerySystemInformation_fun ) GetProcAddress(
+        ntdll,
+        _T( "NtQuerySystemInformation" )
+    );
+    if( instance->nqsi == NULL ) {
+        FreeLibrary( ntdll );
+        return ERR_WINAPI;
+    }
+
     /*------------------------------------------------------------------
     Release the handle to the dynamic library.
     ------------------------------------------------------------------*/
     FreeLibrary( ntdll );
 
+    /*------------------------------------------------------------------
+    Remote process parameters are only readable from a matching
+    architecture, so note when this process runs under WOW64.
+    ------------------------------------------------------------------*/
+    wresult = IsWow64Process( GetCurrentProcess(), &( instance->wow64 ) );
+    if( wresult == FALSE ) {
+        instance->wow64 = FALSE;
+    }
+
     /*------------------------------------------------------------------
     Attempt to enable process debugging.
     ------------------------------------------------------------------*/
@@ -270,11 +455,6 @@ error_type proc_open(               /* open query interface to process      */
     DWORD               id          /* process ID to open                   */
 ) {                                 /* returns error code                   */
 
-    /*------------------------------------------------------------------
-    Local Variables
-    ------------------------------------------------------------------*/
-    BOOL                wresult;    /* result of Windows API calls          */
-
     /*------------------------------------------------------------------
     Check interface usage.
     ------------------------------------------------------------------*/
@@ -283,38 +463,13 @@ error_type proc_open(               /* open query interface to process      */
     }
 
     /*------------------------------------------------------------------
-    Initialize user's memory.
+    Initialize user's memory.  Handles to the process and its token are
+    opened on demand with only the access the requested queries need.
     ------------------------------------------------------------------*/
     memset( info, 0, sizeof( proc_info_type ) );
     info->instance = instance;
     info->id       = id;
 
-    /*------------------------------------------------------------------
-    Open a handle to the requested process.
-    ------------------------------------------------------------------*/
-    info->handle = OpenProcess(
-        ( PROCESS_QUERY_INFORMATION | PROCESS_VM_READ ),
-        FALSE,
-        info->id
-    );
-    if( info->handle == NULL ) {
-        return ERR_WINAPI;
-    }
-
-    /*------------------------------------------------------------------
-    Open a process query token to the requested process.
-    ------------------------------------------------------------------*/
-    wresult = OpenProcessToken(
-        info->handle,
-        TOKEN_QUERY,
-        &( info->token )
-    );
-    if( ( wresult == FALSE ) || ( info->token == NULL ) ) {
-        CloseHandle( info->handle );
-        info->handle = NULL;
-        return ERR_WINAPI;
-    }
-
     /*------------------------------------------------------------------
     Process successfully opened.
     ------------------------------------------------------------------*/
@@ -323,215 +478,631 @@ error_type proc_open(               /* open query interface to process      */
 
 
 /*==========================================================================*/
-void enable_process_debugging(      /* attempt to enable debugging features */
-    void
-) {
+error_type proc_query(              /* load several fields in one pass      */
+    proc_info_type*     info,       /* process information object           */
+    proc_fields_t32     fields      /* mask of PROC_FIELD_* values to load  */
+) {                                 /* returns error code                   */
 
     /*------------------------------------------------------------------
     Local Variables
     ------------------------------------------------------------------*/
-    HANDLE              process_handle;
-                                    /* handle to current process            */
-    HANDLE              token_handle;
-                                    /* handle to process token              */
-    TOKEN_PRIVILEGES    token_privileges;
-                                    /* token privilege object               */
+    DWORD               access;     /* access rights the fields require     */
+    proc_command_type*  command;    /* newly loaded command object          */
+    FILETIME            exit_time;  /* unused process exit time             */
+    BOOL                found;      /* the directory was read               */
+    proc_nt_string_type image;      /* process' image file name             */
+    FILETIME            kernel_time;/* unused process kernel time           */
+    proc_fields_t32     loaded;     /* fields loaded by this query          */
+    proc_command_type*  previous;   /* command loaded by an earlier query   */
+    error_type          result;     /* result of internal operation         */
+    error_type          status;     /* first error seen by this query       */
+    FILETIME            user_time;  /* unused process user time             */
     BOOL                wresult;    /* result of Windows API calls          */
 
     /*------------------------------------------------------------------
-    Initialize local variables.
+    Check interface usage.
     ------------------------------------------------------------------*/
-    memset( &token_privileges, 0, sizeof( token_privileges ) );
+    if( ( info == NULL ) || ( info->instance == NULL ) ) {
+        return ERR_USAGE;
+    }
 
     /*------------------------------------------------------------------
-    Retrieve the handle to the current process.
+    Skip fields that are already loaded.
     ------------------------------------------------------------------*/
-    process_handle = GetCurrentProcess();
+    fields &= ~( info->fields );
+    if( fields == 0 ) {
+        return ERR_OK;
+    }
+    loaded = 0;
+    status = ERR_OK;
 
     /*------------------------------------------------------------------
-    Open a token to the current process.
+    Every field but the session needs limited access.  Reading the
+    directory needs more, which load_command asks for itself, so a
+    protected process still yields its command line.
     ------------------------------------------------------------------*/
-    wresult = OpenProcessToken(
-        process_handle,
-        ( TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY ),
-        &token_handle
-    );
-    if( wresult == FALSE ) {
-        return;
+    access = 0;
+    if( ( fields & ( PROC_FIELD_IMAGE | PROC_FIELD_COMMAND
+                   | PROC_FIELD_DIRECTORY | PROC_FIELD_OWNER
+                   | PROC_FIELD_START ) ) != 0 ) {
+        access |= PROC_ACCESS_LIMITED;
     }
 
     /*------------------------------------------------------------------
-    Retrieve privilege information for the current process.
+    Open the process handle once for every field.
     ------------------------------------------------------------------*/
-    wresult = LookupPrivilegeValue(
-        NULL,
-        SE_DEBUG_NAME,
-        &token_privileges.Privileges[ 0 ].Luid
-    );
-    if( wresult == FALSE ) {
-        CloseHandle( token_handle );
-        return;
+    if( access != 0 ) {
+        result = ensure_access( info, access );
+        if( result != ERR_OK ) {
+            return result;
+        }
     }
 
     /*------------------------------------------------------------------
-    Set desired privilege details to enable additional features.
+    The session ID does not need a handle at all.
     ------------------------------------------------------------------*/
-    token_privileges.PrivilegeCount = 1;
-    token_privileges.Privileges[ 0 ].Attributes = SE_PRIVILEGE_ENABLED;
+    if( ( fields & PROC_FIELD_SESSION ) != 0 ) {
+        wresult = ProcessIdToSessionId( info->id, &( info->session ) );
+        if( wresult != FALSE ) {
+            loaded |= PROC_FIELD_SESSION;
+        }
+        else {
+            status = ERR_WINAPI;
+        }
+    }
 
     /*------------------------------------------------------------------
-    Attempt to allow the current process to retrieve debugging info.
+    Load the process' creation time.
     ------------------------------------------------------------------*/
-    AdjustTokenPrivileges(
-        token_handle,
-        FALSE,
-        &token_privileges,
-        0,
-        ( PTOKEN_PRIVILEGES ) NULL,
-        0
-    );
-    //ZIH - leaving this here for documentation purposes
-    //DWORD error = GetLastError();
-    //if( error != ERROR_SUCCESS ) {
-    //    CloseHandle( token_handle );
-    //    return;
-    //}
+    if( ( fields & PROC_FIELD_START ) != 0 ) {
+        wresult = GetProcessTimes(
+            info->handle,
+            &( info->start_time ),
+            &exit_time,
+            &kernel_time,
+            &user_time
+        );
+        if( wresult != FALSE ) {
+            loaded |= PROC_FIELD_START;
+        }
+        else {
+            status = ERR_WINAPI;
+        }
+    }
 
     /*------------------------------------------------------------------
-    Release the handle to the token.
+    Load the image, command, and directory from one image query.
     ------------------------------------------------------------------*/
-    CloseHandle( token_handle );
-}
+    if( ( fields & ( PROC_FIELD_IMAGE | PROC_FIELD_COMMAND
+                   | PROC_FIELD_DIRECTORY ) ) != 0 ) {
+        result = query_image( info, &image );
+        if( result != ERR_OK ) {
+            status = result;
+        }
 
+        /*--------------------------------------------------------------
+        The command object already holds a copy of the image name.  A
+        directory asked for after the command replaces the command
+        object with one that also holds the directory.  Once an object
+        holds the directory, every object that replaces it must too.
+        --------------------------------------------------------------*/
+        else if( ( fields & ( PROC_FIELD_COMMAND
+                            | PROC_FIELD_DIRECTORY ) ) != 0 ) {
+            command = NULL;
+            found   = FALSE;
+            result  = load_command(
+                info,
+                image.string,
+                ( ( ( fields | info->fields ) & PROC_FIELD_DIRECTORY )
+                  != 0 ),
+                ( ( info->arena != NULL )
+                  ? PROC_ALLOC_ARENA : PROC_ALLOC_ALLOCATE ),
+                &command,
+                &found
+            );
+            if( ( result == ERR_OK ) && ( found == FALSE )
+             && ( ( info->fields & PROC_FIELD_DIRECTORY ) != 0 ) ) {
+                if( info->arena == NULL ) {
+                    proc_free_command( command );
+                }
+                result = ERR_NOT_FOUND;
+            }
+            if( result == ERR_OK ) {
+                previous      = info->command;
+                info->command = command;
+                if( previous != NULL ) {
+                    if( info->image == previous->image ) {
+                        info->image = command->image;
+                    }
+                    if( info->arena == NULL ) {
+                        proc_free_command( previous );
+                    }
+                }
+                loaded |= PROC_FIELD_COMMAND;
+                if( ( fields & PROC_FIELD_IMAGE ) != 0 ) {
+                    info->image = info->command->image;
+                    loaded     |= PROC_FIELD_IMAGE;
+                }
+
+                /*------------------------------------------------------
+                A directory that could not be read is not reported as an
+                empty one.
+                ------------------------------------------------------*/
+                if( found != FALSE ) {
+                    loaded |= fields & PROC_FIELD_DIRECTORY;
+                }
+                else if( ( fields & PROC_FIELD_DIRECTORY ) != 0 ) {
+                    status = ERR_NOT_FOUND;
+                }
+            }
+            else {
+                status = result;
+            }
+        }
 
-/*==========================================================================*/
-error_type get_image(               /* get the process' image file name     */
-    proc_info_type*     info,       /* process information object           */
-    LPTSTR              image,      /* pointer to target string             */
-    proc_alloc_t32      alloc       /* memory allocation specification      */
-) {                                 /* returns error code                   */
+        /*--------------------------------------------------------------
+        Only the image name was requested.
+        --------------------------------------------------------------*/
+        else {
+            result = load_image( info, image.string );
+            if( result == ERR_OK ) {
+                loaded |= PROC_FIELD_IMAGE;
+            }
+            else {
+                status = result;
+            }
+        }
 
-    /*------------------------------------------------------------------
-    Local Variables
-    ------------------------------------------------------------------*/
-    proc_alloc_t32      allocated;  /* memory allocated for user buffers    */
-    HANDLE              heap;       /* current process' heap handle         */
-    UNICODE_STRING      image_file; /* file name of the process' image      */
-    DWORD               return_length;
-                                    /* data length return variable          */
-    NTSTATUS            status;     /* status of NT Windows API calls       */
-    BOOL                wresult;    /* result of Windows API calls          */
+        /*--------------------------------------------------------------
+        Release the image query result.
+        --------------------------------------------------------------*/
+        release_string( &image );
+    }
 
     /*------------------------------------------------------------------
-    Retrieve the necessary length of the image file name.
+    Only owner queries open the process token.
     ------------------------------------------------------------------*/
-    return_length = 0;
-    status = info->instance->nqip(
-        info->handle,
-        ProcessImageFileName,
-        ( PVOID ) &image_file,
-        0,
-        &return_length
-    );
-    if( status != STATUS_INFO_LENGTH_MISMATCH ) {
-        return ERR_WINAPI;
+    if( ( fields & PROC_FIELD_OWNER ) != 0 ) {
+        result = load_user( info );
+        if( result == ERR_OK ) {
+            loaded |= PROC_FIELD_OWNER;
+        }
+        else {
+            status = result;
+        }
     }
 
     /*------------------------------------------------------------------
-    Allocate the buffer to store the image file name.
+    Record the loaded fields, and report any field that failed.
     ------------------------------------------------------------------*/
-    heap = GetProcessHeap();
-    image_file.Buffer = ( PWSTR ) HeapAlloc(
-        heap,
-        HEAP_ZERO_MEMORY,
-        return_length
-    );
-    if( image_file.Buffer == NULL ) {
-        return ERR_ALLOC;
-    }
-    image_file.Length        = return_length;
-    image_file.MaximumLength = return_length;
+    info->fields |= loaded;
+    return status;
+}
+
+
+/*==========================================================================*/
+void proc_term(                     /* release an interface instance        */
+    proc_instance_type* instance    /* process interface instance object    */
+) {
 
     /*------------------------------------------------------------------
-    Retrieve the image file name.
+    Check interface usage.
     ------------------------------------------------------------------*/
-    status = info->instance->nqip(
-        info->handle,
-        ProcessImageFileName,
-        ( PVOID ) &image_file,
-        image_file.Length,
-        &return_length
-    );
-    if( status != STATUS_SUCCESS ) {
-        HeapFree( heap, 0, image_file.Buffer );
-        return ERR_WINAPI;
+    if( instance == NULL ) {
+        return;
     }
 
-    /*------------------------------------------------------
-    Check for need to allocate string buffers.
-    ------------------------------------------------------*/
+    /*------------------------------------------------------------------
+    Close every cached process, and release the owner SID table.
+    ------------------------------------------------------------------*/
+    proc_cache_free( instance );
+    proc_sid_free( &( instance->sids ) );
+
+}
+
+
+/*==========================================================================*/
+error_type alloc_command(           /* get memory for a command object      */
+    proc_info_type*     info,       /* process information object           */
+    SIZE_T              size,       /* total size of the command object     */
+    proc_alloc_t32      alloc,      /* memory allocation specification      */
+    proc_command_type** command     /* user's command object memory         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Allocate the whole object from the process heap.
+    ------------------------------------------------------------------*/
     if( alloc == PROC_ALLOC_ALLOCATE ) {
-        command->image = ( LPTSTR ) HeapAlloc(
-            heap,
+        *command = ( proc_command_type* ) HeapAlloc(
+            GetProcessHeap(),
             HEAP_ZERO_MEMORY,
-            return_length
+            size
         );
-        if( command->image == NULL ) {
-            HeapFree( heap, 0, image_file.Buffer );
+        if( *command == NULL ) {
             return ERR_ALLOC;
         }
-        allocated = return_length;
     }
 
-    /*------------------------------------------------------
-    Not allocating, check user's buffer sizes.
-    ------------------------------------------------------*/
-    else if( alloc < return_length ) {
-        HeapFree( heap, 0, image_file.Buffer );
+    /*------------------------------------------------------------------
+    Allocate the whole object from the user's arena.
+    ------------------------------------------------------------------*/
+    else if( alloc == PROC_ALLOC_ARENA ) {
+        if( info->arena == NULL ) {
+            return ERR_USAGE;
+        }
+        *command = ( proc_command_type* ) proc_arena_alloc(
+            info->arena,
+            size
+        );
+        if( *command == NULL ) {
+            return ERR_ALLOC;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Not allocating, check the user's buffer.
+    ------------------------------------------------------------------*/
+    else if( ( alloc < 0 ) || ( *command == NULL ) ) {
+        return ERR_USAGE;
+    }
+    else if( ( SIZE_T ) alloc < size ) {
         return ERR_OVERFLOW;
     }
 
-    /*------------------------------------------------------
-    User's buffers appear large enough.
-    ------------------------------------------------------*/
-    else {
-        allocated = alloc;
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type build_command(           /* build a single-block command object  */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     image,      /* process' image file name             */
+    PUNICODE_STRING     line,       /* raw command line, or NULL            */
+    PUNICODE_STRING     directory,  /* current directory, or NULL           */
+    proc_alloc_t32      alloc,      /* memory allocation specification      */
+    proc_command_type** command     /* user's command object memory         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_command_type*  block;      /* command object being built           */
+    DWORD               count;      /* number of command line arguments     */
+    DWORD               directory_length;
+                                    /* length of directory (characters)     */
+    LPBYTE              end;        /* end of the command object            */
+    DWORD               i;          /* loop index                           */
+    DWORD               image_length;
+                                    /* length of image name (characters)    */
+    DWORD               line_length;/* length of command line (characters)  */
+    DWORD               offset;     /* offset of current argument           */
+    error_type          result;     /* result of internal operation         */
+    SIZE_T              size;       /* total size of the command object     */
+    LPTSTR              strings;    /* next free string position            */
+    SIZE_T              table_size; /* size of the argument table           */
+    proc_arg_view_type* views;      /* argument views within the table      */
+    DWORD               view_length;/* length of current argument           */
+
+    /*------------------------------------------------------------------
+    Count the arguments without touching the command line.
+    ------------------------------------------------------------------*/
+    image_length     = image->Length / sizeof( WCHAR );
+    line_length      = ( line != NULL )
+                     ? ( line->Length / sizeof( WCHAR ) ) : 0;
+    directory_length = ( directory != NULL )
+                     ? ( directory->Length / sizeof( WCHAR ) ) : 0;
+    count            = proc_args_count(
+        ( ( line != NULL ) ? line->Buffer : NULL ),
+        line_length
+    );
+
+    /*------------------------------------------------------------------
+    The argument table first holds the tokenizer's views, and is then
+    converted in place to string pointers, so it is sized for both.
+    ------------------------------------------------------------------*/
+    table_size = count * max( sizeof( proc_arg_view_type ), sizeof( LPTSTR ) );
+
+    /*------------------------------------------------------------------
+    Size the command object, argument table, and strings as one block.
+    Unescaped arguments are never longer than the raw command line.
+    ------------------------------------------------------------------*/
+    size = FIELD_OFFSET( proc_command_type, values )
+         + table_size
+         + unicode_size( image->Buffer, image_length )
+         + unicode_size(
+               ( ( directory != NULL ) ? directory->Buffer : NULL ),
+               directory_length
+           );
+    if( count > 0 ) {
+        #ifdef UNICODE
+            size += ( line_length + 1 ) * sizeof( WCHAR );
+        #else
+            size += unicode_size( line->Buffer, line_length ) + count;
+        #endif
     }
 
     /*------------------------------------------------------------------
-    Load the image file name into the user's memory.
+    Get the memory for the command object.
+    ------------------------------------------------------------------*/
+    result = alloc_command( info, size, alloc, command );
+    if( result != ERR_OK ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Lay out the image name and directory after the argument table.
+    ------------------------------------------------------------------*/
+    block        = *command;
+    block->count = count;
+    end          = ( LPBYTE ) block + size;
+    strings      = ( LPTSTR ) ( ( LPBYTE ) &( block->values[ 0 ] )
+                              + table_size );
+    block->image = strings;
+    strings     += copy_unicode(
+        strings,
+        ( end - ( LPBYTE ) strings ),
+        image->Buffer,
+        image_length
+    );
+    block->directory = strings;
+    strings         += copy_unicode(
+        strings,
+        ( end - ( LPBYTE ) strings ),
+        ( ( directory != NULL ) ? directory->Buffer : NULL ),
+        directory_length
+    );
+
+    /*------------------------------------------------------------------
+    No arguments to lay out.
+    ------------------------------------------------------------------*/
+    if( count == 0 ) {
+        return ERR_OK;
+    }
+    views = ( proc_arg_view_type* ) &( block->values[ 0 ] );
+
+    /*------------------------------------------------------------------
+    Wide arguments are unescaped in place in the block's own copy of
+    the command line, and each pointer refers into that copy.  A view is
+    always read before its slot is overwritten by a pointer.
     ------------------------------------------------------------------*/
     #ifdef UNICODE
-        StringCbCopyN(
-            command->image,
-            allocated,
-            image_file.Buffer,
-            return_length
-        );
+        memcpy( strings, line->Buffer, ( line_length * sizeof( WCHAR ) ) );
+        proc_args_split( strings, line_length, views, count );
+        for( i = 0; i < count; ++i ) {
+            offset      = views[ i ].offset;
+            view_length = views[ i ].length;
+            strings[ offset + view_length ] = L'\0';
+            block->values[ i ] = strings + offset;
+        }
+
+    /*------------------------------------------------------------------
+    Narrow arguments are unescaped in the query buffer, and each one is
+    converted into the block.
+    ------------------------------------------------------------------*/
     #else
-        WideCharToMultiByte(
-            CP_ACP,
-            0,
-            image_file.Buffer,
-            ( int ) ( return_length / sizeof( WCHAR ) ),
-            command->image,
-            allocated,
-            NULL,
-            NULL
-        );
+        proc_args_split( line->Buffer, line_length, views, count );
+        for( i = 0; i < count; ++i ) {
+            offset      = views[ i ].offset;
+            view_length = views[ i ].length;
+            block->values[ i ] = strings;
+            strings += copy_unicode(
+                strings,
+                ( end - ( LPBYTE ) strings ),
+                ( line->Buffer + offset ),
+                view_length
+            );
+        }
+    #endif
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD copy_unicode(                 /* copy a UTF-16 string to a TCHAR one  */
+    LPTSTR              target,     /* destination string                   */
+    SIZE_T              size,       /* size of destination (bytes)          */
+    LPCWSTR             source,     /* source string                        */
+    DWORD               length      /* length of source (characters)        */
+) {                                 /* returns characters written, with NUL */
+
+    /*------------------------------------------------------------------
+    Load the string into the user's memory.
+    ------------------------------------------------------------------*/
+    #ifdef UNICODE
+        memcpy( target, source, ( length * sizeof( WCHAR ) ) );
+    #else
+        if( length > 0 ) {
+            length = WideCharToMultiByte(
+                CP_ACP,
+                0,
+                source,
+                ( int ) length,
+                target,
+                ( int ) ( size - sizeof( TCHAR ) ),
+                NULL,
+                NULL
+            );
+        }
     #endif
 
     /*------------------------------------------------------------------
-    Release allocated memory.
+    Terminate the string.
+    ------------------------------------------------------------------*/
+    target[ length ] = _T( '\0' );
+    return length + 1;
+}
+
+
+/*==========================================================================*/
+void enable_process_debugging(      /* attempt to enable debugging features */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              process_handle;
+                                    /* handle to current process            */
+    HANDLE              token_handle;
+                                    /* handle to process token              */
+    TOKEN_PRIVILEGES    token_privileges;
+                                    /* token privilege object               */
+    BOOL                wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Initialize local variables.
+    ------------------------------------------------------------------*/
+    memset( &token_privileges, 0, sizeof( token_privileges ) );
+
+    /*------------------------------------------------------------------
+    Retrieve the handle to the current process.
+    ------------------------------------------------------------------*/
+    process_handle = GetCurrentProcess();
+
+    /*------------------------------------------------------------------
+    Open a token to the current process.
+    ------------------------------------------------------------------*/
+    wresult = OpenProcessToken(
+        process_handle,
+        ( TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY ),
+        &token_handle
+    );
+    if( wresult == FALSE ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Retrieve privilege information for the current process.
+    ------------------------------------------------------------------*/
+    wresult = LookupPrivilegeValue(
+        NULL,
+        SE_DEBUG_NAME,
+        &token_privileges.Privileges[ 0 ].Luid
+    );
+    if( wresult == FALSE ) {
+        CloseHandle( token_handle );
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Set desired privilege details to enable additional features.
+    ------------------------------------------------------------------*/
+    token_privileges.PrivilegeCount = 1;
+    token_privileges.Privileges[ 0 ].Attributes = SE_PRIVILEGE_ENABLED;
+
+    /*------------------------------------------------------------------
+    Attempt to allow the current process to retrieve debugging info.
+    ------------------------------------------------------------------*/
+    AdjustTokenPrivileges(
+        token_handle,
+        FALSE,
+        &token_privileges,
+        0,
+        ( PTOKEN_PRIVILEGES ) NULL,
+        0
+    );
+    //ZIH - leaving this here for documentation purposes
+    //DWORD error = GetLastError();
+    //if( error != ERROR_SUCCESS ) {
+    //    CloseHandle( token_handle );
+    //    return;
+    //}
+
+    /*------------------------------------------------------------------
+    Release the handle to the token.
+    ------------------------------------------------------------------*/
+    CloseHandle( token_handle );
+}
+
+
+/*==========================================================================*/
+error_type ensure_access(           /* make sure the handle has some rights */
+    proc_info_type*     info,       /* process information object           */
+    DWORD               access      /* access rights required               */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              handle;     /* handle with the combined rights      */
+
+    /*------------------------------------------------------------------
+    Nothing to do if the current handle already has the rights.
+    ------------------------------------------------------------------*/
+    if( ( info->handle != NULL ) && ( ( info->access & access ) == access ) ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Open a handle with both the existing and the required rights.
+    ------------------------------------------------------------------*/
+    access |= info->access;
+    handle = OpenProcess( access, FALSE, info->id );
+    if( handle == NULL ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Replace the previous handle.
+    ------------------------------------------------------------------*/
+    if( info->handle != NULL ) {
+        CloseHandle( info->handle );
+    }
+    info->handle = handle;
+    info->access = access;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type ensure_token(            /* make sure the process token is open  */
+    proc_info_type*     info        /* process information object           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    error_type          result;     /* result of internal operation         */
+    BOOL                wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Nothing to do if the token is already open.
     ------------------------------------------------------------------*/
-    HeapFree( heap, 0, image_file.Buffer );
-    image_file.Buffer = NULL;
+    if( info->token != NULL ) {
+        return ERR_OK;
+    }
 
-    //// ZIH - implement me
+    /*------------------------------------------------------------------
+    Opening the token needs a process handle.
+    ------------------------------------------------------------------*/
+    result = ensure_access( info, PROC_ACCESS_LIMITED );
+    if( result != ERR_OK ) {
+        return result;
+    }
 
     /*------------------------------------------------------------------
-    
+    Open a process query token to the requested process.
     ------------------------------------------------------------------*/
+    wresult = OpenProcessToken(
+        info->handle,
+        TOKEN_QUERY,
+        &( info->token )
+    );
+    if( ( wresult == FALSE ) || ( info->token == NULL ) ) {
+        info->token = NULL;
+        return ERR_WINAPI;
+    }
 
     /*------------------------------------------------------------------
     Return success.
@@ -539,3 +1110,533 @@ error_type get_image(               /* get the process' image file name     */
     return ERR_OK;
 }
 
+
+/*==========================================================================*/
+error_type load_command(            /* load the command and directory       */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     image,      /* process' image file name             */
+    BOOL                directory,  /* the directory is required            */
+    proc_alloc_t32      alloc,      /* memory allocation specification      */
+    proc_command_type** command,    /* user's command object memory         */
+    BOOL*               read        /* set if the directory was read, or    */
+                                    /* NULL                                 */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    UNICODE_STRING      current;    /* process' current directory           */
+    BOOL                found;      /* the directory was read               */
+    UNICODE_STRING      line;       /* process' raw command line            */
+    error_type          result;     /* result of internal operation         */
+    proc_nt_string_type storage;    /* storage for remote strings           */
+
+    /*------------------------------------------------------------------
+    Without the directory, try the direct command line query first.  It
+    only needs limited access.
+    ------------------------------------------------------------------*/
+    found  = FALSE;
+    result = ERR_WINAPI;
+    if( directory == FALSE ) {
+        result = query_string(
+            info,
+            PROC_COMMAND_LINE_INFORMATION,
+            &storage
+        );
+        if( result == ERR_OK ) {
+            line           = *( storage.string );
+            current.Length = 0;
+            current.Buffer = NULL;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Read the command line and current directory together from the
+    process' parameters.
+    ------------------------------------------------------------------*/
+    if( result != ERR_OK ) {
+        result = ensure_access( info, PROC_ACCESS_PARAMETERS );
+        if( result == ERR_OK ) {
+            result = read_parameters( info, &line, &current, &storage );
+            found  = ( result == ERR_OK ) ? TRUE : FALSE;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The parameters can not be read from protected processes or from a
+    64-bit process while running under WOW64.  The command line can
+    still be queried directly on systems that support it, but the
+    directory is not available, which the caller is told, since an
+    empty directory would look like one that was read.
+    ------------------------------------------------------------------*/
+    if( ( result != ERR_OK ) && ( directory != FALSE ) ) {
+        result = query_string(
+            info,
+            PROC_COMMAND_LINE_INFORMATION,
+            &storage
+        );
+        if( result == ERR_OK ) {
+            line           = *( storage.string );
+            current.Length = 0;
+            current.Buffer = NULL;
+        }
+    }
+    if( result != ERR_OK ) {
+        return result;
+    }
+    current.MaximumLength = current.Length;
+    if( read != NULL ) {
+        *read = found;
+    }
+
+    /*------------------------------------------------------------------
+    Build the command object.
+    ------------------------------------------------------------------*/
+    result = build_command( info, image, &line, &current, alloc, command );
+
+    /*------------------------------------------------------------------
+    Release the query result.
+    ------------------------------------------------------------------*/
+    release_string( &storage );
+
+    /*------------------------------------------------------------------
+    Return the result of building the command.
+    ------------------------------------------------------------------*/
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type load_image(              /* load the image name as a string      */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     image       /* process' image file name             */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               length;     /* length of image name (characters)    */
+    SIZE_T              size;       /* size of the image string (bytes)     */
+
+    /*------------------------------------------------------------------
+    Get memory for the string from the arena or the heap.
+    ------------------------------------------------------------------*/
+    length = image->Length / sizeof( WCHAR );
+    size   = unicode_size( image->Buffer, length );
+    if( info->arena != NULL ) {
+        info->image = ( LPTSTR ) proc_arena_alloc( info->arena, size );
+    }
+    else {
+        info->image = ( LPTSTR ) HeapAlloc( GetProcessHeap(), 0, size );
+    }
+    if( info->image == NULL ) {
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Load the image name into the string.
+    ------------------------------------------------------------------*/
+    copy_unicode( info->image, size, image->Buffer, length );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type load_user(               /* lazy-load the process' user info     */
+    proc_info_type*     info        /* process information object           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               return_length;
+                                    /* data length return variable          */
+    error_type          result;     /* result of internal operation         */
+    BOOL                wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    The user info is only loaded once.
+    ------------------------------------------------------------------*/
+    if( info->user != NULL ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Make sure the process token is open.
+    ------------------------------------------------------------------*/
+    result = ensure_token( info );
+    if( result != ERR_OK ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Perform a dummy query to fetch the size of the user info data.
+    ------------------------------------------------------------------*/
+    return_length = 0;
+    wresult = GetTokenInformation(
+        info->token,
+        TokenUser,
+        ( LPVOID ) info->user,
+        0,
+        &return_length
+    );
+    if( ( wresult == FALSE )
+     && ( GetLastError() != ERROR_INSUFFICIENT_BUFFER ) ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate heap space for the user info data.
+    ------------------------------------------------------------------*/
+    info->user = ( PTOKEN_USER ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        return_length
+    );
+    if( info->user == NULL ) {
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Perform the real query to retrieve the user information.
+    ------------------------------------------------------------------*/
+    wresult = GetTokenInformation(
+        info->token,
+        TokenUser,
+        ( LPVOID ) info->user,
+        return_length,
+        &return_length
+    );
+    if( wresult == FALSE ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) info->user );
+        info->user = NULL;
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type query_image(             /* query the image path in DOS form     */
+    proc_info_type*     info,       /* process information object           */
+    proc_nt_string_type*
+                        image       /* query result                         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    error_type          result;     /* result of internal operation         */
+
+    /*------------------------------------------------------------------
+    Query the image path in its native (device) form.
+    ------------------------------------------------------------------*/
+    result = query_string( info, ProcessImageFileName, image );
+    if( result != ERR_OK ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Rewrite the device prefix in place using the instance's table.
+    Paths on devices without a drive letter are left as they are.
+    ------------------------------------------------------------------*/
+    proc_volume_translate( &( info->instance->volumes ), image->string );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type query_string(            /* query a string from the process      */
+    proc_info_type*     info,       /* process information object           */
+    PROCESSINFOCLASS    query,      /* string information to query          */
+    proc_nt_string_type*
+                        string      /* query result                         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              heap;       /* current process' heap handle         */
+    ULONG               return_length;
+                                    /* data length return variable          */
+    NTSTATUS            status;     /* status of NT Windows API calls       */
+
+    /*------------------------------------------------------------------
+    Most strings fit in local storage, so try that first.
+    ------------------------------------------------------------------*/
+    string->heap   = NULL;
+    string->string = ( PUNICODE_STRING ) string->local;
+    return_length  = 0;
+    status = info->instance->nqip(
+        info->handle,
+        query,
+        ( PVOID ) string->local,
+        sizeof( string->local ),
+        &return_length
+    );
+    if( status == STATUS_SUCCESS ) {
+        return ERR_OK;
+    }
+    else if( ( status != STATUS_INFO_LENGTH_MISMATCH )
+          && ( status != STATUS_BUFFER_OVERFLOW )
+          && ( status != STATUS_BUFFER_TOO_SMALL ) ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate heap storage for a long string.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    string->heap = ( LPBYTE ) HeapAlloc( heap, 0, return_length );
+    if( string->heap == NULL ) {
+        return ERR_ALLOC;
+    }
+    string->string = ( PUNICODE_STRING ) string->heap;
+
+    /*------------------------------------------------------------------
+    Retrieve the string into heap storage.
+    ------------------------------------------------------------------*/
+    status = info->instance->nqip(
+        info->handle,
+        query,
+        ( PVOID ) string->heap,
+        return_length,
+        &return_length
+    );
+    if( status != STATUS_SUCCESS ) {
+        HeapFree( heap, 0, string->heap );
+        string->heap = NULL;
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type read_parameters(         /* read remote command line and dir.    */
+    proc_info_type*     info,       /* process information object           */
+    PUNICODE_STRING     line,       /* returned command line                */
+    PUNICODE_STRING     directory,  /* returned current directory           */
+    proc_nt_string_type*
+                        storage     /* storage for the returned strings     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    PROCESS_BASIC_INFORMATION
+                        basic;      /* basic process information            */
+    LPBYTE              buffer;     /* local copy of the remote strings     */
+    ULONG_PTR           high;       /* remote end of both strings           */
+    ULONG_PTR           low;        /* remote start of both strings         */
+    proc_parameters_type
+                        parameters; /* copy of the remote parameters        */
+    PVOID               parameters_address;
+                                    /* remote address of the parameters     */
+    ULONG_PTR           peb_address;/* remote address of the PEB            */
+    NTSTATUS            status;     /* status of NT Windows API calls       */
+    BOOL                wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Initialize the user's memory.
+    ------------------------------------------------------------------*/
+    storage->heap   = NULL;
+    storage->string = NULL;
+
+    /*------------------------------------------------------------------
+    Under WOW64, only 32-bit processes have a readable PEB, and its
+    address comes straight from the WOW64 query.
+    ------------------------------------------------------------------*/
+    if( info->instance->wow64 != FALSE ) {
+        peb_address = 0;
+        status = info->instance->nqip(
+            info->handle,
+            ProcessWow64Information,
+            ( PVOID ) &peb_address,
+            sizeof( peb_address ),
+            NULL
+        );
+        if( ( status != STATUS_SUCCESS ) || ( peb_address == 0 ) ) {
+            return ERR_WINAPI;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Otherwise, the PEB address is part of the basic information.
+    ------------------------------------------------------------------*/
+    else {
+        status = info->instance->nqip(
+            info->handle,
+            ProcessBasicInformation,
+            ( PVOID ) &basic,
+            sizeof( basic ),
+            NULL
+        );
+        if( status != STATUS_SUCCESS ) {
+            return ERR_WINAPI;
+        }
+        peb_address = ( ULONG_PTR ) basic.PebBaseAddress;
+    }
+
+    /*------------------------------------------------------------------
+    Read only the parameters pointer from the PEB.
+    ------------------------------------------------------------------*/
+    wresult = ReadProcessMemory(
+        info->handle,
+        ( LPCVOID ) ( peb_address + FIELD_OFFSET( PEB, ProcessParameters ) ),
+        ( LPVOID ) &parameters_address,
+        sizeof( parameters_address ),
+        NULL
+    );
+    if( ( wresult == FALSE ) || ( parameters_address == NULL ) ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Read the leading parameters, which describe both strings.
+    ------------------------------------------------------------------*/
+    wresult = ReadProcessMemory(
+        info->handle,
+        ( LPCVOID ) parameters_address,
+        ( LPVOID ) &parameters,
+        sizeof( parameters ),
+        NULL
+    );
+    if( wresult == FALSE ) {
+        return ERR_WINAPI;
+    }
+    *line      = parameters.command_line;
+    *directory = parameters.directory;
+
+    /*------------------------------------------------------------------
+    Both strings normally sit just after the parameters, so they are
+    fetched with one read spanning the two of them.
+    ------------------------------------------------------------------*/
+    low  = min(
+        ( ULONG_PTR ) line->Buffer,
+        ( ULONG_PTR ) directory->Buffer
+    );
+    high = max(
+        ( ( ULONG_PTR ) line->Buffer + line->Length ),
+        ( ( ULONG_PTR ) directory->Buffer + directory->Length )
+    );
+    if( ( line->Buffer == NULL ) || ( directory->Buffer == NULL )
+     || ( ( high - low ) > PROC_SPAN_LIMIT ) ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Use local storage when the span fits.
+    ------------------------------------------------------------------*/
+    if( ( high - low ) <= sizeof( storage->local ) ) {
+        buffer = ( LPBYTE ) storage->local;
+    }
+    else {
+        storage->heap = ( LPBYTE ) HeapAlloc(
+            GetProcessHeap(),
+            0,
+            ( high - low )
+        );
+        if( storage->heap == NULL ) {
+            return ERR_ALLOC;
+        }
+        buffer = storage->heap;
+    }
+
+    /*------------------------------------------------------------------
+    Read the span holding both strings.
+    ------------------------------------------------------------------*/
+    wresult = ReadProcessMemory(
+        info->handle,
+        ( LPCVOID ) low,
+        ( LPVOID ) buffer,
+        ( high - low ),
+        NULL
+    );
+    if( wresult == FALSE ) {
+        release_string( storage );
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Point both strings into the local copy.
+    ------------------------------------------------------------------*/
+    line->Buffer      = ( PWSTR ) (
+        buffer + ( ( ULONG_PTR ) line->Buffer - low )
+    );
+    directory->Buffer = ( PWSTR ) (
+        buffer + ( ( ULONG_PTR ) directory->Buffer - low )
+    );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void release_string(                /* release an NT string query result    */
+    proc_nt_string_type*
+                        string      /* query result                         */
+) {
+
+    /*------------------------------------------------------------------
+    Only long strings use heap storage.
+    ------------------------------------------------------------------*/
+    if( string->heap != NULL ) {
+        HeapFree( GetProcessHeap(), 0, string->heap );
+        string->heap = NULL;
+    }
+    string->string = NULL;
+
+}
+
+
+/*==========================================================================*/
+SIZE_T unicode_size(                /* size of a UTF-16 string as TCHARs    */
+    LPCWSTR             source,     /* source string                        */
+    DWORD               length      /* length of source (characters)        */
+) {                                 /* returns bytes needed, with NUL       */
+
+    /*------------------------------------------------------------------
+    Wide strings are copied as-is.
+    ------------------------------------------------------------------*/
+    #ifdef UNICODE
+        return ( length + 1 ) * sizeof( WCHAR );
+
+    /*------------------------------------------------------------------
+    Narrow strings need the converted length.
+    ------------------------------------------------------------------*/
+    #else
+        if( length == 0 ) {
+            return sizeof( CHAR );
+        }
+        return WideCharToMultiByte(
+            CP_ACP,
+            0,
+            source,
+            ( int ) length,
+            NULL,
+            0,
+            NULL,
+            NULL
+        ) + sizeof( CHAR );
+    #endif
+}
@@ -0,0 +1,908 @@
+/*****************************************************************************
+
+proc_match.c
+
+Running Process Matching
+
+Restoring a session that is already (partly) on the screen should not start
+its programs a second time.  Before a session is launched, this module takes
+one snapshot of the user's processes, keeps only the processes that own a
+visible top-level window, and queries their images and command lines in
+parallel (see proc_capture.c).  The processes are indexed by a hash of their
+image's file name, and each carries a fingerprint of its arguments.
+
+Images and command strings are interned in the index's string pool (see
+proc_pool.c), so the many processes that run the same program share one copy
+of each string.  A configured program's image is looked up in the same pool,
+so comparing it to a process' image is an integer compare.
+
+A configured window matches a running process when the program it would
+start resolves to the same image, and its arguments have the same
+fingerprint.  Each process is claimed by one window at most, so a session
+with two identical windows still gets two of them.
+
+A caller that builds the index again and again (the resident restore, see
+main.c) can keep what was read in the process information instance (see
+proc_cache.c).  Then only processes that started since the last build are
+queried, in parallel and with the same time limits.  When process events
+keep that cache current (see proc_events.c), the process table is not read
+at all.
+
+The windows themselves are listed once (see window_list.c), and kept with
+the index, so a caller that lays out windows can rank every window against
+every configured window without enumerating them again.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "proc_cache.h"
+#include "proc_match.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define MATCH_ARGUMENT_SIZE ( 1024 )
+                                    /* longest expanded argument            */
+#define MATCH_FNV_BASIS     ( 2166136261UL )
+                                    /* FNV-1a offset basis                  */
+#define MATCH_FNV_PRIME     ( 16777619UL )
+                                    /* FNV-1a prime                         */
+#define MATCH_ID_CHUNK      ( 4096 )/* command string ID storage chunk size */
+                                    /* (bytes)                              */
+#define MATCH_MIN_BUCKETS   ( 16 )  /* fewest buckets in the table          */
+#define MATCH_NONE          ( ( DWORD ) -1 )
+                                    /* end of a bucket chain                */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct match_window_s {     /* top-level window type                */
+    DWORD               process_id; /* process that owns the window         */
+    DWORD               order;      /* position in Z order (index in the    */
+                                    /* window list)                         */
+} match_window_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type capture_misses(          /* query the processes not yet cached   */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* cached processes that own windows    */
+    DWORD               timeout,    /* limit on the process queries (ms),   */
+                                    /* or INFINITE                          */
+    proc_pool_type*     pool        /* pool the strings are interned in     */
+);                                  /* returns error code                   */
+
+int compare_windows(                /* order windows by process, then Z     */
+    const void*         left,       /* first window                         */
+    const void*         right       /* second window                        */
+);                                  /* returns sort order                   */
+
+DWORD fold_text(                    /* add a string to a running hash       */
+    DWORD               hash,       /* running hash                         */
+    LPCTSTR             text,       /* string to add                        */
+    BOOL                fold_case   /* ignore case                          */
+);                                  /* returns updated FNV-1a hash          */
+
+DWORD hash_list(                    /* fingerprint a configured argument    */
+                                    /* list                                 */
+    const config_window_type*
+                        window,     /* configured window                    */
+    BOOL                expand      /* expand environment variables first   */
+);                                  /* returns FNV-1a hash                  */
+
+LPCTSTR image_name(                 /* find the file name part of a path    */
+    LPCTSTR             path        /* path or file name                    */
+);                                  /* returns start of the file name       */
+
+error_type intern_cached(           /* intern a cached process' strings     */
+    proc_pool_type*     pool,       /* pool the strings are interned in     */
+    proc_arena_type*    arena,      /* storage for the ID list              */
+    const proc_info_type*
+                        info,       /* cached process                       */
+    proc_match_entry_type*
+                        entry       /* entry to fill                        */
+);                                  /* returns error code                   */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type proc_match_build(        /* index the processes that own windows */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               timeout,    /* limit on the process queries (ms),   */
+                                    /* or INFINITE                          */
+    BOOL                text,       /* also list window classes and titles  */
+    BOOL                cached,     /* reuse what earlier builds read from  */
+                                    /* processes that are still running     */
+    proc_match_type*    match       /* index object to initialize           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bucket;     /* bucket index                         */
+    DWORD               buckets;    /* number of buckets                    */
+    proc_match_entry_type*
+                        entry;      /* entry being filled                   */
+    BOOL                current;    /* the cache is kept current by events  */
+    DWORD               hash;       /* running argument hash                */
+    DWORD               i;          /* record or item index                 */
+    DWORD               id;         /* process ID                           */
+    LPCTSTR             image;      /* process' image path                  */
+    proc_info_type*     info;       /* cached process                       */
+    proc_capture_item_type*
+                        item;       /* captured process                     */
+    DWORD               j;          /* window index                         */
+    DWORD               k;          /* argument index                       */
+    DWORD               kept;       /* number of records kept               */
+    window_list_type*   list;       /* top-level windows                    */
+    DWORD               name;       /* pool ID of image file name           */
+    proc_pool_type*     pool;       /* interned images and command strings  */
+    error_type          result;     /* result of internal operation         */
+    proc_snapshot_type* snapshot;   /* indexed processes                    */
+    DWORD               user;       /* key of the invoking user's SID       */
+    match_window_type*  windows;    /* windows ordered by process           */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( match == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( match, 0, sizeof( proc_match_type ) );
+    pool   = &( match->strings );
+    result = proc_pool_init( pool );
+    if( result != ERR_OK ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    List the visible, unowned top-level windows, and order them by
+    process.  A process' window nearest the top comes first.
+    ------------------------------------------------------------------*/
+    list   = &( match->windows );
+    result = window_list_take( list, text );
+    if( result != ERR_OK ) {
+        proc_match_free( match );
+        return result;
+    }
+    if( list->count == 0 ) {
+        return ERR_OK;
+    }
+    windows = ( match_window_type* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( list->count * sizeof( match_window_type ) )
+    );
+    if( windows == NULL ) {
+        proc_match_free( match );
+        return ERR_ALLOC;
+    }
+    for( j = 0; j < list->count; ++j ) {
+        windows[ j ].process_id = list->process_ids[ j ];
+        windows[ j ].order      = j;
+    }
+    qsort(
+        windows,
+        list->count,
+        sizeof( match_window_type ),
+        compare_windows
+    );
+
+    /*------------------------------------------------------------------
+    Snapshot the invoking user's processes (or, for a cached build, list
+    the processes already cached when events keep them current), then
+    keep only the ones with a window.  Both lists are sorted by process
+    ID.  Other users' processes can rarely be queried, so they are
+    dropped by owner before any of them is opened.  When the owners can
+    not be listed, every process is kept.
+    ------------------------------------------------------------------*/
+    current  = ( ( cached != FALSE ) && ( instance->cache.current != FALSE ) )
+             ? TRUE : FALSE;
+    snapshot = &( match->snapshot );
+    if( current != FALSE ) {
+        result = proc_cache_records( instance, snapshot );
+    }
+    else {
+        result = proc_sid_user( &( instance->sids ), &user );
+        if( result == ERR_OK ) {
+            result = proc_snapshot_take_owned( instance, snapshot, user );
+        }
+        if( result != ERR_OK ) {
+            result = proc_snapshot_take( instance, snapshot );
+        }
+    }
+    if( result != ERR_OK ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) windows );
+        proc_match_free( match );
+        return result;
+    }
+    kept = 0;
+    j    = 0;
+    for( i = 0; i < snapshot->count; ++i ) {
+        while( ( j < list->count )
+            && ( windows[ j ].process_id < snapshot->records[ i ].id ) ) {
+            j += 1;
+        }
+        if( ( j < list->count )
+         && ( windows[ j ].process_id == snapshot->records[ i ].id ) ) {
+            snapshot->records[ kept ] = snapshot->records[ i ];
+            kept += 1;
+        }
+    }
+    snapshot->count = kept;
+
+    /*------------------------------------------------------------------
+    Query the images and command lines.  A process that is too slow to
+    answer is left out, rather than holding up the launch.  A cached
+    build merges the processes into the instance's cache (unless the
+    cache is already current), and only queries those it has not read.
+    ------------------------------------------------------------------*/
+    result = ERR_OK;
+    if( ( cached != FALSE ) && ( current == FALSE ) ) {
+        result = proc_cache_update( instance, snapshot );
+    }
+    if( ( result == ERR_OK ) && ( cached != FALSE ) ) {
+        result = proc_arena_init( &( match->ids ), MATCH_ID_CHUNK );
+        if( ( result == ERR_OK ) && ( kept > 0 ) ) {
+            result = capture_misses( instance, snapshot, timeout, pool );
+        }
+    }
+    else if( ( cached == FALSE ) && ( kept > 0 ) ) {
+        result = proc_capture_run(
+            instance,
+            snapshot,
+            ( PROC_FIELD_IMAGE | PROC_FIELD_COMMAND ),
+            0,
+            timeout,
+            timeout,
+            pool,
+            &( match->capture )
+        );
+        if( result == ERR_TIMEOUT ) {
+            result = ERR_OK;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Allocate the entries and the table at once, keeping the table at
+    most half full.
+    ------------------------------------------------------------------*/
+    buckets = MATCH_MIN_BUCKETS;
+    while( buckets < ( 2 * kept ) ) {
+        buckets *= 2;
+    }
+    if( result == ERR_OK ) {
+        match->entries = ( proc_match_entry_type* ) HeapAlloc(
+            GetProcessHeap(),
+            HEAP_ZERO_MEMORY,
+            ( ( kept * sizeof( proc_match_entry_type ) )
+              + ( buckets * sizeof( DWORD ) ) )
+        );
+        if( match->entries == NULL ) {
+            result = ERR_ALLOC;
+        }
+    }
+    if( result != ERR_OK ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) windows );
+        proc_match_free( match );
+        return result;
+    }
+    match->buckets      = ( DWORD* ) ( match->entries + kept );
+    match->bucket_count = buckets;
+    memset( match->buckets, 0xFF, ( buckets * sizeof( DWORD ) ) );
+
+    /*------------------------------------------------------------------
+    Index each process whose image and command line were read.  The
+    captured items and the cache are sorted by process ID, like the
+    windows.  Cached fields were read (or failed to be) above, so the
+    cache is not asked to query anything, and their strings are
+    interned here.  Captured strings already are.
+    ------------------------------------------------------------------*/
+    j = 0;
+    for( i = 0; i < kept; ++i ) {
+        id    = snapshot->records[ i ].id;
+        entry = &( match->entries[ match->count ] );
+        if( cached != FALSE ) {
+            info = proc_cache_get( instance, id, 0 );
+            if( ( info == NULL )
+             || ( ( info->fields & PROC_FIELD_IMAGE ) == 0 )
+             || ( ( info->fields & PROC_FIELD_COMMAND ) == 0 ) ) {
+                continue;
+            }
+            result = intern_cached( pool, &( match->ids ), info, entry );
+            if( result != ERR_OK ) {
+                break;
+            }
+        }
+        else {
+            if( i >= match->capture.count ) {
+                continue;
+            }
+            item = &( match->capture.items[ i ] );
+            if( ( item->result != ERR_OK )
+             || ( ( item->fields & PROC_FIELD_IMAGE ) == 0 )
+             || ( ( item->fields & PROC_FIELD_COMMAND ) == 0 ) ) {
+                continue;
+            }
+            id            = item->id;
+            entry->image  = item->image;
+            entry->count  = item->count;
+            entry->values = item->values;
+        }
+        while( windows[ j ].process_id < id ) {
+            j += 1;
+        }
+
+        /*--------------------------------------------------------------
+        The image and its file name are compared by their folded IDs.
+        --------------------------------------------------------------*/
+        image  = proc_pool_get( pool, entry->image );
+        result = proc_pool_intern( pool, image_name( image ), &name );
+        if( result != ERR_OK ) {
+            break;
+        }
+
+        /*--------------------------------------------------------------
+        The first argument names the program, so it is not part of the
+        fingerprint.
+        --------------------------------------------------------------*/
+        hash = MATCH_FNV_BASIS;
+        for( k = 1; k < entry->count; ++k ) {
+            hash = fold_text(
+                hash,
+                proc_pool_get( pool, entry->values[ k ] ),
+                FALSE
+            );
+        }
+        entry->id          = id;
+        entry->window      = list->windows[ windows[ j ].order ];
+        entry->path        = proc_pool_fold( pool, entry->image );
+        entry->name        = proc_pool_fold( pool, name );
+        entry->name_hash   = fold_text(
+            MATCH_FNV_BASIS,
+            image_name( image ),
+            TRUE
+        );
+        entry->fingerprint = hash;
+        bucket             = entry->name_hash & ( buckets - 1 );
+        entry->next        = match->buckets[ bucket ];
+        match->buckets[ bucket ] = match->count;
+        match->count      += 1;
+    }
+
+    /*------------------------------------------------------------------
+    A string that could not be interned fails the build.
+    ------------------------------------------------------------------*/
+    if( result != ERR_OK ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) windows );
+        proc_match_free( match );
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Release the ordering (the list itself is kept), and return success.
+    ------------------------------------------------------------------*/
+    HeapFree( GetProcessHeap(), 0, ( LPVOID ) windows );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_match_claim(        /* claim a process already running a    */
+                                    /* configured window                    */
+    proc_match_type*    match,      /* index object                         */
+    const config_window_type*
+                        window,     /* configured window                    */
+    DWORD*              process_id, /* returned process ID                  */
+    HWND*               found       /* returned top-level window            */
+) {                                 /* returns error code (ERR_NOT_FOUND if */
+                                    /* no unclaimed process matches)        */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_match_entry_type*
+                        entry;      /* entry being checked                  */
+    DWORD               index;      /* entry index                          */
+    proc_match_key_type key;        /* program the window would run         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( match == NULL ) || ( window == NULL ) || ( process_id == NULL )
+     || ( found == NULL ) ) {
+        return ERR_USAGE;
+    }
+    if( ( match->count == 0 )
+     || ( proc_match_key( match, window, &key ) != ERR_OK ) ) {
+        return ERR_NOT_FOUND;
+    }
+
+    /*------------------------------------------------------------------
+    Claim the first unclaimed process that matches.
+    ------------------------------------------------------------------*/
+    index = match->buckets[ key.name_hash & ( match->bucket_count - 1 ) ];
+    for( ; index != MATCH_NONE; index = entry->next ) {
+        entry = &( match->entries[ index ] );
+        if( proc_match_rank( entry, &key ) != PROC_MATCH_EXACT ) {
+            continue;
+        }
+        if( InterlockedCompareExchange( &( entry->claimed ), 1, 0 ) == 0 ) {
+            *process_id = entry->id;
+            *found      = entry->window;
+            return ERR_OK;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Nothing running matches the window.
+    ------------------------------------------------------------------*/
+    return ERR_NOT_FOUND;
+}
+
+
+/*==========================================================================*/
+proc_match_entry_type* proc_match_find(
+                                    /* find a running process' entry        */
+    proc_match_type*    match,      /* index object                         */
+    DWORD               process_id  /* process ID                           */
+) {                                 /* returns entry, or NULL if the        */
+                                    /* process is not indexed               */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               high;       /* end of the entries left to search    */
+    DWORD               low;        /* start of the entries left to search  */
+    DWORD               middle;     /* entry being checked                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( match == NULL ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    The entries were indexed in process ID order, so search them by
+    halves.
+    ------------------------------------------------------------------*/
+    low  = 0;
+    high = match->count;
+    while( low < high ) {
+        middle = low + ( ( high - low ) / 2 );
+        if( match->entries[ middle ].id == process_id ) {
+            return &( match->entries[ middle ] );
+        }
+        if( match->entries[ middle ].id < process_id ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return NULL;
+}
+
+
+/*==========================================================================*/
+void proc_match_free(               /* release a running process index      */
+    proc_match_type*    match       /* index object                         */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( match == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release the index, then the captured processes and strings it
+    refers to.
+    ------------------------------------------------------------------*/
+    if( match->entries != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) match->entries );
+    }
+    proc_capture_free( &( match->capture ) );
+    proc_pool_free( &( match->strings ) );
+    proc_arena_free( &( match->ids ) );
+    proc_snapshot_free( &( match->snapshot ) );
+    window_list_free( &( match->windows ) );
+
+    /*------------------------------------------------------------------
+    Clear the index object.
+    ------------------------------------------------------------------*/
+    memset( match, 0, sizeof( proc_match_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type proc_match_key(          /* find the program a configured window */
+                                    /* would run                            */
+    proc_match_type*    match,      /* index whose strings the key is       */
+                                    /* looked up in                         */
+    const config_window_type*
+                        window,     /* configured window                    */
+    proc_match_key_type*
+                        key         /* returned program key                 */
+) {                                 /* returns error code (ERR_NOT_FOUND if */
+                                    /* the window runs no program)          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    TCHAR               command[ MAX_PATH ];
+                                    /* command with variables expanded      */
+    DWORD               length;     /* length of a returned string          */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( match == NULL ) || ( window == NULL ) || ( key == NULL ) ) {
+        return ERR_USAGE;
+    }
+    if( window->command == NULL ) {
+        return ERR_NOT_FOUND;
+    }
+
+    /*------------------------------------------------------------------
+    Find the image CreateProcess would run.  When it can not be found,
+    only its file name is compared.
+    ------------------------------------------------------------------*/
+    if( window->templates != NULL ) {
+        length = arg_template_length( window->templates, window->template );
+        length = ( length < MAX_PATH ) ? ( length + 1 ) : 0;
+        if( length > 0 ) {
+            arg_template_write( window->templates, window->template, command );
+        }
+    }
+    else {
+        length = ExpandEnvironmentStrings(
+            window->command,
+            command,
+            MAX_PATH
+        );
+    }
+    if( ( length == 0 ) || ( length > MAX_PATH ) ) {
+        _tcsncpy( command, window->command, ( MAX_PATH - 1 ) );
+        command[ MAX_PATH - 1 ] = _T( '\0' );
+    }
+    length = SearchPath(
+        NULL,
+        command,
+        _T( ".exe" ),
+        MAX_PATH,
+        key->path,
+        NULL
+    );
+    key->resolved = ( ( length > 0 ) && ( length < MAX_PATH ) ) ? TRUE : FALSE;
+    if( key->resolved == FALSE ) {
+        memcpy( key->path, command, sizeof( command ) );
+    }
+    key->name      = image_name( key->path );
+    key->name_hash = fold_text( MATCH_FNV_BASIS, key->name, TRUE );
+
+    /*------------------------------------------------------------------
+    Look up the path and file name among the running images.  A string
+    that is not in the pool matches no process.
+    ------------------------------------------------------------------*/
+    key->path_id = ( key->resolved != FALSE )
+                 ? proc_pool_find( &( match->strings ), key->path, TRUE )
+                 : PROC_POOL_NONE;
+    key->name_id = proc_pool_find( &( match->strings ), key->name, TRUE );
+
+    /*------------------------------------------------------------------
+    A process started elsewhere (or by an older version of this tool)
+    may have received the arguments as given, rather than expanded.
+    ------------------------------------------------------------------*/
+    key->raw      = hash_list( window, FALSE );
+    key->expanded = hash_list( window, TRUE );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD proc_match_rank(              /* compare a running process to a       */
+                                    /* configured program                   */
+    const proc_match_entry_type*
+                        entry,      /* running process                      */
+    const proc_match_key_type*
+                        key         /* configured program                   */
+) {                                 /* returns PROC_MATCH_* rank            */
+
+    /*------------------------------------------------------------------
+    Interned strings are equal ignoring case exactly when their folded
+    IDs are, so no string is compared.
+    ------------------------------------------------------------------*/
+    if( ( entry == NULL ) || ( key == NULL )
+     || ( entry->name_hash != key->name_hash )
+     || ( entry->name != key->name_id )
+     || ( ( key->resolved != FALSE ) && ( entry->path != key->path_id ) ) ) {
+        return PROC_MATCH_NONE;
+    }
+    if( ( entry->fingerprint != key->raw )
+     && ( entry->fingerprint != key->expanded ) ) {
+        return PROC_MATCH_IMAGE;
+    }
+    return PROC_MATCH_EXACT;
+}
+
+
+/*==========================================================================*/
+error_type capture_misses(          /* query the processes not yet cached   */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* cached processes that own windows    */
+    DWORD               timeout,    /* limit on the process queries (ms),   */
+                                    /* or INFINITE                          */
+    proc_pool_type*     pool        /* pool the strings are interned in     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_capture_type   capture;    /* captured misses                      */
+    DWORD               count;      /* number of misses                     */
+    DWORD               i;          /* record or item index                 */
+    proc_info_type*     info;       /* cached process                       */
+    proc_snapshot_type  misses;     /* processes to query                   */
+    error_type          result;     /* result of internal operation         */
+
+    /*------------------------------------------------------------------
+    Collect the processes whose image or command was never loaded.
+    Looking them up queries nothing.
+    ------------------------------------------------------------------*/
+    memset( &misses, 0, sizeof( proc_snapshot_type ) );
+    misses.instance = instance;
+    misses.records  = ( proc_record_type* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( ( snapshot->count + 1 ) * sizeof( proc_record_type ) )
+    );
+    if( misses.records == NULL ) {
+        return ERR_ALLOC;
+    }
+    count = 0;
+    for( i = 0; i < snapshot->count; ++i ) {
+        info = proc_cache_get( instance, snapshot->records[ i ].id, 0 );
+        if( ( info != NULL )
+         && ( ( ( info->fields & PROC_FIELD_IMAGE ) == 0 )
+           || ( ( info->fields & PROC_FIELD_COMMAND ) == 0 ) ) ) {
+            misses.records[ count ] = snapshot->records[ i ];
+            count += 1;
+        }
+    }
+    misses.count = count;
+
+    /*------------------------------------------------------------------
+    Query them in parallel, with the same deadlines as a build without
+    the cache, and keep what was read in the cache.  A process that is
+    too slow to answer is left out, and tried again next time.
+    ------------------------------------------------------------------*/
+    result = ERR_OK;
+    if( count > 0 ) {
+        result = proc_capture_run(
+            instance,
+            &misses,
+            ( PROC_FIELD_IMAGE | PROC_FIELD_COMMAND ),
+            0,
+            timeout,
+            timeout,
+            pool,
+            &capture
+        );
+        if( result == ERR_TIMEOUT ) {
+            result = ERR_OK;
+        }
+        for( i = 0; ( result == ERR_OK ) && ( i < capture.count ); ++i ) {
+            if( capture.items[ i ].result == ERR_OK ) {
+                proc_cache_store( instance, pool, &( capture.items[ i ] ) );
+            }
+        }
+        proc_capture_free( &capture );
+    }
+    HeapFree( GetProcessHeap(), 0, ( LPVOID ) misses.records );
+    return result;
+}
+
+
+/*==========================================================================*/
+int compare_windows(                /* order windows by process, then Z     */
+    const void*         left,       /* first window                         */
+    const void*         right       /* second window                        */
+) {                                 /* returns sort order                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const match_window_type*
+                        a;          /* first window                         */
+    const match_window_type*
+                        b;          /* second window                        */
+
+    /*------------------------------------------------------------------
+    Compare without subtracting, since IDs are unsigned.
+    ------------------------------------------------------------------*/
+    a = ( const match_window_type* ) left;
+    b = ( const match_window_type* ) right;
+    if( a->process_id != b->process_id ) {
+        return ( a->process_id < b->process_id ) ? -1 : 1;
+    }
+    return ( a->order < b->order ) ? -1 : ( ( a->order > b->order ) ? 1 : 0 );
+}
+
+
+/*==========================================================================*/
+DWORD fold_text(                    /* add a string to a running hash       */
+    DWORD               hash,       /* running hash                         */
+    LPCTSTR             text,       /* string to add                        */
+    BOOL                fold_case   /* ignore case                          */
+) {                                 /* returns updated FNV-1a hash          */
+
+    /*------------------------------------------------------------------
+    Hash each character, then a separator, so adjacent strings can not
+    run together.
+    ------------------------------------------------------------------*/
+    for( ; *text != _T( '\0' ); ++text ) {
+        hash ^= ( DWORD ) ( _TUCHAR ) ( ( fold_case != FALSE )
+                                      ? _totlower( *text ) : *text );
+        hash *= MATCH_FNV_PRIME;
+    }
+    hash *= MATCH_FNV_PRIME;
+    return hash;
+}
+
+
+/*==========================================================================*/
+DWORD hash_list(                    /* fingerprint a configured argument    */
+                                    /* list                                 */
+    const config_window_type*
+                        window,     /* configured window                    */
+    BOOL                expand      /* expand environment variables first   */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             arguments;  /* current argument                     */
+    TCHAR               buffer[ MATCH_ARGUMENT_SIZE ];
+                                    /* expanded argument                    */
+    DWORD               hash;       /* running hash                         */
+    DWORD               i;          /* argument index                       */
+    DWORD               length;     /* length of expanded argument          */
+
+    /*------------------------------------------------------------------
+    Hash the arguments in order.  A compiled argument is expanded from
+    its template.  An argument too long to expand is hashed as given.
+    ------------------------------------------------------------------*/
+    hash      = MATCH_FNV_BASIS;
+    arguments = window->arguments;
+    for( i = 0; ( arguments != NULL ) && ( i < window->argument_count );
+         ++i ) {
+        length = 0;
+        if( ( expand != FALSE ) && ( window->templates != NULL ) ) {
+            length = arg_template_length(
+                window->templates,
+                ( window->template + 1 + i )
+            ) + 1;
+            if( length <= MATCH_ARGUMENT_SIZE ) {
+                arg_template_write(
+                    window->templates,
+                    ( window->template + 1 + i ),
+                    buffer
+                );
+            }
+        }
+        else if( expand != FALSE ) {
+            length = ExpandEnvironmentStrings(
+                arguments,
+                buffer,
+                MATCH_ARGUMENT_SIZE
+            );
+        }
+        hash = fold_text(
+            hash,
+            ( ( ( length > 0 ) && ( length <= MATCH_ARGUMENT_SIZE ) )
+              ? buffer : arguments ),
+            FALSE
+        );
+        arguments += _tcslen( arguments ) + 1;
+    }
+    return hash;
+}
+
+
+/*==========================================================================*/
+LPCTSTR image_name(                 /* find the file name part of a path    */
+    LPCTSTR             path        /* path or file name                    */
+) {                                 /* returns start of the file name       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             name;       /* start of the file name               */
+
+    /*------------------------------------------------------------------
+    The name starts after the last separator.
+    ------------------------------------------------------------------*/
+    for( name = path; *path != _T( '\0' ); ++path ) {
+        if( ( *path == _T( '\\' ) ) || ( *path == _T( '/' ) )
+         || ( *path == _T( ':' ) ) ) {
+            name = path + 1;
+        }
+    }
+    return name;
+}
+
+
+/*==========================================================================*/
+error_type intern_cached(           /* intern a cached process' strings     */
+    proc_pool_type*     pool,       /* pool the strings are interned in     */
+    proc_arena_type*    arena,      /* storage for the ID list              */
+    const proc_info_type*
+                        info,       /* cached process                       */
+    proc_match_entry_type*
+                        entry       /* entry to fill                        */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               k;          /* command string index                 */
+    error_type          result;     /* result of internal operation         */
+    DWORD*              values;     /* pool ID of each command string       */
+
+    /*------------------------------------------------------------------
+    Intern the image path.
+    ------------------------------------------------------------------*/
+    result = proc_pool_intern( pool, info->image, &( entry->image ) );
+    if( result != ERR_OK ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Intern each command string, keeping the list of their IDs.
+    ------------------------------------------------------------------*/
+    values = ( DWORD* ) proc_arena_alloc(
+        arena,
+        ( info->command->count * sizeof( DWORD ) )
+    );
+    if( values == NULL ) {
+        return ERR_ALLOC;
+    }
+    for( k = 0; k < info->command->count; ++k ) {
+        result = proc_pool_intern(
+            pool,
+            info->command->values[ k ],
+            &( values[ k ] )
+        );
+        if( result != ERR_OK ) {
+            return result;
+        }
+    }
+    entry->count  = info->command->count;
+    entry->values = values;
+    return ERR_OK;
+}
+
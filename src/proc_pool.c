@@ -0,0 +1,547 @@
+/*****************************************************************************
+
+proc_pool.c
+
+Interned String Pool
+
+A capture of thousands of processes reads the same image paths and arguments
+again and again.  This module stores each distinct string once, and gives it
+a small integer ID, so records can hold IDs instead of their own copies.
+Once interned, two strings are equal exactly when their IDs are equal.
+
+Paths compare without regard to case, so each string also carries a folded
+ID: the ID of the first string interned that is equal to it ignoring case.
+Two strings are equal ignoring case exactly when their folded IDs are equal.
+
+Strings are copied into an arena, and never move, so a string returned by
+the pool stays valid until the pool is freed.  Interns may come from several
+threads at once.  Every other call reads the pool without locking, so it must
+not run alongside an intern.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "proc_pool.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define POOL_CHUNK          ( 16 * 1024 )
+                                    /* string storage chunk size (bytes)    */
+#define POOL_MIN_ENTRIES    ( 64 )  /* initial number of pool entries       */
+#define POOL_MIN_SLOTS      ( 128 ) /* initial number of hash slots         */
+
+#define POOL_FOLD( _character ) \
+    ( ( DWORD ) _totlower( ( _TUCHAR ) ( _character ) ) )
+                                    /* fold a character's case, the same    */
+                                    /* way for hashing and comparing        */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type grow_pool(               /* rehash into larger slot arrays       */
+    proc_pool_type*     pool        /* interned string pool                 */
+);                                  /* returns error code                   */
+
+DWORD hash_string(                  /* hash a string                        */
+    LPCTSTR             text,       /* string to hash                       */
+    BOOL                fold_case,  /* ignore case                          */
+    DWORD*              length      /* returned length (characters), or     */
+                                    /* NULL                                 */
+);                                  /* returns FNV-1a hash                  */
+
+DWORD probe_exact(                  /* find a string's slot, or an empty    */
+                                    /* one                                  */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to look up                    */
+    DWORD               length,     /* length of the string (characters)    */
+    DWORD               hash        /* hash of the string                   */
+);                                  /* returns slot index                   */
+
+DWORD probe_folded(                 /* find the slot of a string's folded   */
+                                    /* ID, or an empty one                  */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to look up                    */
+    DWORD               hash        /* hash of the string, ignoring case    */
+);                                  /* returns slot index                   */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+DWORD proc_pool_find(               /* look up the ID of an interned string */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to look up                    */
+    BOOL                fold_case   /* ignore case (returns a folded ID)    */
+) {                                 /* returns ID, or PROC_POOL_NONE        */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               hash;       /* hash of the string                   */
+    DWORD               length;     /* length of the string (characters)    */
+    DWORD               slot;       /* slot holding the string              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( pool == NULL ) || ( text == NULL ) || ( pool->slot_count == 0 ) ) {
+        return PROC_POOL_NONE;
+    }
+
+    /*------------------------------------------------------------------
+    Probe the slots for the string.  An empty slot means the string has
+    not been interned.
+    ------------------------------------------------------------------*/
+    hash = hash_string( text, fold_case, &length );
+    if( fold_case != FALSE ) {
+        slot = probe_folded( pool, text, hash );
+        return pool->folds[ slot ] - 1;
+    }
+    slot = probe_exact( pool, text, length, hash );
+    return pool->slots[ slot ] - 1;
+}
+
+
+/*==========================================================================*/
+DWORD proc_pool_fold(               /* get the folded ID of a string        */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    DWORD               id          /* ID of an interned string             */
+) {                                 /* returns ID shared by every string    */
+                                    /* equal to it ignoring case, or        */
+                                    /* PROC_POOL_NONE                       */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( pool == NULL ) || ( id >= pool->count ) ) {
+        return PROC_POOL_NONE;
+    }
+
+    /*------------------------------------------------------------------
+    Return the ID stored when the string was interned.
+    ------------------------------------------------------------------*/
+    return pool->entries[ id ].folded;
+}
+
+
+/*==========================================================================*/
+void proc_pool_free(                /* release an interned string pool      */
+    proc_pool_type*     pool        /* interned string pool                 */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              heap;       /* current process' heap handle         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.  A cleared pool was never initialized.
+    ------------------------------------------------------------------*/
+    if( ( pool == NULL ) || ( pool->arena.head == NULL ) ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release the pool's storage.  Both slot arrays share one allocation.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    if( pool->entries != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) pool->entries );
+    }
+    if( pool->slots != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) pool->slots );
+    }
+    proc_arena_free( &( pool->arena ) );
+    DeleteCriticalSection( &( pool->lock ) );
+
+    /*------------------------------------------------------------------
+    Clear the pool object.
+    ------------------------------------------------------------------*/
+    memset( pool, 0, sizeof( proc_pool_type ) );
+
+}
+
+
+/*==========================================================================*/
+LPCTSTR proc_pool_get(              /* get the string for an ID             */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    DWORD               id          /* ID of an interned string             */
+) {                                 /* returns string (valid until the pool */
+                                    /* is freed), or NULL                   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( pool == NULL ) || ( id >= pool->count ) ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Return the string from the pool's arena.
+    ------------------------------------------------------------------*/
+    return pool->entries[ id ].text;
+}
+
+
+/*==========================================================================*/
+error_type proc_pool_init(          /* initialize an interned string pool   */
+    proc_pool_type*     pool        /* interned string pool                 */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    error_type          result;     /* result of internal operation         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( pool == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Start empty; the tables are allocated by the first intern.
+    ------------------------------------------------------------------*/
+    memset( pool, 0, sizeof( proc_pool_type ) );
+    result = proc_arena_init( &( pool->arena ), POOL_CHUNK );
+    if( result != ERR_OK ) {
+        memset( pool, 0, sizeof( proc_pool_type ) );
+        return result;
+    }
+    InitializeCriticalSection( &( pool->lock ) );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_pool_intern(        /* intern a string                      */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to intern                     */
+    DWORD*              id          /* returned ID of the string            */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* new number of entries                */
+    LPTSTR              copy;       /* string copied to the arena           */
+    proc_pool_entry_type*
+                        entry;      /* new entry                            */
+    DWORD               fold_hash;  /* hash of the string, ignoring case    */
+    DWORD               fold_slot;  /* slot holding the folded ID           */
+    LPVOID              grown;      /* reallocated entry list               */
+    DWORD               hash;       /* hash of the string                   */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               length;     /* length of the string (characters)    */
+    error_type          result;     /* result of internal operation         */
+    DWORD               slot;       /* slot holding the string              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( pool == NULL ) || ( text == NULL ) || ( id == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Hash outside the lock, so concurrent interns only wait on the
+    lookup.
+    ------------------------------------------------------------------*/
+    hash = hash_string( text, FALSE, &length );
+    EnterCriticalSection( &( pool->lock ) );
+
+    /*------------------------------------------------------------------
+    Keep the slots at most half full.
+    ------------------------------------------------------------------*/
+    if( ( ( pool->count + 1 ) * 2 ) > pool->slot_count ) {
+        result = grow_pool( pool );
+        if( result != ERR_OK ) {
+            LeaveCriticalSection( &( pool->lock ) );
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return the existing ID if the string is already interned.
+    ------------------------------------------------------------------*/
+    slot = probe_exact( pool, text, length, hash );
+    if( pool->slots[ slot ] != 0 ) {
+        *id               = pool->slots[ slot ] - 1;
+        pool->references += 1;
+        pool->saved      += ( length + 1 ) * sizeof( TCHAR );
+        LeaveCriticalSection( &( pool->lock ) );
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Grow the entry list if it is full.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    if( pool->count == pool->capacity ) {
+        capacity = ( pool->capacity == 0 )
+                 ? POOL_MIN_ENTRIES : ( pool->capacity * 2 );
+        grown = ( pool->entries == NULL )
+              ? HeapAlloc( heap, 0, capacity * sizeof( proc_pool_entry_type ) )
+              : HeapReAlloc(
+                    heap,
+                    0,
+                    ( LPVOID ) pool->entries,
+                    capacity * sizeof( proc_pool_entry_type )
+                );
+        if( grown == NULL ) {
+            LeaveCriticalSection( &( pool->lock ) );
+            return ERR_ALLOC;
+        }
+        pool->entries  = ( proc_pool_entry_type* ) grown;
+        pool->capacity = capacity;
+    }
+
+    /*------------------------------------------------------------------
+    Copy the string into the arena.
+    ------------------------------------------------------------------*/
+    copy = ( LPTSTR ) proc_arena_alloc(
+        &( pool->arena ),
+        ( length + 1 ) * sizeof( TCHAR )
+    );
+    if( copy == NULL ) {
+        LeaveCriticalSection( &( pool->lock ) );
+        return ERR_ALLOC;
+    }
+    memcpy( copy, text, ( length + 1 ) * sizeof( TCHAR ) );
+
+    /*------------------------------------------------------------------
+    The string joins the folded ID of an equal string, or starts its
+    own.
+    ------------------------------------------------------------------*/
+    fold_hash = hash_string( text, TRUE, NULL );
+    fold_slot = probe_folded( pool, text, fold_hash );
+    entry     = &( pool->entries[ pool->count ] );
+    entry->hash      = hash;
+    entry->fold_hash = fold_hash;
+    entry->length    = length;
+    entry->text      = copy;
+    if( pool->folds[ fold_slot ] != 0 ) {
+        entry->folded = pool->folds[ fold_slot ] - 1;
+    }
+    else {
+        entry->folded             = pool->count;
+        pool->folds[ fold_slot ]  = pool->count + 1;
+    }
+
+    /*------------------------------------------------------------------
+    Claim the string's slot, and return its new ID.
+    ------------------------------------------------------------------*/
+    pool->count         += 1;
+    pool->slots[ slot ]  = pool->count;
+    *id                  = pool->count - 1;
+    LeaveCriticalSection( &( pool->lock ) );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type grow_pool(               /* rehash into larger slot arrays       */
+    proc_pool_type*     pool        /* interned string pool                 */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* new number of each kind of slot      */
+    DWORD*              folds;      /* new folded ID slots                  */
+    DWORD               id;         /* ID being rehashed                    */
+    DWORD               mask;       /* new slot index mask                  */
+    DWORD               slot;       /* new slot for the ID                  */
+    DWORD*              slots;      /* new string slots                     */
+
+    /*------------------------------------------------------------------
+    Allocate both cleared slot arrays at once, twice the current size.
+    ------------------------------------------------------------------*/
+    count = ( pool->slot_count == 0 ) ? POOL_MIN_SLOTS
+                                      : ( pool->slot_count * 2 );
+    slots = ( DWORD* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( 2 * count * sizeof( DWORD ) )
+    );
+    if( slots == NULL ) {
+        return ERR_ALLOC;
+    }
+    folds = slots + count;
+
+    /*------------------------------------------------------------------
+    Reinsert every ID using its stored hashes.  Only the string that
+    starts a folded ID has a folded slot.
+    ------------------------------------------------------------------*/
+    mask = count - 1;
+    for( id = 0; id < pool->count; ++id ) {
+        slot = pool->entries[ id ].hash & mask;
+        while( slots[ slot ] != 0 ) {
+            slot = ( slot + 1 ) & mask;
+        }
+        slots[ slot ] = id + 1;
+        if( pool->entries[ id ].folded != id ) {
+            continue;
+        }
+        slot = pool->entries[ id ].fold_hash & mask;
+        while( folds[ slot ] != 0 ) {
+            slot = ( slot + 1 ) & mask;
+        }
+        folds[ slot ] = id + 1;
+    }
+
+    /*------------------------------------------------------------------
+    Replace the previous slot arrays.
+    ------------------------------------------------------------------*/
+    if( pool->slots != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) pool->slots );
+    }
+    pool->slots      = slots;
+    pool->folds      = folds;
+    pool->slot_count = count;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD hash_string(                  /* hash a string                        */
+    LPCTSTR             text,       /* string to hash                       */
+    BOOL                fold_case,  /* ignore case                          */
+    DWORD*              length      /* returned length (characters), or     */
+                                    /* NULL                                 */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               hash;       /* running hash value                   */
+    LPCTSTR             start;      /* start of the string                  */
+
+    /*------------------------------------------------------------------
+    Fold each character into the hash.
+    ------------------------------------------------------------------*/
+    hash = 2166136261UL;
+    for( start = text; *text != _T( '\0' ); ++text ) {
+        hash ^= ( fold_case != FALSE ) ? POOL_FOLD( *text )
+                                       : ( DWORD ) ( _TUCHAR ) *text;
+        hash *= 16777619UL;
+    }
+
+    /*------------------------------------------------------------------
+    Return the hash, and the length it found on the way.
+    ------------------------------------------------------------------*/
+    if( length != NULL ) {
+        *length = ( DWORD ) ( text - start );
+    }
+    return hash;
+}
+
+
+/*==========================================================================*/
+DWORD probe_exact(                  /* find a string's slot, or an empty    */
+                                    /* one                                  */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to look up                    */
+    DWORD               length,     /* length of the string (characters)    */
+    DWORD               hash        /* hash of the string                   */
+) {                                 /* returns slot index                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_pool_entry_type*
+                        entry;      /* entry in the current slot            */
+    DWORD               mask;       /* slot index mask                      */
+    DWORD               slot;       /* current slot index                   */
+
+    /*------------------------------------------------------------------
+    Probe linearly from the string's home slot.  The hash and length are
+    compared before any characters.
+    ------------------------------------------------------------------*/
+    mask = pool->slot_count - 1;
+    for( slot = hash & mask; ; slot = ( slot + 1 ) & mask ) {
+        if( pool->slots[ slot ] == 0 ) {
+            return slot;
+        }
+        entry = &( pool->entries[ pool->slots[ slot ] - 1 ] );
+        if( ( entry->hash == hash ) && ( entry->length == length )
+         && ( memcmp( entry->text, text, ( length * sizeof( TCHAR ) ) )
+              == 0 ) ) {
+            return slot;
+        }
+    }
+}
+
+
+/*==========================================================================*/
+DWORD probe_folded(                 /* find the slot of a string's folded   */
+                                    /* ID, or an empty one                  */
+    proc_pool_type*     pool,       /* interned string pool                 */
+    LPCTSTR             text,       /* string to look up                    */
+    DWORD               hash        /* hash of the string, ignoring case    */
+) {                                 /* returns slot index                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_pool_entry_type*
+                        entry;      /* entry in the current slot            */
+    DWORD               i;          /* character index                      */
+    DWORD               mask;       /* slot index mask                      */
+    DWORD               slot;       /* current slot index                   */
+
+    /*------------------------------------------------------------------
+    Probe linearly from the string's home slot, comparing the folded
+    hash before the characters.  Characters are folded just as they
+    were for the hash, so strings that compare equal always share a
+    hash.
+    ------------------------------------------------------------------*/
+    mask = pool->slot_count - 1;
+    for( slot = hash & mask; ; slot = ( slot + 1 ) & mask ) {
+        if( pool->folds[ slot ] == 0 ) {
+            return slot;
+        }
+        entry = &( pool->entries[ pool->folds[ slot ] - 1 ] );
+        if( entry->fold_hash != hash ) {
+            continue;
+        }
+        for( i = 0; POOL_FOLD( entry->text[ i ] ) == POOL_FOLD( text[ i ] );
+             ++i ) {
+            if( text[ i ] == _T( '\0' ) ) {
+                return slot;
+            }
+        }
+    }
+}
+
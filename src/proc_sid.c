@@ -0,0 +1,465 @@
+/*****************************************************************************
+
+proc_sid.c
+
+Interned Security Identifier Table
+
+This module stores each distinct SID once, and gives it a small integer key.
+Once interned, two SIDs are equal exactly when their keys are equal, so owner
+comparisons across a capture reduce to integer compares.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "proc_sid.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define SID_MIN_ENTRIES     ( 16 )  /* initial number of table entries      */
+#define SID_MIN_DATA        ( 1024 )/* initial SID storage size (bytes)     */
+#define SID_MIN_SLOTS       ( 32 )  /* initial number of hash slots         */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD find_slot(                    /* find a SID's slot, or an empty one   */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    PSID                sid,        /* SID to look up                       */
+    DWORD               length,     /* length of the SID (bytes)            */
+    DWORD               hash        /* hash of the SID                      */
+);                                  /* returns slot index                   */
+
+error_type grow_slots(              /* rehash into a larger slot array      */
+    proc_sid_table_type*
+                        table       /* interned SID table                   */
+);                                  /* returns error code                   */
+
+DWORD hash_sid(                     /* hash a SID's bytes                   */
+    PSID                sid,        /* SID to hash                          */
+    DWORD               length      /* length of the SID (bytes)            */
+);                                  /* returns FNV-1a hash                  */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+DWORD proc_sid_find(                /* look up the key of an interned SID   */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    PSID                sid         /* SID to look up                       */
+) {                                 /* returns key, or PROC_SID_NONE        */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               length;     /* length of the SID (bytes)            */
+    DWORD               slot;       /* slot holding the SID                 */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( table == NULL ) || ( sid == NULL ) || ( table->slot_count == 0 ) ) {
+        return PROC_SID_NONE;
+    }
+
+    /*------------------------------------------------------------------
+    Probe the hash slots for the SID.
+    ------------------------------------------------------------------*/
+    length = GetLengthSid( sid );
+    slot   = find_slot( table, sid, length, hash_sid( sid, length ) );
+
+    /*------------------------------------------------------------------
+    An empty slot means the SID has not been interned.
+    ------------------------------------------------------------------*/
+    return table->slots[ slot ] - 1;
+}
+
+
+/*==========================================================================*/
+void proc_sid_free(                 /* release an interned SID table        */
+    proc_sid_table_type*
+                        table       /* interned SID table                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              heap;       /* current process' heap handle         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( table == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release the table's storage.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    if( table->entries != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->entries );
+    }
+    if( table->slots != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->slots );
+    }
+    if( table->data != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) table->data );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the table object.
+    ------------------------------------------------------------------*/
+    memset( table, 0, sizeof( proc_sid_table_type ) );
+
+}
+
+
+/*==========================================================================*/
+PSID proc_sid_get(                  /* get the SID for a key                */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    DWORD               key         /* key of an interned SID               */
+) {                                 /* returns SID (valid until the next    */
+                                    /* intern), or NULL                     */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( table == NULL ) || ( key >= table->count ) ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Return the SID from the table's storage.
+    ------------------------------------------------------------------*/
+    return ( PSID ) ( table->data + table->entries[ key ].offset );
+}
+
+
+/*==========================================================================*/
+error_type proc_sid_init(           /* initialize an interned SID table     */
+    proc_sid_table_type*
+                        table       /* interned SID table                   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( table == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Start empty; storage is allocated by the first intern.
+    ------------------------------------------------------------------*/
+    memset( table, 0, sizeof( proc_sid_table_type ) );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_sid_intern(         /* intern a SID                         */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    PSID                sid,        /* SID to intern                        */
+    DWORD*              key         /* returned key of the SID              */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* new number of entries                */
+    LPVOID              grown;      /* reallocated storage                  */
+    DWORD               hash;       /* hash of the SID                      */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               length;     /* length of the SID (bytes)            */
+    error_type          result;     /* result of internal operation         */
+    DWORD               size;       /* new SID storage size (bytes)         */
+    DWORD               slot;       /* slot holding the SID                 */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( table == NULL ) || ( sid == NULL ) || ( key == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Keep the slots at most half full.
+    ------------------------------------------------------------------*/
+    if( ( ( table->count + 1 ) * 2 ) > table->slot_count ) {
+        result = grow_slots( table );
+        if( result != ERR_OK ) {
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return the existing key if the SID is already interned.
+    ------------------------------------------------------------------*/
+    length = GetLengthSid( sid );
+    hash   = hash_sid( sid, length );
+    slot   = find_slot( table, sid, length, hash );
+    if( table->slots[ slot ] != 0 ) {
+        *key = table->slots[ slot ] - 1;
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Grow the entry list if it is full.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    if( table->count == table->capacity ) {
+        capacity = ( table->capacity == 0 )
+                 ? SID_MIN_ENTRIES : ( table->capacity * 2 );
+        grown = ( table->entries == NULL )
+              ? HeapAlloc( heap, 0, capacity * sizeof( proc_sid_entry_type ) )
+              : HeapReAlloc(
+                    heap,
+                    0,
+                    ( LPVOID ) table->entries,
+                    capacity * sizeof( proc_sid_entry_type )
+                );
+        if( grown == NULL ) {
+            return ERR_ALLOC;
+        }
+        table->entries  = ( proc_sid_entry_type* ) grown;
+        table->capacity = capacity;
+    }
+
+    /*------------------------------------------------------------------
+    Grow the SID storage if it can not hold another SID.
+    ------------------------------------------------------------------*/
+    if( ( table->data_used + length ) > table->data_size ) {
+        size = ( table->data_size == 0 ) ? SID_MIN_DATA : table->data_size;
+        while( ( table->data_used + length ) > size ) {
+            size *= 2;
+        }
+        grown = ( table->data == NULL )
+              ? HeapAlloc( heap, 0, size )
+              : HeapReAlloc( heap, 0, ( LPVOID ) table->data, size );
+        if( grown == NULL ) {
+            return ERR_ALLOC;
+        }
+        table->data      = ( LPBYTE ) grown;
+        table->data_size = size;
+    }
+
+    /*------------------------------------------------------------------
+    Store the SID and claim its slot.
+    ------------------------------------------------------------------*/
+    CopySid( length, ( PSID ) ( table->data + table->data_used ), sid );
+    table->entries[ table->count ].hash   = hash;
+    table->entries[ table->count ].length = length;
+    table->entries[ table->count ].offset = table->data_used;
+    table->data_used     += length;
+    table->count         += 1;
+    table->slots[ slot ]  = table->count;
+
+    /*------------------------------------------------------------------
+    Return the new key.
+    ------------------------------------------------------------------*/
+    *key = table->count - 1;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type proc_sid_user(           /* intern the invoking user's SID       */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    DWORD*              key         /* returned key of the user's SID       */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    BYTE                buffer[ sizeof( TOKEN_USER ) + SECURITY_MAX_SID_SIZE ];
+                                    /* user information storage             */
+    DWORD               return_length;
+                                    /* data length return variable          */
+    HANDLE              token;      /* this process' token                  */
+    BOOL                wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Open a query token to this process.
+    ------------------------------------------------------------------*/
+    wresult = OpenProcessToken( GetCurrentProcess(), TOKEN_QUERY, &token );
+    if( wresult == FALSE ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    The user information always fits in the local buffer.
+    ------------------------------------------------------------------*/
+    wresult = GetTokenInformation(
+        token,
+        TokenUser,
+        ( LPVOID ) buffer,
+        sizeof( buffer ),
+        &return_length
+    );
+    CloseHandle( token );
+    if( wresult == FALSE ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Intern the user's SID.
+    ------------------------------------------------------------------*/
+    return proc_sid_intern(
+        table,
+        ( ( PTOKEN_USER ) buffer )->User.Sid,
+        key
+    );
+}
+
+
+/*==========================================================================*/
+DWORD find_slot(                    /* find a SID's slot, or an empty one   */
+    proc_sid_table_type*
+                        table,      /* interned SID table                   */
+    PSID                sid,        /* SID to look up                       */
+    DWORD               length,     /* length of the SID (bytes)            */
+    DWORD               hash        /* hash of the SID                      */
+) {                                 /* returns slot index                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_sid_entry_type*
+                        entry;      /* entry in the current slot            */
+    DWORD               mask;       /* slot index mask                      */
+    DWORD               slot;       /* current slot index                   */
+
+    /*------------------------------------------------------------------
+    Probe linearly from the SID's home slot.  The hash and length are
+    compared before any of the SID's bytes.
+    ------------------------------------------------------------------*/
+    mask = table->slot_count - 1;
+    for( slot = hash & mask; ; slot = ( slot + 1 ) & mask ) {
+        if( table->slots[ slot ] == 0 ) {
+            return slot;
+        }
+        entry = &( table->entries[ table->slots[ slot ] - 1 ] );
+        if( ( entry->hash == hash ) && ( entry->length == length )
+         && ( memcmp( ( table->data + entry->offset ), sid, length ) == 0 ) ) {
+            return slot;
+        }
+    }
+}
+
+
+/*==========================================================================*/
+error_type grow_slots(              /* rehash into a larger slot array      */
+    proc_sid_table_type*
+                        table       /* interned SID table                   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* new number of hash slots             */
+    DWORD               key;        /* key being rehashed                   */
+    DWORD               mask;       /* new slot index mask                  */
+    DWORD               slot;       /* new slot for the key                 */
+    DWORD*              slots;      /* new hash slots                       */
+
+    /*------------------------------------------------------------------
+    Allocate a cleared slot array twice the current size.
+    ------------------------------------------------------------------*/
+    count = ( table->slot_count == 0 ) ? SID_MIN_SLOTS
+                                       : ( table->slot_count * 2 );
+    slots = ( DWORD* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        count * sizeof( DWORD )
+    );
+    if( slots == NULL ) {
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Reinsert every key using its stored hash.
+    ------------------------------------------------------------------*/
+    mask = count - 1;
+    for( key = 0; key < table->count; ++key ) {
+        slot = table->entries[ key ].hash & mask;
+        while( slots[ slot ] != 0 ) {
+            slot = ( slot + 1 ) & mask;
+        }
+        slots[ slot ] = key + 1;
+    }
+
+    /*------------------------------------------------------------------
+    Replace the previous slot array.
+    ------------------------------------------------------------------*/
+    if( table->slots != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) table->slots );
+    }
+    table->slots      = slots;
+    table->slot_count = count;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD hash_sid(                     /* hash a SID's bytes                   */
+    PSID                sid,        /* SID to hash                          */
+    DWORD               length      /* length of the SID (bytes)            */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPBYTE              bytes;      /* SID's bytes                          */
+    DWORD               hash;       /* running hash value                   */
+    DWORD               i;          /* loop index                           */
+
+    /*------------------------------------------------------------------
+    Fold each byte into the hash.
+    ------------------------------------------------------------------*/
+    bytes = ( LPBYTE ) sid;
+    hash  = 2166136261UL;
+    for( i = 0; i < length; ++i ) {
+        hash ^= bytes[ i ];
+        hash *= 16777619UL;
+    }
+
+    /*------------------------------------------------------------------
+    Return the hash.
+    ------------------------------------------------------------------*/
+    return hash;
+}
+
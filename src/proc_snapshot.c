@@ -0,0 +1,734 @@
+/*****************************************************************************
+
+proc_snapshot.c
+
+Process Table Snapshot Interface
+
+This module captures the entire process table with a single system query
+instead of opening each process individually.  The records and image names of
+a snapshot are stored in one contiguous allocation.  Owner SIDs are interned
+in the instance's SID table, so records carry a small integer key for their
+owner, and a capture can be restricted to one owner before any per-process
+string work is done.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdlib.h>
+#include <winternl.h>
+#include <wtsapi32.h>
+
+#include "proc_snapshot.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PROC_SNAPSHOT_BUFFER ( 256 * 1024 )
+                                    /* initial system query buffer size     */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct proc_system_process_s {
+                                    /* system process information entry     */
+    ULONG               next;       /* offset to next entry, or 0           */
+    ULONG               threads;    /* number of threads in process         */
+    LARGE_INTEGER       private_size;
+                                    /* private working set size             */
+    ULONG               hard_faults;/* hard fault count                     */
+    ULONG               thread_mark;/* thread count high watermark          */
+    ULONGLONG           cycle_time; /* CPU cycle time                       */
+    LARGE_INTEGER       create_time;/* process creation time                */
+    LARGE_INTEGER       user_time;  /* time spent in user mode              */
+    LARGE_INTEGER       kernel_time;/* time spent in kernel mode            */
+    UNICODE_STRING      image;      /* process image name                   */
+    LONG                priority;   /* base priority                        */
+    HANDLE              id;         /* process ID                           */
+    HANDLE              parent;     /* parent process ID                    */
+    ULONG               handles;    /* number of open handles               */
+    ULONG               session;    /* terminal services session ID         */
+} proc_system_process_type;
+
+typedef struct proc_owner_s {       /* process owner pairing type           */
+    DWORD               id;         /* process ID                           */
+    DWORD               owner;      /* key of owner SID                     */
+} proc_owner_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+int compare_owners(                 /* order owner pairings by process ID   */
+    const void*         left,       /* left-hand pairing                    */
+    const void*         right       /* right-hand pairing                   */
+);                                  /* returns relative order               */
+
+int compare_records(                /* order process records by ID          */
+    const void*         left,       /* left-hand record                     */
+    const void*         right       /* right-hand record                    */
+);                                  /* returns relative order               */
+
+proc_owner_type* find_owner(        /* find an owner pairing by process ID  */
+    proc_owner_type*    owners,     /* list of pairings sorted by ID        */
+    DWORD               count,      /* number of pairings in list           */
+    DWORD               id          /* process ID to find                   */
+);                                  /* returns pairing, or NULL             */
+
+error_type load_owners(             /* load and intern process owners       */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               owner,      /* owner key to keep, or NONE for all   */
+    proc_owner_type**   owners,     /* returned list of pairings by ID      */
+    DWORD*              count       /* returned number of pairings          */
+);                                  /* returns error code                   */
+
+error_type query_processes(         /* query the system process table       */
+    proc_instance_type* instance,   /* process information instance         */
+    LPBYTE*             buffer      /* returned heap buffer of entries      */
+);                                  /* returns error code                   */
+
+error_type take_snapshot(           /* capture some or all of the processes */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* snapshot object to initialize        */
+    DWORD               owner       /* owner key to keep, or NONE for all   */
+);                                  /* returns error code                   */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+proc_record_type* proc_snapshot_find(
+                                    /* find a process record by ID          */
+    proc_snapshot_type* snapshot,   /* process table snapshot               */
+    DWORD               id          /* process ID to find                   */
+) {                                 /* returns record, or NULL              */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               high;       /* upper bound of search range          */
+    DWORD               low;        /* lower bound of search range          */
+    DWORD               middle;     /* record being tested                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( snapshot == NULL ) || ( snapshot->records == NULL ) ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Binary search the ID-ordered list of records.
+    ------------------------------------------------------------------*/
+    low  = 0;
+    high = snapshot->count;
+    while( low < high ) {
+        middle = low + ( ( high - low ) / 2 );
+        if( snapshot->records[ middle ].id == id ) {
+            return &( snapshot->records[ middle ] );
+        }
+        else if( snapshot->records[ middle ].id < id ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The process is not in the snapshot.
+    ------------------------------------------------------------------*/
+    return NULL;
+}
+
+
+/*==========================================================================*/
+void proc_snapshot_free(            /* release a process table snapshot     */
+    proc_snapshot_type* snapshot    /* process table snapshot               */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( snapshot == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release the single block backing the snapshot.
+    ------------------------------------------------------------------*/
+    if( snapshot->block != NULL ) {
+        HeapFree( GetProcessHeap(), 0, snapshot->block );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the snapshot object.
+    ------------------------------------------------------------------*/
+    memset( snapshot, 0, sizeof( proc_snapshot_type ) );
+
+}
+
+
+/*==========================================================================*/
+LPCTSTR proc_snapshot_image(        /* get a record's image name            */
+    proc_snapshot_type* snapshot,   /* process table snapshot               */
+    proc_record_type*   record      /* process record                       */
+) {                                 /* returns image name string            */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( snapshot == NULL ) || ( record == NULL ) ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Return the image name from the string table.
+    ------------------------------------------------------------------*/
+    return snapshot->strings + record->image;
+}
+
+
+/*==========================================================================*/
+PSID proc_snapshot_owner(           /* get a record's owner SID             */
+    proc_snapshot_type* snapshot,   /* process table snapshot               */
+    proc_record_type*   record      /* process record                       */
+) {                                 /* returns owner SID, or NULL           */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( snapshot == NULL ) || ( record == NULL ) ) {
+        return NULL;
+    }
+
+    /*------------------------------------------------------------------
+    Return the owner SID from the instance's SID table.  Not all
+    processes report an owner (e.g. the idle process).
+    ------------------------------------------------------------------*/
+    return proc_sid_get( &( snapshot->instance->sids ), record->owner );
+}
+
+
+/*==========================================================================*/
+error_type proc_snapshot_take(      /* capture the whole process table      */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot    /* snapshot object to initialize        */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Capture every process.
+    ------------------------------------------------------------------*/
+    return take_snapshot( instance, snapshot, PROC_SID_NONE );
+}
+
+
+/*==========================================================================*/
+error_type proc_snapshot_take_owned(
+                                    /* capture one owner's processes        */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* snapshot object to initialize        */
+    DWORD               owner       /* key of the owner SID to keep         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( owner == PROC_SID_NONE ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Capture only the owner's processes.
+    ------------------------------------------------------------------*/
+    return take_snapshot( instance, snapshot, owner );
+}
+
+
+/*==========================================================================*/
+int compare_owners(                 /* order owner pairings by process ID   */
+    const void*         left,       /* left-hand pairing                    */
+    const void*         right       /* right-hand pairing                   */
+) {                                 /* returns relative order               */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               left_id;    /* left-hand process ID                 */
+    DWORD               right_id;   /* right-hand process ID                */
+
+    /*------------------------------------------------------------------
+    Compare the process IDs without risking overflow.
+    ------------------------------------------------------------------*/
+    left_id  = ( ( const proc_owner_type* ) left )->id;
+    right_id = ( ( const proc_owner_type* ) right )->id;
+    return ( left_id > right_id ) - ( left_id < right_id );
+}
+
+
+/*==========================================================================*/
+int compare_records(                /* order process records by ID          */
+    const void*         left,       /* left-hand record                     */
+    const void*         right       /* right-hand record                    */
+) {                                 /* returns relative order               */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               left_id;    /* left-hand process ID                 */
+    DWORD               right_id;   /* right-hand process ID                */
+
+    /*------------------------------------------------------------------
+    Compare the process IDs without risking overflow.
+    ------------------------------------------------------------------*/
+    left_id  = ( ( const proc_record_type* ) left )->id;
+    right_id = ( ( const proc_record_type* ) right )->id;
+    return ( left_id > right_id ) - ( left_id < right_id );
+}
+
+
+/*==========================================================================*/
+proc_owner_type* find_owner(        /* find an owner pairing by process ID  */
+    proc_owner_type*    owners,     /* list of pairings sorted by ID        */
+    DWORD               count,      /* number of pairings in list           */
+    DWORD               id          /* process ID to find                   */
+) {                                 /* returns pairing, or NULL             */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               high;       /* upper bound of search range          */
+    DWORD               low;        /* lower bound of search range          */
+    DWORD               middle;     /* pairing being tested                 */
+
+    /*------------------------------------------------------------------
+    Binary search the ID-ordered list of pairings.
+    ------------------------------------------------------------------*/
+    low  = 0;
+    high = count;
+    while( low < high ) {
+        middle = low + ( ( high - low ) / 2 );
+        if( owners[ middle ].id == id ) {
+            return &( owners[ middle ] );
+        }
+        else if( owners[ middle ].id < id ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The process has no pairing.
+    ------------------------------------------------------------------*/
+    return NULL;
+}
+
+
+/*==========================================================================*/
+error_type load_owners(             /* load and intern process owners       */
+    proc_instance_type* instance,   /* process information instance         */
+    DWORD               owner,      /* owner key to keep, or NONE for all   */
+    proc_owner_type**   owners,     /* returned list of pairings by ID      */
+    DWORD*              count       /* returned number of pairings          */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* loop index                           */
+    DWORD               key;        /* key of current owner SID             */
+    error_type          result;     /* result of internal operation         */
+    DWORD               wts_count;  /* number of terminal services entries  */
+    PWTS_PROCESS_INFO   wts_info;   /* terminal services process list       */
+    BOOL                wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Initialize the user's memory.
+    ------------------------------------------------------------------*/
+    *owners = NULL;
+    *count  = 0;
+
+    /*------------------------------------------------------------------
+    Fetch the owner of every process in one query.
+    ------------------------------------------------------------------*/
+    wts_count = 0;
+    wts_info  = NULL;
+    wresult   = WTSEnumerateProcesses(
+        WTS_CURRENT_SERVER_HANDLE,
+        0,
+        1,
+        &wts_info,
+        &wts_count
+    );
+    if( wresult == FALSE ) {
+        return ERR_WINAPI;
+    }
+    if( wts_count == 0 ) {
+        WTSFreeMemory( wts_info );
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate the list of pairings.
+    ------------------------------------------------------------------*/
+    *owners = ( proc_owner_type* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( wts_count * sizeof( proc_owner_type ) )
+    );
+    if( *owners == NULL ) {
+        WTSFreeMemory( wts_info );
+        return ERR_ALLOC;
+    }
+
+    /*------------------------------------------------------------------
+    Intern each owner, keeping only the requested owner's processes.
+    Repeated SIDs hash to the same key, so this is a table probe per
+    process rather than a copy.
+    ------------------------------------------------------------------*/
+    result = ERR_OK;
+    for( i = 0; i < wts_count; ++i ) {
+        if( wts_info[ i ].pUserSid == NULL ) {
+            continue;
+        }
+        result = proc_sid_intern(
+            &( instance->sids ),
+            wts_info[ i ].pUserSid,
+            &key
+        );
+        if( result != ERR_OK ) {
+            break;
+        }
+        if( ( owner != PROC_SID_NONE ) && ( key != owner ) ) {
+            continue;
+        }
+        ( *owners )[ *count ].id    = wts_info[ i ].ProcessId;
+        ( *owners )[ *count ].owner = key;
+        *count += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Release the terminal services process list.
+    ------------------------------------------------------------------*/
+    WTSFreeMemory( wts_info );
+    if( result != ERR_OK ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) *owners );
+        *owners = NULL;
+        *count  = 0;
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Order the pairings by process ID.
+    ------------------------------------------------------------------*/
+    qsort( *owners, *count, sizeof( proc_owner_type ), compare_owners );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type query_processes(         /* query the system process table       */
+    proc_instance_type* instance,   /* process information instance         */
+    LPBYTE*             buffer      /* returned heap buffer of entries      */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              heap;       /* current process' heap handle         */
+    ULONG               return_length;
+                                    /* data length return variable          */
+    ULONG               size;       /* size of the query buffer             */
+    NTSTATUS            status;     /* status of NT Windows API calls       */
+
+    /*------------------------------------------------------------------
+    Start with a buffer that fits a typical process table.
+    ------------------------------------------------------------------*/
+    heap = GetProcessHeap();
+    size = PROC_SNAPSHOT_BUFFER;
+
+    /*------------------------------------------------------------------
+    The process table may grow between attempts, so retry until the
+    entire table fits.
+    ------------------------------------------------------------------*/
+    for( ; ; ) {
+
+        /*--------------------------------------------------------------
+        Allocate the query buffer.
+        --------------------------------------------------------------*/
+        *buffer = ( LPBYTE ) HeapAlloc( heap, 0, size );
+        if( *buffer == NULL ) {
+            return ERR_ALLOC;
+        }
+
+        /*--------------------------------------------------------------
+        Query the process table.
+        --------------------------------------------------------------*/
+        return_length = 0;
+        status = instance->nqsi(
+            SystemProcessInformation,
+            ( PVOID ) *buffer,
+            size,
+            &return_length
+        );
+        if( status == STATUS_SUCCESS ) {
+            return ERR_OK;
+        }
+
+        /*--------------------------------------------------------------
+        Release the buffer, and grow it if the table did not fit.
+        --------------------------------------------------------------*/
+        HeapFree( heap, 0, *buffer );
+        *buffer = NULL;
+        if( status != STATUS_INFO_LENGTH_MISMATCH ) {
+            return ERR_WINAPI;
+        }
+        size = return_length + ( PROC_SNAPSHOT_BUFFER / 4 );
+    }
+}
+
+
+/*==========================================================================*/
+error_type take_snapshot(           /* capture some or all of the processes */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* snapshot object to initialize        */
+    DWORD               owner       /* owner key to keep, or NONE for all   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPBYTE              buffer;     /* system process information buffer    */
+    DWORD               count;      /* number of processes to record        */
+    proc_system_process_type*
+                        entry;      /* current system process entry         */
+    HANDLE              heap;       /* current process' heap handle         */
+    DWORD               i;          /* record index                         */
+    DWORD               j;          /* owner pairing index                  */
+    DWORD               length;     /* length of current string             */
+    DWORD               owner_count;/* number of owner pairings             */
+    proc_owner_type*    owners;     /* owner pairings sorted by ID          */
+    proc_record_type*   record;     /* current snapshot record              */
+    error_type          result;     /* result of internal operation         */
+    SIZE_T              string_offset;
+                                    /* next free offset in string table     */
+    SIZE_T              string_size;/* total size of string table           */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( instance == NULL ) || ( snapshot == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Initialize the user's memory.
+    ------------------------------------------------------------------*/
+    memset( snapshot, 0, sizeof( proc_snapshot_type ) );
+    snapshot->instance = instance;
+    heap               = GetProcessHeap();
+
+    /*------------------------------------------------------------------
+    Check for drive changes once per capture, so image paths queried
+    for the captured processes translate without device queries.
+    ------------------------------------------------------------------*/
+    proc_volume_refresh( &( instance->volumes ) );
+
+    /*------------------------------------------------------------------
+    Fetch the process owners first, so a filtered capture knows which
+    processes to skip.  Owners are optional for a full capture.
+    ------------------------------------------------------------------*/
+    result = load_owners( instance, owner, &owners, &owner_count );
+    if( ( result != ERR_OK ) && ( owner != PROC_SID_NONE ) ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Fetch the entire process table in one query.
+    ------------------------------------------------------------------*/
+    result = query_processes( instance, &buffer );
+    if( result != ERR_OK ) {
+        if( owners != NULL ) {
+            HeapFree( heap, 0, ( LPVOID ) owners );
+        }
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Size the records and the string table, skipping other owners'
+    processes.  Image names are bounded by their UTF-16 size in either
+    character encoding.
+    ------------------------------------------------------------------*/
+    count       = 0;
+    string_size = 0;
+    entry       = ( proc_system_process_type* ) buffer;
+    for( ; ; ) {
+        if( ( owner == PROC_SID_NONE )
+         || ( find_owner(
+                  owners,
+                  owner_count,
+                  ( DWORD ) ( ULONG_PTR ) entry->id
+              ) != NULL ) ) {
+            count       += 1;
+            string_size += entry->image.Length + sizeof( TCHAR );
+        }
+        if( entry->next == 0 ) {
+            break;
+        }
+        entry = ( proc_system_process_type* ) ( ( LPBYTE ) entry
+                                              + entry->next );
+    }
+
+    /*------------------------------------------------------------------
+    Allocate one block for the records and strings.
+    ------------------------------------------------------------------*/
+    snapshot->block = HeapAlloc(
+        heap,
+        0,
+        ( ( count * sizeof( proc_record_type ) ) + string_size + 1 )
+    );
+    if( snapshot->block == NULL ) {
+        if( owners != NULL ) {
+            HeapFree( heap, 0, ( LPVOID ) owners );
+        }
+        HeapFree( heap, 0, buffer );
+        return ERR_ALLOC;
+    }
+    snapshot->count   = count;
+    snapshot->records = ( proc_record_type* ) snapshot->block;
+    snapshot->strings = ( LPTSTR ) ( snapshot->records + count );
+
+    /*------------------------------------------------------------------
+    Load each kept system process entry into a snapshot record.
+    ------------------------------------------------------------------*/
+    i             = 0;
+    string_offset = 0;
+    entry         = ( proc_system_process_type* ) buffer;
+    while( i < count ) {
+
+        /*--------------------------------------------------------------
+        Skip other owners' processes.
+        --------------------------------------------------------------*/
+        if( ( owner != PROC_SID_NONE )
+         && ( find_owner(
+                  owners,
+                  owner_count,
+                  ( DWORD ) ( ULONG_PTR ) entry->id
+              ) == NULL ) ) {
+            entry = ( proc_system_process_type* ) ( ( LPBYTE ) entry
+                                                  + entry->next );
+            continue;
+        }
+
+        /*--------------------------------------------------------------
+        Copy the fixed-size process details.
+        --------------------------------------------------------------*/
+        record = &( snapshot->records[ i ] );
+        record->id      = ( DWORD ) ( ULONG_PTR ) entry->id;
+        record->parent  = ( DWORD ) ( ULONG_PTR ) entry->parent;
+        record->session = entry->session;
+        record->image   = ( DWORD ) string_offset;
+        record->owner   = PROC_SNAPSHOT_NONE;
+        record->start_time.dwLowDateTime  = entry->create_time.u.LowPart;
+        record->start_time.dwHighDateTime = entry->create_time.u.HighPart;
+
+        /*--------------------------------------------------------------
+        Copy the image name into the string table.
+        --------------------------------------------------------------*/
+        length = entry->image.Length / sizeof( WCHAR );
+        #ifdef UNICODE
+            memcpy(
+                ( snapshot->strings + string_offset ),
+                entry->image.Buffer,
+                ( length * sizeof( WCHAR ) )
+            );
+        #else
+            if( length > 0 ) {
+                length = WideCharToMultiByte(
+                    CP_ACP,
+                    0,
+                    entry->image.Buffer,
+                    ( int ) length,
+                    ( snapshot->strings + string_offset ),
+                    entry->image.Length,
+                    NULL,
+                    NULL
+                );
+            }
+        #endif
+        snapshot->strings[ string_offset + length ] = _T( '\0' );
+        string_offset += length + 1;
+
+        /*--------------------------------------------------------------
+        Advance to the next record and system process entry.
+        --------------------------------------------------------------*/
+        i    += 1;
+        entry = ( proc_system_process_type* ) ( ( LPBYTE ) entry
+                                              + entry->next );
+    }
+
+    /*------------------------------------------------------------------
+    Release the system query buffer.
+    ------------------------------------------------------------------*/
+    HeapFree( heap, 0, buffer );
+
+    /*------------------------------------------------------------------
+    Order the records by process ID for lookups.
+    ------------------------------------------------------------------*/
+    qsort(
+        snapshot->records,
+        count,
+        sizeof( proc_record_type ),
+        compare_records
+    );
+
+    /*------------------------------------------------------------------
+    Both lists are ordered by process ID, so owner keys are attached in
+    a single merge pass.
+    ------------------------------------------------------------------*/
+    j = 0;
+    for( i = 0; ( i < count ) && ( j < owner_count ); ++i ) {
+        while( ( j < owner_count )
+            && ( owners[ j ].id < snapshot->records[ i ].id ) ) {
+            ++j;
+        }
+        if( ( j < owner_count )
+         && ( owners[ j ].id == snapshot->records[ i ].id ) ) {
+            snapshot->records[ i ].owner = owners[ j ].owner;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the owner pairings.
+    ------------------------------------------------------------------*/
+    if( owners != NULL ) {
+        HeapFree( heap, 0, ( LPVOID ) owners );
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
@@ -0,0 +1,305 @@
+/*****************************************************************************
+
+proc_volume.c
+
+NT Device Path Translation
+
+Process image queries report native paths such as
+"\Device\HarddiskVolume3\Windows\notepad.exe".  This module keeps one table
+of drive letter mappings, built with QueryDosDevice, and rewrites native
+paths into their DOS form with a longest-prefix match.  The table is only
+rebuilt when the system's drive mask changes, so translating a path never
+queries a device.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <winternl.h>
+
+#include "proc_volume.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const WCHAR  volume_unc[] = L"\\Device\\Mup\\";
+                                    /* device prefix of UNC paths           */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL match_prefix(                  /* test a path for a device prefix      */
+    PUNICODE_STRING     path,       /* path to test                         */
+    LPCWSTR             prefix,     /* device prefix                        */
+    USHORT              length      /* length of prefix (characters)        */
+);                                  /* returns TRUE if prefix matches       */
+
+void strip_prefix(                  /* replace a path's leading characters  */
+    PUNICODE_STRING     path,       /* path, rewritten in place             */
+    USHORT              length,     /* characters being replaced            */
+    LPCWSTR             text,       /* replacement text                     */
+    USHORT              count       /* length of replacement (characters)   */
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+void proc_volume_init(              /* initialize a translation table       */
+    proc_volume_table_type*
+                        table       /* volume translation table             */
+) {
+
+    /*------------------------------------------------------------------
+    The table is built on first use.
+    ------------------------------------------------------------------*/
+    memset( table, 0, sizeof( proc_volume_table_type ) );
+
+}
+
+
+/*==========================================================================*/
+void proc_volume_invalidate(        /* force a rebuild on the next refresh  */
+    proc_volume_table_type*
+                        table       /* volume translation table             */
+) {
+
+    /*------------------------------------------------------------------
+    Drive letters can be remapped without changing the drive mask (e.g.
+    with "subst"), so callers that notice device changes may force the
+    next refresh to rebuild the table.
+    ------------------------------------------------------------------*/
+    table->valid = FALSE;
+
+}
+
+
+/*==========================================================================*/
+error_type proc_volume_refresh(     /* rebuild the table if drives changed  */
+    proc_volume_table_type*
+                        table       /* volume translation table             */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               drives;     /* current logical drive mask           */
+    proc_volume_entry_type*
+                        entry;      /* entry being loaded                   */
+    DWORD               i;          /* drive index                          */
+    DWORD               j;          /* insertion index                      */
+    WCHAR               name[ 3 ];  /* DOS device name of a drive           */
+    proc_volume_entry_type
+                        swap;       /* entry being moved into place         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( table == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    The table is current as long as the drive mask is unchanged.
+    ------------------------------------------------------------------*/
+    drives = GetLogicalDrives();
+    if( drives == 0 ) {
+        return ERR_WINAPI;
+    }
+    if( ( table->valid != FALSE ) && ( table->drives == drives ) ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Load the device prefix of each drive letter.
+    ------------------------------------------------------------------*/
+    table->count = 0;
+    name[ 1 ]    = L':';
+    name[ 2 ]    = L'\0';
+    for( i = 0; i < PROC_VOLUME_DRIVES; ++i ) {
+        if( ( drives & ( 1UL << i ) ) == 0 ) {
+            continue;
+        }
+        entry     = &( table->entries[ table->count ] );
+        name[ 0 ] = ( WCHAR ) ( L'A' + i );
+        if( QueryDosDeviceW( name, entry->device, MAX_PATH ) == 0 ) {
+            continue;
+        }
+        entry->device[ MAX_PATH - 1 ] = L'\0';
+        entry->letter = name[ 0 ];
+        entry->length = ( USHORT ) lstrlenW( entry->device );
+
+        /*--------------------------------------------------------------
+        A prefix no longer than its replacement can not be rewritten
+        in place (and is not a native device path).
+        --------------------------------------------------------------*/
+        if( entry->length <= 2 ) {
+            continue;
+        }
+
+        /*--------------------------------------------------------------
+        Keep longer prefixes first, so the first match is the longest.
+        --------------------------------------------------------------*/
+        swap = *entry;
+        for( j = table->count; j > 0; --j ) {
+            if( table->entries[ j - 1 ].length >= swap.length ) {
+                break;
+            }
+            table->entries[ j ] = table->entries[ j - 1 ];
+        }
+        table->entries[ j ] = swap;
+        table->count       += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Note the drive mask the table was built from.
+    ------------------------------------------------------------------*/
+    table->drives = drives;
+    table->valid  = TRUE;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL proc_volume_translate(         /* translate an NT path to a DOS path   */
+    proc_volume_table_type*
+                        table,      /* volume translation table             */
+    PUNICODE_STRING     path        /* path, rewritten in place             */
+) {                                 /* returns TRUE if path was translated  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    WCHAR               drive[ 2 ]; /* DOS drive prefix                     */
+    proc_volume_entry_type*
+                        entry;      /* mapping being tested                 */
+    DWORD               i;          /* mapping index                        */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( table == NULL ) || ( path == NULL ) || ( path->Buffer == NULL ) ) {
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Build the table the first time it is needed.  Later changes are
+    picked up by explicit refreshes.
+    ------------------------------------------------------------------*/
+    if( table->valid == FALSE ) {
+        if( proc_volume_refresh( table ) != ERR_OK ) {
+            return FALSE;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Replace the longest matching drive prefix with its drive letter.
+    ------------------------------------------------------------------*/
+    drive[ 1 ] = L':';
+    for( i = 0; i < table->count; ++i ) {
+        entry = &( table->entries[ i ] );
+        if( match_prefix( path, entry->device, entry->length ) != FALSE ) {
+            drive[ 0 ] = entry->letter;
+            strip_prefix( path, entry->length, drive, 2 );
+            return TRUE;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Network paths without a drive letter become UNC paths.
+    ------------------------------------------------------------------*/
+    if( match_prefix( path, volume_unc, 11 ) != FALSE ) {
+        strip_prefix( path, 11, L"\\", 1 );
+        return TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    The path is left in its native form.
+    ------------------------------------------------------------------*/
+    return FALSE;
+}
+
+
+/*==========================================================================*/
+BOOL match_prefix(                  /* test a path for a device prefix      */
+    PUNICODE_STRING     path,       /* path to test                         */
+    LPCWSTR             prefix,     /* device prefix                        */
+    USHORT              length      /* length of prefix (characters)        */
+) {                                 /* returns TRUE if prefix matches       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    USHORT              path_length;/* length of path (characters)          */
+
+    /*------------------------------------------------------------------
+    The prefix must fit in the path.
+    ------------------------------------------------------------------*/
+    path_length = path->Length / sizeof( WCHAR );
+    if( path_length < length ) {
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    The prefix must end on a path separator, so that volume 1 does not
+    match a path on volume 10.
+    ------------------------------------------------------------------*/
+    if( ( path_length > length ) && ( path->Buffer[ length ] != L'\\' ) ) {
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Device names are reported in one canonical case.
+    ------------------------------------------------------------------*/
+    return ( memcmp( path->Buffer, prefix, ( length * sizeof( WCHAR ) ) )
+             == 0 ) ? TRUE : FALSE;
+}
+
+
+/*==========================================================================*/
+void strip_prefix(                  /* replace a path's leading characters  */
+    PUNICODE_STRING     path,       /* path, rewritten in place             */
+    USHORT              length,     /* characters being replaced            */
+    LPCWSTR             text,       /* replacement text                     */
+    USHORT              count       /* length of replacement (characters)   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    USHORT              skip;       /* characters dropped from the front    */
+
+    /*------------------------------------------------------------------
+    Write the replacement over the end of the prefix, and move the
+    string's start past the rest of it.
+    ------------------------------------------------------------------*/
+    skip = length - count;
+    memcpy( ( path->Buffer + skip ), text, ( count * sizeof( WCHAR ) ) );
+    path->Buffer        += skip;
+    path->Length        -= skip * sizeof( WCHAR );
+    path->MaximumLength -= skip * sizeof( WCHAR );
+
+}
+
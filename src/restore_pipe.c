@@ -0,0 +1,481 @@
+/*****************************************************************************
+
+restore_pipe.c
+
+Resident Restore Pipe
+
+Every run of the restoration tool starts a process, opens the
+configuration, loads the NT entry points, and reads every process with a
+window from scratch.  A resident restore (see main.c) keeps all of that
+between restores, and this module carries the requests to it.
+
+A request is the command line's arguments (the session names or patterns,
+and any options), sent as one message over a local named pipe.  The answer
+is the exit status the restore would have returned.  Requests are answered
+one at a time, so two restores never place the same windows at once.
+
+Each user's logon session has its own pipe, named for the session ID and
+the user's SID, so users on one machine never reach each other's resident
+restore.  Only the user may open the pipe, and the user owns it.  A client
+checks that owner before sending anything, so a pipe created first under
+the same name by someone else is never trusted.
+
+When nothing is serving the pipe, sending fails at once, and the caller
+restores the sessions itself.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+#include <aclapi.h>
+#include <sddl.h>
+
+#include "restore_pipe.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define PIPE_USER_SIZE \
+    ( sizeof( TOKEN_USER ) + SECURITY_MAX_SID_SIZE )
+                                    /* room for this process' user          */
+
+#define PIPE_ACL_SIZE \
+    ( sizeof( ACL ) + sizeof( ACCESS_ALLOWED_ACE ) + SECURITY_MAX_SID_SIZE )
+                                    /* room for the owner-only DACL         */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type name_pipe(               /* name this user's and session's pipe  */
+    LPTSTR              name,       /* returned name                        */
+                                    /* (RESTORE_PIPE_NAME_SIZE characters)  */
+    PTOKEN_USER         user        /* returned user (PIPE_USER_SIZE bytes) */
+);                                  /* returns error code                   */
+
+BOOL pipe_owned(                    /* check who owns a pipe                */
+    HANDLE              pipe,       /* either end of the pipe               */
+    PSID                user        /* expected owner                       */
+);                                  /* returns TRUE if the user owns it     */
+
+DWORD split_request(                /* find the arguments in a request      */
+    LPTSTR              request,    /* request text (terminated in place)   */
+    DWORD               length,     /* length of request (characters)       */
+    LPCTSTR*            arguments   /* returned arguments                   */
+);                                  /* returns number of arguments          */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type restore_pipe_send(       /* hand arguments to a resident restore */
+    LPCTSTR*            arguments,  /* arguments to send                    */
+    DWORD               count,      /* number of arguments                  */
+    DWORD               timeout,    /* limit on waiting for a busy pipe     */
+                                    /* (ms)                                 */
+    DWORD*              status      /* returned exit status of the request  */
+) {                                 /* returns error code (ERR_NOT_FOUND if */
+                                    /* nothing is serving the pipe)         */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* argument index                       */
+    SIZE_T              length;     /* length of an argument                */
+    DWORD               mode;       /* pipe read mode                       */
+    TCHAR               name[ RESTORE_PIPE_NAME_SIZE ];
+                                    /* name of this user's pipe             */
+    HANDLE              pipe;       /* client end of the pipe               */
+    DWORD               received;   /* size of the answer (bytes)           */
+    TCHAR               request[ RESTORE_PIPE_SIZE ];
+                                    /* arguments, each terminated           */
+    error_type          result;     /* result of function calls             */
+    DWORD               used;       /* length of the request (characters)   */
+    BYTE                user[ PIPE_USER_SIZE ];
+                                    /* this process' user                   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( ( arguments == NULL ) && ( count > 0 ) ) || ( status == NULL ) ) {
+        return ERR_USAGE;
+    }
+    if( count > RESTORE_PIPE_LIMIT ) {
+        return ERR_OVERFLOW;
+    }
+
+    /*------------------------------------------------------------------
+    Pack the arguments, each with its terminator.
+    ------------------------------------------------------------------*/
+    used = 0;
+    for( i = 0; i < count; ++i ) {
+        length = _tcslen( arguments[ i ] ) + 1;
+        if( ( used + length ) > RESTORE_PIPE_SIZE ) {
+            return ERR_OVERFLOW;
+        }
+        memcpy(
+            &( request[ used ] ),
+            arguments[ i ],
+            ( length * sizeof( TCHAR ) )
+        );
+        used += ( DWORD ) length;
+    }
+
+    /*------------------------------------------------------------------
+    Connect to this user's resident restore.  It answers one request at
+    a time, so a busy pipe is waited for.  The server may identify the
+    client, but not act as it.
+    ------------------------------------------------------------------*/
+    result = name_pipe( name, ( PTOKEN_USER ) user );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    for( ; ; ) {
+        pipe = CreateFile(
+            name,
+            ( GENERIC_READ | GENERIC_WRITE ),
+            0,
+            NULL,
+            OPEN_EXISTING,
+            ( SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION ),
+            NULL
+        );
+        if( pipe != INVALID_HANDLE_VALUE ) {
+            break;
+        }
+        if( GetLastError() == ERROR_FILE_NOT_FOUND ) {
+            return ERR_NOT_FOUND;
+        }
+        if( GetLastError() != ERROR_PIPE_BUSY ) {
+            return ERR_WINAPI;
+        }
+        if( WaitNamedPipe( name, timeout ) == FALSE ) {
+            return ( GetLastError() == ERROR_FILE_NOT_FOUND )
+                 ? ERR_NOT_FOUND : ERR_TIMEOUT;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    A pipe the user does not own was not created by the user's resident
+    restore, and is treated as if nothing were serving.
+    ------------------------------------------------------------------*/
+    if( pipe_owned( pipe, ( ( PTOKEN_USER ) user )->User.Sid ) == FALSE ) {
+        CloseHandle( pipe );
+        return ERR_NOT_FOUND;
+    }
+
+    /*------------------------------------------------------------------
+    Send the request, and read the answer, in one transaction.
+    ------------------------------------------------------------------*/
+    mode = PIPE_READMODE_MESSAGE;
+    if( ( SetNamedPipeHandleState( pipe, &mode, NULL, NULL ) == FALSE )
+     || ( TransactNamedPipe(
+            pipe,
+            ( LPVOID ) request,
+            ( used * sizeof( TCHAR ) ),
+            ( LPVOID ) status,
+            sizeof( DWORD ),
+            &received,
+            NULL
+        ) == FALSE ) ) {
+        CloseHandle( pipe );
+        return ERR_WINAPI;
+    }
+    CloseHandle( pipe );
+    return ( received == sizeof( DWORD ) ) ? ERR_OK : ERR_FORMAT;
+}
+
+
+/*==========================================================================*/
+error_type restore_pipe_serve(      /* answer requests until told to stop   */
+    restore_pipe_handler_fun
+                        handler,    /* function answering each request      */
+    LPVOID              context     /* passed to the handler                */
+) {                                 /* returns error code (ERR_USAGE if     */
+                                    /* the pipe is already being served)    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             arguments[ RESTORE_PIPE_LIMIT ];
+                                    /* request's arguments                  */
+    BOOL                connected;  /* a client is connected                */
+    DWORD               acl[ PIPE_ACL_SIZE / sizeof( DWORD ) ];
+                                    /* DACL allowing only the user          */
+    SECURITY_ATTRIBUTES attributes; /* security of the pipe                 */
+    DWORD               count;      /* number of arguments                  */
+    SECURITY_DESCRIPTOR descriptor; /* owner and DACL of the pipe           */
+    TCHAR               name[ RESTORE_PIPE_NAME_SIZE ];
+                                    /* name of this user's pipe             */
+    HANDLE              pipe;       /* server end of the pipe               */
+    DWORD               received;   /* size of the request (bytes)          */
+    TCHAR               request[ RESTORE_PIPE_SIZE + 1 ];
+                                    /* request, with room for a terminator  */
+    error_type          result;     /* result of serving                    */
+    BOOL                serving;    /* the handler has not asked to stop    */
+    DWORD               status;     /* exit status for the client           */
+    BYTE                user[ PIPE_USER_SIZE ];
+                                    /* this process' user                   */
+    PSID                sid;        /* the user's SID                       */
+    DWORD               written;    /* size of the answer sent (bytes)      */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( handler == NULL ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    The pipe is owned by this process' user, and only that user may
+    open it.
+    ------------------------------------------------------------------*/
+    result = name_pipe( name, ( PTOKEN_USER ) user );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    sid = ( ( PTOKEN_USER ) user )->User.Sid;
+    if( ( InitializeSecurityDescriptor(
+            &descriptor,
+            SECURITY_DESCRIPTOR_REVISION
+        ) == FALSE )
+     || ( InitializeAcl(
+            ( PACL ) acl,
+            sizeof( acl ),
+            ACL_REVISION
+        ) == FALSE )
+     || ( AddAccessAllowedAce(
+            ( PACL ) acl,
+            ACL_REVISION,
+            GENERIC_ALL,
+            sid
+        ) == FALSE )
+     || ( SetSecurityDescriptorDacl(
+            &descriptor,
+            TRUE,
+            ( PACL ) acl,
+            FALSE
+        ) == FALSE )
+     || ( SetSecurityDescriptorOwner( &descriptor, sid, FALSE ) == FALSE ) ) {
+        return ERR_WINAPI;
+    }
+    attributes.nLength              = sizeof( attributes );
+    attributes.lpSecurityDescriptor = &descriptor;
+    attributes.bInheritHandle       = FALSE;
+
+    /*------------------------------------------------------------------
+    Create the only instance of the pipe.  Creating the first instance
+    fails when another resident restore already serves it.  Clients on
+    other machines are refused.
+    ------------------------------------------------------------------*/
+    pipe = CreateNamedPipe(
+        name,
+        ( PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE ),
+        ( PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT
+        | PIPE_REJECT_REMOTE_CLIENTS ),
+        1,
+        sizeof( DWORD ),
+        ( RESTORE_PIPE_SIZE * sizeof( TCHAR ) ),
+        0,
+        &attributes
+    );
+    if( pipe == INVALID_HANDLE_VALUE ) {
+        return ( GetLastError() == ERROR_ACCESS_DENIED )
+             ? ERR_USAGE : ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Answer one client at a time.  A request that can not be read is
+    dropped, and its client sees the pipe close.
+    ------------------------------------------------------------------*/
+    result  = ERR_OK;
+    serving = TRUE;
+    while( serving != FALSE ) {
+        connected = ConnectNamedPipe( pipe, NULL );
+        if( ( connected == FALSE )
+         && ( GetLastError() != ERROR_PIPE_CONNECTED ) ) {
+            result = ERR_WINAPI;
+            break;
+        }
+        if( ReadFile(
+                pipe,
+                ( LPVOID ) request,
+                ( RESTORE_PIPE_SIZE * sizeof( TCHAR ) ),
+                &received,
+                NULL
+            ) != FALSE ) {
+            count   = split_request(
+                request,
+                ( received / sizeof( TCHAR ) ),
+                arguments
+            );
+            status  = 1;
+            serving = handler( context, arguments, count, &status );
+            WriteFile(
+                pipe,
+                ( LPCVOID ) &status,
+                sizeof( DWORD ),
+                &written,
+                NULL
+            );
+            FlushFileBuffers( pipe );
+        }
+        DisconnectNamedPipe( pipe );
+    }
+
+    /*------------------------------------------------------------------
+    Close the pipe, and return the result of serving.
+    ------------------------------------------------------------------*/
+    CloseHandle( pipe );
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type name_pipe(               /* name this user's and session's pipe  */
+    LPTSTR              name,       /* returned name                        */
+                                    /* (RESTORE_PIPE_NAME_SIZE characters)  */
+    PTOKEN_USER         user        /* returned user (PIPE_USER_SIZE bytes) */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    TCHAR               digits[ 16 ];
+                                    /* session ID                           */
+    DWORD               return_length;
+                                    /* data length return variable          */
+    DWORD               session;    /* this process' logon session          */
+    LPTSTR              sid;        /* the user's SID, as text              */
+    HANDLE              token;      /* this process' token                  */
+    BOOL                wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Find this process' user, and its logon session.
+    ------------------------------------------------------------------*/
+    wresult = OpenProcessToken( GetCurrentProcess(), TOKEN_QUERY, &token );
+    if( wresult == FALSE ) {
+        return ERR_WINAPI;
+    }
+    wresult = GetTokenInformation(
+        token,
+        TokenUser,
+        ( LPVOID ) user,
+        PIPE_USER_SIZE,
+        &return_length
+    );
+    CloseHandle( token );
+    if( ( wresult == FALSE )
+     || ( ProcessIdToSessionId( GetCurrentProcessId(), &session ) == FALSE )
+     || ( ConvertSidToStringSid( user->User.Sid, &sid ) == FALSE ) ) {
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    The pipe is named for both.
+    ------------------------------------------------------------------*/
+    if( ( _tcslen( RESTORE_PIPE_NAME ) + _tcslen( sid ) + 20 )
+      > RESTORE_PIPE_NAME_SIZE ) {
+        LocalFree( ( HLOCAL ) sid );
+        return ERR_OVERFLOW;
+    }
+    _ultot( session, digits, 10 );
+    _tcscpy( name, RESTORE_PIPE_NAME );
+    _tcscat( name, _T( "-" ) );
+    _tcscat( name, digits );
+    _tcscat( name, _T( "-" ) );
+    _tcscat( name, sid );
+    LocalFree( ( HLOCAL ) sid );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL pipe_owned(                    /* check who owns a pipe                */
+    HANDLE              pipe,       /* either end of the pipe               */
+    PSID                user        /* expected owner                       */
+) {                                 /* returns TRUE if the user owns it     */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    PSECURITY_DESCRIPTOR
+                        descriptor; /* security of the pipe                 */
+    BOOL                owned;      /* the user owns the pipe               */
+    PSID                owner;      /* owner of the pipe                    */
+
+    /*------------------------------------------------------------------
+    Compare the pipe's owner to the user.
+    ------------------------------------------------------------------*/
+    if( GetSecurityInfo(
+            pipe,
+            SE_KERNEL_OBJECT,
+            OWNER_SECURITY_INFORMATION,
+            &owner,
+            NULL,
+            NULL,
+            NULL,
+            &descriptor
+        ) != ERROR_SUCCESS ) {
+        return FALSE;
+    }
+    owned = ( ( owner != NULL ) && ( EqualSid( owner, user ) != FALSE ) )
+          ? TRUE : FALSE;
+    LocalFree( ( HLOCAL ) descriptor );
+    return owned;
+}
+
+
+/*==========================================================================*/
+DWORD split_request(                /* find the arguments in a request      */
+    LPTSTR              request,    /* request text (terminated in place)   */
+    DWORD               length,     /* length of request (characters)       */
+    LPCTSTR*            arguments   /* returned arguments                   */
+) {                                 /* returns number of arguments          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of arguments                  */
+    DWORD               i;          /* character index                      */
+    DWORD               start;      /* start of the current argument        */
+
+    /*------------------------------------------------------------------
+    Each argument ends with a terminator.  The last one gets one even
+    if the client left it off.
+    ------------------------------------------------------------------*/
+    request[ length ] = _T( '\0' );
+    count = 0;
+    start = 0;
+    for( i = 0; ( i < length ) && ( count < RESTORE_PIPE_LIMIT ); ++i ) {
+        if( request[ i ] == _T( '\0' ) ) {
+            arguments[ count ] = &( request[ start ] );
+            count += 1;
+            start  = i + 1;
+        }
+    }
+    if( ( start < length ) && ( count < RESTORE_PIPE_LIMIT ) ) {
+        arguments[ count ] = &( request[ start ] );
+        count += 1;
+    }
+    return count;
+}
+
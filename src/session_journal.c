@@ -0,0 +1,1296 @@
+/*****************************************************************************
+
+session_journal.c
+
+Session Autosave Journal
+
+This module saves the open windows (their rectangles, commands, and
+arguments) every few seconds, so a crash or a forced restart loses almost
+nothing.  Rewriting the configuration that often would cost too much, so
+saves are appended to a binary journal beside it instead.
+
+Each entry in the journal lists only the windows that changed since the
+entry before it: a window that appeared, moved, or now runs a different
+command, or a window that closed.  When nothing changed, nothing is
+written.  Every so often an entry lists every window instead (a
+checkpoint), and once the journal grows large it is replaced by a journal
+holding just the latest checkpoint.
+
+The latest desktop is recovered by replaying the entries in order, from the
+last checkpoint.  Each entry carries its size and a hash of its contents, so
+an entry that was only partly written when the system went down is found
+and ignored (and is overwritten by the next save).  An entry whose items
+do not fit it is ignored the same way, before any of it is applied.
+
+The journal is only read by the build that wrote it (it stores text in the
+build's character size).
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdlib.h>
+
+#include "session_journal.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define JOURNAL_FNV_BASIS   ( 2166136261UL )
+                                    /* FNV-1a offset basis                  */
+#define JOURNAL_FNV_PRIME   ( 16777619UL )
+                                    /* FNV-1a prime                         */
+
+#define JOURNAL_CHECKPOINT  ( 1 )   /* entry lists every window             */
+#define JOURNAL_CHANGES     ( 2 )   /* entry lists the windows that changed */
+
+#define JOURNAL_RECTANGLE   ( 1 )   /* item holds the window's rectangle    */
+#define JOURNAL_TEXT        ( 2 )   /* item holds the window's text         */
+#define JOURNAL_REMOVED     ( 4 )   /* the window closed                    */
+
+#define JOURNAL_MIN_WINDOWS ( 32 )  /* initial size of a desktop            */
+
+#define JOURNAL_TEMPORARY   _T( ".tmp" )
+                                    /* suffix of the journal being          */
+                                    /* compacted                            */
+
+#define JOURNAL_ALIGN( _size ) \
+                            ( ( ( _size ) + 3 ) & ~( ( DWORD ) 3 ) )
+                                    /* size padded to the next DWORD        */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct journal_header_s {   /* journal file header type             */
+    DWORD               magic;      /* SESSION_JOURNAL_MAGIC                */
+    DWORD               version;    /* SESSION_JOURNAL_VERSION              */
+    DWORD               char_size;  /* size of a stored character (bytes)   */
+} journal_header_type;
+
+typedef struct journal_entry_s {    /* journal entry header type            */
+    DWORD               size;       /* size of the entry (bytes)            */
+    DWORD               kind;       /* JOURNAL_CHECKPOINT or                */
+                                    /* JOURNAL_CHANGES                      */
+    DWORD               sequence;   /* number of the entry                  */
+    DWORD               count;      /* number of items                      */
+    DWORD               check;      /* hash of the rest of the entry        */
+} journal_entry_type;               /* followed by the items                */
+
+typedef struct journal_item_s {     /* journal entry item type              */
+    DWORD               id;         /* window's identity                    */
+    DWORD               flags;      /* JOURNAL_* parts that follow          */
+} journal_item_type;                /* followed by a RECT, then the text's  */
+                                    /* length (characters) and the padded   */
+                                    /* text, as flagged                     */
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type apply_entry(             /* replay one entry onto a desktop      */
+    session_journal_state_type*
+                        state,      /* desktop to change                    */
+    const BYTE*         data,       /* entry (its hash already checked)     */
+    DWORD               size        /* size of the entry (bytes)            */
+);                                  /* returns error code                   */
+
+error_type check_entry(             /* check an entry's layout              */
+    const BYTE*         data,       /* entry (its hash already checked)     */
+    DWORD               size        /* size of the entry (bytes)            */
+);                                  /* returns error code (ERR_FORMAT if it */
+                                    /* can not be replayed)                 */
+
+error_type compact_journal(         /* replace the journal with a single    */
+                                    /* checkpoint                           */
+    session_journal_type*
+                        journal,    /* open journal                         */
+    const session_journal_state_type*
+                        state       /* current desktop                      */
+);                                  /* returns error code                   */
+
+int compare_ids(                    /* order saved windows by identity      */
+    const void*         left,       /* left-hand window                     */
+    const void*         right       /* right-hand window                    */
+);                                  /* returns relative order               */
+
+error_type encode_entry(            /* build the next entry                 */
+    session_journal_type*
+                        journal,    /* open journal                         */
+    const session_journal_state_type*
+                        state,      /* current desktop                      */
+    BOOL                checkpoint, /* list every window                    */
+    DWORD*              size        /* returned size of the entry (bytes),  */
+                                    /* or 0 if nothing changed              */
+);                                  /* returns error code                   */
+
+DWORD find_id(                      /* find a saved window                  */
+    const session_journal_state_type*
+                        state,      /* saved desktop                        */
+    DWORD               id,         /* window's identity                    */
+    BOOL*               found       /* returned TRUE if the window is saved */
+);                                  /* returns its index, or where it goes  */
+
+DWORD hash_text(                    /* hash a window's text                 */
+    LPCTSTR             text,       /* double-NUL terminated list           */
+    DWORD               length      /* length of the list (characters)      */
+);                                  /* returns FNV-1a hash                  */
+
+error_type replay_file(             /* replay every intact entry of a file  */
+    HANDLE              file,       /* journal file handle                  */
+    session_journal_state_type*
+                        state,      /* empty desktop to fill                */
+    DWORD*              size,       /* returned size of the intact journal  */
+                                    /* (bytes), or 0 if it is empty         */
+    DWORD*              sequence,   /* returned number of the next entry    */
+    DWORD*              changes     /* returned entries since the last      */
+                                    /* checkpoint                           */
+);                                  /* returns error code (ERR_FORMAT if it */
+                                    /* is not a journal)                    */
+
+error_type reserve_windows(         /* make room for more windows           */
+    session_journal_state_type*
+                        state,      /* desktop to grow                      */
+    DWORD               count       /* number of windows needed             */
+);                                  /* returns error code                   */
+
+DWORD sum_entry(                    /* hash an entry, except its own hash   */
+    const BYTE*         data,       /* entry                                */
+    DWORD               size        /* size of the entry (bytes)            */
+);                                  /* returns FNV-1a hash                  */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type session_journal_capture( /* save the open windows of programs    */
+                                    /* that are running                     */
+    proc_match_type*    match,      /* running process index                */
+    session_journal_state_type*
+                        state       /* state to fill (emptied first)        */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_match_entry_type*
+                        entry;      /* window's running process             */
+    DWORD               i;          /* listed window index                  */
+    LPCTSTR             image;      /* process' image path                  */
+    DWORD               k;          /* command string index                 */
+    DWORD               length;     /* length of a string                   */
+    window_list_type*   list;       /* listed windows                       */
+    LPTSTR              next;       /* next character of the text           */
+    proc_pool_type*     pool;       /* process' interned strings            */
+    error_type          result;     /* result of internal operation         */
+    session_journal_window_type*
+                        window;     /* window being saved                   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( match == NULL ) || ( state == NULL ) ) {
+        return ERR_USAGE;
+    }
+    session_journal_free( state );
+    list = &( match->windows );
+    pool = &( match->strings );
+
+    /*------------------------------------------------------------------
+    Save each window whose program is known, and that has a place on
+    the desktop.  The image path stands in for the command, since the
+    command's first string may not be a full path.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < list->count; ++i ) {
+        entry = proc_match_find( match, list->process_ids[ i ] );
+        if( ( entry == NULL )
+         || ( IsIconic( list->windows[ i ] ) != FALSE ) ) {
+            continue;
+        }
+        image  = proc_pool_get( pool, entry->image );
+        length = _tcslen( image ) + 2;
+        for( k = 1; k < entry->count; ++k ) {
+            length += _tcslen( proc_pool_get( pool, entry->values[ k ] ) ) + 1;
+        }
+        result = reserve_windows( state, ( state->count + 1 ) );
+        if( result != ERR_OK ) {
+            session_journal_free( state );
+            return result;
+        }
+        window = &( state->windows[ state->count ] );
+        window->text = ( LPTSTR ) HeapAlloc(
+            GetProcessHeap(),
+            0,
+            ( length * sizeof( TCHAR ) )
+        );
+        if( window->text == NULL ) {
+            session_journal_free( state );
+            return ERR_ALLOC;
+        }
+        window->id        = ( DWORD ) ( ULONG_PTR ) list->windows[ i ];
+        window->rectangle = list->rectangles[ i ];
+        window->length    = length;
+        _tcscpy( window->text, image );
+        next = window->text + _tcslen( image ) + 1;
+        for( k = 1; k < entry->count; ++k ) {
+            _tcscpy( next, proc_pool_get( pool, entry->values[ k ] ) );
+            next += _tcslen( next ) + 1;
+        }
+        *next          = _T( '\0' );
+        window->hash   = hash_text( window->text, length );
+        state->count  += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Entries list windows in order of identity.
+    ------------------------------------------------------------------*/
+    qsort(
+        state->windows,
+        state->count,
+        sizeof( session_journal_window_type ),
+        compare_ids
+    );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void session_journal_close(         /* close an open journal                */
+    session_journal_type*
+                        journal     /* open journal                         */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( journal == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Close the file, and release the recorded desktop.
+    ------------------------------------------------------------------*/
+    if( ( journal->file != NULL )
+     && ( journal->file != INVALID_HANDLE_VALUE ) ) {
+        CloseHandle( journal->file );
+    }
+    session_journal_free( &( journal->state ) );
+    if( journal->buffer != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) journal->buffer );
+    }
+    memset( journal, 0, sizeof( session_journal_type ) );
+
+}
+
+
+/*==========================================================================*/
+void session_journal_free(          /* release a saved desktop              */
+    session_journal_state_type*
+                        state       /* saved desktop                        */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* window index                         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( state == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release each window's text, then the windows.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < state->count; ++i ) {
+        if( state->windows[ i ].text != NULL ) {
+            HeapFree(
+                GetProcessHeap(),
+                0,
+                ( LPVOID ) state->windows[ i ].text
+            );
+        }
+    }
+    if( state->windows != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) state->windows );
+    }
+    memset( state, 0, sizeof( session_journal_state_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type session_journal_open(    /* open a journal for appending         */
+    session_journal_type*
+                        journal,    /* journal object to initialize         */
+    LPCTSTR             path        /* path to the journal file             */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    journal_header_type header;     /* header of a new journal              */
+    error_type          result;     /* result of internal operation         */
+    DWORD               written;    /* number of bytes written              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( journal == NULL ) || ( path == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( journal, 0, sizeof( session_journal_type ) );
+    if( _tcslen( path ) >= ( MAX_PATH - _tcslen( JOURNAL_TEMPORARY ) ) ) {
+        return ERR_OVERFLOW;
+    }
+    _tcscpy( journal->path, path );
+
+    /*------------------------------------------------------------------
+    Open (or create) the journal, and replay what it holds.
+    ------------------------------------------------------------------*/
+    journal->file = CreateFile(
+        path,
+        ( GENERIC_READ | GENERIC_WRITE ),
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if( journal->file == INVALID_HANDLE_VALUE ) {
+        journal->file = NULL;
+        return ERR_WINAPI;
+    }
+    result = replay_file(
+        journal->file,
+        &( journal->state ),
+        &( journal->size ),
+        &( journal->sequence ),
+        &( journal->changes )
+    );
+
+    /*------------------------------------------------------------------
+    An empty file (or one that is not a journal) starts over.
+    ------------------------------------------------------------------*/
+    if( ( result == ERR_FORMAT ) || ( ( result == ERR_OK )
+                                   && ( journal->size == 0 ) ) ) {
+        session_journal_free( &( journal->state ) );
+        header.magic     = SESSION_JOURNAL_MAGIC;
+        header.version   = SESSION_JOURNAL_VERSION;
+        header.char_size = sizeof( TCHAR );
+        journal->size    = sizeof( header );
+        journal->changes = 0;
+        SetFilePointer( journal->file, 0, NULL, FILE_BEGIN );
+        result = ( ( WriteFile( journal->file, &header, sizeof( header ),
+                                &written, NULL ) == FALSE )
+                || ( written != sizeof( header ) ) ) ? ERR_WINAPI : ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Drop an entry that was only partly written, and append after the
+    last intact one.  The first save is a checkpoint, since the
+    windows open now are rarely the ones that were saved.
+    ------------------------------------------------------------------*/
+    if( ( result == ERR_OK )
+     && ( ( SetFilePointer( journal->file, journal->size, NULL,
+                            FILE_BEGIN ) == INVALID_SET_FILE_POINTER )
+       || ( SetEndOfFile( journal->file ) == FALSE ) ) ) {
+        result = ERR_WINAPI;
+    }
+    if( result != ERR_OK ) {
+        session_journal_close( journal );
+        return result;
+    }
+    journal->changes = SESSION_JOURNAL_CHECKPOINT;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type session_journal_path(    /* derive the journal path for a source */
+    LPCTSTR             path,       /* path to the configuration file       */
+    LPTSTR              journal_path,
+                                    /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPTSTR              extension;  /* start of the file's extension        */
+    DWORD               length;     /* length of path                       */
+    LPTSTR              scan;       /* current character                    */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( path == NULL ) || ( journal_path == NULL ) ) {
+        return ERR_USAGE;
+    }
+    length = _tcslen( path );
+    if( ( length + _tcslen( SESSION_JOURNAL_EXTENSION ) ) >= size ) {
+        return ERR_OVERFLOW;
+    }
+    _tcscpy( journal_path, path );
+
+    /*------------------------------------------------------------------
+    Replace the file name's extension, if it has one.
+    ------------------------------------------------------------------*/
+    extension = NULL;
+    for( scan = journal_path; *scan != _T( '\0' ); ++scan ) {
+        if( *scan == _T( '.' ) ) {
+            extension = scan;
+        }
+        else if( ( *scan == _T( '\\' ) ) || ( *scan == _T( '/' ) ) ) {
+            extension = NULL;
+        }
+    }
+    if( extension == NULL ) {
+        extension = journal_path + length;
+    }
+    _tcscpy( extension, SESSION_JOURNAL_EXTENSION );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type session_journal_recover( /* replay a journal                     */
+    LPCTSTR             path,       /* path to the journal file             */
+    session_journal_state_type*
+                        state       /* returned latest saved desktop        */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               changes;    /* entries since the last checkpoint    */
+    HANDLE              file;       /* journal file handle                  */
+    error_type          result;     /* result of replaying the journal      */
+    DWORD               sequence;   /* number of the next entry             */
+    DWORD               size;       /* size of the intact journal (bytes)   */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( path == NULL ) || ( state == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( state, 0, sizeof( session_journal_state_type ) );
+
+    /*------------------------------------------------------------------
+    The journal may be open for appending while it is read.
+    ------------------------------------------------------------------*/
+    file = CreateFile(
+        path,
+        GENERIC_READ,
+        ( FILE_SHARE_READ | FILE_SHARE_WRITE ),
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+    if( file == INVALID_HANDLE_VALUE ) {
+        return ( GetLastError() == ERROR_FILE_NOT_FOUND )
+             ? ERR_NOT_FOUND : ERR_WINAPI;
+    }
+    result = replay_file( file, state, &size, &sequence, &changes );
+    CloseHandle( file );
+    if( result != ERR_OK ) {
+        session_journal_free( state );
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type session_journal_save(    /* append the changes to a desktop      */
+    session_journal_type*
+                        journal,    /* open journal                         */
+    const session_journal_state_type*
+                        state       /* current desktop                      */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    BOOL                checkpoint; /* the entry lists every window         */
+    error_type          result;     /* result of internal operation         */
+    DWORD               size;       /* size of the entry (bytes)            */
+    DWORD               written;    /* number of bytes written              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( journal == NULL ) || ( journal->file == NULL )
+     || ( state == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Build the entry.  When nothing changed, nothing is written.
+    ------------------------------------------------------------------*/
+    checkpoint = ( journal->changes >= SESSION_JOURNAL_CHECKPOINT )
+               ? TRUE : FALSE;
+    result = encode_entry( journal, state, checkpoint, &size );
+    if( ( result != ERR_OK ) || ( size == 0 ) ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    A journal that would grow too large is replaced by one holding just
+    the current desktop.
+    ------------------------------------------------------------------*/
+    if( ( journal->size + size ) > SESSION_JOURNAL_LIMIT ) {
+        return compact_journal( journal, state );
+    }
+
+    /*------------------------------------------------------------------
+    Append the entry, and make sure it reaches the disk.  An entry that
+    was not completely written is cut off again.
+    ------------------------------------------------------------------*/
+    if( ( WriteFile( journal->file, journal->buffer, size, &written, NULL )
+          == FALSE )
+     || ( written != size )
+     || ( FlushFileBuffers( journal->file ) == FALSE ) ) {
+        SetFilePointer( journal->file, journal->size, NULL, FILE_BEGIN );
+        SetEndOfFile( journal->file );
+        return ERR_WINAPI;
+    }
+    journal->size     += size;
+    journal->sequence += 1;
+    journal->changes   = ( checkpoint != FALSE ) ? 0
+                       : ( journal->changes + 1 );
+
+    /*------------------------------------------------------------------
+    Keep the recorded desktop the way a replay would rebuild it.
+    ------------------------------------------------------------------*/
+    return apply_entry( &( journal->state ), journal->buffer, size );
+}
+
+
+/*==========================================================================*/
+error_type apply_entry(             /* replay one entry onto a desktop      */
+    session_journal_state_type*
+                        state,      /* desktop to change                    */
+    const BYTE*         data,       /* entry (its hash already checked)     */
+    DWORD               size        /* size of the entry (bytes)            */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const journal_entry_type*
+                        entry;      /* entry header                         */
+    BOOL                found;      /* the window is already saved          */
+    DWORD               i;          /* item index                           */
+    DWORD               index;      /* saved window index                   */
+    const journal_item_type*
+                        item;       /* current item                         */
+    DWORD               length;     /* length of an item's text             */
+    DWORD               offset;     /* offset of the next part (bytes)      */
+    error_type          result;     /* result of internal operation         */
+    LPTSTR              text;       /* copy of an item's text               */
+    session_journal_window_type*
+                        window;     /* window being changed                 */
+
+    /*------------------------------------------------------------------
+    An entry that does not hold what it claims is refused before it
+    changes anything.  A checkpoint replaces everything before it.
+    ------------------------------------------------------------------*/
+    result = check_entry( data, size );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    entry = ( const journal_entry_type* ) data;
+    if( entry->kind == JOURNAL_CHECKPOINT ) {
+        session_journal_free( state );
+    }
+
+    /*------------------------------------------------------------------
+    Apply each item to its window.
+    ------------------------------------------------------------------*/
+    offset = sizeof( journal_entry_type );
+    for( i = 0; i < entry->count; ++i ) {
+        item    = ( const journal_item_type* ) ( data + offset );
+        offset += sizeof( journal_item_type );
+        index   = find_id( state, item->id, &found );
+
+        /*--------------------------------------------------------------
+        A closed window is removed.  A new window starts empty.
+        --------------------------------------------------------------*/
+        if( ( item->flags & JOURNAL_REMOVED ) != 0 ) {
+            if( found != FALSE ) {
+                if( state->windows[ index ].text != NULL ) {
+                    HeapFree(
+                        GetProcessHeap(),
+                        0,
+                        ( LPVOID ) state->windows[ index ].text
+                    );
+                }
+                memmove(
+                    &( state->windows[ index ] ),
+                    &( state->windows[ index + 1 ] ),
+                    ( ( state->count - index - 1 )
+                      * sizeof( session_journal_window_type ) )
+                );
+                state->count -= 1;
+            }
+            continue;
+        }
+        if( found == FALSE ) {
+            result = reserve_windows( state, ( state->count + 1 ) );
+            if( result != ERR_OK ) {
+                return result;
+            }
+            memmove(
+                &( state->windows[ index + 1 ] ),
+                &( state->windows[ index ] ),
+                ( ( state->count - index )
+                  * sizeof( session_journal_window_type ) )
+            );
+            memset(
+                &( state->windows[ index ] ),
+                0,
+                sizeof( session_journal_window_type )
+            );
+            state->windows[ index ].id = item->id;
+            state->count += 1;
+        }
+        window = &( state->windows[ index ] );
+
+        /*--------------------------------------------------------------
+        Take the parts the item holds.
+        --------------------------------------------------------------*/
+        if( ( item->flags & JOURNAL_RECTANGLE ) != 0 ) {
+            memcpy( &( window->rectangle ), ( data + offset ),
+                    sizeof( RECT ) );
+            offset += sizeof( RECT );
+        }
+        if( ( item->flags & JOURNAL_TEXT ) != 0 ) {
+            length  = *( const DWORD* ) ( data + offset );
+            offset += sizeof( DWORD );
+            text = ( LPTSTR ) HeapAlloc(
+                GetProcessHeap(),
+                0,
+                ( length * sizeof( TCHAR ) )
+            );
+            if( text == NULL ) {
+                return ERR_ALLOC;
+            }
+            memcpy( text, ( data + offset ), ( length * sizeof( TCHAR ) ) );
+            if( window->text != NULL ) {
+                HeapFree( GetProcessHeap(), 0, ( LPVOID ) window->text );
+            }
+            window->text   = text;
+            window->length = length;
+            window->hash   = hash_text( text, length );
+            offset        += JOURNAL_ALIGN( length * sizeof( TCHAR ) );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type check_entry(             /* check an entry's layout              */
+    const BYTE*         data,       /* entry (its hash already checked)     */
+    DWORD               size        /* size of the entry (bytes)            */
+) {                                 /* returns error code (ERR_FORMAT if it */
+                                    /* can not be replayed)                 */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const journal_entry_type*
+                        entry;      /* entry header                         */
+    DWORD               i;          /* item index                           */
+    const journal_item_type*
+                        item;       /* current item                         */
+    DWORD               length;     /* length of an item's text             */
+    DWORD               offset;     /* offset of the next part (bytes)      */
+    LPCTSTR             text;       /* item's text                          */
+
+    /*------------------------------------------------------------------
+    Only the two kinds of entry are known.
+    ------------------------------------------------------------------*/
+    entry = ( const journal_entry_type* ) data;
+    if( ( entry->kind != JOURNAL_CHECKPOINT )
+     && ( entry->kind != JOURNAL_CHANGES ) ) {
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Walk the items the way they are applied, checking that each part
+    fits, and that each text is a double-NUL terminated list.
+    ------------------------------------------------------------------*/
+    offset = sizeof( journal_entry_type );
+    for( i = 0; i < entry->count; ++i ) {
+        if( ( size - offset ) < sizeof( journal_item_type ) ) {
+            return ERR_FORMAT;
+        }
+        item    = ( const journal_item_type* ) ( data + offset );
+        offset += sizeof( journal_item_type );
+        if( ( item->flags & JOURNAL_REMOVED ) != 0 ) {
+            continue;
+        }
+        if( ( item->flags & JOURNAL_RECTANGLE ) != 0 ) {
+            if( ( size - offset ) < sizeof( RECT ) ) {
+                return ERR_FORMAT;
+            }
+            offset += sizeof( RECT );
+        }
+        if( ( item->flags & JOURNAL_TEXT ) != 0 ) {
+            if( ( size - offset ) < sizeof( DWORD ) ) {
+                return ERR_FORMAT;
+            }
+            length  = *( const DWORD* ) ( data + offset );
+            offset += sizeof( DWORD );
+            if( ( length < 2 )
+             || ( length > ( ( size - offset ) / sizeof( TCHAR ) ) )
+             || ( JOURNAL_ALIGN( length * sizeof( TCHAR ) )
+                  > ( size - offset ) ) ) {
+                return ERR_FORMAT;
+            }
+            text = ( LPCTSTR ) ( data + offset );
+            if( ( text[ length - 1 ] != _T( '\0' ) )
+             || ( text[ length - 2 ] != _T( '\0' ) ) ) {
+                return ERR_FORMAT;
+            }
+            offset += JOURNAL_ALIGN( length * sizeof( TCHAR ) );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The items must fill the entry exactly.
+    ------------------------------------------------------------------*/
+    return ( offset == size ) ? ERR_OK : ERR_FORMAT;
+}
+
+
+/*==========================================================================*/
+error_type compact_journal(         /* replace the journal with a single    */
+                                    /* checkpoint                           */
+    session_journal_type*
+                        journal,    /* open journal                         */
+    const session_journal_state_type*
+                        state       /* current desktop                      */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              file;       /* new journal file handle              */
+    journal_header_type header;     /* new journal header                   */
+    error_type          result;     /* result of internal operation         */
+    DWORD               sequence;   /* number of the old journal's next     */
+                                    /* entry                                */
+    DWORD               size;       /* size of the checkpoint (bytes)       */
+    TCHAR               temporary[ MAX_PATH ];
+                                    /* path of the new journal              */
+    DWORD               written;    /* number of bytes written              */
+
+    /*------------------------------------------------------------------
+    Build the checkpoint.  It starts the new journal's numbering, but
+    the old journal's numbering goes on until the new one replaces it.
+    ------------------------------------------------------------------*/
+    sequence          = journal->sequence;
+    journal->sequence = 0;
+    result = encode_entry( journal, state, TRUE, &size );
+    journal->sequence = sequence;
+    if( result != ERR_OK ) {
+        return result;
+    }
+
+    /*------------------------------------------------------------------
+    Write the new journal beside the old one, and replace the old one
+    only once the new one is on the disk.
+    ------------------------------------------------------------------*/
+    _tcscpy( temporary, journal->path );
+    _tcscat( temporary, JOURNAL_TEMPORARY );
+    file = CreateFile(
+        temporary,
+        ( GENERIC_READ | GENERIC_WRITE ),
+        0,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if( file == INVALID_HANDLE_VALUE ) {
+        return ERR_WINAPI;
+    }
+    header.magic     = SESSION_JOURNAL_MAGIC;
+    header.version   = SESSION_JOURNAL_VERSION;
+    header.char_size = sizeof( TCHAR );
+    if( ( WriteFile( file, &header, sizeof( header ), &written, NULL )
+          == FALSE )
+     || ( written != sizeof( header ) )
+     || ( WriteFile( file, journal->buffer, size, &written, NULL )
+          == FALSE )
+     || ( written != size )
+     || ( FlushFileBuffers( file ) == FALSE ) ) {
+        CloseHandle( file );
+        DeleteFile( temporary );
+        return ERR_WINAPI;
+    }
+    CloseHandle( file );
+
+    /*------------------------------------------------------------------
+    Swap the files, and go on appending to the new one.  If the swap
+    fails, the old journal is still whole, and is appended to instead.
+    ------------------------------------------------------------------*/
+    CloseHandle( journal->file );
+    result = ( MoveFileEx(
+                   temporary,
+                   journal->path,
+                   ( MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH )
+               ) != FALSE ) ? ERR_OK : ERR_WINAPI;
+    if( result != ERR_OK ) {
+        DeleteFile( temporary );
+    }
+    journal->file = CreateFile(
+        journal->path,
+        ( GENERIC_READ | GENERIC_WRITE ),
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if( journal->file == INVALID_HANDLE_VALUE ) {
+        journal->file = NULL;
+        return ERR_WINAPI;
+    }
+    if( result != ERR_OK ) {
+        SetFilePointer( journal->file, journal->size, NULL, FILE_BEGIN );
+        return result;
+    }
+    journal->size     = sizeof( header ) + size;
+    journal->sequence = 1;
+    journal->changes  = 0;
+    SetFilePointer( journal->file, journal->size, NULL, FILE_BEGIN );
+    return apply_entry( &( journal->state ), journal->buffer, size );
+}
+
+
+/*==========================================================================*/
+int compare_ids(                    /* order saved windows by identity      */
+    const void*         left,       /* left-hand window                     */
+    const void*         right       /* right-hand window                    */
+) {                                 /* returns relative order               */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               a;          /* left-hand identity                   */
+    DWORD               b;          /* right-hand identity                  */
+
+    /*------------------------------------------------------------------
+    Compare the identities.
+    ------------------------------------------------------------------*/
+    a = ( ( const session_journal_window_type* ) left )->id;
+    b = ( ( const session_journal_window_type* ) right )->id;
+    return ( a < b ) ? -1 : ( ( a > b ) ? 1 : 0 );
+}
+
+
+/*==========================================================================*/
+error_type encode_entry(            /* build the next entry                 */
+    session_journal_type*
+                        journal,    /* open journal                         */
+    const session_journal_state_type*
+                        state,      /* current desktop                      */
+    BOOL                checkpoint, /* list every window                    */
+    DWORD*              size        /* returned size of the entry (bytes),  */
+                                    /* or 0 if nothing changed              */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPBYTE              buffer;     /* grown entry buffer                   */
+    const session_journal_window_type*
+                        current;    /* current window                       */
+    journal_entry_type* entry;      /* entry header                         */
+    DWORD               flags;      /* parts of the current item            */
+    DWORD               i;          /* recorded window index                */
+    journal_item_type*  item;       /* current item                         */
+    DWORD               j;          /* current window index                 */
+    DWORD               needed;     /* largest possible entry (bytes)       */
+    DWORD               offset;     /* offset of the next part (bytes)      */
+    DWORD               old_count;  /* number of recorded windows compared  */
+    const session_journal_window_type*
+                        recorded;   /* recorded window                      */
+
+    /*------------------------------------------------------------------
+    Make room for every recorded window to close, and every current
+    window to be new.
+    ------------------------------------------------------------------*/
+    old_count = ( checkpoint != FALSE ) ? 0 : journal->state.count;
+    needed    = sizeof( journal_entry_type )
+              + ( old_count * sizeof( journal_item_type ) );
+    for( j = 0; j < state->count; ++j ) {
+        current = &( state->windows[ j ] );
+        needed += sizeof( journal_item_type ) + sizeof( RECT )
+                + sizeof( DWORD )
+                + JOURNAL_ALIGN( current->length * sizeof( TCHAR ) );
+    }
+    if( needed > journal->buffer_size ) {
+        buffer = ( LPBYTE ) HeapAlloc( GetProcessHeap(), 0, needed );
+        if( buffer == NULL ) {
+            return ERR_ALLOC;
+        }
+        if( journal->buffer != NULL ) {
+            HeapFree( GetProcessHeap(), 0, ( LPVOID ) journal->buffer );
+        }
+        journal->buffer      = buffer;
+        journal->buffer_size = needed;
+    }
+
+    /*------------------------------------------------------------------
+    Walk both desktops in order of identity, listing each window that
+    closed, appeared, or changed.
+    ------------------------------------------------------------------*/
+    entry         = ( journal_entry_type* ) journal->buffer;
+    entry->count  = 0;
+    offset        = sizeof( journal_entry_type );
+    i             = 0;
+    j             = 0;
+    while( ( i < old_count ) || ( j < state->count ) ) {
+        recorded = ( i < old_count ) ? &( journal->state.windows[ i ] )
+                 : NULL;
+        current  = ( j < state->count ) ? &( state->windows[ j ] ) : NULL;
+        if( ( current == NULL )
+         || ( ( recorded != NULL ) && ( recorded->id < current->id ) ) ) {
+            item        = ( journal_item_type* ) ( journal->buffer + offset );
+            item->id    = recorded->id;
+            item->flags = JOURNAL_REMOVED;
+            offset     += sizeof( journal_item_type );
+            entry->count += 1;
+            i          += 1;
+            continue;
+        }
+        flags = JOURNAL_RECTANGLE | JOURNAL_TEXT;
+        if( ( recorded != NULL ) && ( recorded->id == current->id ) ) {
+            flags = 0;
+            if( EqualRect( &( recorded->rectangle ), &( current->rectangle ) )
+                == FALSE ) {
+                flags |= JOURNAL_RECTANGLE;
+            }
+            if( ( recorded->hash != current->hash )
+             || ( recorded->length != current->length )
+             || ( memcmp( recorded->text, current->text,
+                          ( current->length * sizeof( TCHAR ) ) ) != 0 ) ) {
+                flags |= JOURNAL_TEXT;
+            }
+            i += 1;
+        }
+        j += 1;
+        if( flags == 0 ) {
+            continue;
+        }
+
+        /*--------------------------------------------------------------
+        Write the item, with the parts that changed.
+        --------------------------------------------------------------*/
+        item        = ( journal_item_type* ) ( journal->buffer + offset );
+        item->id    = current->id;
+        item->flags = flags;
+        offset     += sizeof( journal_item_type );
+        if( ( flags & JOURNAL_RECTANGLE ) != 0 ) {
+            memcpy( ( journal->buffer + offset ), &( current->rectangle ),
+                    sizeof( RECT ) );
+            offset += sizeof( RECT );
+        }
+        if( ( flags & JOURNAL_TEXT ) != 0 ) {
+            *( DWORD* ) ( journal->buffer + offset ) = current->length;
+            offset += sizeof( DWORD );
+            memset(
+                ( journal->buffer + offset ),
+                0,
+                JOURNAL_ALIGN( current->length * sizeof( TCHAR ) )
+            );
+            memcpy( ( journal->buffer + offset ), current->text,
+                    ( current->length * sizeof( TCHAR ) ) );
+            offset += JOURNAL_ALIGN( current->length * sizeof( TCHAR ) );
+        }
+        entry->count += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Finish the header.  A checkpoint is written even when it is empty,
+    since it still clears the windows before it.
+    ------------------------------------------------------------------*/
+    if( ( entry->count == 0 ) && ( checkpoint == FALSE ) ) {
+        *size = 0;
+        return ERR_OK;
+    }
+    entry->size     = offset;
+    entry->kind     = ( checkpoint != FALSE ) ? JOURNAL_CHECKPOINT
+                    : JOURNAL_CHANGES;
+    entry->sequence = journal->sequence;
+    entry->check    = sum_entry( journal->buffer, offset );
+    *size           = offset;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD find_id(                      /* find a saved window                  */
+    const session_journal_state_type*
+                        state,      /* saved desktop                        */
+    DWORD               id,         /* window's identity                    */
+    BOOL*               found       /* returned TRUE if the window is saved */
+) {                                 /* returns its index, or where it goes  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               high;       /* end of the search range              */
+    DWORD               low;        /* start of the search range            */
+    DWORD               middle;     /* window being compared                */
+
+    /*------------------------------------------------------------------
+    Search the windows, which are in order of identity.
+    ------------------------------------------------------------------*/
+    low  = 0;
+    high = state->count;
+    while( low < high ) {
+        middle = low + ( ( high - low ) / 2 );
+        if( state->windows[ middle ].id < id ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    *found = ( ( low < state->count ) && ( state->windows[ low ].id == id ) )
+           ? TRUE : FALSE;
+    return low;
+}
+
+
+/*==========================================================================*/
+DWORD hash_text(                    /* hash a window's text                 */
+    LPCTSTR             text,       /* double-NUL terminated list           */
+    DWORD               length      /* length of the list (characters)      */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const BYTE*         bytes;      /* text's bytes                         */
+    DWORD               hash;       /* FNV-1a hash                          */
+    DWORD               i;          /* byte index                           */
+
+    /*------------------------------------------------------------------
+    Hash every byte, terminators included.
+    ------------------------------------------------------------------*/
+    bytes = ( const BYTE* ) text;
+    hash  = JOURNAL_FNV_BASIS;
+    for( i = 0; i < ( length * sizeof( TCHAR ) ); ++i ) {
+        hash = ( hash ^ bytes[ i ] ) * JOURNAL_FNV_PRIME;
+    }
+    return hash;
+}
+
+
+/*==========================================================================*/
+error_type replay_file(             /* replay every intact entry of a file  */
+    HANDLE              file,       /* journal file handle                  */
+    session_journal_state_type*
+                        state,      /* empty desktop to fill                */
+    DWORD*              size,       /* returned size of the intact journal  */
+                                    /* (bytes), or 0 if it is empty         */
+    DWORD*              sequence,   /* returned number of the next entry    */
+    DWORD*              changes     /* returned entries since the last      */
+                                    /* checkpoint                           */
+) {                                 /* returns error code (ERR_FORMAT if it */
+                                    /* is not a journal)                    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPBYTE              data;       /* contents of the file                 */
+    const journal_entry_type*
+                        entry;      /* current entry                        */
+    DWORD               file_size;  /* size of the file (bytes)             */
+    const journal_header_type*
+                        header;     /* journal header                       */
+    DWORD               offset;     /* offset of the current entry          */
+    DWORD               read;       /* number of bytes read                 */
+    DWORD               remaining;  /* bytes after the current offset       */
+    error_type          result;     /* result of internal operation         */
+    DWORD               size_high;  /* upper part of the file size          */
+
+    /*------------------------------------------------------------------
+    An empty file holds no entries.
+    ------------------------------------------------------------------*/
+    *size     = 0;
+    *sequence = 0;
+    *changes  = 0;
+    file_size = GetFileSize( file, &size_high );
+    if( ( file_size == INVALID_FILE_SIZE ) || ( size_high != 0 ) ) {
+        return ERR_FORMAT;
+    }
+    if( file_size == 0 ) {
+        return ERR_OK;
+    }
+    if( file_size < sizeof( journal_header_type ) ) {
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Read the whole journal.
+    ------------------------------------------------------------------*/
+    data = ( LPBYTE ) HeapAlloc( GetProcessHeap(), 0, file_size );
+    if( data == NULL ) {
+        return ERR_ALLOC;
+    }
+    if( ( ReadFile( file, data, file_size, &read, NULL ) == FALSE )
+     || ( read != file_size ) ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) data );
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    A journal written by another build (or that is not a journal) can
+    not be replayed.
+    ------------------------------------------------------------------*/
+    header = ( const journal_header_type* ) data;
+    if( ( header->magic != SESSION_JOURNAL_MAGIC )
+     || ( header->version != SESSION_JOURNAL_VERSION )
+     || ( header->char_size != sizeof( TCHAR ) ) ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) data );
+        return ERR_FORMAT;
+    }
+
+    /*------------------------------------------------------------------
+    Replay entries up to the first one that is not intact.
+    ------------------------------------------------------------------*/
+    result = ERR_OK;
+    offset = sizeof( journal_header_type );
+    while( result == ERR_OK ) {
+        remaining = file_size - offset;
+        entry     = ( const journal_entry_type* ) ( data + offset );
+        if( ( remaining < sizeof( journal_entry_type ) )
+         || ( entry->size < sizeof( journal_entry_type ) )
+         || ( entry->size > remaining )
+         || ( ( entry->size & 3 ) != 0 )
+         || ( entry->check != sum_entry( ( data + offset ), entry->size ) ) ) {
+            break;
+        }
+        result = apply_entry( state, ( data + offset ), entry->size );
+        if( result == ERR_OK ) {
+            *sequence = entry->sequence + 1;
+            *changes  = ( entry->kind == JOURNAL_CHECKPOINT ) ? 0
+                      : ( *changes + 1 );
+            offset   += entry->size;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the contents, and report the intact size.
+    ------------------------------------------------------------------*/
+    HeapFree( GetProcessHeap(), 0, ( LPVOID ) data );
+    *size = offset;
+    return ( result == ERR_ALLOC ) ? result : ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type reserve_windows(         /* make room for more windows           */
+    session_journal_state_type*
+                        state,      /* desktop to grow                      */
+    DWORD               count       /* number of windows needed             */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* new number of windows allocated      */
+    session_journal_window_type*
+                        windows;    /* grown window list                    */
+
+    /*------------------------------------------------------------------
+    Double the list until it is large enough.
+    ------------------------------------------------------------------*/
+    if( count <= state->capacity ) {
+        return ERR_OK;
+    }
+    capacity = ( state->capacity == 0 ) ? JOURNAL_MIN_WINDOWS
+             : state->capacity;
+    while( capacity < count ) {
+        capacity *= 2;
+    }
+    windows = ( state->windows == NULL )
+            ? ( session_journal_window_type* ) HeapAlloc(
+                GetProcessHeap(),
+                0,
+                ( capacity * sizeof( session_journal_window_type ) )
+            )
+            : ( session_journal_window_type* ) HeapReAlloc(
+                GetProcessHeap(),
+                0,
+                ( LPVOID ) state->windows,
+                ( capacity * sizeof( session_journal_window_type ) )
+            );
+    if( windows == NULL ) {
+        return ERR_ALLOC;
+    }
+    state->windows  = windows;
+    state->capacity = capacity;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD sum_entry(                    /* hash an entry, except its own hash   */
+    const BYTE*         data,       /* entry                                */
+    DWORD               size        /* size of the entry (bytes)            */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               check;      /* offset of the entry's hash           */
+    DWORD               hash;       /* FNV-1a hash                          */
+    DWORD               i;          /* byte index                           */
+
+    /*------------------------------------------------------------------
+    Hash every byte around the hash field.
+    ------------------------------------------------------------------*/
+    check = ( DWORD ) ( ULONG_PTR ) &( ( ( journal_entry_type* ) 0 )->check );
+    hash  = JOURNAL_FNV_BASIS;
+    for( i = 0; i < size; ++i ) {
+        if( ( i < check ) || ( i >= ( check + sizeof( DWORD ) ) ) ) {
+            hash = ( hash ^ data[ i ] ) * JOURNAL_FNV_PRIME;
+        }
+    }
+    return hash;
+}
+
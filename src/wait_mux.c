@@ -0,0 +1,496 @@
+/*****************************************************************************
+
+wait_mux.c
+
+Handle Wait Multiplexer
+
+A single wait can only cover MAXIMUM_WAIT_OBJECTS handles, and restoring
+every configured session at once can leave hundreds of processes to watch.
+This module spreads the handles over helper threads, each waiting on a
+shard of up to WAIT_MUX_SHARD handles plus an event that tells it when its
+shard changed.  A helper that sees a handle signaled takes it out of its
+shard, and queues the handle's tag for the caller.  The caller waits on a
+single event no matter how many handles there are.
+
+Helpers are only started once their shard is needed, and each one blocks
+until something happens, so a large wait costs one thread per shard and no
+polling.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+#include "wait_mux.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+void drop_tag(                      /* take a tag out of its shard          */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* tag being waited on                  */
+);
+
+void report_tag(                    /* queue a signaled tag for the caller  */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* tag being waited on                  */
+);
+
+DWORD WINAPI shard_thread(          /* helper thread entry point            */
+    LPVOID              parameter   /* shard to wait on                     */
+);                                  /* returns thread exit code             */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type wait_mux_add(            /* start waiting on a handle            */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag,        /* handle's tag (below the capacity)    */
+    HANDLE              handle      /* handle to wait on (must stay open    */
+                                    /* until the multiplexer is closed)     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* shard index                          */
+    error_type          result;     /* result of starting a helper          */
+    wait_mux_shard_type*
+                        shard;      /* shard taking the handle              */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( mux == NULL ) || ( tag >= mux->capacity ) || ( handle == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    A tag is waited on once at a time.  Adding a signaled tag again
+    drops its unreported signal.
+    ------------------------------------------------------------------*/
+    EnterCriticalSection( &( mux->lock ) );
+    if( ( mux->slots[ tag ] != WAIT_MUX_NONE )
+     && ( mux->slots[ tag ] != WAIT_MUX_DONE ) ) {
+        LeaveCriticalSection( &( mux->lock ) );
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Use the first shard with room.  There are enough shards for every
+    tag, so one always has room.
+    ------------------------------------------------------------------*/
+    for( i = 0; mux->shards[ i ].count == WAIT_MUX_SHARD; ++i ) {
+        /* Nothing else to do. */
+    }
+    shard = &( mux->shards[ i ] );
+
+    /*------------------------------------------------------------------
+    Start the shard's helper the first time it is needed.
+    ------------------------------------------------------------------*/
+    result = ERR_OK;
+    if( shard->thread == NULL ) {
+        shard->signal = CreateEvent( NULL, FALSE, FALSE, NULL );
+        if( shard->signal != NULL ) {
+            shard->thread = CreateThread(
+                NULL,
+                0,
+                shard_thread,
+                ( LPVOID ) shard,
+                0,
+                NULL
+            );
+            if( shard->thread == NULL ) {
+                CloseHandle( shard->signal );
+                shard->signal = NULL;
+            }
+        }
+        if( shard->thread == NULL ) {
+            result = ERR_WINAPI;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Put the handle in the shard, and have the helper wait on it.
+    ------------------------------------------------------------------*/
+    if( result == ERR_OK ) {
+        shard->handles[ shard->count ] = handle;
+        shard->tags[ shard->count ]    = tag;
+        mux->slots[ tag ] = ( i * WAIT_MUX_SHARD ) + shard->count;
+        shard->count     += 1;
+        SetEvent( shard->signal );
+    }
+    LeaveCriticalSection( &( mux->lock ) );
+
+    /*------------------------------------------------------------------
+    Return the result of adding the handle.
+    ------------------------------------------------------------------*/
+    return result;
+}
+
+
+/*==========================================================================*/
+void wait_mux_close(                /* stop every helper and release memory */
+    wait_mux_type*      mux         /* multiplexer object                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* shard index                          */
+    wait_mux_shard_type*
+                        shard;      /* shard being stopped                  */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( mux == NULL ) || ( mux->shards == NULL ) ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Stop each helper that was started, and wait for it to exit, since
+    it still reads its shard.
+    ------------------------------------------------------------------*/
+    InterlockedExchange( &( mux->stopping ), 1 );
+    for( i = 0; i < mux->shard_count; ++i ) {
+        shard = &( mux->shards[ i ] );
+        if( shard->thread != NULL ) {
+            SetEvent( shard->signal );
+            WaitForSingleObject( shard->thread, INFINITE );
+            CloseHandle( shard->thread );
+            CloseHandle( shard->signal );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the queue, then the shards and tables.
+    ------------------------------------------------------------------*/
+    DeleteCriticalSection( &( mux->lock ) );
+    CloseHandle( mux->ready );
+    HeapFree( GetProcessHeap(), 0, ( LPVOID ) mux->shards );
+
+    /*------------------------------------------------------------------
+    Clear the multiplexer object.
+    ------------------------------------------------------------------*/
+    memset( mux, 0, sizeof( wait_mux_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type wait_mux_next(           /* wait for the next signaled handle    */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               timeout,    /* limit on the wait (ms), or INFINITE  */
+    DWORD*              tag         /* returned handle's tag                */
+) {                                 /* returns error code (ERR_TIMEOUT if   */
+                                    /* nothing was signaled in time)        */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               elapsed;    /* time spent waiting                   */
+    DWORD               start;      /* tick count when the wait started     */
+    DWORD               next;       /* signaled tag being checked           */
+    DWORD               wait;       /* time left to wait                    */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( mux == NULL ) || ( tag == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Take the oldest signaled tag.  Tags removed or added again since
+    they were signaled are passed over.  The ready event is only reset
+    once the queue is empty, so it can be waited on along with other
+    handles.
+    ------------------------------------------------------------------*/
+    start = GetTickCount();
+    for( ; ; ) {
+        EnterCriticalSection( &( mux->lock ) );
+        while( mux->head != mux->tail ) {
+            next = mux->done[ mux->head % mux->capacity ];
+            mux->head          += 1;
+            mux->queued[ next ] = FALSE;
+            if( mux->slots[ next ] == WAIT_MUX_DONE ) {
+                mux->slots[ next ] = WAIT_MUX_NONE;
+                LeaveCriticalSection( &( mux->lock ) );
+                *tag = next;
+                return ERR_OK;
+            }
+        }
+        ResetEvent( mux->ready );
+        LeaveCriticalSection( &( mux->lock ) );
+
+        /*--------------------------------------------------------------
+        Wait for a helper to queue something.
+        --------------------------------------------------------------*/
+        wait = INFINITE;
+        if( timeout != INFINITE ) {
+            elapsed = GetTickCount() - start;
+            wait    = ( elapsed < timeout ) ? ( timeout - elapsed ) : 0;
+        }
+        if( ( wait == 0 )
+         || ( WaitForSingleObject( mux->ready, wait ) != WAIT_OBJECT_0 ) ) {
+            return ERR_TIMEOUT;
+        }
+    }
+}
+
+
+/*==========================================================================*/
+error_type wait_mux_open(           /* create a handle wait multiplexer     */
+    wait_mux_type*      mux,        /* multiplexer object to initialize     */
+    DWORD               capacity    /* number of tags                       */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* shard index                          */
+    LPBYTE              memory;     /* shards and tables                    */
+    DWORD               shards;     /* number of shards                     */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( mux == NULL ) || ( capacity == 0 ) ) {
+        return ERR_USAGE;
+    }
+    memset( mux, 0, sizeof( wait_mux_type ) );
+
+    /*------------------------------------------------------------------
+    Allocate the shards, the slot table, the queue, and the queued
+    flags at once.
+    ------------------------------------------------------------------*/
+    shards = ( capacity + WAIT_MUX_SHARD - 1 ) / WAIT_MUX_SHARD;
+    memory = ( LPBYTE ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( ( shards * sizeof( wait_mux_shard_type ) )
+          + ( 2 * capacity * sizeof( DWORD ) )
+          + capacity )
+    );
+    if( memory == NULL ) {
+        return ERR_ALLOC;
+    }
+    mux->shards      = ( wait_mux_shard_type* ) memory;
+    mux->slots       = ( DWORD* ) ( mux->shards + shards );
+    mux->done        = mux->slots + capacity;
+    mux->queued      = ( LPBYTE ) ( mux->done + capacity );
+    mux->shard_count = shards;
+    mux->capacity    = capacity;
+    memset( mux->slots, 0xFF, ( capacity * sizeof( DWORD ) ) );
+    for( i = 0; i < shards; ++i ) {
+        mux->shards[ i ].mux = mux;
+    }
+
+    /*------------------------------------------------------------------
+    Create the queue's lock and signal.
+    ------------------------------------------------------------------*/
+    mux->ready = CreateEvent( NULL, TRUE, FALSE, NULL );
+    if( mux->ready == NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) memory );
+        memset( mux, 0, sizeof( wait_mux_type ) );
+        return ERR_WINAPI;
+    }
+    InitializeCriticalSection( &( mux->lock ) );
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void wait_mux_remove(               /* stop waiting on a handle             */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* handle's tag                         */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( mux == NULL ) || ( tag >= mux->capacity ) ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    The helper notices the handle is gone if it is signaled later, so
+    it does not need to be told now.
+    ------------------------------------------------------------------*/
+    EnterCriticalSection( &( mux->lock ) );
+    if( mux->slots[ tag ] == WAIT_MUX_DONE ) {
+        mux->slots[ tag ] = WAIT_MUX_NONE;
+    }
+    else if( mux->slots[ tag ] != WAIT_MUX_NONE ) {
+        drop_tag( mux, tag );
+    }
+    LeaveCriticalSection( &( mux->lock ) );
+
+}
+
+
+/*==========================================================================*/
+void drop_tag(                      /* take a tag out of its shard          */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* tag being waited on                  */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               last;       /* shard's last slot                    */
+    wait_mux_shard_type*
+                        shard;      /* tag's shard                          */
+    DWORD               slot;       /* tag's slot in its shard              */
+
+    /*------------------------------------------------------------------
+    Move the shard's last handle into the tag's slot.  The caller holds
+    the lock.
+    ------------------------------------------------------------------*/
+    shard = &( mux->shards[ mux->slots[ tag ] / WAIT_MUX_SHARD ] );
+    slot  = mux->slots[ tag ] % WAIT_MUX_SHARD;
+    last  = shard->count - 1;
+    if( slot != last ) {
+        shard->handles[ slot ] = shard->handles[ last ];
+        shard->tags[ slot ]    = shard->tags[ last ];
+        mux->slots[ shard->tags[ slot ] ] = mux->slots[ tag ];
+    }
+    shard->count      = last;
+    mux->slots[ tag ] = WAIT_MUX_NONE;
+
+}
+
+
+/*==========================================================================*/
+void report_tag(                    /* queue a signaled tag for the caller  */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* tag being waited on                  */
+) {
+
+    /*------------------------------------------------------------------
+    A tag holds at most one place in the queue, so the queue never
+    holds more than one lap of tags.  The caller holds the lock.
+    ------------------------------------------------------------------*/
+    drop_tag( mux, tag );
+    mux->slots[ tag ] = WAIT_MUX_DONE;
+    if( mux->queued[ tag ] == FALSE ) {
+        mux->queued[ tag ] = TRUE;
+        mux->done[ mux->tail % mux->capacity ] = tag;
+        mux->tail += 1;
+    }
+    SetEvent( mux->ready );
+
+}
+
+
+/*==========================================================================*/
+DWORD WINAPI shard_thread(          /* helper thread entry point            */
+    LPVOID              parameter   /* shard to wait on                     */
+) {                                 /* returns thread exit code             */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of handles waited on          */
+    HANDLE              handles[ WAIT_MUX_SHARD + 1 ];
+                                    /* signal, then the shard's handles     */
+    DWORD               i;          /* handle index                         */
+    wait_mux_type*      mux;        /* multiplexer object                   */
+    wait_mux_shard_type*
+                        shard;      /* shard to wait on                     */
+    DWORD               slot;       /* slot of the signaled tag             */
+    DWORD               tags[ WAIT_MUX_SHARD + 1 ];
+                                    /* tag of each handle                   */
+    DWORD               wresult;    /* result of Windows API calls          */
+
+    /*------------------------------------------------------------------
+    Wait on a copy of the shard, so the shard can change during the
+    wait.  The signal comes first, so changes are seen before any
+    handle that was removed.
+    ------------------------------------------------------------------*/
+    shard = ( wait_mux_shard_type* ) parameter;
+    mux   = shard->mux;
+    for( ; ; ) {
+        EnterCriticalSection( &( mux->lock ) );
+        handles[ 0 ] = shard->signal;
+        count        = shard->count + 1;
+        memcpy(
+            &( handles[ 1 ] ),
+            shard->handles,
+            ( shard->count * sizeof( HANDLE ) )
+        );
+        memcpy(
+            &( tags[ 1 ] ),
+            shard->tags,
+            ( shard->count * sizeof( DWORD ) )
+        );
+        LeaveCriticalSection( &( mux->lock ) );
+        wresult = WaitForMultipleObjects( count, handles, FALSE, INFINITE );
+        if( mux->stopping != 0 ) {
+            break;
+        }
+
+        /*--------------------------------------------------------------
+        Report a signaled handle, unless it was removed (and perhaps
+        added again) during the wait.
+        --------------------------------------------------------------*/
+        i = wresult - WAIT_OBJECT_0;
+        EnterCriticalSection( &( mux->lock ) );
+        if( ( i > 0 ) && ( i < count ) ) {
+            slot = mux->slots[ tags[ i ] ];
+            if( ( slot < ( mux->shard_count * WAIT_MUX_SHARD ) )
+             && ( &( mux->shards[ slot / WAIT_MUX_SHARD ] ) == shard )
+             && ( shard->handles[ slot % WAIT_MUX_SHARD ] == handles[ i ] ) ) {
+                report_tag( mux, tags[ i ] );
+            }
+        }
+
+        /*--------------------------------------------------------------
+        A handle that can not be waited on (it was closed too soon)
+        would fail every wait.  Report it as signaled, rather than
+        spinning on it.
+        --------------------------------------------------------------*/
+        else if( wresult == WAIT_FAILED ) {
+            for( i = shard->count; i > 0; --i ) {
+                if( WaitForSingleObject( shard->handles[ i - 1 ], 0 )
+                    == WAIT_FAILED ) {
+                    report_tag( mux, shard->tags[ i - 1 ] );
+                }
+            }
+        }
+        LeaveCriticalSection( &( mux->lock ) );
+    }
+
+    /*------------------------------------------------------------------
+    Exit the thread.
+    ------------------------------------------------------------------*/
+    return 0;
+}
+
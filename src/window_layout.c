@@ -0,0 +1,535 @@
+/*****************************************************************************
+
+window_layout.c
+
+Open Window Layout
+
+Moving windows that are already open back to their configured rectangles
+(after a monitor is reconnected, for instance) needs no launching at all.
+The open windows are listed once, with their owning processes' images and
+arguments (see proc_match.c), and every configured window is ranked against
+every open window in one pass:
+
+    1. A window whose process runs the same image with the same arguments
+       outranks one that only runs the same image.
+    2. A window whose title contains the configured window's name outranks
+       one that does not.
+    3. A window nearer its configured rectangle outranks one farther away,
+       so a layout that is mostly in place stays put.
+
+The ranked pairs are then taken best first, each configured window and each
+open window at most once.  The desktop and taskbar windows are never taken,
+even though they belong to the shell's image.
+
+Every move is applied in one deferred window position batch, so the windows
+are repainted once, together, instead of one after another.  Windows that
+are already in place are left out of the batch.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "window_layout.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define LAYOUT_FLAGS ( SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE )
+                                    /* window position flags for a move     */
+
+#define LAYOUT_MIN_PAIRS    ( 64 )  /* fewest ranked pairs allocated        */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct layout_pair_s {      /* ranked window pair type              */
+    DWORD               item;       /* configured window's layout item      */
+    DWORD               window;     /* open window's index in the list      */
+    DWORD               rank;       /* higher ranks are taken first         */
+    DWORD               distance;   /* distance from the configured         */
+                                    /* rectangle (pixels)                   */
+} layout_pair_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+const LPCTSTR layout_shell_classes[] = {
+                                    /* classes of the shell's own windows   */
+    _T( "Progman" ),
+    _T( "WorkerW" ),
+    _T( "Shell_TrayWnd" ),
+    _T( "Shell_SecondaryTrayWnd" ),
+    NULL
+};
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+int compare_pairs(                  /* order pairs best first               */
+    const void*         left,       /* first pair                           */
+    const void*         right       /* second pair                          */
+);                                  /* returns sort order                   */
+
+BOOL contains_text(                 /* check a title for a name             */
+    LPCTSTR             text,       /* text to search                       */
+    LPCTSTR             name        /* name to find, ignoring case          */
+);                                  /* returns TRUE if the name is found    */
+
+void defer_moves(                   /* move the assigned windows at once    */
+    window_layout_type* layout      /* layout pass result                   */
+);
+
+error_type rank_pairs(              /* rank every possible assignment       */
+    window_layout_type* layout,     /* configured windows                   */
+    proc_match_type*    running,    /* open windows and their processes     */
+    proc_match_entry_type**
+                        owners,     /* each open window's process, or NULL  */
+    layout_pair_type**  pairs,      /* returned ranked pairs                */
+    DWORD*              count       /* returned number of pairs             */
+);                                  /* returns error code                   */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+void window_layout_free(            /* release a layout pass result         */
+    window_layout_type* layout      /* layout pass result                   */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( layout == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release the items, and clear the result object.
+    ------------------------------------------------------------------*/
+    if( layout->items != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) layout->items );
+    }
+    memset( layout, 0, sizeof( window_layout_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type window_layout_run(       /* move open windows to their           */
+                                    /* configured rectangles                */
+    config_session_type**
+                        sessions,   /* sessions to lay out                  */
+    DWORD               count,      /* number of sessions                   */
+    proc_match_type*    running,    /* processes that own windows (built    */
+                                    /* with window text)                    */
+    window_layout_type* layout      /* returned result of each window       */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             class_name; /* open window's class name             */
+    const config_window_type*
+                        configured; /* configured window                    */
+    DWORD               i;          /* session, item or pair index          */
+    window_layout_item_type*
+                        item;       /* configured window's layout           */
+    DWORD               j;          /* window or class index                */
+    window_list_type*   list;       /* open windows                         */
+    proc_match_entry_type**
+                        owners;     /* each open window's process, or NULL  */
+    DWORD               pair_count; /* number of ranked pairs               */
+    layout_pair_type*   pairs;      /* ranked pairs                         */
+    error_type          result;     /* result of internal operation         */
+    BOOL*               taken;      /* each open window has been assigned   */
+    DWORD               total;      /* number of configured windows         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( ( sessions == NULL ) && ( count > 0 ) ) || ( running == NULL )
+     || ( layout == NULL ) ) {
+        return ERR_USAGE;
+    }
+    memset( layout, 0, sizeof( window_layout_type ) );
+    list = &( running->windows );
+
+    /*------------------------------------------------------------------
+    Give each configured window an item.  A window without a rectangle
+    has nothing to lay out.
+    ------------------------------------------------------------------*/
+    total = 0;
+    for( i = 0; i < count; ++i ) {
+        total += sessions[ i ]->count;
+    }
+    if( total == 0 ) {
+        return ERR_OK;
+    }
+    layout->items = ( window_layout_item_type* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( total * sizeof( window_layout_item_type ) )
+    );
+    if( layout->items == NULL ) {
+        return ERR_ALLOC;
+    }
+    layout->count = total;
+    item          = layout->items;
+    for( i = 0; i < count; ++i ) {
+        for( j = 0; j < sessions[ i ]->count; ++j, ++item ) {
+            configured    = &( sessions[ i ]->windows[ j ] );
+            item->session = sessions[ i ];
+            item->index   = j;
+            item->result  = ( IsRectEmpty( &( configured->rectangle ) )
+                              == FALSE ) ? ERR_NOT_FOUND : ERR_OK;
+        }
+    }
+    if( list->count == 0 ) {
+        return ERR_OK;
+    }
+
+    /*------------------------------------------------------------------
+    Look up each open window's process once.  The shell's own windows
+    are left without one, so they are never assigned.
+    ------------------------------------------------------------------*/
+    owners = ( proc_match_entry_type** ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( list->count * ( sizeof( proc_match_entry_type* )
+                          + sizeof( BOOL ) ) )
+    );
+    if( owners == NULL ) {
+        window_layout_free( layout );
+        return ERR_ALLOC;
+    }
+    taken = ( BOOL* ) ( owners + list->count );
+    for( i = 0; i < list->count; ++i ) {
+        class_name = window_list_class( list, i );
+        for( j = 0; layout_shell_classes[ j ] != NULL; ++j ) {
+            if( _tcscmp( class_name, layout_shell_classes[ j ] ) == 0 ) {
+                break;
+            }
+        }
+        if( layout_shell_classes[ j ] == NULL ) {
+            owners[ i ] = proc_match_find( running, list->process_ids[ i ] );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Rank every possible assignment, best first.
+    ------------------------------------------------------------------*/
+    result = rank_pairs( layout, running, owners, &pairs, &pair_count );
+    if( result != ERR_OK ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) owners );
+        window_layout_free( layout );
+        return result;
+    }
+    qsort( pairs, pair_count, sizeof( layout_pair_type ), compare_pairs );
+
+    /*------------------------------------------------------------------
+    Take the pairs in order, skipping any whose configured window or
+    open window was already assigned.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < pair_count; ++i ) {
+        item = &( layout->items[ pairs[ i ].item ] );
+        if( ( item->found != NULL )
+         || ( taken[ pairs[ i ].window ] != FALSE ) ) {
+            continue;
+        }
+        taken[ pairs[ i ].window ] = TRUE;
+        item->found  = list->windows[ pairs[ i ].window ];
+        item->moved  = ( pairs[ i ].distance != 0 ) ? TRUE : FALSE;
+        item->result = ERR_OK;
+    }
+    if( pairs != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) pairs );
+    }
+    HeapFree( GetProcessHeap(), 0, ( LPVOID ) owners );
+
+    /*------------------------------------------------------------------
+    Move the windows that are out of place, all at once.
+    ------------------------------------------------------------------*/
+    defer_moves( layout );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+int compare_pairs(                  /* order pairs best first               */
+    const void*         left,       /* first pair                           */
+    const void*         right       /* second pair                          */
+) {                                 /* returns sort order                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    const layout_pair_type*
+                        a;          /* first pair                           */
+    const layout_pair_type*
+                        b;          /* second pair                          */
+
+    /*------------------------------------------------------------------
+    Higher ranks first, then nearer windows.  Ties go to the earlier
+    configured window, then to the open window nearer the top, so the
+    same screen always gets the same layout.
+    ------------------------------------------------------------------*/
+    a = ( const layout_pair_type* ) left;
+    b = ( const layout_pair_type* ) right;
+    if( a->rank != b->rank ) {
+        return ( a->rank > b->rank ) ? -1 : 1;
+    }
+    if( a->distance != b->distance ) {
+        return ( a->distance < b->distance ) ? -1 : 1;
+    }
+    if( a->item != b->item ) {
+        return ( a->item < b->item ) ? -1 : 1;
+    }
+    return ( a->window < b->window ) ? -1
+         : ( ( a->window > b->window ) ? 1 : 0 );
+}
+
+
+/*==========================================================================*/
+BOOL contains_text(                 /* check a title for a name             */
+    LPCTSTR             text,       /* text to search                       */
+    LPCTSTR             name        /* name to find, ignoring case          */
+) {                                 /* returns TRUE if the name is found    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* character index within the name      */
+
+    /*------------------------------------------------------------------
+    Titles and names are short, so compare at each position.
+    ------------------------------------------------------------------*/
+    if( *name == _T( '\0' ) ) {
+        return FALSE;
+    }
+    for( ; *text != _T( '\0' ); ++text ) {
+        for( i = 0; name[ i ] != _T( '\0' ); ++i ) {
+            if( _totlower( text[ i ] ) != _totlower( name[ i ] ) ) {
+                break;
+            }
+        }
+        if( name[ i ] == _T( '\0' ) ) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+/*==========================================================================*/
+void defer_moves(                   /* move the assigned windows at once    */
+    window_layout_type* layout      /* layout pass result                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HDWP                batch;      /* deferred window positions            */
+    DWORD               i;          /* item index                           */
+    window_layout_item_type*
+                        item;       /* configured window's layout           */
+    DWORD               moves;      /* number of windows to move            */
+    const RECT*         rectangle;  /* configured rectangle                 */
+
+    /*------------------------------------------------------------------
+    Count the moves, so the batch is allocated once.
+    ------------------------------------------------------------------*/
+    moves = 0;
+    for( i = 0; i < layout->count; ++i ) {
+        if( layout->items[ i ].moved != FALSE ) {
+            moves += 1;
+        }
+    }
+    if( moves == 0 ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Queue every move, then apply them in one transaction.  A failed
+    DeferWindowPos releases the whole batch.
+    ------------------------------------------------------------------*/
+    batch = BeginDeferWindowPos( ( int ) moves );
+    for( i = 0; ( batch != NULL ) && ( i < layout->count ); ++i ) {
+        item = &( layout->items[ i ] );
+        if( item->moved == FALSE ) {
+            continue;
+        }
+        rectangle = &( item->session->windows[ item->index ].rectangle );
+        batch = DeferWindowPos(
+            batch,
+            item->found,
+            NULL,
+            rectangle->left,
+            rectangle->top,
+            ( rectangle->right - rectangle->left ),
+            ( rectangle->bottom - rectangle->top ),
+            LAYOUT_FLAGS
+        );
+    }
+    if( ( batch != NULL ) && ( EndDeferWindowPos( batch ) != FALSE ) ) {
+        layout->moved = moves;
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    The batch could not be applied (a window closed while it was being
+    built, for instance), so move each window on its own.  A window
+    already moved by a partial batch is simply moved to the same place.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < layout->count; ++i ) {
+        item = &( layout->items[ i ] );
+        if( item->moved == FALSE ) {
+            continue;
+        }
+        rectangle = &( item->session->windows[ item->index ].rectangle );
+        if( SetWindowPos(
+                item->found,
+                NULL,
+                rectangle->left,
+                rectangle->top,
+                ( rectangle->right - rectangle->left ),
+                ( rectangle->bottom - rectangle->top ),
+                LAYOUT_FLAGS
+            ) == FALSE ) {
+            item->result = ERR_WINAPI;
+            continue;
+        }
+        layout->moved += 1;
+    }
+
+}
+
+
+/*==========================================================================*/
+error_type rank_pairs(              /* rank every possible assignment       */
+    window_layout_type* layout,     /* configured windows                   */
+    proc_match_type*    running,    /* open windows and their processes     */
+    proc_match_entry_type**
+                        owners,     /* each open window's process, or NULL  */
+    layout_pair_type**  pairs,      /* returned ranked pairs                */
+    DWORD*              count       /* returned number of pairs             */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* number of pairs allocated            */
+    const config_window_type*
+                        configured; /* configured window                    */
+    DWORD               i;          /* item index                           */
+    DWORD               j;          /* open window index                    */
+    proc_match_key_type key;        /* program the window would run         */
+    window_list_type*   list;       /* open windows                         */
+    layout_pair_type*   pair;       /* pair being added                     */
+    DWORD               rank;       /* process rank                         */
+    layout_pair_type*   resized;    /* reallocated pairs                    */
+    const RECT*         shown;      /* open window's rectangle              */
+    const RECT*         wanted;     /* configured rectangle                 */
+
+    /*------------------------------------------------------------------
+    Start with no pairs.
+    ------------------------------------------------------------------*/
+    list     = &( running->windows );
+    capacity = 0;
+    *pairs   = NULL;
+    *count   = 0;
+
+    /*------------------------------------------------------------------
+    Pair each configured window that has a rectangle with every open
+    window whose process runs its program.  The image name hashes rule
+    out nearly every open window before any pool IDs are compared.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < layout->count; ++i ) {
+        if( layout->items[ i ].result != ERR_NOT_FOUND ) {
+            continue;
+        }
+        configured = &( layout->items[ i ].session->windows[
+            layout->items[ i ].index ] );
+        if( proc_match_key( running, configured, &key ) != ERR_OK ) {
+            continue;
+        }
+        wanted = &( configured->rectangle );
+        for( j = 0; j < list->count; ++j ) {
+            if( ( owners[ j ] == NULL )
+             || ( owners[ j ]->name_hash != key.name_hash ) ) {
+                continue;
+            }
+            rank = proc_match_rank( owners[ j ], &key );
+            if( rank == PROC_MATCH_NONE ) {
+                continue;
+            }
+
+            /*----------------------------------------------------------
+            Grow the pairs by doubling.
+            ----------------------------------------------------------*/
+            if( *count == capacity ) {
+                capacity = ( capacity == 0 )
+                         ? LAYOUT_MIN_PAIRS : ( 2 * capacity );
+                resized  = ( *pairs == NULL )
+                    ? ( layout_pair_type* ) HeapAlloc(
+                        GetProcessHeap(),
+                        0,
+                        ( capacity * sizeof( layout_pair_type ) )
+                    )
+                    : ( layout_pair_type* ) HeapReAlloc(
+                        GetProcessHeap(),
+                        0,
+                        ( LPVOID ) *pairs,
+                        ( capacity * sizeof( layout_pair_type ) )
+                    );
+                if( resized == NULL ) {
+                    if( *pairs != NULL ) {
+                        HeapFree( GetProcessHeap(), 0, ( LPVOID ) *pairs );
+                    }
+                    *pairs = NULL;
+                    *count = 0;
+                    return ERR_ALLOC;
+                }
+                *pairs = resized;
+            }
+
+            /*----------------------------------------------------------
+            A matching title counts for less than matching arguments.
+            ----------------------------------------------------------*/
+            shown          = &( list->rectangles[ j ] );
+            pair           = &( ( *pairs )[ *count ] );
+            pair->item     = i;
+            pair->window   = j;
+            pair->rank     = 2 * rank;
+            pair->distance = ( DWORD ) ( labs( shown->left - wanted->left )
+                                       + labs( shown->top - wanted->top )
+                                       + labs( shown->right - wanted->right )
+                                       + labs( shown->bottom
+                                               - wanted->bottom ) );
+            if( ( configured->name != NULL )
+             && ( contains_text(
+                    window_list_title( list, j ),
+                    configured->name
+                ) != FALSE ) ) {
+                pair->rank += 1;
+            }
+            *count += 1;
+        }
+    }
+    return ERR_OK;
+}
+
@@ -0,0 +1,328 @@
+/*****************************************************************************
+
+window_list.c
+
+Top-Level Window List
+
+The visible, unowned top-level windows are enumerated once, into parallel
+arrays (handle, owning process, rectangle, and optionally class name and
+title), so later passes can scan them without calling back into the window
+manager.  The arrays stay in Z order, topmost first.  Class names and titles
+are kept in one growing string buffer, and referred to by offset, so the
+buffer can move as it grows.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "window_list.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define LIST_MIN_WINDOWS    ( 64 )  /* fewest windows allocated             */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL grow_array(                    /* resize one of a list's arrays        */
+    LPVOID*             array,      /* array to resize (may be NULL)        */
+    SIZE_T              size        /* new size (bytes)                     */
+);                                  /* returns FALSE if out of memory       */
+
+BOOL CALLBACK list_window(          /* add a top-level window to a list     */
+    HWND                window,     /* enumerated window                    */
+    LPARAM              parameter   /* window list                          */
+);                                  /* returns TRUE to keep enumerating     */
+
+DWORD store_text(                   /* read a window's text into a list     */
+    window_list_type*   list,       /* window list                          */
+    HWND                window,     /* window to read                       */
+    BOOL                title       /* read the title, not the class name   */
+);                                  /* returns offset of the text           */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+LPCTSTR window_list_class(          /* get a window's class name            */
+    window_list_type*   list,       /* window list                          */
+    DWORD               index       /* window index                         */
+) {                                 /* returns class name, or empty string  */
+
+    /*------------------------------------------------------------------
+    Class names are only there when the list was taken with its text.
+    ------------------------------------------------------------------*/
+    if( ( list == NULL ) || ( list->strings == NULL )
+     || ( index >= list->count ) ) {
+        return _T( "" );
+    }
+    return list->strings + list->classes[ index ];
+}
+
+
+/*==========================================================================*/
+void window_list_free(              /* release a window list                */
+    window_list_type*   list        /* window list                          */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPVOID              arrays[ 6 ];/* each allocated array                 */
+    DWORD               i;          /* array index                          */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( list == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Release each array that was allocated.
+    ------------------------------------------------------------------*/
+    arrays[ 0 ] = ( LPVOID ) list->windows;
+    arrays[ 1 ] = ( LPVOID ) list->process_ids;
+    arrays[ 2 ] = ( LPVOID ) list->rectangles;
+    arrays[ 3 ] = ( LPVOID ) list->classes;
+    arrays[ 4 ] = ( LPVOID ) list->titles;
+    arrays[ 5 ] = ( LPVOID ) list->strings;
+    for( i = 0; i < 6; ++i ) {
+        if( arrays[ i ] != NULL ) {
+            HeapFree( GetProcessHeap(), 0, arrays[ i ] );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Clear the list object.
+    ------------------------------------------------------------------*/
+    memset( list, 0, sizeof( window_list_type ) );
+
+}
+
+
+/*==========================================================================*/
+error_type window_list_take(        /* list the visible, unowned top-level  */
+                                    /* windows                              */
+    window_list_type*   list,       /* window list to initialize            */
+    BOOL                text        /* also read class names and titles     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    error_type          result;     /* result of listing the windows        */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( list == NULL ) {
+        return ERR_USAGE;
+    }
+    memset( list, 0, sizeof( window_list_type ) );
+    list->text = text;
+
+    /*------------------------------------------------------------------
+    Enumerate the windows once.  A failure in the callback stops the
+    enumeration, and leaves its reason in the list.
+    ------------------------------------------------------------------*/
+    EnumWindows( list_window, ( LPARAM ) list );
+    result = list->result;
+    if( result != ERR_OK ) {
+        window_list_free( list );
+    }
+    return result;
+}
+
+
+/*==========================================================================*/
+LPCTSTR window_list_title(          /* get a window's title                 */
+    window_list_type*   list,       /* window list                          */
+    DWORD               index       /* window index                         */
+) {                                 /* returns title, or empty string       */
+
+    /*------------------------------------------------------------------
+    Titles are only there when the list was taken with its text.
+    ------------------------------------------------------------------*/
+    if( ( list == NULL ) || ( list->strings == NULL )
+     || ( index >= list->count ) ) {
+        return _T( "" );
+    }
+    return list->strings + list->titles[ index ];
+}
+
+
+/*==========================================================================*/
+BOOL grow_array(                    /* resize one of a list's arrays        */
+    LPVOID*             array,      /* array to resize (may be NULL)        */
+    SIZE_T              size        /* new size (bytes)                     */
+) {                                 /* returns FALSE if out of memory       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPVOID              resized;    /* reallocated array                    */
+
+    /*------------------------------------------------------------------
+    The old array stays valid when it can not be resized.
+    ------------------------------------------------------------------*/
+    resized = ( *array == NULL )
+        ? HeapAlloc( GetProcessHeap(), 0, size )
+        : HeapReAlloc( GetProcessHeap(), 0, *array, size );
+    if( resized == NULL ) {
+        return FALSE;
+    }
+    *array = resized;
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+BOOL CALLBACK list_window(          /* add a top-level window to a list     */
+    HWND                window,     /* enumerated window                    */
+    LPARAM              parameter   /* window list                          */
+) {                                 /* returns TRUE to keep enumerating     */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               capacity;   /* new number of windows allocated      */
+    DWORD               index;      /* new window's index                   */
+    window_list_type*   list;       /* window list                          */
+    BOOL                ready;      /* every array was resized              */
+
+    /*------------------------------------------------------------------
+    Only visible, unowned windows can be a session's windows.
+    ------------------------------------------------------------------*/
+    list = ( window_list_type* ) parameter;
+    if( ( IsWindowVisible( window ) == FALSE )
+     || ( GetWindow( window, GW_OWNER ) != NULL ) ) {
+        return TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    Grow the arrays by doubling.  The capacity only changes once every
+    array has its new size.
+    ------------------------------------------------------------------*/
+    if( list->count == list->capacity ) {
+        capacity = ( list->capacity == 0 )
+                 ? LIST_MIN_WINDOWS : ( 2 * list->capacity );
+        ready = grow_array(
+                    ( LPVOID* ) &( list->windows ),
+                    ( capacity * sizeof( HWND ) )
+                )
+             && grow_array(
+                    ( LPVOID* ) &( list->process_ids ),
+                    ( capacity * sizeof( DWORD ) )
+                )
+             && grow_array(
+                    ( LPVOID* ) &( list->rectangles ),
+                    ( capacity * sizeof( RECT ) )
+                );
+        if( ( ready != FALSE ) && ( list->text != FALSE ) ) {
+            ready = grow_array(
+                        ( LPVOID* ) &( list->classes ),
+                        ( capacity * sizeof( DWORD ) )
+                    )
+                 && grow_array(
+                        ( LPVOID* ) &( list->titles ),
+                        ( capacity * sizeof( DWORD ) )
+                    );
+        }
+        if( ready == FALSE ) {
+            list->result = ERR_ALLOC;
+            return FALSE;
+        }
+        list->capacity = capacity;
+    }
+
+    /*------------------------------------------------------------------
+    Add the window.  A window that is destroyed while it is read keeps
+    an empty rectangle, and is then never matched.
+    ------------------------------------------------------------------*/
+    index = list->count;
+    list->windows[ index ]     = window;
+    list->process_ids[ index ] = 0;
+    GetWindowThreadProcessId( window, &( list->process_ids[ index ] ) );
+    if( GetWindowRect( window, &( list->rectangles[ index ] ) ) == FALSE ) {
+        SetRectEmpty( &( list->rectangles[ index ] ) );
+    }
+    if( list->text != FALSE ) {
+        list->classes[ index ] = store_text( list, window, FALSE );
+        list->titles[ index ]  = store_text( list, window, TRUE );
+        if( list->result != ERR_OK ) {
+            return FALSE;
+        }
+    }
+    list->count += 1;
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+DWORD store_text(                   /* read a window's text into a list     */
+    window_list_type*   list,       /* window list                          */
+    HWND                window,     /* window to read                       */
+    BOOL                title       /* read the title, not the class name   */
+) {                                 /* returns offset of the text           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    int                 length;     /* length of the text read              */
+    DWORD               offset;     /* offset of the text                   */
+    DWORD               size;       /* new size of the strings              */
+
+    /*------------------------------------------------------------------
+    Make room for the longest text kept, doubling the buffer.
+    ------------------------------------------------------------------*/
+    if( ( list->size - list->used ) < WINDOW_LIST_TEXT ) {
+        size = ( list->size == 0 )
+             ? ( LIST_MIN_WINDOWS * WINDOW_LIST_TEXT ) : ( 2 * list->size );
+        if( grow_array(
+                ( LPVOID* ) &( list->strings ),
+                ( size * sizeof( TCHAR ) )
+            ) == FALSE ) {
+            list->result = ERR_ALLOC;
+            return 0;
+        }
+        list->size = size;
+    }
+
+    /*------------------------------------------------------------------
+    Read the text in place.  Another process' title is read without
+    sending it a message, so a hung window can not stall the list.
+    ------------------------------------------------------------------*/
+    offset = list->used;
+    length = ( title != FALSE )
+        ? GetWindowText( window, ( list->strings + offset ), WINDOW_LIST_TEXT )
+        : GetClassName( window, ( list->strings + offset ), WINDOW_LIST_TEXT );
+    if( length < 0 ) {
+        length = 0;
+    }
+    list->strings[ offset + length ] = _T( '\0' );
+    list->used += length + 1;
+    return offset;
+}
+
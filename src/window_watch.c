@@ -0,0 +1,915 @@
+/*****************************************************************************
+
+window_watch.c
+
+Window Appearance Watching
+
+A launched program's window can only be positioned once it exists.  Rather
+than checking the window list over and over, this module is told about each
+window as it is shown, and matches it to the entries still waiting for one.
+Entries are kept in two hash tables: one by process ID, and one by image
+name.  A window is matched by the ID of the process that owns it first, and
+only when that fails (and some entry has an image), by the image of that
+process, which catches programs that hand off to another process.
+
+Windows that are shown before their entry is added (the program was quicker
+than its launcher) are kept for a little while, so adding an entry can match
+them right away.  When a process exits without showing a window, its entry
+waits a short while longer for a window from another process with the same
+image, and is then reported with no window.
+
+Events come from a source.  The usual source installs a window event hook on
+the calling thread, and waits on the thread's message queue along with the
+watched processes.  Processes are waited on through a wait multiplexer (see
+wait_mux.c), so any number of them can be watched in one wait.  Other
+sources (for example, a stand-in used to test the matching) can be passed in
+its place.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "window_watch.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define WATCH_FNV_BASIS     ( 2166136261UL )
+                                    /* FNV-1a offset basis                  */
+#define WATCH_FNV_PRIME     ( 16777619UL )
+                                    /* FNV-1a prime                         */
+#define WATCH_HOOKS         ( 16 )  /* most watches hooked at once          */
+#define WATCH_MIN_BUCKETS   ( 16 )  /* fewest buckets per table             */
+#define WATCH_NONE          ( ( DWORD ) -1 )
+                                    /* end of a bucket chain                */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct watch_hook_s {       /* installed event hook type            */
+    window_watch_type* volatile
+                        watch;      /* watch using the slot, or NULL        */
+    HWINEVENTHOOK       hook;       /* hook delivering to the watch         */
+} watch_hook_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+LPCTSTR base_name(                  /* find the file name part of a path    */
+    LPCTSTR             path        /* path or file name                    */
+);                                  /* returns start of the file name       */
+
+DWORD find_image(                   /* find the longest-waiting entry for   */
+                                    /* an image                             */
+    window_watch_type*  watch,      /* watch object                         */
+    LPCTSTR             image       /* image base name                      */
+);                                  /* returns tag, or WATCH_NONE           */
+
+DWORD hash_image(                   /* hash an image name, ignoring case    */
+    LPCTSTR             image       /* image base name                      */
+);                                  /* returns FNV-1a hash                  */
+
+void hook_close(                    /* remove the window event hook         */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch       /* watch being closed                   */
+);
+
+void CALLBACK hook_event(           /* receive a window event               */
+    HWINEVENTHOOK       hook,       /* hook that delivered the event        */
+    DWORD               event,      /* event type                           */
+    HWND                window,     /* window that generated the event      */
+    LONG                object,     /* object that generated the event      */
+    LONG                child,      /* child that generated the event       */
+    DWORD               thread,     /* thread that generated the event      */
+    DWORD               time        /* time of the event                    */
+);
+
+error_type hook_image(              /* query a process' image path          */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch,      /* watch asking                         */
+    DWORD               process_id, /* process ID                           */
+    LPTSTR              image,      /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+);                                  /* returns error code                   */
+
+error_type hook_open(               /* hook window events on this thread    */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch       /* watch to deliver to                  */
+);                                  /* returns error code                   */
+
+void hook_wait(                     /* wait on processes and the message    */
+                                    /* queue, and deliver events            */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch,      /* watch to deliver to                  */
+    DWORD               timeout     /* limit on the wait (ms), or INFINITE  */
+);
+
+void match_entry(                   /* report an entry as ready             */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               tag,        /* entry's tag                          */
+    HWND                window      /* matched window, or NULL              */
+);
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static const window_watch_source_type default_source = {
+    hook_open,
+    hook_wait,
+    hook_image,
+    hook_close,
+    NULL
+};                                  /* window event hooks on this thread    */
+
+static watch_hook_type hooks[ WATCH_HOOKS ];
+                                    /* watches receiving hooked events      */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+error_type window_watch_add(        /* wait for a process' window           */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               tag,        /* entry's tag (below the capacity)     */
+    DWORD               process_id, /* process that will show the window    */
+    HANDLE              process,    /* process handle, or NULL              */
+    LPCTSTR             image       /* program path or name, or NULL (kept  */
+                                    /* while the entry is pending)          */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bucket;     /* bucket index                         */
+    window_watch_entry_type*
+                        entry;      /* entry being added                    */
+    DWORD               i;          /* orphan index                         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.  Each tag is added once.
+    ------------------------------------------------------------------*/
+    if( ( watch == NULL ) || ( tag >= watch->capacity ) ) {
+        return ERR_USAGE;
+    }
+    entry = &( watch->entries[ tag ] );
+    if( entry->added != FALSE ) {
+        return ERR_USAGE;
+    }
+    entry->added = TRUE;
+
+    /*------------------------------------------------------------------
+    A window the process already showed matches right away.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < WINDOW_WATCH_ORPHANS; ++i ) {
+        if( ( watch->orphans[ i ].window != NULL )
+         && ( watch->orphans[ i ].process_id == process_id ) ) {
+            watch->ready[ watch->tail ]   = tag;
+            watch->windows[ watch->tail ] = watch->orphans[ i ].window;
+            watch->tail += 1;
+            watch->orphans[ i ].window = NULL;
+            return ERR_OK;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Chain the entry into its process ID bucket.
+    ------------------------------------------------------------------*/
+    entry->process_id = process_id;
+    entry->process    = process;
+    entry->pending    = TRUE;
+
+    /*------------------------------------------------------------------
+    Watch for the process to exit.  If that can not be done, the entry
+    is left to its caller's time limit.
+    ------------------------------------------------------------------*/
+    if( process != NULL ) {
+        wait_mux_add( &( watch->exits ), tag, process );
+    }
+    bucket            = ( process_id * WATCH_FNV_PRIME )
+                      & ( watch->bucket_count - 1 );
+    entry->next_id    = watch->id_buckets[ bucket ];
+    watch->id_buckets[ bucket ] = tag;
+
+    /*------------------------------------------------------------------
+    Chain the entry into its image name bucket.
+    ------------------------------------------------------------------*/
+    entry->next_image = WATCH_NONE;
+    if( ( image != NULL ) && ( *image != _T( '\0' ) ) ) {
+        entry->image      = base_name( image );
+        entry->image_hash = hash_image( entry->image );
+        bucket            = entry->image_hash & ( watch->bucket_count - 1 );
+        entry->next_image = watch->image_buckets[ bucket ];
+        watch->image_buckets[ bucket ] = tag;
+        watch->images    += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void window_watch_cancel(           /* stop waiting for an entry's window   */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               tag         /* entry's tag                          */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    window_watch_entry_type*
+                        entry;      /* entry being cancelled                */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( watch == NULL ) || ( tag >= watch->capacity ) ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    The entry stays in its chains, but is never matched again.
+    ------------------------------------------------------------------*/
+    entry = &( watch->entries[ tag ] );
+    if( entry->pending != FALSE ) {
+        entry->pending = FALSE;
+        if( entry->process != NULL ) {
+            wait_mux_remove( &( watch->exits ), tag );
+        }
+        if( entry->image != NULL ) {
+            watch->images -= 1;
+        }
+        if( entry->exited != FALSE ) {
+            watch->exiting -= 1;
+        }
+    }
+
+}
+
+
+/*==========================================================================*/
+void window_watch_close(            /* stop watching for windows            */
+    window_watch_type*  watch       /* watch object                         */
+) {
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( watch == NULL ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Stop the source, then release the tables.
+    ------------------------------------------------------------------*/
+    if( ( watch->source != NULL ) && ( watch->source->close != NULL ) ) {
+        watch->source->close( watch->source->context, watch );
+    }
+    wait_mux_close( &( watch->exits ) );
+    if( watch->wake != NULL ) {
+        CloseHandle( watch->wake );
+    }
+    if( watch->entries != NULL ) {
+        HeapFree( GetProcessHeap(), 0, ( LPVOID ) watch->entries );
+    }
+
+    /*------------------------------------------------------------------
+    Clear the watch object.
+    ------------------------------------------------------------------*/
+    memset( watch, 0, sizeof( window_watch_type ) );
+
+}
+
+
+/*==========================================================================*/
+void window_watch_exited(           /* report that a process exited         */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               process_id  /* process ID                           */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    window_watch_entry_type*
+                        entry;      /* entry being checked                  */
+    DWORD               tag;        /* entry's tag                          */
+
+    /*------------------------------------------------------------------
+    Give each of the process' entries a short while to be matched by
+    image.  An entry with no image can not be, so it is done now.
+    ------------------------------------------------------------------*/
+    tag = watch->id_buckets[
+        ( process_id * WATCH_FNV_PRIME ) & ( watch->bucket_count - 1 )
+    ];
+    for( ; tag != WATCH_NONE; tag = entry->next_id ) {
+        entry = &( watch->entries[ tag ] );
+        if( ( entry->pending == FALSE ) || ( entry->exited != FALSE )
+         || ( entry->process_id != process_id ) ) {
+            continue;
+        }
+        if( entry->image == NULL ) {
+            match_entry( watch, tag, NULL );
+            continue;
+        }
+        entry->exited   = TRUE;
+        entry->deadline = GetTickCount() + WINDOW_WATCH_HANDOFF;
+        watch->exiting += 1;
+    }
+
+}
+
+
+/*==========================================================================*/
+error_type window_watch_next(       /* wait for the next matched window     */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               timeout,    /* limit on the wait (ms), or INFINITE  */
+    DWORD*              tag,        /* returned entry's tag                 */
+    HWND*               window      /* returned window, or NULL if the      */
+                                    /* process exited without one           */
+) {                                 /* returns error code (ERR_TIMEOUT if   */
+                                    /* nothing matched, or it was woken)    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               elapsed;    /* time spent waiting                   */
+    window_watch_entry_type*
+                        entry;      /* entry being checked                  */
+    DWORD               exited;     /* tag of an exited process             */
+    DWORD               i;          /* entry index                          */
+    DWORD               now;        /* current tick count                   */
+    BOOL                started;    /* the source has waited once           */
+    DWORD               start;      /* tick count when the wait started     */
+    DWORD               wait;       /* time to let the source wait          */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( ( watch == NULL ) || ( tag == NULL ) || ( window == NULL ) ) {
+        return ERR_USAGE;
+    }
+
+    /*------------------------------------------------------------------
+    Let the source deliver events until an entry is ready.  The source
+    always runs once, so a zero timeout still takes in new events.
+    ------------------------------------------------------------------*/
+    start   = GetTickCount();
+    started = FALSE;
+    for( ; ; ) {
+        now     = GetTickCount();
+        elapsed = now - start;
+
+        /*--------------------------------------------------------------
+        Take in the processes that have exited.  Entries of exited
+        processes are done at their deadline.
+        --------------------------------------------------------------*/
+        while( wait_mux_next( &( watch->exits ), 0, &exited ) == ERR_OK ) {
+            window_watch_exited(
+                watch,
+                watch->entries[ exited ].process_id
+            );
+        }
+        wait = INFINITE;
+        if( timeout != INFINITE ) {
+            wait = ( elapsed < timeout ) ? ( timeout - elapsed ) : 0;
+        }
+        for( i = 0; ( watch->exiting > 0 ) && ( i < watch->capacity ); ++i ) {
+            entry = &( watch->entries[ i ] );
+            if( ( entry->pending == FALSE ) || ( entry->exited == FALSE ) ) {
+                continue;
+            }
+            if( ( LONG ) ( entry->deadline - now ) <= 0 ) {
+                match_entry( watch, i, NULL );
+            }
+            else if( wait > ( entry->deadline - now ) ) {
+                wait = entry->deadline - now;
+            }
+        }
+
+        /*--------------------------------------------------------------
+        Report the oldest ready entry.
+        --------------------------------------------------------------*/
+        if( watch->head < watch->tail ) {
+            *tag         = watch->ready[ watch->head ];
+            *window      = watch->windows[ watch->head ];
+            watch->head += 1;
+            return ERR_OK;
+        }
+
+        /*--------------------------------------------------------------
+        Give up once time is up, or when woken.
+        --------------------------------------------------------------*/
+        if( ( started != FALSE )
+         && ( ( InterlockedExchange( &( watch->woken ), 0 ) != 0 )
+           || ( ( timeout != INFINITE ) && ( elapsed >= timeout ) ) ) ) {
+            return ERR_TIMEOUT;
+        }
+        watch->source->wait( watch->source->context, watch, wait );
+        started = TRUE;
+    }
+}
+
+
+/*==========================================================================*/
+error_type window_watch_open(       /* start watching for windows           */
+    window_watch_type*  watch,      /* watch object to initialize           */
+    const window_watch_source_type*
+                        source,     /* event source, or NULL for window     */
+                                    /* event hooks on this thread           */
+    DWORD               capacity    /* number of entries (tags)             */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               buckets;    /* buckets per table                    */
+    LPBYTE              memory;     /* tables                               */
+    error_type          result;     /* result of opening the source         */
+
+    /*------------------------------------------------------------------
+    Check interface usage.
+    ------------------------------------------------------------------*/
+    if( watch == NULL ) {
+        return ERR_USAGE;
+    }
+    if( source == NULL ) {
+        source = &default_source;
+    }
+    if( ( source->wait == NULL ) || ( capacity == 0 ) ) {
+        return ERR_USAGE;
+    }
+    memset( watch, 0, sizeof( window_watch_type ) );
+
+    /*------------------------------------------------------------------
+    Keep each table at most half full, so chains stay short.
+    ------------------------------------------------------------------*/
+    buckets = WATCH_MIN_BUCKETS;
+    while( buckets < ( 2 * capacity ) ) {
+        buckets *= 2;
+    }
+
+    /*------------------------------------------------------------------
+    Allocate the entries, both tables, and the ready list at once.
+    ------------------------------------------------------------------*/
+    memory = ( LPBYTE ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( ( capacity * sizeof( window_watch_entry_type ) )
+          + ( 2 * buckets * sizeof( DWORD ) )
+          + ( capacity * ( sizeof( HWND ) + sizeof( DWORD ) ) ) )
+    );
+    if( memory == NULL ) {
+        return ERR_ALLOC;
+    }
+    watch->entries       = ( window_watch_entry_type* ) memory;
+    watch->windows       = ( HWND* ) ( watch->entries + capacity );
+    watch->id_buckets    = ( DWORD* ) ( watch->windows + capacity );
+    watch->image_buckets = watch->id_buckets + buckets;
+    watch->ready         = watch->image_buckets + buckets;
+    watch->bucket_count  = buckets;
+    watch->capacity      = capacity;
+    memset(
+        watch->id_buckets,
+        0xFF,
+        ( 2 * buckets * sizeof( DWORD ) )
+    );
+
+    /*------------------------------------------------------------------
+    Create the wake event and the process waits, and start the source.
+    ------------------------------------------------------------------*/
+    result = wait_mux_open( &( watch->exits ), capacity );
+    if( result != ERR_OK ) {
+        window_watch_close( watch );
+        return result;
+    }
+    watch->source = source;
+    watch->wake   = CreateEvent( NULL, FALSE, FALSE, NULL );
+    if( watch->wake == NULL ) {
+        watch->source = NULL;
+        window_watch_close( watch );
+        return ERR_WINAPI;
+    }
+    if( source->open != NULL ) {
+        result = source->open( source->context, watch );
+        if( result != ERR_OK ) {
+            watch->source = NULL;
+            window_watch_close( watch );
+            return result;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void window_watch_post(             /* report that a window was shown       */
+    window_watch_type*  watch,      /* watch object                         */
+    HWND                window,     /* top-level window                     */
+    DWORD               process_id  /* process that owns the window         */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    window_watch_entry_type*
+                        entry;      /* entry being checked                  */
+    TCHAR               image[ MAX_PATH ];
+                                    /* image path of the window's process   */
+    DWORD               tag;        /* entry's tag                          */
+
+    /*------------------------------------------------------------------
+    Match the window to an entry for its process.
+    ------------------------------------------------------------------*/
+    tag = watch->id_buckets[
+        ( process_id * WATCH_FNV_PRIME ) & ( watch->bucket_count - 1 )
+    ];
+    for( ; tag != WATCH_NONE; tag = entry->next_id ) {
+        entry = &( watch->entries[ tag ] );
+        if( ( entry->pending != FALSE )
+         && ( entry->process_id == process_id ) ) {
+            match_entry( watch, tag, window );
+            return;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Otherwise, match it to an entry for its process' image.  Processes
+    are only queried while some entry could match this way.
+    ------------------------------------------------------------------*/
+    if( ( watch->images > 0 ) && ( watch->source->image != NULL )
+     && ( watch->source->image(
+            watch->source->context,
+            watch,
+            process_id,
+            image,
+            MAX_PATH
+        ) == ERR_OK ) ) {
+        tag = find_image( watch, base_name( image ) );
+        if( tag != WATCH_NONE ) {
+            match_entry( watch, tag, window );
+            return;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Keep the window in case its entry has not been added yet.
+    ------------------------------------------------------------------*/
+    watch->orphans[ watch->orphan_next ].process_id = process_id;
+    watch->orphans[ watch->orphan_next ].window     = window;
+    watch->orphan_next = ( watch->orphan_next + 1 ) % WINDOW_WATCH_ORPHANS;
+
+}
+
+
+/*==========================================================================*/
+void window_watch_wake(             /* interrupt a wait from any thread     */
+    window_watch_type*  watch       /* watch object                         */
+) {
+
+    /*------------------------------------------------------------------
+    The flag tells the waiting thread why its wait ended.
+    ------------------------------------------------------------------*/
+    InterlockedExchange( &( watch->woken ), 1 );
+    SetEvent( watch->wake );
+
+}
+
+
+/*==========================================================================*/
+LPCTSTR base_name(                  /* find the file name part of a path    */
+    LPCTSTR             path        /* path or file name                    */
+) {                                 /* returns start of the file name       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             name;       /* start of the file name               */
+
+    /*------------------------------------------------------------------
+    The name starts after the last separator.
+    ------------------------------------------------------------------*/
+    for( name = path; *path != _T( '\0' ); ++path ) {
+        if( ( *path == _T( '\\' ) ) || ( *path == _T( '/' ) )
+         || ( *path == _T( ':' ) ) ) {
+            name = path + 1;
+        }
+    }
+    return name;
+}
+
+
+/*==========================================================================*/
+DWORD find_image(                   /* find the longest-waiting entry for   */
+                                    /* an image                             */
+    window_watch_type*  watch,      /* watch object                         */
+    LPCTSTR             image       /* image base name                      */
+) {                                 /* returns tag, or WATCH_NONE           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    window_watch_entry_type*
+                        entry;      /* entry being checked                  */
+    DWORD               found;      /* longest-waiting matching entry       */
+    DWORD               hash;       /* hash of image                        */
+    DWORD               tag;        /* entry's tag                          */
+
+    /*------------------------------------------------------------------
+    Chains are newest first, so the last match has waited longest.
+    ------------------------------------------------------------------*/
+    hash  = hash_image( image );
+    found = WATCH_NONE;
+    tag   = watch->image_buckets[ hash & ( watch->bucket_count - 1 ) ];
+    for( ; tag != WATCH_NONE; tag = entry->next_image ) {
+        entry = &( watch->entries[ tag ] );
+        if( ( entry->pending != FALSE ) && ( entry->image_hash == hash )
+         && ( _tcsicmp( entry->image, image ) == 0 ) ) {
+            found = tag;
+        }
+    }
+    return found;
+}
+
+
+/*==========================================================================*/
+DWORD hash_image(                   /* hash an image name, ignoring case    */
+    LPCTSTR             image       /* image base name                      */
+) {                                 /* returns FNV-1a hash                  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               hash;       /* running hash                         */
+
+    /*------------------------------------------------------------------
+    Hash each character's lower case value.
+    ------------------------------------------------------------------*/
+    hash = WATCH_FNV_BASIS;
+    for( ; *image != _T( '\0' ); ++image ) {
+        hash ^= ( DWORD ) ( _TUCHAR ) _totlower( *image );
+        hash *= WATCH_FNV_PRIME;
+    }
+    return hash;
+}
+
+
+/*==========================================================================*/
+void hook_close(                    /* remove the window event hook         */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch       /* watch being closed                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* hook slot index                      */
+
+    /*------------------------------------------------------------------
+    Remove the hook, then give up its slot.
+    ------------------------------------------------------------------*/
+    if( watch->hook != NULL ) {
+        UnhookWinEvent( watch->hook );
+    }
+    for( i = 0; i < WATCH_HOOKS; ++i ) {
+        if( hooks[ i ].watch == watch ) {
+            hooks[ i ].hook = NULL;
+            InterlockedExchangePointer(
+                ( PVOID volatile* ) &( hooks[ i ].watch ),
+                NULL
+            );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the process query instance, if it was ever needed.
+    ------------------------------------------------------------------*/
+    if( watch->instance_ready != FALSE ) {
+        proc_term( &( watch->instance ) );
+    }
+
+}
+
+
+/*==========================================================================*/
+void CALLBACK hook_event(           /* receive a window event               */
+    HWINEVENTHOOK       hook,       /* hook that delivered the event        */
+    DWORD               event,      /* event type                           */
+    HWND                window,     /* window that generated the event      */
+    LONG                object,     /* object that generated the event      */
+    LONG                child,      /* child that generated the event       */
+    DWORD               thread,     /* thread that generated the event      */
+    DWORD               time        /* time of the event                    */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* hook slot index                      */
+    DWORD               process_id; /* process that owns the window         */
+
+    /*------------------------------------------------------------------
+    Only unowned top-level windows are launched windows.
+    ------------------------------------------------------------------*/
+    if( ( window == NULL ) || ( object != OBJID_WINDOW )
+     || ( child != CHILDID_SELF )
+     || ( GetAncestor( window, GA_ROOT ) != window )
+     || ( GetWindow( window, GW_OWNER ) != NULL ) ) {
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Pass the window to the watch that installed the hook.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < WATCH_HOOKS; ++i ) {
+        if( ( hooks[ i ].hook == hook ) && ( hooks[ i ].watch != NULL ) ) {
+            GetWindowThreadProcessId( window, &process_id );
+            window_watch_post( hooks[ i ].watch, window, process_id );
+            return;
+        }
+    }
+
+}
+
+
+/*==========================================================================*/
+error_type hook_image(              /* query a process' image path          */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch,      /* watch asking                         */
+    DWORD               process_id, /* process ID                           */
+    LPTSTR              image,      /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_info_type      info;       /* process information object           */
+    error_type          result;     /* result of querying the process       */
+
+    /*------------------------------------------------------------------
+    The process query instance is only set up when first needed.
+    ------------------------------------------------------------------*/
+    if( watch->instance_ready == FALSE ) {
+        result = proc_init( &( watch->instance ) );
+        if( result != ERR_OK ) {
+            return result;
+        }
+        watch->instance_ready = TRUE;
+    }
+
+    /*------------------------------------------------------------------
+    Query the process' image name.
+    ------------------------------------------------------------------*/
+    result = proc_open( &( watch->instance ), &info, process_id );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    result = proc_query( &info, PROC_FIELD_IMAGE );
+    if( ( result == ERR_OK ) && ( _tcslen( info.image ) >= size ) ) {
+        result = ERR_OVERFLOW;
+    }
+    if( result == ERR_OK ) {
+        _tcscpy( image, info.image );
+    }
+    proc_close( &info );
+
+    /*------------------------------------------------------------------
+    Return the result of the query.
+    ------------------------------------------------------------------*/
+    return result;
+}
+
+
+/*==========================================================================*/
+error_type hook_open(               /* hook window events on this thread    */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch       /* watch to deliver to                  */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* hook slot index                      */
+
+    /*------------------------------------------------------------------
+    Claim a slot, so the hook's events can find their watch.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < WATCH_HOOKS; ++i ) {
+        if( InterlockedCompareExchangePointer(
+                ( PVOID volatile* ) &( hooks[ i ].watch ),
+                ( PVOID ) watch,
+                NULL
+            ) == NULL ) {
+            break;
+        }
+    }
+    if( i == WATCH_HOOKS ) {
+        return ERR_OVERFLOW;
+    }
+
+    /*------------------------------------------------------------------
+    Hook windows being shown.  Events are delivered on this thread
+    while it reads its message queue.
+    ------------------------------------------------------------------*/
+    watch->hook = SetWinEventHook(
+        EVENT_OBJECT_SHOW,
+        EVENT_OBJECT_SHOW,
+        NULL,
+        hook_event,
+        0,
+        0,
+        ( WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS )
+    );
+    if( watch->hook == NULL ) {
+        InterlockedExchangePointer(
+            ( PVOID volatile* ) &( hooks[ i ].watch ),
+            NULL
+        );
+        return ERR_WINAPI;
+    }
+    hooks[ i ].hook = watch->hook;
+
+    /*------------------------------------------------------------------
+    Return success.
+    ------------------------------------------------------------------*/
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void hook_wait(                     /* wait on processes and the message    */
+                                    /* queue, and deliver events            */
+    LPVOID              context,    /* unused                               */
+    window_watch_type*  watch,      /* watch to deliver to                  */
+    DWORD               timeout     /* limit on the wait (ms), or INFINITE  */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              handles[ 2 ];
+                                    /* wake event and process exits         */
+    MSG                 message;    /* message from the queue               */
+
+    /*------------------------------------------------------------------
+    Wake for an exited process, or for anything in the message queue.
+    The exits are taken in by the caller.
+    ------------------------------------------------------------------*/
+    handles[ 0 ] = watch->wake;
+    handles[ 1 ] = watch->exits.ready;
+    MsgWaitForMultipleObjectsEx(
+        2,
+        handles,
+        timeout,
+        QS_ALLINPUT,
+        MWMO_INPUTAVAILABLE
+    );
+
+    /*------------------------------------------------------------------
+    Reading the queue delivers the hooked events.
+    ------------------------------------------------------------------*/
+    while( PeekMessage( &message, NULL, 0, 0, PM_REMOVE ) ) {
+        TranslateMessage( &message );
+        DispatchMessage( &message );
+    }
+
+}
+
+
+/*==========================================================================*/
+void match_entry(                   /* report an entry as ready             */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               tag,        /* entry's tag                          */
+    HWND                window      /* matched window, or NULL              */
+) {
+
+    /*------------------------------------------------------------------
+    Take the entry out of the running, and queue it for the caller.
+    Each entry is queued once, so the ready list never wraps.
+    ------------------------------------------------------------------*/
+    window_watch_cancel( watch, tag );
+    watch->ready[ watch->tail ]   = tag;
+    watch->windows[ watch->tail ] = window;
+    watch->tail += 1;
+
+}
@@ -0,0 +1,612 @@
+/*****************************************************************************
+
+config_glob_test.c
+
+Session Name Globbing Tests
+
+Every selection is checked against a naive backtracking matcher: for each
+pattern in turn, every name it matches that no earlier pattern took is
+selected, in name order.  The name tables are built directly, sorted the
+way config_glob_init sorts them, so no configuration file is needed.  A
+few hand-picked patterns cover plain names, whole ranges, runs of stars,
+"?", and trailing stars; random patterns over a small alphabet then cover
+the shared-prefix ranges, and long patterns cover automatons of more than
+one word of states.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_glob.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define GLOB_TEST_NAMES     ( 400 ) /* most names in a table                */
+
+#define GLOB_TEST_LENGTH    ( 128 ) /* most characters in a name or pattern */
+
+#define GLOB_TEST_PATTERNS  ( 6 )   /* most patterns in one selection       */
+
+#define GLOB_TEST_ROUNDS    ( 3000 )/* random selections                    */
+
+#define GLOB_TEST_LONG      ( 300 ) /* selections with long patterns        */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static LPCTSTR glob_fixed_names[] = {
+    _T( "a" ),        _T( "ab" ),       _T( "abc" ),      _T( "abcabc" ),
+    _T( "acc" ),      _T( "b" ),        _T( "ba" ),       _T( "bab" ),
+    _T( "dev" ),      _T( "dev-db" ),   _T( "dev-web" ),  _T( "prod-db" ),
+    _T( "prod-web" ), _T( "web" ),      _T( "web-dev" ),  _T( "ab" )
+};                                  /* hand-picked names (one repeated)     */
+
+static LPCTSTR glob_fixed_patterns[] = {
+    _T( "a" ),        _T( "ab" ),       _T( "zzz" ),      _T( "" ),
+    _T( "a*" ),       _T( "dev*" ),     _T( "*" ),        _T( "**" ),
+    _T( "ab***" ),    _T( "***b" ),     _T( "a**c" ),     _T( "*b" ),
+    _T( "*b*" ),      _T( "?" ),        _T( "??" ),       _T( "???" ),
+    _T( "?b*" ),      _T( "a?c*" ),     _T( "*-web" ),    _T( "*-*" ),
+    _T( "abc*abc" ),  _T( "a*b*c" ),    _T( "*z" ),       _T( "abcabc*" ),
+    _T( "*c" ),       _T( "a*c*" ),     _T( "*?" ),       _T( "?*?*?" ),
+    _T( "d*-?e*" ),   _T( "*dev" ),     _T( "*a*b*c*" ),  _T( "web?*" )
+};                                  /* hand-picked patterns                 */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static DWORD glob_seed;             /* random number state                  */
+
+static TCHAR glob_text[ GLOB_TEST_NAMES ][ GLOB_TEST_LENGTH ];
+                                    /* text of the table's names            */
+
+static config_glob_name_type glob_names[ GLOB_TEST_NAMES ];
+                                    /* the table's sorted names             */
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL check_select(                  /* compare a selection with the naive   */
+                                    /* matcher                              */
+    config_glob_type*   glob,       /* session name table                   */
+    LPCTSTR*            patterns,   /* patterns to select with              */
+    DWORD               pattern_count
+                                    /* number of patterns                   */
+);                                  /* returns TRUE if they agree           */
+
+void make_table(                    /* sort the names into a table          */
+    config_glob_type*   glob,       /* table to fill                        */
+    DWORD               count       /* number of names in glob_text         */
+);
+
+BOOL naive_match(                   /* match a name by backtracking         */
+    LPCTSTR             pattern,    /* pattern using * and ?                */
+    LPCTSTR             name        /* name to match                        */
+);                                  /* returns TRUE if the name matches     */
+
+DWORD next_random(                  /* get a random number below a limit    */
+    DWORD               limit       /* one past the largest number          */
+);                                  /* returns random number                */
+
+void random_text(                   /* write random characters              */
+    LPTSTR              text,       /* destination string                   */
+    DWORD               length,     /* number of characters                 */
+    LPCTSTR             alphabet    /* characters to choose from            */
+);
+
+void test_fixed(                    /* check the hand-picked patterns       */
+    void
+);
+
+void test_long(                     /* check patterns of many states        */
+    void
+);
+
+void test_random(                   /* check random patterns                */
+    void
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* returned number of sessions          */
+    config_glob_type    glob;       /* session name table                   */
+    DWORD               index;      /* returned session index               */
+    LPCTSTR             pattern;    /* pattern to select with               */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked.  An empty table or an empty list of
+    patterns selects nothing.
+    ------------------------------------------------------------------*/
+    _tcscpy( glob_text[ 0 ], _T( "a" ) );
+    make_table( &glob, 1 );
+    pattern = _T( "*" );
+    TEST_CHECK( config_glob_match( NULL, &pattern, 1, &index, &count, NULL )
+                == ERR_USAGE );
+    TEST_CHECK( config_glob_match( &glob, NULL, 1, &index, &count, NULL )
+                == ERR_USAGE );
+    TEST_CHECK( config_glob_match( &glob, &pattern, 1, NULL, &count, NULL )
+                == ERR_USAGE );
+    TEST_CHECK( config_glob_match( &glob, &pattern, 1, &index, NULL, NULL )
+                == ERR_USAGE );
+    TEST_CHECK( config_glob_match( &glob, &pattern, 0, &index, &count, NULL )
+                == ERR_OK );
+    TEST_CHECK( count == 0 );
+    glob.count = 0;
+    TEST_CHECK( config_glob_match( &glob, &pattern, 1, &index, &count, NULL )
+                == ERR_OK );
+    TEST_CHECK( count == 0 );
+
+    /*------------------------------------------------------------------
+    Run each group of checks.
+    ------------------------------------------------------------------*/
+    test_fixed();
+    test_random();
+    test_long();
+    return test_result( "config_glob_test" );
+}
+
+
+/*==========================================================================*/
+BOOL check_select(                  /* compare a selection with the naive   */
+                                    /* matcher                              */
+    config_glob_type*   glob,       /* session name table                   */
+    LPCTSTR*            patterns,   /* patterns to select with              */
+    DWORD               pattern_count
+                                    /* number of patterns                   */
+) {                                 /* returns TRUE if they agree           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* returned number of sessions          */
+    DWORD               expected[ GLOB_TEST_NAMES ];
+                                    /* sessions the naive matcher selects   */
+    DWORD               expected_count;
+                                    /* number of expected sessions          */
+    BOOL                expected_matched[ GLOB_TEST_PATTERNS ];
+                                    /* patterns the naive matcher matched   */
+    DWORD               i;          /* pattern index                        */
+    DWORD               indices[ GLOB_TEST_NAMES ];
+                                    /* returned session indices             */
+    BOOL                matched[ GLOB_TEST_PATTERNS ];
+                                    /* returned per-pattern match flags     */
+    BOOL                passed;     /* the selections agree                 */
+    DWORD               r;          /* table position                       */
+    BOOL                taken[ GLOB_TEST_NAMES ];
+                                    /* an earlier pattern took the name     */
+
+    /*------------------------------------------------------------------
+    Each pattern takes the names it matches that are still free, in
+    name order.
+    ------------------------------------------------------------------*/
+    memset( taken, 0, sizeof( taken ) );
+    expected_count = 0;
+    for( i = 0; i < pattern_count; ++i ) {
+        expected_matched[ i ] = FALSE;
+        for( r = 0; r < glob->count; ++r ) {
+            if( naive_match( patterns[ i ], glob->names[ r ].name )
+                == FALSE ) {
+                continue;
+            }
+            expected_matched[ i ] = TRUE;
+            if( taken[ r ] == FALSE ) {
+                taken[ r ] = TRUE;
+                expected[ expected_count ] = glob->names[ r ].index;
+                expected_count += 1;
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The engine must select the same sessions in the same order, and
+    flag the same patterns.
+    ------------------------------------------------------------------*/
+    passed = TEST_CHECK( config_glob_match(
+        glob,
+        patterns,
+        pattern_count,
+        indices,
+        &count,
+        matched
+    ) == ERR_OK );
+    passed = passed && TEST_CHECK( count == expected_count );
+    passed = passed && TEST_CHECK(
+        memcmp( indices, expected, ( count * sizeof( DWORD ) ) ) == 0
+    );
+    passed = passed && TEST_CHECK( memcmp(
+        matched,
+        expected_matched,
+        ( pattern_count * sizeof( BOOL ) )
+    ) == 0 );
+    if( passed == FALSE ) {
+        for( i = 0; i < pattern_count; ++i ) {
+            _tprintf(
+                _T( "  pattern %lu: \"%s\"\n" ),
+                ( unsigned long ) i,
+                patterns[ i ]
+            );
+        }
+    }
+    return passed;
+}
+
+
+/*==========================================================================*/
+void make_table(                    /* sort the names into a table          */
+    config_glob_type*   glob,       /* table to fill                        */
+    DWORD               count       /* number of names in glob_text         */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* name index                           */
+    DWORD               kept;       /* number of distinct names             */
+
+    /*------------------------------------------------------------------
+    Sort the names, and keep only the first session of a repeated name,
+    as config_glob_init does.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < count; ++i ) {
+        glob_names[ i ].name  = glob_text[ i ];
+        glob_names[ i ].index = i;
+    }
+    qsort(
+        glob_names,
+        count,
+        sizeof( config_glob_name_type ),
+        config_glob_compare
+    );
+    kept = 0;
+    for( i = 0; i < count; ++i ) {
+        if( ( kept == 0 ) || ( _tcscmp(
+            glob_names[ i ].name,
+            glob_names[ kept - 1 ].name
+        ) != 0 ) ) {
+            glob_names[ kept ] = glob_names[ i ];
+            kept += 1;
+        }
+    }
+    glob->count = kept;
+    glob->names = glob_names;
+    glob->block = NULL;
+
+}
+
+
+/*==========================================================================*/
+BOOL naive_match(                   /* match a name by backtracking         */
+    LPCTSTR             pattern,    /* pattern using * and ?                */
+    LPCTSTR             name        /* name to match                        */
+) {                                 /* returns TRUE if the name matches     */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR             mark;       /* name position the star resumes from  */
+    LPCTSTR             star;       /* last star passed, or NULL            */
+
+    /*------------------------------------------------------------------
+    Match characters one at a time.  On a mismatch, go back to the last
+    star and let it take one more character.
+    ------------------------------------------------------------------*/
+    mark = name;
+    star = NULL;
+    while( *name != _T( '\0' ) ) {
+        if( *pattern == _T( '*' ) ) {
+            star     = pattern;
+            pattern += 1;
+            mark     = name;
+        }
+        else if( ( *pattern != _T( '\0' ) )
+              && ( ( *pattern == _T( '?' ) ) || ( *pattern == *name ) ) ) {
+            pattern += 1;
+            name    += 1;
+        }
+        else if( star != NULL ) {
+            pattern = star + 1;
+            mark   += 1;
+            name    = mark;
+        }
+        else {
+            return FALSE;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Only stars may be left in the pattern.
+    ------------------------------------------------------------------*/
+    while( *pattern == _T( '*' ) ) {
+        pattern += 1;
+    }
+    return ( *pattern == _T( '\0' ) ) ? TRUE : FALSE;
+}
+
+
+/*==========================================================================*/
+DWORD next_random(                  /* get a random number below a limit    */
+    DWORD               limit       /* one past the largest number          */
+) {                                 /* returns random number                */
+
+    /*------------------------------------------------------------------
+    The same sequence runs every time.
+    ------------------------------------------------------------------*/
+    glob_seed = ( glob_seed * 1103515245 ) + 12345;
+    return ( glob_seed >> 16 ) % limit;
+}
+
+
+/*==========================================================================*/
+void random_text(                   /* write random characters              */
+    LPTSTR              text,       /* destination string                   */
+    DWORD               length,     /* number of characters                 */
+    LPCTSTR             alphabet    /* characters to choose from            */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* character index                      */
+    DWORD               size;       /* number of characters to choose from  */
+
+    /*------------------------------------------------------------------
+    Fill the string, and terminate it.
+    ------------------------------------------------------------------*/
+    size = _tcslen( alphabet );
+    for( i = 0; i < length; ++i ) {
+        text[ i ] = alphabet[ next_random( size ) ];
+    }
+    text[ length ] = _T( '\0' );
+
+}
+
+
+/*==========================================================================*/
+void test_fixed(                    /* check the hand-picked patterns       */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* returned number of sessions          */
+    config_glob_type    glob;       /* session name table                   */
+    DWORD               i;          /* pattern index                        */
+    DWORD               indices[ GLOB_TEST_NAMES ];
+                                    /* returned session indices             */
+    DWORD               k;          /* second pattern index                 */
+    LPCTSTR             pair[ 2 ];  /* two patterns selected together       */
+    DWORD               pattern_count;
+                                    /* number of hand-picked patterns       */
+
+    /*------------------------------------------------------------------
+    Build the table from the hand-picked names.
+    ------------------------------------------------------------------*/
+    pattern_count = sizeof( glob_fixed_patterns ) / sizeof( LPCTSTR );
+    for( i = 0; i < ( sizeof( glob_fixed_names ) / sizeof( LPCTSTR ) );
+         ++i ) {
+        _tcscpy( glob_text[ i ], glob_fixed_names[ i ] );
+    }
+    make_table( &glob, i );
+    TEST_CHECK( glob.count == ( i - 1 ) );
+
+    /*------------------------------------------------------------------
+    A few answers are spelled out, so the naive matcher is checked too.
+    A repeated name selects its first session.
+    ------------------------------------------------------------------*/
+    pair[ 0 ] = _T( "ab" );
+    TEST_CHECK( config_glob_match( &glob, pair, 1, indices, &count, NULL )
+                == ERR_OK );
+    TEST_CHECK( ( count == 1 ) && ( indices[ 0 ] == 1 ) );
+    pair[ 0 ] = _T( "*-web" );
+    pair[ 1 ] = _T( "prod*" );
+    TEST_CHECK( config_glob_match( &glob, pair, 2, indices, &count, NULL )
+                == ERR_OK );
+    TEST_CHECK( ( count == 3 ) && ( indices[ 0 ] == 10 )
+             && ( indices[ 1 ] == 12 ) && ( indices[ 2 ] == 11 ) );
+    pair[ 0 ] = _T( "a**c" );
+    TEST_CHECK( config_glob_match( &glob, pair, 1, indices, &count, NULL )
+                == ERR_OK );
+    TEST_CHECK( ( count == 3 ) && ( indices[ 0 ] == 2 )
+             && ( indices[ 1 ] == 3 ) && ( indices[ 2 ] == 4 ) );
+
+    /*------------------------------------------------------------------
+    Check each pattern alone, every pair in both orders, and runs of
+    several patterns at once.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < pattern_count; ++i ) {
+        check_select( &glob, &glob_fixed_patterns[ i ], 1 );
+        for( k = 0; k < pattern_count; ++k ) {
+            pair[ 0 ] = glob_fixed_patterns[ i ];
+            pair[ 1 ] = glob_fixed_patterns[ k ];
+            check_select( &glob, pair, 2 );
+        }
+    }
+    for( i = 0; ( i + GLOB_TEST_PATTERNS ) <= pattern_count; ++i ) {
+        check_select( &glob, &glob_fixed_patterns[ i ], GLOB_TEST_PATTERNS );
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_long(                     /* check patterns of many states        */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_glob_type    glob;       /* session name table                   */
+    DWORD               i;          /* name or pattern index                */
+    DWORD               k;          /* character index                      */
+    DWORD               length;     /* length of a pattern                  */
+    DWORD               n;          /* selection index                      */
+    LPCTSTR             patterns[ GLOB_TEST_PATTERNS ];
+                                    /* patterns of a selection              */
+    TCHAR               text[ GLOB_TEST_PATTERNS ][ GLOB_TEST_LENGTH ];
+                                    /* text of the patterns                 */
+    LPCTSTR             source;     /* name a pattern is made from          */
+
+    /*------------------------------------------------------------------
+    Long names over two characters, many sharing long prefixes.
+    ------------------------------------------------------------------*/
+    glob_seed = 7;
+    for( i = 0; i < GLOB_TEST_NAMES; ++i ) {
+        length = 40 + next_random( 60 );
+        if( ( i > 0 ) && ( next_random( 2 ) == 0 ) ) {
+            k = next_random(
+                min( length, ( DWORD ) _tcslen( glob_text[ i - 1 ] ) )
+            );
+            _tcsncpy( glob_text[ i ], glob_text[ i - 1 ], k );
+            random_text( ( glob_text[ i ] + k ), ( length - k ), _T( "ab" ) );
+        }
+        else {
+            random_text( glob_text[ i ], length, _T( "ab" ) );
+        }
+    }
+    make_table( &glob, GLOB_TEST_NAMES );
+
+    /*------------------------------------------------------------------
+    Each pattern is made from one of the names, with characters turned
+    into "?" and runs of characters into stars, so the patterns have
+    from 32 to over a hundred states and still match some names.  Some
+    selections mix in a short pattern.
+    ------------------------------------------------------------------*/
+    for( n = 0; n < GLOB_TEST_LONG; ++n ) {
+        for( i = 0; i < GLOB_TEST_PATTERNS; ++i ) {
+            source = glob.names[ next_random( glob.count ) ].name;
+            length = 0;
+            while( ( *source != _T( '\0' ) )
+                && ( length < ( GLOB_TEST_LENGTH - 3 ) ) ) {
+                switch( next_random( 12 ) ) {
+                    case 0:
+                        text[ i ][ length++ ] = _T( '?' );
+                        source += 1;
+                        break;
+                    case 1:
+                        text[ i ][ length++ ] = _T( '*' );
+                        for( k = next_random( 4 );
+                             ( k > 0 ) && ( *source != _T( '\0' ) ); --k ) {
+                            source += 1;
+                        }
+                        break;
+                    case 2:
+                        text[ i ][ length++ ] = _T( '*' );
+                        text[ i ][ length++ ] = _T( '*' );
+                        break;
+                    default:
+                        text[ i ][ length++ ] = *source;
+                        source += 1;
+                        break;
+                }
+            }
+            if( next_random( 4 ) == 0 ) {
+                text[ i ][ length++ ] = _T( '*' );
+            }
+            text[ i ][ length ] = _T( '\0' );
+            if( ( i == 0 ) && ( next_random( 3 ) == 0 ) ) {
+                _tcscpy( text[ i ], _T( "*ab?a*" ) );
+            }
+            patterns[ i ] = text[ i ];
+        }
+        if( check_select(
+                &glob,
+                patterns,
+                ( 1 + next_random( GLOB_TEST_PATTERNS ) )
+            ) == FALSE ) {
+            break;
+        }
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_random(                   /* check random patterns                */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_glob_type    glob;       /* session name table                   */
+    DWORD               i;          /* name or pattern index                */
+    DWORD               n;          /* selection index                      */
+    LPCTSTR             patterns[ GLOB_TEST_PATTERNS ];
+                                    /* patterns of a selection              */
+    TCHAR               text[ GLOB_TEST_PATTERNS ][ 16 ];
+                                    /* text of the patterns                 */
+
+    /*------------------------------------------------------------------
+    Short names over three characters share many prefixes.  Patterns
+    are drawn from the same characters and both wildcards, some with a
+    literal prefix, so every kind of range is used.  The table changes
+    every hundred selections.
+    ------------------------------------------------------------------*/
+    glob_seed = 1;
+    for( n = 0; n < GLOB_TEST_ROUNDS; ++n ) {
+        if( ( n % 100 ) == 0 ) {
+            for( i = 0; i < GLOB_TEST_NAMES; ++i ) {
+                random_text(
+                    glob_text[ i ],
+                    ( 1 + next_random( 8 ) ),
+                    _T( "abc" )
+                );
+            }
+            make_table( &glob, ( 1 + next_random( GLOB_TEST_NAMES ) ) );
+        }
+        for( i = 0; i < GLOB_TEST_PATTERNS; ++i ) {
+            if( next_random( 3 ) == 0 ) {
+                random_text( text[ i ], next_random( 3 ), _T( "abc" ) );
+                random_text(
+                    ( text[ i ] + _tcslen( text[ i ] ) ),
+                    next_random( 6 ),
+                    _T( "abc*?" )
+                );
+            }
+            else {
+                random_text( text[ i ], next_random( 9 ), _T( "ab*?" ) );
+            }
+            patterns[ i ] = text[ i ];
+        }
+        if( check_select(
+                &glob,
+                patterns,
+                ( 1 + next_random( GLOB_TEST_PATTERNS ) )
+            ) == FALSE ) {
+            break;
+        }
+    }
+
+}
+
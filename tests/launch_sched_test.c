@@ -0,0 +1,805 @@
+/*****************************************************************************
+
+launch_sched_test.c
+
+Session Launch Scheduler Tests
+
+The scheduler is run with a simulated backend.  Starting a program takes a
+set time on the worker that starts it, and its window is shown a set time
+later by a stand-in event source on the watching thread.  Random sessions
+(with random "after" lists, waits, rectangles, and failing programs) check
+that every window starts once, never before the windows it starts after
+are released, and is placed with its own window, and that no more workers
+start programs at once than were asked for.  Smaller sessions check the
+ordering errors, and that a window that never appears, or whose program
+fails, does not hold up later windows.  Last, a session of independent
+windows must start several times faster on eight workers than on one,
+while a chain of windows must not start any faster.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "launch_sched.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define SIM_LIMIT           ( 32 )  /* most windows in a session            */
+
+#define SIM_NAME_SIZE       ( 8 )   /* longest window name, with its NUL    */
+
+#define SIM_SESSIONS        ( 40 )  /* random sessions launched             */
+
+#define SIM_LAUNCH          ( 20 )  /* time to start each program in the    */
+                                    /* timed sessions (ms)                  */
+
+#define SIM_TIMED           ( 16 )  /* windows in the timed sessions        */
+
+#define SIM_PROCESS( _index ) \
+    ( 100 + ( 4 * ( DWORD ) ( _index ) ) )
+                                    /* process ID of a window's program     */
+
+#define SIM_WINDOW( _index ) \
+    ( ( HWND ) ( ULONG_PTR ) ( 0x1000 + ( _index ) ) )
+                                    /* handle of a window                   */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct sim_state_s {        /* simulated backend state type         */
+    config_session_type*
+                        session;    /* session being launched               */
+    window_watch_type*  watch;      /* watch the windows are shown to       */
+    DWORD               launch[ SIM_LIMIT ];
+                                    /* time each start takes (ms)           */
+    DWORD               appear[ SIM_LIMIT ];
+                                    /* time from a start to its window      */
+                                    /* (ms), or INFINITE                    */
+    BOOL                failing[ SIM_LIMIT ];
+                                    /* starting the program fails           */
+    BOOL                scheduled[ SIM_LIMIT ];
+                                    /* the window will be shown             */
+    DWORD               due[ SIM_LIMIT ];
+                                    /* tick count the window is shown       */
+    BOOL                shown[ SIM_LIMIT ];
+                                    /* the window has been shown            */
+    volatile LONG       released[ SIM_LIMIT ];
+                                    /* later windows may start              */
+    volatile LONG       started[ SIM_LIMIT ];
+                                    /* times each program was started       */
+    volatile LONG       placed[ SIM_LIMIT ];
+                                    /* times each window was placed         */
+    volatile LONG       active;     /* programs being started now           */
+    volatile LONG       most;       /* most programs started at once        */
+    volatile LONG       early;      /* programs started before a window     */
+                                    /* they start after was released        */
+    volatile LONG       misplaced;  /* windows placed with another handle   */
+    TCHAR               names[ SIM_LIMIT ][ SIM_NAME_SIZE ];
+                                    /* window names                         */
+    TCHAR               after[ SIM_LIMIT ][ SIM_LIMIT * SIM_NAME_SIZE ];
+                                    /* "after" lists                        */
+    DWORD               after_size[ SIM_LIMIT ];
+                                    /* length of each list (characters)     */
+} sim_state_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+void sim_after(                     /* start a window after another         */
+    DWORD               index,      /* window that starts later             */
+    DWORD               other       /* window it starts after               */
+);
+
+error_type sim_open(                /* note the watch to show windows to    */
+    LPVOID              context,    /* simulated backend state              */
+    window_watch_type*  watch       /* watch to deliver to                  */
+);                                  /* returns error code                   */
+
+error_type sim_place(               /* count a window placed                */
+    LPVOID              context,    /* simulated backend state              */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item with the window that appeared   */
+);                                  /* returns error code                   */
+
+config_session_type* sim_session(   /* create a session, and reset the      */
+                                    /* simulation                           */
+    DWORD               count       /* number of windows                    */
+);                                  /* returns session, or NULL             */
+
+error_type sim_start(               /* start a window's simulated program   */
+    LPVOID              context,    /* simulated backend state              */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item to fill with the process        */
+);                                  /* returns error code                   */
+
+DWORD sim_time(                     /* time launching a timed session       */
+    DWORD               workers,    /* worker threads                       */
+    BOOL                chain       /* each window starts after the one     */
+                                    /* before it                            */
+);                                  /* returns time taken (ms)              */
+
+void sim_wait(                      /* show windows that are due            */
+    LPVOID              context,    /* simulated backend state              */
+    window_watch_type*  watch,      /* watch to deliver to                  */
+    DWORD               timeout     /* limit on the wait (ms), or INFINITE  */
+);
+
+void test_failure(                  /* check windows that never appear      */
+    void
+);
+
+void test_graph(                    /* check ordering errors                */
+    void
+);
+
+void test_random(                   /* check random sessions                */
+    void
+);
+
+void test_speedup(                  /* check the time taken with workers    */
+    void
+);
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static sim_state_type sim;          /* simulated backend state              */
+
+static CRITICAL_SECTION sim_lock;   /* protects the windows' schedule       */
+
+static const window_watch_source_type sim_source = {
+    sim_open,
+    sim_wait,
+    NULL,
+    NULL,
+    &sim
+};                                  /* shows the simulated windows          */
+
+static const launch_sched_backend_type sim_backend = {
+    sim_start,
+    sim_place,
+    NULL,
+    &sim_source,
+    &sim
+};                                  /* starts the simulated programs        */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    launch_sched_backend_type
+                        backend;    /* backend without a start function     */
+    launch_sched_type   launch;     /* launch object                        */
+    config_session_type*
+                        session;    /* empty session                        */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked, and an empty session starts nothing.
+    ------------------------------------------------------------------*/
+    InitializeCriticalSection( &sim_lock );
+    session = sim_session( 0 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return test_result( "launch_sched_test" );
+    }
+    backend       = sim_backend;
+    backend.start = NULL;
+    TEST_CHECK( launch_sched_run( NULL, &sim_backend, NULL, 1, INFINITE,
+        &launch ) == ERR_USAGE );
+    TEST_CHECK( launch_sched_run( session, &sim_backend, NULL, 1, INFINITE,
+        NULL ) == ERR_USAGE );
+    TEST_CHECK( launch_sched_run( session, &backend, NULL, 1, INFINITE,
+        &launch ) == ERR_USAGE );
+    TEST_CHECK( launch_sched_run( session, &sim_backend, NULL, 1, INFINITE,
+        &launch ) == ERR_OK );
+    TEST_CHECK( launch.count == 0 );
+    launch_sched_free( &launch );
+    HeapFree( GetProcessHeap(), 0, session );
+
+    /*------------------------------------------------------------------
+    Run each group of checks.
+    ------------------------------------------------------------------*/
+    test_graph();
+    test_random();
+    test_failure();
+    test_speedup();
+    DeleteCriticalSection( &sim_lock );
+    return test_result( "launch_sched_test" );
+}
+
+
+/*==========================================================================*/
+void sim_after(                     /* start a window after another         */
+    DWORD               index,      /* window that starts later             */
+    DWORD               other       /* window it starts after               */
+) {
+
+    /*------------------------------------------------------------------
+    Add the name to the double-NUL terminated list.
+    ------------------------------------------------------------------*/
+    _tcscpy(
+        ( sim.after[ index ] + sim.after_size[ index ] ),
+        sim.names[ other ]
+    );
+    sim.after_size[ index ] += ( DWORD ) _tcslen( sim.names[ other ] ) + 1;
+    sim.session->windows[ index ].after        = sim.after[ index ];
+    sim.session->windows[ index ].after_count += 1;
+
+}
+
+
+/*==========================================================================*/
+error_type sim_open(                /* note the watch to show windows to    */
+    LPVOID              context,    /* simulated backend state              */
+    window_watch_type*  watch       /* watch to deliver to                  */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Windows are shown to the scheduler's watch.
+    ------------------------------------------------------------------*/
+    ( ( sim_state_type* ) context )->watch = watch;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+error_type sim_place(               /* count a window placed                */
+    LPVOID              context,    /* simulated backend state              */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item with the window that appeared   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               index;      /* window index                         */
+    sim_state_type*     state;      /* simulated backend state              */
+
+    /*------------------------------------------------------------------
+    Each window must be placed with its own handle.
+    ------------------------------------------------------------------*/
+    state = ( sim_state_type* ) context;
+    index = ( DWORD ) ( window - state->session->windows );
+    if( item->window != SIM_WINDOW( index ) ) {
+        InterlockedIncrement( &( state->misplaced ) );
+    }
+    InterlockedIncrement( &( state->placed[ index ] ) );
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+config_session_type* sim_session(   /* create a session, and reset the      */
+                                    /* simulation                           */
+    DWORD               count       /* number of windows                    */
+) {                                 /* returns session, or NULL             */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* window index                         */
+    config_session_type*
+                        session;    /* new session                          */
+
+    /*------------------------------------------------------------------
+    Every window is named, and runs a program, but has no rectangle,
+    no wait, and nothing to start after until a test sets them.
+    ------------------------------------------------------------------*/
+    session = ( config_session_type* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( sizeof( config_session_type )
+        + ( count * sizeof( config_window_type ) ) )
+    );
+    if( session == NULL ) {
+        return NULL;
+    }
+    memset( &sim, 0, sizeof( sim_state_type ) );
+    sim.session    = session;
+    session->count = count;
+    for( i = 0; i < count; ++i ) {
+        _stprintf( sim.names[ i ], _T( "w%lu" ), ( unsigned long ) i );
+        session->windows[ i ].name    = sim.names[ i ];
+        session->windows[ i ].command = sim.names[ i ];
+    }
+    return session;
+}
+
+
+/*==========================================================================*/
+error_type sim_start(               /* start a window's simulated program   */
+    LPVOID              context,    /* simulated backend state              */
+    const config_window_type*
+                        window,     /* configured window                    */
+    launch_sched_item_type*
+                        item        /* item to fill with the process        */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LONG                active;     /* programs being started now           */
+    DWORD               index;      /* window index                         */
+    DWORD               k;          /* "after" name index                   */
+    LONG                most;       /* most programs started at once        */
+    LPCTSTR             name;       /* window this one starts after         */
+    sim_state_type*     state;      /* simulated backend state              */
+
+    /*------------------------------------------------------------------
+    Count the programs being started at once.
+    ------------------------------------------------------------------*/
+    state  = ( sim_state_type* ) context;
+    index  = ( DWORD ) ( window - state->session->windows );
+    active = InterlockedIncrement( &( state->active ) );
+    do {
+        most = state->most;
+    } while( ( active > most )
+          && ( InterlockedCompareExchange( &( state->most ), active, most )
+               != most ) );
+    InterlockedIncrement( &( state->started[ index ] ) );
+
+    /*------------------------------------------------------------------
+    Every window this one starts after must have been released.
+    ------------------------------------------------------------------*/
+    name = window->after;
+    for( k = 0; k < window->after_count; ++k ) {
+        if( state->released[ _tcstoul( ( name + 1 ), NULL, 10 ) ] == 0 ) {
+            InterlockedIncrement( &( state->early ) );
+        }
+        name += _tcslen( name ) + 1;
+    }
+
+    /*------------------------------------------------------------------
+    Take the program's time to start.
+    ------------------------------------------------------------------*/
+    Sleep( state->launch[ index ] );
+    InterlockedDecrement( &( state->active ) );
+    item->process_id = SIM_PROCESS( index );
+    if( state->failing[ index ] != FALSE ) {
+        InterlockedExchange( &( state->released[ index ] ), 1 );
+        return ERR_WINAPI;
+    }
+
+    /*------------------------------------------------------------------
+    Show the window later, if the scheduler is watching for it.  Later
+    windows may start now, unless they wait for it to be shown.
+    ------------------------------------------------------------------*/
+    if( ( state->appear[ index ] != INFINITE )
+     && ( ( window->wait != FALSE )
+       || ( IsRectEmpty( &( window->rectangle ) ) == FALSE ) ) ) {
+        EnterCriticalSection( &sim_lock );
+        state->due[ index ]       = GetTickCount() + state->appear[ index ];
+        state->scheduled[ index ] = TRUE;
+        LeaveCriticalSection( &sim_lock );
+    }
+    if( ( window->wait == FALSE ) || ( state->appear[ index ] == INFINITE ) ) {
+        InterlockedExchange( &( state->released[ index ] ), 1 );
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+DWORD sim_time(                     /* time launching a timed session       */
+    DWORD               workers,    /* worker threads                       */
+    BOOL                chain       /* each window starts after the one     */
+                                    /* before it                            */
+) {                                 /* returns time taken (ms)              */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* window index                         */
+    launch_sched_type   launch;     /* launch object                        */
+    config_session_type*
+                        session;    /* timed session                        */
+    DWORD               start;      /* tick count before the launch         */
+    DWORD               time;       /* time taken (ms)                      */
+
+    /*------------------------------------------------------------------
+    Every program takes the same time to start.
+    ------------------------------------------------------------------*/
+    session = sim_session( SIM_TIMED );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return 0;
+    }
+    for( i = 0; i < SIM_TIMED; ++i ) {
+        sim.launch[ i ] = SIM_LAUNCH;
+        if( ( chain != FALSE ) && ( i > 0 ) ) {
+            sim_after( i, ( i - 1 ) );
+        }
+    }
+    start = GetTickCount();
+    TEST_CHECK( launch_sched_run(
+        session,
+        &sim_backend,
+        NULL,
+        workers,
+        INFINITE,
+        &launch
+    ) == ERR_OK );
+    time = GetTickCount() - start;
+    TEST_CHECK( sim.early == 0 );
+    TEST_CHECK( sim.most <= ( LONG ) workers );
+    launch_sched_free( &launch );
+    HeapFree( GetProcessHeap(), 0, session );
+    return time;
+}
+
+
+/*==========================================================================*/
+void sim_wait(                      /* show windows that are due            */
+    LPVOID              context,    /* simulated backend state              */
+    window_watch_type*  watch,      /* watch to deliver to                  */
+    DWORD               timeout     /* limit on the wait (ms), or INFINITE  */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of windows due                */
+    DWORD               due[ SIM_LIMIT ];
+                                    /* windows due                          */
+    HANDLE              handles[ 2 ];
+                                    /* wake event and process exits         */
+    DWORD               i;          /* window index                         */
+    DWORD               next;       /* time until the next window (ms)      */
+    DWORD               now;        /* current tick count                   */
+    sim_state_type*     state;      /* simulated backend state              */
+
+    /*------------------------------------------------------------------
+    Find the windows that are due, and when the next one will be.
+    ------------------------------------------------------------------*/
+    state = ( sim_state_type* ) context;
+    count = 0;
+    next  = INFINITE;
+    now   = GetTickCount();
+    EnterCriticalSection( &sim_lock );
+    for( i = 0; i < state->session->count; ++i ) {
+        if( ( state->scheduled[ i ] == FALSE )
+         || ( state->shown[ i ] != FALSE ) ) {
+            continue;
+        }
+        if( ( LONG ) ( state->due[ i ] - now ) <= 0 ) {
+            state->shown[ i ] = TRUE;
+            due[ count ]      = i;
+            count            += 1;
+        }
+        else if( next > ( state->due[ i ] - now ) ) {
+            next = state->due[ i ] - now;
+        }
+    }
+    LeaveCriticalSection( &sim_lock );
+
+    /*------------------------------------------------------------------
+    Show the windows that are due.  Otherwise, wait for the next one,
+    or to be woken, as the usual source does.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < count; ++i ) {
+        InterlockedExchange( &( state->released[ due[ i ] ] ), 1 );
+        window_watch_post(
+            watch,
+            SIM_WINDOW( due[ i ] ),
+            SIM_PROCESS( due[ i ] )
+        );
+    }
+    if( count == 0 ) {
+        handles[ 0 ] = watch->wake;
+        handles[ 1 ] = watch->exits.ready;
+        WaitForMultipleObjects(
+            2,
+            handles,
+            FALSE,
+            ( ( next < timeout ) ? next : timeout )
+        );
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_failure(                  /* check windows that never appear      */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    launch_sched_type   launch;     /* launch object                        */
+    config_session_type*
+                        session;    /* session launched                     */
+
+    /*------------------------------------------------------------------
+    A window that never appears is given up at its deadline, and then
+    lets the window after it start.
+    ------------------------------------------------------------------*/
+    session = sim_session( 3 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    sim.appear[ 0 ]          = INFINITE;
+    session->windows[ 0 ].wait = TRUE;
+    SetRect( &( session->windows[ 0 ].rectangle ), 0, 0, 100, 100 );
+    sim_after( 1, 0 );
+    TEST_CHECK( launch_sched_run(
+        session,
+        &sim_backend,
+        NULL,
+        2,
+        100,
+        &launch
+    ) == ERR_TIMEOUT );
+    TEST_CHECK( launch.items[ 0 ].result == ERR_TIMEOUT );
+    TEST_CHECK( launch.items[ 0 ].window == NULL );
+    TEST_CHECK( sim.placed[ 0 ] == 0 );
+    TEST_CHECK( ( sim.started[ 1 ] == 1 ) && ( sim.started[ 2 ] == 1 ) );
+    TEST_CHECK( launch.items[ 1 ].result == ERR_OK );
+    TEST_CHECK(
+        ( launch.items[ 1 ].started - launch.items[ 0 ].started ) >= 100
+    );
+    launch_sched_free( &launch );
+    HeapFree( GetProcessHeap(), 0, session );
+
+    /*------------------------------------------------------------------
+    A program that fails to start lets the window after it start at
+    once, and the launch still succeeds.
+    ------------------------------------------------------------------*/
+    session = sim_session( 2 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    sim.failing[ 0 ]           = TRUE;
+    session->windows[ 0 ].wait = TRUE;
+    sim_after( 1, 0 );
+    TEST_CHECK( launch_sched_run(
+        session,
+        &sim_backend,
+        NULL,
+        2,
+        INFINITE,
+        &launch
+    ) == ERR_OK );
+    TEST_CHECK( launch.items[ 0 ].result == ERR_WINAPI );
+    TEST_CHECK( sim.started[ 1 ] == 1 );
+    TEST_CHECK( launch.items[ 1 ].result == ERR_OK );
+    launch_sched_free( &launch );
+    HeapFree( GetProcessHeap(), 0, session );
+
+}
+
+
+/*==========================================================================*/
+void test_graph(                    /* check ordering errors                */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    launch_sched_type   launch;     /* launch object                        */
+    config_session_type*
+                        session;    /* session launched                     */
+
+    /*------------------------------------------------------------------
+    Nothing starts when a window names one that does not exist.
+    ------------------------------------------------------------------*/
+    session = sim_session( 3 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    session->windows[ 2 ].after       = _T( "w0\0missing\0" );
+    session->windows[ 2 ].after_count = 2;
+    TEST_CHECK( launch_sched_run(
+        session,
+        &sim_backend,
+        NULL,
+        2,
+        INFINITE,
+        &launch
+    ) == ERR_NOT_FOUND );
+    TEST_CHECK( ( sim.started[ 0 ] == 0 ) && ( sim.started[ 1 ] == 0 ) );
+    TEST_CHECK( ( launch.count == 0 ) && ( launch.items == NULL ) );
+    HeapFree( GetProcessHeap(), 0, session );
+
+    /*------------------------------------------------------------------
+    Nothing starts when windows start after each other, even when
+    other windows could.
+    ------------------------------------------------------------------*/
+    session = sim_session( 4 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    sim_after( 1, 2 );
+    sim_after( 2, 3 );
+    sim_after( 3, 1 );
+    TEST_CHECK( launch_sched_run(
+        session,
+        &sim_backend,
+        NULL,
+        2,
+        INFINITE,
+        &launch
+    ) == ERR_FORMAT );
+    TEST_CHECK( sim.started[ 0 ] == 0 );
+    TEST_CHECK( ( launch.count == 0 ) && ( launch.items == NULL ) );
+    HeapFree( GetProcessHeap(), 0, session );
+
+}
+
+
+/*==========================================================================*/
+void test_random(                   /* check random sessions                */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of windows                    */
+    DWORD               density;    /* chance of each "after" (percent)     */
+    DWORD               i;          /* window index                         */
+    DWORD               k;          /* earlier window index                 */
+    launch_sched_item_type*
+                        item;       /* window's launch results              */
+    launch_sched_type   launch;     /* launch object                        */
+    DWORD               order[ SIM_LIMIT ];
+                                    /* order the windows may start in       */
+    DWORD               seed;       /* random number state                  */
+    config_session_type*
+                        session;    /* session launched                     */
+    DWORD               swap;       /* window being shuffled                */
+    DWORD               t;          /* session index                        */
+    config_window_type* window;     /* configured window                    */
+    DWORD               workers;    /* worker threads                       */
+
+    /*------------------------------------------------------------------
+    Each session's windows start after random earlier windows in a
+    shuffled order, so the graph never loops.
+    ------------------------------------------------------------------*/
+    seed = 1;
+    for( t = 0; t < SIM_SESSIONS; ++t ) {
+        seed    = ( seed * 1103515245 ) + 12345;
+        count   = 4 + ( ( seed >> 16 ) % ( SIM_LIMIT - 3 ) );
+        density = ( t % 4 ) * 10;
+        workers = 1 + ( t % 8 );
+        session = sim_session( count );
+        if( TEST_CHECK( session != NULL ) == FALSE ) {
+            return;
+        }
+        for( i = 0; i < count; ++i ) {
+            order[ i ] = i;
+        }
+        for( i = count - 1; i > 0; --i ) {
+            seed         = ( seed * 1103515245 ) + 12345;
+            k            = ( seed >> 16 ) % ( i + 1 );
+            swap         = order[ i ];
+            order[ i ]   = order[ k ];
+            order[ k ]   = swap;
+        }
+        for( i = 0; i < count; ++i ) {
+            for( k = 0; k < i; ++k ) {
+                seed = ( seed * 1103515245 ) + 12345;
+                if( ( ( seed >> 16 ) % 100 ) < density ) {
+                    sim_after( order[ i ], order[ k ] );
+                }
+            }
+            window = &( session->windows[ i ] );
+            seed   = ( seed * 1103515245 ) + 12345;
+            window->wait = ( ( seed >> 16 ) & 1 ) ? TRUE : FALSE;
+            if( ( ( seed >> 17 ) % 3 ) != 0 ) {
+                SetRect( &( window->rectangle ), 0, 0, 100, 100 );
+            }
+            sim.launch[ i ]  = ( seed >> 20 ) % 4;
+            sim.appear[ i ]  = ( seed >> 22 ) % 10;
+            sim.failing[ i ] = ( ( ( seed >> 26 ) % 12 ) == 0 )
+                             ? TRUE : FALSE;
+        }
+
+        /*--------------------------------------------------------------
+        Launch the session, and check each window.
+        --------------------------------------------------------------*/
+        TEST_CHECK( launch_sched_run(
+            session,
+            &sim_backend,
+            NULL,
+            workers,
+            INFINITE,
+            &launch
+        ) == ERR_OK );
+        TEST_CHECK( launch.count == count );
+        TEST_CHECK( ( launch.workers > 0 ) && ( launch.workers <= workers ) );
+        TEST_CHECK( sim.most <= ( LONG ) workers );
+        TEST_CHECK( sim.early == 0 );
+        TEST_CHECK( sim.misplaced == 0 );
+        for( i = 0; i < count; ++i ) {
+            item   = &( launch.items[ i ] );
+            window = &( session->windows[ i ] );
+            TEST_CHECK( sim.started[ i ] == 1 );
+            TEST_CHECK( item->process_id == SIM_PROCESS( i ) );
+            if( sim.failing[ i ] != FALSE ) {
+                TEST_CHECK( item->result == ERR_WINAPI );
+                TEST_CHECK( sim.placed[ i ] == 0 );
+                continue;
+            }
+            TEST_CHECK( item->result == ERR_OK );
+            if( IsRectEmpty( &( window->rectangle ) ) == FALSE ) {
+                TEST_CHECK( item->window == SIM_WINDOW( i ) );
+                TEST_CHECK( sim.placed[ i ] == 1 );
+            }
+            else {
+                TEST_CHECK( sim.placed[ i ] == 0 );
+                TEST_CHECK( ( window->wait == FALSE )
+                         || ( item->window == SIM_WINDOW( i ) ) );
+            }
+        }
+        launch_sched_free( &launch );
+        HeapFree( GetProcessHeap(), 0, session );
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_speedup(                  /* check the time taken with workers    */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               chain;      /* chained windows on eight workers     */
+    DWORD               eight;      /* independent windows on eight workers */
+    DWORD               one;        /* independent windows on one worker    */
+
+    /*------------------------------------------------------------------
+    Independent windows start together; a chain starts one at a time.
+    ------------------------------------------------------------------*/
+    one   = sim_time( 1, FALSE );
+    eight = sim_time( 8, FALSE );
+    chain = sim_time( 8, TRUE );
+    TEST_CHECK( one >= ( SIM_TIMED * SIM_LAUNCH ) );
+    TEST_CHECK( ( eight * 3 ) <= one );
+    TEST_CHECK( chain >= ( SIM_TIMED * SIM_LAUNCH ) );
+    printf(
+        "launch_sched_test: %d windows of %d ms: %lu ms on 1 worker, "
+        "%lu ms on 8, %lu ms chained\n",
+        SIM_TIMED,
+        SIM_LAUNCH,
+        ( unsigned long ) one,
+        ( unsigned long ) eight,
+        ( unsigned long ) chain
+    );
+
+}
+
@@ -0,0 +1,547 @@
+/*****************************************************************************
+
+monitor_layout_test.c
+
+Monitor Layout Remapping Tests
+
+Every layout here is injected with monitor_layout_set, so the tests do not
+depend on the monitors of the machine running them.  A few hand-worked
+cases check each step of the remap (pairing, proportion, DPI, clamping,
+and leaving unchanged monitors alone); thousands of random rectangles then
+check that every remapped rectangle ends up inside a current work area.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "monitor_layout.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define LAYOUT_TEST_RANDOM  ( 5000 )/* number of random rectangles          */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL check_rectangle(               /* compare a rectangle's edges          */
+    const RECT*         rectangle,  /* rectangle to check                   */
+    LONG                left,       /* expected edges                       */
+    LONG                top,
+    LONG                right,
+    LONG                bottom
+);                                  /* returns TRUE if they are the same    */
+
+config_session_type* make_session(  /* allocate a session of rectangles     */
+    const config_monitor_type*
+                        monitors,   /* captured profile, or NULL            */
+    DWORD               monitor_count,
+                                    /* number of captured monitors          */
+    DWORD               count       /* number of windows (rectangles empty) */
+);                                  /* returns session (freed with          */
+                                    /* HeapFree), or NULL                   */
+
+config_monitor_type set_monitor(    /* describe a monitor                   */
+    LONG                left,       /* monitor rectangle                    */
+    LONG                top,
+    LONG                right,
+    LONG                bottom,
+    LONG                taskbar,    /* height of the taskbar at the bottom  */
+    DWORD               dpi         /* dots per inch                        */
+);                                  /* returns monitor                      */
+
+void test_cache(                    /* remap tables are reused              */
+    void
+);
+
+void test_dpi(                      /* sizes keep their physical size       */
+    void
+);
+
+void test_gone(                     /* monitors merged into a larger one    */
+    void
+);
+
+void test_identity(                 /* unchanged monitors are left alone    */
+    void
+);
+
+void test_random(                   /* every result is on a current monitor */
+    void
+);
+
+void test_shrink(                   /* windows are kept inside the work     */
+                                    /* area                                 */
+    void
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    monitor_layout_type layout;     /* layout object                        */
+    config_monitor_type monitor;    /* a current monitor                    */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked.
+    ------------------------------------------------------------------*/
+    monitor = set_monitor( 0, 0, 1920, 1080, 40, 96 );
+    memset( &layout, 0, sizeof( layout ) );
+    TEST_CHECK( monitor_layout_set( &layout, NULL, 1 ) == ERR_USAGE );
+    TEST_CHECK( monitor_layout_set( &layout, &monitor, 0 ) == ERR_USAGE );
+    TEST_CHECK( monitor_layout_remap( &layout, NULL, 0 ) == ERR_USAGE );
+    TEST_CHECK( monitor_layout_set( &layout, &monitor, 1 ) == ERR_OK );
+    TEST_CHECK( monitor_layout_remap( &layout, NULL, 0 ) == ERR_OK );
+    TEST_CHECK( layout.hash == monitor_layout_hash( &monitor, 1 ) );
+
+    /*------------------------------------------------------------------
+    Run each group of checks.
+    ------------------------------------------------------------------*/
+    test_identity();
+    test_dpi();
+    test_gone();
+    test_shrink();
+    test_cache();
+    test_random();
+    return test_result( "monitor_layout_test" );
+}
+
+
+/*==========================================================================*/
+BOOL check_rectangle(               /* compare a rectangle's edges          */
+    const RECT*         rectangle,  /* rectangle to check                   */
+    LONG                left,       /* expected edges                       */
+    LONG                top,
+    LONG                right,
+    LONG                bottom
+) {                                 /* returns TRUE if they are the same    */
+
+    /*------------------------------------------------------------------
+    Report the edges found when they differ.
+    ------------------------------------------------------------------*/
+    if( ( rectangle->left == left ) && ( rectangle->top == top )
+     && ( rectangle->right == right ) && ( rectangle->bottom == bottom ) ) {
+        return TRUE;
+    }
+    fprintf(
+        stderr,
+        "    found [ %ld, %ld, %ld, %ld ], expected [ %ld, %ld, %ld, %ld ]\n",
+        ( long ) rectangle->left,
+        ( long ) rectangle->top,
+        ( long ) rectangle->right,
+        ( long ) rectangle->bottom,
+        ( long ) left,
+        ( long ) top,
+        ( long ) right,
+        ( long ) bottom
+    );
+    return FALSE;
+}
+
+
+/*==========================================================================*/
+config_session_type* make_session(  /* allocate a session of rectangles     */
+    const config_monitor_type*
+                        monitors,   /* captured profile, or NULL            */
+    DWORD               monitor_count,
+                                    /* number of captured monitors          */
+    DWORD               count       /* number of windows (rectangles empty) */
+) {                                 /* returns session (freed with          */
+                                    /* HeapFree), or NULL                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_session_type*
+                        session;    /* new session                          */
+
+    /*------------------------------------------------------------------
+    Only the rectangles and the profile are used by the remap.
+    ------------------------------------------------------------------*/
+    session = ( config_session_type* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( sizeof( config_session_type )
+        + ( count * sizeof( config_window_type ) ) )
+    );
+    if( session != NULL ) {
+        session->monitors      = monitors;
+        session->monitor_count = monitor_count;
+        session->count         = count;
+    }
+    return session;
+}
+
+
+/*==========================================================================*/
+config_monitor_type set_monitor(    /* describe a monitor                   */
+    LONG                left,       /* monitor rectangle                    */
+    LONG                top,
+    LONG                right,
+    LONG                bottom,
+    LONG                taskbar,    /* height of the taskbar at the bottom  */
+    DWORD               dpi         /* dots per inch                        */
+) {                                 /* returns monitor                      */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_monitor_type monitor;    /* monitor described                    */
+
+    /*------------------------------------------------------------------
+    The work area is the monitor without its taskbar.
+    ------------------------------------------------------------------*/
+    memset( &monitor, 0, sizeof( monitor ) );
+    SetRect( &( monitor.rectangle ), left, top, right, bottom );
+    SetRect( &( monitor.work ), left, top, right, ( bottom - taskbar ) );
+    monitor.dpi = dpi;
+    return monitor;
+}
+
+
+/*==========================================================================*/
+void test_cache(                    /* remap tables are reused              */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_monitor_type captured;   /* profile of the sessions              */
+    config_monitor_type current;    /* current monitor                      */
+    monitor_layout_type layout;     /* current layout                       */
+    config_session_type*
+                        sessions[ 3 ];
+                                    /* sessions remapped together           */
+
+    /*------------------------------------------------------------------
+    Two sessions captured on one profile share a table, and so do later
+    remaps.  A session without a profile needs its own.
+    ------------------------------------------------------------------*/
+    captured     = set_monitor( 0, 0, 1920, 1080, 40, 96 );
+    current      = set_monitor( 0, 0, 2560, 1440, 40, 96 );
+    sessions[ 0 ] = make_session( &captured, 1, 1 );
+    sessions[ 1 ] = make_session( &captured, 1, 1 );
+    sessions[ 2 ] = make_session( NULL, 0, 1 );
+    if( ( TEST_CHECK( sessions[ 0 ] != NULL ) != FALSE )
+     && ( TEST_CHECK( sessions[ 1 ] != NULL ) != FALSE )
+     && ( TEST_CHECK( sessions[ 2 ] != NULL ) != FALSE ) ) {
+        SetRect( &( sessions[ 0 ]->windows[ 0 ].rectangle ), 0, 0, 10, 10 );
+        SetRect( &( sessions[ 1 ]->windows[ 0 ].rectangle ), 0, 0, 10, 10 );
+        SetRect( &( sessions[ 2 ]->windows[ 0 ].rectangle ), 0, 0, 10, 10 );
+        monitor_layout_set( &layout, &current, 1 );
+        TEST_CHECK( monitor_layout_remap( &layout, sessions, 2 ) == ERR_OK );
+        TEST_CHECK( ( layout.misses == 1 ) && ( layout.hits == 1 ) );
+        TEST_CHECK( monitor_layout_remap( &layout, sessions, 1 ) == ERR_OK );
+        TEST_CHECK( ( layout.misses == 1 ) && ( layout.hits == 2 ) );
+        TEST_CHECK(
+            monitor_layout_remap( &layout, &( sessions[ 2 ] ), 1 ) == ERR_OK
+        );
+        TEST_CHECK( ( layout.misses == 2 ) && ( layout.hits == 2 ) );
+    }
+    HeapFree( GetProcessHeap(), 0, sessions[ 0 ] );
+    HeapFree( GetProcessHeap(), 0, sessions[ 1 ] );
+    HeapFree( GetProcessHeap(), 0, sessions[ 2 ] );
+
+}
+
+
+/*==========================================================================*/
+void test_dpi(                      /* sizes keep their physical size       */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_monitor_type captured;   /* monitor at 96 DPI                    */
+    config_monitor_type current;    /* same monitor at 192 DPI              */
+    monitor_layout_type layout;     /* current layout                       */
+    config_session_type*
+                        session;    /* session captured at 96 DPI           */
+
+    /*------------------------------------------------------------------
+    The same monitor, now scaled to 200%.  Sizes double, positions stay
+    (the work area is the same), and a window pushed past the work area
+    is moved back inside it.
+    ------------------------------------------------------------------*/
+    captured = set_monitor( 0, 0, 1920, 1080, 40, 96 );
+    current  = set_monitor( 0, 0, 1920, 1080, 40, 192 );
+    session  = make_session( &captured, 1, 2 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    SetRect( &( session->windows[ 0 ].rectangle ), 100, 100, 500, 400 );
+    SetRect( &( session->windows[ 1 ].rectangle ), 1500, 800, 1900, 1000 );
+    monitor_layout_set( &layout, &current, 1 );
+    TEST_CHECK( monitor_layout_remap( &layout, &session, 1 ) == ERR_OK );
+    TEST_CHECK( check_rectangle(
+        &( session->windows[ 0 ].rectangle ), 100, 100, 900, 700
+    ) );
+    TEST_CHECK( check_rectangle(
+        &( session->windows[ 1 ].rectangle ), 1120, 640, 1920, 1040
+    ) );
+    HeapFree( GetProcessHeap(), 0, session );
+
+}
+
+
+/*==========================================================================*/
+void test_gone(                     /* monitors merged into a larger one    */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_monitor_type captured[ 2 ];
+                                    /* two 1080p monitors at 96 DPI         */
+    config_monitor_type current;    /* one 4K monitor at 192 DPI            */
+    config_monitor_type moved;      /* the first monitor, moved right       */
+    monitor_layout_type layout;     /* current layout                       */
+    config_session_type*
+                        session;    /* session captured on two monitors     */
+
+    /*------------------------------------------------------------------
+    Both monitors are inside the new one, so their windows keep their
+    places, and double in size.
+    ------------------------------------------------------------------*/
+    captured[ 0 ] = set_monitor( 0, 0, 1920, 1080, 40, 96 );
+    captured[ 1 ] = set_monitor( 1920, 0, 3840, 1080, 0, 96 );
+    current       = set_monitor( 0, 0, 3840, 2160, 40, 192 );
+    session       = make_session( captured, 2, 2 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    SetRect( &( session->windows[ 0 ].rectangle ), 100, 100, 900, 700 );
+    SetRect( &( session->windows[ 1 ].rectangle ), 2000, 100, 2800, 700 );
+    monitor_layout_set( &layout, &current, 1 );
+    TEST_CHECK( monitor_layout_remap( &layout, &session, 1 ) == ERR_OK );
+    TEST_CHECK( check_rectangle(
+        &( session->windows[ 0 ].rectangle ), 100, 100, 1700, 1300
+    ) );
+    TEST_CHECK( check_rectangle(
+        &( session->windows[ 1 ].rectangle ), 2000, 100, 3600, 1300
+    ) );
+
+    /*------------------------------------------------------------------
+    A monitor of the same size elsewhere takes the windows of the one
+    that is gone, at the same place within it.
+    ------------------------------------------------------------------*/
+    moved = set_monitor( 1920, 0, 3840, 1080, 40, 96 );
+    SetRect( &( session->windows[ 0 ].rectangle ), 100, 100, 900, 700 );
+    SetRectEmpty( &( session->windows[ 1 ].rectangle ) );
+    session->monitor_count = 1;
+    monitor_layout_set( &layout, &moved, 1 );
+    TEST_CHECK( monitor_layout_remap( &layout, &session, 1 ) == ERR_OK );
+    TEST_CHECK( check_rectangle(
+        &( session->windows[ 0 ].rectangle ), 2020, 100, 2820, 700
+    ) );
+    TEST_CHECK( IsRectEmpty( &( session->windows[ 1 ].rectangle ) ) );
+    HeapFree( GetProcessHeap(), 0, session );
+
+}
+
+
+/*==========================================================================*/
+void test_identity(                 /* unchanged monitors are left alone    */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_monitor_type current[ 2 ];
+                                    /* current monitors                     */
+    monitor_layout_type layout;     /* current layout                       */
+    config_session_type*
+                        sessions[ 2 ];
+                                    /* with and without a profile           */
+
+    /*------------------------------------------------------------------
+    Rectangles captured on the current monitors do not move, even past
+    the work area.  Nor do those of a session without a profile, unless
+    they are off every monitor: then they go onto the nearest one.
+    ------------------------------------------------------------------*/
+    current[ 0 ]  = set_monitor( 0, 0, 1920, 1080, 40, 96 );
+    current[ 1 ]  = set_monitor( 1920, 0, 3840, 1080, 0, 96 );
+    sessions[ 0 ] = make_session( current, 2, 3 );
+    sessions[ 1 ] = make_session( NULL, 0, 2 );
+    if( ( TEST_CHECK( sessions[ 0 ] != NULL ) != FALSE )
+     && ( TEST_CHECK( sessions[ 1 ] != NULL ) != FALSE ) ) {
+        SetRect( &( sessions[ 0 ]->windows[ 0 ].rectangle ),
+            100, 100, 900, 700 );
+        SetRect( &( sessions[ 0 ]->windows[ 1 ].rectangle ),
+            2000, 900, 2800, 1300 );
+        SetRect( &( sessions[ 1 ]->windows[ 0 ].rectangle ),
+            5000, 5000, 5400, 5300 );
+        SetRect( &( sessions[ 1 ]->windows[ 1 ].rectangle ),
+            10, 10, 200, 200 );
+        monitor_layout_set( &layout, current, 2 );
+        TEST_CHECK( monitor_layout_remap( &layout, sessions, 2 ) == ERR_OK );
+        TEST_CHECK( check_rectangle(
+            &( sessions[ 0 ]->windows[ 0 ].rectangle ), 100, 100, 900, 700
+        ) );
+        TEST_CHECK( check_rectangle(
+            &( sessions[ 0 ]->windows[ 1 ].rectangle ), 2000, 900, 2800, 1300
+        ) );
+        TEST_CHECK(
+            IsRectEmpty( &( sessions[ 0 ]->windows[ 2 ].rectangle ) )
+        );
+        TEST_CHECK( check_rectangle(
+            &( sessions[ 1 ]->windows[ 0 ].rectangle ), 3440, 780, 3840, 1080
+        ) );
+        TEST_CHECK( check_rectangle(
+            &( sessions[ 1 ]->windows[ 1 ].rectangle ), 10, 10, 200, 200
+        ) );
+    }
+    HeapFree( GetProcessHeap(), 0, sessions[ 0 ] );
+    HeapFree( GetProcessHeap(), 0, sessions[ 1 ] );
+
+}
+
+
+/*==========================================================================*/
+void test_random(                   /* every result is on a current monitor */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_monitor_type captured[ 3 ];
+                                    /* three monitors at 96 DPI             */
+    config_monitor_type current[ 2 ];
+                                    /* two monitors at 144 DPI              */
+    DWORD               i;          /* rectangle index                      */
+    BOOL                inside;     /* rectangle is in a work area          */
+    DWORD               k;          /* current monitor index                */
+    monitor_layout_type layout;     /* current layout                       */
+    RECT*               rectangle;  /* remapped rectangle                   */
+    DWORD               seed;       /* random number state                  */
+    config_session_type*
+                        session;    /* random rectangles                    */
+    LONG                x;          /* random left edge                     */
+    LONG                y;          /* random top edge                      */
+
+    /*------------------------------------------------------------------
+    Scatter rectangles of every size over and around three monitors,
+    and move them onto two others.
+    ------------------------------------------------------------------*/
+    captured[ 0 ] = set_monitor( 0, 0, 1920, 1080, 40, 96 );
+    captured[ 1 ] = set_monitor( 1920, 0, 3840, 1080, 0, 96 );
+    captured[ 2 ] = set_monitor( -1280, 0, 0, 1024, 0, 96 );
+    current[ 0 ]  = set_monitor( 0, 0, 2560, 1440, 48, 144 );
+    current[ 1 ]  = set_monitor( 2560, 0, 5120, 1440, 0, 144 );
+    session       = make_session( captured, 3, LAYOUT_TEST_RANDOM );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    seed = 1;
+    for( i = 0; i < LAYOUT_TEST_RANDOM; ++i ) {
+        seed = ( seed * 1103515245 ) + 12345;
+        x    = ( LONG ) ( ( seed >> 8 ) % 8000 ) - 3000;
+        seed = ( seed * 1103515245 ) + 12345;
+        y    = ( LONG ) ( ( seed >> 8 ) % 2000 ) - 400;
+        seed = ( seed * 1103515245 ) + 12345;
+        SetRect(
+            &( session->windows[ i ].rectangle ),
+            x,
+            y,
+            ( x + 1 + ( LONG ) ( ( seed >> 8 ) % 3000 ) ),
+            ( y + 1 + ( LONG ) ( ( seed >> 16 ) % 1500 ) )
+        );
+    }
+    monitor_layout_set( &layout, current, 2 );
+    TEST_CHECK( monitor_layout_remap( &layout, &session, 1 ) == ERR_OK );
+
+    /*------------------------------------------------------------------
+    Every rectangle must now be inside one of the current work areas.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < LAYOUT_TEST_RANDOM; ++i ) {
+        rectangle = &( session->windows[ i ].rectangle );
+        inside    = FALSE;
+        for( k = 0; k < 2; ++k ) {
+            if( ( rectangle->left >= current[ k ].work.left )
+             && ( rectangle->top >= current[ k ].work.top )
+             && ( rectangle->right <= current[ k ].work.right )
+             && ( rectangle->bottom <= current[ k ].work.bottom ) ) {
+                inside = TRUE;
+            }
+        }
+        if( ( TEST_CHECK( inside != FALSE ) == FALSE )
+         || ( TEST_CHECK( IsRectEmpty( rectangle ) == FALSE ) == FALSE ) ) {
+            check_rectangle( rectangle, 0, 0, 0, 0 );
+            break;
+        }
+    }
+    HeapFree( GetProcessHeap(), 0, session );
+
+}
+
+
+/*==========================================================================*/
+void test_shrink(                   /* windows are kept inside the work     */
+                                    /* area                                 */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_monitor_type captured;   /* 1080p monitor                        */
+    config_monitor_type current;    /* 720p monitor                         */
+    monitor_layout_type layout;     /* current layout                       */
+    config_session_type*
+                        session;    /* session captured on 1080p            */
+
+    /*------------------------------------------------------------------
+    A window filling a larger monitor's work area fills the smaller
+    one's.
+    ------------------------------------------------------------------*/
+    captured = set_monitor( 0, 0, 1920, 1080, 40, 96 );
+    current  = set_monitor( 0, 0, 1280, 720, 40, 96 );
+    session  = make_session( &captured, 1, 1 );
+    if( TEST_CHECK( session != NULL ) == FALSE ) {
+        return;
+    }
+    SetRect( &( session->windows[ 0 ].rectangle ), 0, 0, 1920, 1040 );
+    monitor_layout_set( &layout, &current, 1 );
+    TEST_CHECK( monitor_layout_remap( &layout, &session, 1 ) == ERR_OK );
+    TEST_CHECK( check_rectangle(
+        &( session->windows[ 0 ].rectangle ), 0, 0, 1280, 680
+    ) );
+    HeapFree( GetProcessHeap(), 0, session );
+
+}
+
@@ -0,0 +1,435 @@
+/*****************************************************************************
+
+proc_args_test.c
+
+Command Line Argument Tokenizer Tests
+
+The tokenizer is checked two ways.  A few command lines have their
+arguments written out by hand, from the examples given for
+CommandLineToArgvW.  Many more (every run length around the eight
+characters SSE2 tests at once, and a long series of random lines) are
+split by a reference that applies the same rules one character at a time
+into separate storage, and the tokenizer must agree with it exactly: the
+number of arguments, their text, and the terminators it writes in place.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "proc_args.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define ARGS_LIMIT          ( 256 ) /* most arguments in a tested line      */
+
+#define ARGS_LENGTH         ( 512 ) /* longest tested line (characters)     */
+
+#define ARGS_RANDOM         ( 20000 )
+                                    /* number of random lines tested        */
+
+#define ARGS_RUN            ( 40 )  /* longest ordinary run tested before   */
+                                    /* a special character                  */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct args_case_s {        /* hand-split command line type         */
+    LPCWSTR             line;       /* command line                         */
+    DWORD               count;      /* number of arguments                  */
+    LPCWSTR             arguments[ 4 ];
+                                    /* expected arguments                   */
+} args_case_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const args_case_type args_cases[] = {
+    { L"prog \"abc\" d e",
+      4, { L"prog", L"abc", L"d", L"e" } },
+    { L"prog a\\\\\\b d\"e f\"g h",
+      4, { L"prog", L"a\\\\\\b", L"de fg", L"h" } },
+    { L"prog a\\\\\\\"b c d",
+      4, { L"prog", L"a\\\"b", L"c", L"d" } },
+    { L"prog a\\\\\\\\\"b c\" d e",
+      4, { L"prog", L"a\\\\b c", L"d", L"e" } },
+    { L"\"C:\\Program Files\\x.exe\" arg",
+      2, { L"C:\\Program Files\\x.exe", L"arg" } },
+    { L"C:\\a\\\"b c",
+      2, { L"C:\\a\\\"b", L"c" } },
+    { L"prog \"\"",
+      2, { L"prog", L"" } },
+    { L"prog \"\"\"\"",
+      2, { L"prog", L"\"" } },
+    { L"prog  a\tb \t",
+      3, { L"prog", L"a", L"b" } },
+    { L"prog \"a b\\\\\"",
+      2, { L"prog", L"a b\\" } },
+    { L"prog \"unterminated quote",
+      2, { L"prog", L"unterminated quote" } },
+    { L" leading",
+      2, { L"", L"leading" } }
+};
+
+static const WCHAR args_alphabet[] = {
+    L'x', L'y', L'x', L'y', L'x', L' ', L'\t', L'"', L'\\', L'\\'
+};
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL check_expected(                /* check a hand-split command line      */
+    const args_case_type*
+                        test        /* command line and its arguments       */
+);                                  /* returns TRUE if it split as expected */
+
+BOOL check_line(                    /* check the tokenizer on a line        */
+    LPCWSTR             line,       /* command line                         */
+    DWORD               length      /* length of command line (characters)  */
+);                                  /* returns TRUE if it agreed with the   */
+                                    /* reference                            */
+
+DWORD reference_split(              /* split a line one character at a time */
+    LPCWSTR             line,       /* command line                         */
+    DWORD               length,     /* length of command line (characters)  */
+    LPWSTR              storage,    /* storage for the arguments (length    */
+                                    /* characters)                          */
+    proc_arg_view_type* views       /* returned views into storage          */
+                                    /* (ARGS_LIMIT)                         */
+);                                  /* returns number of arguments          */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* case or line index                   */
+    DWORD               k;          /* special character index              */
+    DWORD               length;     /* length of the line (characters)      */
+    WCHAR               line[ ARGS_LENGTH ];
+                                    /* line being tested                    */
+    DWORD               quoted;     /* the run is inside quotes             */
+    DWORD               run;        /* length of the ordinary run           */
+    DWORD               seed;       /* random number state                  */
+    static const WCHAR  specials[] = { L' ', L'\t', L'"', L'\\' };
+                                    /* characters that end an ordinary run  */
+
+    /*------------------------------------------------------------------
+    Check the lines split by hand.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < ( sizeof( args_cases ) / sizeof( args_cases[ 0 ] ) );
+         ++i ) {
+        check_expected( &( args_cases[ i ] ) );
+    }
+
+    /*------------------------------------------------------------------
+    End ordinary runs of every length around the SSE2 width with each
+    special character, inside and outside quotes, and at the end of
+    the line.
+    ------------------------------------------------------------------*/
+    for( quoted = 0; quoted < 2; ++quoted ) {
+        for( run = 0; run <= ARGS_RUN; ++run ) {
+            for( k = 0; k <= ( sizeof( specials ) / sizeof( WCHAR ) ); ++k ) {
+                wcscpy( line, ( quoted != 0 ) ? L"prog \"" : L"prog " );
+                length = ( DWORD ) wcslen( line );
+                for( i = 0; i < run; ++i ) {
+                    line[ length++ ] = ( WCHAR ) ( L'a' + ( i % 26 ) );
+                }
+                if( k < ( sizeof( specials ) / sizeof( WCHAR ) ) ) {
+                    line[ length++ ] = specials[ k ];
+                    line[ length++ ] = L'"';
+                    for( i = 0; i < run; ++i ) {
+                        line[ length++ ] = L'z';
+                    }
+                }
+                line[ length ] = L'\0';
+                check_line( line, length );
+            }
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Split random lines, mostly made of short runs of ordinary
+    characters, with blanks, quotes, and runs of backslashes between.
+    ------------------------------------------------------------------*/
+    seed = 12345;
+    for( i = 0; i < ARGS_RANDOM; ++i ) {
+        seed   = ( seed * 1103515245 ) + 12345;
+        length = ( seed >> 16 ) % 72;
+        for( k = 0; k < length; ++k ) {
+            seed      = ( seed * 1103515245 ) + 12345;
+            line[ k ] = args_alphabet[ ( seed >> 16 )
+                      % ( sizeof( args_alphabet ) / sizeof( WCHAR ) ) ];
+        }
+        line[ length ] = L'\0';
+        if( check_line( line, length ) == FALSE ) {
+            break;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Report the checks.
+    ------------------------------------------------------------------*/
+    return test_result( "proc_args_test" );
+}
+
+
+/*==========================================================================*/
+BOOL check_expected(                /* check a hand-split command line      */
+    const args_case_type*
+                        test        /* command line and its arguments       */
+) {                                 /* returns TRUE if it split as expected */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    WCHAR               buffer[ ARGS_LENGTH ];
+                                    /* line, unescaped in place             */
+    DWORD               count;      /* number of arguments found            */
+    DWORD               i;          /* argument index                       */
+    DWORD               length;     /* length of the line (characters)      */
+    proc_arg_view_type  views[ ARGS_LIMIT ];
+                                    /* arguments found                      */
+
+    /*------------------------------------------------------------------
+    Split the line, and compare each argument.
+    ------------------------------------------------------------------*/
+    length = ( DWORD ) wcslen( test->line );
+    wcscpy( buffer, test->line );
+    count = proc_args_split( buffer, length, views, ARGS_LIMIT );
+    if( TEST_CHECK( count == test->count ) == FALSE ) {
+        return FALSE;
+    }
+    for( i = 0; i < count; ++i ) {
+        if( ( TEST_CHECK(
+                views[ i ].length == wcslen( test->arguments[ i ] )
+            ) == FALSE )
+         || ( TEST_CHECK( memcmp(
+                &( buffer[ views[ i ].offset ] ),
+                test->arguments[ i ],
+                ( views[ i ].length * sizeof( WCHAR ) )
+            ) == 0 ) == FALSE ) ) {
+            return FALSE;
+        }
+    }
+
+    /*------------------------------------------------------------------
+    The reference must split it the same way.
+    ------------------------------------------------------------------*/
+    return check_line( test->line, length );
+}
+
+
+/*==========================================================================*/
+BOOL check_line(                    /* check the tokenizer on a line        */
+    LPCWSTR             line,       /* command line                         */
+    DWORD               length      /* length of command line (characters)  */
+) {                                 /* returns TRUE if it agreed with the   */
+                                    /* reference                            */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    WCHAR               buffer[ ARGS_LENGTH ];
+                                    /* line, unescaped in place             */
+    DWORD               counted;    /* number of arguments counted          */
+    DWORD               expected;   /* number of arguments in the reference */
+    DWORD               i;          /* argument index                       */
+    proc_arg_view_type  reference[ ARGS_LIMIT ];
+                                    /* arguments in the reference           */
+    DWORD               split;      /* number of arguments split            */
+    WCHAR               storage[ ARGS_LENGTH ];
+                                    /* reference's arguments                */
+    proc_arg_view_type  views[ ARGS_LIMIT ];
+                                    /* arguments split in place             */
+
+    /*------------------------------------------------------------------
+    Count, split, and split by reference.  Counting must not touch the
+    line.
+    ------------------------------------------------------------------*/
+    memcpy( buffer, line, ( length * sizeof( WCHAR ) ) );
+    counted  = proc_args_count( buffer, length );
+    if( TEST_CHECK(
+            memcmp( buffer, line, ( length * sizeof( WCHAR ) ) ) == 0
+        ) == FALSE ) {
+        return FALSE;
+    }
+    split    = proc_args_split( buffer, length, views, ARGS_LIMIT );
+    expected = reference_split( line, length, storage, reference );
+    if( ( TEST_CHECK( counted == expected ) == FALSE )
+     || ( TEST_CHECK( split == expected ) == FALSE ) ) {
+        fprintf( stderr, "    line: \"%ls\"\n", line );
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Each argument must match, and all but the last must be terminated
+    in place.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < split; ++i ) {
+        if( ( TEST_CHECK( views[ i ].length == reference[ i ].length )
+              == FALSE )
+         || ( TEST_CHECK( memcmp(
+                &( buffer[ views[ i ].offset ] ),
+                &( storage[ reference[ i ].offset ] ),
+                ( views[ i ].length * sizeof( WCHAR ) )
+            ) == 0 ) == FALSE )
+         || ( TEST_CHECK(
+                ( ( i + 1 ) == split )
+             || ( buffer[ views[ i ].offset + views[ i ].length ] == L'\0' )
+            ) == FALSE ) ) {
+            fprintf( stderr, "    line: \"%ls\", argument %lu\n",
+                line, ( unsigned long ) i );
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+DWORD reference_split(              /* split a line one character at a time */
+    LPCWSTR             line,       /* command line                         */
+    DWORD               length,     /* length of command line (characters)  */
+    LPWSTR              storage,    /* storage for the arguments (length    */
+                                    /* characters)                          */
+    proc_arg_view_type* views       /* returned views into storage          */
+                                    /* (ARGS_LIMIT)                         */
+) {                                 /* returns number of arguments          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bcount;     /* number of pending backslashes        */
+    WCHAR               c;          /* current character                    */
+    DWORD               count;      /* number of arguments found            */
+    BOOL                open;       /* an argument is being collected       */
+    DWORD               out;        /* output position in storage           */
+    DWORD               qcount;     /* quote state                          */
+    DWORD               s;          /* source position                      */
+    DWORD               start;      /* start of the current argument        */
+
+    /*------------------------------------------------------------------
+    An empty line has no arguments, not even a program path.
+    ------------------------------------------------------------------*/
+    if( length == 0 ) {
+        return 0;
+    }
+
+    /*------------------------------------------------------------------
+    The program path ends at the next quote if it starts with one, or
+    at the next blank.  Nothing is escaped in it.
+    ------------------------------------------------------------------*/
+    out = 0;
+    s   = 0;
+    if( line[ 0 ] == L'"' ) {
+        for( s = 1; ( s < length ) && ( line[ s ] != L'"' ); ++s ) {
+            storage[ out++ ] = line[ s ];
+        }
+        if( s < length ) {
+            ++s;
+        }
+    }
+    else {
+        for( ; ( s < length ) && ( line[ s ] != L' ' )
+            && ( line[ s ] != L'\t' ); ++s ) {
+            storage[ out++ ] = line[ s ];
+        }
+    }
+    views[ 0 ].offset = 0;
+    views[ 0 ].length = out;
+    count = 1;
+
+    /*------------------------------------------------------------------
+    Go through the rest one character at a time.  A blank outside
+    quotes ends an argument.  2n backslashes before a quote become n,
+    and the quote opens or closes quoting; 2n + 1 become n and a
+    literal quote.  Other backslashes are literal.  Of consecutive
+    quotes, every third is literal.
+    ------------------------------------------------------------------*/
+    while( ( s < length ) && ( ( line[ s ] == L' ' )
+                            || ( line[ s ] == L'\t' ) ) ) {
+        ++s;
+    }
+    open   = ( s < length ) ? TRUE : FALSE;
+    start  = out;
+    bcount = 0;
+    qcount = 0;
+    while( s < length ) {
+        c = line[ s ];
+        if( ( ( c == L' ' ) || ( c == L'\t' ) ) && ( qcount == 0 ) ) {
+            views[ count ].offset = start;
+            views[ count ].length = out - start;
+            count += 1;
+            while( ( s < length ) && ( ( line[ s ] == L' ' )
+                                    || ( line[ s ] == L'\t' ) ) ) {
+                ++s;
+            }
+            open   = ( s < length ) ? TRUE : FALSE;
+            start  = out;
+            bcount = 0;
+            continue;
+        }
+        if( c == L'\\' ) {
+            storage[ out++ ] = c;
+            bcount += 1;
+        }
+        else if( c == L'"' ) {
+            out -= bcount / 2;
+            if( ( bcount % 2 ) != 0 ) {
+                out -= 1;
+                storage[ out++ ] = L'"';
+            }
+            else {
+                qcount += 1;
+            }
+            bcount = 0;
+            while( ( ( s + 1 ) < length ) && ( line[ s + 1 ] == L'"' ) ) {
+                ++s;
+                qcount += 1;
+                if( qcount == 3 ) {
+                    storage[ out++ ] = L'"';
+                    qcount = 0;
+                }
+            }
+            if( qcount == 2 ) {
+                qcount = 0;
+            }
+        }
+        else {
+            storage[ out++ ] = c;
+            bcount = 0;
+        }
+        ++s;
+    }
+    if( open != FALSE ) {
+        views[ count ].offset = start;
+        views[ count ].length = out - start;
+        count += 1;
+    }
+    return count;
+}
+
@@ -0,0 +1,362 @@
+/*****************************************************************************
+
+proc_events_test.c
+
+Process Start and Exit Event Decoding Tests
+
+Tracing the system's processes needs the rights to trace, so the trace
+session itself is not run here.  Instead, canned event records laid out
+the way the kernel's process provider delivers them are decoded: a start
+with every field (the process ID, creation time, parent ID, and session
+ID, then the fields that are not used), an exit (the process ID and
+creation time, then its exit time and code), a start cut short after the
+creation time, records from other providers or of other kinds, and
+records too short to hold a process ID and creation time.  Every payload
+is also decoded from an odd address, as the fields are not aligned.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include <evntrace.h>
+#include <evntcons.h>
+
+#include "proc_events.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define EVENTS_TEST_START   ( 1 )   /* a process started                    */
+#define EVENTS_TEST_STOP    ( 2 )   /* a process exited                     */
+#define EVENTS_TEST_IMAGE   ( 5 )   /* an image was loaded                  */
+
+#define EVENTS_TEST_SIZE    ( 64 )  /* room for a payload (bytes)           */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const GUID events_provider = {
+    0x22FB2CD6, 0x0E7B, 0x422B,
+    { 0xA0, 0xC7, 0x2F, 0xAD, 0x1F, 0xD0, 0xE7, 0x16 }
+};                                  /* Microsoft-Windows-Kernel-Process     */
+
+static const GUID events_other = {
+    0x3D6FA8D0, 0xFE05, 0x11D0,
+    { 0x9D, 0xDA, 0x00, 0xC0, 0x4F, 0xD7, 0xBA, 0x7C }
+};                                  /* the kernel logger's process events   */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD make_payload(                 /* lay out an event's fields            */
+    LPBYTE              data,       /* payload to fill                      */
+    USHORT              id,         /* EVENTS_TEST_START or                 */
+                                    /* EVENTS_TEST_STOP                     */
+    DWORD               process_id, /* process ID                           */
+    DWORD               parent_id   /* parent's ID (starts only)            */
+);                                  /* returns size of the payload (bytes)  */
+
+void make_record(                   /* describe a canned event              */
+    EVENT_RECORD*       record,     /* record to fill                       */
+    const GUID*         provider,   /* provider that sent the event         */
+    USHORT              id,         /* event's kind                         */
+    LPVOID              data,       /* payload                              */
+    USHORT              size        /* size of the payload (bytes)          */
+);
+
+void test_exits(                    /* check decoding exits                 */
+    void
+);
+
+void test_ignored(                  /* check records that are not decoded   */
+    void
+);
+
+void test_starts(                   /* check decoding starts                */
+    void
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_change_type    change;     /* decoded start or exit                */
+    BYTE                data[ EVENTS_TEST_SIZE ];
+                                    /* payload                              */
+    EVENT_RECORD        record;     /* canned event                         */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked.
+    ------------------------------------------------------------------*/
+    make_record(
+        &record,
+        &events_provider,
+        EVENTS_TEST_START,
+        data,
+        ( USHORT ) make_payload( data, EVENTS_TEST_START, 1, 2 )
+    );
+    TEST_CHECK( proc_events_decode( NULL, &change ) == ERR_USAGE );
+    TEST_CHECK( proc_events_decode( &record, NULL ) == ERR_USAGE );
+
+    /*------------------------------------------------------------------
+    Run each group of checks.
+    ------------------------------------------------------------------*/
+    test_starts();
+    test_exits();
+    test_ignored();
+    return test_result( "proc_events_test" );
+}
+
+
+/*==========================================================================*/
+DWORD make_payload(                 /* lay out an event's fields            */
+    LPBYTE              data,       /* payload to fill                      */
+    USHORT              id,         /* EVENTS_TEST_START or                 */
+                                    /* EVENTS_TEST_STOP                     */
+    DWORD               process_id, /* process ID                           */
+    DWORD               parent_id   /* parent's ID (starts only)            */
+) {                                 /* returns size of the payload (bytes)  */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    FILETIME            created;    /* creation time                        */
+    DWORD               value;      /* field being laid out                 */
+
+    /*------------------------------------------------------------------
+    Both events start with the process ID and its creation time, packed
+    with no padding.
+    ------------------------------------------------------------------*/
+    memset( data, 0xCC, EVENTS_TEST_SIZE );
+    created.dwLowDateTime  = 0x89ABCDEF ^ process_id;
+    created.dwHighDateTime = 0x01D00000 + process_id;
+    memcpy( data, &process_id, sizeof( DWORD ) );
+    memcpy( ( data + 4 ), &created, sizeof( FILETIME ) );
+
+    /*------------------------------------------------------------------
+    A start goes on with the parent's ID, the session ID, its flags,
+    and the image name.  An exit goes on with the exit time and code.
+    ------------------------------------------------------------------*/
+    if( id == EVENTS_TEST_START ) {
+        memcpy( ( data + 12 ), &parent_id, sizeof( DWORD ) );
+        value = process_id % 3;
+        memcpy( ( data + 16 ), &value, sizeof( DWORD ) );
+        value = 0;
+        memcpy( ( data + 20 ), &value, sizeof( DWORD ) );
+        memcpy( ( data + 24 ), "\\Device\\a.exe", 14 );
+        return 38;
+    }
+    created.dwHighDateTime += 1;
+    memcpy( ( data + 12 ), &created, sizeof( FILETIME ) );
+    value = 259;
+    memcpy( ( data + 20 ), &value, sizeof( DWORD ) );
+    return 24;
+}
+
+
+/*==========================================================================*/
+void make_record(                   /* describe a canned event              */
+    EVENT_RECORD*       record,     /* record to fill                       */
+    const GUID*         provider,   /* provider that sent the event         */
+    USHORT              id,         /* event's kind                         */
+    LPVOID              data,       /* payload                              */
+    USHORT              size        /* size of the payload (bytes)          */
+) {
+
+    /*------------------------------------------------------------------
+    Only the fields a consumer looks at are filled.
+    ------------------------------------------------------------------*/
+    memset( record, 0, sizeof( EVENT_RECORD ) );
+    record->EventHeader.ProviderId         = *provider;
+    record->EventHeader.EventDescriptor.Id = id;
+    record->UserData                       = data;
+    record->UserDataLength                 = size;
+
+}
+
+
+/*==========================================================================*/
+void test_exits(                    /* check decoding exits                 */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_change_type    change;     /* decoded exit                         */
+    BYTE                data[ EVENTS_TEST_SIZE + 1 ];
+                                    /* payload, and room to misalign it     */
+    DWORD               i;          /* payload offset                       */
+    EVENT_RECORD        record;     /* canned event                         */
+    DWORD               size;       /* size of the payload (bytes)          */
+
+    /*------------------------------------------------------------------
+    An exit gives the process ID and creation time, which identify the
+    process, and nothing of its parent or session.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < 2; ++i ) {
+        size = make_payload( ( data + i ), EVENTS_TEST_STOP, 5120, 0 );
+        make_record(
+            &record,
+            &events_provider,
+            EVENTS_TEST_STOP,
+            ( data + i ),
+            ( USHORT ) size
+        );
+        memset( &change, 0xAA, sizeof( change ) );
+        TEST_CHECK( proc_events_decode( &record, &change ) == ERR_OK );
+        TEST_CHECK( change.started == FALSE );
+        TEST_CHECK( change.record.id == 5120 );
+        TEST_CHECK( change.record.start_time.dwLowDateTime
+                    == ( 0x89ABCDEF ^ 5120 ) );
+        TEST_CHECK( change.record.start_time.dwHighDateTime
+                    == ( 0x01D00000 + 5120 ) );
+        TEST_CHECK( change.record.parent == 0 );
+        TEST_CHECK( change.record.session == 0 );
+        TEST_CHECK( change.record.owner == PROC_SNAPSHOT_NONE );
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_ignored(                  /* check records that are not decoded   */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_change_type    change;     /* decoded start or exit                */
+    BYTE                data[ EVENTS_TEST_SIZE ];
+                                    /* payload                              */
+    EVENT_RECORD        record;     /* canned event                         */
+    DWORD               size;       /* size of the payload (bytes)          */
+
+    /*------------------------------------------------------------------
+    Other providers' events, and the provider's other kinds of event,
+    are not starts or exits.
+    ------------------------------------------------------------------*/
+    size = make_payload( data, EVENTS_TEST_START, 44, 4 );
+    make_record(
+        &record,
+        &events_other,
+        EVENTS_TEST_START,
+        data,
+        ( USHORT ) size
+    );
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_NOT_FOUND );
+    make_record(
+        &record,
+        &events_provider,
+        EVENTS_TEST_IMAGE,
+        data,
+        ( USHORT ) size
+    );
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_NOT_FOUND );
+    make_record( &record, &events_provider, 0, data, ( USHORT ) size );
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_NOT_FOUND );
+
+    /*------------------------------------------------------------------
+    A start or exit too short to hold the process ID and creation time
+    is refused.
+    ------------------------------------------------------------------*/
+    make_record( &record, &events_provider, EVENTS_TEST_START, data, 11 );
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_FORMAT );
+    make_record( &record, &events_provider, EVENTS_TEST_STOP, data, 4 );
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_FORMAT );
+    make_record( &record, &events_provider, EVENTS_TEST_STOP, NULL, 0 );
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_FORMAT );
+
+}
+
+
+/*==========================================================================*/
+void test_starts(                   /* check decoding starts                */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_change_type    change;     /* decoded start                        */
+    BYTE                data[ EVENTS_TEST_SIZE + 1 ];
+                                    /* payload, and room to misalign it     */
+    DWORD               i;          /* payload offset                       */
+    EVENT_RECORD        record;     /* canned event                         */
+    DWORD               size;       /* size of the payload (bytes)          */
+
+    /*------------------------------------------------------------------
+    A whole start gives the process, its creation time, its parent, and
+    its session.  Nothing is known of its owner yet.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < 2; ++i ) {
+        size = make_payload( ( data + i ), EVENTS_TEST_START, 7004, 652 );
+        make_record(
+            &record,
+            &events_provider,
+            EVENTS_TEST_START,
+            ( data + i ),
+            ( USHORT ) size
+        );
+        memset( &change, 0xAA, sizeof( change ) );
+        TEST_CHECK( proc_events_decode( &record, &change ) == ERR_OK );
+        TEST_CHECK( change.started != FALSE );
+        TEST_CHECK( change.record.id == 7004 );
+        TEST_CHECK( change.record.start_time.dwLowDateTime
+                    == ( 0x89ABCDEF ^ 7004 ) );
+        TEST_CHECK( change.record.start_time.dwHighDateTime
+                    == ( 0x01D00000 + 7004 ) );
+        TEST_CHECK( change.record.parent == 652 );
+        TEST_CHECK( change.record.session == ( 7004 % 3 ) );
+        TEST_CHECK( change.record.owner == PROC_SNAPSHOT_NONE );
+        TEST_CHECK( change.record.image == 0 );
+    }
+
+    /*------------------------------------------------------------------
+    A start cut short after the creation time, or part way through the
+    session ID, still gives the process, but not its parent or session.
+    ------------------------------------------------------------------*/
+    make_payload( data, EVENTS_TEST_START, 9000, 4 );
+    make_record( &record, &events_provider, EVENTS_TEST_START, data, 12 );
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_OK );
+    TEST_CHECK( change.started != FALSE );
+    TEST_CHECK( change.record.id == 9000 );
+    TEST_CHECK( change.record.parent == 0 );
+    TEST_CHECK( change.record.session == 0 );
+    record.UserDataLength = 19;
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_OK );
+    TEST_CHECK( change.record.parent == 0 );
+    record.UserDataLength = 20;
+    TEST_CHECK( proc_events_decode( &record, &change ) == ERR_OK );
+    TEST_CHECK( change.record.parent == 4 );
+    TEST_CHECK( change.record.session == ( 9000 % 3 ) );
+
+}
+
@@ -0,0 +1,397 @@
+/*****************************************************************************
+
+proc_volume_test.c
+
+NT Device Path Translation Tests
+
+Most checks run against a table of device prefixes injected by hand
+(marked built, so translating never queries a device): volumes whose
+numbers share leading digits, a drive whose device lies inside another's,
+a mapped network drive, bare UNC paths, and paths that must be left
+alone.  Every translated path must be rewritten in place, ending where it
+did.  The rest check the table built from this machine's drives: its
+order, that it is kept while the drive mask is unchanged, and that every
+drive's own device translates back to it.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include <winternl.h>
+
+#include "proc_volume.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define VOLUME_FAKE         L"\\Device\\WinsessionTestVolume"
+                                    /* device no drive is mapped to         */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct volume_case_s {      /* path translation case type           */
+    LPCWSTR             path;       /* native path                          */
+    LPCWSTR             expected;   /* expected DOS path, or NULL if the    */
+                                    /* path must be left alone              */
+} volume_case_type;
+
+typedef struct volume_device_s {    /* injected drive mapping type          */
+    WCHAR               letter;     /* DOS drive letter                     */
+    LPCWSTR             device;     /* NT device prefix                     */
+} volume_device_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const volume_device_type volume_devices[] = {
+    { L'Z', L"\\Device\\LanmanRedirector\\;Z:0000000000012345"
+            L"\\server\\share" },
+    { L'M', L"\\Device\\HarddiskVolume3\\mnt" },
+    { L'E', L"\\Device\\HarddiskVolume10" },
+    { L'C', L"\\Device\\HarddiskVolume3" },
+    { L'D', L"\\Device\\HarddiskVolume1" }
+};                                  /* longest first, as a refresh keeps    */
+                                    /* them                                 */
+
+static const volume_case_type volume_cases[] = {
+    { L"\\Device\\HarddiskVolume3\\Windows\\notepad.exe",
+      L"C:\\Windows\\notepad.exe" },
+    { L"\\Device\\HarddiskVolume3\\", L"C:\\" },
+    { L"\\Device\\HarddiskVolume3", L"C:" },
+    { L"\\Device\\HarddiskVolume1\\a.exe", L"D:\\a.exe" },
+    { L"\\Device\\HarddiskVolume10\\a.exe", L"E:\\a.exe" },
+    { L"\\Device\\HarddiskVolume11\\a.exe", NULL },
+    { L"\\Device\\HarddiskVolume30\\a.exe", NULL },
+    { L"\\Device\\HarddiskVolume3\\mnt\\a.exe", L"M:\\a.exe" },
+    { L"\\Device\\HarddiskVolume3\\mntx\\a.exe", L"C:\\mntx\\a.exe" },
+    { L"\\Device\\LanmanRedirector\\;Z:0000000000012345\\server\\share"
+      L"\\tool.exe", L"Z:\\tool.exe" },
+    { L"\\Device\\LanmanRedirector\\;Z:0000000000012345\\server\\other"
+      L"\\tool.exe", NULL },
+    { L"\\Device\\Mup\\server\\share\\tool.exe",
+      L"\\\\server\\share\\tool.exe" },
+    { L"\\Device\\Mupx\\server\\share\\tool.exe", NULL },
+    { L"\\device\\harddiskvolume3\\a.exe", NULL },
+    { L"\\Device\\Hard", NULL },
+    { L"C:\\Windows\\notepad.exe", NULL },
+    { L"", NULL }
+};
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL check_translate(               /* check translating one path           */
+    proc_volume_table_type*
+                        table,      /* volume translation table             */
+    LPCWSTR             path,       /* native path                          */
+    LPCWSTR             expected    /* expected DOS path, or NULL if the    */
+                                    /* path must be left alone              */
+);                                  /* returns TRUE if it translated as     */
+                                    /* expected                             */
+
+void inject_table(                  /* fill a table with the test devices   */
+    proc_volume_table_type*
+                        table       /* returned volume translation table    */
+);
+
+void test_injected(                 /* check the injected devices           */
+    void
+);
+
+void test_refresh(                  /* check the table of this machine      */
+    void
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    UNICODE_STRING      path;       /* path without a buffer                */
+    proc_volume_table_type
+                        table;      /* volume translation table             */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked.
+    ------------------------------------------------------------------*/
+    inject_table( &table );
+    memset( &path, 0, sizeof( path ) );
+    TEST_CHECK( proc_volume_refresh( NULL ) == ERR_USAGE );
+    TEST_CHECK( proc_volume_translate( NULL, &path ) == FALSE );
+    TEST_CHECK( proc_volume_translate( &table, NULL ) == FALSE );
+    TEST_CHECK( proc_volume_translate( &table, &path ) == FALSE );
+
+    /*------------------------------------------------------------------
+    Run each group of checks.
+    ------------------------------------------------------------------*/
+    test_injected();
+    test_refresh();
+    return test_result( "proc_volume_test" );
+}
+
+
+/*==========================================================================*/
+BOOL check_translate(               /* check translating one path           */
+    proc_volume_table_type*
+                        table,      /* volume translation table             */
+    LPCWSTR             path,       /* native path                          */
+    LPCWSTR             expected    /* expected DOS path, or NULL if the    */
+                                    /* path must be left alone              */
+) {                                 /* returns TRUE if it translated as     */
+                                    /* expected                             */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    WCHAR               buffer[ MAX_PATH ];
+                                    /* path, rewritten in place             */
+    USHORT              length;     /* length of the path (characters)      */
+    BOOL                result;     /* result of translating                */
+    UNICODE_STRING      string;     /* path being translated                */
+
+    /*------------------------------------------------------------------
+    Translate a copy of the path.
+    ------------------------------------------------------------------*/
+    length = ( USHORT ) wcslen( path );
+    wcscpy( buffer, path );
+    string.Buffer        = buffer;
+    string.Length        = length * sizeof( WCHAR );
+    string.MaximumLength = ( length + 1 ) * sizeof( WCHAR );
+    result = proc_volume_translate( table, &string );
+
+    /*------------------------------------------------------------------
+    A path that is left alone is not touched.
+    ------------------------------------------------------------------*/
+    if( expected == NULL ) {
+        return ( TEST_CHECK( result == FALSE )
+              && TEST_CHECK( string.Buffer == buffer )
+              && TEST_CHECK( string.Length == ( length * sizeof( WCHAR ) ) )
+              && TEST_CHECK( wcscmp( buffer, path ) == 0 ) )
+             ? TRUE : FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    A translated path starts later in the same buffer, and still ends
+    (and leaves the same room) where it did.
+    ------------------------------------------------------------------*/
+    return ( TEST_CHECK( result != FALSE )
+          && TEST_CHECK(
+                string.Length == ( wcslen( expected ) * sizeof( WCHAR ) )
+             )
+          && TEST_CHECK( memcmp(
+                string.Buffer,
+                expected,
+                string.Length
+             ) == 0 )
+          && TEST_CHECK(
+                ( string.Buffer + ( string.Length / sizeof( WCHAR ) ) )
+                == ( buffer + length )
+             )
+          && TEST_CHECK(
+                ( string.MaximumLength - string.Length ) == sizeof( WCHAR )
+             ) )
+         ? TRUE : FALSE;
+}
+
+
+/*==========================================================================*/
+void inject_table(                  /* fill a table with the test devices   */
+    proc_volume_table_type*
+                        table       /* returned volume translation table    */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* device index                         */
+
+    /*------------------------------------------------------------------
+    Mark the table built, so translating never refreshes it.
+    ------------------------------------------------------------------*/
+    proc_volume_init( table );
+    for( i = 0;
+         i < ( sizeof( volume_devices ) / sizeof( volume_devices[ 0 ] ) );
+         ++i ) {
+        table->entries[ i ].letter = volume_devices[ i ].letter;
+        table->entries[ i ].length
+            = ( USHORT ) wcslen( volume_devices[ i ].device );
+        wcscpy( table->entries[ i ].device, volume_devices[ i ].device );
+    }
+    table->count = i;
+    table->valid = TRUE;
+
+}
+
+
+/*==========================================================================*/
+void test_injected(                 /* check the injected devices           */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    WCHAR               buffer[ MAX_PATH ];
+                                    /* path longer than its string          */
+    DWORD               i;          /* case index                           */
+    UNICODE_STRING      string;     /* part of the path                     */
+    proc_volume_table_type
+                        table;      /* volume translation table             */
+
+    /*------------------------------------------------------------------
+    Translate every case.
+    ------------------------------------------------------------------*/
+    inject_table( &table );
+    for( i = 0; i < ( sizeof( volume_cases ) / sizeof( volume_cases[ 0 ] ) );
+         ++i ) {
+        check_translate(
+            &table,
+            volume_cases[ i ].path,
+            volume_cases[ i ].expected
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Only the string's length is matched, not the text past it.
+    ------------------------------------------------------------------*/
+    wcscpy( buffer, L"\\Device\\HarddiskVolume30\\a.exe" );
+    string.Buffer        = buffer;
+    string.Length        = ( USHORT ) ( wcslen( L"\\Device\\HarddiskVolume3" )
+                         * sizeof( WCHAR ) );
+    string.MaximumLength = string.Length;
+    TEST_CHECK( proc_volume_translate( &table, &string ) != FALSE );
+    TEST_CHECK( string.Length == ( 2 * sizeof( WCHAR ) ) );
+    TEST_CHECK( memcmp( string.Buffer, L"C:", string.Length ) == 0 );
+
+    /*------------------------------------------------------------------
+    Without its devices, only UNC paths are translated.
+    ------------------------------------------------------------------*/
+    table.count = 0;
+    check_translate( &table, volume_cases[ 0 ].path, NULL );
+    check_translate(
+        &table,
+        L"\\Device\\Mup\\server\\share\\tool.exe",
+        L"\\\\server\\share\\tool.exe"
+    );
+
+}
+
+
+/*==========================================================================*/
+void test_refresh(                  /* check the table of this machine      */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of this machine's mappings    */
+    proc_volume_entry_type*
+                        entry;      /* mapping being checked                */
+    WCHAR               expected[ 16 ];
+                                    /* translation of a device's path       */
+    DWORD               i;          /* mapping index                        */
+    DWORD               k;          /* earlier mapping index                */
+    DWORD               letters;    /* drive letters seen                   */
+    WCHAR               path[ MAX_PATH ];
+                                    /* path on a device                     */
+    proc_volume_table_type
+                        table;      /* volume translation table             */
+
+    /*------------------------------------------------------------------
+    A table is built on its first use.
+    ------------------------------------------------------------------*/
+    proc_volume_init( &table );
+    TEST_CHECK( table.valid == FALSE );
+    check_translate( &table, L"C:\\Windows\\notepad.exe", NULL );
+    TEST_CHECK( table.valid != FALSE );
+
+    /*------------------------------------------------------------------
+    Every mapping is for one of the drives, with a native prefix, and
+    longer prefixes come first.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( proc_volume_refresh( &table ) == ERR_OK );
+    TEST_CHECK( table.drives == GetLogicalDrives() );
+    TEST_CHECK( table.count <= PROC_VOLUME_DRIVES );
+    letters = 0;
+    for( i = 0; i < table.count; ++i ) {
+        entry = &( table.entries[ i ] );
+        if( ( TEST_CHECK( ( entry->letter >= L'A' )
+                       && ( entry->letter <= L'Z' ) ) == FALSE )
+         || ( TEST_CHECK( ( table.drives
+                          & ( 1UL << ( entry->letter - L'A' ) ) ) != 0 )
+              == FALSE )
+         || ( TEST_CHECK( ( letters
+                          & ( 1UL << ( entry->letter - L'A' ) ) ) == 0 )
+              == FALSE ) ) {
+            continue;
+        }
+        letters |= 1UL << ( entry->letter - L'A' );
+        TEST_CHECK( entry->length > 2 );
+        TEST_CHECK( entry->length == wcslen( entry->device ) );
+        TEST_CHECK( ( i == 0 )
+                 || ( table.entries[ i - 1 ].length >= entry->length ) );
+
+        /*--------------------------------------------------------------
+        A path on the device translates to the first drive mapped to
+        that device.
+        --------------------------------------------------------------*/
+        if( ( entry->length + 8 ) >= MAX_PATH ) {
+            continue;
+        }
+        for( k = 0; k < i; ++k ) {
+            if( wcscmp( table.entries[ k ].device, entry->device ) == 0 ) {
+                break;
+            }
+        }
+        wcscpy( path, entry->device );
+        wcscat( path, L"\\a.exe" );
+        wcscpy( expected, L"?:\\a.exe" );
+        expected[ 0 ] = table.entries[ k ].letter;
+        check_translate( &table, path, expected );
+    }
+
+    /*------------------------------------------------------------------
+    The table is kept while the drive mask is unchanged, until it is
+    invalidated.
+    ------------------------------------------------------------------*/
+    count                      = table.count;
+    table.count                = 1;
+    table.entries[ 0 ].letter  = L'Q';
+    table.entries[ 0 ].length  = ( USHORT ) wcslen( VOLUME_FAKE );
+    wcscpy( table.entries[ 0 ].device, VOLUME_FAKE );
+    TEST_CHECK( proc_volume_refresh( &table ) == ERR_OK );
+    TEST_CHECK( table.count == 1 );
+    check_translate( &table, ( VOLUME_FAKE L"\\a.exe" ), L"Q:\\a.exe" );
+    proc_volume_invalidate( &table );
+    TEST_CHECK( table.valid == FALSE );
+    TEST_CHECK( proc_volume_refresh( &table ) == ERR_OK );
+    TEST_CHECK( table.valid != FALSE );
+    TEST_CHECK( table.count == count );
+    check_translate( &table, ( VOLUME_FAKE L"\\a.exe" ), NULL );
+
+}
+
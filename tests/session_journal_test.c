@@ -0,0 +1,573 @@
+/*****************************************************************************
+
+session_journal_test.c
+
+Session Autosave Journal Tests
+
+Desktops are captured from a stand-in process index: two hundred windows,
+each owned by a process with a fixed image and arguments.  Capturing and
+saving twice with nothing changed must leave the journal untouched, and
+moving one window must append only a few hundred bytes.  A journal of a
+checkpoint followed by dozens of changes (windows moving, closing,
+opening, and running other commands) must replay to the last desktop
+saved, including when a torn entry, or an entry whose hash holds but whose
+items do not, follows the last good one.  Reopening the journal drops such
+a tail, and later saves replay after it.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "session_journal.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define JOURNAL_TEST_NAME   _T( "winsession_test.jnl" )
+                                    /* journal file, in the temporary       */
+                                    /* directory                            */
+
+#define JOURNAL_TEST_WINDOWS ( 200 )
+                                    /* windows on the desktop               */
+
+#define JOURNAL_TEST_ROUNDS ( 80 )  /* changes saved after the checkpoint   */
+                                    /* (more than one checkpoint's worth)   */
+
+#define JOURNAL_TEST_QUIET  ( 300 ) /* most bytes a save moving one window  */
+                                    /* may append                           */
+
+#define JOURNAL_TEST_CHANGES ( 2 )  /* kind of an entry listing changes     */
+#define JOURNAL_TEST_TEXT   ( 2 )   /* item holds the window's text         */
+#define JOURNAL_TEST_REMOVED ( 4 )  /* the window closed                    */
+
+#define JOURNAL_TEST_WINDOW( _index ) \
+    ( ( HWND ) ( ULONG_PTR ) ( 0x20000 + ( ( _index ) * 4 ) ) )
+                                    /* handle of a listed window            */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static TCHAR journal_path[ MAX_PATH ];
+                                    /* path to the journal file             */
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL append_bytes(                  /* append raw bytes to the journal      */
+    const BYTE*         data,       /* bytes to append                      */
+    DWORD               size        /* number of bytes                      */
+);                                  /* returns TRUE if they were written    */
+
+DWORD journal_bytes(                /* get the size of the journal file     */
+    void
+);                                  /* returns size (bytes), or 0           */
+
+error_type make_match(              /* build a stand-in process index       */
+    proc_match_type*    match       /* index object to initialize           */
+);                                  /* returns error code                   */
+
+BOOL same_state(                    /* compare two saved desktops           */
+    const session_journal_state_type*
+                        left,       /* left-hand desktop                    */
+    const session_journal_state_type*
+                        right       /* right-hand desktop                   */
+);                                  /* returns TRUE if they are equal       */
+
+void test_quiet(                    /* check saves when nothing moves       */
+    proc_match_type*    match       /* stand-in process index               */
+);
+
+void test_replay(                   /* check replaying changes              */
+    proc_match_type*    match       /* stand-in process index               */
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    session_journal_type
+                        journal;    /* open journal                         */
+    proc_match_type     match;      /* stand-in process index               */
+    session_journal_state_type
+                        state;      /* saved desktop                        */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked.
+    ------------------------------------------------------------------*/
+    memset( &state, 0, sizeof( state ) );
+    if( TEST_CHECK( GetTempPath( ( MAX_PATH - 32 ), journal_path ) != 0 )
+        == FALSE ) {
+        return test_result( "session_journal_test" );
+    }
+    _tcscat( journal_path, JOURNAL_TEST_NAME );
+    DeleteFile( journal_path );
+    TEST_CHECK( session_journal_open( NULL, journal_path ) == ERR_USAGE );
+    TEST_CHECK( session_journal_open( &journal, NULL ) == ERR_USAGE );
+    TEST_CHECK( session_journal_save( NULL, &state ) == ERR_USAGE );
+    TEST_CHECK( session_journal_capture( NULL, &state ) == ERR_USAGE );
+    TEST_CHECK( session_journal_recover( journal_path, NULL ) == ERR_USAGE );
+    TEST_CHECK( session_journal_recover( journal_path, &state )
+                == ERR_NOT_FOUND );
+
+    /*------------------------------------------------------------------
+    Run each group of checks on the same stand-in desktop.
+    ------------------------------------------------------------------*/
+    if( TEST_CHECK( make_match( &match ) == ERR_OK ) != FALSE ) {
+        test_quiet( &match );
+        test_replay( &match );
+    }
+    proc_match_free( &match );
+    DeleteFile( journal_path );
+    return test_result( "session_journal_test" );
+}
+
+
+/*==========================================================================*/
+BOOL append_bytes(                  /* append raw bytes to the journal      */
+    const BYTE*         data,       /* bytes to append                      */
+    DWORD               size        /* number of bytes                      */
+) {                                 /* returns TRUE if they were written    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              file;       /* journal file handle                  */
+    BOOL                result;     /* the bytes were written               */
+    DWORD               written;    /* number of bytes written              */
+
+    /*------------------------------------------------------------------
+    Write the bytes after everything in the file.
+    ------------------------------------------------------------------*/
+    file = CreateFile(
+        journal_path,
+        GENERIC_WRITE,
+        0,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if( file == INVALID_HANDLE_VALUE ) {
+        return FALSE;
+    }
+    result = ( SetFilePointer( file, 0, NULL, FILE_END )
+               != INVALID_SET_FILE_POINTER )
+          && ( WriteFile( file, data, size, &written, NULL ) != FALSE )
+          && ( written == size );
+    CloseHandle( file );
+    return result;
+}
+
+
+/*==========================================================================*/
+DWORD journal_bytes(                /* get the size of the journal file     */
+    void
+) {                                 /* returns size (bytes), or 0           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              file;       /* journal file handle                  */
+    DWORD               size;       /* size of the file (bytes)             */
+
+    /*------------------------------------------------------------------
+    The journal may be open for appending while it is measured.
+    ------------------------------------------------------------------*/
+    file = CreateFile(
+        journal_path,
+        GENERIC_READ,
+        ( FILE_SHARE_READ | FILE_SHARE_WRITE ),
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if( file == INVALID_HANDLE_VALUE ) {
+        return 0;
+    }
+    size = GetFileSize( file, NULL );
+    CloseHandle( file );
+    return ( size == INVALID_FILE_SIZE ) ? 0 : size;
+}
+
+
+/*==========================================================================*/
+error_type make_match(              /* build a stand-in process index       */
+    proc_match_type*    match       /* index object to initialize           */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    proc_match_entry_type*
+                        entry;      /* process being added                  */
+    DWORD               i;          /* window index                         */
+    window_list_type*   list;       /* listed windows                       */
+    error_type          result;     /* result of internal operation         */
+    TCHAR               text[ 64 ]; /* string being interned                */
+    DWORD*              values;     /* process' command string IDs          */
+
+    /*------------------------------------------------------------------
+    Allocate one process for each window.
+    ------------------------------------------------------------------*/
+    memset( match, 0, sizeof( proc_match_type ) );
+    list   = &( match->windows );
+    result = proc_pool_init( &( match->strings ) );
+    if( result == ERR_OK ) {
+        result = proc_arena_init( &( match->ids ), 0 );
+    }
+    if( result != ERR_OK ) {
+        return result;
+    }
+    match->entries = ( proc_match_entry_type* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( JOURNAL_TEST_WINDOWS * sizeof( proc_match_entry_type ) )
+    );
+    list->windows = ( HWND* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( JOURNAL_TEST_WINDOWS * sizeof( HWND ) )
+    );
+    list->process_ids = ( DWORD* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( JOURNAL_TEST_WINDOWS * sizeof( DWORD ) )
+    );
+    list->rectangles = ( RECT* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( JOURNAL_TEST_WINDOWS * sizeof( RECT ) )
+    );
+    if( ( match->entries == NULL ) || ( list->windows == NULL )
+     || ( list->process_ids == NULL ) || ( list->rectangles == NULL ) ) {
+        return ERR_ALLOC;
+    }
+    match->count   = JOURNAL_TEST_WINDOWS;
+    list->count    = JOURNAL_TEST_WINDOWS;
+    list->capacity = JOURNAL_TEST_WINDOWS;
+
+    /*------------------------------------------------------------------
+    Each process runs one of a few programs, with its own arguments.
+    Processes are indexed by ID, and windows are listed in the reverse
+    order, the way Z order rarely matches either.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < JOURNAL_TEST_WINDOWS; ++i ) {
+        values = ( DWORD* ) proc_arena_alloc(
+            &( match->ids ),
+            ( 3 * sizeof( DWORD ) )
+        );
+        if( values == NULL ) {
+            return ERR_ALLOC;
+        }
+        entry = &( match->entries[ i ] );
+        _stprintf(
+            text,
+            _T( "C:\\Programs\\tool%lu.exe" ),
+            ( unsigned long ) ( i % 7 )
+        );
+        result = proc_pool_intern( &( match->strings ), text, &entry->image );
+        values[ 0 ] = entry->image;
+        if( result == ERR_OK ) {
+            result = proc_pool_intern(
+                &( match->strings ),
+                _T( "--profile" ),
+                &values[ 1 ]
+            );
+        }
+        _stprintf( text, _T( "work %lu" ), ( unsigned long ) i );
+        if( result == ERR_OK ) {
+            result = proc_pool_intern(
+                &( match->strings ),
+                text,
+                &values[ 2 ]
+            );
+        }
+        if( result != ERR_OK ) {
+            return result;
+        }
+        entry->id     = 100 + ( i * 4 );
+        entry->window = JOURNAL_TEST_WINDOW( i );
+        entry->count  = 3;
+        entry->values = values;
+        list->windows[ JOURNAL_TEST_WINDOWS - 1 - i ]     = entry->window;
+        list->process_ids[ JOURNAL_TEST_WINDOWS - 1 - i ] = entry->id;
+        SetRect(
+            &list->rectangles[ JOURNAL_TEST_WINDOWS - 1 - i ],
+            ( i * 3 ),
+            ( i * 2 ),
+            ( ( i * 3 ) + 640 ),
+            ( ( i * 2 ) + 480 )
+        );
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+BOOL same_state(                    /* compare two saved desktops           */
+    const session_journal_state_type*
+                        left,       /* left-hand desktop                    */
+    const session_journal_state_type*
+                        right       /* right-hand desktop                   */
+) {                                 /* returns TRUE if they are equal       */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* window index                         */
+    const session_journal_window_type*
+                        a;          /* left-hand window                     */
+    const session_journal_window_type*
+                        b;          /* right-hand window                    */
+
+    /*------------------------------------------------------------------
+    Both desktops list their windows in order of identity.
+    ------------------------------------------------------------------*/
+    if( left->count != right->count ) {
+        return FALSE;
+    }
+    for( i = 0; i < left->count; ++i ) {
+        a = &( left->windows[ i ] );
+        b = &( right->windows[ i ] );
+        if( ( a->id != b->id )
+         || ( EqualRect( &( a->rectangle ), &( b->rectangle ) ) == FALSE )
+         || ( a->length != b->length )
+         || ( a->hash != b->hash )
+         || ( memcmp( a->text, b->text, ( a->length * sizeof( TCHAR ) ) )
+              != 0 ) ) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+void test_quiet(                    /* check saves when nothing moves       */
+    proc_match_type*    match       /* stand-in process index               */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               first;      /* journal size after the checkpoint    */
+    session_journal_type
+                        journal;    /* open journal                         */
+    DWORD               sequence;   /* number of the next entry             */
+    session_journal_state_type
+                        state;      /* captured desktop                     */
+
+    /*------------------------------------------------------------------
+    The first save is a checkpoint of every window.
+    ------------------------------------------------------------------*/
+    memset( &state, 0, sizeof( state ) );
+    DeleteFile( journal_path );
+    if( TEST_CHECK( session_journal_open( &journal, journal_path ) == ERR_OK )
+        == FALSE ) {
+        return;
+    }
+    TEST_CHECK( session_journal_capture( match, &state ) == ERR_OK );
+    TEST_CHECK( state.count == JOURNAL_TEST_WINDOWS );
+    TEST_CHECK( session_journal_save( &journal, &state ) == ERR_OK );
+    first = journal_bytes();
+    TEST_CHECK( first > ( JOURNAL_TEST_WINDOWS * 32 ) );
+
+    /*------------------------------------------------------------------
+    Capturing again with nothing changed writes nothing.
+    ------------------------------------------------------------------*/
+    sequence = journal.sequence;
+    TEST_CHECK( session_journal_capture( match, &state ) == ERR_OK );
+    TEST_CHECK( session_journal_save( &journal, &state ) == ERR_OK );
+    TEST_CHECK( session_journal_capture( match, &state ) == ERR_OK );
+    TEST_CHECK( session_journal_save( &journal, &state ) == ERR_OK );
+    TEST_CHECK( journal_bytes() == first );
+    TEST_CHECK( journal.size == first );
+    TEST_CHECK( journal.sequence == sequence );
+
+    /*------------------------------------------------------------------
+    Moving one window writes just that window's rectangle.
+    ------------------------------------------------------------------*/
+    OffsetRect( &( match->windows.rectangles[ 17 ] ), 25, 0 );
+    TEST_CHECK( session_journal_capture( match, &state ) == ERR_OK );
+    TEST_CHECK( session_journal_save( &journal, &state ) == ERR_OK );
+    TEST_CHECK( journal_bytes() > first );
+    TEST_CHECK( journal_bytes() <= ( first + JOURNAL_TEST_QUIET ) );
+    OffsetRect( &( match->windows.rectangles[ 17 ] ), -25, 0 );
+    session_journal_free( &state );
+    session_journal_close( &journal );
+
+}
+
+
+/*==========================================================================*/
+void test_replay(                   /* check replaying changes              */
+    proc_match_type*    match       /* stand-in process index               */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               bad[ 11 ];  /* entry whose items do not fit it      */
+    DWORD               good;       /* size of the intact journal (bytes)   */
+    DWORD               hash;       /* FNV-1a hash of the bad entry         */
+    DWORD               i;          /* round or byte index                  */
+    session_journal_type
+                        journal;    /* open journal                         */
+    window_list_type*   list;       /* listed windows                       */
+    session_journal_state_type
+                        replayed;   /* desktop rebuilt from the journal     */
+    session_journal_state_type
+                        state;      /* last captured desktop                */
+    HWND                swap;       /* window taken out of the list         */
+    const DWORD*        values;     /* command strings being swapped        */
+
+    /*------------------------------------------------------------------
+    Save a checkpoint, then a change in every round: a window moves,
+    a window closes or opens again, or a window's process runs another
+    command.
+    ------------------------------------------------------------------*/
+    memset( &state, 0, sizeof( state ) );
+    memset( &replayed, 0, sizeof( replayed ) );
+    list = &( match->windows );
+    DeleteFile( journal_path );
+    if( TEST_CHECK( session_journal_open( &journal, journal_path ) == ERR_OK )
+        == FALSE ) {
+        return;
+    }
+    for( i = 0; i < JOURNAL_TEST_ROUNDS; ++i ) {
+        switch( i % 4 ) {
+            case 1:
+                OffsetRect(
+                    &( list->rectangles[ ( i * 7 ) % list->count ] ),
+                    ( LONG ) i,
+                    -1
+                );
+                break;
+            case 2:
+                swap = list->windows[ i % list->count ];
+                list->windows[ i % list->count ] =
+                    list->windows[ list->count - 1 ];
+                list->windows[ list->count - 1 ] = swap;
+                list->count -= ( list->count > 100 ) ? 1 : 0;
+                break;
+            case 3:
+                values = match->entries[ ( i * 3 ) % match->count ].values;
+                match->entries[ ( i * 3 ) % match->count ].values =
+                    match->entries[ i % match->count ].values;
+                match->entries[ i % match->count ].values = values;
+                break;
+            default:
+                list->count += ( list->count < JOURNAL_TEST_WINDOWS )
+                             ? 1 : 0;
+                break;
+        }
+        TEST_CHECK( session_journal_capture( match, &state ) == ERR_OK );
+        TEST_CHECK( session_journal_save( &journal, &state ) == ERR_OK );
+    }
+    TEST_CHECK( same_state( &( journal.state ), &state ) );
+    session_journal_close( &journal );
+
+    /*------------------------------------------------------------------
+    Replay rebuilds the last desktop saved.
+    ------------------------------------------------------------------*/
+    good = journal_bytes();
+    TEST_CHECK( session_journal_recover( journal_path, &replayed )
+                == ERR_OK );
+    TEST_CHECK( same_state( &replayed, &state ) );
+    session_journal_free( &replayed );
+
+    /*------------------------------------------------------------------
+    An entry cut off part way (its size claims more than follows) is
+    ignored.
+    ------------------------------------------------------------------*/
+    memset( bad, 0, sizeof( bad ) );
+    bad[ 0 ] = 64;
+    bad[ 1 ] = JOURNAL_TEST_CHANGES;
+    TEST_CHECK( append_bytes( ( const BYTE* ) bad, 28 ) );
+    TEST_CHECK( session_journal_recover( journal_path, &replayed )
+                == ERR_OK );
+    TEST_CHECK( same_state( &replayed, &state ) );
+    session_journal_free( &replayed );
+
+    /*------------------------------------------------------------------
+    Reopening the journal drops the tail.  Then append an entry whose
+    hash holds, but whose second item's text is not terminated.  Its
+    first item (closing a saved window) must not be applied either.
+    The entry is laid out the way session_journal.c writes one: its
+    size, kind, number, item count, and hash, then each item's
+    identity and flags, and an item's text length and padded text.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( session_journal_open( &journal, journal_path ) == ERR_OK );
+    session_journal_close( &journal );
+    TEST_CHECK( journal_bytes() == good );
+    bad[ 0 ]  = sizeof( bad );
+    bad[ 1 ]  = JOURNAL_TEST_CHANGES;
+    bad[ 2 ]  = JOURNAL_TEST_ROUNDS;
+    bad[ 3 ]  = 2;
+    bad[ 5 ]  = state.windows[ 0 ].id;
+    bad[ 6 ]  = JOURNAL_TEST_REMOVED;
+    bad[ 7 ]  = state.windows[ 1 ].id;
+    bad[ 8 ]  = JOURNAL_TEST_TEXT;
+    bad[ 9 ]  = 4 / sizeof( TCHAR );
+    memset( &bad[ 10 ], 'x', sizeof( DWORD ) );
+    hash = 2166136261UL;
+    for( i = 0; i < sizeof( bad ); ++i ) {
+        if( ( i < ( 4 * sizeof( DWORD ) ) )
+         || ( i >= ( 5 * sizeof( DWORD ) ) ) ) {
+            hash = ( hash ^ ( ( const BYTE* ) bad )[ i ] ) * 16777619UL;
+        }
+    }
+    bad[ 4 ] = hash;
+    TEST_CHECK( append_bytes( ( const BYTE* ) bad, sizeof( bad ) ) );
+    TEST_CHECK( session_journal_recover( journal_path, &replayed )
+                == ERR_OK );
+    TEST_CHECK( same_state( &replayed, &state ) );
+    session_journal_free( &replayed );
+
+    /*------------------------------------------------------------------
+    A journal reopened after such a tail writes over it, and replays
+    to the next desktop saved.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( session_journal_open( &journal, journal_path ) == ERR_OK );
+    TEST_CHECK( same_state( &( journal.state ), &state ) );
+    OffsetRect( &( list->rectangles[ 0 ] ), 0, 40 );
+    TEST_CHECK( session_journal_capture( match, &state ) == ERR_OK );
+    TEST_CHECK( session_journal_save( &journal, &state ) == ERR_OK );
+    session_journal_close( &journal );
+    TEST_CHECK( session_journal_recover( journal_path, &replayed )
+                == ERR_OK );
+    TEST_CHECK( same_state( &replayed, &state ) );
+    session_journal_free( &replayed );
+    session_journal_free( &state );
+
+}
+
@@ -0,0 +1,85 @@
+/*****************************************************************************
+
+test_check.c
+
+Unit Test Checks
+
+Every test program counts its checks here, and prints each one that fails
+with its place in the source.  A test program's exit status is non-zero
+when any check failed, so `make check` stops at the first failing program.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <windows.h>
+
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static DWORD test_checks;           /* number of checks made                */
+static DWORD test_failures;         /* number of checks that failed         */
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+BOOL test_check(                    /* count a check, and report a failure  */
+    BOOL                passed,     /* the check held                       */
+    LPCSTR              file,       /* source file of the check             */
+    int                 line,       /* source line of the check             */
+    LPCSTR              text        /* text of the check                    */
+) {                                 /* returns the passed argument          */
+
+    /*------------------------------------------------------------------
+    Count the check, and report it if it failed.
+    ------------------------------------------------------------------*/
+    test_checks += 1;
+    if( passed == FALSE ) {
+        test_failures += 1;
+        fprintf( stderr, "%s:%d: check failed: %s\n", file, line, text );
+    }
+    return passed;
+}
+
+
+/*==========================================================================*/
+int test_result(                    /* report the checks made so far        */
+    LPCSTR              name        /* name of the test program             */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Summarize the checks.
+    ------------------------------------------------------------------*/
+    printf(
+        "%s: %lu checks, %lu failed\n",
+        name,
+        ( unsigned long ) test_checks,
+        ( unsigned long ) test_failures
+    );
+    return ( test_failures == 0 ) ? 0 : 1;
+}
+
@@ -0,0 +1,52 @@
+/*****************************************************************************
+
+test_check.h
+
+Unit Test Check Interface
+
+*****************************************************************************/
+
+#ifndef _TEST_CHECK_H
+#define _TEST_CHECK_H
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <windows.h>
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define TEST_CHECK( _condition ) \
+    test_check( ( ( _condition ) ? TRUE : FALSE ), __FILE__, __LINE__, \
+        #_condition )
+                                    /* check a condition, and report it if  */
+                                    /* it does not hold                     */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Interface Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL test_check(                    /* count a check, and report a failure  */
+    BOOL                passed,     /* the check held                       */
+    LPCSTR              file,       /* source file of the check             */
+    int                 line,       /* source line of the check             */
+    LPCSTR              text        /* text of the check                    */
+);                                  /* returns the passed argument          */
+
+int test_result(                    /* report the checks made so far        */
+    LPCSTR              name        /* name of the test program             */
+);                                  /* returns program exit status          */
+
+#endif  /* _TEST_CHECK_H */
+
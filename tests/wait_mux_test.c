@@ -0,0 +1,416 @@
+/*****************************************************************************
+
+wait_mux_test.c
+
+Handle Wait Multiplexer Tests
+
+Five hundred manual-reset events stand in for process handles, spread over
+eight helper threads.  Events in different shards are signaled one at a
+time and all at once, and each must be reported by its own tag exactly
+once.  Removed handles must never be reported, whether they were signaled
+before or after their removal, and the handles moved into their slots must
+still be.  Removed tags can be added again, with the same handle or a new
+one.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "wait_mux.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define MUX_TEST_HANDLES    ( 500 ) /* events waited on                     */
+
+#define MUX_TEST_WAIT       ( 2000 )/* limit on a wait that must succeed    */
+                                    /* (ms)                                 */
+
+#define MUX_TEST_QUIET      ( 100 ) /* time given to a helper to report a   */
+                                    /* handle that must not be (ms)         */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static HANDLE mux_events[ MUX_TEST_HANDLES ];
+                                    /* events standing in for processes     */
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL check_quiet(                   /* check that nothing is reported       */
+    wait_mux_type*      mux         /* multiplexer object                   */
+);                                  /* returns TRUE if nothing was          */
+
+BOOL check_reported(                /* signal a tag, and check it is the    */
+                                    /* next one reported                    */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* tag to signal                        */
+);                                  /* returns TRUE if it was reported      */
+
+void test_all(                      /* check every handle signaled at once  */
+    wait_mux_type*      mux         /* multiplexer object                   */
+);
+
+void test_readd(                    /* check tags added again               */
+    wait_mux_type*      mux         /* multiplexer object                   */
+);
+
+void test_remove(                   /* check removed handles                */
+    wait_mux_type*      mux         /* multiplexer object                   */
+);
+
+void test_shards(                   /* check one handle in each shard       */
+    wait_mux_type*      mux         /* multiplexer object                   */
+);
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* tag                                  */
+    wait_mux_type       mux;        /* multiplexer object                   */
+    DWORD               tag;        /* returned tag                         */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( wait_mux_open( NULL, 1 ) == ERR_USAGE );
+    TEST_CHECK( wait_mux_open( &mux, 0 ) == ERR_USAGE );
+    for( i = 0; i < MUX_TEST_HANDLES; ++i ) {
+        mux_events[ i ] = CreateEvent( NULL, TRUE, FALSE, NULL );
+        if( TEST_CHECK( mux_events[ i ] != NULL ) == FALSE ) {
+            return test_result( "wait_mux_test" );
+        }
+    }
+    if( TEST_CHECK( wait_mux_open( &mux, MUX_TEST_HANDLES ) == ERR_OK )
+        == FALSE ) {
+        return test_result( "wait_mux_test" );
+    }
+    TEST_CHECK( mux.shard_count
+                == ( ( MUX_TEST_HANDLES + WAIT_MUX_SHARD - 1 )
+                     / WAIT_MUX_SHARD ) );
+    TEST_CHECK( wait_mux_add( NULL, 0, mux_events[ 0 ] ) == ERR_USAGE );
+    TEST_CHECK( wait_mux_add( &mux, MUX_TEST_HANDLES, mux_events[ 0 ] )
+                == ERR_USAGE );
+    TEST_CHECK( wait_mux_add( &mux, 0, NULL ) == ERR_USAGE );
+    TEST_CHECK( wait_mux_next( NULL, 0, &tag ) == ERR_USAGE );
+    TEST_CHECK( wait_mux_next( &mux, 0, NULL ) == ERR_USAGE );
+    TEST_CHECK( wait_mux_next( &mux, 0, &tag ) == ERR_TIMEOUT );
+    wait_mux_remove( &mux, MUX_TEST_HANDLES );
+    wait_mux_remove( &mux, 0 );
+
+    /*------------------------------------------------------------------
+    Wait on every event, filling every shard.  A tag is waited on once
+    at a time.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < MUX_TEST_HANDLES; ++i ) {
+        TEST_CHECK( wait_mux_add( &mux, i, mux_events[ i ] ) == ERR_OK );
+    }
+    TEST_CHECK( wait_mux_add( &mux, 7, mux_events[ 7 ] ) == ERR_USAGE );
+    for( i = 0; i < mux.shard_count; ++i ) {
+        TEST_CHECK( mux.shards[ i ].thread != NULL );
+    }
+    TEST_CHECK( mux.shards[ 0 ].count == WAIT_MUX_SHARD );
+    TEST_CHECK( mux.shards[ mux.shard_count - 1 ].count
+                == ( MUX_TEST_HANDLES % WAIT_MUX_SHARD ) );
+
+    /*------------------------------------------------------------------
+    Run each group of checks.
+    ------------------------------------------------------------------*/
+    test_shards( &mux );
+    test_remove( &mux );
+    test_readd( &mux );
+    test_all( &mux );
+    wait_mux_close( &mux );
+    for( i = 0; i < MUX_TEST_HANDLES; ++i ) {
+        CloseHandle( mux_events[ i ] );
+    }
+    return test_result( "wait_mux_test" );
+}
+
+
+/*==========================================================================*/
+BOOL check_quiet(                   /* check that nothing is reported       */
+    wait_mux_type*      mux         /* multiplexer object                   */
+) {                                 /* returns TRUE if nothing was          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               tag;        /* returned tag                         */
+
+    /*------------------------------------------------------------------
+    Give the helpers time to report anything they would.
+    ------------------------------------------------------------------*/
+    tag = WAIT_MUX_NONE;
+    if( TEST_CHECK( wait_mux_next( mux, MUX_TEST_QUIET, &tag )
+                    == ERR_TIMEOUT ) == FALSE ) {
+        printf( "  reported tag %lu\n", ( unsigned long ) tag );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+BOOL check_reported(                /* signal a tag, and check it is the    */
+                                    /* next one reported                    */
+    wait_mux_type*      mux,        /* multiplexer object                   */
+    DWORD               tag         /* tag to signal                        */
+) {                                 /* returns TRUE if it was reported      */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               found;      /* returned tag                         */
+
+    /*------------------------------------------------------------------
+    Signal the tag's event, and take the next report.
+    ------------------------------------------------------------------*/
+    SetEvent( mux_events[ tag ] );
+    found = WAIT_MUX_NONE;
+    if( ( TEST_CHECK( wait_mux_next( mux, MUX_TEST_WAIT, &found )
+                      == ERR_OK ) == FALSE )
+     || ( TEST_CHECK( found == tag ) == FALSE ) ) {
+        printf(
+            "  signaled tag %lu, reported %lu\n",
+            ( unsigned long ) tag,
+            ( unsigned long ) found
+        );
+        return FALSE;
+    }
+    TEST_CHECK( mux->slots[ tag ] == WAIT_MUX_NONE );
+    return TRUE;
+}
+
+
+/*==========================================================================*/
+void test_all(                      /* check every handle signaled at once  */
+    wait_mux_type*      mux         /* multiplexer object                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* tag                                  */
+    DWORD               reported;   /* number of tags reported              */
+    BYTE                seen[ MUX_TEST_HANDLES ];
+                                    /* each tag has been reported           */
+    DWORD               tag;        /* returned tag                         */
+
+    /*------------------------------------------------------------------
+    Reset every event, and wait on all of them again.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < MUX_TEST_HANDLES; ++i ) {
+        ResetEvent( mux_events[ i ] );
+        if( mux->slots[ i ] == WAIT_MUX_NONE ) {
+            TEST_CHECK( wait_mux_add( mux, i, mux_events[ i ] ) == ERR_OK );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Signal them all at once.  Each tag is reported exactly once.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < MUX_TEST_HANDLES; ++i ) {
+        SetEvent( mux_events[ ( i * 7 ) % MUX_TEST_HANDLES ] );
+    }
+    memset( seen, 0, sizeof( seen ) );
+    for( reported = 0; reported < MUX_TEST_HANDLES; ++reported ) {
+        if( ( TEST_CHECK( wait_mux_next( mux, MUX_TEST_WAIT, &tag )
+                          == ERR_OK ) == FALSE )
+         || ( TEST_CHECK( tag < MUX_TEST_HANDLES ) == FALSE )
+         || ( TEST_CHECK( seen[ tag ] == 0 ) == FALSE ) ) {
+            break;
+        }
+        seen[ tag ] = 1;
+    }
+    TEST_CHECK( reported == MUX_TEST_HANDLES );
+    check_quiet( mux );
+    for( i = 0; i < mux->shard_count; ++i ) {
+        TEST_CHECK( mux->shards[ i ].count == 0 );
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_readd(                    /* check tags added again               */
+    wait_mux_type*      mux         /* multiplexer object                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              other;      /* a second event for one tag           */
+    DWORD               tag;        /* returned tag                         */
+
+    /*------------------------------------------------------------------
+    A removed tag can be added again with its own handle, or with a new
+    one, and is then reported.
+    ------------------------------------------------------------------*/
+    wait_mux_remove( mux, 64 );
+    ResetEvent( mux_events[ 64 ] );
+    TEST_CHECK( wait_mux_add( mux, 64, mux_events[ 64 ] ) == ERR_OK );
+    check_reported( mux, 64 );
+    other = CreateEvent( NULL, TRUE, FALSE, NULL );
+    if( TEST_CHECK( other != NULL ) != FALSE ) {
+        wait_mux_remove( mux, 130 );
+        TEST_CHECK( wait_mux_add( mux, 130, other ) == ERR_OK );
+        SetEvent( mux_events[ 130 ] );
+        check_quiet( mux );
+        SetEvent( other );
+        TEST_CHECK( wait_mux_next( mux, MUX_TEST_WAIT, &tag ) == ERR_OK );
+        TEST_CHECK( tag == 130 );
+    }
+
+    /*------------------------------------------------------------------
+    A tag reported and taken can be added again at once.
+    ------------------------------------------------------------------*/
+    ResetEvent( mux_events[ 64 ] );
+    TEST_CHECK( wait_mux_add( mux, 64, mux_events[ 64 ] ) == ERR_OK );
+    check_reported( mux, 64 );
+
+    /*------------------------------------------------------------------
+    Adding a tag that was signaled but not yet taken drops the signal.
+    ------------------------------------------------------------------*/
+    ResetEvent( mux_events[ 64 ] );
+    TEST_CHECK( wait_mux_add( mux, 64, mux_events[ 64 ] ) == ERR_OK );
+    SetEvent( mux_events[ 64 ] );
+    while( mux->slots[ 64 ] != WAIT_MUX_DONE ) {
+        Sleep( 1 );
+    }
+    ResetEvent( mux_events[ 64 ] );
+    TEST_CHECK( wait_mux_add( mux, 64, mux_events[ 64 ] ) == ERR_OK );
+    check_quiet( mux );
+    check_reported( mux, 64 );
+    if( other != NULL ) {
+        CloseHandle( other );
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_remove(                   /* check removed handles                */
+    wait_mux_type*      mux         /* multiplexer object                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* shard index                          */
+    DWORD               last;       /* tag in a shard's last slot           */
+
+    /*------------------------------------------------------------------
+    Remove a tag from the middle of each shard, then signal it.  The
+    tag that was in the shard's last slot moves into its place, and is
+    still reported.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < mux->shard_count; ++i ) {
+        ResetEvent( mux_events[ ( i * WAIT_MUX_SHARD ) + 1 ] );
+        TEST_CHECK( wait_mux_add(
+            mux,
+            ( ( i * WAIT_MUX_SHARD ) + 1 ),
+            mux_events[ ( i * WAIT_MUX_SHARD ) + 1 ]
+        ) == ERR_OK );
+    }
+    for( i = 0; i < mux->shard_count; ++i ) {
+        last = mux->shards[ i ].tags[ mux->shards[ i ].count - 1 ];
+        wait_mux_remove( mux, ( ( i * WAIT_MUX_SHARD ) + 2 ) );
+        TEST_CHECK( mux->slots[ ( i * WAIT_MUX_SHARD ) + 2 ]
+                    == WAIT_MUX_NONE );
+        SetEvent( mux_events[ ( i * WAIT_MUX_SHARD ) + 2 ] );
+        check_quiet( mux );
+        check_reported( mux, last );
+    }
+
+    /*------------------------------------------------------------------
+    A tag signaled and removed before it is taken is never reported,
+    whether or not its helper saw it first.
+    ------------------------------------------------------------------*/
+    SetEvent( mux_events[ 3 ] );
+    while( mux->slots[ 3 ] != WAIT_MUX_DONE ) {
+        Sleep( 1 );
+    }
+    wait_mux_remove( mux, 3 );
+    SetEvent( mux_events[ 200 ] );
+    wait_mux_remove( mux, 200 );
+    check_quiet( mux );
+
+    /*------------------------------------------------------------------
+    A removed tag leaves the other tags of its shard reported.
+    ------------------------------------------------------------------*/
+    check_reported( mux, 4 );
+    check_reported( mux, 201 );
+
+}
+
+
+/*==========================================================================*/
+void test_shards(                   /* check one handle in each shard       */
+    wait_mux_type*      mux         /* multiplexer object                   */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* shard index                          */
+    DWORD               tag;        /* returned tag                         */
+
+    /*------------------------------------------------------------------
+    Signal the first handle of each shard, last shard first, one at a
+    time.  A reported tag stops being waited on, so its event staying
+    signaled does not report it again.
+    ------------------------------------------------------------------*/
+    for( i = mux->shard_count; i > 0; --i ) {
+        if( check_reported( mux, ( ( i - 1 ) * WAIT_MUX_SHARD ) ) == FALSE ) {
+            break;
+        }
+    }
+    check_quiet( mux );
+    TEST_CHECK( check_reported( mux, ( MUX_TEST_HANDLES - 1 ) ) );
+
+    /*------------------------------------------------------------------
+    Signal one handle in each shard together.  Each is reported once.
+    ------------------------------------------------------------------*/
+    for( i = 0; i < mux->shard_count; ++i ) {
+        SetEvent( mux_events[ ( i * WAIT_MUX_SHARD ) + 1 ] );
+    }
+    for( i = 0; i < mux->shard_count; ++i ) {
+        tag = WAIT_MUX_NONE;
+        TEST_CHECK( wait_mux_next( mux, MUX_TEST_WAIT, &tag ) == ERR_OK );
+        TEST_CHECK( ( tag % WAIT_MUX_SHARD ) == 1 );
+        TEST_CHECK( mux->slots[ tag ] == WAIT_MUX_NONE );
+    }
+    check_quiet( mux );
+
+}
+
@@ -0,0 +1,670 @@
+/*****************************************************************************
+
+window_watch_test.c
+
+Window Appearance Watching Tests
+
+The watch is fed by a stand-in event source: the tests queue the windows
+to be shown, and the source delivers them the next time the watch waits,
+and answers image queries from a fixed table of processes.  The checks
+cover matching by process ID, windows shown before their entry was added,
+matching by image when a program hands off to another process (oldest
+entry first, ignoring case and directory), processes that exit with and
+without an image to wait for, cancelled entries, waking and time limits,
+and a thousand entries shown in random order.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "window_watch.h"
+#include "test_check.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define STAND_EVENTS        ( 1024 )/* most windows queued at once          */
+
+#define STAND_MANY          ( 1000 )/* entries in the largest watch         */
+
+#define STAND_WINDOW( _index ) \
+    ( ( HWND ) ( ULONG_PTR ) ( 0x1000 + ( _index ) ) )
+                                    /* handle of a shown window             */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct stand_event_s {      /* queued window type                   */
+    HWND                window;     /* window to show                       */
+    DWORD               process_id; /* process that owns it                 */
+} stand_event_type;
+
+typedef struct stand_image_s {      /* process image type                   */
+    DWORD               process_id; /* process ID                           */
+    LPCTSTR             image;      /* image path                           */
+} stand_image_type;
+
+typedef struct stand_in_s {         /* stand-in event source state type     */
+    stand_event_type    events[ STAND_EVENTS ];
+                                    /* windows to show on the next wait     */
+    DWORD               count;      /* number of queued windows             */
+    DWORD               images;     /* number of image queries              */
+    DWORD               opened;     /* times the source was opened          */
+    DWORD               closed;     /* times the source was closed          */
+} stand_in_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const stand_image_type stand_images[] = {
+    { 200, _T( "D:\\Apps\\LAUNCHER.EXE" ) },
+    { 204, _T( "launcher.exe" ) },
+    { 208, _T( "C:\\Apps\\launcher.exe.bak" ) },
+    { 212, _T( "C:\\Other\\editor.exe" ) }
+};                                  /* processes the source can query       */
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+BOOL check_next(                    /* check the next matched window        */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               timeout,    /* limit on the wait (ms)               */
+    DWORD               tag,        /* expected tag                         */
+    HWND                window      /* expected window, or NULL             */
+);                                  /* returns TRUE if it was as expected   */
+
+void stand_close(                   /* count the source closed              */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch       /* watch being closed                   */
+);
+
+error_type stand_image(             /* look up a process' image             */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch,      /* watch asking                         */
+    DWORD               process_id, /* process ID                           */
+    LPTSTR              image,      /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+);                                  /* returns error code                   */
+
+error_type stand_open(              /* count the source opened              */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch       /* watch to deliver to                  */
+);                                  /* returns error code                   */
+
+void stand_show(                    /* queue a window to be shown           */
+    HWND                window,     /* window to show                       */
+    DWORD               process_id  /* process that owns it                 */
+);
+
+void stand_wait(                    /* show the queued windows, or wait     */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch,      /* watch to deliver to                  */
+    DWORD               timeout     /* limit on the wait (ms), or INFINITE  */
+);
+
+void test_exit(                     /* check processes that exit            */
+    void
+);
+
+void test_image(                    /* check matching by image              */
+    void
+);
+
+void test_many(                     /* check many entries                   */
+    void
+);
+
+void test_process(                  /* check matching by process ID         */
+    void
+);
+
+void test_wake(                     /* check waking and time limits         */
+    void
+);
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static stand_in_type stand;         /* stand-in event source state          */
+
+static const window_watch_source_type stand_source = {
+    stand_open,
+    stand_wait,
+    stand_image,
+    stand_close,
+    &stand
+};                                  /* delivers the queued windows          */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    window_watch_source_type
+                        source;     /* source without a wait function       */
+    DWORD               tag;        /* returned tag                         */
+    window_watch_type   watch;      /* watch object                         */
+    HWND                window;     /* returned window                      */
+
+    /*------------------------------------------------------------------
+    Interface usage is checked, and the source is opened and closed
+    with the watch.
+    ------------------------------------------------------------------*/
+    source      = stand_source;
+    source.wait = NULL;
+    TEST_CHECK( window_watch_open( NULL, &stand_source, 1 ) == ERR_USAGE );
+    TEST_CHECK( window_watch_open( &watch, &stand_source, 0 ) == ERR_USAGE );
+    TEST_CHECK( window_watch_open( &watch, &source, 1 ) == ERR_USAGE );
+    TEST_CHECK( stand.opened == 0 );
+    if( TEST_CHECK( window_watch_open( &watch, &stand_source, 2 ) == ERR_OK )
+        != FALSE ) {
+        TEST_CHECK( stand.opened == 1 );
+        TEST_CHECK( window_watch_add( NULL, 0, 100, NULL, NULL )
+                    == ERR_USAGE );
+        TEST_CHECK( window_watch_add( &watch, 2, 100, NULL, NULL )
+                    == ERR_USAGE );
+        TEST_CHECK( window_watch_add( &watch, 1, 100, NULL, NULL )
+                    == ERR_OK );
+        TEST_CHECK( window_watch_add( &watch, 1, 104, NULL, NULL )
+                    == ERR_USAGE );
+        TEST_CHECK( window_watch_next( &watch, 0, NULL, &window )
+                    == ERR_USAGE );
+        TEST_CHECK( window_watch_next( &watch, 0, &tag, NULL )
+                    == ERR_USAGE );
+        window_watch_close( &watch );
+        TEST_CHECK( stand.closed == 1 );
+    }
+
+    /*------------------------------------------------------------------
+    Run each group of checks.
+    ------------------------------------------------------------------*/
+    test_process();
+    test_image();
+    test_exit();
+    test_wake();
+    test_many();
+    return test_result( "window_watch_test" );
+}
+
+
+/*==========================================================================*/
+BOOL check_next(                    /* check the next matched window        */
+    window_watch_type*  watch,      /* watch object                         */
+    DWORD               timeout,    /* limit on the wait (ms)               */
+    DWORD               tag,        /* expected tag                         */
+    HWND                window      /* expected window, or NULL             */
+) {                                 /* returns TRUE if it was as expected   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HWND                found;      /* returned window                      */
+    DWORD               found_tag;  /* returned tag                         */
+
+    /*------------------------------------------------------------------
+    Take the next entry, and compare it.
+    ------------------------------------------------------------------*/
+    return ( TEST_CHECK( window_watch_next(
+                watch,
+                timeout,
+                &found_tag,
+                &found
+             ) == ERR_OK )
+          && TEST_CHECK( found_tag == tag )
+          && TEST_CHECK( found == window ) )
+         ? TRUE : FALSE;
+}
+
+
+/*==========================================================================*/
+void stand_close(                   /* count the source closed              */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch       /* watch being closed                   */
+) {
+
+    /*------------------------------------------------------------------
+    Windows still queued are dropped with the watch.
+    ------------------------------------------------------------------*/
+    ( ( stand_in_type* ) context )->closed += 1;
+    ( ( stand_in_type* ) context )->count   = 0;
+
+}
+
+
+/*==========================================================================*/
+error_type stand_image(             /* look up a process' image             */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch,      /* watch asking                         */
+    DWORD               process_id, /* process ID                           */
+    LPTSTR              image,      /* destination string                   */
+    DWORD               size        /* size of destination (characters)     */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* process index                        */
+
+    /*------------------------------------------------------------------
+    Only the processes in the table can be queried.
+    ------------------------------------------------------------------*/
+    ( ( stand_in_type* ) context )->images += 1;
+    for( i = 0; i < ( sizeof( stand_images ) / sizeof( stand_images[ 0 ] ) );
+         ++i ) {
+        if( ( stand_images[ i ].process_id == process_id )
+         && ( _tcslen( stand_images[ i ].image ) < size ) ) {
+            _tcscpy( image, stand_images[ i ].image );
+            return ERR_OK;
+        }
+    }
+    return ERR_NOT_FOUND;
+}
+
+
+/*==========================================================================*/
+error_type stand_open(              /* count the source opened              */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch       /* watch to deliver to                  */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Nothing is queued for a new watch.
+    ------------------------------------------------------------------*/
+    ( ( stand_in_type* ) context )->opened += 1;
+    ( ( stand_in_type* ) context )->count   = 0;
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+void stand_show(                    /* queue a window to be shown           */
+    HWND                window,     /* window to show                       */
+    DWORD               process_id  /* process that owns it                 */
+) {
+
+    /*------------------------------------------------------------------
+    The window is shown the next time the watch waits.
+    ------------------------------------------------------------------*/
+    if( TEST_CHECK( stand.count < STAND_EVENTS ) != FALSE ) {
+        stand.events[ stand.count ].window     = window;
+        stand.events[ stand.count ].process_id = process_id;
+        stand.count += 1;
+    }
+
+}
+
+
+/*==========================================================================*/
+void stand_wait(                    /* show the queued windows, or wait     */
+    LPVOID              context,    /* stand-in state                       */
+    window_watch_type*  watch,      /* watch to deliver to                  */
+    DWORD               timeout     /* limit on the wait (ms), or INFINITE  */
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              handles[ 2 ];
+                                    /* wake event and process exits         */
+    DWORD               i;          /* window index                         */
+    stand_in_type*      state;      /* stand-in state                       */
+
+    /*------------------------------------------------------------------
+    Show every queued window, in order.
+    ------------------------------------------------------------------*/
+    state = ( stand_in_type* ) context;
+    if( state->count > 0 ) {
+        for( i = 0; i < state->count; ++i ) {
+            window_watch_post(
+                watch,
+                state->events[ i ].window,
+                state->events[ i ].process_id
+            );
+        }
+        state->count = 0;
+        return;
+    }
+
+    /*------------------------------------------------------------------
+    Otherwise, wait as the usual source does, without a message queue.
+    ------------------------------------------------------------------*/
+    handles[ 0 ] = watch->wake;
+    handles[ 1 ] = watch->exits.ready;
+    WaitForMultipleObjects( 2, handles, FALSE, timeout );
+
+}
+
+
+/*==========================================================================*/
+void test_exit(                     /* check processes that exit            */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              process;    /* stands in for a process handle       */
+    DWORD               start;      /* tick count before an exit            */
+    DWORD               tag;        /* returned tag                         */
+    window_watch_type   watch;      /* watch object                         */
+    HWND                window;     /* returned window                      */
+
+    /*------------------------------------------------------------------
+    A process whose handle is signaled has no window, and its entry has
+    no image to wait for.
+    ------------------------------------------------------------------*/
+    if( TEST_CHECK( window_watch_open( &watch, &stand_source, 4 ) == ERR_OK )
+        == FALSE ) {
+        return;
+    }
+    process = CreateEvent( NULL, TRUE, FALSE, NULL );
+    if( TEST_CHECK( process != NULL ) != FALSE ) {
+        TEST_CHECK( window_watch_add( &watch, 0, 100, process, NULL )
+                    == ERR_OK );
+        TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                    == ERR_TIMEOUT );
+        SetEvent( process );
+        check_next( &watch, INFINITE, 0, NULL );
+    }
+
+    /*------------------------------------------------------------------
+    An exit reported by process ID does the same.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( window_watch_add( &watch, 1, 104, NULL, NULL ) == ERR_OK );
+    window_watch_exited( &watch, 104 );
+    check_next( &watch, 0, 1, NULL );
+
+    /*------------------------------------------------------------------
+    An entry with an image waits for another process with that image
+    to show the window.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( window_watch_add( &watch, 2, 108, NULL,
+        _T( "C:\\Apps\\launcher.exe" ) ) == ERR_OK );
+    window_watch_exited( &watch, 108 );
+    TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                == ERR_TIMEOUT );
+    stand_show( STAND_WINDOW( 2 ), 200 );
+    check_next( &watch, 0, 2, STAND_WINDOW( 2 ) );
+
+    /*------------------------------------------------------------------
+    If none does, the entry is done without a window once the hand-off
+    time is up.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( window_watch_add( &watch, 3, 112, NULL,
+        _T( "C:\\Apps\\launcher.exe" ) ) == ERR_OK );
+    start = GetTickCount();
+    window_watch_exited( &watch, 112 );
+    check_next( &watch, INFINITE, 3, NULL );
+    TEST_CHECK( ( GetTickCount() - start ) >= WINDOW_WATCH_HANDOFF );
+    TEST_CHECK( watch.exiting == 0 );
+    window_watch_close( &watch );
+    if( process != NULL ) {
+        CloseHandle( process );
+    }
+
+}
+
+
+/*==========================================================================*/
+void test_image(                    /* check matching by image              */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               tag;        /* returned tag                         */
+    window_watch_type   watch;      /* watch object                         */
+    HWND                window;     /* returned window                      */
+
+    /*------------------------------------------------------------------
+    Windows of other processes are matched by image base name, in any
+    case, to the entry that has waited longest.
+    ------------------------------------------------------------------*/
+    if( TEST_CHECK( window_watch_open( &watch, &stand_source, 4 ) == ERR_OK )
+        == FALSE ) {
+        return;
+    }
+    TEST_CHECK( window_watch_add( &watch, 0, 100, NULL,
+        _T( "C:\\Apps\\launcher.exe" ) ) == ERR_OK );
+    TEST_CHECK( window_watch_add( &watch, 1, 104, NULL,
+        _T( "launcher.exe" ) ) == ERR_OK );
+    TEST_CHECK( window_watch_add( &watch, 2, 108, NULL,
+        _T( "C:/Other/Editor.exe" ) ) == ERR_OK );
+    TEST_CHECK( watch.images == 3 );
+    stand_show( STAND_WINDOW( 0 ), 200 );
+    stand_show( STAND_WINDOW( 1 ), 204 );
+    check_next( &watch, 0, 0, STAND_WINDOW( 0 ) );
+    check_next( &watch, 0, 1, STAND_WINDOW( 1 ) );
+
+    /*------------------------------------------------------------------
+    A longer name, or a process that can not be queried, does not
+    match.  A full path matches a name written with forward slashes.
+    ------------------------------------------------------------------*/
+    stand_show( STAND_WINDOW( 8 ), 208 );
+    stand_show( STAND_WINDOW( 9 ), 999 );
+    TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                == ERR_TIMEOUT );
+    stand.images = 0;
+    stand_show( STAND_WINDOW( 2 ), 212 );
+    check_next( &watch, 0, 2, STAND_WINDOW( 2 ) );
+    TEST_CHECK( stand.images == 1 );
+
+    /*------------------------------------------------------------------
+    Processes are not queried once no entry has an image.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( watch.images == 0 );
+    TEST_CHECK( window_watch_add( &watch, 3, 116, NULL, NULL ) == ERR_OK );
+    stand.images = 0;
+    stand_show( STAND_WINDOW( 10 ), 200 );
+    TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                == ERR_TIMEOUT );
+    TEST_CHECK( stand.images == 0 );
+    window_watch_close( &watch );
+
+}
+
+
+/*==========================================================================*/
+void test_many(                     /* check many entries                   */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* entry index                          */
+    DWORD               k;          /* shuffled index                       */
+    DWORD               order[ STAND_MANY ];
+                                    /* order the windows are shown in       */
+    DWORD               seed;       /* random number state                  */
+    DWORD               swap;       /* entry being shuffled                 */
+    window_watch_type   watch;      /* watch object                         */
+
+    /*------------------------------------------------------------------
+    Add every entry, with process IDs spaced as Windows spaces them,
+    then show their windows in random order.  Each window matches its
+    own entry, in the order shown.
+    ------------------------------------------------------------------*/
+    if( TEST_CHECK(
+            window_watch_open( &watch, &stand_source, STAND_MANY ) == ERR_OK
+        ) == FALSE ) {
+        return;
+    }
+    for( i = 0; i < STAND_MANY; ++i ) {
+        TEST_CHECK( window_watch_add(
+            &watch,
+            i,
+            ( 1000 + ( 4 * i ) ),
+            NULL,
+            NULL
+        ) == ERR_OK );
+        order[ i ] = i;
+    }
+    seed = 7;
+    for( i = STAND_MANY - 1; i > 0; --i ) {
+        seed       = ( seed * 1103515245 ) + 12345;
+        k          = ( seed >> 16 ) % ( i + 1 );
+        swap       = order[ i ];
+        order[ i ] = order[ k ];
+        order[ k ] = swap;
+    }
+    for( i = 0; i < STAND_MANY; ++i ) {
+        stand_show(
+            STAND_WINDOW( order[ i ] ),
+            ( 1000 + ( 4 * order[ i ] ) )
+        );
+    }
+    for( i = 0; i < STAND_MANY; ++i ) {
+        if( check_next( &watch, 0, order[ i ], STAND_WINDOW( order[ i ] ) )
+            == FALSE ) {
+            break;
+        }
+    }
+    window_watch_close( &watch );
+
+}
+
+
+/*==========================================================================*/
+void test_process(                  /* check matching by process ID         */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* window index                         */
+    DWORD               tag;        /* returned tag                         */
+    window_watch_type   watch;      /* watch object                         */
+    HWND                window;     /* returned window                      */
+
+    /*------------------------------------------------------------------
+    Windows match the entries of their processes, in the order shown.
+    Without images, no process is queried.
+    ------------------------------------------------------------------*/
+    if( TEST_CHECK( window_watch_open( &watch, &stand_source, 8 ) == ERR_OK )
+        == FALSE ) {
+        return;
+    }
+    stand.images = 0;
+    for( i = 0; i < 4; ++i ) {
+        TEST_CHECK( window_watch_add(
+            &watch,
+            i,
+            ( 100 + ( 4 * i ) ),
+            NULL,
+            NULL
+        ) == ERR_OK );
+    }
+    stand_show( STAND_WINDOW( 2 ), 108 );
+    stand_show( STAND_WINDOW( 9 ), 999 );
+    stand_show( STAND_WINDOW( 1 ), 104 );
+    check_next( &watch, 0, 2, STAND_WINDOW( 2 ) );
+    check_next( &watch, 0, 1, STAND_WINDOW( 1 ) );
+    TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                == ERR_TIMEOUT );
+    TEST_CHECK( stand.images == 0 );
+
+    /*------------------------------------------------------------------
+    A cancelled entry is not matched.  Its window, and a second window
+    of a matched process, are kept for entries added later.
+    ------------------------------------------------------------------*/
+    window_watch_cancel( &watch, 3 );
+    stand_show( STAND_WINDOW( 3 ), 112 );
+    stand_show( STAND_WINDOW( 5 ), 108 );
+    TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                == ERR_TIMEOUT );
+
+    /*------------------------------------------------------------------
+    A window shown before its entry was added matches at once.
+    ------------------------------------------------------------------*/
+    TEST_CHECK( window_watch_add( &watch, 4, 999, NULL, NULL ) == ERR_OK );
+    check_next( &watch, 0, 4, STAND_WINDOW( 9 ) );
+    TEST_CHECK( window_watch_add( &watch, 5, 108, NULL, NULL ) == ERR_OK );
+    check_next( &watch, 0, 5, STAND_WINDOW( 5 ) );
+
+    /*------------------------------------------------------------------
+    Only the most recent unmatched windows are kept.
+    ------------------------------------------------------------------*/
+    for( i = 0; i <= WINDOW_WATCH_ORPHANS; ++i ) {
+        stand_show( STAND_WINDOW( 100 + i ), ( 2000 + ( 4 * i ) ) );
+    }
+    TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                == ERR_TIMEOUT );
+    TEST_CHECK( window_watch_add( &watch, 6, 2000, NULL, NULL ) == ERR_OK );
+    TEST_CHECK( window_watch_next( &watch, 0, &tag, &window )
+                == ERR_TIMEOUT );
+    TEST_CHECK( window_watch_add(
+        &watch,
+        7,
+        ( 2000 + ( 4 * WINDOW_WATCH_ORPHANS ) ),
+        NULL,
+        NULL
+    ) == ERR_OK );
+    check_next( &watch, 0, 7, STAND_WINDOW( 100 + WINDOW_WATCH_ORPHANS ) );
+    window_watch_close( &watch );
+
+}
+
+
+/*==========================================================================*/
+void test_wake(                     /* check waking and time limits         */
+    void
+) {
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               start;      /* tick count before a wait             */
+    DWORD               tag;        /* returned tag                         */
+    window_watch_type   watch;      /* watch object                         */
+    HWND                window;     /* returned window                      */
+
+    /*------------------------------------------------------------------
+    A wait with nothing to match lasts its time limit, or until the
+    watch is woken.
+    ------------------------------------------------------------------*/
+    if( TEST_CHECK( window_watch_open( &watch, &stand_source, 1 ) == ERR_OK )
+        == FALSE ) {
+        return;
+    }
+    TEST_CHECK( window_watch_add( &watch, 0, 100, NULL, NULL ) == ERR_OK );
+    start = GetTickCount();
+    TEST_CHECK( window_watch_next( &watch, 50, &tag, &window )
+                == ERR_TIMEOUT );
+    TEST_CHECK( ( GetTickCount() - start ) >= 50 );
+    window_watch_wake( &watch );
+    TEST_CHECK( window_watch_next( &watch, INFINITE, &tag, &window )
+                == ERR_TIMEOUT );
+
+    /*------------------------------------------------------------------
+    A wait that was woken still takes in the windows already shown.
+    ------------------------------------------------------------------*/
+    window_watch_wake( &watch );
+    stand_show( STAND_WINDOW( 0 ), 100 );
+    check_next( &watch, INFINITE, 0, STAND_WINDOW( 0 ) );
+    window_watch_close( &watch );
+
+}
+
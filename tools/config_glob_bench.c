@@ -0,0 +1,254 @@
+/*****************************************************************************
+
+config_glob_bench.c
+
+Session Name Globbing Benchmark
+
+Times config_glob_match over synthetic session names such as
+"build-prod-01234", from 10,000 to 100,000 of them.  The name tables are
+built directly, sorted the way config_glob_init sorts them, so only the
+selection is timed.  Each case is a list of patterns of one shape: plain
+names, literal prefixes, patterns that run the automaton over the whole
+table or one prefix's range, and a mix of them.  The best of several runs
+is reported with the number of sessions selected.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_glob.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define BENCH_RUNS          ( 9 )   /* runs timed for each case             */
+
+#define BENCH_NAME_SIZE     ( 24 )  /* most characters in a name            */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct bench_case_s {       /* pattern list type                    */
+    LPCSTR              title;      /* what the patterns exercise           */
+    LPCTSTR             patterns[ 4 ];
+                                    /* patterns, ending with NULL           */
+} bench_case_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const DWORD bench_names[] = { 10000, 30000, 100000 };
+                                    /* session names in each case           */
+
+static LPCTSTR bench_teams[] = {
+    _T( "build" ), _T( "chat" ), _T( "db" ), _T( "docs" ),
+    _T( "mail" ), _T( "review" ), _T( "shell" ), _T( "web" )
+};                                  /* first part of each name              */
+
+static LPCTSTR bench_stages[] = {
+    _T( "dev" ), _T( "lab" ), _T( "prod" ), _T( "test" )
+};                                  /* second part of each name             */
+
+static const bench_case_type bench_cases[] = {
+    { "plain names",
+      { _T( "web-dev-00007" ), _T( "db-prod-01234" ), _T( "nope" ), NULL } },
+    { "prefix ranges",
+      { _T( "web-*" ), _T( "db-prod-*" ), NULL } },
+    { "everything",
+      { _T( "*" ), NULL } },
+    { "automaton, whole table",
+      { _T( "*-prod-*7" ), _T( "*?ab-*" ), NULL } },
+    { "automaton, one range",
+      { _T( "shell-?e*-*3?" ), NULL } },
+    { "mixed",
+      { _T( "docs-dev-00003" ), _T( "mail-*" ), _T( "*-test-0*9" ),
+        _T( "b*-l?b-*" ) } }
+};                                  /* pattern lists timed                  */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+double bench_match(                 /* time selecting sessions              */
+    config_glob_type*   glob,       /* session name table                   */
+    const bench_case_type*
+                        pattern_case,
+                                    /* patterns to select with              */
+    DWORD*              indices,    /* returned session indices             */
+    DWORD*              count       /* returned number of sessions          */
+);                                  /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time of a case (ms)             */
+    DWORD               count;      /* number of sessions selected          */
+    config_glob_type    glob;       /* session name table                   */
+    DWORD               i;          /* name case index                      */
+    DWORD*              indices;    /* selected session indices             */
+    DWORD               j;          /* pattern case index                   */
+    DWORD               k;          /* name index                           */
+    DWORD               most;       /* largest number of names              */
+    LPTSTR              text;       /* text of the names                    */
+
+    /*------------------------------------------------------------------
+    Allocate room for the largest table.
+    ------------------------------------------------------------------*/
+    most = bench_names[ ( sizeof( bench_names ) / sizeof( DWORD ) ) - 1 ];
+    glob.names = ( config_glob_name_type* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( most * sizeof( config_glob_name_type ) )
+    );
+    indices = ( DWORD* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( most * sizeof( DWORD ) )
+    );
+    text = ( LPTSTR ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( most * BENCH_NAME_SIZE * sizeof( TCHAR ) )
+    );
+    if( ( glob.names == NULL ) || ( indices == NULL ) || ( text == NULL ) ) {
+        fprintf( stderr, "unable to allocate the name table\n" );
+        return 1;
+    }
+    glob.block = NULL;
+
+    /*------------------------------------------------------------------
+    Time every pattern list on every size of table.
+    ------------------------------------------------------------------*/
+    printf( "   names  case                       selected   best (ms)\n" );
+    for( i = 0; i < ( sizeof( bench_names ) / sizeof( DWORD ) ); ++i ) {
+        for( k = 0; k < bench_names[ i ]; ++k ) {
+            glob.names[ k ].name  = text + ( k * BENCH_NAME_SIZE );
+            glob.names[ k ].index = k;
+            _stprintf(
+                ( text + ( k * BENCH_NAME_SIZE ) ),
+                _T( "%s-%s-%05lu" ),
+                bench_teams[ k % 8 ],
+                bench_stages[ ( k / 8 ) % 4 ],
+                ( unsigned long ) k
+            );
+        }
+        qsort(
+            glob.names,
+            bench_names[ i ],
+            sizeof( config_glob_name_type ),
+            config_glob_compare
+        );
+        glob.count = bench_names[ i ];
+        for( j = 0; j < ( sizeof( bench_cases ) / sizeof( bench_case_type ) );
+             ++j ) {
+            best = bench_match( &glob, &bench_cases[ j ], indices, &count );
+            if( best < 0 ) {
+                fprintf( stderr, "unable to select sessions\n" );
+                return 1;
+            }
+            printf(
+                "%8lu  %-24s  %9lu  %10.3f\n",
+                ( unsigned long ) bench_names[ i ],
+                bench_cases[ j ].title,
+                ( unsigned long ) count,
+                best
+            );
+        }
+    }
+
+    /*------------------------------------------------------------------
+    Release the table.
+    ------------------------------------------------------------------*/
+    HeapFree( GetProcessHeap(), 0, text );
+    HeapFree( GetProcessHeap(), 0, indices );
+    HeapFree( GetProcessHeap(), 0, glob.names );
+    return 0;
+}
+
+
+/*==========================================================================*/
+double bench_match(                 /* time selecting sessions              */
+    config_glob_type*   glob,       /* session name table                   */
+    const bench_case_type*
+                        pattern_case,
+                                    /* patterns to select with              */
+    DWORD*              indices,    /* returned session indices             */
+    DWORD*              count       /* returned number of sessions          */
+) {                                 /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time so far (ms)                */
+    LARGE_INTEGER       frequency;  /* performance counter frequency        */
+    DWORD               i;          /* run index                            */
+    DWORD               pattern_count;
+                                    /* number of patterns                   */
+    error_type          result;     /* result of a run                      */
+    LARGE_INTEGER       start;      /* counter before a run                 */
+    LARGE_INTEGER       stop;       /* counter after a run                  */
+    double              time;       /* time of a run (ms)                   */
+
+    /*------------------------------------------------------------------
+    Count the patterns.
+    ------------------------------------------------------------------*/
+    pattern_count = 0;
+    while( ( pattern_count < 4 )
+        && ( pattern_case->patterns[ pattern_count ] != NULL ) ) {
+        pattern_count += 1;
+    }
+
+    /*------------------------------------------------------------------
+    Each run is one selection, as a restore of those patterns does.
+    ------------------------------------------------------------------*/
+    QueryPerformanceFrequency( &frequency );
+    best = -1;
+    for( i = 0; i < BENCH_RUNS; ++i ) {
+        QueryPerformanceCounter( &start );
+        result = config_glob_match(
+            glob,
+            ( LPCTSTR* ) pattern_case->patterns,
+            pattern_count,
+            indices,
+            count,
+            NULL
+        );
+        QueryPerformanceCounter( &stop );
+        if( result != ERR_OK ) {
+            return -1;
+        }
+        time = ( ( double ) ( stop.QuadPart - start.QuadPart ) * 1000.0 )
+             / ( double ) frequency.QuadPart;
+        if( ( best < 0 ) || ( time < best ) ) {
+            best = time;
+        }
+    }
+    return best;
+}
+
@@ -0,0 +1,303 @@
+/*****************************************************************************
+
+config_index_bench.c
+
+Session Index Benchmark
+
+Times what a restore does before it launches anything (open the
+configuration, find a session by name, and load it) from the JSON text and
+from the compiled index.  The configurations are written to the temporary
+directory with 10 to 10,000 sessions of eight windows each, and removed
+afterwards.  The best of several runs is reported for each path, with the
+index's speedup.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "config_file.h"
+#include "config_index.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define BENCH_RUNS          ( 9 )   /* runs timed for each case             */
+
+#define BENCH_WINDOWS       ( 8 )   /* windows in each session              */
+
+#define BENCH_WINDOW_SIZE   ( 320 ) /* most text for a window (bytes)       */
+
+#define BENCH_NAME          _T( "winsession_bench.json" )
+                                    /* configuration file written           */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const DWORD bench_sessions[] = { 10, 100, 1000, 10000 };
+                                    /* sessions in each case                */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+double bench_load(                  /* time opening and loading a session   */
+    LPCTSTR             path,       /* path to the configuration            */
+    LPCTSTR             name,       /* session to load                      */
+    BOOL                indexed     /* the index must be used               */
+);                                  /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+error_type write_config(            /* write a synthetic configuration      */
+    LPCTSTR             path,       /* path to the configuration            */
+    DWORD               count       /* number of sessions                   */
+);                                  /* returns error code                   */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    config_file_type    config;     /* configuration opened from its text   */
+    DWORD               i;          /* case index                           */
+    TCHAR               index_path[ MAX_PATH ];
+                                    /* path to the compiled index           */
+    double              indexed;    /* best time from the index (ms)        */
+    TCHAR               name[ 32 ]; /* session loaded (the last one)        */
+    TCHAR               path[ MAX_PATH ];
+                                    /* path to the configuration            */
+    error_type          result;     /* result of internal operation         */
+    double              text;       /* best time from the text (ms)         */
+
+    /*------------------------------------------------------------------
+    Both files go in the temporary directory.
+    ------------------------------------------------------------------*/
+    if( ( GetTempPath( ( MAX_PATH - 32 ), path ) == 0 )
+     || ( config_index_path(
+            _tcscat( path, BENCH_NAME ),
+            index_path,
+            MAX_PATH
+        ) != ERR_OK ) ) {
+        fprintf( stderr, "unable to find the temporary directory\n" );
+        return 1;
+    }
+
+    /*------------------------------------------------------------------
+    Time each size from the text, then compile the index, and time it
+    from the index.
+    ------------------------------------------------------------------*/
+    printf( "sessions   text (ms)  index (ms)  speedup\n" );
+    result = ERR_OK;
+    for( i = 0; i < ( sizeof( bench_sessions ) / sizeof( DWORD ) ); ++i ) {
+        DeleteFile( index_path );
+        result = write_config( path, bench_sessions[ i ] );
+        if( result != ERR_OK ) {
+            fprintf( stderr, "unable to write configuration (%d)\n", result );
+            break;
+        }
+        _stprintf(
+            name,
+            _T( "session%05lu" ),
+            ( unsigned long ) ( bench_sessions[ i ] - 1 )
+        );
+        text   = bench_load( path, name, FALSE );
+        result = config_open( &config, path );
+        if( result == ERR_OK ) {
+            result = config_index_compile( &config, path );
+            config_close( &config );
+        }
+        indexed = ( result == ERR_OK ) ? bench_load( path, name, TRUE ) : -1;
+        if( ( text < 0 ) || ( indexed < 0 ) ) {
+            fprintf( stderr, "unable to load a session (%d)\n", result );
+            result = ERR_FORMAT;
+            break;
+        }
+        printf(
+            "%8lu  %10.3f  %10.3f  %7.1f\n",
+            ( unsigned long ) bench_sessions[ i ],
+            text,
+            indexed,
+            ( ( indexed > 0 ) ? ( text / indexed ) : 0.0 )
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Remove the files.
+    ------------------------------------------------------------------*/
+    DeleteFile( index_path );
+    DeleteFile( path );
+    return ( result == ERR_OK ) ? 0 : 1;
+}
+
+
+/*==========================================================================*/
+double bench_load(                  /* time opening and loading a session   */
+    LPCTSTR             path,       /* path to the configuration            */
+    LPCTSTR             name,       /* session to load                      */
+    BOOL                indexed     /* the index must be used               */
+) {                                 /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time so far (ms)                */
+    config_file_type    config;     /* configuration file object            */
+    LARGE_INTEGER       frequency;  /* performance counter frequency        */
+    DWORD               i;          /* run index                            */
+    DWORD               index;      /* index of the session                 */
+    error_type          result;     /* result of a run                      */
+    config_session_type*
+                        session;    /* loaded session                       */
+    LARGE_INTEGER       start;      /* counter before a run                 */
+    LARGE_INTEGER       stop;       /* counter after a run                  */
+    double              time;       /* time of a run (ms)                   */
+
+    /*------------------------------------------------------------------
+    Each run does what a restore of one session does first.
+    ------------------------------------------------------------------*/
+    QueryPerformanceFrequency( &frequency );
+    best = -1;
+    for( i = 0; i < BENCH_RUNS; ++i ) {
+        QueryPerformanceCounter( &start );
+        result = config_open( &config, path );
+        if( result != ERR_OK ) {
+            return -1;
+        }
+        index  = config_find( &config, name );
+        result = ( index == CONFIG_NONE ) ? ERR_NOT_FOUND
+               : config_load( &config, index, &session );
+        if( result == ERR_OK ) {
+            config_free_session( session );
+        }
+        QueryPerformanceCounter( &stop );
+
+        /*--------------------------------------------------------------
+        Make sure the path meant to be timed was the one taken.
+        --------------------------------------------------------------*/
+        if( ( result != ERR_OK )
+         || ( ( config.index != NULL ) != ( indexed != FALSE ) ) ) {
+            config_close( &config );
+            return -1;
+        }
+        config_close( &config );
+        time = ( ( double ) ( stop.QuadPart - start.QuadPart ) * 1000.0 )
+             / ( double ) frequency.QuadPart;
+        if( ( best < 0 ) || ( time < best ) ) {
+            best = time;
+        }
+    }
+    return best;
+}
+
+
+/*==========================================================================*/
+error_type write_config(            /* write a synthetic configuration      */
+    LPCTSTR             path,       /* path to the configuration            */
+    DWORD               count       /* number of sessions                   */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    HANDLE              file;       /* configuration file handle            */
+    DWORD               i;          /* session index                        */
+    DWORD               k;          /* window index                         */
+    DWORD               size;       /* length of the text (bytes)           */
+    LPSTR               text;       /* text of the configuration            */
+    BOOL                wresult;    /* result of Windows API calls          */
+    DWORD               written;    /* number of bytes written              */
+
+    /*------------------------------------------------------------------
+    Every session has the same kind of windows: a command with a few
+    arguments, a rectangle, and a name, some ordered after another.
+    ------------------------------------------------------------------*/
+    text = ( LPSTR ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( 64 + ( count * ( 64 + ( BENCH_WINDOWS * BENCH_WINDOW_SIZE ) ) ) )
+    );
+    if( text == NULL ) {
+        return ERR_ALLOC;
+    }
+    size = sprintf( text, "{ \"sessions\": {\n" );
+    for( i = 0; i < count; ++i ) {
+        size += sprintf(
+            ( text + size ),
+            "  \"session%05lu\": [\n",
+            ( unsigned long ) i
+        );
+        for( k = 0; k < BENCH_WINDOWS; ++k ) {
+            size += sprintf(
+                ( text + size ),
+                "    { \"name\": \"w%lu\", \"command\": "
+                "\"C:\\\\Program Files\\\\Tool %lu\\\\tool.exe\", "
+                "\"arguments\": [ \"--profile\", \"p%lu\", "
+                "\"C:\\\\work\\\\project %lu\" ], "
+                "\"rectangle\": [ %lu, %lu, %lu, %lu ]%s }%s\n",
+                ( unsigned long ) k,
+                ( unsigned long ) k,
+                ( unsigned long ) i,
+                ( unsigned long ) i,
+                ( unsigned long ) ( k * 100 ),
+                ( unsigned long ) ( k * 50 ),
+                ( unsigned long ) ( ( k * 100 ) + 800 ),
+                ( unsigned long ) ( ( k * 50 ) + 600 ),
+                ( ( k > 0 ) ? ", \"after\": [ \"w0\" ]" : "" ),
+                ( ( ( k + 1 ) < BENCH_WINDOWS ) ? "," : "" )
+            );
+        }
+        size += sprintf(
+            ( text + size ),
+            "  ]%s\n",
+            ( ( ( i + 1 ) < count ) ? "," : "" )
+        );
+    }
+    size += sprintf( ( text + size ), "} }\n" );
+
+    /*------------------------------------------------------------------
+    Write the text.
+    ------------------------------------------------------------------*/
+    file = CreateFile(
+        path,
+        GENERIC_WRITE,
+        0,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if( file == INVALID_HANDLE_VALUE ) {
+        HeapFree( GetProcessHeap(), 0, text );
+        return ERR_WINAPI;
+    }
+    wresult = WriteFile( file, text, size, &written, NULL );
+    CloseHandle( file );
+    HeapFree( GetProcessHeap(), 0, text );
+    return ( ( wresult != FALSE ) && ( written == size ) )
+         ? ERR_OK : ERR_WINAPI;
+}
+
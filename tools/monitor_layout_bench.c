@@ -0,0 +1,226 @@
+/*****************************************************************************
+
+monitor_layout_bench.c
+
+Monitor Layout Remapping Benchmark
+
+Times monitor_layout_remap on synthetic layouts, so the numbers do not
+depend on the machine's monitors: a row of 1080p monitors at 96 DPI is
+remapped onto a smaller row of 1440p monitors at 144 DPI.  Each run remaps
+a fresh copy of the same random rectangles; the best of several runs is
+reported, in total and per rectangle.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "monitor_layout.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define BENCH_RUNS          ( 9 )   /* runs timed for each case             */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const DWORD bench_monitors[] = { 1, 2, 4, 8, 16 };
+                                    /* captured monitors in each case       */
+
+static const DWORD bench_rectangles[] = { 1000, 10000, 100000 };
+                                    /* rectangles in each case              */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+double bench_remap(                 /* time remapping rectangles            */
+    DWORD               monitor_count,
+                                    /* number of captured monitors          */
+    DWORD               count       /* number of rectangles                 */
+);                                  /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time of a case (ms)             */
+    DWORD               i;          /* monitor case index                   */
+    DWORD               j;          /* rectangle case index                 */
+
+    /*------------------------------------------------------------------
+    Time every combination of monitors and rectangles.
+    ------------------------------------------------------------------*/
+    printf( "monitors  rectangles   best (ms)   ns/rectangle\n" );
+    for( i = 0; i < ( sizeof( bench_monitors ) / sizeof( DWORD ) ); ++i ) {
+        for( j = 0; j < ( sizeof( bench_rectangles ) / sizeof( DWORD ) );
+             ++j ) {
+            best = bench_remap( bench_monitors[ i ], bench_rectangles[ j ] );
+            if( best < 0 ) {
+                fprintf( stderr, "unable to remap\n" );
+                return 1;
+            }
+            printf(
+                "%8lu  %10lu  %10.3f  %13.1f\n",
+                ( unsigned long ) bench_monitors[ i ],
+                ( unsigned long ) bench_rectangles[ j ],
+                best,
+                ( ( best * 1e6 ) / bench_rectangles[ j ] )
+            );
+        }
+    }
+    return 0;
+}
+
+
+/*==========================================================================*/
+double bench_remap(                 /* time remapping rectangles            */
+    DWORD               monitor_count,
+                                    /* number of captured monitors          */
+    DWORD               count       /* number of rectangles                 */
+) {                                 /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time so far (ms)                */
+    config_monitor_type captured[ MONITOR_LAYOUT_LIMIT ];
+                                    /* row of 1080p monitors                */
+    config_monitor_type current[ MONITOR_LAYOUT_LIMIT ];
+                                    /* row of 1440p monitors                */
+    DWORD               current_count;
+                                    /* number of current monitors           */
+    LARGE_INTEGER       frequency;  /* performance counter frequency        */
+    DWORD               i;          /* monitor, rectangle, or run index     */
+    DWORD               k;          /* rectangle index                      */
+    monitor_layout_type layout;     /* current layout                       */
+    RECT*               original;   /* rectangles before remapping          */
+    error_type          result;     /* result of remapping                  */
+    DWORD               seed;       /* random number state                  */
+    config_session_type*
+                        session;    /* rectangles being remapped            */
+    LARGE_INTEGER       start;      /* counter before a run                 */
+    LARGE_INTEGER       stop;       /* counter after a run                  */
+    double              time;       /* time of a run (ms)                   */
+    LONG                x;          /* random left edge                     */
+    LONG                y;          /* random top edge                      */
+
+    /*------------------------------------------------------------------
+    Lay out the monitors: the current row has half as many (at least
+    one), so most captured monitors are gone and must be paired.
+    ------------------------------------------------------------------*/
+    current_count = ( monitor_count + 1 ) / 2;
+    for( i = 0; i < monitor_count; ++i ) {
+        SetRect(
+            &( captured[ i ].rectangle ),
+            ( ( LONG ) i * 1920 ), 0, ( ( LONG ) ( i + 1 ) * 1920 ), 1080
+        );
+        captured[ i ].work         = captured[ i ].rectangle;
+        captured[ i ].work.bottom -= 40;
+        captured[ i ].dpi          = 96;
+    }
+    for( i = 0; i < current_count; ++i ) {
+        SetRect(
+            &( current[ i ].rectangle ),
+            ( ( LONG ) i * 2560 ), 0, ( ( LONG ) ( i + 1 ) * 2560 ), 1440
+        );
+        current[ i ].work         = current[ i ].rectangle;
+        current[ i ].work.bottom -= 48;
+        current[ i ].dpi          = 144;
+    }
+
+    /*------------------------------------------------------------------
+    Scatter the rectangles over the captured monitors.
+    ------------------------------------------------------------------*/
+    session = ( config_session_type* ) HeapAlloc(
+        GetProcessHeap(),
+        HEAP_ZERO_MEMORY,
+        ( sizeof( config_session_type )
+        + ( count * sizeof( config_window_type ) ) )
+    );
+    original = ( RECT* ) HeapAlloc(
+        GetProcessHeap(),
+        0,
+        ( count * sizeof( RECT ) )
+    );
+    if( ( session == NULL ) || ( original == NULL ) ) {
+        if( session != NULL ) {
+            HeapFree( GetProcessHeap(), 0, session );
+        }
+        if( original != NULL ) {
+            HeapFree( GetProcessHeap(), 0, original );
+        }
+        return -1;
+    }
+    session->monitors      = captured;
+    session->monitor_count = monitor_count;
+    session->count         = count;
+    seed = 1;
+    for( i = 0; i < count; ++i ) {
+        seed = ( seed * 1103515245 ) + 12345;
+        x    = ( LONG ) ( ( seed >> 8 ) % ( monitor_count * 1920 ) );
+        seed = ( seed * 1103515245 ) + 12345;
+        y    = ( LONG ) ( ( seed >> 8 ) % 1080 );
+        seed = ( seed * 1103515245 ) + 12345;
+        SetRect(
+            &( original[ i ] ),
+            x,
+            y,
+            ( x + 100 + ( LONG ) ( ( seed >> 8 ) % 1200 ) ),
+            ( y + 100 + ( LONG ) ( ( seed >> 16 ) % 800 ) )
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Time each run from the same rectangles.  The first run also builds
+    the remap table; later runs find it in the cache.
+    ------------------------------------------------------------------*/
+    QueryPerformanceFrequency( &frequency );
+    monitor_layout_set( &layout, current, current_count );
+    best   = -1;
+    result = ERR_OK;
+    for( i = 0; ( i < BENCH_RUNS ) && ( result == ERR_OK ); ++i ) {
+        for( k = 0; k < count; ++k ) {
+            session->windows[ k ].rectangle = original[ k ];
+        }
+        QueryPerformanceCounter( &start );
+        result = monitor_layout_remap( &layout, &session, 1 );
+        QueryPerformanceCounter( &stop );
+        time = ( ( double ) ( stop.QuadPart - start.QuadPart ) * 1000.0 )
+             / ( double ) frequency.QuadPart;
+        if( ( best < 0 ) || ( time < best ) ) {
+            best = time;
+        }
+    }
+    HeapFree( GetProcessHeap(), 0, session );
+    HeapFree( GetProcessHeap(), 0, original );
+    return ( result == ERR_OK ) ? best : -1;
+}
+
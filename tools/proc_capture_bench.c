@@ -0,0 +1,217 @@
+/*****************************************************************************
+
+proc_capture_bench.c
+
+Parallel Process Capture Benchmark
+
+Times proc_capture_run over this machine's process table with 1, 2, 4, ...
+workers, up to one per CPU (or the number given on the command line).
+Every run queries the same snapshot for images, commands, and owners into
+a fresh string pool; the best of several runs is reported with its
+speedup over a single worker.  Run it as an administrator to query every
+process rather than only the user's.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <windows.h>
+
+#include "proc_capture.h"
+#include "proc_info.h"
+#include "proc_pool.h"
+#include "proc_snapshot.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define BENCH_RUNS          ( 5 )   /* runs timed for each worker count     */
+
+#define BENCH_FIELDS \
+    ( PROC_FIELD_IMAGE | PROC_FIELD_COMMAND | PROC_FIELD_OWNER )
+                                    /* fields each run queries              */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+double bench_capture(               /* time capturing a snapshot            */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* processes to query                   */
+    DWORD               workers,    /* worker threads                       */
+    DWORD*              failed      /* returned number of processes that    */
+                                    /* could not be queried                 */
+);                                  /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time with some workers (ms)     */
+    DWORD               failed;     /* processes that could not be queried  */
+    proc_instance_type  instance;   /* process information instance         */
+    DWORD               limit;      /* most workers timed                   */
+    error_type          result;     /* result of internal operation         */
+    double              single;     /* best time with one worker (ms)       */
+    proc_snapshot_type  snapshot;   /* processes to query                   */
+    SYSTEM_INFO         system;     /* number of CPUs                       */
+    DWORD               workers;    /* worker threads in this case          */
+
+    /*------------------------------------------------------------------
+    Take one snapshot, so every run queries the same processes.
+    ------------------------------------------------------------------*/
+    GetSystemInfo( &system );
+    limit = ( argc > 1 ) ? ( DWORD ) strtoul( argv[ 1 ], NULL, 10 )
+                         : system.dwNumberOfProcessors;
+    if( limit == 0 ) {
+        limit = 1;
+    }
+    result = proc_init( &instance );
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to initialize (%d)\n", result );
+        return 1;
+    }
+    result = proc_snapshot_take( &instance, &snapshot );
+    if( result != ERR_OK ) {
+        fprintf( stderr, "unable to read processes (%d)\n", result );
+        proc_term( &instance );
+        return 1;
+    }
+
+    /*------------------------------------------------------------------
+    Double the workers up to the limit, and always time the limit.
+    ------------------------------------------------------------------*/
+    printf( "workers  processes  failed   best (ms)  speedup\n" );
+    single  = 0;
+    workers = 1;
+    for( ; ; ) {
+        best = bench_capture( &instance, &snapshot, workers, &failed );
+        if( best < 0 ) {
+            fprintf( stderr, "unable to capture processes\n" );
+            break;
+        }
+        if( workers == 1 ) {
+            single = best;
+        }
+        printf(
+            "%7lu  %9lu  %6lu  %10.3f  %7.2f\n",
+            ( unsigned long ) workers,
+            ( unsigned long ) snapshot.count,
+            ( unsigned long ) failed,
+            best,
+            ( ( best > 0 ) ? ( single / best ) : 0.0 )
+        );
+        if( workers >= limit ) {
+            break;
+        }
+        workers = ( ( 2 * workers ) < limit ) ? ( 2 * workers ) : limit;
+    }
+
+    /*------------------------------------------------------------------
+    Release the snapshot and the instance.
+    ------------------------------------------------------------------*/
+    proc_snapshot_free( &snapshot );
+    proc_term( &instance );
+    return ( best < 0 ) ? 1 : 0;
+}
+
+
+/*==========================================================================*/
+double bench_capture(               /* time capturing a snapshot            */
+    proc_instance_type* instance,   /* process information instance         */
+    proc_snapshot_type* snapshot,   /* processes to query                   */
+    DWORD               workers,    /* worker threads                       */
+    DWORD*              failed      /* returned number of processes that    */
+                                    /* could not be queried                 */
+) {                                 /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time so far (ms)                */
+    proc_capture_type   capture;    /* results of a run                     */
+    LARGE_INTEGER       frequency;  /* performance counter frequency        */
+    DWORD               i;          /* run or item index                    */
+    DWORD               k;          /* item index                           */
+    proc_pool_type      pool;       /* strings of a run                     */
+    error_type          result;     /* result of a run                      */
+    LARGE_INTEGER       start;      /* counter before a run                 */
+    LARGE_INTEGER       stop;       /* counter after a run                  */
+    double              time;       /* time of a run (ms)                   */
+
+    /*------------------------------------------------------------------
+    Time each run from an empty pool.
+    ------------------------------------------------------------------*/
+    QueryPerformanceFrequency( &frequency );
+    best    = -1;
+    *failed = 0;
+    for( i = 0; i < BENCH_RUNS; ++i ) {
+        if( proc_pool_init( &pool ) != ERR_OK ) {
+            return -1;
+        }
+        QueryPerformanceCounter( &start );
+        result = proc_capture_run(
+            instance,
+            snapshot,
+            BENCH_FIELDS,
+            workers,
+            INFINITE,
+            INFINITE,
+            &pool,
+            &capture
+        );
+        QueryPerformanceCounter( &stop );
+        if( result != ERR_OK ) {
+            proc_pool_free( &pool );
+            return -1;
+        }
+        time = ( ( double ) ( stop.QuadPart - start.QuadPart ) * 1000.0 )
+             / ( double ) frequency.QuadPart;
+        if( ( best < 0 ) || ( time < best ) ) {
+            best = time;
+        }
+
+        /*--------------------------------------------------------------
+        Count the processes that could not be queried (those of other
+        users, without the rights to read them).
+        --------------------------------------------------------------*/
+        *failed = 0;
+        for( k = 0; k < capture.count; ++k ) {
+            if( capture.items[ k ].result != ERR_OK ) {
+                *failed += 1;
+            }
+        }
+        proc_capture_free( &capture );
+        proc_pool_free( &pool );
+    }
+    return best;
+}
+
@@ -0,0 +1,379 @@
+/*****************************************************************************
+
+proc_pool_bench.c
+
+Interned String Pool Benchmark
+
+Measures the memory a capture's strings take with and without the pool, on
+a synthetic process table shaped like a busy desktop: service host groups,
+browser renderers, a Java service with a long class path, console hosts,
+and assorted programs with documents open.  Before is what each process
+took when its item held its own single-block command object.  After is the
+pool's text, entries and hash slots, plus each item and its list of string
+IDs.  Every string is then looked up again with its case changed, to check
+that it finds the same folded ID.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "proc_arena.h"
+#include "proc_capture.h"
+#include "proc_info.h"
+#include "proc_pool.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define BENCH_STRINGS       ( 12 )  /* most strings in one process          */
+
+#define BENCH_TEXT_SIZE     ( 4096 )/* most characters in one process       */
+
+#define BENCH_ROUND( _size ) \
+    ( ( ( _size ) + ( PROC_ARENA_ALIGN - 1 ) ) & ~( PROC_ARENA_ALIGN - 1 ) )
+                                    /* round a size up to arena alignment   */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+typedef struct bench_old_item_s {   /* captured process before the pool     */
+    DWORD               id;         /* process ID                           */
+    error_type          result;     /* result of querying the process       */
+    proc_fields_t32     fields;     /* fields that were loaded              */
+    LPTSTR              image;      /* image file name                      */
+    proc_command_type*  command;    /* process start command                */
+    PSID                owner;      /* owner (user) SID                     */
+} bench_old_item_type;
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+static const DWORD bench_processes[] = { 1000, 5000, 20000 };
+                                    /* processes in each case               */
+
+static LPCTSTR bench_groups[] = {
+    _T( "netsvcs" ), _T( "LocalService" ), _T( "DcomLaunch" ), _T( "RPCSS" ),
+    _T( "LocalSystemNetworkRestricted" ), _T( "UnistackSvcGroup" )
+};                                  /* service host groups                  */
+
+static LPCTSTR bench_services[] = {
+    _T( "BITS" ), _T( "Dhcp" ), _T( "EventLog" ), _T( "Schedule" ),
+    _T( "Themes" ), _T( "WinHttpAutoProxySvc" ), _T( "CryptSvc" ),
+    _T( "Dnscache" ), _T( "LanmanWorkstation" ), _T( "wuauserv" )
+};                                  /* hosted services                      */
+
+static LPCTSTR bench_apps[] = {
+    _T( "C:\\Windows\\System32\\notepad.exe" ),
+    _T( "C:\\Program Files\\Microsoft VS Code\\Code.exe" ),
+    _T( "C:\\Program Files\\Microsoft Office\\root\\Office16\\WINWORD.EXE" ),
+    _T( "C:\\Program Files\\Microsoft Office\\root\\Office16\\EXCEL.EXE" ),
+    _T( "C:\\Windows\\explorer.exe" ),
+    _T( "C:\\Program Files\\Mozilla Firefox\\firefox.exe" ),
+    _T( "C:\\Program Files\\Git\\usr\\bin\\mintty.exe" ),
+    _T( "C:\\Program Files\\7-Zip\\7zFM.exe" )
+};                                  /* assorted programs                    */
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+static TCHAR bench_class_path[ 2048 ];
+                                    /* Java class path shared by services   */
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+DWORD bench_process(                /* describe one synthetic process       */
+    DWORD               index,      /* process index                        */
+    LPTSTR              text,       /* storage for the strings              */
+    LPCTSTR*            strings     /* returned image, directory, and       */
+                                    /* command strings                      */
+);                                  /* returns number of command strings    */
+
+error_type bench_pool(              /* intern a process table, and count    */
+                                    /* the memory both ways                 */
+    DWORD               count,      /* number of processes                  */
+    SIZE_T*             before,     /* returned bytes without the pool      */
+    SIZE_T*             after       /* returned bytes with the pool         */
+);                                  /* returns error code                   */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    SIZE_T              after;      /* bytes with the pool                  */
+    SIZE_T              before;     /* bytes without the pool               */
+    DWORD               i;          /* case index                           */
+    DWORD               length;     /* length of the class path             */
+    error_type          result;     /* result of a case                     */
+
+    /*------------------------------------------------------------------
+    Every Java service shares one long class path.
+    ------------------------------------------------------------------*/
+    length = 0;
+    for( i = 0; i < 40; ++i ) {
+        length += _stprintf(
+            ( bench_class_path + length ),
+            _T( "%sC:\\work\\lib\\component-%02lu-1.4.2.jar" ),
+            ( ( i > 0 ) ? _T( ";" ) : _T( "" ) ),
+            ( unsigned long ) i
+        );
+    }
+
+    /*------------------------------------------------------------------
+    Measure each size of process table.
+    ------------------------------------------------------------------*/
+    printf( "processes  before (KB)  after (KB)  saved\n" );
+    for( i = 0; i < ( sizeof( bench_processes ) / sizeof( DWORD ) ); ++i ) {
+        result = bench_pool( bench_processes[ i ], &before, &after );
+        if( result != ERR_OK ) {
+            fprintf(
+                stderr,
+                "unable to intern or find the strings (%d)\n",
+                result
+            );
+            return 1;
+        }
+        printf(
+            "%9lu  %11.1f  %10.1f  %4.0f%%\n",
+            ( unsigned long ) bench_processes[ i ],
+            ( ( double ) before / 1024.0 ),
+            ( ( double ) after / 1024.0 ),
+            ( 100.0 * ( 1.0 - ( ( double ) after / ( double ) before ) ) )
+        );
+    }
+    return 0;
+}
+
+
+/*==========================================================================*/
+DWORD bench_process(                /* describe one synthetic process       */
+    DWORD               index,      /* process index                        */
+    LPTSTR              text,       /* storage for the strings              */
+    LPCTSTR*            strings     /* returned image, directory, and       */
+                                    /* command strings                      */
+) {                                 /* returns number of command strings    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               count;      /* number of strings                    */
+    DWORD               group;      /* which of its kind the process is     */
+
+    /*------------------------------------------------------------------
+    Strings that differ per process are written to the storage; the
+    rest are constants.
+    ------------------------------------------------------------------*/
+    group = index / 16;
+    switch( index % 16 ) {
+
+        /*--------------------------------------------------------------
+        Service hosts, one service each.
+        --------------------------------------------------------------*/
+        case 0: case 1: case 2: case 3: case 4: case 5:
+            strings[ 0 ] = _T( "C:\\Windows\\System32\\svchost.exe" );
+            strings[ 1 ] = _T( "C:\\Windows\\system32\\" );
+            strings[ 2 ] = _T( "C:\\Windows\\system32\\svchost.exe" );
+            strings[ 3 ] = _T( "-k" );
+            strings[ 4 ] = bench_groups[ index % 6 ];
+            strings[ 5 ] = _T( "-p" );
+            strings[ 6 ] = _T( "-s" );
+            strings[ 7 ] = text;
+            _stprintf(
+                text,
+                _T( "%s%lu" ),
+                bench_services[ group % 10 ],
+                ( unsigned long ) ( ( group / 10 ) % 4 )
+            );
+            count = 8;
+            break;
+
+        /*--------------------------------------------------------------
+        Browser renderers, with a few unique switches each.
+        --------------------------------------------------------------*/
+        case 6: case 7: case 8: case 9:
+            strings[ 0 ] = _T( "C:\\Program Files\\Google\\Chrome\\"
+                               "Application\\chrome.exe" );
+            strings[ 1 ] = _T( "C:\\Program Files\\Google\\Chrome\\"
+                               "Application\\120.0.6099.130\\" );
+            strings[ 2 ] = strings[ 0 ];
+            strings[ 3 ] = _T( "--type=renderer" );
+            strings[ 4 ] = _T( "--lang=en-US" );
+            strings[ 5 ] = _T( "--field-trial-handle=1864,i,13804283455410"
+                               "11443,12337283456217043562,262144" );
+            strings[ 6 ] = _T( "--disable-features=BackForwardCache,"
+                               "CalculateNativeWinOcclusion" );
+            strings[ 7 ] = text;
+            strings[ 8 ] = text + 64;
+            _stprintf(
+                text,
+                _T( "--renderer-client-id=%lu" ),
+                ( unsigned long ) ( index + 7 )
+            );
+            _stprintf(
+                ( text + 64 ),
+                _T( "--launch-time-ticks=%lu" ),
+                ( unsigned long ) ( 91234567 + ( index * 1313 ) )
+            );
+            count = 9;
+            break;
+
+        /*--------------------------------------------------------------
+        Java services sharing a class path.
+        --------------------------------------------------------------*/
+        case 10:
+            strings[ 0 ] = _T( "C:\\Program Files\\Java\\jdk-17\\bin\\"
+                               "java.exe" );
+            strings[ 1 ] = text;
+            strings[ 2 ] = strings[ 0 ];
+            strings[ 3 ] = _T( "-Xmx2g" );
+            strings[ 4 ] = _T( "-cp" );
+            strings[ 5 ] = bench_class_path;
+            strings[ 6 ] = _T( "com.example.service.Main" );
+            strings[ 7 ] = text + 64;
+            _stprintf(
+                text,
+                _T( "C:\\work\\service%lu\\" ),
+                ( unsigned long ) ( group % 8 )
+            );
+            _stprintf(
+                ( text + 64 ),
+                _T( "--port=%lu" ),
+                ( unsigned long ) ( 8000 + ( group % 50 ) )
+            );
+            count = 8;
+            break;
+
+        /*--------------------------------------------------------------
+        Console hosts are all the same.
+        --------------------------------------------------------------*/
+        case 11: case 12:
+            strings[ 0 ] = _T( "C:\\Windows\\System32\\conhost.exe" );
+            strings[ 1 ] = _T( "C:\\Windows\\system32\\" );
+            strings[ 2 ] = _T( "\\??\\C:\\Windows\\system32\\conhost.exe" );
+            strings[ 3 ] = _T( "0xffffffff" );
+            strings[ 4 ] = _T( "-ForceV1" );
+            count = 5;
+            break;
+
+        /*--------------------------------------------------------------
+        Assorted programs, each with a document open.
+        --------------------------------------------------------------*/
+        default:
+            strings[ 0 ] = bench_apps[ ( index + group ) % 8 ];
+            strings[ 1 ] = _T( "C:\\Users\\user\\" );
+            strings[ 2 ] = strings[ 0 ];
+            strings[ 3 ] = text;
+            _stprintf(
+                text,
+                _T( "C:\\Users\\user\\Documents\\report-%lu.txt" ),
+                ( unsigned long ) ( group % 300 )
+            );
+            count = 4;
+            break;
+    }
+    return count;
+}
+
+
+/*==========================================================================*/
+error_type bench_pool(              /* intern a process table, and count    */
+                                    /* the memory both ways                 */
+    DWORD               count,      /* number of processes                  */
+    SIZE_T*             before,     /* returned bytes without the pool      */
+    SIZE_T*             after       /* returned bytes with the pool         */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    TCHAR               changed[ BENCH_TEXT_SIZE ];
+                                    /* string with its case changed         */
+    proc_arena_chunk_type*
+                        chunk;      /* chunk of the pool's arena            */
+    SIZE_T              characters; /* characters in one process' strings   */
+    DWORD               i;          /* process index                        */
+    DWORD               id;         /* ID of an interned string             */
+    DWORD               k;          /* string index                         */
+    proc_pool_type      pool;       /* interned string pool                 */
+    error_type          result;     /* result of internal operation         */
+    DWORD               total;      /* number of strings in the process     */
+    LPCTSTR             strings[ BENCH_STRINGS ];
+                                    /* image, directory, and command        */
+    TCHAR               text[ BENCH_TEXT_SIZE ];
+                                    /* storage for the strings              */
+
+    /*------------------------------------------------------------------
+    Intern every process' strings, counting what each process took
+    before: an item, and a command object holding its own copy of every
+    string.
+    ------------------------------------------------------------------*/
+    result = proc_pool_init( &pool );
+    if( result != ERR_OK ) {
+        return result;
+    }
+    *before = 0;
+    *after  = 0;
+    for( i = 0; ( i < count ) && ( result == ERR_OK ); ++i ) {
+        total      = bench_process( i, text, strings );
+        characters = 0;
+        for( k = 0; ( k < total ) && ( result == ERR_OK ); ++k ) {
+            characters += _tcslen( strings[ k ] ) + 1;
+            result      = proc_pool_intern( &pool, strings[ k ], &id );
+        }
+        *before += sizeof( bench_old_item_type ) + BENCH_ROUND(
+            sizeof( proc_command_type )
+            + ( ( total - 2 ) * sizeof( LPTSTR ) )
+            + ( characters * sizeof( TCHAR ) )
+        );
+        *after  += sizeof( proc_capture_item_type )
+                 + BENCH_ROUND( ( total - 2 ) * sizeof( DWORD ) );
+    }
+
+    /*------------------------------------------------------------------
+    Add the pool itself: its arena, entries, and both kinds of slot.
+    ------------------------------------------------------------------*/
+    for( chunk = pool.arena.head; chunk != NULL; chunk = chunk->next ) {
+        *after += sizeof( proc_arena_chunk_type ) + chunk->size;
+    }
+    *after += ( pool.capacity * sizeof( proc_pool_entry_type ) )
+            + ( 2 * pool.slot_count * sizeof( DWORD ) );
+
+    /*------------------------------------------------------------------
+    Every string must find its own folded ID with its case swapped.
+    ------------------------------------------------------------------*/
+    for( id = 0; ( id < pool.count ) && ( result == ERR_OK ); ++id ) {
+        _tcscpy( changed, proc_pool_get( &pool, id ) );
+        for( k = 0; changed[ k ] != _T( '\0' ); ++k ) {
+            changed[ k ] = _istupper( ( _TUCHAR ) changed[ k ] )
+                         ? _totlower( ( _TUCHAR ) changed[ k ] )
+                         : _totupper( ( _TUCHAR ) changed[ k ] );
+        }
+        if( proc_pool_find( &pool, changed, TRUE )
+            != proc_pool_fold( &pool, id ) ) {
+            result = ERR_NOT_FOUND;
+        }
+    }
+    proc_pool_free( &pool );
+    return result;
+}
+
@@ -0,0 +1,416 @@
+/*****************************************************************************
+
+restore_latency_bench.c
+
+Resident Restore Latency Benchmark
+
+Times one restore three ways: a cold run of the program with nothing
+resident, a run of the program that hands the restore to a resident
+restore, and the pipe request alone (what that hand-off costs once the
+client process is running).  The program is the winsession.exe beside
+this benchmark, or the one given as the first argument; any further
+arguments are the restore's arguments.  Without them, a session that does
+not exist is requested, which times starting up and answering without
+touching any windows.  To time a whole restore without starting anything,
+give "--layout-only" and a session's name.
+
+Stop any resident restore before running this.  The benchmark starts its
+own, and stops it when done.
+
+*****************************************************************************/
+
+/*----------------------------------------------------------------------------
+Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include <tchar.h>
+
+#include "restore_pipe.h"
+
+/*----------------------------------------------------------------------------
+Macros
+----------------------------------------------------------------------------*/
+
+#define BENCH_RUNS          ( 9 )   /* runs timed for each way              */
+
+#define BENCH_IMAGE         _T( "winsession.exe" )
+                                    /* program started, beside this one     */
+
+#define BENCH_SESSION       _T( "winsession-bench-none" )
+                                    /* session requested by default         */
+
+#define BENCH_READY         ( 10000 )
+                                    /* limit on the resident restore's      */
+                                    /* start (ms)                           */
+
+/*----------------------------------------------------------------------------
+Types and Structures
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Memory Constants
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Variables
+----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+Module Prototypes
+----------------------------------------------------------------------------*/
+
+error_type bench_command(           /* build a command line                 */
+    LPTSTR              command,    /* returned command line                */
+                                    /* (RESTORE_PIPE_SIZE characters)       */
+    LPCTSTR             image,      /* program to start                     */
+    LPCTSTR*            arguments,  /* program's arguments                  */
+    DWORD               count       /* number of arguments                  */
+);                                  /* returns error code                   */
+
+double bench_run(                   /* time running the program             */
+    LPCTSTR             command     /* command line to run                  */
+);                                  /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+double bench_send(                  /* time sending the pipe request        */
+    LPCTSTR*            arguments,  /* arguments to send                    */
+    DWORD               count       /* number of arguments                  */
+);                                  /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+BOOL start_resident(                /* start a resident restore             */
+    LPCTSTR             image,      /* program to start                     */
+    LPCTSTR*            arguments,  /* arguments of the restores timed      */
+    DWORD               count,      /* number of arguments                  */
+    PROCESS_INFORMATION*
+                        process     /* returned resident process            */
+);                                  /* returns TRUE once it is answering    */
+
+/*----------------------------------------------------------------------------
+Implementation
+----------------------------------------------------------------------------*/
+
+/*==========================================================================*/
+int main(                           /* program entry point                  */
+    int                 argc,       /* number of arguments                  */
+    char**              argv        /* list of arguments                    */
+) {                                 /* returns program exit status          */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    LPCTSTR*            arguments;  /* restore's arguments                  */
+    double              client;     /* best time handing off (ms)           */
+    double              cold;       /* best time with nothing resident (ms) */
+    TCHAR               command[ RESTORE_PIPE_SIZE ];
+                                    /* command line of a restore            */
+    DWORD               count;      /* number of restore's arguments        */
+    LPCTSTR             fallback[ 1 ];
+                                    /* restore's arguments by default       */
+    TCHAR               image[ MAX_PATH ];
+                                    /* program to start                     */
+    LPTSTR              name;       /* file name in the program's path      */
+    double              pipe;       /* best time of the request alone (ms)  */
+    PROCESS_INFORMATION resident;   /* resident restore process             */
+    DWORD               status;     /* exit status of a request             */
+    LPCTSTR             stop[ 1 ];  /* request to stop the resident restore */
+
+    /*------------------------------------------------------------------
+    Find the program and the restore's arguments.
+    ------------------------------------------------------------------*/
+    if( argc > 1 ) {
+        if( _tcslen( argv[ 1 ] ) >= MAX_PATH ) {
+            fprintf( stderr, "program path is too long\n" );
+            return 1;
+        }
+        _tcscpy( image, argv[ 1 ] );
+    }
+    else {
+        count = GetModuleFileName( NULL, image, MAX_PATH );
+        name  = _tcsrchr( image, _T( '\\' ) );
+        name  = ( name != NULL ) ? ( name + 1 ) : image;
+        if( ( count == 0 ) || ( count >= MAX_PATH )
+         || ( ( ( name - image ) + _tcslen( BENCH_IMAGE ) ) >= MAX_PATH ) ) {
+            fprintf( stderr, "unable to find the program\n" );
+            return 1;
+        }
+        _tcscpy( name, BENCH_IMAGE );
+    }
+    fallback[ 0 ] = BENCH_SESSION;
+    arguments     = ( argc > 2 ) ? ( LPCTSTR* ) ( argv + 2 ) : fallback;
+    count         = ( argc > 2 ) ? ( DWORD ) ( argc - 2 ) : 1;
+    if( bench_command( command, image, arguments, count ) != ERR_OK ) {
+        fprintf( stderr, "command line is too long\n" );
+        return 1;
+    }
+
+    /*------------------------------------------------------------------
+    A restore that is already resident would answer the cold runs.
+    ------------------------------------------------------------------*/
+    if( restore_pipe_send( arguments, count, 0, &status ) == ERR_OK ) {
+        fprintf( stderr, "stop the resident restore first\n" );
+        return 1;
+    }
+
+    /*------------------------------------------------------------------
+    Time the cold runs, then start a resident restore, and time handing
+    the same restore to it.
+    ------------------------------------------------------------------*/
+    cold = bench_run( command );
+    if( cold < 0 ) {
+        fprintf( stderr, "unable to run the program\n" );
+        return 1;
+    }
+    if( start_resident( image, arguments, count, &resident ) == FALSE ) {
+        fprintf( stderr, "unable to start a resident restore\n" );
+        return 1;
+    }
+    client = bench_run( command );
+    pipe   = bench_send( arguments, count );
+
+    /*------------------------------------------------------------------
+    Stop the resident restore.
+    ------------------------------------------------------------------*/
+    stop[ 0 ] = _T( "--stop" );
+    if( restore_pipe_send( stop, 1, RESTORE_PIPE_TIMEOUT, &status )
+        != ERR_OK ) {
+        TerminateProcess( resident.hProcess, 1 );
+    }
+    WaitForSingleObject( resident.hProcess, INFINITE );
+    CloseHandle( resident.hThread );
+    CloseHandle( resident.hProcess );
+    if( ( client < 0 ) || ( pipe < 0 ) ) {
+        fprintf( stderr, "unable to reach the resident restore\n" );
+        return 1;
+    }
+
+    /*------------------------------------------------------------------
+    Report the best times.
+    ------------------------------------------------------------------*/
+    printf( "restore                  best (ms)  speedup\n" );
+    printf( "cold program            %10.3f  %7.1f\n", cold, 1.0 );
+    printf(
+        "program to resident     %10.3f  %7.1f\n",
+        client,
+        ( ( client > 0 ) ? ( cold / client ) : 0.0 )
+    );
+    printf(
+        "request to resident     %10.3f  %7.1f\n",
+        pipe,
+        ( ( pipe > 0 ) ? ( cold / pipe ) : 0.0 )
+    );
+    return 0;
+}
+
+
+/*==========================================================================*/
+error_type bench_command(           /* build a command line                 */
+    LPTSTR              command,    /* returned command line                */
+                                    /* (RESTORE_PIPE_SIZE characters)       */
+    LPCTSTR             image,      /* program to start                     */
+    LPCTSTR*            arguments,  /* program's arguments                  */
+    DWORD               count       /* number of arguments                  */
+) {                                 /* returns error code                   */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    DWORD               i;          /* argument index                       */
+    size_t              length;     /* length of the command line so far    */
+
+    /*------------------------------------------------------------------
+    Quote the program and every argument.  Session names and options
+    hold no quotes of their own.
+    ------------------------------------------------------------------*/
+    length = _tcslen( image ) + 2;
+    if( length >= RESTORE_PIPE_SIZE ) {
+        return ERR_OVERFLOW;
+    }
+    _tcscpy( command, _T( "\"" ) );
+    _tcscat( command, image );
+    _tcscat( command, _T( "\"" ) );
+    for( i = 0; i < count; ++i ) {
+        length += _tcslen( arguments[ i ] ) + 3;
+        if( length >= RESTORE_PIPE_SIZE ) {
+            return ERR_OVERFLOW;
+        }
+        _tcscat( command, _T( " \"" ) );
+        _tcscat( command, arguments[ i ] );
+        _tcscat( command, _T( "\"" ) );
+    }
+    return ERR_OK;
+}
+
+
+/*==========================================================================*/
+double bench_run(                   /* time running the program             */
+    LPCTSTR             command     /* command line to run                  */
+) {                                 /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time so far (ms)                */
+    TCHAR               buffer[ RESTORE_PIPE_SIZE ];
+                                    /* command line CreateProcess may edit  */
+    LARGE_INTEGER       frequency;  /* performance counter frequency        */
+    DWORD               i;          /* run index                            */
+    PROCESS_INFORMATION process;    /* program run                          */
+    STARTUPINFO         startup;    /* program's startup information        */
+    LARGE_INTEGER       start;      /* counter before a run                 */
+    LARGE_INTEGER       stop;       /* counter after a run                  */
+    double              time;       /* time of a run (ms)                   */
+
+    /*------------------------------------------------------------------
+    Each run starts the program and waits for it to exit.  Its exit
+    status is the restore's, and does not matter here.
+    ------------------------------------------------------------------*/
+    QueryPerformanceFrequency( &frequency );
+    best = -1;
+    for( i = 0; i < BENCH_RUNS; ++i ) {
+        _tcscpy( buffer, command );
+        memset( &startup, 0, sizeof( STARTUPINFO ) );
+        startup.cb = sizeof( STARTUPINFO );
+        QueryPerformanceCounter( &start );
+        if( CreateProcess(
+            NULL,
+            buffer,
+            NULL,
+            NULL,
+            FALSE,
+            0,
+            NULL,
+            NULL,
+            &startup,
+            &process
+        ) == FALSE ) {
+            return -1;
+        }
+        WaitForSingleObject( process.hProcess, INFINITE );
+        QueryPerformanceCounter( &stop );
+        CloseHandle( process.hThread );
+        CloseHandle( process.hProcess );
+        time = ( ( double ) ( stop.QuadPart - start.QuadPart ) * 1000.0 )
+             / ( double ) frequency.QuadPart;
+        if( ( best < 0 ) || ( time < best ) ) {
+            best = time;
+        }
+    }
+    return best;
+}
+
+
+/*==========================================================================*/
+double bench_send(                  /* time sending the pipe request        */
+    LPCTSTR*            arguments,  /* arguments to send                    */
+    DWORD               count       /* number of arguments                  */
+) {                                 /* returns best time (ms), or a         */
+                                    /* negative number on failure           */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    double              best;       /* best time so far (ms)                */
+    LARGE_INTEGER       frequency;  /* performance counter frequency        */
+    DWORD               i;          /* run index                            */
+    LARGE_INTEGER       start;      /* counter before a run                 */
+    DWORD               status;     /* exit status of the request           */
+    LARGE_INTEGER       stop;       /* counter after a run                  */
+    double              time;       /* time of a run (ms)                   */
+
+    /*------------------------------------------------------------------
+    Each run is one request and its answer.
+    ------------------------------------------------------------------*/
+    QueryPerformanceFrequency( &frequency );
+    best = -1;
+    for( i = 0; i < BENCH_RUNS; ++i ) {
+        QueryPerformanceCounter( &start );
+        if( restore_pipe_send(
+            arguments,
+            count,
+            RESTORE_PIPE_TIMEOUT,
+            &status
+        ) != ERR_OK ) {
+            return -1;
+        }
+        QueryPerformanceCounter( &stop );
+        time = ( ( double ) ( stop.QuadPart - start.QuadPart ) * 1000.0 )
+             / ( double ) frequency.QuadPart;
+        if( ( best < 0 ) || ( time < best ) ) {
+            best = time;
+        }
+    }
+    return best;
+}
+
+
+/*==========================================================================*/
+BOOL start_resident(                /* start a resident restore             */
+    LPCTSTR             image,      /* program to start                     */
+    LPCTSTR*            arguments,  /* arguments of the restores timed      */
+    DWORD               count,      /* number of arguments                  */
+    PROCESS_INFORMATION*
+                        process     /* returned resident process            */
+) {                                 /* returns TRUE once it is answering    */
+
+    /*------------------------------------------------------------------
+    Local Variables
+    ------------------------------------------------------------------*/
+    TCHAR               command[ RESTORE_PIPE_SIZE ];
+                                    /* resident restore's command line      */
+    LPCTSTR             daemon[ 1 ];/* resident restore's argument          */
+    DWORD               i;          /* attempt index                        */
+    DWORD               status;     /* exit status of a request             */
+    STARTUPINFO         startup;    /* program's startup information        */
+
+    /*------------------------------------------------------------------
+    Start the program with --daemon.
+    ------------------------------------------------------------------*/
+    daemon[ 0 ] = _T( "--daemon" );
+    if( bench_command( command, image, daemon, 1 ) != ERR_OK ) {
+        return FALSE;
+    }
+    memset( &startup, 0, sizeof( STARTUPINFO ) );
+    startup.cb = sizeof( STARTUPINFO );
+    if( CreateProcess(
+        NULL,
+        command,
+        NULL,
+        NULL,
+        FALSE,
+        0,
+        NULL,
+        NULL,
+        &startup,
+        process
+    ) == FALSE ) {
+        return FALSE;
+    }
+
+    /*------------------------------------------------------------------
+    Wait for it to answer the first request, which also warms it up
+    (the process information is read on the first restore).
+    ------------------------------------------------------------------*/
+    for( i = 0; i < ( BENCH_READY / 10 ); ++i ) {
+        if( restore_pipe_send(
+            arguments,
+            count,
+            RESTORE_PIPE_TIMEOUT,
+            &status
+        ) == ERR_OK ) {
+            return TRUE;
+        }
+        if( WaitForSingleObject( process->hProcess, 10 ) == WAIT_OBJECT_0 ) {
+            break;
+        }
+    }
+    TerminateProcess( process->hProcess, 1 );
+    CloseHandle( process->hThread );
+    CloseHandle( process->hProcess );
+    return FALSE;
+}
+